@@ -147,3 +147,47 @@ if(CLR_CMAKE_ENABLE_CODE_COVERAGE)
   endif(CLR_CMAKE_PLATFORM_UNIX)
 
 endif(CLR_CMAKE_ENABLE_CODE_COVERAGE)
+
+# Opt-in PGO pipeline (see eng/pgo-build.sh). A training build is produced
+# with CLR_CMAKE_PGO_INSTRUMENT, the recorded-dump command script is replayed
+# against it, and the merged profile drives an LTO+PGO final build through
+# CLR_CMAKE_PGO_PROFILE_PATH.
+if(CLR_CMAKE_PGO_INSTRUMENT AND NOT CLR_CMAKE_PGO_PROFILE_PATH STREQUAL "")
+  message(FATAL_ERROR "CLR_CMAKE_PGO_INSTRUMENT and CLR_CMAKE_PGO_PROFILE_PATH are mutually exclusive")
+endif()
+
+if(CLR_CMAKE_PGO_INSTRUMENT)
+
+  if(CLR_CMAKE_PLATFORM_UNIX)
+    add_compile_options(-fprofile-instr-generate)
+    set(CLANG_PGO_LINK_FLAGS "-fprofile-instr-generate")
+    set(CMAKE_SHARED_LINKER_FLAGS "${CMAKE_SHARED_LINKER_FLAGS} ${CLANG_PGO_LINK_FLAGS}")
+    set(CMAKE_EXE_LINKER_FLAGS    "${CMAKE_EXE_LINKER_FLAGS} ${CLANG_PGO_LINK_FLAGS}")
+  else()
+    message(FATAL_ERROR "PGO instrumented builds not supported on current platform")
+  endif(CLR_CMAKE_PLATFORM_UNIX)
+
+endif(CLR_CMAKE_PGO_INSTRUMENT)
+
+if(NOT CLR_CMAKE_PGO_PROFILE_PATH STREQUAL "")
+
+  if(CLR_CMAKE_PLATFORM_UNIX)
+    if(NOT EXISTS ${CLR_CMAKE_PGO_PROFILE_PATH})
+      message(FATAL_ERROR "PGO profile data not found: ${CLR_CMAKE_PGO_PROFILE_PATH}")
+    endif()
+
+    add_compile_options(-fprofile-instr-use=${CLR_CMAKE_PGO_PROFILE_PATH})
+    # The profile is gathered from one workload, so functions the training run
+    # never reached (and ones that changed since) are expected.
+    add_compile_options(-Wno-profile-instr-unprofiled)
+    add_compile_options(-Wno-profile-instr-out-of-date)
+
+    add_compile_options(-flto=thin)
+    set(CLANG_LTO_LINK_FLAGS "-flto=thin -fprofile-instr-use=${CLR_CMAKE_PGO_PROFILE_PATH}")
+    set(CMAKE_SHARED_LINKER_FLAGS "${CMAKE_SHARED_LINKER_FLAGS} ${CLANG_LTO_LINK_FLAGS}")
+    set(CMAKE_EXE_LINKER_FLAGS    "${CMAKE_EXE_LINKER_FLAGS} ${CLANG_LTO_LINK_FLAGS}")
+  else()
+    message(FATAL_ERROR "PGO optimized builds not supported on current platform")
+  endif(CLR_CMAKE_PLATFORM_UNIX)
+
+endif(NOT CLR_CMAKE_PGO_PROFILE_PATH STREQUAL "")
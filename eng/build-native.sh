@@ -33,6 +33,7 @@ __CI=false
 __Verbosity=minimal
 __TestArgs=
 __UnprocessedBuildArgs=
+__cmakeargs=
 __Alpine=false
 
 usage()
@@ -44,6 +45,7 @@ usage()
     echo "--architecture <x64|x86|arm|armel|arm64>"
     echo "--configuration <debug|release>"
     echo "--rootfs <ROOTFS_DIR>"
+    echo "--cmakeargs - additional arguments for the cmake configure (e.g. \"-DCLR_CMAKE_PGO_INSTRUMENT=1\")"
     echo "--clangx.y - optional argument to build using clang version x.y"
     echo "--ci - CI lab build"
     echo "--verbosity <q[uiet]|m[inimal]|n[ormal]|d[etailed]|diag[nostic]>"
@@ -200,6 +202,11 @@ while :; do
             shift
             ;;
 
+        --cmakeargs)
+            __cmakeargs="$__cmakeargs $2"
+            shift
+            ;;
+
         --portablebuild=false)
             __PortableBuild=0
             ;;
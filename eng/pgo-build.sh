@@ -0,0 +1,155 @@
+#!/usr/bin/env bash
+# Copyright (c) .NET Foundation and contributors. All rights reserved.
+# Licensed under the MIT license. See LICENSE file in the project root for full license information.
+#
+# Opt-in PGO pipeline for the native SOS binaries:
+#   1. builds instrumented binaries (CLR_CMAKE_PGO_INSTRUMENT),
+#   2. trains them by replaying a command script against a recorded dump
+#      under lldb,
+#   3. merges the raw profiles with llvm-profdata,
+#   4. rebuilds with LTO and the merged profile (CLR_CMAKE_PGO_PROFILE_PATH).
+#
+# The training dump and executable are whatever you would pass to
+# lldbplugin.tests; the default command list covers the hot decode and heap
+# walk paths in strike.cpp and the GC info decoder.
+
+source="${BASH_SOURCE[0]}"
+
+# resolve $SOURCE until the file is no longer a symlink
+while [[ -h $source ]]; do
+  scriptroot="$( cd -P "$( dirname "$source" )" && pwd )"
+  source="$(readlink "$source")"
+
+  # if $source was a relative symlink, we need to resolve it relative to the path where
+  # the symlink file was located
+  [[ $source != /* ]] && source="$scriptroot/$source"
+done
+
+scriptroot="$( cd -P "$( dirname "$source" )" && pwd )"
+projectroot="$( cd -P "$scriptroot/.." && pwd )"
+
+__BuildArch=x64
+__BuildType=release
+__Lldb=lldb
+__Executable=
+__Core=
+__Commands='clrthreads;dumpheap -stat;eeheap -gc;dumpdomain;clrstack -all'
+__ProfileDir=$projectroot/artifacts/pgo
+__ExtraBuildArgs=
+
+usage()
+{
+    echo "Usage: $0 --executable <debuggee> --core <dump> [options]"
+    echo "--executable <path> - debuggee binary the dump was collected from"
+    echo "--core <path> - recorded core dump to replay commands against"
+    echo "--commands '<cmd;cmd;...>' - SOS commands for the training run"
+    echo "--lldb <path> - lldb to host the training run (default: lldb)"
+    echo "--architecture <x64|arm|arm64>"
+    echo "--configuration <debug|release>"
+    echo "--profiledir <path> - where raw and merged profiles are written"
+    echo "--help - this help message"
+    exit 1
+}
+
+while :; do
+    if [ $# -le 0 ]; then
+        break
+    fi
+
+    case $1 in
+        --help|-h)
+            usage
+            ;;
+        --executable)
+            __Executable=$2
+            shift
+            ;;
+        --core)
+            __Core=$2
+            shift
+            ;;
+        --commands)
+            __Commands=$2
+            shift
+            ;;
+        --lldb)
+            __Lldb=$2
+            shift
+            ;;
+        --architecture)
+            __BuildArch=$2
+            shift
+            ;;
+        --configuration)
+            __BuildType=$2
+            shift
+            ;;
+        --profiledir)
+            __ProfileDir=$2
+            shift
+            ;;
+        *)
+            __ExtraBuildArgs="$__ExtraBuildArgs $1"
+            ;;
+    esac
+
+    shift
+done
+
+if [ -z "$__Executable" ] || [ -z "$__Core" ]; then
+    echo "error: --executable and --core are required for the training run"
+    usage
+fi
+
+if ! command -v llvm-profdata > /dev/null 2>&1; then
+    echo "error: llvm-profdata not found on PATH; it ships with the clang used to build"
+    exit 1
+fi
+
+if [ "$(uname)" == "Darwin" ]; then
+    __Plugin=$projectroot/artifacts/bin/OSX.$__BuildArch.$__BuildType/libsosplugin.dylib
+else
+    __Plugin=$projectroot/artifacts/bin/Linux.$__BuildArch.$__BuildType/libsosplugin.so
+fi
+
+mkdir -p "$__ProfileDir"
+rm -f "$__ProfileDir"/*.profraw
+
+echo "=== PGO phase 1: instrumented build"
+"$scriptroot/build.sh" --build-native --architecture $__BuildArch --configuration $__BuildType \
+    --cmakeargs "-DCLR_CMAKE_PGO_INSTRUMENT=1" $__ExtraBuildArgs
+if [ $? != 0 ]; then
+    exit 1
+fi
+
+echo "=== PGO phase 2: training replay against $__Core"
+__LldbCommands=
+IFS=';' read -ra __CommandList <<< "$__Commands"
+for cmd in "${__CommandList[@]}"; do
+    __LldbCommands="$__LldbCommands -o \"$cmd\""
+done
+
+LLVM_PROFILE_FILE="$__ProfileDir/sos-%p.profraw" eval "$__Lldb" -b \
+    -O \"plugin load $__Plugin\" \
+    -o \"target create --core $__Core $__Executable\" \
+    $__LldbCommands \
+    -o \"quit\" > "$__ProfileDir/training.log" 2>&1
+if ! ls "$__ProfileDir"/*.profraw > /dev/null 2>&1; then
+    echo "error: training run produced no profiles; see $__ProfileDir/training.log"
+    exit 1
+fi
+
+echo "=== PGO phase 3: merging profiles"
+llvm-profdata merge -output "$__ProfileDir/sos.profdata" "$__ProfileDir"/*.profraw
+if [ $? != 0 ]; then
+    exit 1
+fi
+
+echo "=== PGO phase 4: LTO+PGO optimized build"
+"$scriptroot/build.sh" --build-native --architecture $__BuildArch --configuration $__BuildType \
+    --cmakeargs "-DCLR_CMAKE_PGO_PROFILE_PATH=$__ProfileDir/sos.profdata" $__ExtraBuildArgs
+if [ $? != 0 ]; then
+    exit 1
+fi
+
+echo "PGO build complete; profile: $__ProfileDir/sos.profdata"
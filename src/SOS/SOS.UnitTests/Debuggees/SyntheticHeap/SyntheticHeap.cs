@@ -0,0 +1,163 @@
+// Debuggee that deterministically builds a large, configurable managed heap
+// for SOS performance testing. Real perf dumps contain customer data and
+// can't be shared; this generator produces heaps with the same shape knobs —
+// object count, type diversity, reference fan-out, fragmentation, and string
+// duplication — from a fixed seed, so a dump built from the same arguments is
+// reproducible anywhere.
+//
+//     SyntheticHeap [objects] [types] [fanout] [fragPercent] [stringDupPercent] [seed]
+//
+//       objects           total node count               (default 1000000)
+//       types             distinct node types, 1..32     (default 16)
+//       fanout            references per node            (default 3)
+//       fragPercent       % of allocations that are dropped filler,
+//                         punching free holes into the segments (default 20)
+//       stringDupPercent  % of strings that repeat an earlier value,
+//                         exercising !dumpheap -strings folding (default 80)
+//       seed              xorshift seed                  (default 0x2545F491)
+//
+// The heap is built, collected into a steady state, and then the program
+// calls Debugger.Break() — that is the snapshot point. Take the dump with the
+// usual harness (SOSRunner.CreateDump / createdump / gdb gcore) and feed it to
+// the PerfBaseline script or compare against sosbench numbers. 1M objects is
+// roughly a 100 MB heap; the knobs scale linearly from there.
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+
+// Marker types: Node<M00>..Node<M31> get distinct method tables, which is what
+// type diversity means to !dumpheap -stat.
+sealed class M00 { } sealed class M01 { } sealed class M02 { } sealed class M03 { }
+sealed class M04 { } sealed class M05 { } sealed class M06 { } sealed class M07 { }
+sealed class M08 { } sealed class M09 { } sealed class M10 { } sealed class M11 { }
+sealed class M12 { } sealed class M13 { } sealed class M14 { } sealed class M15 { }
+sealed class M16 { } sealed class M17 { } sealed class M18 { } sealed class M19 { }
+sealed class M20 { } sealed class M21 { } sealed class M22 { } sealed class M23 { }
+sealed class M24 { } sealed class M25 { } sealed class M26 { } sealed class M27 { }
+sealed class M28 { } sealed class M29 { } sealed class M30 { } sealed class M31 { }
+
+interface INode
+{
+    object[] Children { get; }
+    string Tag { get; set; }
+}
+
+sealed class Node<T> : INode
+{
+    readonly object[] _children;
+    public Node(int fanout) { _children = new object[fanout]; }
+    public object[] Children { get { return _children; } }
+    public string Tag { get; set; }
+}
+
+class SyntheticHeap
+{
+    // Fixed-seed xorshift so the heap shape is a pure function of the
+    // arguments.
+    static ulong s_rand;
+    static ulong NextRand()
+    {
+        ulong x = s_rand;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        return s_rand = x;
+    }
+
+    static readonly Func<int, INode>[] s_factories = new Func<int, INode>[]
+    {
+        f => new Node<M00>(f), f => new Node<M01>(f), f => new Node<M02>(f), f => new Node<M03>(f),
+        f => new Node<M04>(f), f => new Node<M05>(f), f => new Node<M06>(f), f => new Node<M07>(f),
+        f => new Node<M08>(f), f => new Node<M09>(f), f => new Node<M10>(f), f => new Node<M11>(f),
+        f => new Node<M12>(f), f => new Node<M13>(f), f => new Node<M14>(f), f => new Node<M15>(f),
+        f => new Node<M16>(f), f => new Node<M17>(f), f => new Node<M18>(f), f => new Node<M19>(f),
+        f => new Node<M20>(f), f => new Node<M21>(f), f => new Node<M22>(f), f => new Node<M23>(f),
+        f => new Node<M24>(f), f => new Node<M25>(f), f => new Node<M26>(f), f => new Node<M27>(f),
+        f => new Node<M28>(f), f => new Node<M29>(f), f => new Node<M30>(f), f => new Node<M31>(f),
+    };
+
+    static int Main(string[] args)
+    {
+        int objects = Arg(args, 0, 1000000);
+        int types = Math.Max(1, Math.Min(Arg(args, 1, 16), s_factories.Length));
+        int fanout = Arg(args, 2, 3);
+        int fragPercent = Arg(args, 3, 20);
+        int stringDupPercent = Arg(args, 4, 80);
+        s_rand = (ulong)Arg(args, 5, 0x2545F491);
+
+        var nodes = new List<INode>(objects);
+
+        // One string per 8 nodes; duplicates reuse an earlier value so the
+        // unique/total ratio tracks stringDupPercent.
+        var strings = new List<string>();
+
+        // Filler that survives until after the next real allocation and is
+        // then dropped, leaving a free hole behind it.
+        object filler = null;
+
+        for (int i = 0; i < objects; i++)
+        {
+            INode node = s_factories[(int)(NextRand() % (ulong)types)](fanout);
+
+            // Wire references back to already-allocated nodes so the graph is
+            // connected and acyclic-ish, like real object graphs: mostly
+            // nearby, occasionally far.
+            for (int e = 0; e < fanout && i > 0; e++)
+            {
+                int target = (NextRand() & 0xF) != 0
+                    ? i - 1 - (int)(NextRand() % (ulong)Math.Min(i, 64))
+                    : (int)(NextRand() % (ulong)i);
+                node.Children[e] = nodes[target];
+            }
+
+            if ((i & 7) == 0)
+            {
+                string tag;
+                if (strings.Count > 0 && (int)(NextRand() % 100) < stringDupPercent)
+                {
+                    // A duplicate with identical contents but a fresh
+                    // allocation, which is what -strings folds.
+                    tag = string.Copy(strings[(int)(NextRand() % (ulong)strings.Count)]);
+                }
+                else
+                {
+                    tag = "synthetic-" + strings.Count.ToString("x8");
+                    strings.Add(tag);
+                }
+                node.Tag = tag;
+            }
+
+            if ((int)(NextRand() % 100) < fragPercent)
+            {
+                filler = new byte[24 + (int)(NextRand() % 512)];
+            }
+            else
+            {
+                filler = null;
+            }
+
+            nodes.Add(node);
+        }
+        GC.KeepAlive(filler);
+
+        // Settle everything that survives into gen2 so the snapshot is a
+        // steady-state heap, not a nursery full of just-born objects.
+        GC.Collect();
+        GC.Collect();
+
+        Console.WriteLine("SyntheticHeap: {0} objects, {1} types, fanout {2}, {3} strings, ~{4} MB",
+            nodes.Count, types, fanout, strings.Count, GC.GetTotalMemory(forceFullCollection: false) / (1024 * 1024));
+
+        Debugger.Break();   // snapshot point: take the dump here
+
+        GC.KeepAlive(nodes);
+        return 100;
+    }
+
+    static int Arg(string[] args, int index, int defaultValue)
+    {
+        int value;
+        return (index < args.Length && int.TryParse(args[index], out value)) ? value : defaultValue;
+    }
+}
@@ -113,6 +113,34 @@ public class SOS
         }
     }
 
+    [SkippableTheory, MemberData(nameof(Configurations))]
+    public async Task PerfBaseline(TestConfiguration config)
+    {
+        // Dump only: perf numbers are only comparable against a recorded dump,
+        // never a live process. Opt-in via RunPerfTests so the regular runs
+        // don't pay for the timing passes.
+        SkipIfArm(config);
+        if (!config.RunPerfTests())
+        {
+            throw new SkipTestException("perf tests not enabled (RunPerfTests)");
+        }
+        if (!IsOpenDumpConfig(config))
+        {
+            throw new SkipTestException("perf tests require a dump (DebuggeeDumpInputRootDir)");
+        }
+        if (IsCreateDumpConfig(config))
+        {
+            await SOSRunner.CreateDump(config, Output, "SOS.PerfBaseline", "GCWhere", null, useCreateDump: true);
+        }
+        if (!SOSRunner.IsAlpine())
+        {
+            using (SOSRunner runner = await SOSRunner.StartDebugger(config, Output, "SOS.PerfBaseline", "GCWhere", null, SOSRunner.Options.LoadDump))
+            {
+                await runner.RunScript("PerfBaseline.script");
+            }
+        }
+    }
+
     [SkippableTheory, MemberData(nameof(Configurations))]
     public async Task Overflow(TestConfiguration config)
     {
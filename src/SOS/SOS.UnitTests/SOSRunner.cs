@@ -5,6 +5,8 @@
 using Microsoft.Diagnostic.TestHelpers;
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
+using System.Globalization;
 using System.IO;
 using System.Linq;
 using System.Text;
@@ -25,6 +27,20 @@ public class SOSRunner : IDisposable
     string _lastCommandOutput;
     string _previousCommandCapture;
 
+    /// <summary>
+    /// The measurements the PERFCOMMAND script directive collects: wall time
+    /// plus the memory-read counters SOS reports through !ReadStats.
+    /// </summary>
+    class PerfResult
+    {
+        public string Command;
+        public bool Succeeded;
+        public double Milliseconds;
+        public Dictionary<string, long> Counters = new Dictionary<string, long>();
+    }
+
+    readonly List<PerfResult> _perfResults = new List<PerfResult>();
+
     public enum Options
     {
         None,
@@ -474,6 +490,16 @@ public class SOSRunner : IDisposable
                         throw new Exception($"SOS command FAILED: {input}");
                     }
                 }
+                else if (line.StartsWith("PERFCOMMAND:"))
+                {
+                    string input = line.Substring("PERFCOMMAND:".Length).TrimStart();
+                    await RunPerfCommand(input);
+                }
+                else if (line.StartsWith("SHADOWCOMMAND:"))
+                {
+                    string input = line.Substring("SHADOWCOMMAND:".Length).TrimStart();
+                    await RunShadowCommand(input);
+                }
                 else if (line.StartsWith("COMMAND:"))
                 {
                     string input = line.Substring("COMMAND:".Length).TrimStart();
@@ -498,6 +524,11 @@ public class SOSRunner : IDisposable
                 throw new Exception("Error unbalanced IFDEFs. " + activeDefines.First().Key + " has no ENDIF.");
             }
 
+            if (_perfResults.Count > 0)
+            {
+                ReportPerfResults(Path.GetFileNameWithoutExtension(scriptFile));
+            }
+
             await QuitDebugger();
         }
         catch (Exception e)
@@ -618,6 +649,238 @@ public class SOSRunner : IDisposable
         return await RunCommand(command);
     }
 
+    /// <summary>
+    /// Runs a SOS command for the performance suite: wall time and the
+    /// memory-read counters are recorded instead of output being verified.
+    /// A failing command is recorded rather than thrown, so it shows up in
+    /// the baseline comparison instead of aborting the measurement pass.
+    /// </summary>
+    /// <param name="command">the SOS command to time</param>
+    public async Task RunPerfCommand(string command)
+    {
+        PerfResult result = new PerfResult { Command = command };
+
+        // Zero the read counters so the report below covers only this command.
+        await RunSosCommand("ReadStats -reset");
+
+        Stopwatch stopwatch = Stopwatch.StartNew();
+        result.Succeeded = await RunSosCommand(command);
+        stopwatch.Stop();
+        result.Milliseconds = stopwatch.Elapsed.TotalMilliseconds;
+
+        if (await RunSosCommand("ReadStats"))
+        {
+            ParseReadStats(_lastCommandOutput, result.Counters);
+        }
+
+        _perfResults.Add(result);
+        WriteLine("    PERF: {0}: {1:F0} ms{2}", command, result.Milliseconds, result.Succeeded ? "" : " (FAILED)");
+    }
+
+    /// <summary>
+    /// Runs a SOS command twice against the same target - once with the
+    /// session caches and read fast paths disabled ("sosperf -fastpaths 0")
+    /// and once with them enabled - and fails if the normalized output
+    /// differs. This is the correctness gate for the optimized paths: a
+    /// cache or batch reader that changes what a command prints shows up
+    /// here before it ships.
+    /// </summary>
+    /// <param name="command">the SOS command to diff</param>
+    public async Task RunShadowCommand(string command)
+    {
+        string baseline;
+        try
+        {
+            await RunSosCommand("SOSPerf -fastpaths 0");
+            if (!await RunSosCommand(command))
+            {
+                throw new Exception($"SHADOW baseline command FAILED: {command}");
+            }
+            baseline = _lastCommandOutput;
+        }
+        finally
+        {
+            await RunSosCommand("SOSPerf -fastpaths 1");
+        }
+
+        if (!await RunSosCommand(command))
+        {
+            throw new Exception($"SHADOW optimized command FAILED: {command}");
+        }
+        string optimized = _lastCommandOutput;
+
+        string[] baselineLines = NormalizeShadowOutput(baseline);
+        string[] optimizedLines = NormalizeShadowOutput(optimized);
+
+        if (baselineLines.Length != optimizedLines.Length)
+        {
+            throw new Exception($"SHADOW mismatch for '{command}': {baselineLines.Length} lines unoptimized, {optimizedLines.Length} lines optimized");
+        }
+        for (int i = 0; i < baselineLines.Length; i++)
+        {
+            if (baselineLines[i] != optimizedLines[i])
+            {
+                throw new Exception($"SHADOW mismatch for '{command}':{Environment.NewLine}  unoptimized: {baselineLines[i]}{Environment.NewLine}  optimized:   {optimizedLines[i]}");
+            }
+        }
+        WriteLine("    SHADOW: {0}: {1} lines match", command, baselineLines.Length);
+    }
+
+    /// <summary>
+    /// Normalizes command output for the shadow diff: addresses are
+    /// canonicalized (hex runs of pointer width become a fixed token, so
+    /// session-dependent values like cache addresses can't cause noise),
+    /// trailing whitespace is dropped, and the lines are sorted so modes
+    /// that emit rows in a nondeterministic (e.g. parallel) order still
+    /// compare equal as a multiset.
+    /// </summary>
+    private static string[] NormalizeShadowOutput(string output)
+    {
+        List<string> lines = new List<string>();
+        foreach (string rawLine in output.Replace("\r", "").Split('\n'))
+        {
+            string line = Regex.Replace(rawLine, @"\b0x[0-9a-fA-F]+\b|\b[0-9a-fA-F]{8,16}\b", "<ADDR>").TrimEnd();
+            if (line.Length > 0)
+            {
+                lines.Add(line);
+            }
+        }
+        lines.Sort(StringComparer.Ordinal);
+        return lines.ToArray();
+    }
+
+    // The counter names here become the result file columns; the expressions
+    // match the !ReadStats report printed by ReadVirtualStats::Print.
+    private static readonly KeyValuePair<string, string>[] s_readStatCounters = new KeyValuePair<string, string>[]
+    {
+        new KeyValuePair<string, string>("ReadVirtualCalls", @"ReadVirtual:\s+(\d+) calls"),
+        new KeyValuePair<string, string>("BytesRead", @"bytes requested, (\d+) bytes read"),
+        new KeyValuePair<string, string>("PageReads", @"Page cache:\s+(\d+) reads"),
+        new KeyValuePair<string, string>("PageFills", @"%\), (\d+) fills"),
+        new KeyValuePair<string, string>("BatchCalls", @"Batched reads:\s+(\d+) batches"),
+    };
+
+    private static void ParseReadStats(string output, Dictionary<string, long> counters)
+    {
+        foreach (KeyValuePair<string, string> counter in s_readStatCounters)
+        {
+            Match m = Regex.Match(output, counter.Value);
+            if (m.Success)
+            {
+                counters[counter.Key] = long.Parse(m.Groups[1].Value);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Writes the collected measurements as a CSV results file and, when a
+    /// checked-in baseline exists for this test/debugger pair, fails on
+    /// regression: a command that succeeded in the baseline but failed now,
+    /// or wall time/read counters above the baseline by more than the
+    /// configured tolerance (counters are near-deterministic against a
+    /// recorded dump, so they catch algorithmic regressions that wall time
+    /// hides on a noisy machine).
+    /// </summary>
+    /// <param name="testName">script name, used to name the results/baseline files</param>
+    private void ReportPerfResults(string testName)
+    {
+        string fileName = testName + "." + DebuggerToString.ToLowerInvariant() + ".perf.csv";
+
+        StringBuilder csv = new StringBuilder();
+        csv.AppendLine("command,succeeded,milliseconds," + string.Join(",", s_readStatCounters.Select(c => c.Key)));
+        foreach (PerfResult result in _perfResults)
+        {
+            csv.Append(result.Command).Append(',');
+            csv.Append(result.Succeeded ? "true" : "false").Append(',');
+            csv.Append(result.Milliseconds.ToString("F1", CultureInfo.InvariantCulture));
+            foreach (KeyValuePair<string, string> counter in s_readStatCounters)
+            {
+                long value;
+                csv.Append(',').Append(result.Counters.TryGetValue(counter.Key, out value) ? value.ToString() : "");
+            }
+            csv.AppendLine();
+        }
+
+        string outputRoot = _config.PerfOutputRootDir();
+        if (outputRoot != null)
+        {
+            Directory.CreateDirectory(outputRoot);
+            string outputPath = Path.Combine(outputRoot, fileName);
+            File.WriteAllText(outputPath, csv.ToString());
+            WriteLine("    PERF: results written to {0}", outputPath);
+        }
+        else
+        {
+            WriteLine("    PERF: results (set PerfOutputRootDir to persist):");
+            WriteLine(csv.ToString());
+        }
+
+        string baselineRoot = _config.PerfBaselineRootDir();
+        if (baselineRoot == null)
+        {
+            WriteLine("    PERF: no baseline directory configured (PerfBaselineRootDir); skipping comparison");
+            return;
+        }
+        string baselinePath = Path.Combine(baselineRoot, fileName);
+        if (!File.Exists(baselinePath))
+        {
+            WriteLine("    PERF: no baseline at {0}; skipping comparison", baselinePath);
+            return;
+        }
+
+        int tolerance = _config.PerfRegressionTolerancePercent();
+        List<string> regressions = new List<string>();
+
+        foreach (string baselineLine in File.ReadAllLines(baselinePath).Skip(1))
+        {
+            if (string.IsNullOrWhiteSpace(baselineLine))
+            {
+                continue;
+            }
+            string[] fields = baselineLine.Split(',');
+            string command = fields[0];
+
+            PerfResult result = _perfResults.FirstOrDefault(r => r.Command == command);
+            if (result == null)
+            {
+                regressions.Add($"'{command}' is in the baseline but was not measured");
+                continue;
+            }
+
+            bool baselineSucceeded = fields[1] == "true";
+            if (baselineSucceeded && !result.Succeeded)
+            {
+                regressions.Add($"'{command}' succeeded in the baseline but failed");
+                continue;
+            }
+
+            double baselineMs = double.Parse(fields[2], CultureInfo.InvariantCulture);
+            if (result.Milliseconds > baselineMs * (100 + tolerance) / 100.0)
+            {
+                regressions.Add($"'{command}' took {result.Milliseconds:F1} ms, baseline {baselineMs:F1} ms (+{tolerance}% allowed)");
+            }
+
+            for (int i = 0; i < s_readStatCounters.Length && 3 + i < fields.Length; i++)
+            {
+                long baselineValue;
+                long value;
+                if (long.TryParse(fields[3 + i], out baselineValue) &&
+                    result.Counters.TryGetValue(s_readStatCounters[i].Key, out value) &&
+                    value > baselineValue * (100 + tolerance) / 100)
+                {
+                    regressions.Add($"'{command}' {s_readStatCounters[i].Key} was {value}, baseline {baselineValue} (+{tolerance}% allowed)");
+                }
+            }
+        }
+
+        if (regressions.Count > 0)
+        {
+            throw new Exception("Performance regressions against " + baselinePath + ":" + Environment.NewLine +
+                                string.Join(Environment.NewLine, regressions));
+        }
+        WriteLine("    PERF: no regressions against {0}", baselinePath);
+    }
+
     public async Task RunCommands(IEnumerable<string> commands)
     {
         foreach (string command in commands)
@@ -1156,4 +1419,26 @@ public static class TestConfigurationExtensions
     {
         return TestConfiguration.MakeCanonicalPath(config.GetValue("DebuggeeDumpOutputRootDir"));
     }
+
+    public static bool RunPerfTests(this TestConfiguration config)
+    {
+        return config.GetValue("RunPerfTests")?.ToLowerInvariant() == "true";
+    }
+
+    public static string PerfBaselineRootDir(this TestConfiguration config)
+    {
+        return TestConfiguration.MakeCanonicalPath(config.GetValue("PerfBaselineRootDir"));
+    }
+
+    public static string PerfOutputRootDir(this TestConfiguration config)
+    {
+        return TestConfiguration.MakeCanonicalPath(config.GetValue("PerfOutputRootDir"));
+    }
+
+    public static int PerfRegressionTolerancePercent(this TestConfiguration config)
+    {
+        string tolerance = config.GetValue("PerfRegressionTolerancePercent");
+        int value;
+        return int.TryParse(tolerance, out value) ? value : 30;
+    }
 }
@@ -63,10 +63,26 @@ HRESULT __stdcall EventCallbacks::ChangeDebuggeeState(ULONG Flags, ULONG64 Argum
 
 HRESULT __stdcall EventCallbacks::ChangeEngineState(ULONG Flags, ULONG64 Argument)
 {
+    // The target may have executed, so any cached target memory is stale
+    // and assemblies may have been loaded or unloaded.
+    if ((Flags & DEBUG_CES_EXECUTION_STATUS) != 0)
+    {
+        InvalidateCachedReadVirtual();
+        ClearDomainModuleTree();
+        ClearThreadStoreSnapshot();
+        ClearEHInfoCache();
+        ClearGCInfoDumpCache();
+        ClearILAddressMapCache();
+        ClearCallTargetMemo();
+        ClearPointerClassificationCache();
+    }
     return DEBUG_STATUS_NO_CHANGE;
 }
 HRESULT __stdcall EventCallbacks::ChangeSymbolState(ULONG Flags, ULONG64 Argument)
 {
+    // Symbols may have been loaded or reloaded; drop the cached readers so
+    // the next line lookup sees them.
+    ClearILAddressMapCache();
     return DEBUG_STATUS_NO_CHANGE;
 }
 HRESULT __stdcall EventCallbacks::CreateProcess(ULONG64 ImageFileHandle,
@@ -109,7 +125,7 @@ HRESULT __stdcall EventCallbacks::ExitThread(ULONG ExitCode)
 
 HRESULT __stdcall EventCallbacks::GetInterestMask(PULONG Mask)
 {
-    *Mask = DEBUG_EVENT_LOAD_MODULE | DEBUG_EVENT_EXIT_PROCESS;
+    *Mask = DEBUG_EVENT_LOAD_MODULE | DEBUG_EVENT_UNLOAD_MODULE | DEBUG_EVENT_EXIT_PROCESS | DEBUG_EVENT_CHANGE_ENGINE_STATE;
     return S_OK;
 }
 
@@ -126,6 +142,10 @@ HRESULT __stdcall EventCallbacks::LoadModule(ULONG64 ImageFileHandle,
     HRESULT handleEventStatus = DEBUG_STATUS_NO_CHANGE;
     ExtQuery(m_pDebugClient);
 
+    // A new module may carry managed assemblies; the cached domain tree
+    // no longer reflects the target.
+    ClearDomainModuleTree();
+
     if (ModuleName != NULL && _stricmp(ModuleName, MAIN_CLR_MODULE_NAME_A) == 0)
     {
         // if we don't want the JIT to optimize, we should also disable optimized NGEN images
@@ -156,5 +176,6 @@ HRESULT __stdcall EventCallbacks::SystemError(ULONG Error, ULONG Level)
 
 HRESULT __stdcall EventCallbacks::UnloadModule(PCSTR ImageBaseName, ULONG64 BaseOffset)
 {
+    ClearDomainModuleTree();
     return DEBUG_STATUS_NO_CHANGE;
 }
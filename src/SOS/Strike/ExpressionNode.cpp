@@ -9,6 +9,92 @@
 #define IfFailRet(EXPR) do { Status = (EXPR); if(FAILED(Status)) { return (Status); } } while (0)
 #endif
 
+ExpressionNodeArena* ExpressionNode::s_pActiveArena = NULL;
+ExpressionNodeArena* ExpressionNode::s_pArenaToFree = NULL;
+
+ExpressionNodeArena::ExpressionNodeArena()
+{
+    pChunkList = NULL;
+}
+
+ExpressionNodeArena::~ExpressionNodeArena()
+{
+    Chunk* pChunk = pChunkList;
+    while(pChunk != NULL)
+    {
+        Chunk* pNext = pChunk->pNext;
+        delete [] (BYTE*)pChunk;
+        pChunk = pNext;
+    }
+}
+
+// Carves out storage for one allocation, growing the chunk list as needed.
+// Returns NULL if a new chunk could not be allocated.
+VOID* ExpressionNodeArena::Allocate(size_t size)
+{
+    // keep every allocation pointer aligned
+    size = (size + sizeof(VOID*) - 1) & ~(sizeof(VOID*) - 1);
+    if(pChunkList == NULL || pChunkList->cbUsed + size > pChunkList->cbCapacity)
+    {
+        size_t cbCapacity = (size > cbChunkCapacity) ? size : cbChunkCapacity;
+        Chunk* pChunk = (Chunk*) new BYTE[sizeof(Chunk) + cbCapacity];
+        if(pChunk == NULL)
+            return NULL;
+        pChunk->pNext = pChunkList;
+        pChunk->cbUsed = 0;
+        pChunk->cbCapacity = cbCapacity;
+        pChunkList = pChunk;
+    }
+    VOID* pResult = (BYTE*)(pChunkList + 1) + pChunkList->cbUsed;
+    pChunkList->cbUsed += size;
+    return pResult;
+}
+
+// Nodes are placed in the arena of the evaluation that creates them
+VOID* ExpressionNode::operator new(size_t size)
+{
+    _ASSERTE(s_pActiveArena != NULL);
+    if(s_pActiveArena == NULL)
+        return NULL;
+    return s_pActiveArena->Allocate(size);
+}
+
+VOID ExpressionNode::operator delete(VOID* pMemory)
+{
+    // Node storage lives in the tree's arena so there is nothing to free per
+    // node. The root's destructor parks the arena in s_pArenaToFree once the
+    // subtree is down, and it is released here - after the root's own members
+    // (which live in that arena) have been destroyed.
+    if(s_pArenaToFree != NULL)
+    {
+        ExpressionNodeArena* pDoomed = s_pArenaToFree;
+        s_pArenaToFree = NULL;
+        delete pDoomed;
+    }
+}
+
+// Tears down this node's subtree; deleting the root also releases the
+// arena every node in the tree was allocated from
+ExpressionNode::~ExpressionNode()
+{
+    // Walk the sibling chain iteratively - an expanded array produces one
+    // sibling per element and recursing the chain could get very deep
+    ExpressionNode* pCurChild = pChild;
+    pChild = NULL;
+    while(pCurChild != NULL)
+    {
+        ExpressionNode* pNext = pCurChild->pNextSibling;
+        pCurChild->pNextSibling = NULL;
+        delete pCurChild;
+        pCurChild = pNext;
+    }
+    if(ownsArena)
+    {
+        _ASSERTE(s_pArenaToFree == NULL);
+        s_pArenaToFree = pArena;
+    }
+}
+
 // Returns the complete expression being evaluated to get the value for this node
 // The returned pointer is a string interior to this object - once you release
 // all references to this object the string is invalid.
@@ -42,10 +128,32 @@ WCHAR* ExpressionNode::GetTextValue() { PopulateTextValue(); return pTextValue;
 // all references to this object the string is invalid.
 WCHAR* ExpressionNode::GetErrorMessage() { return pErrorMessage; }
 
+// Returns the debuggee address backing this node's value, or 0 if the node
+// is not memory backed. Used by !watch to probe whether a cached evaluation
+// is still current.
+ULONG64 ExpressionNode::GetAddress()
+{
+    if(pValue == NULL)
+        return 0;
+    CORDB_ADDRESS address = 0;
+    if(FAILED(pValue->GetAddress(&address)))
+        return 0;
+    return address;
+}
+
 // Factory function for creating the expression node at the root of a tree
 HRESULT ExpressionNode::CreateExpressionNode(__in_z WCHAR* pExpression, ExpressionNode** ppExpressionNode)
 {
     *ppExpressionNode = NULL;
+
+    // every node in the tree shares one arena, owned by the root and freed
+    // wholesale when the root is deleted
+    ExpressionNodeArena* pNewArena = new ExpressionNodeArena();
+    if(pNewArena == NULL)
+        return E_OUTOFMEMORY;
+    ExpressionNodeArena* pPreviousArena = s_pActiveArena;
+    s_pActiveArena = pNewArena;
+
     HRESULT Status = CreateExpressionNodeHelper(pExpression,
         pExpression,
         0,
@@ -65,6 +173,12 @@ HRESULT ExpressionNode::CreateExpressionNode(__in_z WCHAR* pExpression, Expressi
         if(*ppExpressionNode == NULL)
             Status = E_OUTOFMEMORY;
     }
+
+    s_pActiveArena = pPreviousArena;
+    if(*ppExpressionNode != NULL)
+        (*ppExpressionNode)->ownsArena = TRUE;
+    else
+        delete pNewArena;
     return Status;
 }
 
@@ -74,6 +188,19 @@ HRESULT ExpressionNode::CreateExpressionNode(__in_z WCHAR* pExpression, Expressi
 // For example if a tree was rooted with expression 'foo.bar' and varToExpand is '(Baz)foo.bar[9]'
 // then 'foo.bar', 'foo.bar[9]', and '(Baz)foo.bar[9]' nodes would all be expanded.
 HRESULT ExpressionNode::Expand(__in_z WCHAR* varToExpand)
+{
+    // activate this tree's arena so new children land alongside the rest of
+    // the tree; save/restore handles the recursive expansion calls
+    ExpressionNodeArena* pPreviousArena = s_pActiveArena;
+    s_pActiveArena = pArena;
+    HRESULT Status = ExpandHelper(varToExpand);
+    s_pActiveArena = pPreviousArena;
+    return Status;
+}
+
+// Body of Expand; runs with this tree's arena active so new children are
+// placed alongside the rest of the tree
+HRESULT ExpressionNode::ExpandHelper(__in_z WCHAR* varToExpand)
 {
     if(!ShouldExpandVariable(varToExpand))
         return S_FALSE;
@@ -168,6 +295,8 @@ VOID ExpressionNode::Init(ICorDebugValue* pValue, ICorDebugType* pTypeCast, ICor
     this->pValue = pValue;
     this->pTypeCast = pTypeCast;
     this->pILFrame = pFrame;
+    pArena = s_pActiveArena;
+    ownsArena = FALSE;
     pChild = NULL;
     pNextSibling = NULL;
     pTextValue[0] = 0;
@@ -17,6 +17,35 @@
 #define MAX_EXPRESSION 500
 #define MAX_ERROR 500
 
+// A bump allocator that backs one tree of ExpressionNodes. Each node embeds
+// several fixed-size string buffers and weighs in at a few KB, so expanding a
+// large object graph used to produce one heap allocation per node. Nodes are
+// instead carved out of large chunks owned by the tree's root and the chunk
+// list is freed wholesale when the root is deleted.
+class ExpressionNodeArena
+{
+public:
+    ExpressionNodeArena();
+    ~ExpressionNodeArena();
+
+    // Carves out storage for one allocation, growing the chunk list as needed.
+    // Returns NULL if a new chunk could not be allocated.
+    VOID* Allocate(size_t size);
+
+private:
+    struct Chunk
+    {
+        Chunk* pNext;
+        size_t cbUsed;
+        size_t cbCapacity;
+        // allocations follow the header
+    };
+
+    // Large enough for a couple dozen nodes per chunk
+    static const size_t cbChunkCapacity = 128*1024;
+
+    Chunk* pChunkList;
+};
 
 // Represents one node in a tree of expressions and sub-expressions
 // These nodes are used in the !watch expandable expression tree
@@ -73,6 +102,11 @@ public:
     // The returned pointer is a string interior to this object - once you release
     // all references to this object the string is invalid.
     WCHAR* GetErrorMessage();
+
+    // Returns the debuggee address backing this node's value, or 0 if the node
+    // is not memory backed. Used by !watch to probe whether a cached evaluation
+    // is still current.
+    ULONG64 GetAddress();
     
     // Factory function for creating the expression node at the root of a tree
     static HRESULT CreateExpressionNode(__in_z WCHAR* pExpression, ExpressionNode** ppExpressionNode);
@@ -87,7 +121,28 @@ public:
     // Standard depth first search tree traversal pattern with a callback
     VOID DFSVisit(ExpressionNodeVisitorCallback pFunc, VOID* pUserData, int depth=0);
 
+    // Tears down this node's subtree; deleting the root also releases the
+    // arena every node in the tree was allocated from
+    ~ExpressionNode();
+
+    // Nodes are placed in the arena of the evaluation that creates them
+    static VOID* operator new(size_t size);
+    static VOID operator delete(VOID* pMemory);
+
 private:
+    // the arena every node in this tree is allocated from; only the root
+    // (ownsArena) releases it
+    ExpressionNodeArena* pArena;
+    BOOL ownsArena;
+
+    // the arena that new nodes are currently being carved out of; set for the
+    // duration of a root evaluation or an expansion
+    static ExpressionNodeArena* s_pActiveArena;
+
+    // hand-off slot between the root's destructor and operator delete so the
+    // arena outlives the root's own (arena backed) storage
+    static ExpressionNodeArena* s_pArenaToFree;
+
     // for nodes that evaluate to a type, this is that type
     // for nodes that evaluate to a debuggee value, this is the type of that
     // value or one of its base types. It represents the type the value should
@@ -161,6 +216,10 @@ private:
 
     // Node expansion helpers
 
+    // Body of Expand; runs with this tree's arena active so new children are
+    // placed alongside the rest of the tree
+    HRESULT ExpandHelper(__in_z WCHAR* varToExpand);
+
     // Inserts a new child at the end of the linked list of children
     // PERF: This has O(N) insert time but these lists should never be large
     VOID AddChild(ExpressionNode* pNewChild);
@@ -56,6 +56,9 @@ HRESULT WatchCmd::Add(__in_z WCHAR* pExpression)
     if(pExpr == NULL)
         return E_OUTOFMEMORY;
     wcsncpy_s(pExpr->pExpression, MAX_EXPRESSION, pExpression, _TRUNCATE);
+    pExpr->cacheValid = FALSE;
+    pExpr->cacheRootAddr = 0;
+    pExpr->cacheRootValue = 0;
     pExpr->pNext = NULL;
 
     WatchExpression** ppCurrent = &pExpressionListHead;
@@ -115,10 +118,32 @@ HRESULT WatchCmd::Print(int expansionIndex, __in_z WCHAR* expansionPath, __in_z
     int index = 1;
     while(pExpression != NULL)
     {
+        // An unexpanded, unfiltered entry whose root slot re-reads identically
+        // since the last evaluation prints from the cache without being
+        // re-resolved; refreshing a long watch list then only pays for the
+        // entries that actually changed.
+        BOOL expandThis = (index == expansionIndex);
+        if(pFilterName == NULL && !expandThis && pExpression->cacheValid)
+        {
+            ULONG64 rootValue;
+            if(ReadRootSlot(pExpression->cacheRootAddr, &rootValue) && rootValue == pExpression->cacheRootValue)
+            {
+                WCHAR pCommand[MAX_EXPRESSION];
+                swprintf_s(pCommand, MAX_EXPRESSION, L"!watch -expand %d", index);
+                ExtOut("  %d) ", index);
+                PrintEntryLine(pCommand, pExpression->pCachedTypeName, pExpression->pCachedAbsoluteExpression,
+                    pExpression->pCachedRelativeExpression, pExpression->pCachedTextValue);
+                pExpression = pExpression->pNext;
+                index++;
+                continue;
+            }
+        }
+
         ExpressionNode* pResult = NULL;
         if(FAILED(Status = ExpressionNode::CreateExpressionNode(pExpression->pExpression, &pResult)))
         {
             ExtOut("  %d) Error: HRESULT 0x%x while evaluating expression \'%S\'", index, Status, pExpression->pExpression);
+            pExpression->cacheValid = FALSE;
         }
         else
         {
@@ -155,6 +180,8 @@ HRESULT WatchCmd::Print(int expansionIndex, __in_z WCHAR* expansionPath, __in_z
                 data.pCommand = pCommand;
                 pResult->DFSVisit(EvalPrintCallback, (VOID*)&data);
             }
+            if(pFilterName == NULL && !expandThis)
+                UpdateCache(pExpression, pResult);
             delete pResult;
         }
         pExpression = pExpression->pNext;
@@ -291,15 +318,53 @@ VOID WatchCmd::EvalPrintCallback(ExpressionNode* pExpressionNode, int depth, VOI
     }
     else
     {
-        // names can have '<' and '>' in them, need to escape
-        WCHAR pEscapedTypeName[MAX_EXPRESSION];
-        DmlEscape(pExpressionNode->GetTypeName(), (int)_wcslen(pExpressionNode->GetTypeName()), pEscapedTypeName, MAX_EXPRESSION);
-        WCHAR pRelativeExpression[MAX_EXPRESSION];
-        DmlEscape(pExpressionNode->GetRelativeExpression(), (int)_wcslen(pExpressionNode->GetRelativeExpression()), pRelativeExpression, MAX_EXPRESSION);
-        DMLOut("%S <exec cmd=\"%S (%S)%S\">%S</exec> %S\n", pEscapedTypeName, pData->pCommand, pEscapedTypeName, pExpressionNode->GetAbsoluteExpression(), pRelativeExpression, pExpressionNode->GetTextValue());
+        PrintEntryLine(pData->pCommand, pExpressionNode->GetTypeName(), pExpressionNode->GetAbsoluteExpression(),
+            pExpressionNode->GetRelativeExpression(), pExpressionNode->GetTextValue());
     }
 }
 
+// Prints the output line for an evaluated (non-error) node; callers print the
+// index or depth prefix first
+VOID WatchCmd::PrintEntryLine(__in_z WCHAR* pCommand, __in_z WCHAR* pTypeName, __in_z WCHAR* pAbsoluteExpression, __in_z WCHAR* pRelativeExpression, __in_z WCHAR* pTextValue)
+{
+    // names can have '<' and '>' in them, need to escape
+    WCHAR pEscapedTypeName[MAX_EXPRESSION];
+    DmlEscape(pTypeName, (int)_wcslen(pTypeName), pEscapedTypeName, MAX_EXPRESSION);
+    WCHAR pEscapedRelativeExpression[MAX_EXPRESSION];
+    DmlEscape(pRelativeExpression, (int)_wcslen(pRelativeExpression), pEscapedRelativeExpression, MAX_EXPRESSION);
+    DMLOut("%S <exec cmd=\"%S (%S)%S\">%S</exec> %S\n", pEscapedTypeName, pCommand, pEscapedTypeName, pAbsoluteExpression, pEscapedRelativeExpression, pTextValue);
+}
+
+// Reads the pointer-sized slot backing a cached watch entry
+BOOL WatchCmd::ReadRootSlot(ULONG64 addr, ULONG64* pValue)
+{
+    *pValue = 0;
+    return addr != 0 && SafeReadMemory(TO_TADDR(addr), pValue, sizeof(TADDR), NULL);
+}
+
+// Stores the evaluation of an unexpanded root node in the watch entry's cache.
+// Nodes that errored or that aren't memory backed can't be probed for
+// staleness, so they stay uncached and re-evaluate every time.
+VOID WatchCmd::UpdateCache(WatchExpression* pExpression, ExpressionNode* pResult)
+{
+    pExpression->cacheValid = FALSE;
+    if(pResult->GetErrorMessage()[0] != 0)
+        return;
+
+    ULONG64 addr = pResult->GetAddress();
+    ULONG64 value;
+    if(!ReadRootSlot(addr, &value))
+        return;
+
+    pExpression->cacheRootAddr = addr;
+    pExpression->cacheRootValue = value;
+    wcsncpy_s(pExpression->pCachedTypeName, MAX_EXPRESSION, pResult->GetTypeName(), _TRUNCATE);
+    wcsncpy_s(pExpression->pCachedAbsoluteExpression, MAX_EXPRESSION, pResult->GetAbsoluteExpression(), _TRUNCATE);
+    wcsncpy_s(pExpression->pCachedRelativeExpression, MAX_EXPRESSION, pResult->GetRelativeExpression(), _TRUNCATE);
+    wcsncpy_s(pExpression->pCachedTextValue, MAX_EXPRESSION, pResult->GetTextValue(), _TRUNCATE);
+    pExpression->cacheValid = TRUE;
+}
+
 // A DFS traversal callback for the expression node tree that saves all the values into a new
 // persisted watch list
 VOID WatchCmd::PersistCallback(ExpressionNode* pExpressionNode, int depth, VOID* pUserData)
@@ -16,6 +16,21 @@
 typedef struct _WatchExpression
 {
     WCHAR pExpression[MAX_EXPRESSION];
+
+    // Cached result of the last evaluation of the (unexpanded) root node.
+    // The backing address and the pointer-sized bytes last read from it act
+    // as a cheap validity probe: if the slot re-reads identically on a later
+    // refresh, the rendered line cannot have changed and the expression is
+    // not re-resolved. Interior mutations that leave the root slot intact
+    // are only picked up once the slot (or the list) changes.
+    BOOL cacheValid;
+    ULONG64 cacheRootAddr;
+    ULONG64 cacheRootValue;
+    WCHAR pCachedTypeName[MAX_EXPRESSION];
+    WCHAR pCachedAbsoluteExpression[MAX_EXPRESSION];
+    WCHAR pCachedRelativeExpression[MAX_EXPRESSION];
+    WCHAR pCachedTextValue[MAX_EXPRESSION];
+
     _WatchExpression* pNext;
 
 } WatchExpression;
@@ -93,6 +108,17 @@ private:
     // A DFS traversal callback for the expression node tree that prints it
     static VOID EvalPrintCallback(ExpressionNode* pExpressionNode, int depth, VOID* pUserData);
 
+    // Prints the output line for an evaluated (non-error) node; callers print
+    // the index or depth prefix first
+    static VOID PrintEntryLine(__in_z WCHAR* pCommand, __in_z WCHAR* pTypeName,
+        __in_z WCHAR* pAbsoluteExpression, __in_z WCHAR* pRelativeExpression, __in_z WCHAR* pTextValue);
+
+    // Reads the pointer-sized slot backing a cached watch entry
+    static BOOL ReadRootSlot(ULONG64 addr, ULONG64* pValue);
+
+    // Stores the evaluation of an unexpanded root node in the watch entry's cache
+    static VOID UpdateCache(WatchExpression* pExpression, ExpressionNode* pResult);
+
     typedef struct _PersistCallbackData
     {
         PersistWatchExpression** ppNext;
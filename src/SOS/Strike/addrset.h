@@ -0,0 +1,610 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+// Sharded concurrent address set and address-to-value map.
+//
+// Visited sets, classification caches and memoized sizes all need the same
+// structure: a hash table keyed by target addresses that several worker
+// threads can fill at once.  Both containers here shard their keys across
+// independent tables (so concurrent inserts rarely touch the same cache
+// lines) and index each table with fibonacci hashing and linear probing.
+// Zero is the empty-slot marker, which is fine for the keys these hold:
+// a managed object never lives at address zero.
+//
+// Concurrency contract:
+//   - Lookups are always lock-free, including while a shard grows.  A
+//     lookup racing an insert may miss the new entry, exactly as if the
+//     lookup had run first.
+//   - Inserts and value updates are lock-free on the hot path; only while
+//     a shard is being grown (rare, amortized) do writers to that shard
+//     briefly spin.
+//   - Retired tables are kept until Clear or destruction, so a reader
+//     holding a pre-growth snapshot never dereferences freed memory.
+//
+// This header expects the usual Strike environment (TADDR, the
+// Interlocked* family) to have been set up by its includer; util.h pulls
+// it in at the right point.
+
+// Table allocations report into the includer's byte accounting when it
+// defines these; standalone includers (sosbench) get no-ops.
+#ifndef ADDRSET_ACCOUNT_ALLOC
+#define ADDRSET_ACCOUNT_ALLOC(bytes)
+#define ADDRSET_ACCOUNT_FREE(bytes)
+#endif
+
+// Fibonacci hashing: multiply by 2^64 / phi and take the high bits, which
+// mix well even for pointer-aligned keys.  The top kAddrShardBits select
+// the shard; the bits below select the slot.
+const int kAddrShardBits = 6;
+const int kAddrShardCount = 1 << kAddrShardBits;
+
+inline ULONG64 MixAddress(TADDR addr)
+{
+    return (ULONG64)addr * 0x9E3779B97F4A7C15ULL;
+}
+
+/* A sharded concurrent set of target addresses.
+ */
+class SharedAddressSet
+{
+public:
+    SharedAddressSet()
+    {
+        for (int i = 0; i < kAddrShardCount; i++)
+            InitShard(mShards[i]);
+    }
+
+    ~SharedAddressSet()
+    {
+        Clear();
+        for (int i = 0; i < kAddrShardCount; i++)
+            FreeTable(mShards[i].Current);
+    }
+
+    /* Adds addr to the set.  Returns true if it was newly added, false if
+     * it was already present.  Safe to call from several threads at once.
+     */
+    bool Add(TADDR addr)
+    {
+        if (addr == 0)
+            return false;
+
+        ULONG64 hash = MixAddress(addr);
+        Shard &shard = mShards[hash >> (64 - kAddrShardBits)];
+
+        for (;;)
+        {
+            EnterWriter(shard);
+
+            Table *table = shard.Current;
+            if ((size_t)shard.Count * 4 >= table->Size * 3)
+            {
+                // Keep the load factor below 3/4 so probe sequences stay
+                // short.  Growth excludes writers, so step back out first.
+                LeaveWriter(shard);
+                Grow(shard, table);
+                continue;
+            }
+
+            size_t mask = table->Size - 1;
+            size_t bucket = (size_t)(hash >> (64 - kAddrShardBits - table->Bits)) & mask;
+
+            for (;;)
+            {
+                TADDR cur = table->Slots[bucket];
+                if (cur == addr)
+                {
+                    LeaveWriter(shard);
+                    return false;
+                }
+
+                if (cur == 0)
+                {
+                    TADDR prev = (TADDR)InterlockedCompareExchangePointer(
+                        (PVOID volatile *)&table->Slots[bucket], (PVOID)addr, NULL);
+                    if (prev == 0)
+                    {
+                        InterlockedIncrement(&shard.Count);
+                        LeaveWriter(shard);
+                        return true;
+                    }
+                    if (prev == addr)
+                    {
+                        LeaveWriter(shard);
+                        return false;
+                    }
+                    // Another thread claimed the slot for a different key;
+                    // keep probing past it.
+                }
+
+                bucket = (bucket + 1) & mask;
+            }
+        }
+    }
+
+    /* Returns true if addr is in the set.  Lock-free.
+     */
+    bool Contains(TADDR addr) const
+    {
+        if (addr == 0)
+            return false;
+
+        ULONG64 hash = MixAddress(addr);
+        const Shard &shard = mShards[hash >> (64 - kAddrShardBits)];
+
+        Table *table = shard.Current;
+        size_t mask = table->Size - 1;
+        size_t bucket = (size_t)(hash >> (64 - kAddrShardBits - table->Bits)) & mask;
+
+        for (;;)
+        {
+            TADDR cur = table->Slots[bucket];
+            if (cur == addr)
+                return true;
+            if (cur == 0)
+                return false;
+
+            bucket = (bucket + 1) & mask;
+        }
+    }
+
+    /* Number of addresses in the set.  Exact only when no inserts are in
+     * flight.
+     */
+    size_t Count() const
+    {
+        size_t total = 0;
+        for (int i = 0; i < kAddrShardCount; i++)
+            total += (size_t)mShards[i].Count;
+        return total;
+    }
+
+    /* Empties the set and releases the retired tables.  Not safe to call
+     * concurrently with any other operation.
+     */
+    void Clear()
+    {
+        for (int i = 0; i < kAddrShardCount; i++)
+        {
+            Shard &shard = mShards[i];
+
+            for (size_t r = 0; r < shard.Retired.size(); r++)
+                FreeTable(shard.Retired[r]);
+            shard.Retired.clear();
+
+            if (shard.Current->Size != kInitialSlots)
+            {
+                FreeTable(shard.Current);
+                shard.Current = NewTable(kInitialSlots);
+            }
+            else
+            {
+                memset((void *)shard.Current->Slots, 0, shard.Current->Size * sizeof(TADDR));
+            }
+            shard.Count = 0;
+        }
+    }
+
+private:
+    // Initial slots per shard; must be a power of 2.
+    static const size_t kInitialSlots = 0x100;
+
+    struct Table
+    {
+        size_t Size;            // number of slots, a power of 2
+        int Bits;               // log2(Size)
+        TADDR volatile *Slots;  // 0 marks an empty slot
+    };
+
+    struct Shard
+    {
+        Table * volatile Current;
+        volatile LONG Count;    // entries inserted
+        volatile LONG Growing;  // a grower holds this while rebuilding
+        volatile LONG Writers;  // writers currently touching Current
+        std::vector<Table*> Retired;
+    };
+
+    static void InitShard(Shard &shard)
+    {
+        shard.Current = NewTable(kInitialSlots);
+        shard.Count = 0;
+        shard.Growing = 0;
+        shard.Writers = 0;
+    }
+
+    static Table *NewTable(size_t size)
+    {
+        Table *table = new Table;
+        table->Size = size;
+        table->Bits = 0;
+        for (size_t s = size; s > 1; s >>= 1)
+            table->Bits++;
+        table->Slots = new TADDR[size]();
+        ADDRSET_ACCOUNT_ALLOC(sizeof(Table) + size * sizeof(TADDR));
+        return table;
+    }
+
+    static void FreeTable(Table *table)
+    {
+        ADDRSET_ACCOUNT_FREE(sizeof(Table) + table->Size * sizeof(TADDR));
+        delete [] (TADDR *)table->Slots;
+        delete table;
+    }
+
+    // Writers gate out growth (not each other): an insert registers here
+    // and backs off while the shard is being rebuilt.
+    static void EnterWriter(Shard &shard)
+    {
+        for (;;)
+        {
+            InterlockedIncrement(&shard.Writers);
+            if (!shard.Growing)
+                return;
+
+            InterlockedDecrement(&shard.Writers);
+            while (shard.Growing)
+                YieldProcessor();
+        }
+    }
+
+    static void LeaveWriter(Shard &shard)
+    {
+        InterlockedDecrement(&shard.Writers);
+    }
+
+    // Doubles the shard's table.  Only one thread rebuilds; the rest wait
+    // for it and retry their insert against the new table.
+    void Grow(Shard &shard, Table *expect)
+    {
+        if (InterlockedExchange(&shard.Growing, 1) != 0)
+        {
+            while (shard.Growing)
+                YieldProcessor();
+            return;
+        }
+
+        // Wait for in-flight writers to drain, then check that the loser
+        // of a growth race isn't doubling a table that already doubled.
+        while (shard.Writers != 0)
+            YieldProcessor();
+
+        Table *table = shard.Current;
+        if (table == expect)
+        {
+            Table *next = NewTable(table->Size * 2);
+            size_t mask = next->Size - 1;
+            int bits = next->Bits;
+
+            for (size_t i = 0; i < table->Size; i++)
+            {
+                TADDR addr = table->Slots[i];
+                if (addr == 0)
+                    continue;
+
+                size_t bucket = (size_t)(MixAddress(addr) >> (64 - kAddrShardBits - bits)) & mask;
+                while (next->Slots[bucket] != 0)
+                    bucket = (bucket + 1) & mask;
+                next->Slots[bucket] = addr;
+            }
+
+            // Readers may still hold the old table; retire it instead of
+            // freeing it.
+            shard.Retired.push_back(table);
+            InterlockedExchangePointer((PVOID volatile *)&shard.Current, next);
+        }
+
+        InterlockedExchange(&shard.Growing, 0);
+    }
+
+private:
+    Shard mShards[kAddrShardCount];
+};
+
+/* A sharded concurrent map from target address to a 64-bit value.
+ * Same structure and concurrency contract as SharedAddressSet; values are
+ * updated with interlocked operations, so Add can accumulate from several
+ * threads.
+ */
+class SharedAddressMap
+{
+public:
+    SharedAddressMap()
+    {
+        for (int i = 0; i < kAddrShardCount; i++)
+            InitShard(mShards[i]);
+    }
+
+    ~SharedAddressMap()
+    {
+        Clear();
+        for (int i = 0; i < kAddrShardCount; i++)
+            FreeTable(mShards[i].Current);
+    }
+
+    /* Sets the value for key, inserting it if absent.
+     */
+    void Set(TADDR key, ULONG64 value)
+    {
+        Slot *slot = FindOrAdd(key);
+        if (slot != NULL)
+            InterlockedExchange64((LONG64 volatile *)&slot->Value, (LONG64)value);
+    }
+
+    /* Adds delta to the value for key (inserting it as zero first if
+     * absent) and returns the new value.  Atomic, so concurrent Adds to
+     * one key all land.
+     */
+    ULONG64 Add(TADDR key, ULONG64 delta)
+    {
+        Slot *slot = FindOrAdd(key);
+        if (slot == NULL)
+            return 0;
+        return (ULONG64)InterlockedExchangeAdd64((LONG64 volatile *)&slot->Value, (LONG64)delta) + delta;
+    }
+
+    /* Fetches the value for key.  Returns false (and leaves *value alone)
+     * if the key is absent.  Lock-free.
+     */
+    bool Lookup(TADDR key, ULONG64 *value) const
+    {
+        const Slot *slot = Find(key);
+        if (slot == NULL)
+            return false;
+
+        *value = slot->Value;
+        return true;
+    }
+
+    /* The value for key, or zero if the key is absent.  Lock-free.
+     */
+    ULONG64 Get(TADDR key) const
+    {
+        const Slot *slot = Find(key);
+        return slot != NULL ? slot->Value : 0;
+    }
+
+    /* Returns true if key is in the map.  Lock-free.
+     */
+    bool Contains(TADDR key) const
+    {
+        return Find(key) != NULL;
+    }
+
+    /* Number of keys in the map.  Exact only when no inserts are in
+     * flight.
+     */
+    size_t Count() const
+    {
+        size_t total = 0;
+        for (int i = 0; i < kAddrShardCount; i++)
+            total += (size_t)mShards[i].Count;
+        return total;
+    }
+
+    /* Empties the map and releases the retired tables.  Not safe to call
+     * concurrently with any other operation.
+     */
+    void Clear()
+    {
+        for (int i = 0; i < kAddrShardCount; i++)
+        {
+            Shard &shard = mShards[i];
+
+            for (size_t r = 0; r < shard.Retired.size(); r++)
+                FreeTable(shard.Retired[r]);
+            shard.Retired.clear();
+
+            if (shard.Current->Size != kInitialSlots)
+            {
+                FreeTable(shard.Current);
+                shard.Current = NewTable(kInitialSlots);
+            }
+            else
+            {
+                memset((void *)shard.Current->Slots, 0, shard.Current->Size * sizeof(Slot));
+            }
+            shard.Count = 0;
+        }
+    }
+
+private:
+    // Initial slots per shard; must be a power of 2.
+    static const size_t kInitialSlots = 0x100;
+
+    struct Slot
+    {
+        TADDR volatile Key;       // 0 marks an empty slot; published last
+        ULONG64 volatile Value;
+    };
+
+    struct Table
+    {
+        size_t Size;              // number of slots, a power of 2
+        int Bits;                 // log2(Size)
+        Slot *Slots;
+    };
+
+    struct Shard
+    {
+        Table * volatile Current;
+        volatile LONG Count;
+        volatile LONG Growing;
+        volatile LONG Writers;
+        std::vector<Table*> Retired;
+    };
+
+    static void InitShard(Shard &shard)
+    {
+        shard.Current = NewTable(kInitialSlots);
+        shard.Count = 0;
+        shard.Growing = 0;
+        shard.Writers = 0;
+    }
+
+    static Table *NewTable(size_t size)
+    {
+        Table *table = new Table;
+        table->Size = size;
+        table->Bits = 0;
+        for (size_t s = size; s > 1; s >>= 1)
+            table->Bits++;
+        table->Slots = new Slot[size]();
+        ADDRSET_ACCOUNT_ALLOC(sizeof(Table) + size * sizeof(Slot));
+        return table;
+    }
+
+    static void FreeTable(Table *table)
+    {
+        ADDRSET_ACCOUNT_FREE(sizeof(Table) + table->Size * sizeof(Slot));
+        delete [] table->Slots;
+        delete table;
+    }
+
+    static void EnterWriter(Shard &shard)
+    {
+        for (;;)
+        {
+            InterlockedIncrement(&shard.Writers);
+            if (!shard.Growing)
+                return;
+
+            InterlockedDecrement(&shard.Writers);
+            while (shard.Growing)
+                YieldProcessor();
+        }
+    }
+
+    static void LeaveWriter(Shard &shard)
+    {
+        InterlockedDecrement(&shard.Writers);
+    }
+
+    const Slot *Find(TADDR key) const
+    {
+        if (key == 0)
+            return NULL;
+
+        ULONG64 hash = MixAddress(key);
+        const Shard &shard = mShards[hash >> (64 - kAddrShardBits)];
+
+        Table *table = shard.Current;
+        size_t mask = table->Size - 1;
+        size_t bucket = (size_t)(hash >> (64 - kAddrShardBits - table->Bits)) & mask;
+
+        for (;;)
+        {
+            const Slot &slot = table->Slots[bucket];
+            if (slot.Key == key)
+                return &slot;
+            if (slot.Key == 0)
+                return NULL;
+
+            bucket = (bucket + 1) & mask;
+        }
+    }
+
+    // Returns the slot for key, inserting a zero-valued one if absent.
+    // An inserter publishes the key with a compare-exchange after the
+    // (zero) value is visible, so a reader that sees the key sees a
+    // coherent slot.
+    Slot *FindOrAdd(TADDR key)
+    {
+        if (key == 0)
+            return NULL;
+
+        ULONG64 hash = MixAddress(key);
+        Shard &shard = mShards[hash >> (64 - kAddrShardBits)];
+
+        for (;;)
+        {
+            EnterWriter(shard);
+
+            Table *table = shard.Current;
+            if ((size_t)shard.Count * 4 >= table->Size * 3)
+            {
+                LeaveWriter(shard);
+                Grow(shard, table);
+                continue;
+            }
+
+            size_t mask = table->Size - 1;
+            size_t bucket = (size_t)(hash >> (64 - kAddrShardBits - table->Bits)) & mask;
+
+            for (;;)
+            {
+                Slot &slot = table->Slots[bucket];
+                TADDR cur = slot.Key;
+                if (cur == key)
+                {
+                    LeaveWriter(shard);
+                    return &slot;
+                }
+
+                if (cur == 0)
+                {
+                    TADDR prev = (TADDR)InterlockedCompareExchangePointer(
+                        (PVOID volatile *)&slot.Key, (PVOID)key, NULL);
+                    if (prev == 0)
+                    {
+                        InterlockedIncrement(&shard.Count);
+                        LeaveWriter(shard);
+                        return &slot;
+                    }
+                    if (prev == key)
+                    {
+                        LeaveWriter(shard);
+                        return &slot;
+                    }
+                }
+
+                bucket = (bucket + 1) & mask;
+            }
+        }
+    }
+
+    void Grow(Shard &shard, Table *expect)
+    {
+        if (InterlockedExchange(&shard.Growing, 1) != 0)
+        {
+            while (shard.Growing)
+                YieldProcessor();
+            return;
+        }
+
+        while (shard.Writers != 0)
+            YieldProcessor();
+
+        Table *table = shard.Current;
+        if (table == expect)
+        {
+            Table *next = NewTable(table->Size * 2);
+            size_t mask = next->Size - 1;
+            int bits = next->Bits;
+
+            for (size_t i = 0; i < table->Size; i++)
+            {
+                const Slot &slot = table->Slots[i];
+                if (slot.Key == 0)
+                    continue;
+
+                size_t bucket = (size_t)(MixAddress(slot.Key) >> (64 - kAddrShardBits - bits)) & mask;
+                while (next->Slots[bucket].Key != 0)
+                    bucket = (bucket + 1) & mask;
+                next->Slots[bucket].Key = slot.Key;
+                next->Slots[bucket].Value = slot.Value;
+            }
+
+            shard.Retired.push_back(table);
+            InterlockedExchangePointer((PVOID volatile *)&shard.Current, next);
+        }
+
+        InterlockedExchange(&shard.Growing, 0);
+    }
+
+private:
+    Shard mShards[kAddrShardCount];
+};
@@ -0,0 +1,379 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+// ==++==
+//
+// Microbenchmarks for the Strike hot-path primitives.
+//
+// Every performance change to the heap commands should be accepted or
+// rejected on numbers; this target supplies them for the pieces that can
+// run outside a debugger session: the concurrent address set/map, the
+// sorting utilities, a synthetic object-graph traversal shaped like the
+// gcroot walk, the vector scan kernels (checked against their scalar
+// definitions first), and printf-family formatting (PAL_vsnprintf on Unix),
+// which dominates large -stat outputs.  The paths that need a live DAC —
+// LinearReadCache fills, real GCRootImpl runs — are measured in-session
+// with !sosperf instead.
+//
+// Each benchmark is warmed up once and then timed over several rounds;
+// the best round is reported, which is the stablest statistic on a noisy
+// machine.  Output is one CSV row per benchmark:
+//
+//     name,operations,ns_per_op,ops_per_sec
+//
+// An optional argument filters benchmarks by substring:
+//
+//     sosbench [filter]
+//
+// ==--==
+
+#include <windows.h>
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "../addrset.h"
+#include "../radixsort.h"
+#include "../scankernels.h"
+
+// A fixed-seed xorshift generator, so every run sorts and inserts exactly
+// the same data.
+static ULONG64 s_randState = 0x853C49E6748FEA9BULL;
+
+static ULONG64 NextRand()
+{
+    ULONG64 x = s_randState;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    s_randState = x;
+    return x;
+}
+
+static void ResetRand()
+{
+    s_randState = 0x853C49E6748FEA9BULL;
+}
+
+static double NowNs()
+{
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart * 1e9 / (double)freq.QuadPart;
+}
+
+static const char *s_filter = NULL;
+
+// Runs fn (which performs `ops` operations) once to warm up and then
+// kRounds times for the clock, reporting the best round.
+template <class FN>
+static void RunBench(const char *name, ULONG64 ops, FN fn)
+{
+    const int kRounds = 5;
+
+    if (s_filter != NULL && strstr(name, s_filter) == NULL)
+        return;
+
+    fn();   // warmup: faults pages, primes caches and branch predictors
+
+    double best = 0;
+    for (int round = 0; round < kRounds; round++)
+    {
+        double start = NowNs();
+        fn();
+        double elapsed = NowNs() - start;
+
+        if (round == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    double nsPerOp = best / (double)ops;
+    printf("%s,%llu,%.2f,%.0f\n", name, (unsigned long long)ops, nsPerOp, 1e9 / nsPerOp);
+    fflush(stdout);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Concurrent address set / map.
+///////////////////////////////////////////////////////////////////////////////
+
+static const size_t kAddrCount = 1000000;
+
+static void MakeAddresses(std::vector<TADDR> &addrs)
+{
+    ResetRand();
+    addrs.resize(kAddrCount);
+    for (size_t i = 0; i < kAddrCount; i++)
+        addrs[i] = (TADDR)((NextRand() & 0xFFFFFFFFF8ULL) | 8);
+}
+
+static void BenchAddressSet()
+{
+    std::vector<TADDR> addrs;
+    MakeAddresses(addrs);
+
+    RunBench("addrset_insert", kAddrCount, [&]()
+    {
+        SharedAddressSet set;
+        for (size_t i = 0; i < kAddrCount; i++)
+            set.Add(addrs[i]);
+    });
+
+    SharedAddressSet set;
+    for (size_t i = 0; i < kAddrCount; i++)
+        set.Add(addrs[i]);
+
+    RunBench("addrset_hit", kAddrCount, [&]()
+    {
+        size_t hits = 0;
+        for (size_t i = 0; i < kAddrCount; i++)
+            hits += set.Contains(addrs[i]);
+        if (hits == 0)
+            printf("# impossible\n");
+    });
+
+    RunBench("addrset_miss", kAddrCount, [&]()
+    {
+        size_t hits = 0;
+        for (size_t i = 0; i < kAddrCount; i++)
+            hits += set.Contains(addrs[i] ^ 0x4);
+        if (hits != 0)
+            printf("# impossible\n");
+    });
+
+    RunBench("addrmap_accumulate", kAddrCount, [&]()
+    {
+        SharedAddressMap map;
+        for (size_t i = 0; i < kAddrCount; i++)
+            map.Add(addrs[i] & ~(TADDR)0xFF8, 24);
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Sorting.
+///////////////////////////////////////////////////////////////////////////////
+
+struct StatRow
+{
+    TADDR Data;
+    DWORD Count;
+    size_t TotalSize;
+};
+
+static void MakeRows(std::vector<StatRow> &rows, size_t n)
+{
+    ResetRand();
+    rows.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        rows[i].Data = (TADDR)NextRand();
+        rows[i].Count = (DWORD)(NextRand() & 0xFFFF);
+        rows[i].TotalSize = (size_t)(NextRand() & 0xFFFFFFF);
+    }
+}
+
+static void BenchSorts()
+{
+    const size_t kRows = 1000000;
+    std::vector<StatRow> rows;
+    MakeRows(rows, kRows);
+
+    RunBench("sort_radix_1m", kRows, [&]()
+    {
+        std::vector<StatRow> v = rows;
+        RadixSortByKey(v, [](const StatRow &row) { return (ULONG64)row.TotalSize; });
+    });
+
+    RunBench("sort_std_1m", kRows, [&]()
+    {
+        std::vector<StatRow> v = rows;
+        std::sort(v.begin(), v.end(),
+            [](const StatRow &lhs, const StatRow &rhs) { return lhs.TotalSize < rhs.TotalSize; });
+    });
+
+    const size_t kBig = 4000000;
+    std::vector<StatRow> big;
+    MakeRows(big, kBig);
+
+    RunBench("sort_parallel_merge_4m", kBig, [&]()
+    {
+        std::vector<StatRow> v = big;
+        ParallelMergeSort(v,
+            [](const StatRow &lhs, const StatRow &rhs) { return lhs.TotalSize < rhs.TotalSize; });
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Synthetic object-graph traversal.
+///////////////////////////////////////////////////////////////////////////////
+
+// A graph shaped like a managed heap snapshot: a flat node array where each
+// node holds a few edges to random other nodes.  The walk is the gcroot
+// pattern — a frontier, a visited set, no recursion — so what's measured is
+// the visited-set and frontier cost per edge, with the DAC out of the
+// picture.
+static void BenchGraphWalk()
+{
+    const size_t kNodes = 1000000;
+    const int kEdges = 3;
+
+    ResetRand();
+    std::vector<ULONG> edges(kNodes * kEdges);
+    for (size_t i = 0; i < edges.size(); i++)
+        edges[i] = (ULONG)(NextRand() % kNodes);
+
+    RunBench("graph_walk_bfs", kNodes * kEdges, [&]()
+    {
+        SharedAddressSet visited;
+        std::vector<ULONG> frontier, next;
+
+        frontier.push_back(0);
+        visited.Add(0x10);
+
+        while (!frontier.empty())
+        {
+            for (size_t i = 0; i < frontier.size(); i++)
+            {
+                const ULONG *refs = &edges[(size_t)frontier[i] * kEdges];
+                for (int e = 0; e < kEdges; e++)
+                {
+                    // Node indices are spread like object addresses.
+                    TADDR addr = ((TADDR)refs[e] << 4) | 0x10;
+                    if (visited.Add(addr))
+                        next.push_back(refs[e]);
+                }
+            }
+
+            frontier.swap(next);
+            next.clear();
+        }
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Scan kernels.
+///////////////////////////////////////////////////////////////////////////////
+
+// Checks the vector kernels against their scalar definitions before timing
+// them; a kernel that disagrees gets a "# ... disagrees" line instead of
+// numbers.
+static void BenchScanKernels()
+{
+    const size_t kSlots = 1000000;
+    const DWORD_PTR base = (DWORD_PTR)0x10000000;
+    const DWORD_PTR range = (DWORD_PTR)0x8000000;
+
+    ResetRand();
+    std::vector<DWORD_PTR> slots(kSlots);
+    for (size_t i = 0; i < kSlots; i++)
+    {
+        // Mostly junk with a few percent of in-range "heap pointers",
+        // shaped like a stack scan.
+        if (NextRand() % 32 == 0)
+            slots[i] = base + (DWORD_PTR)(NextRand() % range);
+        else
+            slots[i] = (DWORD_PTR)NextRand();
+    }
+
+    size_t scalarHits = 0;
+    for (size_t i = 0; i < kSlots; i++)
+    {
+        if ((DWORD_PTR)(slots[i] - base) < range)
+            scalarHits++;
+    }
+
+    size_t kernelHits = 0;
+    for (size_t i = ScanNextSlotInRange(slots.data(), kSlots, 0, base, range);
+         i < kSlots;
+         i = ScanNextSlotInRange(slots.data(), kSlots, i + 1, base, range))
+        kernelHits++;
+
+    if (kernelHits != scalarHits)
+    {
+        printf("# scan_range disagrees with scalar: %llu vs %llu\n",
+               (unsigned long long)kernelHits, (unsigned long long)scalarHits);
+        return;
+    }
+
+    RunBench("scan_range_1m", kSlots, [&]()
+    {
+        size_t hits = 0;
+        for (size_t i = ScanNextSlotInRange(slots.data(), kSlots, 0, base, range);
+             i < kSlots;
+             i = ScanNextSlotInRange(slots.data(), kSlots, i + 1, base, range))
+            hits++;
+        if (hits != scalarHits)
+            printf("# impossible\n");
+    });
+
+    const size_t kHashBytes = 1 << 20;
+    std::vector<BYTE> payload(kHashBytes);
+    for (size_t i = 0; i < kHashBytes; i++)
+        payload[i] = (BYTE)NextRand();
+
+    RunBench("scan_hash_1m", kHashBytes, [&]()
+    {
+        if (ScanHashBytes(payload.data(), kHashBytes) == 0)
+            printf("# impossible\n");
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Formatting.
+///////////////////////////////////////////////////////////////////////////////
+
+static int FormatOne(char *buffer, size_t size, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer, size, format, args);
+    va_end(args);
+    return written;
+}
+
+// On Unix vsnprintf is PAL_vsnprintf, the formatter under every ExtOut; a
+// million rows of !dumpheap -stat is a million trips through it.
+static void BenchFormat()
+{
+    const size_t kFormats = 1000000;
+
+    RunBench("format_vsnprintf", kFormats, [&]()
+    {
+        char buffer[128];
+        size_t total = 0;
+        for (size_t i = 0; i < kFormats; i++)
+            total += FormatOne(buffer, sizeof(buffer), "%p %8d %12lu %s\n",
+                               (void *)(size_t)(i * 24), (int)i, (unsigned long)(i * 3), "System.String");
+        if (total == 0)
+            printf("# impossible\n");
+    });
+}
+
+int __cdecl main(int argc, char *argv[])
+{
+#ifdef FEATURE_PAL
+    if (PAL_InitializeDLL() != 0)
+    {
+        fprintf(stderr, "PAL initialization failed\n");
+        return 1;
+    }
+#endif
+
+    if (argc > 1)
+        s_filter = argv[1];
+
+    printf("name,operations,ns_per_op,ops_per_sec\n");
+
+    BenchAddressSet();
+    BenchSorts();
+    BenchGraphWalk();
+    BenchScanKernels();
+    BenchFormat();
+
+    return 0;
+}
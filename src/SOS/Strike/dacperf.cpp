@@ -0,0 +1,277 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+// Counting/latency shim around the ISOSDacInterface call edge.  While the
+// !sosperf profiler is enabled, LoadClrDebugDll hands commands a forwarding
+// proxy instead of the DAC's own interface; every method runs under a timer
+// that buckets the call into a latency histogram keyed by method name.
+// "!sosperf -dac" prints the histograms, which show whether a slow command
+// spent its time in DAC requests or in raw memory reads (!readstats covers
+// the latter).
+
+#include "exts.h"
+
+#include <map>
+#include <string>
+
+namespace
+{
+
+// Histogram bucket upper bounds, in microseconds.  The last bucket is open.
+const ULONG64 kBucketLimits[] = { 10, 100, 1000, 10000, 100000 };
+const int kBucketCount = _countof(kBucketLimits) + 1;
+
+struct DacRequestStats
+{
+    ULONG64 Calls;
+    ULONG64 TotalMicros;
+    ULONG64 Buckets[kBucketCount];
+};
+
+// Created on first use so sessions that never enable the profiler pay
+// nothing.  Keyed by ISOSDacInterface method name, which maps one-to-one to
+// the Dacp* structure whose Request made the call.
+std::map<std::string, DacRequestStats> *g_dacStats = NULL;
+
+ULONG64 TicksToMicros(ULONG64 ticks)
+{
+    static ULONG64 frequency = 0;
+    if (frequency == 0)
+    {
+        LARGE_INTEGER freq;
+        QueryPerformanceFrequency(&freq);
+        frequency = freq.QuadPart;
+    }
+    return ticks * 1000000 / frequency;
+}
+
+// Times one DAC request and folds it into the histogram for "name".
+class DacRequestTimer
+{
+public:
+    DacRequestTimer(const char *name)
+    {
+        mName = name;
+        LARGE_INTEGER start;
+        QueryPerformanceCounter(&start);
+        mStart = start.QuadPart;
+    }
+
+    ~DacRequestTimer()
+    {
+        LARGE_INTEGER end;
+        QueryPerformanceCounter(&end);
+        ULONG64 micros = TicksToMicros(end.QuadPart - mStart);
+
+        if (g_dacStats == NULL)
+            g_dacStats = new (std::nothrow) std::map<std::string, DacRequestStats>();
+        if (g_dacStats == NULL)
+            return;
+
+        DacRequestStats &stats = (*g_dacStats)[mName];
+        stats.Calls++;
+        stats.TotalMicros += micros;
+        int bucket = 0;
+        while (bucket < kBucketCount - 1 && micros >= kBucketLimits[bucket])
+            bucket++;
+        stats.Buckets[bucket]++;
+    }
+
+private:
+    const char *mName;
+    ULONG64 mStart;
+};
+
+// Forwards one ISOSDacInterface method to the real implementation under a
+// DacRequestTimer.
+#define DAC_FORWARD(Method, Params, Args)                   \
+    virtual HRESULT STDMETHODCALLTYPE Method Params         \
+    {                                                       \
+        DacRequestTimer timer(#Method);                     \
+        return mReal->Method Args;                          \
+    }
+
+class SOSDacPerfProxy : public ISOSDacInterface
+{
+public:
+    // Takes over the caller's reference on "real"; it is released when the
+    // proxy's own reference count reaches zero.
+    SOSDacPerfProxy(ISOSDacInterface *real)
+        : mRefCount(1), mReal(real)
+    {
+    }
+
+    virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject)
+    {
+        if (riid == __uuidof(ISOSDacInterface) || riid == IID_IUnknown)
+        {
+            AddRef();
+            *ppvObject = this;
+            return S_OK;
+        }
+        // The versioned interfaces (ISOSDacInterface2 and up) escape the
+        // shim; the handful of requests made on them is noise next to the
+        // traffic on the primary interface.
+        return mReal->QueryInterface(riid, ppvObject);
+    }
+
+    virtual ULONG STDMETHODCALLTYPE AddRef()
+    {
+        return (ULONG)InterlockedIncrement(&mRefCount);
+    }
+
+    virtual ULONG STDMETHODCALLTYPE Release()
+    {
+        LONG count = InterlockedDecrement(&mRefCount);
+        if (count <= 0)
+            delete this;
+        return (ULONG)count;
+    }
+
+    DAC_FORWARD(GetThreadStoreData, (struct DacpThreadStoreData *data), (data))
+    DAC_FORWARD(GetAppDomainStoreData, (struct DacpAppDomainStoreData *data), (data))
+    DAC_FORWARD(GetAppDomainList, (unsigned int count, CLRDATA_ADDRESS values[], unsigned int *pNeeded), (count, values, pNeeded))
+    DAC_FORWARD(GetAppDomainData, (CLRDATA_ADDRESS addr, struct DacpAppDomainData *data), (addr, data))
+    DAC_FORWARD(GetAppDomainName, (CLRDATA_ADDRESS addr, unsigned int count, WCHAR *name, unsigned int *pNeeded), (addr, count, name, pNeeded))
+    DAC_FORWARD(GetDomainFromContext, (CLRDATA_ADDRESS context, CLRDATA_ADDRESS *domain), (context, domain))
+    DAC_FORWARD(GetAssemblyList, (CLRDATA_ADDRESS appDomain, int count, CLRDATA_ADDRESS values[], int *pNeeded), (appDomain, count, values, pNeeded))
+    DAC_FORWARD(GetAssemblyData, (CLRDATA_ADDRESS baseDomainPtr, CLRDATA_ADDRESS assembly, struct DacpAssemblyData *data), (baseDomainPtr, assembly, data))
+    DAC_FORWARD(GetAssemblyName, (CLRDATA_ADDRESS assembly, unsigned int count, WCHAR *name, unsigned int *pNeeded), (assembly, count, name, pNeeded))
+    DAC_FORWARD(GetModule, (CLRDATA_ADDRESS addr, IXCLRDataModule **mod), (addr, mod))
+    DAC_FORWARD(GetModuleData, (CLRDATA_ADDRESS moduleAddr, struct DacpModuleData *data), (moduleAddr, data))
+    DAC_FORWARD(TraverseModuleMap, (ModuleMapType mmt, CLRDATA_ADDRESS moduleAddr, MODULEMAPTRAVERSE pCallback, LPVOID token), (mmt, moduleAddr, pCallback, token))
+    DAC_FORWARD(GetAssemblyModuleList, (CLRDATA_ADDRESS assembly, unsigned int count, CLRDATA_ADDRESS modules[], unsigned int *pNeeded), (assembly, count, modules, pNeeded))
+    DAC_FORWARD(GetILForModule, (CLRDATA_ADDRESS moduleAddr, DWORD rva, CLRDATA_ADDRESS *il), (moduleAddr, rva, il))
+    DAC_FORWARD(GetThreadData, (CLRDATA_ADDRESS thread, struct DacpThreadData *data), (thread, data))
+    DAC_FORWARD(GetThreadFromThinlockID, (UINT thinLockId, CLRDATA_ADDRESS *pThread), (thinLockId, pThread))
+    DAC_FORWARD(GetStackLimits, (CLRDATA_ADDRESS threadPtr, CLRDATA_ADDRESS *lower, CLRDATA_ADDRESS *upper, CLRDATA_ADDRESS *fp), (threadPtr, lower, upper, fp))
+    DAC_FORWARD(GetMethodDescData, (CLRDATA_ADDRESS methodDesc, CLRDATA_ADDRESS ip, struct DacpMethodDescData *data, ULONG cRevertedRejitVersions, struct DacpReJitData *rgRevertedRejitData, ULONG *pcNeededRevertedRejitData), (methodDesc, ip, data, cRevertedRejitVersions, rgRevertedRejitData, pcNeededRevertedRejitData))
+    DAC_FORWARD(GetMethodDescPtrFromIP, (CLRDATA_ADDRESS ip, CLRDATA_ADDRESS *ppMD), (ip, ppMD))
+    DAC_FORWARD(GetMethodDescName, (CLRDATA_ADDRESS methodDesc, unsigned int count, WCHAR *name, unsigned int *pNeeded), (methodDesc, count, name, pNeeded))
+    DAC_FORWARD(GetMethodDescPtrFromFrame, (CLRDATA_ADDRESS frameAddr, CLRDATA_ADDRESS *ppMD), (frameAddr, ppMD))
+    DAC_FORWARD(GetMethodDescFromToken, (CLRDATA_ADDRESS moduleAddr, mdToken token, CLRDATA_ADDRESS *methodDesc), (moduleAddr, token, methodDesc))
+    DAC_FORWARD(GetMethodDescTransparencyData, (CLRDATA_ADDRESS methodDesc, struct DacpMethodDescTransparencyData *data), (methodDesc, data))
+    DAC_FORWARD(GetCodeHeaderData, (CLRDATA_ADDRESS ip, struct DacpCodeHeaderData *data), (ip, data))
+    DAC_FORWARD(GetJitManagerList, (unsigned int count, struct DacpJitManagerInfo *managers, unsigned int *pNeeded), (count, managers, pNeeded))
+    DAC_FORWARD(GetJitHelperFunctionName, (CLRDATA_ADDRESS ip, unsigned int count, char *name, unsigned int *pNeeded), (ip, count, name, pNeeded))
+    DAC_FORWARD(GetJumpThunkTarget, (T_CONTEXT *ctx, CLRDATA_ADDRESS *targetIP, CLRDATA_ADDRESS *targetMD), (ctx, targetIP, targetMD))
+    DAC_FORWARD(GetThreadpoolData, (struct DacpThreadpoolData *data), (data))
+    DAC_FORWARD(GetWorkRequestData, (CLRDATA_ADDRESS addrWorkRequest, struct DacpWorkRequestData *data), (addrWorkRequest, data))
+    DAC_FORWARD(GetHillClimbingLogEntry, (CLRDATA_ADDRESS addr, struct DacpHillClimbingLogEntry *data), (addr, data))
+    DAC_FORWARD(GetObjectData, (CLRDATA_ADDRESS objAddr, struct DacpObjectData *data), (objAddr, data))
+    DAC_FORWARD(GetObjectStringData, (CLRDATA_ADDRESS obj, unsigned int count, WCHAR *stringData, unsigned int *pNeeded), (obj, count, stringData, pNeeded))
+    DAC_FORWARD(GetObjectClassName, (CLRDATA_ADDRESS obj, unsigned int count, WCHAR *className, unsigned int *pNeeded), (obj, count, className, pNeeded))
+    DAC_FORWARD(GetMethodTableName, (CLRDATA_ADDRESS mt, unsigned int count, WCHAR *mtName, unsigned int *pNeeded), (mt, count, mtName, pNeeded))
+    DAC_FORWARD(GetMethodTableData, (CLRDATA_ADDRESS mt, struct DacpMethodTableData *data), (mt, data))
+    DAC_FORWARD(GetMethodTableSlot, (CLRDATA_ADDRESS mt, unsigned int slot, CLRDATA_ADDRESS *value), (mt, slot, value))
+    DAC_FORWARD(GetMethodTableFieldData, (CLRDATA_ADDRESS mt, struct DacpMethodTableFieldData *data), (mt, data))
+    DAC_FORWARD(GetMethodTableTransparencyData, (CLRDATA_ADDRESS mt, struct DacpMethodTableTransparencyData *data), (mt, data))
+    DAC_FORWARD(GetMethodTableForEEClass, (CLRDATA_ADDRESS eeClass, CLRDATA_ADDRESS *value), (eeClass, value))
+    DAC_FORWARD(GetFieldDescData, (CLRDATA_ADDRESS fieldDesc, struct DacpFieldDescData *data), (fieldDesc, data))
+    DAC_FORWARD(GetFrameName, (CLRDATA_ADDRESS vtable, unsigned int count, WCHAR *frameName, unsigned int *pNeeded), (vtable, count, frameName, pNeeded))
+    DAC_FORWARD(GetPEFileBase, (CLRDATA_ADDRESS addr, CLRDATA_ADDRESS *base), (addr, base))
+    DAC_FORWARD(GetPEFileName, (CLRDATA_ADDRESS addr, unsigned int count, WCHAR *fileName, unsigned int *pNeeded), (addr, count, fileName, pNeeded))
+    DAC_FORWARD(GetGCHeapData, (struct DacpGcHeapData *data), (data))
+    DAC_FORWARD(GetGCHeapList, (unsigned int count, CLRDATA_ADDRESS heaps[], unsigned int *pNeeded), (count, heaps, pNeeded))
+    DAC_FORWARD(GetGCHeapDetails, (CLRDATA_ADDRESS heap, struct DacpGcHeapDetails *details), (heap, details))
+    DAC_FORWARD(GetGCHeapStaticData, (struct DacpGcHeapDetails *data), (data))
+    DAC_FORWARD(GetHeapSegmentData, (CLRDATA_ADDRESS seg, struct DacpHeapSegmentData *data), (seg, data))
+    DAC_FORWARD(GetOOMData, (CLRDATA_ADDRESS oomAddr, struct DacpOomData *data), (oomAddr, data))
+    DAC_FORWARD(GetOOMStaticData, (struct DacpOomData *data), (data))
+    DAC_FORWARD(GetHeapAnalyzeData, (CLRDATA_ADDRESS addr, struct DacpGcHeapAnalyzeData *data), (addr, data))
+    DAC_FORWARD(GetHeapAnalyzeStaticData, (struct DacpGcHeapAnalyzeData *data), (data))
+    DAC_FORWARD(GetDomainLocalModuleData, (CLRDATA_ADDRESS addr, struct DacpDomainLocalModuleData *data), (addr, data))
+    DAC_FORWARD(GetDomainLocalModuleDataFromAppDomain, (CLRDATA_ADDRESS appDomainAddr, int moduleID, struct DacpDomainLocalModuleData *data), (appDomainAddr, moduleID, data))
+    DAC_FORWARD(GetDomainLocalModuleDataFromModule, (CLRDATA_ADDRESS moduleAddr, struct DacpDomainLocalModuleData *data), (moduleAddr, data))
+    DAC_FORWARD(GetThreadLocalModuleData, (CLRDATA_ADDRESS thread, unsigned int index, struct DacpThreadLocalModuleData *data), (thread, index, data))
+    DAC_FORWARD(GetSyncBlockData, (unsigned int number, struct DacpSyncBlockData *data), (number, data))
+    DAC_FORWARD(GetSyncBlockCleanupData, (CLRDATA_ADDRESS addr, struct DacpSyncBlockCleanupData *data), (addr, data))
+    DAC_FORWARD(GetHandleEnum, (ISOSHandleEnum **ppHandleEnum), (ppHandleEnum))
+    DAC_FORWARD(GetHandleEnumForTypes, (unsigned int types[], unsigned int count, ISOSHandleEnum **ppHandleEnum), (types, count, ppHandleEnum))
+    DAC_FORWARD(GetHandleEnumForGC, (unsigned int gen, ISOSHandleEnum **ppHandleEnum), (gen, ppHandleEnum))
+    DAC_FORWARD(TraverseEHInfo, (CLRDATA_ADDRESS ip, DUMPEHINFO pCallback, LPVOID token), (ip, pCallback, token))
+    DAC_FORWARD(GetNestedExceptionData, (CLRDATA_ADDRESS exception, CLRDATA_ADDRESS *exceptionObject, CLRDATA_ADDRESS *nextNestedException), (exception, exceptionObject, nextNestedException))
+    DAC_FORWARD(GetStressLogAddress, (CLRDATA_ADDRESS *stressLog), (stressLog))
+    DAC_FORWARD(TraverseLoaderHeap, (CLRDATA_ADDRESS loaderHeapAddr, VISITHEAP pCallback), (loaderHeapAddr, pCallback))
+    DAC_FORWARD(GetCodeHeapList, (CLRDATA_ADDRESS jitManager, unsigned int count, struct DacpJitCodeHeapInfo *codeHeaps, unsigned int *pNeeded), (jitManager, count, codeHeaps, pNeeded))
+    DAC_FORWARD(TraverseVirtCallStubHeap, (CLRDATA_ADDRESS pAppDomain, VCSHeapType heaptype, VISITHEAP pCallback), (pAppDomain, heaptype, pCallback))
+    DAC_FORWARD(GetUsefulGlobals, (struct DacpUsefulGlobalsData *data), (data))
+    DAC_FORWARD(GetClrWatsonBuckets, (CLRDATA_ADDRESS thread, void *pGenericModeBlock), (thread, pGenericModeBlock))
+    DAC_FORWARD(GetTLSIndex, (ULONG *pIndex), (pIndex))
+    DAC_FORWARD(GetDacModuleHandle, (HMODULE *phModule), (phModule))
+    DAC_FORWARD(GetRCWData, (CLRDATA_ADDRESS addr, struct DacpRCWData *data), (addr, data))
+    DAC_FORWARD(GetRCWInterfaces, (CLRDATA_ADDRESS rcw, unsigned int count, struct DacpCOMInterfacePointerData *interfaces, unsigned int *pNeeded), (rcw, count, interfaces, pNeeded))
+    DAC_FORWARD(GetCCWData, (CLRDATA_ADDRESS ccw, struct DacpCCWData *data), (ccw, data))
+    DAC_FORWARD(GetCCWInterfaces, (CLRDATA_ADDRESS ccw, unsigned int count, struct DacpCOMInterfacePointerData *interfaces, unsigned int *pNeeded), (ccw, count, interfaces, pNeeded))
+    DAC_FORWARD(TraverseRCWCleanupList, (CLRDATA_ADDRESS cleanupListPtr, VISITRCWFORCLEANUP pCallback, LPVOID token), (cleanupListPtr, pCallback, token))
+    DAC_FORWARD(GetStackReferences, (DWORD osThreadID, ISOSStackRefEnum **ppEnum), (osThreadID, ppEnum))
+    DAC_FORWARD(GetRegisterName, (int regName, unsigned int count, WCHAR *buffer, unsigned int *pNeeded), (regName, count, buffer, pNeeded))
+    DAC_FORWARD(GetThreadAllocData, (CLRDATA_ADDRESS thread, struct DacpAllocData *data), (thread, data))
+    DAC_FORWARD(GetHeapAllocData, (unsigned int count, struct DacpGenerationAllocData *data, unsigned int *pNeeded), (count, data, pNeeded))
+    DAC_FORWARD(GetFailedAssemblyList, (CLRDATA_ADDRESS appDomain, int count, CLRDATA_ADDRESS values[], unsigned int *pNeeded), (appDomain, count, values, pNeeded))
+    DAC_FORWARD(GetPrivateBinPaths, (CLRDATA_ADDRESS appDomain, int count, WCHAR *paths, unsigned int *pNeeded), (appDomain, count, paths, pNeeded))
+    DAC_FORWARD(GetAssemblyLocation, (CLRDATA_ADDRESS assembly, int count, WCHAR *location, unsigned int *pNeeded), (assembly, count, location, pNeeded))
+    DAC_FORWARD(GetAppDomainConfigFile, (CLRDATA_ADDRESS appDomain, int count, WCHAR *configFile, unsigned int *pNeeded), (appDomain, count, configFile, pNeeded))
+    DAC_FORWARD(GetApplicationBase, (CLRDATA_ADDRESS appDomain, int count, WCHAR *base, unsigned int *pNeeded), (appDomain, count, base, pNeeded))
+    DAC_FORWARD(GetFailedAssemblyData, (CLRDATA_ADDRESS assembly, unsigned int *pContext, HRESULT *pResult), (assembly, pContext, pResult))
+    DAC_FORWARD(GetFailedAssemblyLocation, (CLRDATA_ADDRESS assesmbly, unsigned int count, WCHAR *location, unsigned int *pNeeded), (assesmbly, count, location, pNeeded))
+    DAC_FORWARD(GetFailedAssemblyDisplayName, (CLRDATA_ADDRESS assembly, unsigned int count, WCHAR *name, unsigned int *pNeeded), (assembly, count, name, pNeeded))
+
+private:
+    ~SOSDacPerfProxy()
+    {
+        mReal->Release();
+    }
+
+    LONG mRefCount;
+    ISOSDacInterface *mReal;
+};
+
+#undef DAC_FORWARD
+
+} // namespace
+
+ISOSDacInterface *WrapSOSDacPerfProxy(ISOSDacInterface *real)
+{
+    ISOSDacInterface *proxy = new (std::nothrow) SOSDacPerfProxy(real);
+    return proxy != NULL ? proxy : real;
+}
+
+void DacPerfReport()
+{
+    // The read cache sits under most DAC requests, so its behavior belongs
+    // in this report: a low hit rate or an eviction count rivaling the fill
+    // count means the geometry (!sosperf -cachepages/-cachesize) is too
+    // small for the dump being examined.
+    ExtOut("Read cache: %d pages x %#x bytes; %I64u lookups, %I64u hits (%.1f%%), %I64u fills, %I64u evictions\n\n",
+           g_linearCachePageCount, g_linearCachePageSize,
+           g_readStats.PageReads, g_readStats.PageHits,
+           g_readStats.PageReads != 0 ? 100.0 * g_readStats.PageHits / g_readStats.PageReads : 0.0,
+           g_readStats.PageFills, g_readStats.PageEvictions);
+
+    if (g_dacStats == NULL || g_dacStats->empty())
+    {
+        ExtOut("No DAC requests recorded.  Enable the profiler with !sosperf -on.\n");
+        return;
+    }
+
+    ExtOut("%-38s %9s %10s %8s %8s %8s %8s %8s %8s\n",
+           "DAC request", "Calls", "Total(ms)",
+           "<10us", "<100us", "<1ms", "<10ms", "<100ms", ">=100ms");
+    for (std::map<std::string, DacRequestStats>::const_iterator it = g_dacStats->begin();
+         it != g_dacStats->end(); ++it)
+    {
+        const DacRequestStats &stats = it->second;
+        ExtOut("%-38s %9I64u %10.1f %8I64u %8I64u %8I64u %8I64u %8I64u %8I64u\n",
+               it->first.c_str(), stats.Calls, stats.TotalMicros / 1000.0,
+               stats.Buckets[0], stats.Buckets[1], stats.Buckets[2],
+               stats.Buckets[3], stats.Buckets[4], stats.Buckets[5]);
+    }
+}
+
+void DacPerfReset()
+{
+    if (g_dacStats != NULL)
+        g_dacStats->clear();
+}
@@ -148,7 +148,10 @@ DataTarget::ReadVirtual(
         }
     }
 #endif
-    return g_ExtData->ReadVirtual(address, (PVOID)buffer, request, (PULONG)done);
+    // Go through the page cache shared with the SOS-side read paths, so the
+    // DAC's field-by-field reads and SOS's own reads of the same pages only
+    // hit the debugger once.
+    return CachedReadVirtual(address, (PVOID)buffer, request, (PULONG)done);
 }
 
 HRESULT STDMETHODCALLTYPE
@@ -162,6 +165,10 @@ DataTarget::WriteVirtual(
     {
         return E_UNEXPECTED;
     }
+
+    // Writes make cached pages stale.
+    InvalidateCachedReadVirtual();
+
     return g_ExtData->WriteVirtual(address, (PVOID)buffer, request, (PULONG)done);
 }
 
@@ -303,13 +310,12 @@ DataTarget::GetMetadata(
     BYTE* buffer,
     /* [out] */ ULONG32* dataSize)
 {
-    HRESULT hr = InitializeHosting();
+    HRESULT hr = GetHostingDelegate(MetadataHelperClassName, "GetMetadataLocator", (void **)&g_SOSNetCoreCallbacks.GetMetadataLocatorDelegate);
     if (FAILED(hr))
     {
         return hr;
     }
     InitializeSymbolStore();
-    _ASSERTE(g_SOSNetCoreCallbacks.GetMetadataLocatorDelegate != nullptr);
     return g_SOSNetCoreCallbacks.GetMetadataLocatorDelegate(imagePath, imageTimestamp, imageSize, mvid, mdRva, flags, bufferSize, buffer, dataSize);
 }
 
@@ -64,10 +64,120 @@ namespace X86GCDump
 
 #include "disasm.h"
 
+#ifdef SOS_TARGET_AMD64
+// Timing hook for !gcinfobench; it lives here because this is the only
+// translation unit that instantiates the AMD64 decoder.  The variants mirror
+// the flag combinations real callers use: header queries, the
+// EnumerateLiveSlots preparation with its safe-point lookup, and the
+// DECODE_SLOTS_ONLY fast path that skips that lookup.
+ULONG64 GCInfoDecodeBench(GCInfoToken gcInfoToken, GCInfoBenchVariant variant)
+{
+    unsigned flags = DECODE_CODE_LENGTH;
+    switch (variant)
+    {
+        case GCInfoBench_Header:
+            flags |= DECODE_RETURN_KIND | DECODE_VARARG | DECODE_GENERICS_INST_CONTEXT
+                   | DECODE_GS_COOKIE | DECODE_PSP_SYM | DECODE_SECURITY_OBJECT;
+            break;
+        case GCInfoBench_Lifetimes:
+            flags |= DECODE_GC_LIFETIMES | DECODE_NO_VALIDATION;
+            break;
+        case GCInfoBench_SlotsOnly:
+            flags |= DECODE_GC_LIFETIMES | DECODE_NO_VALIDATION | DECODE_SLOTS_ONLY;
+            break;
+    }
+
+    GcInfoDecoder decoder(gcInfoToken, (GcInfoDecoderFlags)flags, 0);
+    return decoder.GetCodeLength();
+}
+#endif // SOS_TARGET_AMD64
+
+#include <string>
+
 #ifndef ERANGE
 #define ERANGE 34
 #endif
 
+// Session memo of resolved call targets, shared by the per-arch disassembly
+// walkers.  A large jitted method calls the same helpers and methods from
+// many sites, and without the memo every occurrence re-runs the callee-site
+// reads, the MethodDesc search and the engine symbol lookup.  Jitted code
+// can appear or unload whenever a live target runs, so the memo is dropped
+// with the other session caches at those points.
+static std::unordered_map<DWORD_PTR, DWORD_PTR> *g_pCalleeMDMemo = NULL;
+static std::unordered_map<DWORD_PTR, std::string> *g_pCalleeSymbolMemo = NULL;
+
+BOOL TryGetMemoizedCalleeMD(DWORD_PTR callee, DWORD_PTR *pMethodDesc)
+{
+    if (g_pCalleeMDMemo != NULL)
+    {
+        std::unordered_map<DWORD_PTR, DWORD_PTR>::const_iterator itr = g_pCalleeMDMemo->find(callee);
+        if (itr != g_pCalleeMDMemo->end())
+        {
+            *pMethodDesc = itr->second;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+void MemoizeCalleeMD(DWORD_PTR callee, DWORD_PTR methodDesc)
+{
+    // The memo is best effort: on allocation failure the lookup simply runs
+    // again next time.
+    if (g_pCalleeMDMemo == NULL)
+    {
+        g_pCalleeMDMemo = new std::unordered_map<DWORD_PTR, DWORD_PTR>();
+        if (g_pCalleeMDMemo == NULL)
+            return;
+    }
+
+    (*g_pCalleeMDMemo)[callee] = methodDesc;
+}
+
+BOOL TryGetMemoizedCalleeSymbol(DWORD_PTR callee, const char **ppSymbol)
+{
+    if (g_pCalleeSymbolMemo != NULL)
+    {
+        std::unordered_map<DWORD_PTR, std::string>::const_iterator itr = g_pCalleeSymbolMemo->find(callee);
+        if (itr != g_pCalleeSymbolMemo->end())
+        {
+            *ppSymbol = itr->second.c_str();
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+void MemoizeCalleeSymbol(DWORD_PTR callee, const char *pSymbol)
+{
+    if (g_pCalleeSymbolMemo == NULL)
+    {
+        g_pCalleeSymbolMemo = new std::unordered_map<DWORD_PTR, std::string>();
+        if (g_pCalleeSymbolMemo == NULL)
+            return;
+    }
+
+    (*g_pCalleeSymbolMemo)[callee] = pSymbol;
+}
+
+void ClearCallTargetMemo()
+{
+    if (g_pCalleeMDMemo != NULL)
+    {
+        delete g_pCalleeMDMemo;
+        g_pCalleeMDMemo = NULL;
+    }
+
+    if (g_pCalleeSymbolMemo != NULL)
+    {
+        delete g_pCalleeSymbolMemo;
+        g_pCalleeSymbolMemo = NULL;
+    }
+}
+
 PVOID
 GenOpenMapping(
     PCSTR FilePath,
@@ -990,7 +1100,13 @@ void DumpStackWorker (DumpStackFlag &DSFlag)
 
     // make certain dword/qword aligned
     DWORD_PTR ptr = DSFlag.top & (~ALIGNCONST);
-    
+
+    // Snapshot the stack range up front instead of reading it back one slot
+    // at a time; if the bulk read fails fall back to the per-slot reads.
+    const DWORD_PTR base = ptr;
+    size_t slotCount = 0;
+    ArrayHolder<DWORD_PTR> slots = ReadStackSlots(base, DSFlag.end, &slotCount);
+
     ExtOut (g_targetMachine->GetDumpStackHeading());
     while (ptr < DSFlag.end)
     {
@@ -998,7 +1114,11 @@ void DumpStackWorker (DumpStackFlag &DSFlag)
             return;
         DWORD_PTR retAddr;
         DWORD_PTR whereCalled;
-        move_xp(retAddr, ptr);
+        size_t slot = (ptr - base) / sizeof(DWORD_PTR);
+        if (slots != NULL && slot < slotCount)
+            retAddr = slots[slot];
+        else
+            move_xp(retAddr, ptr);
         g_targetMachine->IsReturnAddress(retAddr, &whereCalled);
         if (whereCalled)
         {
@@ -86,6 +86,16 @@ BOOL IsTermSep (char ch);
 
 const char * HelperFuncName (size_t IP);
 
+// Session memo of resolved call targets shared by the per-arch walkers: a
+// callee address maps to its MethodDesc (0 when the target is not managed
+// code) and, separately, to the engine symbol text looked up for unmanaged
+// targets.  ClearCallTargetMemo (declared in util.h with the other session
+// caches) drops both whenever the target may have run.
+BOOL TryGetMemoizedCalleeMD(DWORD_PTR callee, DWORD_PTR *pMethodDesc);
+void MemoizeCalleeMD(DWORD_PTR callee, DWORD_PTR methodDesc);
+BOOL TryGetMemoizedCalleeSymbol(DWORD_PTR callee, const char **ppSymbol);
+void MemoizeCalleeSymbol(DWORD_PTR callee, __in_z const char *pSymbol);
+
 enum eTargetType { ettUnk = 0, ettNative = 1, ettJitHelp = 2, ettStub = 3, ettMD = 4 };
 
 // GetFinalTarget is based on HandleCall, but avoids printing anything to the output.
@@ -370,6 +380,22 @@ private:
 }; // class ARM64Machine
 
 #endif // SOS_TARGET_ARM64
+
+#ifdef SOS_TARGET_AMD64
+// Timing hook for !gcinfobench.  The GcInfoDecoderFlags combinations live in
+// disasm.cpp next to the AMD64 decoder instantiation (strike.cpp cannot see
+// gcinfodecoder.h), so callers pick a named variant instead.
+enum GCInfoBenchVariant
+{
+    GCInfoBench_Header,     // the header items (code length, return kind, ...)
+    GCInfoBench_Lifetimes,  // DECODE_GC_LIFETIMES including the safe-point lookup
+    GCInfoBench_SlotsOnly,  // DECODE_GC_LIFETIMES | DECODE_SLOTS_ONLY fast path
+};
+
+// Decodes the blob with the variant's flag combination and returns the code
+// length, which keeps the construction observable.
+ULONG64 GCInfoDecodeBench(GCInfoToken gcInfoToken, GCInfoBenchVariant variant);
+#endif // SOS_TARGET_AMD64
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif // _MSC_VER
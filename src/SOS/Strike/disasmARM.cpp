@@ -252,7 +252,8 @@ void ARMMachine::IsReturnAddress(TADDR retAddr, TADDR* whereCalled) const
 }
 
 
-// Return 0 for non-managed call.  Otherwise return MD address.
+// Return 0 for non-managed call.  Otherwise return MD address.  Results are
+// memoized by callee address for the session, as on x86/AMD64.
 static TADDR MDForCall (TADDR callee)
 {
     // call managed code?
@@ -261,11 +262,17 @@ static TADDR MDForCall (TADDR callee)
     TADDR PC = callee;
     TADDR gcinfoAddr;
 
+    if (TryGetMemoizedCalleeMD(callee, &methodDesc))
+        return methodDesc;
+
+    methodDesc = 0;
     PC = GetRealCallTarget(callee);
-    if (!PC)
-        return 0;
+    if (PC)
+    {
+        IP2MethodDesc (PC, methodDesc, jitType, gcinfoAddr);
+    }
 
-    IP2MethodDesc (PC, methodDesc, jitType, gcinfoAddr);
+    MemoizeCalleeMD(callee, methodDesc);
     return methodDesc;
 }
 
@@ -280,37 +287,80 @@ static void HandleValue(TADDR value)
     value = value | 1;
 #endif //!FEATURE_PAL
 
-    // A MethodTable?
-    if (IsMethodTable(value))
-    {
-        NameForMT_s (value, g_mdName,mdNameLen);
-        ExtOut (" (MT: %S)", g_mdName);
-        return;
-    }
-    
-    // A Managed Object?
-    TADDR dwMTAddr;
-    move_xp (dwMTAddr, value);
-    if (IsStringObject(value))
+    // Classified before?  The same runtime addresses recur constantly across
+    // a method, and each probe costs a round of DAC requests otherwise.  An
+    // entry left by !dumpstackobjects carries a different validation level
+    // and name, so those fall through and the address is reclassified.
+    PointerKind kind;
+    const WCHAR *pCachedName;
+    BOOL reclassify = TRUE;
+    if (TryGetPointerClassification(value, &kind, &pCachedName))
     {
-        ExtOut (" (\"");
-        StringObjectContent (value, TRUE);
-        ExtOut ("\")");
-        return;
+        switch (kind)
+        {
+            case PK_MethodTable:
+                ExtOut (" (MT: %S)", pCachedName);
+                return;
+            case PK_StringObject:
+                // contents can change between stops; render them live
+                ExtOut (" (\"");
+                StringObjectContent (value, TRUE);
+                ExtOut ("\")");
+                return;
+            case PK_Object:
+                ExtOut (" (Object: %S)", pCachedName);
+                return;
+            case PK_MethodDesc:
+                ExtOut (" (MD: %S)", pCachedName);
+                return;
+            case PK_NotClassified:
+                reclassify = FALSE;
+                break;
+            default:
+                break;
+        }
     }
-    else if (IsMethodTable(dwMTAddr))
+
+    if (reclassify)
     {
-        NameForMT_s (dwMTAddr, g_mdName,mdNameLen);
-        ExtOut (" (Object: %S)", g_mdName);
-        return;
-    }
-    
-    // A MethodDesc?
-    if (IsMethodDesc(value))
-    {        
-        NameForMD_s (value, g_mdName,mdNameLen);
-        ExtOut (" (MD: %S)", g_mdName);
-        return;
+        // A MethodTable?
+        if (IsMethodTable(value))
+        {
+            NameForMT_s (value, g_mdName,mdNameLen);
+            CachePointerClassification(value, PK_MethodTable, g_mdName);
+            ExtOut (" (MT: %S)", g_mdName);
+            return;
+        }
+
+        // A Managed Object?
+        TADDR dwMTAddr;
+        move_xp (dwMTAddr, value);
+        if (IsStringObject(value))
+        {
+            CachePointerClassification(value, PK_StringObject, NULL);
+            ExtOut (" (\"");
+            StringObjectContent (value, TRUE);
+            ExtOut ("\")");
+            return;
+        }
+        else if (IsMethodTable(dwMTAddr))
+        {
+            NameForMT_s (dwMTAddr, g_mdName,mdNameLen);
+            CachePointerClassification(value, PK_Object, g_mdName);
+            ExtOut (" (Object: %S)", g_mdName);
+            return;
+        }
+
+        // A MethodDesc?
+        if (IsMethodDesc(value))
+        {
+            NameForMD_s (value, g_mdName,mdNameLen);
+            CachePointerClassification(value, PK_MethodDesc, g_mdName);
+            ExtOut (" (MD: %S)", g_mdName);
+            return;
+        }
+
+        CachePointerClassification(value, PK_NotClassified, NULL);
     }
 
     // A JitHelper?
@@ -330,10 +380,21 @@ static void HandleValue(TADDR value)
     }
     
     // Random symbol.
+    const char *pMemoizedSymbol;
+    if (TryGetMemoizedCalleeSymbol(value, &pMemoizedSymbol))
+    {
+        if (pMemoizedSymbol[0] != '\0')
+        {
+            ExtOut (" (%s)", pMemoizedSymbol);
+        }
+        return;
+    }
+
     char Symbol[1024];
     if (SUCCEEDED(g_ExtSymbols->GetNameByOffset(TO_CDADDR(value), Symbol, 1024,
                                                 NULL, NULL)))
     {
+        MemoizeCalleeSymbol(value, Symbol);
         if (Symbol[0] != '\0')
         {
             ExtOut (" (%s)", Symbol);
@@ -85,37 +85,80 @@ void ARM64Machine::IsReturnAddress(TADDR retAddr, TADDR* whereCalled) const
 // Determine if a value is MT/MD/Obj
 static void HandleValue(TADDR value)
 {
-    // A MethodTable?
-    if (IsMethodTable(value))
+    // Classified before?  The same runtime addresses recur constantly across
+    // a method, and each probe costs a round of DAC requests otherwise.  An
+    // entry left by !dumpstackobjects carries a different validation level
+    // and name, so those fall through and the address is reclassified.
+    PointerKind kind;
+    const WCHAR *pCachedName;
+    BOOL reclassify = TRUE;
+    if (TryGetPointerClassification(value, &kind, &pCachedName))
     {
-        NameForMT_s (value, g_mdName,mdNameLen);
-        ExtOut (" (MT: %S)", g_mdName);
-        return;
-    }
-    
-    // A Managed Object?
-    TADDR dwMTAddr;
-    move_xp (dwMTAddr, value);
-    if (IsStringObject(value))
-    {
-        ExtOut (" (\"");
-        StringObjectContent (value, TRUE);
-        ExtOut ("\")");
-        return;
+        switch (kind)
+        {
+            case PK_MethodTable:
+                ExtOut (" (MT: %S)", pCachedName);
+                return;
+            case PK_StringObject:
+                // contents can change between stops; render them live
+                ExtOut (" (\"");
+                StringObjectContent (value, TRUE);
+                ExtOut ("\")");
+                return;
+            case PK_Object:
+                ExtOut (" (Object: %S)", pCachedName);
+                return;
+            case PK_MethodDesc:
+                ExtOut (" (MD: %S)", pCachedName);
+                return;
+            case PK_NotClassified:
+                reclassify = FALSE;
+                break;
+            default:
+                break;
+        }
     }
-    else if (IsMethodTable(dwMTAddr))
+
+    if (reclassify)
     {
-        NameForMT_s (dwMTAddr, g_mdName,mdNameLen);
-        ExtOut (" (Object: %S)", g_mdName);
-        return;
-    }
-    
-    // A MethodDesc?
-    if (IsMethodDesc(value))
-    {        
-        NameForMD_s (value, g_mdName,mdNameLen);
-        ExtOut (" (MD: %S)", g_mdName);
-        return;
+        // A MethodTable?
+        if (IsMethodTable(value))
+        {
+            NameForMT_s (value, g_mdName,mdNameLen);
+            CachePointerClassification(value, PK_MethodTable, g_mdName);
+            ExtOut (" (MT: %S)", g_mdName);
+            return;
+        }
+
+        // A Managed Object?
+        TADDR dwMTAddr;
+        move_xp (dwMTAddr, value);
+        if (IsStringObject(value))
+        {
+            CachePointerClassification(value, PK_StringObject, NULL);
+            ExtOut (" (\"");
+            StringObjectContent (value, TRUE);
+            ExtOut ("\")");
+            return;
+        }
+        else if (IsMethodTable(dwMTAddr))
+        {
+            NameForMT_s (dwMTAddr, g_mdName,mdNameLen);
+            CachePointerClassification(value, PK_Object, g_mdName);
+            ExtOut (" (Object: %S)", g_mdName);
+            return;
+        }
+
+        // A MethodDesc?
+        if (IsMethodDesc(value))
+        {
+            NameForMD_s (value, g_mdName,mdNameLen);
+            CachePointerClassification(value, PK_MethodDesc, g_mdName);
+            ExtOut (" (MD: %S)", g_mdName);
+            return;
+        }
+
+        CachePointerClassification(value, PK_NotClassified, NULL);
     }
 
     // A JitHelper?
@@ -127,19 +170,30 @@ static void HandleValue(TADDR value)
 
     // A call to managed code?
     // ARM64TODO: not (yet) implemented. perhaps we don't need it at all.
-    
+
     // Random symbol.
+    const char *pMemoizedSymbol;
+    if (TryGetMemoizedCalleeSymbol(value, &pMemoizedSymbol))
+    {
+        if (pMemoizedSymbol[0] != '\0')
+        {
+            ExtOut (" (%s)", pMemoizedSymbol);
+        }
+        return;
+    }
+
     char Symbol[1024];
     if (SUCCEEDED(g_ExtSymbols->GetNameByOffset(TO_CDADDR(value), Symbol, 1024,
                                                 NULL, NULL)))
     {
+        MemoizeCalleeSymbol(value, Symbol);
         if (Symbol[0] != '\0')
         {
             ExtOut (" (%s)", Symbol);
             return;
         }
     }
-    
+
 }
 
 /**********************************************************************\
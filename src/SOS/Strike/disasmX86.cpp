@@ -334,7 +334,7 @@ void DecodeAddressTerm (___in __in_z char *term, InstData& arg)
 }
 
 // Return 0 for non-managed call.  Otherwise return MD address.
-TADDR MDForCall (TADDR callee)
+static TADDR MDForCallWorker (TADDR callee)
 {
     // call managed code?
     JITTypes jitType;
@@ -372,6 +372,21 @@ TADDR MDForCall (TADDR callee)
     return 0;
 }
 
+// Return 0 for non-managed call.  Otherwise return MD address.  Resolution
+// depends only on the callee address, so results - including misses - are
+// memoized for the session: a large method calls the same targets from many
+// sites, and each lookup costs callee-site reads plus a MethodDesc search.
+TADDR MDForCall (TADDR callee)
+{
+    TADDR methodDesc;
+    if (TryGetMemoizedCalleeMD(callee, &methodDesc))
+        return methodDesc;
+
+    methodDesc = MDForCallWorker(callee);
+    MemoizeCalleeMD(callee, methodDesc);
+    return methodDesc;
+}
+
 // Handle a call instruction.
 void HandleCall(TADDR callee, Register *reg)
 {
@@ -434,10 +449,23 @@ void HandleCall(TADDR callee, Register *reg)
     }
 
     // call unmanaged code?
+    const char *pMemoizedSymbol;
+    if (TryGetMemoizedCalleeSymbol(callee, &pMemoizedSymbol))
+    {
+        if (pMemoizedSymbol[0] != '\0')
+        {
+            ExtOut (" (%s)", pMemoizedSymbol);
+        }
+        return;
+    }
+
     char Symbol[1024];
     if (SUCCEEDED(g_ExtSymbols->GetNameByOffset(TO_CDADDR(callee), Symbol, 1024,
                                                 NULL, NULL)))
     {
+        // An empty name is memoized too, so the engine is asked only once
+        // per address.
+        MemoizeCalleeSymbol(callee, Symbol);
         if (Symbol[0] != '\0')
         {
             ExtOut (" (%s)", Symbol);
@@ -449,40 +477,83 @@ void HandleCall(TADDR callee, Register *reg)
 // Determine if a value is MT/MD/Obj
 void HandleValue(TADDR value)
 {
-    // A MethodTable?
-    if (IsMethodTable(value))
-    {
-        NameForMT_s (value, g_mdName,mdNameLen);
-        ExtOut (" (MT: %S)", g_mdName);
-        return;
-    }
-    
-    // A Managed Object?
-    TADDR dwMTAddr;
-    move_xp (dwMTAddr, value);
-    if (IsStringObject(value))
+    // Classified before?  The same runtime addresses recur constantly across
+    // a method, and each probe costs a round of DAC requests otherwise.  An
+    // entry left by !dumpstackobjects carries a different validation level
+    // and name, so those fall through and the address is reclassified.
+    PointerKind kind;
+    const WCHAR *pCachedName;
+    BOOL reclassify = TRUE;
+    if (TryGetPointerClassification(value, &kind, &pCachedName))
     {
-        ExtOut (" (\"");
-        StringObjectContent (value, TRUE);
-        ExtOut ("\")");
-        return;
+        switch (kind)
+        {
+            case PK_MethodTable:
+                ExtOut (" (MT: %S)", pCachedName);
+                return;
+            case PK_StringObject:
+                // contents can change between stops; render them live
+                ExtOut (" (\"");
+                StringObjectContent (value, TRUE);
+                ExtOut ("\")");
+                return;
+            case PK_Object:
+                ExtOut (" (Object: %S)", pCachedName);
+                return;
+            case PK_MethodDesc:
+                ExtOut (" (MD: %S)", pCachedName);
+                return;
+            case PK_NotClassified:
+                reclassify = FALSE;
+                break;
+            default:
+                break;
+        }
     }
-    else if (IsMethodTable(dwMTAddr))
+
+    if (reclassify)
     {
-        NameForMT_s (dwMTAddr, g_mdName,mdNameLen);
-        ExtOut (" (Object: %S)", g_mdName);
-        return;
-    }
-    
-    // A MethodDesc?
-    if (IsMethodDesc(value))
-    {        
-        NameForMD_s (value, g_mdName,mdNameLen);
-        ExtOut (" (MD: %S)", g_mdName);
-        return;
+        // A MethodTable?
+        if (IsMethodTable(value))
+        {
+            NameForMT_s (value, g_mdName,mdNameLen);
+            CachePointerClassification(value, PK_MethodTable, g_mdName);
+            ExtOut (" (MT: %S)", g_mdName);
+            return;
+        }
+
+        // A Managed Object?
+        TADDR dwMTAddr;
+        move_xp (dwMTAddr, value);
+        if (IsStringObject(value))
+        {
+            CachePointerClassification(value, PK_StringObject, NULL);
+            ExtOut (" (\"");
+            StringObjectContent (value, TRUE);
+            ExtOut ("\")");
+            return;
+        }
+        else if (IsMethodTable(dwMTAddr))
+        {
+            NameForMT_s (dwMTAddr, g_mdName,mdNameLen);
+            CachePointerClassification(value, PK_Object, g_mdName);
+            ExtOut (" (Object: %S)", g_mdName);
+            return;
+        }
+
+        // A MethodDesc?
+        if (IsMethodDesc(value))
+        {
+            NameForMD_s (value, g_mdName,mdNameLen);
+            CachePointerClassification(value, PK_MethodDesc, g_mdName);
+            ExtOut (" (MD: %S)", g_mdName);
+            return;
+        }
+
+        CachePointerClassification(value, PK_NotClassified, NULL);
     }
 
-    // A JitHelper?
+    // A JitHelper?  A plain table lookup, not worth caching.
     const char* name = HelperFuncName(value);
     if (name) {
         ExtOut (" (JitHelp: %s)", name);
@@ -8,8 +8,12 @@
 // 
 // ==--==
 #include <assert.h>
+#include <algorithm>
+#include <map>
 #include "sos.h"
 #include "safemath.h"
+#include "radixsort.h"
+#include "scankernels.h"
 
 
 // This is the increment for the segment lookup data
@@ -25,112 +29,55 @@ const int nSegLookupStgIncrement = 100;
 \**********************************************************************/
 void HeapStat::Add(DWORD_PTR aData, DWORD aSize)
 {
-    if (head == 0)
-    {
-        head = new Node();
-        if (head == NULL)
-        {
-            ReportOOM();
-            ControlC = TRUE;
-            return;
-        }
-        
-        if (bHasStrings)
-        {
-            size_t capacity_pNew = _wcslen((WCHAR*)aData) + 1;
-            WCHAR *pNew = new WCHAR[capacity_pNew];
-            if (pNew == NULL)
-            {
-               ReportOOM();               
-               ControlC = TRUE;
-               return;
-            }
-            wcscpy_s(pNew, capacity_pNew, (WCHAR*)aData);
-            aData = (DWORD_PTR)pNew;            
-        }
+    Add(aData, (size_t)aSize, 1);
+}
 
-        head->data = aData;
-    }
-    Node *walk = head;
-    int cmp = 0;
+// Adds a pre-aggregated entry (aCount instances totalling aTotalSize bytes).
+void HeapStat::Add(DWORD_PTR aData, size_t aTotalSize, DWORD aCount)
+{
+    Entry *entry = FindOrAdd(aData);
+    if (entry == NULL)
+        return;
 
-    for (;;)
-    {
-        if (IsInterrupt())
-            return;
-        
-        cmp = CompareData(aData, walk->data);            
+    entry->count += aCount;
+    entry->totalSize += aTotalSize;
+}
 
-        if (cmp == 0)
-            break;
-        
-        if (cmp < 0)
-        {
-            if (walk->left == NULL)
-                break;
-            walk = walk->left;
-        }
-        else
-        {
-            if (walk->right == NULL)
-                break;
-            walk = walk->right;
-        }
-    }
+// Folds another statistics table into this one by key union.  The other
+// table's entries arrive in its insertion order; callers which need a
+// deterministic order across runs should sort what they feed in (see
+// ParallelHeapWalker::AddStatsTo).
+void HeapStat::Merge(const HeapStat &other)
+{
+    // Interned string keys hash and compare as strings; adopting the flag
+    // before the adds keeps a merge into an empty table consistent.  Mixing
+    // string and address keys is a caller error.
+    bHasStrings |= other.bHasStrings;
+    bFailed |= other.bFailed;
 
-    if (cmp == 0)
-    {
-        walk->count ++;
-        walk->totalSize += aSize;
-    }
-    else
+    for (size_t i = 0; i < other.mCount; i++)
     {
-        Node *node = new Node();
-        if (node == NULL)
-        {
-            ReportOOM();                
-            ControlC = TRUE;
-            return;
-        }
-
-        if (bHasStrings)
-        {
-            size_t capacity_pNew = _wcslen((WCHAR*)aData) + 1;
-            WCHAR *pNew = new WCHAR[capacity_pNew];
-            if (pNew == NULL)
-            {
-               ReportOOM();
-               ControlC = TRUE;
-               return;
-            }
-            wcscpy_s(pNew, capacity_pNew, (WCHAR*)aData);
-            aData = (DWORD_PTR)pNew;            
-        }
-        
-        node->data = aData;       
-        node->totalSize = aSize;
-        node->count ++;
-
-        if (cmp < 0)
-        {
-            walk->left = node;
-        }
-        else
-        {
-            walk->right = node;
-        }
+        const Entry *entry = other.GetEntry(i);
+        Add(entry->data, entry->totalSize, entry->count);
     }
 }
+
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
-*    This function compares two nodes in the tree.     *  
+*    This function compares two keys in the hash table.                *
 *                                                                      *
 \**********************************************************************/
 int HeapStat::CompareData(DWORD_PTR d1, DWORD_PTR d2)
 {
     if (bHasStrings)
+    {
+        // Stored names are interned, so a repeat lookup through the same
+        // pooled pointer settles on the first comparison.
+        if (d1 == d2)
+            return 0;
         return _wcscmp((WCHAR*)d1, (WCHAR*)d2);
+    }
 
     if (d1 > d2)
         return 1;
@@ -141,123 +88,227 @@ int HeapStat::CompareData(DWORD_PTR d1, DWORD_PTR d2)
     return 0;   
 }
 
-/**********************************************************************\
-* Routine Description:                                                 *
-*                                                                      *
-*    This function is called to sort all entries in the heap stat.     *  
-*                                                                      *
-\**********************************************************************/
-void HeapStat::Sort ()
+size_t HeapStat::HashData(DWORD_PTR aData)
+{
+    if (bHasStrings)
+    {
+        // Bulk FNV over the string payload (see scankernels.h); long string
+        // bodies dominate the -strings hashing otherwise.
+        const WCHAR *str = (const WCHAR*)aData;
+        return (size_t)ScanHashBytes(str, _wcslen(str) * sizeof(WCHAR));
+    }
+
+    // MethodTable addresses are pointer aligned; shift out the always-zero
+    // bits before mixing so consecutive tables land in different buckets.
+    size_t hash = (size_t)aData >> 3;
+    hash *= 2654435761u;
+    return hash ^ (hash >> 16);
+}
+
+HeapStat::Entry *HeapStat::FindOrAdd(DWORD_PTR aData)
 {
-    Node *root = head;
-    head = NULL;
-    ReverseLeftMost (root);
+    if (mBuckets.empty())
+        mBuckets.resize(kInitialBuckets, 0);
+
+    size_t mask = mBuckets.size() - 1;
+    size_t bucket = HashData(aData) & mask;
+
+    for (;;)
+    {
+        size_t biased = mBuckets[bucket];
+        if (biased == 0)
+            break;
+
+        Entry *entry = GetEntry(biased - 1);
+        if (CompareData(aData, entry->data) == 0)
+            return entry;
 
-    Node *sortRoot = NULL;
-    while (head)
+        bucket = (bucket + 1) & mask;
+    }
+
+    // Keep the load factor below 3/4 so probe sequences stay short.
+    if (mCount + 1 > mBuckets.size() - (mBuckets.size() >> 2))
     {
-        Node *tmp = head;
-        head = head->left;
-        if (tmp->right)
-            ReverseLeftMost (tmp->right);
-        // add tmp
-        tmp->right = NULL;
-        tmp->left = NULL;
-        SortAdd (sortRoot, tmp);
+        Grow();
+
+        // The rehash moved everything, find the insertion slot again.
+        mask = mBuckets.size() - 1;
+        bucket = HashData(aData) & mask;
+        while (mBuckets[bucket] != 0)
+            bucket = (bucket + 1) & mask;
     }
-    head = sortRoot;
 
-    Linearize();
+    // Allocate the entry, starting a new chunk if the last one is full.
+    if (mCount % kEntriesPerChunk == 0)
+    {
+        Entry *chunk = new Entry[kEntriesPerChunk];
+        if (chunk == NULL)
+        {
+            // A pool worker cannot report: it must not touch the output
+            // interfaces, so it records the failure for the main thread to
+            // act on after the join.
+            if (bWorkerMode)
+            {
+                bFailed = TRUE;
+                return NULL;
+            }
+
+            ReportOOM();
+            ControlC = TRUE;
+            return NULL;
+        }
+        mChunks.push_back(chunk);
+        SOSMemAdd(SOSMemHeapStat, sizeof(Entry) * kEntriesPerChunk);
+    }
 
-    //reverse the order
-    root = head;
-    head = NULL;
-    sortRoot = NULL;
-    while (root)
+    if (bHasStrings)
     {
-        Node *tmp = root->right;
-        root->left = NULL;
-        root->right = NULL;
-        LinearAdd (sortRoot, root);
-        root = tmp;
+        // The pool owns the storage; entries of every statistics table
+        // with the same name share one copy.
+        aData = (DWORD_PTR)InternString((WCHAR*)aData);
     }
-    head = sortRoot;
+
+    Entry *entry = GetEntry(mCount);
+    entry->data = aData;
+    entry->count = 0;
+    entry->totalSize = 0;
+
+    mBuckets[bucket] = ++mCount;    // biased by one
+    return entry;
 }
 
-void HeapStat::Linearize()
+void HeapStat::Grow()
 {
-    // Change binary tree to a linear tree
-    Node *root = head;
-    head = NULL;
-    ReverseLeftMost (root);
-    Node *sortRoot = NULL;
-    while (head)
+    std::vector<size_t> old;
+    old.swap(mBuckets);
+
+    mBuckets.resize(old.size() * 2, 0);
+
+    size_t mask = mBuckets.size() - 1;
+    for (size_t i = 0; i < old.size(); i++)
     {
-        Node *tmp = head;
-        head = head->left;
-        if (tmp->right)
-            ReverseLeftMost (tmp->right);
-        // add tmp
-        tmp->right = NULL;
-        tmp->left = NULL;
-        LinearAdd (sortRoot, tmp);
+        size_t biased = old[i];
+        if (biased == 0)
+            continue;
+
+        size_t bucket = HashData(GetEntry(biased - 1)->data) & mask;
+        while (mBuckets[bucket] != 0)
+            bucket = (bucket + 1) & mask;
+
+        mBuckets[bucket] = biased;
     }
-    head = sortRoot;
-    fLinear = TRUE;
 }
 
-void HeapStat::ReverseLeftMost (Node *root)
+bool HeapStat::AscendingSize(const Entry *e1, const Entry *e2)
 {
-    while (root)
-    {
-        Node *tmp = root->left;
-        root->left = head;
-        head = root;
-        root = tmp;
-    }
+    return e1->totalSize < e2->totalSize;
+}
+
+bool HeapStat::DescendingSize(const Entry *e1, const Entry *e2)
+{
+    return e1->totalSize > e2->totalSize;
 }
 
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
-*    This function is called to help to sort heap stat.                *  
+*    This function is called to sort all entries in the heap stat.     *  
 *                                                                      *
 \**********************************************************************/
-void HeapStat::SortAdd (Node *&root, Node *entry)
+void HeapStat::Sort ()
 {
-    if (root == NULL)
+    mSorted.clear();
+    mSorted.reserve(mCount);
+    for (size_t i = 0; i < mCount; i++)
+        mSorted.push_back(GetEntry(i));
+
+    // Ascending by total size; equal sizes keep insertion order (the radix
+    // sort is stable).
+    RadixSortByKey(mSorted, [](const Entry *entry) { return (ULONG64)entry->totalSize; });
+}
+
+void HeapStat::SortTopK(size_t k)
+{
+    mSorted.clear();
+
+    if (k == 0 || mCount == 0)
+        return;
+
+    if (k >= mCount)
     {
-        root = entry;
+        Sort();
+        return;
     }
-    else
+
+    // Maintain a bounded min-heap of the k largest entries seen so far: with
+    // the descending comparator the heap front is the smallest candidate, and
+    // it is evicted whenever a larger entry streams by.
+    mSorted.reserve(k);
+    for (size_t i = 0; i < mCount; i++)
     {
-        Node *parent = root;
-        Node *ptr = root;
-        while (ptr)
+        Entry *entry = GetEntry(i);
+        if (mSorted.size() < k)
         {
-            parent = ptr;
-            if (ptr->totalSize < entry->totalSize)
-                ptr = ptr->right;
-            else
-                ptr = ptr->left;
+            mSorted.push_back(entry);
+            std::push_heap(mSorted.begin(), mSorted.end(), DescendingSize);
+        }
+        else if (mSorted.front()->totalSize < entry->totalSize)
+        {
+            std::pop_heap(mSorted.begin(), mSorted.end(), DescendingSize);
+            mSorted.back() = entry;
+            std::push_heap(mSorted.begin(), mSorted.end(), DescendingSize);
         }
-        if (parent->totalSize < entry->totalSize)
-            parent->right = entry;
-        else
-            parent->left = entry;
     }
+
+    // Ascending by total size, matching Sort, so the largest types print last.
+    std::stable_sort(mSorted.begin(), mSorted.end(), AscendingSize);
 }
 
-void HeapStat::LinearAdd(Node *&root, Node *entry)
+void HeapStat::SortTiesByName()
 {
-    if (root == NULL)
-    {
-        root = entry;
-    }
-    else
-    {
-        entry->right = root;
-        root = entry;
+    // Runs of equal total size are reordered by display name so the grouping
+    // is stable across dumps of the same process.  Names are resolved only
+    // here -- for the rows about to print -- through the interned-name cache,
+    // so a million-type table pays name resolution for exactly the ties it
+    // shows.
+    size_t i = 0;
+    while (i < mSorted.size())
+    {
+        size_t j = i + 1;
+        while (j < mSorted.size() && mSorted[j]->totalSize == mSorted[i]->totalSize)
+            j++;
+
+        if (j - i > 1)
+        {
+            std::vector<std::pair<const WCHAR*, Entry*> > run;
+            run.reserve(j - i);
+            for (size_t n = i; n < j; n++)
+            {
+                Entry *entry = mSorted[n];
+                const WCHAR *name;
+                if (bHasStrings)
+                    name = (const WCHAR*)entry->data;
+                else if (IsMTForFreeObj(entry->data))
+                    name = W("Free");
+                else
+                    name = GetInternedMethodTableName(TO_TADDR(entry->data));
+
+                if (name == NULL)
+                    name = W("UNKNOWN");
+                run.push_back(std::pair<const WCHAR*, Entry*>(name, entry));
+            }
+
+            std::stable_sort(run.begin(), run.end(),
+                [](const std::pair<const WCHAR*, Entry*> &p1, const std::pair<const WCHAR*, Entry*> &p2)
+                {
+                    return _wcscmp(p1.first, p2.first) < 0;
+                });
+
+            for (size_t n = i; n < j; n++)
+                mSorted[n] = run[n - i].second;
+        }
+
+        i = j;
     }
 }
 
@@ -279,62 +330,68 @@ void HeapStat::Print(const char* label /* = NULL */)
     else
         ExtOut("%" POINTERSIZE "s %8s %12s %s\n","MT", "Count", "TotalSize", "Class Name");
 
-    Node *root = head;
+    // The total below covers every entry, even when SortTopK selected only a
+    // subset for printing.
     int ncount = 0;
-    while (root)
+    for (size_t i = 0; i < mCount; i++)
+        ncount += GetEntry(i)->count;
+
+    // Print the sorted entries if Sort or SortTopK was called, the insertion
+    // order otherwise.
+    if (mSorted.size() != 0)
+        SortTiesByName();
+    size_t nprint = mSorted.size() != 0 ? mSorted.size() : mCount;
+    for (size_t i = 0; i < nprint; i++)
     {
         if (IsInterrupt())
             return;
-        
-        ncount += root->count;
+
+        Entry *entry = mSorted.size() != 0 ? mSorted[i] : GetEntry(i);
 
         if (bHasStrings)
         {
-            ExtOut("%8d %12I64u \"%S\"\n", root->count, (unsigned __int64)root->totalSize, root->data);
+            // Narrow the name here rather than letting %S do it per call;
+            // -stat prints thousands of these lines and the arena-backed
+            // conversion is the cheaper path for the typical ASCII name.
+            ExtOut("%8d %12I64u \"%s\"\n", entry->count, (unsigned __int64)entry->totalSize,
+                   WideToNarrowArena((const WCHAR *)entry->data));
         }
         else
         {
-            DMLOut("%s %8d %12I64u ", DMLDumpHeapMT(root->data), root->count, (unsigned __int64)root->totalSize);
-            if (IsMTForFreeObj(root->data))
+            DMLOut("%s %8d %12I64u ", DMLDumpHeapMT(entry->data), entry->count, (unsigned __int64)entry->totalSize);
+            if (IsMTForFreeObj(entry->data))
             {
                 ExtOut("%9s\n", "Free");
             }
             else
             {
                 wcscpy_s(g_mdName, mdNameLen, W("UNKNOWN"));
-                NameForMT_s((DWORD_PTR) root->data, g_mdName, mdNameLen);
-                ExtOut("%S\n", g_mdName);
+                NameForMT_s((DWORD_PTR) entry->data, g_mdName, mdNameLen);
+                ExtOut("%s\n", WideToNarrowArena(g_mdName));
             }
         }
-        root = root->right;
-        
     }
+    if (nprint < mCount)
+        ExtOut("(showing the %d largest of %d types)\n", (int)nprint, (int)mCount);
     ExtOut ("Total %d objects\n", ncount);
 }
 
 void HeapStat::Delete()
 {
-    if (head == NULL)
-        return;
+    // String data is interned, so the pool owns it; only the entry
+    // storage belongs to the table.
 
-    // Ensure the data structure is already linearized.
-    if (!fLinear)
-        Linearize();
+    for (size_t i = 0; i < mChunks.size(); i++)
+        delete[] mChunks[i];
 
-    while (head)
-    {
-        // The list is linearized on such that the left node is always null.
-        Node *tmp = head;
-        head = head->right;
-
-        if (bHasStrings)
-            delete[] ((WCHAR*)tmp->data);
-        delete tmp;
-    }
+    SOSMemSub(SOSMemHeapStat, sizeof(Entry) * kEntriesPerChunk * mChunks.size());
+    mChunks.clear();
+    mBuckets.clear();
+    mSorted.clear();
+    mCount = 0;
 
     // return to default state
     bHasStrings = FALSE;
-    fLinear = FALSE;
 }
 
 // -----------------------------------------------------------------------
@@ -345,80 +402,119 @@ void HeapStat::Delete()
 //
 MethodTableInfo* MethodTableCache::Lookup (DWORD_PTR aData)
 {
-    Node** addHere = &head;
-    if (head != 0) {
-        Node *walk = head;
-        int cmp = 0;
+    // 0 marks an empty slot, so it cannot live in the table; hand back the
+    // dedicated record so a corrupt header still gets the usual
+    // "uninitialized entry" treatment from callers.
+    if (aData == 0)
+        return &mNullKeyInfo;
 
-        for (;;)
-        {
-            cmp = CompareData(aData, walk->data);            
+    MethodTableInfo* info = Find(aData);
+    if (info != NULL)
+        return info;
 
-            if (cmp == 0)
-                return &walk->info;
-            
-            if (cmp < 0)
-            {
-                if (walk->left == NULL) 
-                {
-                    addHere = &walk->left;
-                    break;
-                }
-                walk = walk->left;
-            }
-            else
-            {
-                if (walk->right == NULL)
-                {
-                    addHere = &walk->right;
-                    break;
-                }
-                walk = walk->right;
-            }
-        }
-    }
-    Node* newNode = new Node(aData);
-    if (newNode == NULL)
+    info = AllocInfo();
+    if (info == NULL)
     {
         ReportOOM();
         return NULL;
     }
-    *addHere = newNode;
-    return &newNode->info;
+
+    Insert(aData, info);
+    return info;
 }
 
-/**********************************************************************\
-* Routine Description:                                                 *
-*                                                                      *
-*    This function compares two nodes in the tree.     *  
-*                                                                      *
-\**********************************************************************/
-int MethodTableCache::CompareData(DWORD_PTR d1, DWORD_PTR d2)
+// Carves the next info record out of the chunk arena.  Records never move,
+// so the pointers Lookup hands out stay valid across growth and rehashing.
+MethodTableInfo* MethodTableCache::AllocInfo()
 {
-    if (d1 > d2)
-        return 1;
+    if (mChunks.empty() || mChunkUsed == kInfosPerChunk)
+    {
+        MethodTableInfo* chunk = new MethodTableInfo[kInfosPerChunk];
+        if (chunk == NULL)
+            return NULL;
+        mChunks.push_back(chunk);
+        mChunkUsed = 0;
+    }
 
-    if (d1 < d2)
-        return -1;
+    MethodTableInfo* info = &mChunks.back()[mChunkUsed++];
+    memset(info, 0, sizeof(MethodTableInfo));
+    return info;
+}
 
-    return 0;   
+void MethodTableCache::Insert(DWORD_PTR aData, MethodTableInfo* info)
+{
+    if (mSlots.empty() || (mCount + 1) * 3 > mSlots.size() * 2)
+        Grow();
+
+    Slot s;
+    s.data = aData;
+    s.info = info;
+
+    size_t mask = mSlots.size() - 1;
+    size_t i = HashKey(s.data) & mask;
+    size_t dist = 0;
+    for (;;)
+    {
+        if (mSlots[i].data == 0)
+        {
+            mSlots[i] = s;
+            mCount++;
+            return;
+        }
+
+        // Robin hood: displace an occupant closer to its home slot than we
+        // are to ours; it continues down the run in our place.  Recomputing
+        // the occupant's distance from its key keeps the slot at 16 bytes.
+        size_t occupantDist = (i + mSlots.size() - (HashKey(mSlots[i].data) & mask)) & mask;
+        if (occupantDist < dist)
+        {
+            Slot displaced = mSlots[i];
+            mSlots[i] = s;
+            s = displaced;
+            dist = occupantDist;
+        }
+
+        i = (i + 1) & mask;
+        dist++;
+    }
+}
+
+void MethodTableCache::Grow()
+{
+    std::vector<Slot> oldSlots;
+    oldSlots.swap(mSlots);
+
+    // Doubling keeps the load factor under 2/3, which keeps robin-hood
+    // probe runs short; value-initialized slots are the empty marker.
+    mSlots.resize(oldSlots.empty() ? kInitialSlots : oldSlots.size() * 2);
+    mCount = 0;
+
+    for (size_t i = 0; i < oldSlots.size(); i++)
+    {
+        if (oldSlots[i].data != 0)
+            Insert(oldSlots[i].data, oldSlots[i].info);
+    }
 }
 
-void MethodTableCache::ReverseLeftMost (Node *root)
+void MethodTableCache::Enumerate(void (*fn)(DWORD_PTR mt, const MethodTableInfo &info, void *state), void *state) const
 {
-    if (root)
+    for (size_t i = 0; i < mSlots.size(); i++)
     {
-        if (root->left) ReverseLeftMost(root->left);
-        if (root->right) ReverseLeftMost(root->right);
-        delete root;
+        if (mSlots[i].data != 0)
+            fn(mSlots[i].data, *mSlots[i].info, state);
     }
 }
 
 void MethodTableCache::Clear()
 {
-    Node *root = head;
-    head = NULL;
-    ReverseLeftMost (root);
+    for (size_t i = 0; i < mChunks.size(); i++)
+        delete [] mChunks[i];
+
+    mChunks.clear();
+    mSlots.clear();
+    mChunkUsed = 0;
+    mCount = 0;
+    mNullKeyInfo = MethodTableInfo();
 }
 
 MethodTableCache g_special_mtCache;
@@ -544,7 +640,122 @@ void GCHeapInfo(const DacpGcHeapDetails &heap, DWORD_PTR &total_size)
     GCPrintLargeHeapSegmentInfo(heap,total_size);
 }
 
-BOOL GCObjInGeneration(TADDR taddrObj, const DacpGcHeapDetails &heap, 
+/* Buckets every object on the GC heap by generation in a single walk, for
+ * !eeheap -gc -gen.  An object's generation follows from where it lives:
+ * large object segments hold generation 3, non-ephemeral small object
+ * segments hold generation 2, and within the ephemeral segment the
+ * generation_table allocation starts split the ranges — the same
+ * boundaries GCPrintGenerationInfo prints.  One pass replaces the
+ * per-generation !dumpheap runs otherwise needed for these numbers.
+ */
+void GCPrintGenerationSummary()
+{
+    try
+    {
+        sos::GCHeap gcheap;
+        if (!gcheap.AreGCStructuresValid())
+        {
+            ExtOut("No generation summary: the GC heap is not in a walkable state.\n");
+            return;
+        }
+
+        const int nGens = 4;    // gen0-2 plus the large object heap
+        int numHeaps = gcheap.GetNumHeaps();
+
+        std::vector<size_t> counts((size_t)numHeaps * nGens, 0);
+        std::vector<size_t> sizes((size_t)numHeaps * nGens, 0);
+
+        // The ephemeral segment range of each heap, so non-ephemeral gen2
+        // segments above the gen0/gen1 boundaries do not get misbucketed.
+        std::vector<TADDR> ephStart((size_t)numHeaps, 0);
+        std::vector<TADDR> ephEnd((size_t)numHeaps, 0);
+        for (int h = 0; h < numHeaps; h++)
+        {
+            const DacpGcHeapDetails &details = gcheap.GetHeapDetails(h);
+            DacpHeapSegmentData segment;
+            if (segment.Request(g_sos, details.generation_table[0].start_segment, details) == S_OK)
+            {
+                ephStart[h] = TO_TADDR(segment.mem);
+                ephEnd[h] = TO_TADDR(details.alloc_allocated);
+            }
+        }
+
+        for (sos::ObjectIterator itr = gcheap.WalkHeap(); itr; ++itr)
+        {
+            if (IsInterrupt())
+                return;
+
+            int heap = itr.GetCurrHeap();
+            int gen;
+            if (itr.IsCurrObjectOnLOH())
+            {
+                gen = 3;
+            }
+            else
+            {
+                gen = 2;
+                TADDR addr = itr->GetAddress();
+                if (addr >= ephStart[heap] && addr < ephEnd[heap])
+                {
+                    const DacpGcHeapDetails &details = gcheap.GetHeapDetails(heap);
+                    for (UINT n = 0; n < GetMaxGeneration(); n++)
+                    {
+                        if (addr >= TO_TADDR(details.generation_table[n].allocation_start))
+                        {
+                            gen = n;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            counts[(size_t)heap * nGens + gen]++;
+            sizes[(size_t)heap * nGens + gen] += itr->GetSize();
+        }
+
+        ExtOut("\nGeneration summary:\n");
+        ExtOut("%8s %12s %16s\n", "gen", "objects", "size");
+
+        size_t totalCounts[4] = {0, 0, 0, 0};
+        size_t totalSizes[4] = {0, 0, 0, 0};
+        for (int h = 0; h < numHeaps; h++)
+        {
+            if (numHeaps > 1)
+                ExtOut("Heap %d\n", h);
+
+            for (int gen = 0; gen < nGens; gen++)
+            {
+                size_t count = counts[(size_t)h * nGens + gen];
+                size_t size = sizes[(size_t)h * nGens + gen];
+                if (gen == nGens - 1)
+                    ExtOut("%8s %12" POINTERSIZE_TYPE "d %16" POINTERSIZE_TYPE "d\n", "loh", (ULONG_PTR)count, (ULONG_PTR)size);
+                else
+                    ExtOut("    gen%d %12" POINTERSIZE_TYPE "d %16" POINTERSIZE_TYPE "d\n", gen, (ULONG_PTR)count, (ULONG_PTR)size);
+
+                totalCounts[gen] += count;
+                totalSizes[gen] += size;
+            }
+        }
+
+        if (numHeaps > 1)
+        {
+            ExtOut("All heaps\n");
+            for (int gen = 0; gen < nGens; gen++)
+            {
+                if (gen == nGens - 1)
+                    ExtOut("%8s %12" POINTERSIZE_TYPE "d %16" POINTERSIZE_TYPE "d\n", "loh", (ULONG_PTR)totalCounts[gen], (ULONG_PTR)totalSizes[gen]);
+                else
+                    ExtOut("    gen%d %12" POINTERSIZE_TYPE "d %16" POINTERSIZE_TYPE "d\n", gen, (ULONG_PTR)totalCounts[gen], (ULONG_PTR)totalSizes[gen]);
+            }
+        }
+    }
+    catch (const sos::Exception &e)
+    {
+        ExtOut("%s\n", e.what());
+    }
+}
+
+BOOL GCObjInGeneration(TADDR taddrObj, const DacpGcHeapDetails &heap,
     const TADDR_SEGINFO& /*seg*/, int& gen, TADDR_RANGE& allocCtx)
 {
     gen = -1;
@@ -655,6 +866,39 @@ BOOL GCObjInLargeSegment(TADDR taddrObj, const DacpGcHeapDetails &heap, TADDR_SE
 BOOL GCObjInHeap(TADDR taddrObj, const DacpGcHeapDetails &heap, 
     TADDR_SEGINFO& rngSeg, int& gen, TADDR_RANGE& allocCtx, BOOL &bLarge)
 {
+    // If the heap snapshot has been built (GCWhere, ListNearObj and the heap
+    // walkers do this up front), find the segment with a binary search of the
+    // snapshotted segment ranges instead of walking the DAC's segment list on
+    // every query.
+    const DacpHeapSegmentData *snapSeg = g_snapshot.FindSegment(taddrObj, &bLarge);
+    if (snapSeg != NULL)
+    {
+        // The snapshot spans every GC heap; the caller asked about one of them.
+        if (snapSeg->gc_heap != NULL && snapSeg->gc_heap != heap.heapAddr)
+            return FALSE;
+
+        rngSeg.segAddr = (TADDR)snapSeg->segmentAddr;
+        rngSeg.start   = (TADDR)snapSeg->mem;
+        rngSeg.end     = (TADDR)snapSeg->highAllocMark;
+
+        if (bLarge)
+        {
+            gen = GetMaxGeneration()+1;
+            allocCtx.start = allocCtx.end = 0;
+            return TRUE;
+        }
+
+        if (rngSeg.segAddr == (TADDR)heap.ephemeral_heap_segment)
+            return GCObjInGeneration(taddrObj, heap, rngSeg, gen, allocCtx);
+
+        gen = 2;
+        allocCtx.start = allocCtx.end = 0;
+        return TRUE;
+    }
+
+    if (g_snapshot.IsBuilt())
+        return FALSE;
+
     if (GCObjInSegment(taddrObj, heap, rngSeg, gen, allocCtx))
     {
         bLarge = FALSE;
@@ -995,27 +1239,86 @@ void GatherOneHeapFinalization(DacpGcHeapDetails& heapDetails, HeapStat *stat, B
     // otherwise we count all finalizable objects.
     TADDR taddrLowerLimit = (bAllReady ? (TADDR)SegQueue(heapDetails, CriticalFinalizerListSeg) :
         (DWORD_PTR)SegQueue(heapDetails, gen_segment(GetMaxGeneration())));
-    for (dwAddr = taddrLowerLimit;
-         dwAddr < (DWORD_PTR)SegQueueLimit(heapDetails, FinalizerListSeg);
-         dwAddr += sizeof (dwAddr)) 
+    DWORD_PTR dwUpperLimit = (DWORD_PTR)SegQueueLimit(heapDetails, FinalizerListSeg);
+
+    // Read the queue in slices: one block read per slice instead of one MOVE
+    // per slot.
+    const size_t maxSlots = 0x4000;
+    std::vector<DWORD_PTR> slots;
+
+    // The statistics do not depend on queue order, so the stats path batches
+    // the object addresses and resolves them sorted; queue neighbors are
+    // rarely heap neighbors, and the sort turns the header and size reads
+    // into a streaming pass over the page cache.  The -short listing prints
+    // in queue order and keeps resolving inline.
+    std::vector<DWORD_PTR> objects;
+    if (!bShort && dwUpperLimit > taddrLowerLimit)
+        objects.reserve((dwUpperLimit - taddrLowerLimit) / sizeof(DWORD_PTR));
+
+    for (dwAddr = taddrLowerLimit; dwAddr < dwUpperLimit; )
     {
         if (IsInterrupt())
         {
             return;
         }
-        
-        DWORD_PTR objAddr = NULL, 
-                  MTAddr = NULL;
 
-        if (SUCCEEDED(MOVE(objAddr, dwAddr)) && SUCCEEDED(GetMTOfObject(objAddr, &MTAddr)) && MTAddr) 
+        size_t cSlots = (dwUpperLimit - dwAddr) / sizeof(DWORD_PTR);
+        if (cSlots > maxSlots)
+            cSlots = maxSlots;
+
+        slots.resize(cSlots);
+        bool haveSlice = SUCCEEDED(moveArray(slots.data(), dwAddr, cSlots));
+
+        for (size_t n = 0; n < cSlots; n++, dwAddr += sizeof(dwAddr))
         {
+            if (IsInterrupt())
+            {
+                return;
+            }
+
+            DWORD_PTR objAddr = NULL,
+                      MTAddr = NULL;
+
+            // A slice straddling an unmapped page fails as a block while some
+            // of its slots are still readable, so fall back to slot reads.
+            if (haveSlice)
+            {
+                objAddr = slots[n];
+            }
+            else if (FAILED(MOVE(objAddr, dwAddr)))
+            {
+                continue;
+            }
+
             if (bShort)
             {
-                DMLOut("%s\n", DMLObject(objAddr));
+                if (SUCCEEDED(GetMTOfObject(objAddr, &MTAddr)) && MTAddr)
+                {
+                    DMLOut("%s\n", DMLObject(objAddr));
+                }
             }
             else
             {
-                size_t s = ObjectSize(objAddr);
+                objects.push_back(objAddr);
+            }
+        }
+    }
+
+    if (!bShort)
+    {
+        std::sort(objects.begin(), objects.end());
+
+        for (size_t n = 0; n < objects.size(); n++)
+        {
+            if (IsInterrupt())
+            {
+                return;
+            }
+
+            DWORD_PTR MTAddr = NULL;
+            if (SUCCEEDED(GetMTOfObject(objects[n], &MTAddr)) && MTAddr)
+            {
+                size_t s = ObjectSize(objects[n]);
                 stat->Add(MTAddr, (DWORD)s);
             }
         }
@@ -1251,51 +1554,23 @@ BOOL GCHeapsTraverse(VISITGCHEAPFUNC pFunc, LPVOID token, BOOL verify)
     AllocInfo allocInfo;
     allocInfo.Init();
 
-    if (!IsServerBuild())
+    // The per-heap details come from the session snapshot, so a traversal
+    // after any other heap command issues no new detail requests.
+    if (!g_snapshot.Build())
     {
-        DacpGcHeapDetails heapDetails;
-        if (heapDetails.Request(g_sos) != S_OK)
-        {
-            ExtOut("Error requesting gc heap details\n");
-            return FALSE;
-        }
+        return FALSE;
+    }
 
-        return GCHeapTraverse (heapDetails, &allocInfo, pFunc, token, verify);
+    if (!IsServerBuild())
+    {
+        return GCHeapTraverse (*g_snapshot.GetHeapDetails(0), &allocInfo, pFunc, token, verify);
     }
     else
     {
-        DacpGcHeapData gcheap;
-        if (gcheap.Request(g_sos) != S_OK)
-        {
-            ExtOut("Error requesting GC Heap data\n");
-            return FALSE;
-        }
-
-        DWORD dwAllocSize;
-        DWORD dwNHeaps = gcheap.HeapCount;
-        if (!ClrSafeInt<DWORD>::multiply(sizeof(CLRDATA_ADDRESS), dwNHeaps, dwAllocSize))
-        {
-            ExtOut("Failed to get GCHeaps:  integer overflow error\n");
-            return FALSE;
-        }
-        CLRDATA_ADDRESS *heapAddrs = (CLRDATA_ADDRESS*)alloca(dwAllocSize);
-        if (g_sos->GetGCHeapList(dwNHeaps, heapAddrs, NULL) != S_OK)
-        {
-            ExtOut("Failed to get GCHeaps\n");
-            return FALSE;
-        }
- 
-        DWORD n;
-        for (n = 0; n < dwNHeaps; n ++)
+        int nHeaps = g_snapshot.GetHeapCount();
+        for (int n = 0; n < nHeaps; n ++)
         {
-            DacpGcHeapDetails heapDetails;
-            if (heapDetails.Request(g_sos, heapAddrs[n]) != S_OK)
-            {
-                ExtOut("Error requesting details\n");
-                return FALSE;
-            }
-
-            if (!GCHeapTraverse (heapDetails, &allocInfo, pFunc, token, verify))
+            if (!GCHeapTraverse (*g_snapshot.GetHeapDetails(n), &allocInfo, pFunc, token, verify))
             {
                 ExtOut("Traversing a gc heap failed\n");
                 return FALSE;
@@ -1316,6 +1591,9 @@ GCHeapSnapshot::GCHeapSnapshot()
 SegmentLookup::SegmentLookup() 
 { 
     m_iSegmentsSize = m_iSegmentCount = 0; 
+    m_segmentIsLarge = NULL;
+    m_sortedIndex = NULL;
+    m_bSorted = FALSE;
 
     m_segments = new DacpHeapSegmentData[nSegLookupStgIncrement];
     if (m_segments == NULL)
@@ -1325,10 +1603,19 @@ SegmentLookup::SegmentLookup()
     else 
     {
         m_iSegmentsSize = nSegLookupStgIncrement;
+        m_segmentIsLarge = new BOOL[nSegLookupStgIncrement];
+        m_sortedIndex = new int[nSegLookupStgIncrement];
+        if (m_segmentIsLarge == NULL || m_sortedIndex == NULL)
+        {
+            ReportOOM();
+            delete [] m_segments;
+            m_segments = NULL;
+            m_iSegmentsSize = 0;
+        }
     }
 }
 
-BOOL SegmentLookup::AddSegment(DacpHeapSegmentData *pData)
+BOOL SegmentLookup::AddSegment(DacpHeapSegmentData *pData, BOOL bLarge)
 {
     // appends the address of a new (initialized) instance of DacpHeapSegmentData to the list of segments
     // (m_segments) adding  space for a segment when necessary. 
@@ -1337,27 +1624,43 @@ BOOL SegmentLookup::AddSegment(DacpHeapSegmentData *pData)
     // m_iMaxSegments instead. 
     if (m_iSegmentCount >= m_iSegmentsSize)
     {
-        // expand buffer--allocate enough space to hold the elements we already have plus nSegLookupStgIncrement
+        // expand buffers--allocate enough space to hold the elements we already have plus nSegLookupStgIncrement
         // more elements
         DacpHeapSegmentData *pNewBuffer = new DacpHeapSegmentData[m_iSegmentsSize+nSegLookupStgIncrement];
-        if (pNewBuffer==NULL)
+        BOOL *pNewIsLarge = new BOOL[m_iSegmentsSize+nSegLookupStgIncrement];
+        int *pNewSortedIndex = new int[m_iSegmentsSize+nSegLookupStgIncrement];
+        if (pNewBuffer==NULL || pNewIsLarge==NULL || pNewSortedIndex==NULL)
+        {
+            delete [] pNewBuffer;
+            delete [] pNewIsLarge;
+            delete [] pNewSortedIndex;
             return FALSE;
+        }
 
-        // copy the old elements into the new array
+        // copy the old elements into the new arrays
         memcpy(pNewBuffer, m_segments, sizeof(DacpHeapSegmentData)*m_iSegmentsSize);
+        memcpy(pNewIsLarge, m_segmentIsLarge, sizeof(BOOL)*m_iSegmentsSize);
         
         // record the new number of elements available
         m_iSegmentsSize+=nSegLookupStgIncrement;
 
-        // delete the old array
+        // delete the old arrays
         delete [] m_segments;
+        delete [] m_segmentIsLarge;
+        delete [] m_sortedIndex;
 
-        // set m_segments to point to the new array
+        // point at the new arrays
         m_segments = pNewBuffer;
+        m_segmentIsLarge = pNewIsLarge;
+        m_sortedIndex = pNewSortedIndex;
     }
      
     // add pData to the array
-    m_segments[m_iSegmentCount++] = *pData;        
+    m_segmentIsLarge[m_iSegmentCount] = bLarge;
+    m_segments[m_iSegmentCount++] = *pData;
+
+    // the sorted index is rebuilt lazily on the next lookup
+    m_bSorted = FALSE;
     
     return TRUE;
 }
@@ -1369,11 +1672,69 @@ SegmentLookup::~SegmentLookup()
         delete [] m_segments;
         m_segments = NULL;
     }
+
+    if (m_segmentIsLarge)
+    {
+        delete [] m_segmentIsLarge;
+        m_segmentIsLarge = NULL;
+    }
+
+    if (m_sortedIndex)
+    {
+        delete [] m_sortedIndex;
+        m_sortedIndex = NULL;
+    }
 }
 
 void SegmentLookup::Clear()
 {
     m_iSegmentCount = 0;
+    m_bSorted = FALSE;
+}
+
+void SegmentLookup::EnsureSorted()
+{
+    if (m_bSorted)
+        return;
+
+    for (int i = 0; i < m_iSegmentCount; i++)
+        m_sortedIndex[i] = i;
+
+    DacpHeapSegmentData *segments = m_segments;
+    std::sort(m_sortedIndex, m_sortedIndex + m_iSegmentCount,
+        [segments](int lhs, int rhs) { return TO_TADDR(segments[lhs].mem) < TO_TADDR(segments[rhs].mem); });
+
+    m_bSorted = TRUE;
+}
+
+int SegmentLookup::Find(CLRDATA_ADDRESS object)
+{
+    EnsureSorted();
+
+    // Binary search for the segment with the greatest mem <= object.  Segment
+    // ranges never overlap, so that segment is the only candidate.
+    int lo = 0;
+    int hi = m_iSegmentCount - 1;
+    int candidate = -1;
+
+    while (lo <= hi)
+    {
+        int mid = lo + (hi - lo)/2;
+        if (TO_TADDR(m_segments[m_sortedIndex[mid]].mem) <= TO_TADDR(object))
+        {
+            candidate = m_sortedIndex[mid];
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    if (candidate != -1 && TO_TADDR(object) < TO_TADDR(m_segments[candidate].highAllocMark))
+        return candidate;
+
+    return -1;
 }
 
 CLRDATA_ADDRESS SegmentLookup::GetHeap(CLRDATA_ADDRESS object, BOOL& bFound)
@@ -1381,17 +1742,12 @@ CLRDATA_ADDRESS SegmentLookup::GetHeap(CLRDATA_ADDRESS object, BOOL& bFound)
     CLRDATA_ADDRESS ret = NULL;
     bFound = FALSE;
     
-    // Visit our segments
-    for (int i=0; i<m_iSegmentCount; i++)
+    int i = Find(object);
+    if (i != -1)
     {
-        if (TO_TADDR(m_segments[i].mem) <= TO_TADDR(object) && 
-            TO_TADDR(m_segments[i].highAllocMark) > TO_TADDR(object))
-        {
-            ret = m_segments[i].gc_heap;
-            bFound = TRUE;
-            break;
-        }
-    }    
+        ret = m_segments[i].gc_heap;
+        bFound = TRUE;
+    }
 
     return ret;
 }
@@ -1399,9 +1755,16 @@ CLRDATA_ADDRESS SegmentLookup::GetHeap(CLRDATA_ADDRESS object, BOOL& bFound)
 ///////////////////////////////////////////////////////////////////////////
 
 BOOL GCHeapSnapshot::Build()
-{    
+{
+    // Session cache: on server GC this costs one details request per heap
+    // plus the segment walk, so rebuilding it for every command was hundreds
+    // of DAC round trips on a 64-heap dump before any real work started.
+    // ResetGlobals clears the snapshot whenever the target may have run.
+    if (m_isBuilt)
+        return TRUE;
+
     Clear();
-    
+
     m_isBuilt = FALSE;
 
     ///- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -1526,7 +1889,7 @@ BOOL GCHeapSnapshot::AddSegments(DacpGcHeapDetails& details)
             }
 
             // add the new segment to the array of segments. This will expand the array if necessary
-            if (!m_segments.AddSegment(&segment))
+            if (!m_segments.AddSegment(&segment, i == 1))
             {
                 ExtOut("strike: Failed to store segment\n");
                 return FALSE;
@@ -1581,6 +1944,21 @@ DacpGcHeapDetails *GCHeapSnapshot::GetHeap(CLRDATA_ADDRESS objectPointer)
     return NULL;
 }
 
+const DacpHeapSegmentData *GCHeapSnapshot::FindSegment(CLRDATA_ADDRESS objectPointer, BOOL *pbLarge)
+{
+    if (!m_isBuilt)
+        return NULL;
+
+    int i = m_segments.Find(objectPointer);
+    if (i == -1)
+        return NULL;
+
+    if (pbLarge)
+        *pbLarge = m_segments.m_segmentIsLarge[i];
+
+    return m_segments.m_segments + i;
+}
+
 // TODO: Do we need to handle the LOH here?
 int GCHeapSnapshot::GetGeneration(CLRDATA_ADDRESS objectPointer)
 {
@@ -1655,6 +2033,193 @@ void PrintHeapSize(DWORD_PTR total, DWORD_PTR wasted)
     ExtOut(".\n");
 }
 
+/* The session's code-heap range index.  The JIT manager and code heap lists
+ * are enumerated once; the stack scanners then answer "is this a managed code
+ * address" with a local binary search instead of a DAC request per probe.
+ * The JIT grows new code heaps whenever a live target runs, so the index only
+ * survives across commands against a dump (see the cache-clearing block in
+ * util.cpp).
+ */
+struct CodeHeapRangeIndex
+{
+    BOOL Valid;
+    BOOL Unavailable;       // enumeration failed; don't retry every probe
+    std::vector<CodeHeapRange> Ranges;  // sorted by Start
+};
+
+static CodeHeapRangeIndex g_codeHeapRanges;
+
+void ClearCodeHeapRangeIndex()
+{
+    g_codeHeapRanges.Valid = FALSE;
+    g_codeHeapRanges.Unavailable = FALSE;
+    g_codeHeapRanges.Ranges.clear();
+}
+
+// Passed through TraverseLoaderHeap while capturing a LoaderCodeHeap's blocks.
+static CLRDATA_ADDRESS g_codeHeapRangeManager;
+
+static void CodeHeapRangeTraverse(CLRDATA_ADDRESS blockData, size_t blockSize, BOOL blockIsCurrentBlock)
+{
+    // Record the whole reserved block; over-inclusion only costs the caller a
+    // probe it would have made anyway, while a missed range would misclassify
+    // real jitted code.
+    CodeHeapRange range;
+    range.Start = TO_TADDR(blockData);
+    range.End = TO_TADDR(blockData) + blockSize;
+    range.Kind = CHK_LoaderCodeHeap;
+    range.Manager = g_codeHeapRangeManager;
+    g_codeHeapRanges.Ranges.push_back(range);
+}
+
+static bool CodeHeapRangeLess(const CodeHeapRange &lhs, const CodeHeapRange &rhs)
+{
+    return lhs.Start < rhs.Start;
+}
+
+const std::vector<CodeHeapRange> *GetCodeHeapRangeIndex()
+{
+    if (g_codeHeapRanges.Valid)
+        return &g_codeHeapRanges.Ranges;
+
+    if (g_codeHeapRanges.Unavailable)
+        return NULL;
+
+    g_codeHeapRanges.Ranges.clear();
+    g_codeHeapRanges.Unavailable = TRUE;
+
+    unsigned int count = 0;
+    if (FAILED(g_sos->GetJitManagerList(0, NULL, &count)))
+        return NULL;
+
+    ArrayHolder<DacpJitManagerInfo> managers = new DacpJitManagerInfo[count];
+    if (managers == NULL)
+        return NULL;
+
+    if (g_sos->GetJitManagerList(count, managers, NULL) != S_OK)
+        return NULL;
+
+    for (unsigned int n = 0; n < count; n++)
+    {
+        if (IsInterrupt())
+        {
+            // Interrupted, not unavailable; the next command starts over.
+            g_codeHeapRanges.Unavailable = FALSE;
+            return NULL;
+        }
+
+        if (!IsMiIL(managers[n].codeType))
+            continue;
+
+        unsigned int heapCount = 0;
+        if (FAILED(g_sos->GetCodeHeapList(managers[n].managerAddr, 0, NULL, &heapCount)) || heapCount == 0)
+            continue;
+
+        ArrayHolder<DacpJitCodeHeapInfo> codeHeapInfo = new DacpJitCodeHeapInfo[heapCount];
+        if (codeHeapInfo == NULL)
+            return NULL;
+
+        if (g_sos->GetCodeHeapList(managers[n].managerAddr, heapCount, codeHeapInfo, NULL) != S_OK)
+            return NULL;
+
+        for (unsigned int iHeaps = 0; iHeaps < heapCount; iHeaps++)
+        {
+            if (IsInterrupt())
+            {
+                g_codeHeapRanges.Unavailable = FALSE;
+                return NULL;
+            }
+
+            if (codeHeapInfo[iHeaps].codeHeapType == CODEHEAP_LOADER)
+            {
+                if (codeHeapInfo[iHeaps].LoaderHeap)
+                {
+                    g_codeHeapRangeManager = managers[n].managerAddr;
+                    g_sos->TraverseLoaderHeap(codeHeapInfo[iHeaps].LoaderHeap, CodeHeapRangeTraverse);
+                }
+            }
+            else if (codeHeapInfo[iHeaps].codeHeapType == CODEHEAP_HOST)
+            {
+                CodeHeapRange range;
+                range.Start = TO_TADDR(codeHeapInfo[iHeaps].HostData.baseAddr);
+                range.End = TO_TADDR(codeHeapInfo[iHeaps].HostData.currentAddr);
+                range.Kind = CHK_HostCodeHeap;
+                range.Manager = managers[n].managerAddr;
+                if (range.End > range.Start)
+                    g_codeHeapRanges.Ranges.push_back(range);
+            }
+        }
+    }
+
+    std::sort(g_codeHeapRanges.Ranges.begin(), g_codeHeapRanges.Ranges.end(), CodeHeapRangeLess);
+    g_codeHeapRanges.Unavailable = FALSE;
+    g_codeHeapRanges.Valid = TRUE;
+    return &g_codeHeapRanges.Ranges;
+}
+
+BOOL TryIsInJitCodeHeap(TADDR ip, BOOL *pInHeap)
+{
+    const std::vector<CodeHeapRange> *ranges = GetCodeHeapRangeIndex();
+    if (ranges == NULL)
+        return FALSE;
+
+    size_t lo = 0, hi = ranges->size();
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((*ranges)[mid].Start <= ip)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *pInHeap = lo > 0 && ip < (*ranges)[lo - 1].End;
+    return TRUE;
+}
+
+/* The one-pass summary behind !eeheap -codestats: range counts and bytes per
+ * heap flavor, then per jit manager.  Everything is served from the range
+ * index, so repeated runs against a dump cost nothing.
+ */
+void PrintCodeHeapStats()
+{
+    const std::vector<CodeHeapRange> *ranges = GetCodeHeapRangeIndex();
+    if (ranges == NULL)
+    {
+        ExtOut("Unable to enumerate the JIT code heaps\n");
+        return;
+    }
+
+    size_t kindCount[2] = {0, 0};
+    ULONG64 kindBytes[2] = {0, 0};
+    std::map<CLRDATA_ADDRESS, ULONG64> managerBytes;
+
+    for (size_t i = 0; i < ranges->size(); ++i)
+    {
+        const CodeHeapRange &range = (*ranges)[i];
+        kindCount[range.Kind]++;
+        kindBytes[range.Kind] += range.End - range.Start;
+        managerBytes[range.Manager] += range.End - range.Start;
+    }
+
+    ExtOut("JIT code heaps:\n");
+    ExtOut("LoaderCodeHeap:    %d ranges, 0x%" POINTERSIZE_TYPE "x (%" POINTERSIZE_TYPE "u) bytes\n",
+        (int)kindCount[CHK_LoaderCodeHeap], (DWORD_PTR)kindBytes[CHK_LoaderCodeHeap], (DWORD_PTR)kindBytes[CHK_LoaderCodeHeap]);
+    ExtOut("HostCodeHeap:      %d ranges, 0x%" POINTERSIZE_TYPE "x (%" POINTERSIZE_TYPE "u) bytes\n",
+        (int)kindCount[CHK_HostCodeHeap], (DWORD_PTR)kindBytes[CHK_HostCodeHeap], (DWORD_PTR)kindBytes[CHK_HostCodeHeap]);
+
+    if (managerBytes.size() > 1)
+    {
+        ExtOut("\nBy jit manager:\n");
+        for (std::map<CLRDATA_ADDRESS, ULONG64>::iterator itr = managerBytes.begin(); itr != managerBytes.end(); ++itr)
+            ExtOut("%p: 0x%" POINTERSIZE_TYPE "x (%" POINTERSIZE_TYPE "u) bytes\n",
+                SOS_PTR(itr->first), (DWORD_PTR)itr->second, (DWORD_PTR)itr->second);
+    }
+
+    ExtOut("Total size:        ");
+    PrintHeapSize((DWORD_PTR)(kindBytes[0] + kindBytes[1]), 0);
+}
+
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
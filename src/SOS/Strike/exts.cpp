@@ -9,6 +9,16 @@
 // ==--==
 #include "exts.h"
 #include "disasm.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#ifndef FEATURE_PAL
+#include <dbghelp.h>
+#else
+#include <execinfo.h>
+#include <dlfcn.h>
+#endif
 #ifndef FEATURE_PAL
 #include "EventCallbacks.h"
 
@@ -46,6 +56,643 @@ bool                  g_palInitialized = false;
 IMachine* g_targetMachine = NULL;
 BOOL      g_bDacBroken = FALSE;
 
+ReadVirtualStats g_readStats = {};
+ReadVirtualStats g_readStatsBaseline = {};
+BOOL g_readStatsVerbose = FALSE;
+
+ULONG g_linearCachePageSize = 0x1000;
+int   g_linearCachePageCount = 64;
+
+void ReadVirtualStats::Print(const ReadVirtualStats &since) const
+{
+    ULONG64 calls = Calls - since.Calls;
+    ULONG64 moveReads = MoveReads - since.MoveReads;
+    ULONG64 moveHits = MoveHits - since.MoveHits;
+    ULONG64 pageReads = PageReads - since.PageReads;
+    ULONG64 pageHits = PageHits - since.PageHits;
+
+    ExtOut("ReadVirtual:   %I64u calls, %I64u bytes requested, %I64u bytes read\n",
+           calls, BytesRequested - since.BytesRequested, BytesRead - since.BytesRead);
+    ExtOut("MOVE cache:    %I64u reads, %I64u hits (%.1f%%)\n",
+           moveReads, moveHits, moveReads != 0 ? 100.0 * moveHits / moveReads : 0.0);
+    ExtOut("Page cache:    %I64u reads, %I64u hits (%.1f%%), %I64u fills, %I64u evictions\n",
+           pageReads, pageHits, pageReads != 0 ? 100.0 * pageHits / pageReads : 0.0,
+           PageFills - since.PageFills, PageEvictions - since.PageEvictions);
+    ExtOut("Batched reads: %I64u batches resolving %I64u ranges\n",
+           BatchCalls - since.BatchCalls, BatchRanges - since.BatchRanges);
+}
+
+BOOL g_sosPerfEnabled = FALSE;
+BOOL g_sosFastPathsEnabled = TRUE;
+
+CommandArena g_commandArena;
+
+// Depth of nested command scopes; the arena is reset only when the
+// outermost one unwinds.
+static int g_commandArenaDepth = 0;
+
+CommandArena::CommandArena()
+    : mHead(NULL), mCurrent(NULL), mBytesAllocated(0)
+{
+}
+
+CommandArena::~CommandArena()
+{
+    Reset();
+    if (mHead)
+    {
+        SOSMemSub(SOSMemArena, sizeof(Block) + mHead->capacity);
+        delete [] (BYTE *)mHead;
+    }
+}
+
+CommandArena::Block *CommandArena::NewBlock(size_t minSize)
+{
+    size_t capacity = BlockSize;
+    if (capacity < minSize)
+        capacity = minSize;
+
+    Block *block = (Block *)new (std::nothrow) BYTE[sizeof(Block) + capacity];
+    if (block == NULL)
+        return NULL;
+
+    block->next = NULL;
+    block->used = 0;
+    block->capacity = capacity;
+    SOSMemAdd(SOSMemArena, sizeof(Block) + capacity);
+    return block;
+}
+
+void *CommandArena::Alloc(size_t size)
+{
+    size = (size + Alignment - 1) & ~((size_t)Alignment - 1);
+
+    if (mCurrent == NULL || mCurrent->used + size > mCurrent->capacity)
+    {
+        Block *block = NewBlock(size);
+        if (block == NULL)
+            return NULL;
+
+        if (mCurrent)
+            mCurrent->next = block;
+        else
+            mHead = block;
+        mCurrent = block;
+    }
+
+    void *result = DataOf(mCurrent) + mCurrent->used;
+    mCurrent->used += size;
+    mBytesAllocated += size;
+    return result;
+}
+
+void CommandArena::Reset()
+{
+    // Keep the first block so steady-state commands never touch the heap.
+    if (mHead)
+    {
+        Block *block = mHead->next;
+        while (block)
+        {
+            Block *next = block->next;
+            SOSMemSub(SOSMemArena, sizeof(Block) + block->capacity);
+            delete [] (BYTE *)block;
+            block = next;
+        }
+
+        mHead->next = NULL;
+        mHead->used = 0;
+        mCurrent = mHead;
+    }
+
+    mBytesAllocated = 0;
+}
+
+CommandArenaScope::CommandArenaScope()
+{
+    g_commandArenaDepth++;
+}
+
+CommandArenaScope::~CommandArenaScope()
+{
+    if (--g_commandArenaDepth == 0)
+        g_commandArena.Reset();
+}
+
+#ifndef FEATURE_PAL
+
+/* The interrupt watcher turns the per-object cancellation poll into one
+ * volatile load.  Under dbgeng GetInterrupt is a COM call and showed up for
+ * several percent of the big walks; instead, while a command is running, a
+ * parked thread polls it every kInterruptPollMs and latches the answer into
+ * g_interruptPending for SOSInterruptPending to test.  GetInterrupt is one
+ * of the few dbgeng methods documented as callable from a secondary thread.
+ *
+ * The busy flag is a handshake with the command epilogue: the scope
+ * destructor waits for any in-flight poll to finish before the command
+ * returns to the engine, so the watcher never touches the interfaces while
+ * the engine could be tearing them down.
+ */
+const DWORD kInterruptPollMs = 50;
+
+volatile LONG g_interruptPending = 0;
+volatile LONG g_interruptWatcherRunning = 0;
+
+static HANDLE s_interruptWatcherThread = NULL;
+static HANDLE s_interruptWatcherWake = NULL;
+static volatile LONG s_interruptPollDepth = 0;  // commands on the stack
+static volatile LONG s_interruptPollBusy = 0;   // watcher inside a poll
+
+static DWORD WINAPI InterruptWatcherProc(LPVOID)
+{
+    for (;;)
+    {
+        WaitForSingleObject(s_interruptWatcherWake, INFINITE);
+
+        while (s_interruptPollDepth != 0)
+        {
+            // Raise busy before re-checking the depth; the scope destructor
+            // does the opposite, so either we see the command gone or it
+            // waits for this poll.
+            InterlockedExchange(&s_interruptPollBusy, 1);
+            if (s_interruptPollDepth != 0 && g_ExtControl != NULL &&
+                g_ExtControl->GetInterrupt() == S_OK)
+            {
+                InterlockedExchange(&g_interruptPending, 1);
+            }
+            InterlockedExchange(&s_interruptPollBusy, 0);
+
+            Sleep(kInterruptPollMs);
+        }
+    }
+
+    return 0;
+}
+
+InterruptWatcherScope::InterruptWatcherScope()
+{
+    if (s_interruptWatcherThread == NULL)
+    {
+        static BOOL s_createFailed = FALSE;
+        if (s_createFailed)
+            return;
+
+        s_interruptWatcherWake = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (s_interruptWatcherWake != NULL)
+            s_interruptWatcherThread = CreateThread(NULL, 0, InterruptWatcherProc, NULL, 0, NULL);
+
+        if (s_interruptWatcherThread == NULL)
+        {
+            // IsInterrupt falls back to polling the debugger directly for
+            // the rest of the session.
+            s_createFailed = TRUE;
+            if (s_interruptWatcherWake != NULL)
+            {
+                CloseHandle(s_interruptWatcherWake);
+                s_interruptWatcherWake = NULL;
+            }
+            return;
+        }
+
+        InterlockedExchange(&g_interruptWatcherRunning, 1);
+    }
+
+    if (InterlockedIncrement(&s_interruptPollDepth) == 1)
+    {
+        // Nested commands share the outer command's latch.
+        InterlockedExchange(&g_interruptPending, 0);
+        SetEvent(s_interruptWatcherWake);
+    }
+}
+
+InterruptWatcherScope::~InterruptWatcherScope()
+{
+    if (!g_interruptWatcherRunning)
+        return;
+
+    if (InterlockedDecrement(&s_interruptPollDepth) == 0)
+    {
+        while (s_interruptPollBusy != 0)
+            Sleep(0);
+        InterlockedExchange(&g_interruptPending, 0);
+    }
+}
+
+#endif // !FEATURE_PAL
+
+// Cumulative totals for one command, keyed by command name below.
+struct SOSPerfTotals
+{
+    ULONG64 Calls;
+    double  WallSecs;
+    double  CpuSecs;
+    ULONG64 Reads;
+    ULONG64 BytesRead;
+};
+
+// Created on first use so sessions that never enable the profiler pay nothing.
+static std::map<std::string, SOSPerfTotals> *g_sosPerfTotals = NULL;
+
+// Thread CPU time in 100ns units, or 0 where the host cannot report it.
+static ULONG64 GetCommandCpuTime()
+{
+#ifndef FEATURE_PAL
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return 0;
+    return (((ULONG64)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime) +
+           (((ULONG64)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime);
+#else
+    // The PAL does not expose thread CPU times; the profiler reports wall
+    // time only.
+    return 0;
+#endif
+}
+
+SOSMemStats g_sosMemStats[SOSMemOwnerCount];
+
+LONG64 SOSMemTotal()
+{
+    LONG64 total = 0;
+    for (int i = 0; i < SOSMemOwnerCount; i++)
+        total += g_sosMemStats[i].Current;
+    return total;
+}
+
+void SOSMemReport()
+{
+    static const char * const ownerNames[SOSMemOwnerCount] =
+    {
+        "Read cache",
+        "Heap statistics",
+        "Name caches",
+        "Graph indexes",
+        "Command arena",
+        "Scratch buffers",
+    };
+
+    ExtOut("%-18s %14s %14s\n", "Owner", "Current (KB)", "Peak (KB)");
+    LONG64 current = 0;
+    LONG64 peak = 0;
+    for (int i = 0; i < SOSMemOwnerCount; i++)
+    {
+        ExtOut("%-18s %14I64d %14I64d\n", ownerNames[i],
+               g_sosMemStats[i].Current / 1024, g_sosMemStats[i].Peak / 1024);
+        current += g_sosMemStats[i].Current;
+        peak += g_sosMemStats[i].Peak;
+    }
+    ExtOut("%-18s %14I64d %14I64d\n", "TOTAL", current / 1024, peak / 1024);
+    ExtOut("\nOnly SOS's own caches are accounted; debugger-side allocations are not.\n");
+}
+
+#ifndef FEATURE_PAL
+static BOOL ScratchLargePagesEnabled()
+{
+    static int enabled = -1;
+    if (enabled < 0)
+    {
+        const char *knob = getenv("SOS_LARGE_PAGES");
+        enabled = (knob == NULL || atoi(knob) != 0) ? 1 : 0;
+    }
+    return enabled != 0;
+}
+#endif
+
+void *AllocScratchBuffer(size_t size)
+{
+#ifndef FEATURE_PAL
+    if (ScratchLargePagesEnabled())
+    {
+        size_t largePage = GetLargePageMinimum();
+        if (largePage != 0 && size >= largePage)
+        {
+            // Large-page regions must be a multiple of the large-page size.
+            size_t rounded = (size + largePage - 1) & ~(largePage - 1);
+            void *buffer = VirtualAlloc(NULL, rounded, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (buffer != NULL)
+            {
+                SOSMemAdd(SOSMemScratch, size);
+                return buffer;
+            }
+            // Typically the debugger lacks SeLockMemoryPrivilege; fall
+            // through to a regular mapping without complaint.
+        }
+    }
+#endif
+
+    void *buffer = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (buffer != NULL)
+        SOSMemAdd(SOSMemScratch, size);
+    return buffer;
+}
+
+void FreeScratchBuffer(void *buffer, size_t size)
+{
+    if (buffer == NULL)
+        return;
+
+    VirtualFree(buffer, 0, MEM_RELEASE);
+    SOSMemSub(SOSMemScratch, size);
+}
+
+BOOL g_sosProgressEnabled = FALSE;
+size_t g_sosProgressIntervalSecs = 5;
+ULONG64 g_sosProgressCount = 0;
+
+static ULONG64 s_progressLastTick = 0;    // QPC ticks of the last line (or the first ping)
+static ULONG64 s_progressLastCount = 0;
+static ULONG64 s_progressStartBytes = 0;  // read counter when the walk started
+
+void SOSProgressReset()
+{
+    g_sosProgressCount = 0;
+    s_progressLastTick = 0;
+    s_progressLastCount = 0;
+    s_progressStartBytes = 0;
+}
+
+void SOSProgressPrint(const char *phase, TADDR current)
+{
+    LARGE_INTEGER now, freq;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&freq);
+
+    if (s_progressLastTick == 0)
+    {
+        // The first ping of the command starts the interval without printing,
+        // so short commands never emit a line.
+        s_progressLastTick = now.QuadPart;
+        s_progressLastCount = g_sosProgressCount;
+        s_progressStartBytes = g_readStats.BytesRead;
+        return;
+    }
+
+    double elapsed = (double)(now.QuadPart - (LONGLONG)s_progressLastTick) / (double)freq.QuadPart;
+    if (elapsed < (double)g_sosProgressIntervalSecs)
+        return;
+
+    ExtOut("progress: %s: %I64u visited, %I64u MB read, at %p, %.0f/sec\n",
+        phase, g_sosProgressCount,
+        (g_readStats.BytesRead - s_progressStartBytes) / (1024 * 1024),
+        SOS_PTR(current),
+        (double)(g_sosProgressCount - s_progressLastCount) / elapsed);
+
+    s_progressLastTick = now.QuadPart;
+    s_progressLastCount = g_sosProgressCount;
+}
+
+SOSPerfScope::SOSPerfScope(const char *commandName)
+{
+    mCommandName = commandName;
+
+    // Each command gets a fresh progress interval and item count.
+    SOSProgressReset();
+
+    // Latch the enabled flags so toggling the profiler from inside a command
+    // cannot pair a missing start with an end.  The control command itself
+    // is neither timed nor sampled.
+    mActive = g_sosPerfEnabled && strcmp(commandName, "SOSPerf") != 0;
+    mSampling = g_sosSampleEnabled && strcmp(commandName, "SOSPerf") != 0;
+    if (mSampling)
+        SOSSampleStart();
+    if (!mActive)
+        return;
+
+    LARGE_INTEGER wall;
+    QueryPerformanceCounter(&wall);
+    mWallStart = wall.QuadPart;
+    mCpuStart = GetCommandCpuTime();
+    mReadStart = g_readStats;
+    mMemStart = SOSMemTotal();
+}
+
+SOSPerfScope::~SOSPerfScope()
+{
+    if (mSampling)
+        SOSSampleStop();
+    if (!mActive)
+        return;
+
+    LARGE_INTEGER wall, freq;
+    QueryPerformanceCounter(&wall);
+    QueryPerformanceFrequency(&freq);
+    double wallSecs = (double)(wall.QuadPart - mWallStart) / (double)freq.QuadPart;
+    double cpuSecs = (GetCommandCpuTime() - mCpuStart) / 1e7;
+    ULONG64 reads = g_readStats.Calls - mReadStart.Calls;
+    ULONG64 bytesRead = g_readStats.BytesRead - mReadStart.BytesRead;
+
+    if (g_sosPerfTotals == NULL)
+        g_sosPerfTotals = new (std::nothrow) std::map<std::string, SOSPerfTotals>();
+    if (g_sosPerfTotals != NULL)
+    {
+        SOSPerfTotals &totals = (*g_sosPerfTotals)[mCommandName];
+        totals.Calls++;
+        totals.WallSecs += wallSecs;
+        totals.CpuSecs += cpuSecs;
+        totals.Reads += reads;
+        totals.BytesRead += bytesRead;
+    }
+
+    // The scope is declared after __ExtensionCleanUp in the INIT_API macros,
+    // so it destructs first and the output interfaces are still alive here.
+    if (g_ExtControl != NULL)
+    {
+        LONG64 memDelta = SOSMemTotal() - mMemStart;
+#ifndef FEATURE_PAL
+        ExtOut("[sosperf] %s: wall %.3fs, cpu %.3fs, %I64u reads, %I64u KB, mem %+I64d KB\n",
+               mCommandName, wallSecs, cpuSecs, reads, bytesRead / 1024, memDelta / 1024);
+#else
+        ExtOut("[sosperf] %s: wall %.3fs, %I64u reads, %I64u KB, mem %+I64d KB\n",
+               mCommandName, wallSecs, reads, bytesRead / 1024, memDelta / 1024);
+#endif
+    }
+}
+
+void SOSPerfReport()
+{
+    if (g_sosPerfTotals == NULL || g_sosPerfTotals->empty())
+    {
+        ExtOut("No commands profiled.  Enable the profiler with !sosperf -on.\n");
+        return;
+    }
+
+#ifndef FEATURE_PAL
+    ExtOut("%-24s %8s %12s %12s %12s %12s\n",
+           "Command", "Calls", "Wall (s)", "CPU (s)", "Reads", "KB read");
+#else
+    ExtOut("%-24s %8s %12s %12s %12s\n",
+           "Command", "Calls", "Wall (s)", "Reads", "KB read");
+#endif
+    for (std::map<std::string, SOSPerfTotals>::const_iterator it = g_sosPerfTotals->begin();
+         it != g_sosPerfTotals->end(); ++it)
+    {
+        const SOSPerfTotals &totals = it->second;
+#ifndef FEATURE_PAL
+        ExtOut("%-24s %8I64u %12.3f %12.3f %12I64u %12I64u\n",
+               it->first.c_str(), totals.Calls, totals.WallSecs, totals.CpuSecs,
+               totals.Reads, totals.BytesRead / 1024);
+#else
+        ExtOut("%-24s %8I64u %12.3f %12I64u %12I64u\n",
+               it->first.c_str(), totals.Calls, totals.WallSecs,
+               totals.Reads, totals.BytesRead / 1024);
+#endif
+    }
+}
+
+void SOSPerfReset()
+{
+    if (g_sosPerfTotals != NULL)
+        g_sosPerfTotals->clear();
+}
+
+BOOL g_sosSampleEnabled = FALSE;
+volatile LONG g_sosSamplePending = 0;
+
+// Cooperative sampling self-profiler (!sosperf -sample).  A timer thread
+// raises g_sosSamplePending on a fixed interval; the command thread notices
+// at the hot-path checkpoints (the read funnel, IsInterrupt) and captures
+// its own stack, so no suspension or signal machinery is needed and the
+// same code runs under dbgeng and the lldb plugin.  The trade-off is that
+// samples land only at checkpoint sites, which is fine for the question the
+// sampler answers: which SOS code path is driving all the reads.
+
+static const int kSampleIntervalMs = 10;
+static const int kSampleMaxDepth = 48;
+
+// Collapsed stacks: raw return addresses, root first, mapped to the number
+// of samples that observed them.  Symbolization happens at report time so
+// captures stay cheap.
+static std::map<std::vector<PVOID>, ULONG64> *g_sampleStacks = NULL;
+static ULONG64 g_sampleCount = 0;
+static HANDLE g_sampleTimerThread = NULL;
+static volatile LONG g_sampleTimerStop = 0;
+
+static DWORD WINAPI SampleTimerProc(LPVOID)
+{
+    while (g_sampleTimerStop == 0)
+    {
+        Sleep(kSampleIntervalMs);
+        g_sosSamplePending = 1;
+    }
+    return 0;
+}
+
+void SOSSampleCapture()
+{
+    g_sosSamplePending = 0;
+
+    PVOID frames[kSampleMaxDepth];
+    int depth;
+#ifndef FEATURE_PAL
+    // Skip this function; the top frame is the checkpoint's caller.
+    depth = (int)CaptureStackBackTrace(1, kSampleMaxDepth, frames, NULL);
+    int first = 0;
+#else
+    depth = backtrace(frames, kSampleMaxDepth);
+    int first = 1;      // frames[0] is this function
+#endif
+    if (depth <= first)
+        return;
+
+    if (g_sampleStacks == NULL)
+        g_sampleStacks = new (std::nothrow) std::map<std::vector<PVOID>, ULONG64>();
+    if (g_sampleStacks == NULL)
+        return;
+
+    std::vector<PVOID> stack;
+    stack.reserve(depth - first);
+    for (int i = depth - 1; i >= first; i--)
+        stack.push_back(frames[i]);
+
+    (*g_sampleStacks)[stack]++;
+    g_sampleCount++;
+}
+
+void SOSSampleStart()
+{
+    if (g_sampleTimerThread != NULL)
+        return;
+    g_sampleTimerStop = 0;
+    g_sosSamplePending = 0;
+    g_sampleTimerThread = CreateThread(NULL, 0, SampleTimerProc, NULL, 0, NULL);
+}
+
+void SOSSampleStop()
+{
+    if (g_sampleTimerThread == NULL)
+        return;
+    g_sampleTimerStop = 1;
+    WaitForSingleObject(g_sampleTimerThread, INFINITE);
+    CloseHandle(g_sampleTimerThread);
+    g_sampleTimerThread = NULL;
+    g_sosSamplePending = 0;
+}
+
+// Appends the symbol for one host-process address, falling back to the raw
+// address when no symbol is available.
+static void AppendFrameName(std::string &line, PVOID address)
+{
+#ifndef FEATURE_PAL
+    static BOOL symInitialized = FALSE;
+    if (!symInitialized)
+    {
+        SymInitialize(GetCurrentProcess(), NULL, TRUE);
+        symInitialized = TRUE;
+    }
+    char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME] = {0};
+    SYMBOL_INFO *symbol = (SYMBOL_INFO *)buffer;
+    symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+    symbol->MaxNameLen = MAX_SYM_NAME;
+    DWORD64 displacement = 0;
+    if (SymFromAddr(GetCurrentProcess(), (DWORD64)(size_t)address, &displacement, symbol))
+    {
+        line += symbol->Name;
+        return;
+    }
+#else
+    Dl_info info;
+    if (dladdr(address, &info) != 0 && info.dli_sname != NULL)
+    {
+        line += info.dli_sname;
+        return;
+    }
+#endif
+    char raw[32];
+    sprintf_s(raw, _countof(raw), "0x%p", address);
+    line += raw;
+}
+
+void SOSSampleReport()
+{
+    if (g_sampleStacks == NULL || g_sampleStacks->empty())
+    {
+        ExtOut("No samples recorded.  Arm the sampler with !sosperf -sample.\n");
+        return;
+    }
+
+    ExtOut("%I64u samples at %d ms; collapsed stacks (root;...;leaf count):\n",
+           g_sampleCount, kSampleIntervalMs);
+    for (std::map<std::vector<PVOID>, ULONG64>::const_iterator it = g_sampleStacks->begin();
+         it != g_sampleStacks->end(); ++it)
+    {
+        std::string line;
+        for (size_t i = 0; i < it->first.size(); i++)
+        {
+            if (i != 0)
+                line += ';';
+            AppendFrameName(line, it->first[i]);
+        }
+        ExtOut("%s %I64u\n", line.c_str(), it->second);
+    }
+}
+
+void SOSSampleReset()
+{
+    if (g_sampleStacks != NULL)
+        g_sampleStacks->clear();
+    g_sampleCount = 0;
+}
+
 PDEBUG_CONTROL2       g_ExtControl;
 PDEBUG_DATA_SPACES    g_ExtData;
 PDEBUG_REGISTERS      g_ExtRegisters;
@@ -94,6 +741,10 @@ ExtQuery(ILLDBServices* services)
     SOS_ExtQueryFailGo(g_ExtSymbols2, IDebugSymbols2);
     SOS_ExtQueryFailGo(g_ExtAdvanced, IDebugAdvanced);
 #endif // FEATURE_PAL
+
+    // Remember the read totals so the per-command summary can print only
+    // what this command did.
+    g_readStatsBaseline = g_readStats;
     return S_OK;
 
  Fail:
@@ -152,6 +803,12 @@ ArchQuery(void)
 void
 ExtRelease(void)
 {
+    // Report what the command read before the output interfaces go away.
+    // ExtRelease also runs when ExtQuery fails partway through; nothing has
+    // been read then and nothing is printed.
+    if (g_readStatsVerbose && g_ExtControl != NULL && g_readStats.Changed(g_readStatsBaseline))
+        g_readStats.Print(g_readStatsBaseline);
+
     EXT_RELEASE(g_ExtControl);
     EXT_RELEASE(g_ExtData);
     EXT_RELEASE(g_ExtRegisters);
@@ -170,9 +170,38 @@ extern DWORD_PTR g_filterHint;
 
 extern BOOL ControlC;
 
+#ifndef FEATURE_PAL
+// Written by the interrupt watcher thread (see exts.cpp): Pending latches a
+// user interrupt the watcher saw, Running is nonzero once the thread exists.
+extern volatile LONG g_interruptPending;
+extern volatile LONG g_interruptWatcherRunning;
+#endif
+
+// TRUE once the user has requested cancellation.  While the watcher thread
+// is running this is a single volatile load -- cheap enough to test per
+// object, and safe from pool worker threads, which must not call into the
+// debugger interfaces themselves.  Without the watcher it falls back to
+// polling the debugger directly.
+inline BOOL SOSInterruptPending()
+{
+    if (ControlC)
+        return TRUE;
+
+#ifndef FEATURE_PAL
+    if (g_interruptWatcherRunning)
+        return g_interruptPending != 0;
+#endif
+
+    return g_ExtControl->GetInterrupt() == S_OK;
+}
+
 inline BOOL IsInterrupt()
 {
-    if (!ControlC && g_ExtControl->GetInterrupt() == S_OK)
+    // Every long-running loop polls here, which makes it a natural
+    // checkpoint for the cooperative stack sampler.
+    SOSSampleCheckpoint();
+
+    if (!ControlC && SOSInterruptPending())
     {
         ExtOut("Command cancelled at the user's request.\n");
         ControlC = TRUE;
@@ -181,6 +210,18 @@ inline BOOL IsInterrupt()
     return ControlC;
 }
 
+// Scopes the interrupt watcher's polling to the enclosing command (installed
+// by INIT_API_EXT).  On the PAL GetInterrupt never blocks or leaves the
+// plugin, so no watcher is needed and the scope compiles away.
+class InterruptWatcherScope
+{
+public:
+#ifndef FEATURE_PAL
+    InterruptWatcherScope();
+    ~InterruptWatcherScope();
+#endif
+};
+
 //
 // undef the wdbgexts
 //
@@ -241,6 +282,9 @@ HRESULT CheckEEDll();
 #define INIT_API_EXT()                                          \
     HRESULT Status;                                             \
     __ExtensionCleanUp __extensionCleanUp;                      \
+    SOSPerfScope __perfScope(__FUNCTION__);                     \
+    CommandArenaScope __arenaScope;                             \
+    InterruptWatcherScope __interruptScope;                     \
     if ((Status = ExtQuery(client)) != S_OK) return Status;     \
     ControlC = FALSE;                                           \
     g_bDacBroken = TRUE;                                        \
@@ -452,21 +496,8 @@ extern WINDBG_EXTENSION_APIS ExtensionApis;
 
 #endif // FEATURE_PAL
 
-#define CACHE_SIZE  DT_OS_PAGE_SIZE
- 
-struct ReadVirtualCache
-{
-    BYTE   m_cache[CACHE_SIZE];
-    TADDR  m_startCache;
-    BOOL   m_cacheValid;
-    ULONG  m_cacheSize;
-
-    ReadVirtualCache() { Clear(); }
-    HRESULT Read(TADDR Offset, PVOID Buffer, ULONG BufferSize, PULONG lpcbBytesRead);    
-    void Clear() { m_cacheValid = FALSE; m_cacheSize = CACHE_SIZE; }
-};
-
-extern ReadVirtualCache *rvCache;
+// CACHE_SIZE, ReadVirtualCache and the ReadVirtualStats counters live in
+// util.h so the inline read paths there can reference them.
 
 #define MOVE(dst, src) rvCache->Read(TO_TADDR(src), &(dst), sizeof(dst), NULL)
 #define MOVEBLOCK(dst, src, size) rvCache->Read(TO_TADDR(src), &(dst), size, NULL)
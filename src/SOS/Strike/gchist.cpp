@@ -32,6 +32,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <stddef.h>
+#include <unordered_map>
+#include <vector>
 
 #include "strike.h"
 // We need to define the target address type.  This will be used in the 
@@ -102,17 +104,38 @@ struct RelocRecord
     RelocRecord() { ZeroMemory(this,sizeof(RelocRecord)); }
 };
 
+// Address -> record indexes built as the log is replayed, so the per-object
+// Hist* commands do hash lookups instead of rescanning the flat lists for
+// every query.  The vectors hold records in insertion order; the lists they
+// shadow are built by prepending, so walking a vector backwards visits
+// records in list-traversal order.
+struct GCRecordIndex
+{
+    std::unordered_map<size_t, std::vector<PromoteRecord*> > PromoteByRoot;
+    std::unordered_map<size_t, std::vector<PromoteRecord*> > PromoteByValue;
+    std::unordered_map<size_t, std::vector<RelocRecord*> > RelocByRoot;
+    std::unordered_map<size_t, std::vector<RelocRecord*> > RelocByNewValue;
+    std::unordered_map<size_t, std::vector<RelocRecord*> > RelocByPrevValue;
+};
+
 struct GCRecord
 {
     ULONG64 GCCount;
-    
+
     // BOOL IsComplete() { return bFinished && bHaveStart; }
-    
+
     PlugRecord *PlugList;
     RelocRecord *RelocList;
     PromoteRecord *PromoteList;
+    GCRecordIndex *Index;
+
+    GCRecordIndex* EnsureIndex() {
+        if (Index == NULL)
+            Index = new GCRecordIndex();
+        return Index;
+    }
 
-    void AddPlug(PlugRecord& p) { 
+    void AddPlug(PlugRecord& p) {
         PlugRecord *pTmp = PlugList;
         PlugList = new PlugRecord(p);
         PlugList->next = pTmp;
@@ -122,12 +145,21 @@ struct GCRecord
         RelocRecord *pTmp = RelocList;
         RelocList = new RelocRecord(r);
         RelocList->next = pTmp;
+
+        GCRecordIndex *pIndex = EnsureIndex();
+        pIndex->RelocByRoot[RelocList->Root].push_back(RelocList);
+        pIndex->RelocByNewValue[RelocList->NewValue].push_back(RelocList);
+        pIndex->RelocByPrevValue[RelocList->PrevValue].push_back(RelocList);
     }
 
     void AddPromote(PromoteRecord& r) {
         PromoteRecord *pTmp = PromoteList;
         PromoteList = new PromoteRecord(r);
         PromoteList->next = pTmp;
+
+        GCRecordIndex *pIndex = EnsureIndex();
+        pIndex->PromoteByRoot[PromoteList->Root].push_back(PromoteList);
+        pIndex->PromoteByValue[PromoteList->Value].push_back(PromoteList);
     }
 
     UINT PlugCount() {
@@ -183,6 +215,8 @@ struct GCRecord
             pTravP = pTmp;
         }
 
+        delete Index;
+
         ZeroMemory(this,sizeof(GCRecord));
     }        
         
@@ -278,54 +312,46 @@ DECLARE_API(HistStats)
     }
 
     BOOL bErrorFound = FALSE;
-    
-    // Check for duplicate Reloc or Promote messages within one gc.
-    // Method is very inefficient, improve it later.
+
+    // Check for duplicate Reloc or Promote messages within one gc.  The
+    // per-root indexes make this a walk over the buckets instead of the
+    // old all-pairs comparison.
     for (UINT i=0; i < g_recordCount; i++)
-    {       
+    {
+        if (g_records[i].Index == NULL)
+        {
+            continue;
+        }
+
+        UINT GCCount = (UINT) g_records[i].GCCount;
+
         {   // Promotes
-            PromoteRecord *Iter = g_records[i].PromoteList;
-            UINT GCCount = (UINT) g_records[i].GCCount;
-            while (Iter) 
+            std::unordered_map<size_t, std::vector<PromoteRecord*> >::const_iterator itr;
+            for (itr = g_records[i].Index->PromoteByRoot.begin(); itr != g_records[i].Index->PromoteByRoot.end(); ++itr)
             {
-                PromoteRecord *innerIter = Iter->next;
-                while (innerIter)
+                if (itr->second.size() > 1)
                 {
-                    if (Iter->Root == innerIter->Root)
-                    {
-                        ExtOut ("Root %p promoted multiple times in gc %d\n",
-                            SOS_PTR(Iter->Root),
-                            GCCount);
-                        bErrorFound = TRUE;
-                    }
-                    innerIter = innerIter->next;
+                    ExtOut ("Root %p promoted multiple times in gc %d\n",
+                        SOS_PTR(itr->first),
+                        GCCount);
+                    bErrorFound = TRUE;
                 }
-                
-                Iter = Iter->next;            
             }
         }
 
         {   // Relocates
-            RelocRecord *Iter = g_records[i].RelocList;
-            UINT GCCount = (UINT) g_records[i].GCCount;
-            while (Iter) 
+            std::unordered_map<size_t, std::vector<RelocRecord*> >::const_iterator itr;
+            for (itr = g_records[i].Index->RelocByRoot.begin(); itr != g_records[i].Index->RelocByRoot.end(); ++itr)
             {
-                RelocRecord *innerIter = Iter->next;
-                while (innerIter)
+                if (itr->second.size() > 1)
                 {
-                    if (Iter->Root == innerIter->Root)
-                    {
-                        ExtOut ("Root %p relocated multiple times in gc %d\n",
-                            SOS_PTR(Iter->Root),
-                            GCCount);
-                        bErrorFound = TRUE;
-                    }
-                    innerIter = innerIter->next;
+                    ExtOut ("Root %p relocated multiple times in gc %d\n",
+                        SOS_PTR(itr->first),
+                        GCCount);
+                    bErrorFound = TRUE;
                 }
-                
-                Iter = Iter->next;            
             }
-        }        
+        }
     }
 
     if (!bErrorFound)
@@ -370,43 +396,30 @@ DECLARE_API(HistRoot)
     {
         UINT GCCount = (UINT) g_records[i].GCCount;
 
-        // Find promotion records...there should only be one.
-        PromoteRecord *pPtr = g_records[i].PromoteList;
+        // Find promotion records...there should only be one.  The back of
+        // an index bucket is the record the old list scan found first.
         PromoteRecord *pPromoteRec = NULL;
         bool bPromotedMoreThanOnce = false;
-        while(pPtr)
+        RelocRecord *pRelocRec = NULL;
+        bool bRelocatedMoreThanOnce = false;
+
+        if (g_records[i].Index != NULL)
         {
-            if (pPtr->Root == Root)
+            std::unordered_map<size_t, std::vector<PromoteRecord*> >::const_iterator promoted =
+                g_records[i].Index->PromoteByRoot.find(Root);
+            if (promoted != g_records[i].Index->PromoteByRoot.end())
             {
-                if (pPromoteRec)
-                {
-                    bPromotedMoreThanOnce = true;
-                }
-                else
-                {
-                    pPromoteRec = pPtr;
-                }
+                pPromoteRec = promoted->second.back();
+                bPromotedMoreThanOnce = promoted->second.size() > 1;
             }
-            pPtr = pPtr->next;
-        }
 
-        RelocRecord *pReloc = g_records[i].RelocList;
-        RelocRecord *pRelocRec = NULL;
-        bool bRelocatedMoreThanOnce = false;
-        while(pReloc)
-        {
-            if (pReloc->Root == Root)
+            std::unordered_map<size_t, std::vector<RelocRecord*> >::const_iterator relocated =
+                g_records[i].Index->RelocByRoot.find(Root);
+            if (relocated != g_records[i].Index->RelocByRoot.end())
             {
-                if (pRelocRec)
-                {
-                    bRelocatedMoreThanOnce = true;
-                }
-                else
-                {
-                    pRelocRec = pReloc;
-                }
+                pRelocRec = relocated->second.back();
+                bRelocatedMoreThanOnce = relocated->second.size() > 1;
             }
-            pReloc = pReloc->next;
         }
 
         // Validate the records found for this root.
@@ -489,37 +502,60 @@ DECLARE_API(HistObjFind)
             break;
         }
         
-        UINT GCCount = (UINT) g_records[i].GCCount;        
+        UINT GCCount = (UINT) g_records[i].GCCount;
 
-        PromoteRecord *pPtr = g_records[i].PromoteList;
-        while(pPtr)
+        if (g_records[i].Index != NULL)
         {
-            if (pPtr->Value  == curAddress)
+            GCRecordIndex *pIndex = g_records[i].Index;
+
+            std::unordered_map<size_t, std::vector<PromoteRecord*> >::const_iterator promoted =
+                pIndex->PromoteByValue.find(curAddress);
+            if (promoted != pIndex->PromoteByValue.end())
             {
-                bBoringPeople = false;
-                ExtOut ("%8d %p ", GCCount, SOS_PTR(curAddress));
-                ExtOut ("Promotion for root %p (MT = %p)\n",
-                    SOS_PTR(pPtr->Root),
-                    SOS_PTR(pPtr->methodTable));
+                for (size_t j = promoted->second.size(); j > 0; j--)
+                {
+                    PromoteRecord *pPtr = promoted->second[j - 1];
+                    bBoringPeople = false;
+                    ExtOut ("%8d %p ", GCCount, SOS_PTR(curAddress));
+                    ExtOut ("Promotion for root %p (MT = %p)\n",
+                        SOS_PTR(pPtr->Root),
+                        SOS_PTR(pPtr->methodTable));
+                }
             }
-            pPtr = pPtr->next;
-        }
 
-        RelocRecord *pReloc = g_records[i].RelocList;
-        while(pReloc)
-        {
-            if (pReloc->NewValue == curAddress ||
-                pReloc->PrevValue == curAddress)
+            std::unordered_map<size_t, std::vector<RelocRecord*> >::const_iterator relocated =
+                pIndex->RelocByNewValue.find(curAddress);
+            if (relocated != pIndex->RelocByNewValue.end())
             {
-                bBoringPeople = false;
-                ExtOut ("%8d %p ", GCCount, SOS_PTR(curAddress));
-                ExtOut ("Relocation %s for root %p\n",
-                    (pReloc->NewValue == curAddress) ? "NEWVALUE" : "PREVVALUE",
-                    SOS_PTR(pReloc->Root));
+                for (size_t j = relocated->second.size(); j > 0; j--)
+                {
+                    bBoringPeople = false;
+                    ExtOut ("%8d %p ", GCCount, SOS_PTR(curAddress));
+                    ExtOut ("Relocation NEWVALUE for root %p\n",
+                        SOS_PTR(relocated->second[j - 1]->Root));
+                }
+            }
+
+            relocated = pIndex->RelocByPrevValue.find(curAddress);
+            if (relocated != pIndex->RelocByPrevValue.end())
+            {
+                for (size_t j = relocated->second.size(); j > 0; j--)
+                {
+                    RelocRecord *pReloc = relocated->second[j - 1];
+
+                    // Records whose new value also matches were reported
+                    // above, the same way the list scan printed them once.
+                    if (pReloc->NewValue == curAddress)
+                        continue;
+
+                    bBoringPeople = false;
+                    ExtOut ("%8d %p ", GCCount, SOS_PTR(curAddress));
+                    ExtOut ("Relocation PREVVALUE for root %p\n",
+                        SOS_PTR(pReloc->Root));
+                }
             }
-            pReloc = pReloc->next;
         }
-        
+
         if (!bBoringPeople)
         {
             ExtOut ("...\n");
@@ -530,35 +566,17 @@ DECLARE_API(HistObjFind)
     return Status;
 }
 
-DECLARE_API(HistObj)
+// Walks one object's address back through the recorded GCs, printing the
+// roots that relocated to it.  Shared by the single-object and -list forms
+// of !HistObj.
+static void GcHistDumpObject(size_t object)
 {
-    INIT_API();
-    size_t nArg;
-
-    StringHolder objstr;
-    CMDValue arg[] = 
-    {
-        // vptr, type
-        {&objstr.data, COSTRING},
-    };
-
-    if (!GetCMDOption(args, NULL, 0, arg, _countof(arg), &nArg))
-        return Status;
-
-    if (nArg != 1)
-    {
-        ExtOut ("!object <valid object pointer>\n");
-        return Status;
-    }
-
-    size_t object = (size_t) GetExpression(objstr.data);
-    
     ExtOut ("%8s %" POINTERSIZE "s %40s\n",
         "GCCount", "Object", "Roots");
     ExtOut ("---------------------------------------------------------\n");
 
     size_t curAddress = object;
-    
+
     // Just traverse the data structure, printing basic stats
     for (UINT i=0; i < g_recordCount; i++)
     {
@@ -566,35 +584,106 @@ DECLARE_API(HistObj)
         {
             break;
         }
-        
+
         UINT GCCount = (UINT) g_records[i].GCCount;
 
         ExtOut ("%8d %p ", GCCount, SOS_PTR(curAddress));
 
-        RelocRecord *pReloc = g_records[i].RelocList;
         size_t candidateCurAddress = curAddress;
         bool bFirstReloc = true;
-        while(pReloc)
+
+        if (g_records[i].Index != NULL)
         {
-            if (pReloc->NewValue == curAddress)
+            std::unordered_map<size_t, std::vector<RelocRecord*> >::const_iterator relocated =
+                g_records[i].Index->RelocByNewValue.find(curAddress);
+            if (relocated != g_records[i].Index->RelocByNewValue.end())
             {
-                ExtOut ("%p, ", SOS_PTR(pReloc->Root));
-                if (bFirstReloc)
-                {
-                    candidateCurAddress = pReloc->PrevValue;
-                    bFirstReloc = false;
-                }
-                else if (candidateCurAddress != pReloc->PrevValue)
+                for (size_t j = relocated->second.size(); j > 0; j--)
                 {
-                    ExtOut ("differing reloc values for this object!\n");
+                    RelocRecord *pReloc = relocated->second[j - 1];
+                    ExtOut ("%p, ", SOS_PTR(pReloc->Root));
+                    if (bFirstReloc)
+                    {
+                        candidateCurAddress = pReloc->PrevValue;
+                        bFirstReloc = false;
+                    }
+                    else if (candidateCurAddress != pReloc->PrevValue)
+                    {
+                        ExtOut ("differing reloc values for this object!\n");
+                    }
                 }
             }
-            pReloc = pReloc->next;
         }
 
         ExtOut ("\n");
-        curAddress = candidateCurAddress;                
-    }    
+        curAddress = candidateCurAddress;
+    }
+}
+
+DECLARE_API(HistObj)
+{
+    INIT_API();
+    size_t nArg;
+
+    StringHolder objstr, liststr;
+    CMDOption option[] =
+    {   // name, vptr, type, hasValue
+        {"-list", &liststr.data, COSTRING, TRUE},
+    };
+    CMDValue arg[] =
+    {
+        // vptr, type
+        {&objstr.data, COSTRING},
+    };
+
+    if (!GetCMDOption(args, option, _countof(option), arg, _countof(arg), &nArg))
+        return Status;
+
+    if (liststr.data != NULL)
+    {
+        // Batch mode: one object address or expression per line.
+        FILE *list = fopen(liststr.data, "r");
+        if (list == NULL)
+        {
+            ExtOut ("Unable to open list file '%s'\n", liststr.data);
+            return E_FAIL;
+        }
+
+        char line[128];
+        while (fgets(line, _countof(line), list) != NULL)
+        {
+            if (IsInterrupt())
+                break;
+
+            // Strip the newline so GetExpression sees a clean expression.
+            line[strcspn(line, "\r\n")] = 0;
+            if (line[0] == 0)
+                continue;
+
+            size_t object = (size_t) GetExpression(line);
+            if (object == 0)
+            {
+                ExtOut ("Skipping unparsable entry '%s'\n", line);
+                continue;
+            }
+
+            GcHistDumpObject(object);
+            ExtOut ("\n");
+        }
+
+        fclose(list);
+        return Status;
+    }
+
+    if (nArg != 1)
+    {
+        ExtOut ("!object <valid object pointer>\n");
+        return Status;
+    }
+
+    size_t object = (size_t) GetExpression(objstr.data);
+
+    GcHistDumpObject(object);
     return Status;
 }
 
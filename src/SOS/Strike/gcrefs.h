@@ -0,0 +1,217 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "strike.h"
+#include "util.h"
+#include "gcdesc.h"
+
+#include <vector>
+
+/* A shared walk of an object's GCDesc series.
+ *
+ * The series arithmetic (normal objects walk the series from the highest
+ * down, adding the object size back to each adjusted series length; arrays
+ * of value classes repeat a coded serie across the components) has been
+ * re-implemented by every consumer that needs an object's references.
+ * GCRefSpan runs that walk once against a host copy of the GCDesc,
+ * collects the reference slot runs, and reads every slot of the object
+ * with a single scatter-gather request.  The slot addresses and values
+ * are then available as a contiguous span, so per-object reference
+ * enumeration costs one target read no matter how many series the type
+ * has.
+ *
+ * Usage:
+ *     GCRefSpan refs(obj, size, map, arrayOfVC);
+ *     refs.ReadAll();
+ *     for (unsigned i = 0; i < refs.Count(); ++i)
+ *         if (refs.Valid(i) && refs.Value(i) != 0)
+ *             Process(refs.Address(i), refs.Value(i));
+ */
+class GCRefSpan
+{
+public:
+    /* obj/size describe the object in the target; map points at the host
+     * copy of its CGCDesc (the address just past the slot buffer, exactly
+     * as the existing consumers build it); arrayOfVC is true when the
+     * GCDesc's series count was negative.
+     */
+    GCRefSpan(TADDR obj, size_t size, CGCDesc *map, bool arrayOfVC)
+        : mObject(obj)
+    {
+        if (!arrayOfVC)
+        {
+            CGCDescSeries *cur = map->GetHighestSeries();
+            CGCDescSeries *last = map->GetLowestSeries();
+
+            while (cur >= last)
+            {
+                AddRun(obj + cur->GetSeriesOffset(),
+                       (cur->GetSeriesSize() + size) / sizeof(TADDR));
+                cur--;
+            }
+        }
+        else
+        {
+            // The coded serie walks forward through the components,
+            // alternating runs of pointers with skips, until it falls off
+            // the data portion of the array.
+            CGCDescSeries *cur = map->GetHighestSeries();
+            int cnt = (int)map->GetNumSeries();
+
+            TADDR parm = obj + cur->startoffset;
+            while (parm < obj + size - plug_skew)
+            {
+                for (int i = 0; i > cnt; i--)
+                {
+                    unsigned nptrs = cur->val_serie[i].nptrs;
+
+                    AddRun(parm, nptrs);
+                    parm += nptrs * sizeof(TADDR) + cur->val_serie[i].skip;
+
+                    if (parm >= obj + size - plug_skew)
+                        break;
+                }
+            }
+        }
+    }
+
+    /* Issues one batched read covering every reference slot.  Individual
+     * runs succeed or fail on their own; check Valid() per slot.  Returns
+     * true if at least one slot was read (or there were none to read).
+     */
+    bool ReadAll()
+    {
+        if (mRuns.empty())
+            return true;
+
+        std::vector<ReadVirtualRange> ranges(mRuns.size());
+        for (size_t r = 0; r < mRuns.size(); r++)
+        {
+            ranges[r].Address = mRuns[r].start;
+            ranges[r].Buffer = &mValues[mRuns[r].first];
+            ranges[r].Size = (ULONG)(mRuns[r].count * sizeof(TADDR));
+        }
+
+        ReadVirtualBatch(ranges.data(), (ULONG)ranges.size());
+
+        bool any = false;
+        for (size_t r = 0; r < mRuns.size(); r++)
+        {
+            // A short read validates only the slots it covered.
+            unsigned good = SUCCEEDED(ranges[r].Status)
+                            ? ranges[r].BytesRead / (unsigned)sizeof(TADDR)
+                            : 0;
+            if (good > mRuns[r].count)
+                good = mRuns[r].count;
+
+            for (unsigned i = 0; i < good; i++)
+                mValid[mRuns[r].first + i] = true;
+
+            any |= good != 0;
+        }
+
+        return any;
+    }
+
+    unsigned Count() const
+    {
+        return (unsigned)mValues.size();
+    }
+
+    /* The target address of reference slot i.
+     */
+    TADDR Address(unsigned i) const
+    {
+        const Run &run = RunOf(i);
+        return run.start + (i - run.first) * sizeof(TADDR);
+    }
+
+    /* The offset of reference slot i within the object.
+     */
+    TADDR Offset(unsigned i) const
+    {
+        return Address(i) - mObject;
+    }
+
+    /* True if ReadAll was able to read slot i.
+     */
+    bool Valid(unsigned i) const
+    {
+        return mValid[i];
+    }
+
+    /* The value of reference slot i; only meaningful when Valid(i).
+     */
+    TADDR Value(unsigned i) const
+    {
+        return mValues[i];
+    }
+
+    /* The whole span of slot values, Count() entries.
+     */
+    const TADDR *Values() const
+    {
+        return mValues.data();
+    }
+
+private:
+    struct Run
+    {
+        TADDR start;        // target address of the first slot
+        unsigned first;     // index of that slot in the span
+        unsigned count;     // number of slots in the run
+    };
+
+    void AddRun(TADDR start, size_t count)
+    {
+        if (count == 0)
+            return;
+
+        // Series are contiguous within a run, so adjacent runs can merge;
+        // the batch then issues one range for them.
+        if (!mRuns.empty())
+        {
+            Run &tail = mRuns.back();
+            if (tail.start + tail.count * sizeof(TADDR) == start)
+            {
+                tail.count += (unsigned)count;
+                mValues.resize(mValues.size() + count, 0);
+                mValid.resize(mValid.size() + count, false);
+                return;
+            }
+        }
+
+        Run run;
+        run.start = start;
+        run.first = (unsigned)mValues.size();
+        run.count = (unsigned)count;
+        mRuns.push_back(run);
+
+        mValues.resize(mValues.size() + count, 0);
+        mValid.resize(mValid.size() + count, false);
+    }
+
+    const Run &RunOf(unsigned i) const
+    {
+        // Runs are in span order; binary search for the one containing i.
+        size_t lo = 0, hi = mRuns.size() - 1;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi + 1) / 2;
+            if (mRuns[mid].first <= i)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        return mRuns[lo];
+    }
+
+private:
+    TADDR mObject;
+    std::vector<Run> mRuns;
+    std::vector<TADDR> mValues;
+    std::vector<bool> mValid;
+};
@@ -38,6 +38,10 @@
 #include "gcdesc.h"
 
 #include "safemath.h"
+#include "heapwalk.h"
+#include "radixsort.h"
+
+#include <algorithm>
 
 
 #undef _ASSERTE
@@ -62,38 +66,174 @@ inline void* ALIGN_DOWN( void* val, size_t alignment )
     return (void*) ALIGN_DOWN( (size_t)val, alignment );
 }
 
-LinearReadCache::LinearReadCache(ULONG pageSize)
-    : mCurrPageStart(0), mPageSize(pageSize), mCurrPageSize(0), mPage(0)
+LinearReadCache::LinearReadCache(ULONG pageSize, int pageCount)
+    : mPageSize(pageSize), mPageCount(pageCount), mPages(0), mMru(0), mClock(0),
+      mLastMissBase(0), mReadAhead(0), mReadAheadPages(0), mAccountedBytes(0)
 {
-    mPage = new BYTE[pageSize];
+    // 0 means "use the process-wide setting" so the geometry can be tuned
+    // without touching every construction site.
+    if (mPageSize == 0)
+        mPageSize = g_linearCachePageSize;
+    if (mPageCount == 0)
+        mPageCount = g_linearCachePageCount;
+
+    // The page lookup relies on page-aligned starts, so round the page size up
+    // to a power of two.
+    while (mPageSize & (mPageSize - 1))
+        mPageSize = (mPageSize | (mPageSize - 1)) + 1;
+
+    if (mPageCount < 1)
+        mPageCount = 1;
+
+    mPages = new Page[mPageCount];
+    if (mPages != NULL)
+    {
+        // One allocation backs every page; mPages[0].data owns it.
+        BYTE *data = new BYTE[(size_t)mPageSize * mPageCount];
+        if (data == NULL)
+        {
+            delete [] mPages;
+            mPages = NULL;
+        }
+        else
+        {
+            for (int i = 0; i < mPageCount; i++)
+            {
+                mPages[i].start = 0;
+                mPages[i].size = 0;
+                mPages[i].lastUsed = 0;
+                mPages[i].data = data + (size_t)i * mPageSize;
+            }
+
+            mMru = mPages;
+        }
+    }
+
+    if (mPages != NULL)
+    {
+        // The streaming read-ahead is an optimization; running without the
+        // scratch buffer just means one read per page again.
+        mReadAheadPages = mPageCount < 8 ? mPageCount : 8;
+        mReadAhead = new BYTE[(size_t)mPageSize * mReadAheadPages];
+        if (mReadAhead == NULL)
+            mReadAheadPages = 0;
+    }
+
+    if (mPages != NULL)
+    {
+        mAccountedBytes = sizeof(Page) * mPageCount + (size_t)mPageSize * (mPageCount + mReadAheadPages);
+        SOSMemAdd(SOSMemReadCache, mAccountedBytes);
+    }
+
     ClearStats();
 }
 
 LinearReadCache::~LinearReadCache()
 {
-    if (mPage)
-        delete [] mPage;
+    SOSMemSub(SOSMemReadCache, mAccountedBytes);
+
+    if (mPages)
+    {
+        delete [] mPages[0].data;
+        delete [] mPages;
+    }
+
+    if (mReadAhead)
+        delete [] mReadAhead;
+}
+
+LinearReadCache::Page *LinearReadCache::EvictLru()
+{
+    Page *page = &mPages[0];
+    for (int i = 1; i < mPageCount; i++)
+        if (mPages[i].lastUsed < page->lastUsed)
+            page = &mPages[i];
+
+    // A non-empty victim means the cache is full and churning; the
+    // eviction rate relative to fills is how "!sosperf -dac" shows that
+    // the configured page count is too small for the access pattern.
+    if (page->start != 0)
+        g_readStats.PageEvictions++;
+
+    return page;
 }
 
-bool LinearReadCache::MoveToPage(TADDR addr, unsigned int size)
+LinearReadCache::Page *LinearReadCache::MoveToPage(TADDR base)
 {
-    if (size > mPageSize)
-        size = mPageSize;
+    // Two misses in a row on adjacent pages mean the caller is streaming
+    // forward (object iterators, stack scans, the finalize queue).  Fetch a
+    // run of pages with one read so the next several lookups are hits; the
+    // walking thread then only stalls once per run instead of once per page.
+    bool streaming = (mLastMissBase != 0 && base == mLastMissBase + mPageSize);
+    mLastMissBase = base;
+
+    if (streaming && mReadAheadPages > 1)
+    {
+        ULONG fetched = 0;
+
+        g_readStats.Calls++;
+        g_readStats.BytesRequested += mPageSize * mReadAheadPages;
+
+        if (SUCCEEDED(g_ExtData->ReadVirtual(base, mReadAhead, mPageSize * mReadAheadPages, &fetched)) && fetched > 0)
+        {
+            Page *result = NULL;
+
+            g_readStats.BytesRead += fetched;
+
+            for (ULONG offset = 0; offset < fetched; offset += mPageSize)
+            {
+                Page *page = EvictLru();
+                page->start = base + offset;
+                page->lastUsed = ++mClock;
+                page->size = (fetched - offset < mPageSize) ? (fetched - offset) : mPageSize;
+                memcpy(page->data, mReadAhead + offset, page->size);
 
-    mCurrPageStart = addr;
-    HRESULT hr = g_ExtData->ReadVirtual(mCurrPageStart, mPage, size, &mCurrPageSize);
+                g_readStats.PageFills++;
+
+                if (offset == 0)
+                    result = page;
+            }
+
+#ifdef _DEBUG
+            mMisses++;
+#endif
+
+            mMru = result;
+            return result;
+        }
+
+        // The block read may fail across an unmapped boundary where the
+        // single page is still readable, so fall through and try it alone.
+    }
+
+    // Evict the least recently used page.
+    Page *page = EvictLru();
+
+    page->start = base;
+    page->lastUsed = ++mClock;
+
+    g_readStats.Calls++;
+    g_readStats.BytesRequested += mPageSize;
+
+    HRESULT hr = g_ExtData->ReadVirtual(base, page->data, mPageSize, &page->size);
 
     if (hr != S_OK)
     {
-        mCurrPageStart = 0;
-        mCurrPageSize = 0;
-        return false;
+        page->start = 0;
+        page->size = 0;
+        page->lastUsed = 0;
+        return NULL;
     }
 
+    g_readStats.BytesRead += page->size;
+    g_readStats.PageFills++;
+
 #ifdef _DEBUG
     mMisses++;
 #endif
-    return true;
+
+    mMru = page;
+    return page;
 }
 
 
@@ -122,221 +262,1030 @@ static const char *NameForHandle(unsigned int type)
     return "unknown";
 }
 
+bool FetchSortedHandleTable(ISOSHandleEnum *pEnum, std::vector<SOSHandleData> &handles)
+{
+    // GCC can't handle stacks which are too large.
+#ifndef FEATURE_PAL
+    SOSHandleData data[256];
+#else
+    SOSHandleData data[64];
+#endif
+
+    unsigned int fetched = 0;
+    do
+    {
+        if (FAILED(pEnum->Next(_countof(data), data, &fetched)))
+            return false;
+
+        handles.insert(handles.end(), data, data + fetched);
+    } while (_countof(data) == fetched);
+
+    RadixSortByKey(handles,
+        [](const SOSHandleData &handle)
+        {
+            return (ULONG64)handle.Handle;
+        });
+
+    return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // GCRoot functions to cleanup data.
 ///////////////////////////////////////////////////////////////////////////////
 void GCRootImpl::ClearSizeData()
 {
     mConsidered.clear();
-    mSizes.clear();
+    mSizes.Clear();
 }
 
-void GCRootImpl::ClearAll()
+///////////////////////////////////////////////////////////////////////////////
+// VisitedBitmap.
+///////////////////////////////////////////////////////////////////////////////
+
+bool VisitedBitmap::Init()
 {
-    ClearNodes();
+    Clear();
 
+    if (!g_snapshot.Build())
+        return false;
+
+    for (int i = 0; i < g_snapshot.GetSegmentCount(); i++)
     {
-        std::unordered_map<TADDR, MTInfo*>::iterator itr;
-        for (itr = mMTs.begin(); itr != mMTs.end(); ++itr)
-            delete itr->second;
-    }
-    
-    {
-        std::unordered_map<TADDR, RootNode*>::iterator itr;
-        for (itr = mTargets.begin(); itr != mTargets.end(); ++itr)
-            delete itr->second;
+        const DacpHeapSegmentData *segment = g_snapshot.GetSegmentByIndex(i);
+
+        SegmentBits seg;
+        seg.Start = TO_TADDR(segment->mem);
+        seg.End = TO_TADDR(segment->highAllocMark);
+        if (seg.End <= seg.Start)
+            continue;
+
+        // One bit per 8 bytes of committed segment space.
+        size_t cb = ((seg.End - seg.Start) / 8 + 7) / 8;
+        seg.Bits = new BYTE[cb];
+        if (seg.Bits == NULL)
+        {
+            Clear();
+            return false;
+        }
+
+        memset(seg.Bits, 0, cb);
+        mSegments.push_back(seg);
     }
 
-    mMTs.clear();
-    mTargets.clear();
-    mConsidered.clear();
-    mSizes.clear();
-    mDependentHandleMap.clear();
-    mCache.ClearStats();
-    
-    mAll = false;
-    mSize = false;
+    std::sort(mSegments.begin(), mSegments.end(),
+        [](const SegmentBits &lhs, const SegmentBits &rhs)
+        {
+            return lhs.Start < rhs.Start;
+        });
+
+    return true;
 }
 
-void GCRootImpl::ClearNodes()
+void VisitedBitmap::Clear()
 {
-    std::list<RootNode*>::iterator itr;
+    for (size_t i = 0; i < mSegments.size(); i++)
+        delete [] mSegments[i].Bits;
 
-    for  (itr = mCleanupList.begin(); itr != mCleanupList.end(); ++itr)
-        delete *itr;
-
-    mCleanupList.clear();
-    mRootNewList.clear();
+    mSegments.clear();
+    mOverflow.clear();
 }
 
-GCRootImpl::RootNode *GCRootImpl::NewNode(TADDR obj, MTInfo *mtInfo, bool fromDependent)
+VisitedBitmap::SegmentBits *VisitedBitmap::Find(TADDR obj) const
 {
-    // We need to create/destroy a TON of nodes during execution of GCRoot functions.
-    // To avoid heap fragmentation (and since it's faster), we don't actually new/delete
-    // nodes unless we have to.  Instead we keep a stl list with free nodes to use.
-    RootNode *toReturn = NULL;
-    
-    if (mRootNewList.size())
+    // Binary search for the segment with the greatest Start <= obj.
+    int lo = 0, hi = (int)mSegments.size() - 1, found = -1;
+    while (lo <= hi)
     {
-        toReturn = mRootNewList.back();
-        mRootNewList.pop_back();
-    }
-    else
-    {
-        toReturn = new RootNode();
-        mCleanupList.push_back(toReturn);
+        int mid = (lo + hi) / 2;
+        if (mSegments[mid].Start <= obj)
+        {
+            found = mid;
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
     }
 
-    toReturn->Object = obj;
-    toReturn->MTInfo = mtInfo;
-    toReturn->FromDependentHandle = fromDependent;
-    return toReturn;
+    if (found == -1 || obj >= mSegments[found].End)
+        return NULL;
+
+    return const_cast<SegmentBits*>(&mSegments[found]);
 }
 
-void GCRootImpl::DeleteNode(RootNode *node)
+bool VisitedBitmap::Contains(TADDR obj) const
 {
-    // Add node to the "new list".
-    node->Clear();
-    mRootNewList.push_back(node);
+    const SegmentBits *seg = Find(obj);
+    if (seg == NULL)
+        return mOverflow.find(obj) != mOverflow.end();
+
+    size_t bit = (obj - seg->Start) >> 3;
+    return (seg->Bits[bit >> 3] & (1 << (bit & 7))) != 0;
 }
 
-void GCRootImpl::GetDependentHandleMap(std::unordered_map<TADDR, std::list<TADDR>> &map)
+bool VisitedBitmap::Add(TADDR obj)
 {
-    unsigned int type = HNDTYPE_DEPENDENT;
-    ToRelease<ISOSHandleEnum> handles;
-    
-    HRESULT hr = g_sos->GetHandleEnumForTypes(&type, 1, &handles);
-    
-    if (FAILED(hr))
+    SegmentBits *seg = Find(obj);
+    if (seg == NULL)
+        return mOverflow.insert(obj).second;
+
+    size_t bit = (obj - seg->Start) >> 3;
+    BYTE mask = (BYTE)(1 << (bit & 7));
+
+    if (seg->Bits[bit >> 3] & mask)
+        return false;
+
+    seg->Bits[bit >> 3] |= mask;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Segment layout hash.
+///////////////////////////////////////////////////////////////////////////////
+
+/* A 64 bit FNV-1a hash of the GC segment layout of the target, used as a
+ * cheap fingerprint of the heap state: two targets with every segment at the
+ * same address and fill level are the same heap for our purposes, and
+ * resuming a live target moves the allocation pointers, changing the hash.
+ * The caller must have built g_snapshot.
+ */
+static ULONG64 HashSegmentLayout()
+{
+    ULONG64 hash = 14695981039346656037ULL;
+    for (int i = 0; i < g_snapshot.GetSegmentCount(); ++i)
     {
-        ExtOut("Failed to walk dependent handles.  GCRoot may miss paths.\n");
-        return;
+        const DacpHeapSegmentData *segment = g_snapshot.GetSegmentByIndex(i);
+        ULONG64 data[] = { segment->segmentAddr, segment->mem, segment->highAllocMark };
+
+        const BYTE *bytes = (const BYTE *)data;
+        for (size_t b = 0; b < sizeof(data); ++b)
+            hash = (hash ^ bytes[b]) * 1099511628211ULL;
     }
-    
-    SOSHandleData data[4];
-    unsigned int fetched = 0;
-    
-    do
-    {
-        hr = handles->Next(_countof(data), data, &fetched);
-        
-        if (FAILED(hr))
-        {
-            ExtOut("Error walking dependent handles.  GCRoot may miss paths.\n");
-            return;
-        }
-        
-        for (unsigned int i = 0; i < fetched; ++i)
-        {
-            if (data[i].Secondary != 0)
-            {
-                TADDR obj = 0;
-                TADDR target = TO_TADDR(data[i].Secondary);
-                
-                MOVE(obj, TO_TADDR(data[i].Handle));
-                
-                map[obj].push_back(target);
-            }
-        }
-    } while (fetched == _countof(data));
+
+    return hash;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Public functions.
+// ObjSize memoization.
 ///////////////////////////////////////////////////////////////////////////////
-int GCRootImpl::PrintRootsForObject(TADDR target, bool all, bool noStacks)
-{
-    ClearAll();
-    GetDependentHandleMap(mDependentHandleMap);
-    
-    mAll = all;
 
-    // Add "target" to the mTargets list.
-    TADDR mt = ReadPointerCached(target);
-    RootNode *node = NewNode(target, GetMTInfo(mt));
-    mTargets[target] = node;
+/* objsize answers are exact closure sizes and the object graph of a stopped
+ * target doesn't change, so remember them across invocations.  The cache is
+ * keyed by the segment layout hash: resuming a live target changes the key
+ * and throws the stale entries away, while against a dump the cache lives
+ * for the whole session.
+ */
+static ULONG64 s_sizeCacheKey = 0;
+static SharedAddressMap s_sizeCache;
 
-    // Look for roots on the HandleTable, FQ, and all threads.
-    int count = 0;
-    
-    if (!noStacks)
-        count += PrintRootsOnAllThreads();
-    
-    count += PrintRootsOnHandleTable();
-    count += PrintRootsOnFQ();
+static SharedAddressMap *GetObjSizeCache()
+{
+    if (!g_snapshot.Build())
+        return NULL;
 
-    if(count == 0)
+    ULONG64 key = HashSegmentLayout();
+    if (key != s_sizeCacheKey)
     {
-        count += PrintRootsOnFQ(true);
-        if(count)
-        {
-            ExtOut("Warning: These roots are from finalizable objects that are not yet ready for finalization.\n");
-            ExtOut("This is to handle the case where objects re-register themselves for finalization.\n");
-            ExtOut("These roots may be false positives.\n");
-        }
+        s_sizeCache.Clear();
+        s_sizeCacheKey = key;
     }
 
-    mCache.PrintStats(__FUNCTION__);
-    return count;
+    return &s_sizeCache;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// ObjectGraphIndex.
+///////////////////////////////////////////////////////////////////////////////
 
-bool GCRootImpl::PrintPathToObject(TADDR root, TADDR target)
+/* The object graph of a dump never changes, yet every gcroot/objsize run used
+ * to rediscover it by pulling each object through the DAC.  The first run in a
+ * session now serializes the graph - object addresses, sizes and outgoing
+ * references in CSR layout - to a file in the temp directory, keyed by the GC
+ * segment layout of the dump.  Later runs, in this session or a new one
+ * against the same dump, map the file and answer reference queries without
+ * touching the target at all.  Live targets never use the index since their
+ * heaps change between commands.
+ */
+struct ObjectGraphFileHeader
 {
-    ClearAll();
-    GetDependentHandleMap(mDependentHandleMap);
-    
-    // Add "target" to the mTargets list.
-    TADDR mt = ReadPointerCached(target);
-    RootNode *node = NewNode(target, GetMTInfo(mt));
-    mTargets[target] = node;
+    char Magic[8];
+    DWORD Version;
+    DWORD PointerSize;
+    ULONG64 SegmentCount;   // ObjectGraphFileSegment[SegmentCount] follows the header
+    ULONG64 ObjectCount;    // then ULONG64 addresses, sizes and ObjectCount+1 CSR row starts
+    ULONG64 RefCount;       // then the ULONG64 reference targets the rows point into
+};
 
-    // Check to see if the root reaches the target.
-    RootNode *path = FindPathToTarget(root);
-    if (path)
+struct ObjectGraphFileSegment
+{
+    ULONG64 Segment;
+    ULONG64 Start;
+    ULONG64 End;
+};
+
+static const char kObjectGraphMagic[8] = { 'S', 'O', 'S', 'G', 'R', 'A', 'P', 'H' };
+
+/* Build-time scratch array backed by a temp-file mapping.  The graph of a
+ * 60 GB dump does not fit in the RAM of a 32 GB analysis machine, so the
+ * build-time arrays cannot live in anonymous memory: backing them with a
+ * file lets the OS page the cold tail to disk and the build finish on
+ * machines much smaller than the dump.  Access is index-based rather than
+ * pointer-based - the view moves whenever the file grows - and T must be
+ * trivially copyable.  The file is deleted on destruction.
+ */
+template <class T>
+class MappedScratch
+{
+public:
+    MappedScratch()
+        : mFile(INVALID_HANDLE_VALUE), mView(NULL), mCount(0), mCapacity(0)
     {
-        ExtOut("%p %S\n", SOS_PTR(path->Object), path->GetTypeName());
-        path = path->Next;
+        mPath[0] = '\0';
+    }
 
-        while (path)
-        {
-            ExtOut("  -> %p %S%s\n",SOS_PTR(path->Object), path->GetTypeName(), path->FromDependentHandle ? " (dependent handle)" : "");
-            path = path->Next;
-        }
-        
-        mCache.PrintStats(__FUNCTION__);
+    ~MappedScratch()
+    {
+        if (mView != NULL)
+            UnmapViewOfFile(mView);
+        if (mFile != INVALID_HANDLE_VALUE)
+            CloseHandle(mFile);
+        if (mPath[0] != '\0')
+            DeleteFileA(mPath);
+    }
+
+    bool Push(const T &value)
+    {
+        if (mCount == mCapacity && !Grow())
+            return false;
+
+        ((T *)mView)[mCount++] = value;
         return true;
     }
-    
-    mCache.PrintStats(__FUNCTION__);
-    return false;
-}
 
-size_t GCRootImpl::ObjSize(TADDR root)
-{
-    // Calculates the size of the closure of objects kept alive by root.
-    ClearAll();
-    GetDependentHandleMap(mDependentHandleMap);
-    
-    // mSize tells GCRootImpl to build the "mSizes" table with the total size
-    // each object roots.
-    mSize = true;
+    T &operator[](size_t i)             { return ((T *)mView)[i]; }
+    const T &operator[](size_t i) const { return ((const T *)mView)[i]; }
 
-    // Note that we are calling the same method as we would to locate the rooting
-    // chain for an object, but we haven't added any items to mTargets.  This means
-    // the algorithm will scan all objects and never terminate until it has walked
+    T *Data()           { return (T *)mView; }
+    size_t Size() const { return mCount; }
+
+private:
+    bool Grow()
+    {
+        if (mFile == INVALID_HANDLE_VALUE)
+        {
+            char temp[MAX_LONGPATH];
+            if (GetTempPathA(_countof(temp), temp) == 0)
+                return false;
+
+            sprintf_s(mPath, _countof(mPath), "%ssosgraph-build-%u-%p.tmp",
+                      temp, GetCurrentProcessId(), (void *)this);
+            mFile = CreateFileA(mPath, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                                CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (mFile == INVALID_HANDLE_VALUE)
+            {
+                mPath[0] = '\0';
+                return false;
+            }
+        }
+
+        // Start with a few MB and grow by half; CreateFileMapping extends
+        // the file to the new capacity.
+        size_t newCapacity = mCapacity == 0 ? (0x400000 / sizeof(T)) + 1
+                                            : mCapacity + mCapacity / 2;
+
+        if (mView != NULL)
+        {
+            UnmapViewOfFile(mView);
+            mView = NULL;
+        }
+
+        ULONG64 bytes = (ULONG64)newCapacity * sizeof(T);
+        HANDLE hMapping = CreateFileMappingA(mFile, NULL, PAGE_READWRITE,
+                                             (DWORD)(bytes >> 32), (DWORD)bytes, NULL);
+        if (hMapping == NULL)
+            return false;
+
+        mView = MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+        CloseHandle(hMapping);
+        if (mView == NULL)
+            return false;
+
+#ifdef FEATURE_PAL
+        // The build appends and then sorts in place; readahead helps both.
+        PAL_AdviseMappedRange(mView, (SIZE_T)bytes, PAL_MAP_HINT_SEQUENTIAL);
+#endif
+
+        mCapacity = newCapacity;
+        return true;
+    }
+
+    MappedScratch(const MappedScratch &);            // not copyable
+    MappedScratch &operator=(const MappedScratch &);
+
+private:
+    char mPath[MAX_LONGPATH];
+    HANDLE mFile;
+    void *mView;
+    size_t mCount;
+    size_t mCapacity;
+};
+
+class ObjectGraphIndex
+{
+public:
+    // Returns the index for the current dump, building and saving it on first
+    // use.  Returns NULL when no index can be used (live target, unreadable
+    // heap, unwritable temp directory); the failure is remembered so the cost
+    // is paid at most once per session.
+    static ObjectGraphIndex *Get();
+
+    // Finds the slot for the given object, returning false if the object
+    // isn't in the index.
+    bool FindObject(TADDR obj, size_t &slot) const
+    {
+        size_t lo = 0, hi = (size_t)mHeader->ObjectCount;
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (mObjects[mid] < obj)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        slot = lo;
+        return lo < mHeader->ObjectCount && mObjects[lo] == obj;
+    }
+
+    size_t GetObjectSize(size_t slot) const
+    {
+        return (size_t)mSizes[slot];
+    }
+
+    // Returns the outgoing references of the given slot (loader allocator
+    // objects of collectible types included, dependent handle edges not).
+    const ULONG64 *GetRefs(size_t slot, size_t &count) const
+    {
+        count = (size_t)(mRowStart[slot+1] - mRowStart[slot]);
+        return mRefs + mRowStart[slot];
+    }
+
+private:
+    ObjectGraphIndex()
+        : mView(NULL), mHeader(NULL), mObjects(NULL), mSizes(NULL), mRowStart(NULL), mRefs(NULL)
+    {
+    }
+
+    ~ObjectGraphIndex()
+    {
+        if (mView)
+            UnmapViewOfFile(mView);
+    }
+
+    static bool GetIndexPath(char *path, size_t cch);
+    bool Load(const char *path);
+    bool Build(const char *path);
+
+private:
+    void *mView;
+    const ObjectGraphFileHeader *mHeader;
+    const ULONG64 *mObjects;    // sorted object addresses
+    const ULONG64 *mSizes;
+    const ULONG64 *mRowStart;   // CSR row starts, ObjectCount+1 entries
+    const ULONG64 *mRefs;
+};
+
+ObjectGraphIndex *ObjectGraphIndex::Get()
+{
+    static ObjectGraphIndex *s_index = NULL;
+    static bool s_failed = false;
+
+    if (s_index != NULL || s_failed)
+        return s_index;
+
+    s_failed = true;
+
+    // Only a dump is immutable; a live target can allocate between commands.
+    if (!IsDumpFile())
+        return NULL;
+
+    if (!g_snapshot.Build())
+        return NULL;
+
+    char path[MAX_LONGPATH];
+    if (!GetIndexPath(path, _countof(path)))
+        return NULL;
+
+    ObjectGraphIndex *index = new ObjectGraphIndex;
+    bool mapped = index->Load(path);
+
+    if (!mapped)
+    {
+        // A corrupt heap throws out of the object walk; treat that the same
+        // as any other build failure and let the caller run uncached.
+        try
+        {
+            mapped = index->Build(path);
+        }
+        catch (const sos::Exception &)
+        {
+            mapped = false;
+        }
+    }
+
+    if (!mapped)
+    {
+        delete index;
+        return NULL;
+    }
+
+    s_index = index;
+    s_failed = false;
+    return s_index;
+}
+
+bool ObjectGraphIndex::GetIndexPath(char *path, size_t cch)
+{
+    // Key the file on the GC segment layout of the dump; Load rechecks the
+    // full table so a hash collision only costs a rebuild.
+    ULONG64 hash = HashSegmentLayout();
+
+    char temp[MAX_LONGPATH];
+    if (GetTempPathA(_countof(temp), temp) == 0)
+        return false;
+
+    sprintf_s(path, cch, "%ssosgraph-%016I64x.idx", temp, hash);
+    return true;
+}
+
+bool ObjectGraphIndex::Load(const char *path)
+{
+    HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    DWORD sizeHigh = 0;
+    DWORD sizeLow = GetFileSize(hFile, &sizeHigh);
+    ULONG64 fileSize = ((ULONG64)sizeHigh << 32) | sizeLow;
+
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(hFile);
+    if (hMapping == NULL)
+        return false;
+
+    mView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (mView == NULL)
+        return false;
+
+    const ObjectGraphFileHeader *header = (const ObjectGraphFileHeader *)mView;
+    if (fileSize < sizeof(*header) ||
+        memcmp(header->Magic, kObjectGraphMagic, sizeof(header->Magic)) != 0 ||
+        header->Version != 1 ||
+        header->PointerSize != sizeof(TADDR))
+    {
+        UnmapViewOfFile(mView);
+        mView = NULL;
+        return false;
+    }
+
+    ULONG64 expected = sizeof(*header)
+                     + header->SegmentCount * sizeof(ObjectGraphFileSegment)
+                     + (3 * header->ObjectCount + 1 + header->RefCount) * sizeof(ULONG64);
+    if (fileSize != expected || header->SegmentCount != (ULONG64)g_snapshot.GetSegmentCount())
+    {
+        UnmapViewOfFile(mView);
+        mView = NULL;
+        return false;
+    }
+
+    // Verify the stored segment table against the dump; the file name hash is
+    // not proof enough to trust several gigabytes of cached graph.
+    const ObjectGraphFileSegment *segments = (const ObjectGraphFileSegment *)(header + 1);
+    for (int i = 0; i < g_snapshot.GetSegmentCount(); ++i)
+    {
+        const DacpHeapSegmentData *segment = g_snapshot.GetSegmentByIndex(i);
+        if (segments[i].Segment != segment->segmentAddr ||
+            segments[i].Start != segment->mem ||
+            segments[i].End != segment->highAllocMark)
+        {
+            UnmapViewOfFile(mView);
+            mView = NULL;
+            return false;
+        }
+    }
+
+    mHeader = header;
+    mObjects = (const ULONG64 *)(segments + header->SegmentCount);
+    mSizes = mObjects + header->ObjectCount;
+    mRowStart = mSizes + header->ObjectCount;
+    mRefs = mRowStart + header->ObjectCount + 1;
+
+#ifdef FEATURE_PAL
+    // Queries hit the index at random, so turn readahead off for the view
+    // as a whole - an index larger than RAM must not evict itself pulling
+    // pages nobody asked for - but start populating the address column,
+    // which every lookup's binary search touches.
+    PAL_AdviseMappedRange(mView, (SIZE_T)fileSize, PAL_MAP_HINT_RANDOM);
+    PAL_AdviseMappedRange((LPVOID)mObjects,
+                          (SIZE_T)(header->ObjectCount * sizeof(ULONG64)),
+                          PAL_MAP_HINT_WILLNEED);
+#endif
+
+    return true;
+}
+
+bool ObjectGraphIndex::Build(const char *path)
+{
+    sos::GCHeap gcheap;
+    if (!gcheap.AreGCStructuresValid())
+        return false;
+
+    ExtOut("Building the object graph index for this dump; later runs will map %s.\n", path);
+
+    struct BuildEntry
+    {
+        TADDR Object;
+        ULONG64 Size;
+        size_t RefStart;
+        size_t RefCount;
+    };
+
+    // The scratch arrays live in temp-file mappings rather than anonymous
+    // memory: the graph of a dump much larger than this machine's RAM still
+    // builds, with the OS paging the cold tail instead of the allocator
+    // failing or the box swapping itself to death.
+    MappedScratch<BuildEntry> entries;
+    MappedScratch<ULONG64> refs;
+    LinearReadCache cache(512);
+
+    for (sos::ObjectIterator itr = gcheap.WalkHeap(); itr; ++itr)
+    {
+        if (IsInterrupt())
+            return false;
+
+        BuildEntry entry;
+        entry.Object = itr->GetAddress();
+        entry.Size = itr->GetSize();
+        entry.RefStart = refs.Size();
+
+        if (!itr->IsFree())
+        {
+            try
+            {
+                for (sos::RefIterator ref(itr->GetAddress(), &cache); ref; ++ref)
+                    if (*ref && !refs.Push(*ref))
+                        return false;
+            }
+            catch (const sos::Exception &)
+            {
+                // An object whose references can't be read contributes no
+                // edges; the serial walk would have skipped it too.
+            }
+        }
+
+        entry.RefCount = refs.Size() - entry.RefStart;
+        if (!entries.Push(entry))
+            return false;
+    }
+
+    // Server GC interleaves the heaps in the walk, so sort for binary search.
+    std::sort(entries.Data(), entries.Data() + entries.Size(),
+        [](const BuildEntry &lhs, const BuildEntry &rhs)
+        {
+            return lhs.Object < rhs.Object;
+        });
+
+    FILE *file = NULL;
+    if (fopen_s(&file, path, "wb") != 0)
+    {
+        ExtOut("Unable to write the object graph index to %s\n", path);
+        return false;
+    }
+
+    ObjectGraphFileHeader header;
+    memcpy(header.Magic, kObjectGraphMagic, sizeof(header.Magic));
+    header.Version = 1;
+    header.PointerSize = sizeof(TADDR);
+    header.SegmentCount = (ULONG64)g_snapshot.GetSegmentCount();
+    header.ObjectCount = entries.Size();
+    header.RefCount = refs.Size();
+    fwrite(&header, sizeof(header), 1, file);
+
+    for (int i = 0; i < g_snapshot.GetSegmentCount(); ++i)
+    {
+        const DacpHeapSegmentData *data = g_snapshot.GetSegmentByIndex(i);
+
+        ObjectGraphFileSegment segment;
+        segment.Segment = data->segmentAddr;
+        segment.Start = data->mem;
+        segment.End = data->highAllocMark;
+        fwrite(&segment, sizeof(segment), 1, file);
+    }
+
+    // The columns are streamed through a small chunk buffer rather than
+    // materialized: a full column is another 8 bytes per object we may not
+    // have the RAM for.
+    ULONG64 chunk[8192];
+    size_t filled = 0;
+    auto flush = [&]()
+    {
+        if (filled != 0)
+        {
+            fwrite(chunk, sizeof(ULONG64), filled, file);
+            filled = 0;
+        }
+    };
+    auto put = [&](ULONG64 value)
+    {
+        chunk[filled++] = value;
+        if (filled == _countof(chunk))
+            flush();
+    };
+
+    for (size_t i = 0; i < entries.Size(); ++i)
+        put(entries[i].Object);
+    flush();
+
+    for (size_t i = 0; i < entries.Size(); ++i)
+        put(entries[i].Size);
+    flush();
+
+    ULONG64 offset = 0;
+    for (size_t i = 0; i < entries.Size(); ++i)
+    {
+        put(offset);
+        offset += entries[i].RefCount;
+    }
+    put(offset);
+    flush();
+
+    // The reference rows were built in walk order; write them in sorted order
+    // to match the rows above.
+    for (size_t i = 0; i < entries.Size(); ++i)
+        if (entries[i].RefCount)
+            fwrite(refs.Data() + entries[i].RefStart, sizeof(ULONG64), entries[i].RefCount, file);
+
+    fclose(file);
+
+    if (!Load(path))
+    {
+        ExtOut("Unable to map the object graph index; is the temp directory full?\n");
+        return false;
+    }
+
+    ExtOut("Indexed %I64d objects and %I64d references.\n", header.ObjectCount, header.RefCount);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void GCRootImpl::ClearAll()
+{
+    ClearNodes();
+
+    {
+        std::unordered_map<TADDR, MTInfo*>::iterator itr;
+        for (itr = mMTs.begin(); itr != mMTs.end(); ++itr)
+            delete itr->second;
+    }
+
+    // The nodes in mTargets all came from NewNode, so ClearNodes has already
+    // freed them; deleting them here again would be a double free now that
+    // ClearAll runs between the passes of a multi-target search.
+
+    mMTs.clear();
+    mTargets.clear();
+    mFoundTargets.clear();
+    mConsidered.clear();
+    mVisited.Clear();
+    mSizes.Clear();
+    mDependentHandleMap = NULL;
+    mCache.ClearStats();
+
+    mAll = false;
+    mSize = false;
+    mUseBitmap = false;
+    mFirstOnly = false;
+    mMaxDepth = 0;
+
+    // Map (or build, on the first run against this dump) the persistent
+    // object graph index; GetGCRefs answers from it when one is available.
+    mIndex = ObjectGraphIndex::Get();
+}
+
+bool GCRootImpl::IsConsidered(TADDR obj)
+{
+    if (mUseBitmap)
+        return mVisited.Contains(obj);
+
+    return mConsidered.find(obj) != mConsidered.end();
+}
+
+void GCRootImpl::MarkConsidered(TADDR obj)
+{
+    if (mUseBitmap)
+        mVisited.Add(obj);
+    else
+        mConsidered.insert(obj);
+}
+
+void GCRootImpl::ClearNodes()
+{
+    std::list<RootNode*>::iterator itr;
+
+    for  (itr = mCleanupList.begin(); itr != mCleanupList.end(); ++itr)
+        delete *itr;
+
+    SOSMemSub(SOSMemGraphIndex, sizeof(RootNode) * mCleanupList.size());
+    mCleanupList.clear();
+    mRootNewList.clear();
+}
+
+GCRootImpl::RootNode *GCRootImpl::NewNode(TADDR obj, MTInfo *mtInfo, bool fromDependent)
+{
+    // We need to create/destroy a TON of nodes during execution of GCRoot functions.
+    // To avoid heap fragmentation (and since it's faster), we don't actually new/delete
+    // nodes unless we have to.  Instead we keep a stl list with free nodes to use.
+    RootNode *toReturn = NULL;
+    
+    if (mRootNewList.size())
+    {
+        toReturn = mRootNewList.back();
+        mRootNewList.pop_back();
+    }
+    else
+    {
+        toReturn = new RootNode();
+        mCleanupList.push_back(toReturn);
+        SOSMemAdd(SOSMemGraphIndex, sizeof(RootNode));
+    }
+
+    toReturn->Object = obj;
+    toReturn->MTInfo = mtInfo;
+    toReturn->FromDependentHandle = fromDependent;
+    return toReturn;
+}
+
+void GCRootImpl::DeleteNode(RootNode *node)
+{
+    // Add node to the "new list".
+    node->Clear();
+    mRootNewList.push_back(node);
+}
+
+/* The session's dependent handle map.  Building it enumerates the full
+ * dependent handle table and batch-reads every primary, so every rooting
+ * command sharing one build matters on ConditionalWeakTable-heavy targets.
+ * Handles come and go whenever a live target runs, so the map only survives
+ * across commands against a dump (see the cache-clearing block in util.cpp).
+ */
+struct DependentHandleMapCache
+{
+    BOOL Valid;
+    DependentHandleMap Map;
+};
+
+static DependentHandleMapCache g_dependentHandleMap;
+
+void ClearDependentHandleMap()
+{
+    g_dependentHandleMap.Valid = FALSE;
+    g_dependentHandleMap.Map.Clear();
+}
+
+const DependentHandleMap *GCRootImpl::GetDependentHandleMap()
+{
+    if (g_dependentHandleMap.Valid)
+        return &g_dependentHandleMap.Map;
+
+    g_dependentHandleMap.Map.Clear();
+
+    unsigned int type = HNDTYPE_DEPENDENT;
+    ToRelease<ISOSHandleEnum> handles;
+
+    HRESULT hr = g_sos->GetHandleEnumForTypes(&type, 1, &handles);
+
+    if (FAILED(hr))
+    {
+        ExtOut("Failed to walk dependent handles.  GCRoot may miss paths.\n");
+        return &g_dependentHandleMap.Map;
+    }
+
+    std::vector<SOSHandleData> data;
+    if (!FetchSortedHandleTable(handles, data))
+    {
+        ExtOut("Error walking dependent handles.  GCRoot may miss paths.\n");
+        return &g_dependentHandleMap.Map;
+    }
+
+    // Resolve every handle's primary object in one scatter-gather request
+    // instead of one small read per handle.
+    std::vector<TADDR> primaries(data.size(), 0);
+    std::vector<ReadVirtualRange> ranges;
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        if (data[i].Secondary == 0)
+            continue;
+
+        ReadVirtualRange range;
+        range.Address = data[i].Handle;
+        range.Buffer = &primaries[i];
+        range.Size = sizeof(TADDR);
+        ranges.push_back(range);
+    }
+
+    ReadVirtualBatch(ranges.data(), (ULONG)ranges.size());
+
+    for (size_t i = 0; i < data.size(); ++i)
+        if (data[i].Secondary != 0)
+            g_dependentHandleMap.Map.Add(primaries[i], TO_TADDR(data[i].Secondary));
+
+    g_dependentHandleMap.Valid = TRUE;
+    return &g_dependentHandleMap.Map;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public functions.
+///////////////////////////////////////////////////////////////////////////////
+int GCRootImpl::PrintRootsForObject(TADDR target, bool all, bool noStacks, bool firstOnly, int maxDepth)
+{
+    ClearAll();
+    mDependentHandleMap = GetDependentHandleMap();
+
+    mAll = all;
+    mUseBitmap = mVisited.Init();
+
+    // -all wants every path, so the early-out cannot apply with it.
+    mFirstOnly = firstOnly && !all;
+    mMaxDepth = maxDepth;
+
+    // Add "target" to the mTargets list.
+    TADDR mt = ReadPointerCached(target);
+    RootNode *node = NewNode(target, GetMTInfo(mt));
+    mTargets[target] = node;
+
+    // Look for roots on the HandleTable, FQ, and all threads.
+    int count = 0;
+
+    if (!noStacks)
+        count += PrintRootsOnAllThreads();
+
+    if (!SearchComplete())
+        count += PrintRootsOnHandleTable();
+    if (!SearchComplete())
+        count += PrintRootsOnFQ();
+
+    if(count == 0)
+    {
+        count += PrintRootsOnFQ(true);
+        if(count)
+        {
+            ExtOut("Warning: These roots are from finalizable objects that are not yet ready for finalization.\n");
+            ExtOut("This is to handle the case where objects re-register themselves for finalization.\n");
+            ExtOut("These roots may be false positives.\n");
+        }
+    }
+
+    mCache.PrintStats(__FUNCTION__);
+    return count;
+}
+
+int GCRootImpl::PrintRootsForObjects(const std::vector<TADDR> &targets, bool noStacks)
+{
+    // Resolve several suspects with shared passes over the object graph
+    // instead of one full traversal per target.  A single pass can consume
+    // the only path to one target while resolving another (every object is
+    // considered at most once), so targets still unfound after a pass get a
+    // fresh one without the already-resolved targets; we stop as soon as a
+    // pass makes no progress.
+    std::vector<TADDR> remaining(targets.begin(), targets.end());
+    int total = 0;
+
+    while (!remaining.empty())
+    {
+        ClearAll();
+        mDependentHandleMap = GetDependentHandleMap();
+        mUseBitmap = mVisited.Init();
+
+        for (size_t i = 0; i < remaining.size(); ++i)
+        {
+            TADDR target = remaining[i];
+            if (mTargets.find(target) != mTargets.end())
+                continue;
+
+            TADDR mt = ReadPointerCached(target);
+            mTargets[target] = NewNode(target, GetMTInfo(mt));
+        }
+
+        if (!noStacks)
+            total += PrintRootsOnAllThreads();
+
+        total += PrintRootsOnHandleTable();
+        total += PrintRootsOnFQ();
+
+        if (IsInterrupt())
+            break;
+
+        // Keep only the targets no pass has resolved yet.
+        std::vector<TADDR> unresolved;
+        for (size_t i = 0; i < remaining.size(); ++i)
+            if (mFoundTargets.find(remaining[i]) == mFoundTargets.end())
+                unresolved.push_back(remaining[i]);
+
+        if (unresolved.size() == remaining.size())
+        {
+            // No progress; what's left isn't reachable from any root.
+            for (size_t i = 0; i < unresolved.size(); ++i)
+                ExtOut("Found no roots for %p.\n", SOS_PTR(unresolved[i]));
+
+            break;
+        }
+
+        remaining.swap(unresolved);
+    }
+
+    mCache.PrintStats(__FUNCTION__);
+    return total;
+}
+
+
+bool GCRootImpl::PrintPathToObject(TADDR root, TADDR target)
+{
+    ClearAll();
+    mDependentHandleMap = GetDependentHandleMap();
+    mUseBitmap = mVisited.Init();
+
+    // Add "target" to the mTargets list.
+    TADDR mt = ReadPointerCached(target);
+    RootNode *node = NewNode(target, GetMTInfo(mt));
+    mTargets[target] = node;
+
+    // Check to see if the root reaches the target.
+    RootNode *path = FindPathToTarget(root);
+    if (path)
+    {
+        ExtOut("%p %S\n", SOS_PTR(path->Object), path->GetTypeName());
+        path = path->Next;
+
+        while (path)
+        {
+            ExtOut("  -> %p %S%s\n",SOS_PTR(path->Object), path->GetTypeName(), path->FromDependentHandle ? " (dependent handle)" : "");
+            path = path->Next;
+        }
+        
+        mCache.PrintStats(__FUNCTION__);
+        return true;
+    }
+    
+    mCache.PrintStats(__FUNCTION__);
+    return false;
+}
+
+size_t GCRootImpl::ObjSize(TADDR root)
+{
+    // Calculates the size of the closure of objects kept alive by root.
+
+    // An earlier invocation may have already walked this closure.
+    SharedAddressMap *sizeCache = GetObjSizeCache();
+    if (sizeCache)
+    {
+        ULONG64 memoized;
+        if (sizeCache->Lookup(root, &memoized))
+            return (size_t)memoized;
+    }
+
+    ClearAll();
+    mDependentHandleMap = GetDependentHandleMap();
+
+    // mSize tells GCRootImpl to build the "mSizes" table with the total size
+    // each object roots.
+    mSize = true;
+    mUseBitmap = mVisited.Init();
+
+    // Note that we are calling the same method as we would to locate the rooting
+    // chain for an object, but we haven't added any items to mTargets.  This means
+    // the algorithm will scan all objects and never terminate until it has walked
     // all objects in the closure.
     FindPathToTarget(root);
-    
+
     mCache.PrintStats(__FUNCTION__);
-    return mSizes[root];
+
+    size_t size = (size_t)mSizes.Get(root);
+    if (sizeCache)
+        sizeCache->Set(root, size);
+
+    return size;
 }
 
 void GCRootImpl::ObjSize()
 {
     ClearAll();
-    GetDependentHandleMap(mDependentHandleMap);
+    mDependentHandleMap = GetDependentHandleMap();
     mSize = true;
+    mUseBitmap = mVisited.Init();
 
     // Walks all roots in the process, and prints out the object size for each one.
     PrintRootsOnAllThreads();
@@ -346,29 +1295,530 @@ void GCRootImpl::ObjSize()
     mCache.PrintStats(__FUNCTION__);
 }
 
-
-const std::unordered_set<TADDR> &GCRootImpl::GetLiveObjects(bool excludeFQ)
+
+const std::unordered_set<TADDR> &GCRootImpl::GetLiveObjects(bool excludeFQ)
+{
+    ClearAll();
+    mDependentHandleMap = GetDependentHandleMap();
+
+    // Reachability doesn't depend on the visit order and nothing is printed
+    // here, so compute the closure breadth-first on the parallel marking pool:
+    // collect every root, then let the workers fill mConsidered.  With a graph
+    // index mapped the serial walk already runs at memory speed, so don't
+    // spin up the pool for it.
+    std::vector<TADDR> roots;
+    if (mIndex == NULL && CollectRoots(roots, excludeFQ))
+    {
+        ParallelObjectMarker marker(*mDependentHandleMap);
+        if (marker.MarkFrom(roots, mConsidered))
+            return mConsidered;
+
+        // The pool could not run; throw away any partial state and fall
+        // through to the serial walk.
+        mConsidered.clear();
+    }
+
+    // Walk each root in the process without setting a target.  This has the effect of
+    // causing us to walk every object in the process, adding them to mConsidered as we
+    // go.
+    PrintRootsOnAllThreads();
+    PrintRootsOnHandleTable();
+
+    if (!excludeFQ)
+        PrintRootsOnFQ();
+
+    mCache.PrintStats(__FUNCTION__);
+    return mConsidered;
+}
+
+void GCRootImpl::BuildLivenessMap(bool excludeFQ)
+{
+    ClearAll();
+    mDependentHandleMap = GetDependentHandleMap();
+    mUseBitmap = mVisited.Init();
+
+    // Without a segment bitmap the closure lands in the hash set, and
+    // reachability doesn't depend on the visit order, so compute it
+    // breadth-first on the parallel marking pool.  (The pool's workers share
+    // a hash set, so it can't fill the bitmap; with the bitmap or a graph
+    // index the serial walk is already cheap.)
+    if (!mUseBitmap)
+    {
+        std::vector<TADDR> roots;
+        if (mIndex == NULL && CollectRoots(roots, excludeFQ))
+        {
+            ParallelObjectMarker marker(*mDependentHandleMap);
+            if (marker.MarkFrom(roots, mConsidered))
+                return;
+
+            // The pool could not run; throw away any partial state and fall
+            // through to the serial walk.
+            mConsidered.clear();
+        }
+    }
+
+    // Walk each root in the process without setting a target, marking every
+    // reachable object as we go.
+    PrintRootsOnAllThreads();
+    PrintRootsOnHandleTable();
+
+    if (!excludeFQ)
+        PrintRootsOnFQ();
+
+    mCache.PrintStats(__FUNCTION__);
+}
+
+void GCRootImpl::PrintRetainedSizes(int topObjects)
+{
+    ClearAll();
+    mDependentHandleMap = GetDependentHandleMap();
+
+    sos::GCHeap gcheap;
+    if (!gcheap.AreGCStructuresValid())
+    {
+        ExtOut("The GC heap structures are not in a valid state; cannot compute retained sizes.\n");
+        return;
+    }
+
+    // Gather every root first; they become the successors of a virtual root
+    // node so the dominator computation sees a single-entry graph.
+    std::vector<TADDR> roots;
+    if (!CollectRoots(roots, false))
+    {
+        ExtOut("Failed to enumerate the roots of the process.\n");
+        return;
+    }
+
+    // Build the object graph once: one entry per object, with its references
+    // (including dependent handle edges) appended to a flat edge array.
+    struct GraphEntry
+    {
+        TADDR Object;
+        TADDR MT;
+        ULONG64 Size;
+        size_t RefStart;
+        size_t RefCount;
+    };
+
+    std::vector<GraphEntry> entries;
+    std::vector<TADDR> refs;
+    LinearReadCache cache(512);
+
+    for (sos::ObjectIterator itr = gcheap.WalkHeap(); itr; ++itr)
+    {
+        if (IsInterrupt())
+            return;
+
+        if (itr->IsFree())
+            continue;
+
+        GraphEntry entry;
+        entry.Object = itr->GetAddress();
+        entry.MT = itr->GetMT();
+        entry.Size = itr->GetSize();
+        entry.RefStart = refs.size();
+
+        try
+        {
+            for (sos::RefIterator ref(itr->GetAddress(), &cache); ref; ++ref)
+                if (*ref)
+                    refs.push_back(*ref);
+        }
+        catch (const sos::Exception &)
+        {
+            // An object whose references can't be read contributes no edges.
+        }
+
+        const std::list<TADDR> *dep = mDependentHandleMap->Lookup(entry.Object);
+        if (dep)
+            for (std::list<TADDR>::const_iterator secondary = dep->begin(); secondary != dep->end(); ++secondary)
+                refs.push_back(*secondary);
+
+        entry.RefCount = refs.size() - entry.RefStart;
+        entries.push_back(entry);
+    }
+
+    // Server GC interleaves the heaps in the walk, so sort for binary search.
+    // The rows in "refs" are not moved, only the order they are visited in.
+    std::sort(entries.begin(), entries.end(),
+        [](const GraphEntry &lhs, const GraphEntry &rhs)
+        {
+            return lhs.Object < rhs.Object;
+        });
+
+    const size_t count = entries.size();
+    const size_t virtualRoot = count;
+    const size_t invalid = (size_t)-1;
+
+    auto findSlot = [&](TADDR obj) -> size_t
+    {
+        size_t lo = 0, hi = count;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (entries[mid].Object < obj)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        return (lo < count && entries[lo].Object == obj) ? lo : invalid;
+    };
+
+    // Resolve every edge to a slot up front; edges to addresses which are not
+    // objects (unwalkable regions, loader heaps) are dropped.
+    std::vector<size_t> refSlots(refs.size());
+    for (size_t i = 0; i < refs.size(); ++i)
+        refSlots[i] = findSlot(refs[i]);
+
+    std::vector<size_t> rootSlots;
+    for (size_t i = 0; i < roots.size(); ++i)
+    {
+        size_t slot = findSlot(roots[i]);
+        if (slot != invalid)
+            rootSlots.push_back(slot);
+    }
+
+    // A non-recursive depth-first walk from the virtual root, producing the
+    // postorder numbering the dominator intersection runs on.  The heap graph
+    // is far too deep for recursion.
+    std::vector<size_t> po(count + 1, invalid);    // slot -> postorder number
+    std::vector<size_t> byPo;                      // postorder number -> slot
+
+    {
+        struct DfsFrame
+        {
+            size_t Slot;
+            size_t Next;    // index of the next successor to visit
+        };
+
+        std::vector<DfsFrame> stack;
+        stack.push_back(DfsFrame{virtualRoot, 0});
+        po[virtualRoot] = invalid - 1;              // on-stack marker
+
+        while (!stack.empty())
+        {
+            if (IsInterrupt())
+                return;
+
+            DfsFrame &frame = stack.back();
+            size_t succCount = frame.Slot == virtualRoot ? rootSlots.size() : entries[frame.Slot].RefCount;
+
+            if (frame.Next < succCount)
+            {
+                size_t succ = frame.Slot == virtualRoot ? rootSlots[frame.Next]
+                                                        : refSlots[entries[frame.Slot].RefStart + frame.Next];
+                frame.Next++;
+
+                if (succ != invalid && po[succ] == invalid)
+                {
+                    po[succ] = invalid - 1;
+                    stack.push_back(DfsFrame{succ, 0});
+                }
+            }
+            else
+            {
+                po[frame.Slot] = byPo.size();
+                byPo.push_back(frame.Slot);
+                stack.pop_back();
+            }
+        }
+    }
+
+    // Predecessor lists in CSR form, restricted to reachable nodes.
+    std::vector<size_t> predStart(count + 2, 0);
+    std::vector<size_t> preds;
+
+    {
+        for (size_t v = 0; v < count; ++v)
+        {
+            if (po[v] == invalid)
+                continue;
+
+            for (size_t i = 0; i < entries[v].RefCount; ++i)
+            {
+                size_t succ = refSlots[entries[v].RefStart + i];
+                if (succ != invalid && po[succ] != invalid)
+                    predStart[succ + 1]++;
+            }
+        }
+
+        for (size_t i = 0; i < rootSlots.size(); ++i)
+            predStart[rootSlots[i] + 1]++;
+
+        for (size_t i = 1; i < predStart.size(); ++i)
+            predStart[i] += predStart[i - 1];
+
+        preds.resize(predStart[count + 1]);
+        std::vector<size_t> fill(predStart.begin(), predStart.end() - 1);
+
+        for (size_t v = 0; v < count; ++v)
+        {
+            if (po[v] == invalid)
+                continue;
+
+            for (size_t i = 0; i < entries[v].RefCount; ++i)
+            {
+                size_t succ = refSlots[entries[v].RefStart + i];
+                if (succ != invalid && po[succ] != invalid)
+                    preds[fill[succ]++] = v;
+            }
+        }
+
+        for (size_t i = 0; i < rootSlots.size(); ++i)
+            preds[fill[rootSlots[i]]++] = virtualRoot;
+    }
+
+    // Immediate dominators by the Cooper/Harvey/Kennedy iteration: start from
+    // the virtual root and intersect each node's predecessors' dominators in
+    // reverse postorder until a fixed point.  On the near-reducible graphs the
+    // GC heap produces this converges in a couple of passes.
+    std::vector<size_t> idom(count + 1, invalid);
+    idom[virtualRoot] = virtualRoot;
+
+    auto intersect = [&](size_t a, size_t b) -> size_t
+    {
+        while (a != b)
+        {
+            while (po[a] < po[b])
+                a = idom[a];
+            while (po[b] < po[a])
+                b = idom[b];
+        }
+
+        return a;
+    };
+
+    bool changed = true;
+    while (changed)
+    {
+        if (IsInterrupt())
+            return;
+
+        changed = false;
+        for (size_t i = byPo.size(); i-- > 0; )
+        {
+            size_t v = byPo[i];
+            if (v == virtualRoot)
+                continue;
+
+            size_t newIdom = invalid;
+            for (size_t p = predStart[v]; p < predStart[v + 1]; ++p)
+            {
+                size_t pred = preds[p];
+                if (idom[pred] == invalid)
+                    continue;
+
+                newIdom = (newIdom == invalid) ? pred : intersect(newIdom, pred);
+            }
+
+            if (newIdom != invalid && idom[v] != newIdom)
+            {
+                idom[v] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    // The retained size of an object is its own size plus that of everything
+    // it dominates.  idom[v] finishes after v in the depth-first walk, so one
+    // pass in postorder accumulates children before their parents.
+    std::vector<ULONG64> retained(count + 1, 0);
+    for (size_t v = 0; v < count; ++v)
+        if (po[v] != invalid)
+            retained[v] = entries[v].Size;
+
+    for (size_t i = 0; i < byPo.size(); ++i)
+    {
+        size_t v = byPo[i];
+        if (v != virtualRoot && idom[v] != invalid)
+            retained[idom[v]] += retained[v];
+    }
+
+    // Retained size per type.  Note that instances of the same type count
+    // each other's closure when one dominates the other.
+    struct TypeStat
+    {
+        int Count;
+        ULONG64 Retained;
+    };
+
+    std::unordered_map<TADDR, TypeStat> types;
+    for (size_t v = 0; v < count; ++v)
+    {
+        if (po[v] == invalid)
+            continue;
+
+        TypeStat &stat = types[entries[v].MT];
+        stat.Count++;
+        stat.Retained += retained[v];
+    }
+
+    std::vector<std::pair<TADDR, TypeStat>> sortedTypes(types.begin(), types.end());
+    std::sort(sortedTypes.begin(), sortedTypes.end(),
+        [](const std::pair<TADDR, TypeStat> &lhs, const std::pair<TADDR, TypeStat> &rhs)
+        {
+            return lhs.second.Retained < rhs.second.Retained;
+        });
+
+    ExtOut("Statistics by retained size:\n");
+    ExtOut("%" POINTERSIZE "s %8s %12s %s\n", "MT", "Count", "Retained", "Class Name");
+    for (size_t i = 0; i < sortedTypes.size(); ++i)
+    {
+        if (IsInterrupt())
+            return;
+
+        DMLOut("%s %8d %12I64u ", DMLDumpHeapMT(sortedTypes[i].first), sortedTypes[i].second.Count,
+               (unsigned __int64)sortedTypes[i].second.Retained);
+
+        wcscpy_s(g_mdName, mdNameLen, W("UNKNOWN"));
+        NameForMT_s(sortedTypes[i].first, g_mdName, mdNameLen);
+        ExtOut("%S\n", g_mdName);
+    }
+
+    // The largest individual dominators, the usual starting points when
+    // hunting a leak.
+    std::vector<size_t> largest;
+    for (size_t v = 0; v < count; ++v)
+        if (po[v] != invalid)
+            largest.push_back(v);
+
+    size_t nprint = ((size_t)topObjects < largest.size()) ? (size_t)topObjects : largest.size();
+    std::partial_sort(largest.begin(), largest.begin() + nprint, largest.end(),
+        [&](size_t lhs, size_t rhs)
+        {
+            return retained[lhs] > retained[rhs];
+        });
+
+    ExtOut("\nLargest dominators:\n");
+    ExtOut("%" POINTERSIZE "s %12s %s\n", "Address", "Retained", "Class Name");
+    for (size_t i = 0; i < nprint; ++i)
+    {
+        size_t v = largest[i];
+
+        DMLOut("%s %12I64u ", DMLObject(entries[v].Object), (unsigned __int64)retained[v]);
+
+        wcscpy_s(g_mdName, mdNameLen, W("UNKNOWN"));
+        NameForMT_s(entries[v].MT, g_mdName, mdNameLen);
+        ExtOut("%S\n", g_mdName);
+    }
+
+    mCache.PrintStats(__FUNCTION__);
+}
+
+bool GCRootImpl::CollectRoots(std::vector<TADDR> &roots, bool excludeFQ)
+{
+    // Enumerates the same roots PrintRootsOnHandleTable, PrintRootsOnAllThreads
+    // and PrintRootsOnFQ do, but only gathers the root objects instead of
+    // walking each one.  Returns false if any enumeration failed; the caller
+    // should use the serial walk in that case.
+
+    // Roots on the HandleTable.
+    {
+        ToRelease<ISOSHandleEnum> pEnum = NULL;
+        if (FAILED(g_sos->GetHandleEnum(&pEnum)))
+            return false;
+
+        // Resolve the handles in address order so the reads are sequential.
+        std::vector<SOSHandleData> handles;
+        if (!FetchSortedHandleTable(pEnum, handles))
+            return false;
+
+        // One scatter-gather request resolves every strong handle.
+        std::vector<TADDR> referents(handles.size(), 0);
+        std::vector<ReadVirtualRange> ranges;
+
+        for (size_t i = 0; i < handles.size(); ++i)
+        {
+            // Ignore handles which aren't actually roots.
+            if (!handles[i].StrongReference)
+                continue;
+
+            ReadVirtualRange range;
+            range.Address = handles[i].Handle;
+            range.Buffer = &referents[i];
+            range.Size = sizeof(TADDR);
+            ranges.push_back(range);
+        }
+
+        ReadVirtualBatch(ranges.data(), (ULONG)ranges.size());
+
+        for (size_t i = 0; i < handles.size(); ++i)
+            if (referents[i])
+                roots.push_back(referents[i]);
+    }
+
+    // Roots on thread stacks.
+    {
+        ArrayHolder<DWORD_PTR> threadList = NULL;
+        int numThreads = 0;
+
+        if (FAILED(GetThreadList(&threadList, &numThreads)) || !threadList)
+            return false;
+
+        DacpThreadData vThread;
+        for (int i = 0; i < numThreads; i++)
+        {
+            if (IsInterrupt())
+                return false;
+
+            if (FAILED(vThread.Request(g_sos, threadList[i])) || !vThread.osThreadId)
+                continue;
+
+            unsigned int refCount = 0;
+            ArrayHolder<SOSStackRefData> refs = NULL;
+            if (FAILED(::GetGCRefs(vThread.osThreadId, &refs, &refCount, NULL, NULL)))
+            {
+                ExtOut("Failed to walk thread %x\n", vThread.osThreadId);
+                continue;
+            }
+
+            for (unsigned int r = 0; r < refCount; ++r)
+                if (refs[r].Object)
+                    roots.push_back(TO_TADDR(refs[r].Object));
+        }
+    }
+
+    // Roots on the finalizer queue.
+    if (!excludeFQ)
+    {
+        // Use a different linear read cache here instead of polluting the object read cache.
+        LinearReadCache cache(512);
+
+        // Per-heap details come from the session snapshot.
+        if (!g_snapshot.Build())
+            return false;
+
+        int nHeaps = g_snapshot.GetHeapCount();
+        for (int n = 0; n < nHeaps; n ++)
+        {
+            DacpGcHeapDetails &heapDetails = *g_snapshot.GetHeapDetails(n);
+            TADDR start = TO_TADDR(SegQueue(heapDetails, CriticalFinalizerListSeg));
+            TADDR stop = TO_TADDR(SegQueue(heapDetails, FinalizerListSeg));
+            CollectRootsInRange(cache, start, stop, roots);
+        }
+    }
+
+    return true;
+}
+
+void GCRootImpl::CollectRootsInRange(LinearReadCache &cache, TADDR start, TADDR stop, std::vector<TADDR> &roots)
 {
-    ClearAll();
-    GetDependentHandleMap(mDependentHandleMap);
-
-    // Walk each root in the process without setting a target.  This has the effect of
-    // causing us to walk every object in the process, adding them to mConsidered as we
-    // go.
-    PrintRootsOnAllThreads();
-    PrintRootsOnHandleTable();
-
-    if (!excludeFQ)
-        PrintRootsOnFQ();
+    // Walk the range [start, stop) and consider each pointer in the range as a root.
+    while (start < stop)
+    {
+        TADDR root = 0;
+        if (cache.Read(start, &root, true) && root)
+            roots.push_back(root);
 
-    mCache.PrintStats(__FUNCTION__);
-    return mConsidered;
+        start += sizeof(TADDR);
+    }
 }
 
 int GCRootImpl::FindRoots(int gen, TADDR target)
 {
     ClearAll();
-    GetDependentHandleMap(mDependentHandleMap);
+    mDependentHandleMap = GetDependentHandleMap();
 
     if (gen == -1 || ((UINT)gen) == GetMaxGeneration())
     {
@@ -378,6 +1828,8 @@ int GCRootImpl::FindRoots(int gen, TADDR target)
     else
     {
         // Otherwise walk all roots for only the given generation.
+        mUseBitmap = mVisited.Init();
+
         int count = PrintRootsInOlderGen();
         count += PrintRootsOnHandleTable(gen);
         count += PrintRootsOnFQ();
@@ -398,7 +1850,7 @@ void GCRootImpl::ReportSizeInfo(const SOSHandleData &handle, TADDR obj)
 
     const WCHAR *type = mtInfo ? mtInfo->GetTypeName() : W("unknown type");
 
-    size_t size = mSizes[obj];
+    size_t size = (size_t)mSizes.Get(obj);
     ExtOut("Handle (%s): %p -> %p: %d (0x%x) bytes (%S)\n", NameForHandle(handle.Type), SOS_PTR(handle.Handle),
                                 SOS_PTR(obj), size, size, type);
 }
@@ -419,7 +1871,7 @@ void GCRootImpl::ReportSizeInfo(DWORD thread, const SOSStackRefData &stackRef, T
     MTInfo *mtInfo = GetMTInfo(mt);
     const WCHAR *type = mtInfo ? mtInfo->GetTypeName() : W("unknown type");
     
-    size_t size = mSizes[obj];
+    size_t size = (size_t)mSizes.Get(obj);
     ExtOut("Thread %x (%S): %S: %d (0x%x) bytes (%S)\n", thread, frame.c_str(), regOutput.c_str(), size, size, type);
 }
 
@@ -579,19 +2031,19 @@ int GCRootImpl::PrintRootsInOlderGen()
 
 int GCRootImpl::PrintRootsOnFQ(bool notReadyForFinalization)
 {
-    // Here are objects kept alive by objects in the finalizer queue.
-    DacpGcHeapDetails heapDetails;
-
     // Use a different linear read cache here instead of polluting the object read cache.
     LinearReadCache cache(512);
 
+    // Per-heap details come from the session snapshot.
+    if (!g_snapshot.Build())
+    {
+        ExtErr("Error requesting heap data.\n");
+        return 0;
+    }
+
     if (!IsServerBuild())
     {
-        if (heapDetails.Request(g_sos) != S_OK)
-        {
-            ExtErr("Error requesting heap data.\n");
-            return 0;
-        }
+        DacpGcHeapDetails &heapDetails = *g_snapshot.GetHeapDetails(0);
 
         // If we include objects that are not ready for finalization, we may report
         // false positives.  False positives occur if the object is not ready for finalization
@@ -613,30 +2065,12 @@ int GCRootImpl::PrintRootsOnFQ(bool notReadyForFinalization)
     }
     else
     {
-        DWORD dwAllocSize;
-        DWORD dwNHeaps = GetGcHeapCount();
-        if (!ClrSafeInt<DWORD>::multiply(sizeof(CLRDATA_ADDRESS), dwNHeaps, dwAllocSize))
-        {
-            ExtErr("Failed to get GCHeaps:  integer overflow\n");
-            return 0;
-        }
-
-        CLRDATA_ADDRESS *heapAddrs = (CLRDATA_ADDRESS*)alloca(dwAllocSize);
-        if (g_sos->GetGCHeapList(dwNHeaps, heapAddrs, NULL) != S_OK)
-        {
-            ExtErr("Error requesting heap data.\n");
-            return 0;
-        }
-
         int total = 0;
-        for (UINT n = 0; n < dwNHeaps; n ++)
+        int nHeaps = g_snapshot.GetHeapCount();
+        for (int n = 0; n < nHeaps; n ++)
         {
-            if (heapDetails.Request(g_sos, heapAddrs[n]) != S_OK)
-            {
-                ExtErr("Error requesting heap data for heap %d.\n", n);
-                continue;
-            }
-            
+            DacpGcHeapDetails &heapDetails = *g_snapshot.GetHeapDetails(n);
+
             // If we include objects that are not ready for finalization, we may report
             // false positives.  False positives occur if the object is not ready for finalization
             // and does not re-register itself for finalization inside the finalizer.
@@ -652,7 +2086,7 @@ int GCRootImpl::PrintRootsOnFQ(bool notReadyForFinalization)
                 start = TO_TADDR(SegQueue(heapDetails, CriticalFinalizerListSeg));
                 stop = TO_TADDR(SegQueueLimit(heapDetails, FinalizerListSeg));
             }
-            
+
             total += PrintRootsInRange(cache, start, stop, &GCRootImpl::ReportOneFQEntry, total == 0);
         }
 
@@ -683,6 +2117,9 @@ int GCRootImpl::PrintRootsInRange(LinearReadCache &cache, TADDR start, TADDR sto
                 func(root, path, printHeader);
                 total++;
                 printHeader = false;
+
+                if (SearchComplete())
+                    return total;
             }
         }
 
@@ -707,12 +2144,12 @@ int GCRootImpl::PrintRootsOnAllThreads()
     DacpThreadData vThread;
     for (int i = 0; i < numThreads; i++)
     {
-        if (IsInterrupt())
+        if (IsInterrupt() || SearchComplete())
             return total;
-        
+
         if (FAILED(vThread.Request(g_sos, threadList[i])))
             continue;
-        
+
         if (vThread.osThreadId)
             total += PrintRootsOnThread(vThread.osThreadId);
     }
@@ -754,6 +2191,9 @@ int GCRootImpl::PrintRootsOnThread(DWORD osThreadId)
                 ReportOnePath(osThreadId, refs[i], path, first, reportFrame);
                 first = false;
                 total++;
+
+                if (SearchComplete())
+                    return total;
             }
             
             if (mSize)
@@ -781,61 +2221,85 @@ int GCRootImpl::PrintRootsOnHandleTable(int gen)
         return 0;
     }
     
-    int total = 0;
-    unsigned int fetched = 0;
-    SOSHandleData handles[8];
-    
-    bool printHeader = true;
-    do
+    // Drain the enumerator up front and walk the handles in address order, so
+    // the reads which resolve each handle to its object are sequential.
+    std::vector<SOSHandleData> handles;
+    if (!FetchSortedHandleTable(pEnum, handles))
     {
-        // Fetch more handles
-        hr = pEnum->Next(_countof(handles), handles, &fetched);
-        if (FAILED(hr))
-        {
-            ExtOut("Failed to request more handles.\n");
-            return total;
-        }
+        ExtOut("Failed to request more handles.\n");
+        return 0;
+    }
 
-        // Find rooting info for each handle.
-        for (unsigned int i = 0; i < fetched; ++i)
+    // Resolve every strong handle to its object in one scatter-gather
+    // request; everything below consumes the values, so fetching them up
+    // front removes one small read per handle.
+    std::vector<TADDR> referents(handles.size(), 0);
+    {
+        std::vector<ReadVirtualRange> ranges;
+        for (size_t i = 0; i < handles.size(); ++i)
         {
-            if (IsInterrupt())
-                return total;
-            
-            // Ignore handles which aren't actually roots.
             if (!handles[i].StrongReference)
                 continue;
-            
-            // clear the size table
-            if (mAll)
-                ClearSizeData();
 
-            // Get the object the handle points to.
-            TADDR root = ReadPointer(TO_TADDR(handles[i].Handle));
+            ReadVirtualRange range;
+            range.Address = handles[i].Handle;
+            range.Buffer = &referents[i];
+            range.Size = sizeof(TADDR);
+            ranges.push_back(range);
+        }
+
+        ReadVirtualBatch(ranges.data(), (ULONG)ranges.size());
+    }
+
+    int total = 0;
+    bool printHeader = true;
+
+    // Find rooting info for each handle.
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        if (IsInterrupt())
+            return total;
+
+        // Ignore handles which aren't actually roots.
+        if (!handles[i].StrongReference)
+            continue;
 
-            // Only inspect handle if the object is non-null, and not one we've already walked.
-            if (root)
+        // clear the size table
+        if (mAll)
+            ClearSizeData();
+
+        // Get the object the handle points to.
+        TADDR root = referents[i];
+
+        // Only inspect handle if the object is non-null, and not one we've already walked.
+        if (root)
+        {
+            // Find all paths to the object and don't clean up the return value.
+            // It's tracked by mCleanupList.
+            RootNode *path = FindPathToTarget(root);
+            if (path)
             {
-                // Find all paths to the object and don't clean up the return value.
-                // It's tracked by mCleanupList.
-                RootNode *path = FindPathToTarget(root);
-                if (path)
-                {
-                    ReportOneHandlePath(handles[i], path, printHeader);
-                    printHeader = false;
-                    total++;
-                }
+                ReportOneHandlePath(handles[i], path, printHeader);
+                printHeader = false;
+                total++;
 
-                if (mSize)
-                    ReportSizeInfo(handles[i], root);
+                if (!mSize && SearchComplete())
+                    return total;
             }
+
+            if (mSize)
+                ReportSizeInfo(handles[i], root);
         }
     }
-    while (_countof(handles) == fetched);
 
     return total;
 }
 
+bool GCRootImpl::SearchComplete()
+{
+    return mFirstOnly && !mTargets.empty() && mFoundTargets.size() >= mTargets.size();
+}
+
 GCRootImpl::RootNode *GCRootImpl::FilterRoots(RootNode *&list)
 {
     // Filter the list of GC refs:
@@ -857,7 +2321,7 @@ GCRootImpl::RootNode *GCRootImpl::FilterRoots(RootNode *&list)
             targetItr->second->FromDependentHandle = curr->FromDependentHandle;
             return targetItr->second;
         }
-        else if (mConsidered.find(curr->Object) != mConsidered.end())
+        else if (IsConsidered(curr->Object))
         {
             curr->Remove(list);
 
@@ -890,22 +2354,30 @@ GCRootImpl::RootNode *GCRootImpl::FindPathToTarget(TADDR root)
     // Early out.  We may have already looked at this object.
     std::unordered_map<TADDR, RootNode *>::iterator targetItr = mTargets.find(root);
     if (targetItr != mTargets.end())
+    {
+        mFoundTargets.insert(root);
         return targetItr->second;
-    else if (mConsidered.find(root) != mConsidered.end())
+    }
+    else if (IsConsidered(root))
+    {
         return NULL;
-    
+    }
+
     // Add obj as a considered node (since we are considering it now).
-    mConsidered.insert(root);
+    MarkConsidered(root);
 
     // Create path.
     RootNode *path = NewNode(root);
 
     RootNode *curr = path;
+    int depth = 1;
     while (curr)
     {
         if (IsInterrupt())
             return NULL;
-        
+
+        SOSProgressStep("gcroot walk", curr->Object);
+
         // If this is a new reference we are walking, we haven't filled the list of objects
         // this one points to.  Update that first.
         if (!curr->FilledRefs)
@@ -922,7 +2394,8 @@ GCRootImpl::RootNode *GCRootImpl::FindPathToTarget(TADDR root)
                 // Link the current to the target.
                 curr->Next = foundTarget;
                 foundTarget->Prev = curr;
-                
+                mFoundTargets.insert(foundTarget->Object);
+
                 // If the user requested all paths, set each node in the path to be a target.
                 // Normally, we don't consider a node we've already seen, which means if we don't
                 // get a *completely* unique path, it's not printed out.  By adding each of the
@@ -944,6 +2417,23 @@ GCRootImpl::RootNode *GCRootImpl::FindPathToTarget(TADDR root)
                 
                 return path;
             }
+
+            // Depth bound: the refs of a node at the limit were still
+            // checked against the targets above, but the walk does not
+            // descend into them.  Objects dropped here were never marked
+            // considered, so another root can still reach them.
+            if (mMaxDepth > 0 && depth >= mMaxDepth)
+            {
+                while (curr->GCRefs)
+                {
+                    RootNode *drop = curr->GCRefs;
+                    curr->GCRefs = drop->Next;
+                    if (curr->GCRefs)
+                        curr->GCRefs->Prev = NULL;
+
+                    DeleteNode(drop);
+                }
+            }
         }
 
         // We have filled the references, now walk them depth-first.
@@ -952,7 +2442,7 @@ GCRootImpl::RootNode *GCRootImpl::FindPathToTarget(TADDR root)
             RootNode *next = curr->GCRefs;
             curr->GCRefs = next->Next;
 
-            if (mConsidered.find(next->Object) != mConsidered.end())
+            if (IsConsidered(next->Object))
             {
                 // Whoops.  This object was considered deeper down the tree, so we
                 // don't need to do it again.  Delete this node and continue looping.
@@ -970,9 +2460,10 @@ GCRootImpl::RootNode *GCRootImpl::FindPathToTarget(TADDR root)
                 curr->Next = next;
                 next->Prev = curr;
                 curr = next;
-                
+                depth++;
+
                 // Finally, insert the current object into the considered set.
-                mConsidered.insert(curr->Object);
+                MarkConsidered(curr->Object);
                 // Now the next iteration will operate on "next".
             }
         }
@@ -981,6 +2472,7 @@ GCRootImpl::RootNode *GCRootImpl::FindPathToTarget(TADDR root)
             // This object has no more GCRefs.  We now need to "pop" it from the current path.
             RootNode *tmp = curr;
             curr = curr->Prev;
+            depth--;
             DeleteNode(tmp);
         }
     }
@@ -1007,6 +2499,56 @@ GCRootImpl::RootNode *GCRootImpl::GetGCRefs(RootNode *path, RootNode *node)
     if (!node->MTInfo)
         return NULL;
 
+    // Answer from the persistent graph index when one is mapped; the stored
+    // edges are exactly what the GCDesc walk below would produce.
+    size_t indexSlot;
+    if (mIndex && mIndex->FindObject(obj, indexSlot))
+    {
+        if (mSize)
+        {
+            size_t objSize = mIndex->GetObjectSize(indexSlot);
+            mSizes.Set(obj, 0);
+
+            while (path)
+            {
+                mSizes.Add(path->Object, objSize);
+                path = path->Next;
+            }
+        }
+
+        size_t count = 0;
+        const ULONG64 *targets = mIndex->GetRefs(indexSlot, count);
+
+        RootNode *refs = NewNode();
+        RootNode *curr = refs;
+        for (size_t i = 0; i < count; ++i)
+        {
+            curr->Next = NewNode(TO_TADDR(targets[i]));
+            curr->Next->Prev = curr;
+            curr = curr->Next;
+        }
+
+        // Dependent handle edges are not part of the index; add them from the
+        // map, the same way the GCDesc walk does.
+        const std::list<TADDR> *depRefs = mDependentHandleMap->Lookup(obj);
+        if (depRefs)
+        {
+            for (std::list<TADDR>::const_iterator litr = depRefs->begin(); litr != depRefs->end(); ++litr)
+            {
+                curr->Next = NewNode(*litr, NULL, true);
+                curr->Next->Prev = curr;
+                curr = curr->Next;
+            }
+        }
+
+        curr = refs;
+        refs = refs->Next;
+        DeleteNode(curr);
+
+        PrefetchObjects(refs);
+        return refs;
+    }
+
     // Only calculate the size if we need it.
     size_t objSize = 0;
     if (mSize || node->MTInfo->ContainsPointers || node->MTInfo->Collectible)
@@ -1016,11 +2558,11 @@ GCRootImpl::RootNode *GCRootImpl::GetGCRefs(RootNode *path, RootNode *node)
         // Update object size list, if requested.
         if (mSize)
         {
-            mSizes[obj] = 0;
+            mSizes.Set(obj, 0);
             
             while (path)
             {
-                mSizes[path->Object] += objSize;
+                mSizes.Add(path->Object, objSize);
                 path = path->Next;
             }
         }
@@ -1051,10 +2593,10 @@ GCRootImpl::RootNode *GCRootImpl::GetGCRefs(RootNode *path, RootNode *node)
     }
     
     // Add edges from dependent handles.
-    std::unordered_map<TADDR, std::list<TADDR>>::iterator itr = mDependentHandleMap.find(obj);
-    if (itr != mDependentHandleMap.end())
+    const std::list<TADDR> *depRefs = mDependentHandleMap->Lookup(obj);
+    if (depRefs)
     {
-        for (std::list<TADDR>::iterator litr = itr->second.begin(); litr != itr->second.end(); ++litr)
+        for (std::list<TADDR>::const_iterator litr = depRefs->begin(); litr != depRefs->end(); ++litr)
         {
             curr->Next = NewNode(*litr, NULL, true);
             curr->Next->Prev = curr;
@@ -1067,9 +2609,48 @@ GCRootImpl::RootNode *GCRootImpl::GetGCRefs(RootNode *path, RootNode *node)
     refs = refs->Next;
     DeleteNode(curr);
 
+    PrefetchObjects(refs);
     return refs;
 }
 
+void GCRootImpl::PrefetchObjects(RootNode *refs)
+{
+    // Dequeuing a child costs a chain of dependent reads: the MethodTable
+    // pointer, then the size fields, then the reference slots.  The child
+    // addresses are known the moment the list is built, so warm the pages
+    // holding their headers in one batched pass.  Sorting the addresses
+    // turns scattered single-page fills into ascending runs, which the
+    // cache's streaming-run detection fetches with one large read each;
+    // each child's own walk then starts from a warm cache instead of a
+    // round trip per object.
+    std::vector<TADDR> addrs;
+    for (RootNode *node = refs; node; node = node->Next)
+        if (node->Object && !IsConsidered(node->Object))
+            addrs.push_back(node->Object);
+
+    if (addrs.size() < 2)
+        return;
+
+    std::sort(addrs.begin(), addrs.end());
+
+    // Warming more distinct pages than the cache holds would just evict the
+    // pages warmed a moment ago.
+    const TADDR pageMask = ~((TADDR)mCache.PageSize() - 1);
+    int pagesWarmed = 0;
+    TADDR lastPage = 0;
+
+    for (size_t i = 0; i < addrs.size() && pagesWarmed < mCache.PageCount(); ++i)
+    {
+        TADDR page = addrs[i] & pageMask;
+        if (page == lastPage)
+            continue;
+
+        mCache.EnsureRangeInCache(addrs[i], (unsigned int)(3 * sizeof(TADDR)));
+        lastPage = page;
+        pagesWarmed++;
+    }
+}
+
 DWORD GCRootImpl::GetComponents(TADDR obj, TADDR mt)
 {
     // Get the number of components in the object (for arrays and such).
@@ -1272,24 +2853,27 @@ UINT FindAllPinnedAndStrong(DWORD_PTR handlearray[], UINT arraySize)
 
 void PrintNotReachableInRange(TADDR rngStart, TADDR rngEnd, BOOL bExcludeReadyForFinalization, HeapStat* hpstat, BOOL bShort)
 {
+    // One marking pass answers liveness for every queue entry through the
+    // segment bitmap; materializing the live set as a hash of every object
+    // address is both slower to build and much larger than the bitmap.
     GCRootImpl gcroot;
-    const std::unordered_set<TADDR> &liveObjs = gcroot.GetLiveObjects(bExcludeReadyForFinalization == TRUE);
+    gcroot.BuildLivenessMap(bExcludeReadyForFinalization == TRUE);
 
     LinearReadCache cache(512);
     cache.EnsureRangeInCache(rngStart, (unsigned int)(rngEnd-rngStart));
-    
+
     for (TADDR p = rngStart; p < rngEnd; p += sizeof(TADDR))
     {
         if (IsInterrupt())
             break;
-        
+
         TADDR header = 0;
         TADDR obj = 0;
         TADDR taddrMT = 0;
-        
+
         bool read = cache.Read(p-sizeof(SIZEOF_OBJHEADER), &header);
         read = read && cache.Read(p, &obj);
-        if (read && ((header & BIT_SBLK_FINALIZER_RUN) == 0) && liveObjs.find(obj) == liveObjs.end())
+        if (read && ((header & BIT_SBLK_FINALIZER_RUN) == 0) && !gcroot.IsLive(obj))
         {
             if (bShort)
             {
@@ -1428,13 +3012,46 @@ size_t mark_word_of(CLRDATA_ADDRESS add)
     return (size_t)(add / mark_word_size);
 }
 
+// Each mark word covers only 32 mark bits, so a liveness walk over a segment
+// asks for millions of them, in ascending address order.  Cache a large block
+// of the mark array and refill it on a miss, so almost every lookup is
+// answered in memory instead of with its own cross-interface read.
+static const size_t kMarkWordBlock = 0x10000;   // DWORDs per block read.
+
+static CLRDATA_ADDRESS g_markArrayBase = 0;     // The mark array the block was read from.
+static size_t g_markBlockStart = 0;             // The first mark word in the block.
+static size_t g_markBlockCount = 0;             // The number of valid words in the block.
+static DWORD g_markBlock[kMarkWordBlock];
+
+static BOOL ReadMarkArrayEntry(const DacpGcHeapDetails &heap, size_t word, DWORD &entry)
+{
+    if (heap.mark_array != g_markArrayBase || word < g_markBlockStart || word >= g_markBlockStart + g_markBlockCount)
+    {
+        ULONG read = 0;
+        if (FAILED(g_ExtData->ReadVirtual(TO_CDADDR(heap.mark_array + sizeof(DWORD) * word),
+                                          g_markBlock, sizeof(g_markBlock), &read))
+            || read < sizeof(DWORD))
+        {
+            // The block may span past the end of the committed mark array;
+            // fall back to the original single-DWORD read.
+            g_markBlockCount = 0;
+            return SUCCEEDED(MOVE(entry, heap.mark_array + sizeof(DWORD) * word));
+        }
+
+        g_markArrayBase = heap.mark_array;
+        g_markBlockStart = word;
+        g_markBlockCount = read / sizeof(DWORD);
+    }
+
+    entry = g_markBlock[word - g_markBlockStart];
+    return TRUE;
+}
+
 inline BOOL mark_array_marked(const DacpGcHeapDetails &heap, CLRDATA_ADDRESS add)
 {
 
     DWORD entry = 0;
-    HRESULT hr = MOVE(entry, heap.mark_array + sizeof(DWORD) * mark_word_of(add));
-
-    if (FAILED(hr))
+    if (!ReadMarkArrayEntry(heap, mark_word_of(add), entry))
         ExtOut("Failed to read card table entry.\n");
 
     return entry & (1 << mark_bit_bit_of(add));
@@ -1686,114 +3303,120 @@ BOOL VerifyObject(const DacpGcHeapDetails &heap, DWORD_PTR objAddr, DWORD_PTR MT
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
-typedef void (*TYPETREEVISIT)(size_t methodTable, size_t ID, LPVOID token);
 
-// TODO remove this.   MethodTableCache already maps method tables to
-// various information.  We don't need TypeTree to do this too.   
-// Straightfoward to do, but low priority.  
-class TypeTree
+/* The interned type table for the heap traversal.  Types are interned into a
+ * flat hash map during the gather pass, IDs are assigned in MethodTable order
+ * once gathering is done, and the type names are copied into a bump pointer
+ * arena so the report pass never resolves a name twice.  GetID is the
+ * per-object classification step of the second pass: a single hash probe,
+ * with none of the per-type allocation and pointer chasing of the binary
+ * search tree this replaces.
+ */
+class TypeNameTable
 {
-private:
-    size_t methodTable;
-    size_t ID;
-    TypeTree *pLeft;
-    TypeTree *pRight;
+public:
+    TypeNameTable() : mNext(NULL), mChunkLeft(0)
+    {
+    }
 
-public:    
-    TypeTree(size_t MT) : methodTable(MT),ID(0),pLeft(NULL),pRight(NULL) { }
+    ~TypeNameTable()
+    {
+        for (size_t i = 0; i < mChunks.size(); ++i)
+            delete [] mChunks[i];
+    }
 
-    BOOL isIn(size_t MT, size_t *pID)
+    // Interns the MethodTable; cheap when it is already present.
+    void Insert(size_t mt)
     {
-        TypeTree *pCur = this;
+        mIDs[mt];
+    }
 
-        while (pCur)
-        {
-            if (MT == pCur->methodTable)
-            {
-                if (pID)
-                    *pID = pCur->ID;
-                return TRUE;
-            }
-            else if (MT < pCur->methodTable)
-                pCur = pCur->pLeft;
-            else
-                pCur = pCur->pRight;            
-        }
-            
-        return FALSE;
+    // Returns the ID of the MethodTable, 0 if it was never interned.
+    size_t GetID(size_t mt) const
+    {
+        std::unordered_map<size_t, size_t>::const_iterator itr = mIDs.find(mt);
+        return itr == mIDs.end() ? 0 : itr->second;
     }
 
-    BOOL insert(size_t MT)
+    // Assigns IDs in MethodTable order (starting at 1 to keep 0 free as the
+    // "not found" value) and resolves each type's name into the arena.
+    void AssignIDsAndNames()
     {
-        TypeTree *pCur = this;
+        mEntries.clear();
+        mEntries.reserve(mIDs.size());
 
-        while (pCur)
+        std::unordered_map<size_t, size_t>::iterator itr;
+        for (itr = mIDs.begin(); itr != mIDs.end(); ++itr)
         {
-            if (MT == pCur->methodTable)
-                return TRUE;
-            else if ((MT < pCur->methodTable))
-            {
-                if (pCur->pLeft)
-                    pCur = pCur->pLeft;
-                else
-                    break;
-            }
-            else if (pCur->pRight)
-                pCur = pCur->pRight;            
-            else
-                break;
-        }        
+            Entry entry = { itr->first, NULL };
+            mEntries.push_back(entry);
+        }
 
-        // If we got here, we need to append at the current node.
-        TypeTree *pNewNode = new TypeTree(MT);
-        if (pNewNode == NULL)
-            return FALSE;
-        
-        if (MT < pCur->methodTable)
-            pCur->pLeft = pNewNode;
-        else
-            pCur->pRight = pNewNode;
+        std::sort(mEntries.begin(), mEntries.end(),
+            [](const Entry &lhs, const Entry &rhs)
+            {
+                return lhs.MethodTable < rhs.MethodTable;
+            });
 
-        return TRUE;
+        for (size_t i = 0; i < mEntries.size(); ++i)
+        {
+            NameForMT_s(mEntries[i].MethodTable, g_mdName, mdNameLen);
+            mEntries[i].Name = InternName(g_mdName);
+            mIDs[mEntries[i].MethodTable] = i + 1;
+        }
     }
 
-    static void destroy(TypeTree *pStart)
+    // The interned types in ID order; entry i has ID i+1.
+    size_t Count() const
     {
-        TypeTree *pCur = pStart;
-
-        if (pCur)
-        {
-            destroy(pCur->pLeft);
-            destroy(pCur->pRight);
-            delete [] pCur;
-        }        
+        return mEntries.size();
     }
 
-    static void visit_inorder(TypeTree *pStart, TYPETREEVISIT pFunc, LPVOID token)
+    const WCHAR *GetName(size_t index) const
     {
-        TypeTree *pCur = pStart;
-
-        if (pCur)
-        {
-            visit_inorder(pCur->pLeft, pFunc, token);
-            pFunc (pCur->methodTable, pCur->ID, token);
-            visit_inorder(pCur->pRight, pFunc, token);
-        }        
+        return mEntries[index].Name;
     }
 
-    static void setTypeIDs(TypeTree *pStart, size_t *pCurID)
+private:
+    // Copies the name into the arena: a pointer bump, plus a new chunk when
+    // the current one is exhausted.
+    const WCHAR *InternName(const WCHAR *name)
     {
-        TypeTree *pCur = pStart;
+        size_t len = _wcslen(name) + 1;
 
-        if (pCur)
+        if (len > mChunkLeft)
         {
-            setTypeIDs(pCur->pLeft, pCurID);
-            pCur->ID = *pCurID;
-            (*pCurID)++;
-            setTypeIDs(pCur->pRight, pCurID);
-        }        
+            size_t chunk = kChunkSize > len ? kChunkSize : len;
+            WCHAR *data = new WCHAR[chunk];
+            if (data == NULL)
+                return W("<OOM>");
+
+            mChunks.push_back(data);
+            mNext = data;
+            mChunkLeft = chunk;
+        }
+
+        const WCHAR *result = mNext;
+        wcscpy_s(mNext, mChunkLeft, name);
+        mNext += len;
+        mChunkLeft -= len;
+        return result;
     }
-    
+
+private:
+    static const size_t kChunkSize = 0x10000;   // in WCHARs
+
+    struct Entry
+    {
+        size_t MethodTable;
+        const WCHAR *Name;
+    };
+
+    std::unordered_map<size_t, size_t> mIDs;    // MethodTable -> assigned ID
+    std::vector<Entry> mEntries;                // in ID order after AssignIDsAndNames
+    std::vector<WCHAR*> mChunks;                // name arena backing store
+    WCHAR *mNext;                               // bump pointer into the newest chunk
+    size_t mChunkLeft;                          // WCHARs left in the newest chunk
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1804,17 +3427,21 @@ HeapTraverser::HeapTraverser(bool verify)
     m_format = 0;
     m_file = NULL;
     m_objVisited = 0;
-    m_pTypeTree = NULL;
+    m_pTypes = NULL;
     m_curNID = 1;
     m_verify = verify;
+    m_binObjAddr = 0;
+    m_binObjTypeID = 0;
+    m_binObjSize = 0;
+    mDependentHandleMap = NULL;
 }
-    
-HeapTraverser::~HeapTraverser() 
-{ 
-    if (m_pTypeTree) { 
-        TypeTree::destroy(m_pTypeTree); 
-        m_pTypeTree = NULL;
-    } 
+
+HeapTraverser::~HeapTraverser()
+{
+    if (m_pTypes) {
+        delete m_pTypes;
+        m_pTypes = NULL;
+    }
 }
 
 BOOL HeapTraverser::Initialize()
@@ -1825,17 +3452,17 @@ BOOL HeapTraverser::Initialize()
         return FALSE;
     }
 
-    GCRootImpl::GetDependentHandleMap(mDependentHandleMap);
+    mDependentHandleMap = GCRootImpl::GetDependentHandleMap();
 
-    size_t startID = 1;
-    TypeTree::setTypeIDs(m_pTypeTree, &startID);
+    if (m_pTypes)
+        m_pTypes->AssignIDsAndNames();
 
     return TRUE;
 }
 
 BOOL HeapTraverser::CreateReport (FILE *fp, int format)
 {
-    if (fp == NULL || (format!=FORMAT_XML && format != FORMAT_CLRPROFILER))
+    if (fp == NULL || (format!=FORMAT_XML && format != FORMAT_CLRPROFILER && format != FORMAT_BINARY))
     {
         return FALSE;
     }
@@ -1845,8 +3472,12 @@ BOOL HeapTraverser::CreateReport (FILE *fp, int format)
 
     PrintSection(TYPE_START,TRUE);                     
     
-    PrintSection(TYPE_TYPES,TRUE);        
-    TypeTree::visit_inorder(m_pTypeTree, HeapTraverser::PrintOutTree, this);
+    PrintSection(TYPE_TYPES,TRUE);
+    if (m_pTypes)
+    {
+        for (size_t i = 0; i < m_pTypes->Count(); ++i)
+            PrintType(i + 1, m_pTypes->GetName(i));
+    }
     PrintSection(TYPE_TYPES,FALSE);
 
     ExtOut("tracing roots...\n");
@@ -1874,35 +3505,28 @@ BOOL HeapTraverser::CreateReport (FILE *fp, int format)
 
 void HeapTraverser::insert(size_t mTable)
 {
-    if (m_pTypeTree == NULL)
+    if (m_pTypes == NULL)
     {
-        m_pTypeTree = new TypeTree(mTable);
-        if (m_pTypeTree == NULL)
+        m_pTypes = new TypeNameTable;
+        if (m_pTypes == NULL)
         {
             ReportOOM();
             return;
         }
     }
-    else
-    {
-        m_pTypeTree->insert(mTable);
-    }
+
+    m_pTypes->Insert(mTable);
 }
 
 size_t HeapTraverser::getID(size_t mTable)
 {
-    if (m_pTypeTree == NULL)
+    if (m_pTypes == NULL)
     {
         return 0;
     }
+
     // IDs start at 1, so we can return 0 if not found.
-    size_t ret;
-    if (m_pTypeTree->isIn(mTable,&ret))
-    {
-        return ret;
-    }
-    
-    return 0;
+    return m_pTypes->GetID(mTable);
 }
 
 #ifndef FEATURE_PAL
@@ -1944,6 +3568,16 @@ void HeapTraverser::PrintType(size_t ID,LPCWSTR name)
             "t %d 0 %S\n",
             ID,name);
     }
+    else if (m_format==FORMAT_BINARY)
+    {
+        // 't' <id:8> <byteLen:4> <name: UTF-16LE, no terminator>
+        ULONG64 id = ID;
+        DWORD byteLen = (DWORD)(_wcslen(name)*sizeof(WCHAR));
+        fputc('t', m_file);
+        fwrite(&id, sizeof(id), 1, m_file);
+        fwrite(&byteLen, sizeof(byteLen), 1, m_file);
+        fwrite(name, 1, byteLen, m_file);
+    }
 }
 
 void HeapTraverser::PrintObjectHead(size_t objAddr,size_t typeID,size_t Size)
@@ -1970,6 +3604,15 @@ void HeapTraverser::PrintObjectHead(size_t objAddr,size_t typeID,size_t Size)
             "o 0x%p %d %d ",
             (PBYTE)objAddr,typeID,Size);
     }
+    else if (m_format==FORMAT_BINARY)
+    {
+        // The record is written by PrintObjectTail, once the number of
+        // references is known.
+        m_binObjAddr = objAddr;
+        m_binObjTypeID = typeID;
+        m_binObjSize = Size;
+        m_binRefs.clear();
+    }
 }
 
 void HeapTraverser::PrintLoaderAllocator(size_t memberValue)
@@ -1986,6 +3629,10 @@ void HeapTraverser::PrintLoaderAllocator(size_t memberValue)
             " 0x%p",
             (PBYTE)memberValue);
     }
+    else if (m_format == FORMAT_BINARY)
+    {
+        m_binRefs.push_back(std::make_pair((ULONG64)memberValue, (BYTE)2));
+    }
 }
 
 void HeapTraverser::PrintObjectMember(size_t memberValue, bool dependentHandle)
@@ -2002,6 +3649,10 @@ void HeapTraverser::PrintObjectMember(size_t memberValue, bool dependentHandle)
             " 0x%p",
             (PBYTE)memberValue);    
     }
+    else if (m_format==FORMAT_BINARY)
+    {
+        m_binRefs.push_back(std::make_pair((ULONG64)memberValue, (BYTE)(dependentHandle ? 1 : 0)));
+    }
 }
 
 void HeapTraverser::PrintObjectTail()
@@ -2016,6 +3667,23 @@ void HeapTraverser::PrintObjectTail()
         fprintf(m_file,
             "\n");
     }
+    else if (m_format==FORMAT_BINARY)
+    {
+        // 'o' <address:8> <typeID:8> <size:8> <refCount:4>
+        // followed by refCount references, each <value:8> <kind:1>
+        // (kind 0 = member, 1 = dependent handle, 2 = loader allocator).
+        DWORD refCount = (DWORD)m_binRefs.size();
+        fputc('o', m_file);
+        fwrite(&m_binObjAddr, sizeof(m_binObjAddr), 1, m_file);
+        fwrite(&m_binObjTypeID, sizeof(m_binObjTypeID), 1, m_file);
+        fwrite(&m_binObjSize, sizeof(m_binObjSize), 1, m_file);
+        fwrite(&refCount, sizeof(refCount), 1, m_file);
+        for (DWORD i = 0; i < refCount; i++)
+        {
+            fwrite(&m_binRefs[i].first, sizeof(ULONG64), 1, m_file);
+            fputc(m_binRefs[i].second, m_file);
+        }
+    }
 }
 
 void HeapTraverser::PrintRootHead()
@@ -2042,6 +3710,15 @@ void HeapTraverser::PrintRoot(LPCWSTR kind,size_t Value)
             "0x%p ",
             (PBYTE)Value);
     }
+    else if (m_format==FORMAT_BINARY)
+    {
+        // 'r' <kind:1> <address:8> (kind 0 = stack, 1 = handle)
+        BYTE kindByte = (_wcscmp(kind, W("stack")) == 0) ? 0 : 1;
+        fputc('r', m_file);
+        fputc(kindByte, m_file);
+        ULONG64 value = Value;
+        fwrite(&value, sizeof(value), 1, m_file);
+    }
 }
 
 void HeapTraverser::PrintRootTail()
@@ -2076,6 +3753,23 @@ void HeapTraverser::PrintSection(int Type,BOOL bOpening)
             fprintf(m_file,"\n");
         }
     }
+    else if (m_format==FORMAT_BINARY)
+    {
+        if (Type == TYPE_START)
+        {
+            if (bOpening)
+            {
+                // Fixed 16 byte header: magic, format version, the size of a
+                // target pointer, and six reserved bytes.
+                BYTE header[16] = { 'S','O','S','H','E','A','P','B', 1, sizeof(void*), 0, 0, 0, 0, 0, 0 };
+                fwrite(header, sizeof(header), 1, m_file);
+            }
+            else
+            {
+                fputc('E', m_file);
+            }
+        }
+    }
 }
 
 void HeapTraverser::FindGCRootOnStacks()
@@ -2118,15 +3812,6 @@ void HeapTraverser::FindGCRootOnStacks()
 }
 
 
-/* static */ void HeapTraverser::PrintOutTree(size_t methodTable, size_t ID, 
-    LPVOID token)
-{
-    HeapTraverser *pHolder = (HeapTraverser *) token;
-    NameForMT_s(methodTable, g_mdName, mdNameLen);
-    pHolder->PrintType(ID,g_mdName);
-}
-
-
 /* static */ void HeapTraverser::PrintHeap(DWORD_PTR objAddr,size_t Size,
     DWORD_PTR methodTable, LPVOID token)
 {    
@@ -2239,10 +3924,10 @@ void HeapTraverser::PrintRefs(size_t obj, size_t methodTable, size_t size)
         }
     }
     
-    std::unordered_map<TADDR, std::list<TADDR>>::iterator itr = mDependentHandleMap.find((TADDR)obj);
-    if (itr != mDependentHandleMap.end())
+    const std::list<TADDR> *depRefs = mDependentHandleMap->Lookup((TADDR)obj);
+    if (depRefs)
     {
-        for (std::list<TADDR>::iterator litr = itr->second.begin(); litr != itr->second.end(); ++litr)
+        for (std::list<TADDR>::const_iterator litr = depRefs->begin(); litr != depRefs->end(); ++litr)
         {
             PrintObjectMember(*litr, true);
         }
@@ -0,0 +1,1349 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "sos.h"
+#include "gcdesc.h"
+#include "safemath.h"
+#include "heapwalk.h"
+#include "taskpool.h"
+
+#include <algorithm>
+
+// Amount of segment memory a worker reads per serialized ReadVirtual call.
+const ULONG kHeapWalkChunkSize = 0x100000;
+
+// Bounded by WaitForMultipleObjects.
+const int kMaxHeapWalkWorkers = 64;
+
+// Card and mark array math used by the verifier.  This must be kept in sync
+// with the analogous code in gcroot.cpp (which mirrors gc.cpp).
+#define card_word_width ((size_t)32)
+
+#if defined (_TARGET_WIN64_)
+#define card_size ((size_t)(2*DT_GC_PAGE_SIZE/card_word_width))
+#else
+#define card_size ((size_t)(DT_GC_PAGE_SIZE/card_word_width))
+#endif //_TARGET_WIN64_
+
+#define mark_bit_pitch 8
+#define mark_word_width 32
+#define mark_word_size (mark_word_width * mark_bit_pitch)
+#define heap_segment_flags_swept 16
+
+enum c_gc_state
+{
+    c_gc_state_marking,
+    c_gc_state_planning,
+    c_gc_state_free
+};
+
+inline size_t card_word(size_t card)
+{
+    return card / card_word_width;
+}
+
+inline unsigned card_bit(size_t card)
+{
+    return (unsigned)(card % card_word_width);
+}
+
+inline size_t card_of(TADDR object)
+{
+    return (size_t)object / card_size;
+}
+
+inline size_t mark_bit_bit_of(CLRDATA_ADDRESS add)
+{
+    return (size_t)((add / mark_bit_pitch) % mark_word_width);
+}
+
+inline size_t mark_word_of(CLRDATA_ADDRESS add)
+{
+    return (size_t)(add / mark_word_size);
+}
+
+inline TADDR heapwalk_align_down(TADDR addr, size_t alignment)
+{
+    return addr & ~((TADDR)alignment - 1);
+}
+
+/* The per-thread state of the pool.  Statistics and MethodTable data are
+ * accumulated without any synchronization and merged by the main thread once
+ * the pool has drained.
+ */
+struct HeapWalkWorker
+{
+    ParallelHeapWalker *Owner;
+    HANDLE Thread;
+    HeapStat Stats;
+    ParallelHeapWalker::MTSizeMap MTCache;
+    BYTE *Buffer;
+
+    // Verification state.  The GCDesc cache holds the raw slots read from
+    // below each MethodTable; an empty vector is a negative entry.  The bgc
+    // booleans are recomputed at the start of each segment.
+    HeapWalkReadCache Cache;
+    std::unordered_map<TADDR, std::vector<DWORD_PTR> > GCDescCache;
+    BOOL ConsiderBgcMark;
+    BOOL CheckCurrentSweep;
+    BOOL CheckSavedSweep;
+
+    HeapWalkWorker(ParallelHeapWalker *owner)
+        : Owner(owner), Thread(NULL),
+          ConsiderBgcMark(FALSE), CheckCurrentSweep(FALSE), CheckSavedSweep(FALSE)
+    {
+        Stats.SetWorkerMode();
+        Buffer = (BYTE*)AllocScratchBuffer(kHeapWalkChunkSize);
+        if (owner->mVerify && !Cache.Init(&owner->mLock))
+        {
+            FreeScratchBuffer(Buffer, kHeapWalkChunkSize);
+            Buffer = NULL;
+        }
+    }
+
+    ~HeapWalkWorker()
+    {
+        FreeScratchBuffer(Buffer, kHeapWalkChunkSize);
+    }
+
+    void Walk()
+    {
+        for (;;)
+        {
+            LONG index = InterlockedIncrement(&Owner->mNextSegment) - 1;
+            if (index >= (LONG)Owner->mSegments.size())
+                break;
+
+            if (Owner->mCancel || Owner->mFailed)
+                break;
+
+            if (!WalkSegment((int)index))
+                break;
+        }
+    }
+
+    BOOL WalkSegment(int index)
+    {
+        const ParallelHeapWalker::Segment &seg = Owner->mSegments[index];
+        ParallelHeapWalker::SegmentResult &result = Owner->mResults[index];
+        const DacpGcHeapDetails &heap = Owner->mHeap.GetHeapDetails(seg.Heap);
+
+        if (Owner->mVerify)
+            ShouldCheckBgcMark(heap, seg.Data);
+
+        TADDR winStart = 0, winEnd = 0;     // span of the segment currently buffered
+
+        TADDR lastFreeObj = 0;
+        size_t lastFreeSize = 0;
+
+        TADDR curr = seg.Start;
+        while (curr < seg.End)
+        {
+            if (Owner->mCancel || Owner->mFailed)
+                return FALSE;
+
+            if (!seg.Large)
+            {
+                // Is this the beginning of an allocation context?  There can be
+                // allocated memory at the end of an allocation context that does
+                // not contain any objects yet, so we must skip over it.
+                const AllocInfo &allocInfo = Owner->mAllocInfo;
+                int i;
+                for (i = 0; i < allocInfo.num; i++)
+                {
+                    if (curr == (TADDR)allocInfo.array[i].alloc_ptr)
+                    {
+                        curr = (TADDR)allocInfo.array[i].alloc_limit + Align(min_obj_size);
+                        break;
+                    }
+                }
+                if (i < allocInfo.num)
+                    continue;
+
+                // We also need to look at the gen0 alloc context.
+                if (curr == TO_TADDR(heap.generation_table[0].allocContextPtr))
+                {
+                    curr = TO_TADDR(heap.generation_table[0].allocContextLimit) + Align(min_obj_size);
+                    continue;
+                }
+            }
+
+            // Make sure the object header (MethodTable and component count) is
+            // buffered before decoding it.
+            if (curr < winStart || curr + 2*sizeof(TADDR) > winEnd)
+            {
+                TADDR remaining = seg.End + 2*sizeof(TADDR) - curr;
+                ULONG toRead = remaining < kHeapWalkChunkSize ? (ULONG)remaining : kHeapWalkChunkSize;
+                ULONG read = Owner->ReadChunk(curr, Buffer, toRead);
+                if (read < 2*sizeof(TADDR))
+                    return Fail(result, curr);
+
+                winStart = curr;
+                winEnd = curr + read;
+            }
+
+            TADDR mt = *(TADDR*)(Buffer + (curr - winStart)) & ~3;
+            if (mt == 0)
+                return Fail(result, curr);
+
+            const ParallelHeapWalker::MTSizeInfo *info = Owner->LookupMT(mt, MTCache);
+            if (info == NULL)
+                return Fail(result, curr);
+
+            size_t size = info->BaseSize;
+            if (info->ComponentSize)
+            {
+                // The number of components is always the second pointer in the
+                // object.  The component count of a String does not include the
+                // trailing null character, so add it ourselves.
+                DWORD components = *(DWORD*)(Buffer + (curr - winStart) + sizeof(TADDR));
+                if (mt == TO_TADDR(g_special_usefulGlobals.StringMethodTable))
+                    components++;
+
+                size += (size_t)info->ComponentSize * components;
+            }
+
+#ifdef _TARGET_WIN64_
+            // Pad to min object size if necessary.
+            if (size < min_obj_size)
+                size = min_obj_size;
+#endif // _TARGET_WIN64_
+
+            size_t alignedSize = seg.Large ? AlignLarge(size) : Align(size);
+            if (alignedSize == 0 || curr + alignedSize < curr)
+                return Fail(result, curr);
+
+            if (Owner->mVerify && !IsMTForFreeObj(mt))
+                VerifyObject(seg, heap, result, curr, mt, size, info, winStart, winEnd);
+
+            if (result.FirstObj == 0)
+            {
+                result.FirstObj = curr;
+                result.FirstMT = mt;
+            }
+
+            // Fragmentation tracking mirrors the serial walk: a free block is
+            // reported together with the object which follows it.
+            if (lastFreeObj != 0)
+            {
+                result.FreeBlocks.push_back(HeapWalkFreeBlock(lastFreeObj, lastFreeSize, curr, mt));
+                lastFreeObj = 0;
+            }
+
+            if (!seg.Large && IsMTForFreeObj(mt) && size >= Owner->mMinFreeBlock)
+            {
+                lastFreeObj = curr;
+                lastFreeSize = size;
+            }
+
+            if ((Owner->mMTFilter == 0 || Owner->mMTFilter == mt) &&
+                size >= Owner->mMinSize && size <= Owner->mMaxSize)
+            {
+                Stats.Add((DWORD_PTR)mt, size, 1);
+            }
+
+            curr += alignedSize;
+        }
+
+        result.TrailingFreeObj = lastFreeObj;
+        result.TrailingFreeSize = lastFreeSize;
+        result.Walked = TRUE;
+        return TRUE;
+    }
+
+    BOOL Fail(ParallelHeapWalker::SegmentResult &result, TADDR obj)
+    {
+        if (Owner->mVerify)
+        {
+            // In verify mode an undecodable object is a finding, not a fatal
+            // error.  Record it and give up on the rest of the segment, the
+            // same recovery the serial iterator makes when it cannot advance,
+            // but keep the pool running on the remaining segments.
+            result.Failures.push_back(HeapWalkVerifyFailure(HeapWalkVerifyFailure::BadObject, obj));
+            result.Walked = TRUE;
+            return TRUE;
+        }
+
+        // Only the first failure is reported.
+        if (InterlockedExchange(&Owner->mFailed, 1) == 0)
+            Owner->mBadObject = obj;
+
+        return FALSE;
+    }
+
+    /* The checks below replicate sos::ObjectIterator::Verify and the card,
+     * mark array and bgc helpers in gcroot.cpp (which in turn mirror gc.cpp).
+     * They cannot be shared with the serial path because the serial helpers
+     * read through MOVE and g_snapshot, neither of which is safe off the main
+     * thread; all target reads here go through the worker read cache instead.
+     */
+
+    void ShouldCheckBgcMark(const DacpGcHeapDetails &heap, const DacpHeapSegmentData &seg)
+    {
+        ConsiderBgcMark = FALSE;
+        CheckCurrentSweep = FALSE;
+        CheckSavedSweep = FALSE;
+
+        if (heap.current_c_gc_state == c_gc_state_planning)
+        {
+            if ((seg.flags & heap_segment_flags_swept) || (heap.next_sweep_obj == seg.reserved))
+            {
+                // this seg was already swept.
+            }
+            else
+            {
+                ConsiderBgcMark = TRUE;
+
+                if (seg.segmentAddr == heap.saved_sweep_ephemeral_seg)
+                    CheckSavedSweep = TRUE;
+
+                if (heap.next_sweep_obj >= seg.mem && heap.next_sweep_obj < seg.reserved)
+                    CheckCurrentSweep = TRUE;
+            }
+        }
+    }
+
+    BOOL MarkArrayMarked(const DacpGcHeapDetails &heap, CLRDATA_ADDRESS add)
+    {
+        DWORD entry = 0;
+        if (!Cache.Read(TO_TADDR(heap.mark_array) + sizeof(DWORD) * mark_word_of(add), &entry))
+            return FALSE;
+
+        return entry & (1 << mark_bit_bit_of(add));
+    }
+
+    BOOL BackgroundObjectMarked(const DacpGcHeapDetails &heap, CLRDATA_ADDRESS o)
+    {
+        if ((o >= heap.background_saved_lowest_address) && (o < heap.background_saved_highest_address))
+            return MarkArrayMarked(heap, o);
+
+        return TRUE;
+    }
+
+    BOOL FgcShouldConsiderObject(const DacpGcHeapDetails &heap, CLRDATA_ADDRESS o,
+                                 const DacpHeapSegmentData &seg)
+    {
+        BOOL no_bgc_mark_p = FALSE;
+
+        if (ConsiderBgcMark)
+        {
+            if (CheckCurrentSweep && (o < heap.next_sweep_obj))
+            {
+                no_bgc_mark_p = TRUE;
+            }
+
+            if (!no_bgc_mark_p)
+            {
+                if (CheckSavedSweep && (o >= heap.saved_sweep_ephemeral_start))
+                {
+                    no_bgc_mark_p = TRUE;
+                }
+
+                if (!CheckSavedSweep)
+                {
+                    if (o >= seg.background_allocated)
+                    {
+                        no_bgc_mark_p = TRUE;
+                    }
+                }
+            }
+        }
+        else
+        {
+            no_bgc_mark_p = TRUE;
+        }
+
+        return no_bgc_mark_p ? TRUE : BackgroundObjectMarked(heap, o);
+    }
+
+    BOOL CardIsSet(const DacpGcHeapDetails &heap, TADDR objAddr)
+    {
+        // The card table has to be translated to look at the refcount, etc.
+        // g_card_table[card_word(card_of(g_lowest_address))].
+        TADDR card_table = TO_TADDR(heap.card_table);
+        card_table = card_table + card_word(card_of(TO_TADDR(heap.lowest_address)))*sizeof(DWORD);
+
+        do
+        {
+            TADDR card_table_lowest_addr;
+            TADDR card_table_next;
+
+            if (!Cache.Read(heapwalk_align_down(card_table, 0x1000) + sizeof(PVOID), &card_table_lowest_addr))
+                return FALSE;
+
+            if (!Cache.Read(card_table - sizeof(PVOID), &card_table_next))
+                return FALSE;
+
+            size_t card = (objAddr - card_table_lowest_addr) / card_size;
+            DWORD value;
+            if (!Cache.Read(card_table + card_word(card)*sizeof(DWORD), &value))
+                return FALSE;
+
+            if (value & 1<<card_bit(card))
+                return TRUE;
+
+            card_table = card_table_next;
+        }
+        while (card_table);
+
+        return FALSE;
+    }
+
+    BOOL NeedCard(TADDR parent, TADDR child)
+    {
+        int iChildGen = Owner->GetGeneration(child);
+
+        if (iChildGen == 2)
+            return FALSE;
+
+        int iParentGen = Owner->GetGeneration(parent);
+
+        return (iChildGen < iParentGen);
+    }
+
+    // Returns the GCDesc slots stored below the given MethodTable, laid out so
+    // that data() + size() is the CGCDesc, or NULL if they could not be read.
+    const std::vector<DWORD_PTR> *GetGCDesc(TADDR mt)
+    {
+        std::unordered_map<TADDR, std::vector<DWORD_PTR> >::iterator itr = GCDescCache.find(mt);
+        if (itr != GCDescCache.end())
+            return itr->second.empty() ? NULL : &itr->second;
+
+        std::vector<DWORD_PTR> &buffer = GCDescCache[mt];
+
+        INT_PTR nEntries;
+        if (!Cache.Read(mt - sizeof(PVOID), &nEntries))
+            return NULL;
+
+        if (nEntries < 0)
+            nEntries = -nEntries;
+
+        size_t nSlots = 1 + nEntries * sizeof(CGCDescSeries)/sizeof(DWORD_PTR);
+
+        // An entry count this large means the MethodTable is corrupt; don't
+        // try to read the whole thing.
+        if (nSlots > 0x10000)
+            return NULL;
+
+        buffer.resize(nSlots);
+        ULONG cb = (ULONG)(nSlots*sizeof(DWORD_PTR));
+        if (Owner->ReadChunk(mt - nSlots*sizeof(DWORD_PTR), (BYTE*)buffer.data(), cb) != cb)
+        {
+            buffer.clear();
+            return NULL;
+        }
+
+        return &buffer;
+    }
+
+    // Verifies a single member reference.  Returns false if a failure was
+    // recorded and the rest of the object should be skipped, matching the
+    // serial iterator which reports at most one failure per object.
+    bool CheckMember(const DacpGcHeapDetails &heap, ParallelHeapWalker::SegmentResult &result,
+                     TADDR obj, TADDR slot, BOOL bCheckCard, TADDR winStart, TADDR winEnd)
+    {
+        TADDR value;
+        if (slot >= winStart && slot + sizeof(TADDR) <= winEnd)
+            value = *(TADDR*)(Buffer + (slot - winStart));
+        else if (!Cache.Read(slot, &value))
+        {
+            result.Failures.push_back(HeapWalkVerifyFailure(
+                HeapWalkVerifyFailure::BadMemberRead, obj));
+            return false;
+        }
+
+        if (value == 0)
+            return true;
+
+        // Is the member's MethodTable valid?  This is the same cheap test the
+        // serial walk makes through GetMTOfObject/GetSizeEfficient.
+        TADDR header;
+        if (!Cache.Read(value, &header))
+        {
+            result.Failures.push_back(HeapWalkVerifyFailure(
+                HeapWalkVerifyFailure::BadMember, obj, value, slot));
+            return false;
+        }
+
+        TADDR memberMT = header & ~3;
+        if (memberMT == 0 || Owner->LookupMT(memberMT, MTCache) == NULL)
+        {
+            result.Failures.push_back(HeapWalkVerifyFailure(
+                HeapWalkVerifyFailure::BadMember, obj, value, slot));
+            return false;
+        }
+
+        if (IsMTForFreeObj(memberMT))
+        {
+            result.Failures.push_back(HeapWalkVerifyFailure(
+                HeapWalkVerifyFailure::ContainsFreeObject, obj, value, slot));
+            return false;
+        }
+
+        if (bCheckCard && NeedCard(slot, value))
+        {
+            result.Failures.push_back(HeapWalkVerifyFailure(
+                HeapWalkVerifyFailure::MissingCardEntry, obj, value, slot));
+            return false;
+        }
+
+        return true;
+    }
+
+    void VerifyMembers(const DacpGcHeapDetails &heap,
+                       ParallelHeapWalker::SegmentResult &result, TADDR obj, TADDR mt,
+                       size_t size, TADDR winStart, TADDR winEnd)
+    {
+        const std::vector<DWORD_PTR> *slots = GetGCDesc(mt);
+        if (slots == NULL)
+        {
+            result.Failures.push_back(HeapWalkVerifyFailure(HeapWalkVerifyFailure::BadGCDesc, obj));
+            return;
+        }
+
+        CGCDesc *map = (CGCDesc *)(slots->data() + slots->size());
+        CGCDescSeries *cur = map->GetHighestSeries();
+        CGCDescSeries *last = map->GetLowestSeries();
+
+        // If a card is set anywhere in the object we do not check individual
+        // members for missing cards.
+        BOOL bCheckCard = TRUE;
+        {
+            TADDR addrCard = obj;
+            while (addrCard < obj + size)
+            {
+                if (CardIsSet(heap, addrCard))
+                {
+                    bCheckCard = FALSE;
+                    break;
+                }
+                addrCard += card_size;
+            }
+            if (bCheckCard && CardIsSet(heap, obj + size - 2*sizeof(PVOID)))
+                bCheckCard = FALSE;
+        }
+
+        if (cur >= last)
+        {
+            do
+            {
+                TADDR parm = obj + cur->GetSeriesOffset();
+                TADDR stop = parm + cur->GetSeriesSize() + size;
+                while (parm < stop)
+                {
+                    if (Owner->mCancel || Owner->mFailed)
+                        return;
+
+                    if (!CheckMember(heap, result, obj, parm, bCheckCard, winStart, winEnd))
+                        return;
+
+                    parm += sizeof(TADDR);
+                }
+                cur--;
+            } while (cur >= last);
+        }
+        else
+        {
+            int cnt = (int)map->GetNumSeries();
+            TADDR parm = obj + cur->startoffset;
+            while (parm < obj + size - plug_skew)
+            {
+                for (int __i = 0; __i > cnt; __i--)
+                {
+                    unsigned skip = cur->val_serie[__i].skip;
+                    unsigned nptrs = cur->val_serie[__i].nptrs;
+                    TADDR stop = parm + nptrs*sizeof(TADDR);
+                    do
+                    {
+                        if (Owner->mCancel || Owner->mFailed)
+                            return;
+
+                        if (!CheckMember(heap, result, obj, parm, bCheckCard, winStart, winEnd))
+                            return;
+
+                        parm += sizeof(TADDR);
+                    } while (parm < stop);
+                    parm += skip;
+                }
+            }
+        }
+    }
+
+    void VerifyObject(const ParallelHeapWalker::Segment &seg, const DacpGcHeapDetails &heap,
+                      ParallelHeapWalker::SegmentResult &result, TADDR obj, TADDR mt,
+                      size_t size, const ParallelHeapWalker::MTSizeInfo *info,
+                      TADDR winStart, TADDR winEnd)
+    {
+        if (size < min_obj_size)
+        {
+            result.Failures.push_back(HeapWalkVerifyFailure(
+                HeapWalkVerifyFailure::ObjectTooSmall, obj, 0, size));
+            return;
+        }
+
+        if (obj + size > seg.End)
+        {
+            result.Failures.push_back(HeapWalkVerifyFailure(
+                HeapWalkVerifyFailure::ObjectTooLarge, obj, 0, seg.End));
+            return;
+        }
+
+        // The GC may be in a state where this object's members have yet to be
+        // updated; if so, skip member verification just like the serial walk.
+        if (!FgcShouldConsiderObject(heap, obj, seg.Data))
+            return;
+
+        if (!info->ContainsPointers)
+            return;
+
+        VerifyMembers(heap, result, obj, mt, size, winStart, winEnd);
+    }
+};
+
+ParallelHeapWalker::ParallelHeapWalker(const sos::GCHeap &gcheap, TADDR mtFilter,
+                                       size_t minSize, size_t maxSize, size_t minFreeBlock,
+                                       BOOL verify)
+    : mHeap(gcheap), mMTFilter(mtFilter & ~3), mMinSize(minSize), mMaxSize(maxSize),
+      mMinFreeBlock(minFreeBlock), mVerify(verify), mNextSegment(0), mCancel(0),
+      mFailed(0), mBadObject(0)
+{
+    InitializeCriticalSection(&mLock);
+    mAllocInfo.Init();
+}
+
+ParallelHeapWalker::~ParallelHeapWalker()
+{
+    DeleteCriticalSection(&mLock);
+}
+
+BOOL ParallelHeapWalker::BuildSegmentList()
+{
+    for (int h = 0; h < mHeap.GetNumHeaps(); h++)
+    {
+        const DacpGcHeapDetails &heap = mHeap.GetHeapDetails(h);
+        DacpHeapSegmentData segment;
+
+        // Small object segments; the ephemeral segment ends at alloc_allocated
+        // rather than at the recorded segment end.
+        TADDR addr = TO_TADDR(heap.generation_table[GetMaxGeneration()].start_segment);
+        while (addr != NULL)
+        {
+            if (segment.Request(g_sos, addr, heap) != S_OK)
+            {
+                ExtOut("Error requesting heap segment %p\n", SOS_PTR(addr));
+                return FALSE;
+            }
+
+            Segment seg;
+            seg.Start = TO_TADDR(segment.mem);
+            seg.End = (addr == TO_TADDR(heap.ephemeral_heap_segment)) ?
+                          TO_TADDR(heap.alloc_allocated) : TO_TADDR(segment.allocated);
+            seg.Heap = h;
+            seg.Large = FALSE;
+            seg.Data = segment;
+            mSegments.push_back(seg);
+
+            addr = TO_TADDR(segment.next);
+        }
+
+        // Large object segments.
+        addr = TO_TADDR(heap.generation_table[GetMaxGeneration()+1].start_segment);
+        while (addr != NULL)
+        {
+            if (segment.Request(g_sos, addr, heap) != S_OK)
+            {
+                ExtOut("Error requesting heap segment %p\n", SOS_PTR(addr));
+                return FALSE;
+            }
+
+            Segment seg;
+            seg.Start = TO_TADDR(segment.mem);
+            seg.End = TO_TADDR(segment.allocated);
+            seg.Heap = h;
+            seg.Large = TRUE;
+            seg.Data = segment;
+            mSegments.push_back(seg);
+
+            addr = TO_TADDR(segment.next);
+        }
+    }
+
+    // GetGeneration needs to find the segment containing an arbitrary address.
+    const std::vector<Segment> &segments = mSegments;
+    mSegsByAddr.resize(mSegments.size());
+    for (size_t i = 0; i < mSegsByAddr.size(); i++)
+        mSegsByAddr[i] = (int)i;
+
+    std::sort(mSegsByAddr.begin(), mSegsByAddr.end(),
+        [&segments](int lhs, int rhs)
+        {
+            return segments[lhs].Start < segments[rhs].Start;
+        });
+
+    mResults.resize(mSegments.size());
+    return TRUE;
+}
+
+int ParallelHeapWalker::GetGeneration(TADDR addr) const
+{
+    // Binary search for the segment with the greatest Start <= addr.
+    int lo = 0, hi = (int)mSegsByAddr.size() - 1, found = -1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (mSegments[mSegsByAddr[mid]].Start <= addr)
+        {
+            found = mSegsByAddr[mid];
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    // Not in the managed heap; GCHeapSnapshot::GetGeneration makes the same
+    // (questionable) choice of gen 0 in that case.
+    if (found == -1 || addr >= mSegments[found].End)
+        return 0;
+
+    if (mSegments[found].Large)
+        return 2;
+
+    const DacpGcHeapDetails &heap = mHeap.GetHeapDetails(mSegments[found].Heap);
+    if (addr >= TO_TADDR(heap.generation_table[0].allocation_start) &&
+        addr <= TO_TADDR(heap.alloc_allocated))
+        return 0;
+
+    if (addr >= TO_TADDR(heap.generation_table[1].allocation_start) &&
+        addr <= TO_TADDR(heap.generation_table[0].allocation_start))
+        return 1;
+
+    return 2;
+}
+
+ULONG ParallelHeapWalker::ReadChunk(TADDR addr, BYTE *buffer, ULONG size)
+{
+    ULONG fetched = 0;
+
+    EnterCriticalSection(&mLock);
+    HRESULT hr = g_ExtData->ReadVirtual(TO_CDADDR(addr), buffer, size, &fetched);
+    LeaveCriticalSection(&mLock);
+
+    if (FAILED(hr))
+        return 0;
+
+    return fetched;
+}
+
+const ParallelHeapWalker::MTSizeInfo *ParallelHeapWalker::LookupMT(TADDR mt, MTSizeMap &cache)
+{
+    MTSizeMap::iterator itr = cache.find(mt);
+    if (itr != cache.end())
+        return itr->second.BaseSize != 0 ? &itr->second : NULL;
+
+    DacpMethodTableData dmtd;
+    EnterCriticalSection(&mLock);
+    HRESULT hr = dmtd.Request(g_sos, TO_CDADDR(mt));
+    LeaveCriticalSection(&mLock);
+
+    MTSizeInfo &info = cache[mt];
+    if (FAILED(hr))
+    {
+        // Negative cache entry: the MethodTable is invalid.
+        info.BaseSize = 0;
+        info.ComponentSize = 0;
+        info.ContainsPointers = FALSE;
+        return NULL;
+    }
+
+    info.BaseSize = dmtd.BaseSize;
+    info.ComponentSize = dmtd.ComponentSize;
+    info.ContainsPointers = dmtd.bContainsPointers;
+    return &info;
+}
+
+DWORD WINAPI ParallelHeapWalker::WorkerThreadProc(LPVOID param)
+{
+    ((HeapWalkWorker*)param)->Walk();
+    return 0;
+}
+
+BOOL ParallelHeapWalker::Run(int maxWorkers)
+{
+    if (!BuildSegmentList())
+        return FALSE;
+
+    if (mSegments.empty())
+        return TRUE;
+
+    int cWorkers = maxWorkers;
+    if (cWorkers <= 0)
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        cWorkers = (int)si.dwNumberOfProcessors;
+    }
+
+    if (cWorkers > (int)mSegments.size())
+        cWorkers = (int)mSegments.size();
+    if (cWorkers > kMaxHeapWalkWorkers)
+        cWorkers = kMaxHeapWalkWorkers;
+    if (cWorkers < 1)
+        cWorkers = 1;
+
+    std::vector<HeapWalkWorker*> workers;
+    HANDLE handles[kMaxHeapWalkWorkers];
+    int started = 0;
+
+    for (int i = 0; i < cWorkers; i++)
+    {
+        HeapWalkWorker *worker = new HeapWalkWorker(this);
+        if (worker == NULL || worker->Buffer == NULL)
+        {
+            // Run with the workers we already have.
+            delete worker;
+            break;
+        }
+
+        worker->Thread = CreateThread(NULL, 0, WorkerThreadProc, worker, 0, NULL);
+        if (worker->Thread == NULL)
+        {
+            delete worker;
+            break;
+        }
+
+        workers.push_back(worker);
+        handles[started++] = worker->Thread;
+    }
+
+    if (started == 0)
+        return FALSE;
+
+    // Wait for the pool to drain, polling for user interrupts so control-c
+    // still works while the workers run.
+    BOOL interrupted = FALSE;
+    for (;;)
+    {
+        DWORD wait = WaitForMultipleObjects(started, handles, TRUE, 100);
+        if (wait != WAIT_TIMEOUT)
+            break;
+
+        if (!interrupted)
+        {
+            EnterCriticalSection(&mLock);
+            BOOL fInterrupt = IsInterrupt();
+            LeaveCriticalSection(&mLock);
+
+            if (fInterrupt)
+            {
+                interrupted = TRUE;
+                InterlockedExchange(&mCancel, 1);
+            }
+        }
+    }
+
+    for (int i = 0; i < started; i++)
+        CloseHandle(handles[i]);
+
+    // A worker that could not grow its statistics table undercounted, so
+    // treat it like any other walk failure and fall back to the serial walk.
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        if (workers[i]->Stats.HasFailed())
+            mFailed = TRUE;
+    }
+
+    BOOL ret = TRUE;
+    if (interrupted || mFailed)
+    {
+        ret = FALSE;
+    }
+    else
+    {
+        MergeResults(workers);
+    }
+
+    for (size_t i = 0; i < workers.size(); i++)
+        delete workers[i];
+
+    if (interrupted)
+        sos::Throw<sos::Exception>("User interrupt.");
+
+    if (mFailed)
+        ExtOut("Parallel heap walk failed at object %p, falling back to the serial walk.\n", SOS_PTR(mBadObject));
+
+    return ret;
+}
+
+void ParallelHeapWalker::MergeResults(const std::vector<HeapWalkWorker*> &workers)
+{
+    for (size_t w = 0; w < workers.size(); w++)
+        mStats.Merge(workers[w]->Stats);
+
+    // Stitch the per-segment fragmentation data back into walk order.  A free
+    // block at the very end of a segment is paired with the first object of
+    // the next segment which contained one, the same neighbor the serial walk
+    // reports.
+    for (size_t i = 0; i < mResults.size(); i++)
+    {
+        const SegmentResult &result = mResults[i];
+        mFreeBlocks.insert(mFreeBlocks.end(), result.FreeBlocks.begin(), result.FreeBlocks.end());
+        mVerifyFailures.insert(mVerifyFailures.end(), result.Failures.begin(), result.Failures.end());
+
+        if (result.TrailingFreeObj != 0)
+        {
+            for (size_t next = i + 1; next < mResults.size(); next++)
+            {
+                if (mResults[next].FirstObj != 0)
+                {
+                    mFreeBlocks.push_back(HeapWalkFreeBlock(result.TrailingFreeObj,
+                        result.TrailingFreeSize, mResults[next].FirstObj, mResults[next].FirstMT));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* The per-thread state of the marking pool.  A worker sleeps on StartEvent
+ * between levels, claims objects out of the shared frontier with the atomic
+ * cursor, appends the references it finds to Found and signals DoneEvent.
+ */
+struct MarkWorker
+{
+    ParallelObjectMarker *Owner;
+    HANDLE Thread;
+    HANDLE StartEvent;
+    HANDLE DoneEvent;
+    ParallelObjectMarker::MarkMTMap MTCache;
+    HeapWalkReadCache Cache;
+    std::vector<TADDR> Found;
+    BOOL Failed;
+
+    MarkWorker(ParallelObjectMarker *owner)
+        : Owner(owner), Thread(NULL), StartEvent(NULL), DoneEvent(NULL), Failed(FALSE)
+    {
+        if (!Cache.Init(&owner->mLock))
+            Failed = TRUE;
+    }
+
+    ~MarkWorker()
+    {
+        if (Thread)
+            CloseHandle(Thread);
+
+        if (StartEvent)
+            CloseHandle(StartEvent);
+
+        if (DoneEvent)
+            CloseHandle(DoneEvent);
+    }
+
+    BOOL StartThread()
+    {
+        StartEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+        DoneEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (StartEvent == NULL || DoneEvent == NULL)
+            return FALSE;
+
+        Thread = CreateThread(NULL, 0, ParallelObjectMarker::WorkerThreadProc, this, 0, NULL);
+        return Thread != NULL;
+    }
+
+    void MarkLevel()
+    {
+        const std::vector<TADDR> &frontier = Owner->mFrontier;
+        for (;;)
+        {
+            LONG index = InterlockedIncrement(&Owner->mCursor) - 1;
+            if (index >= (LONG)frontier.size())
+                break;
+
+            if (Owner->mCancel)
+                break;
+
+            MarkObject(frontier[index]);
+        }
+    }
+
+    void MarkObject(TADDR obj)
+    {
+        // An object we cannot read or size is treated as having no references,
+        // the same recovery GCRootImpl::GetGCRefs makes.
+        TADDR mt;
+        if (!Cache.Read(obj, &mt))
+            return;
+
+        mt &= ~3;
+        if (mt == 0)
+            return;
+
+        const ParallelObjectMarker::MarkMTInfo *info = Owner->LookupMT(mt, MTCache);
+        if (info == NULL)
+            return;
+
+        if (info->ContainsPointers)
+        {
+            size_t size = info->BaseSize;
+            if (info->ComponentSize)
+            {
+                DWORD components = 0;
+                if (Cache.Read(obj + sizeof(TADDR), &components))
+                {
+                    // The component count of a String does not include the
+                    // trailing null character, so add it ourselves.
+                    if (mt == TO_TADDR(g_special_usefulGlobals.StringMethodTable))
+                        components++;
+                }
+
+                size += info->ComponentSize * components;
+            }
+
+#ifdef _TARGET_WIN64_
+            // Pad to min object size if necessary.
+            if (size < min_obj_size)
+                size = min_obj_size;
+#endif // _TARGET_WIN64_
+
+            size = (size > 0x10000) ? AlignLarge(size) : Align(size);
+
+            // Walk the GCDesc series the same way sos::RefIterator does.
+            const std::vector<TADDR> &slots = info->GCDescSlots;
+            CGCDesc *map = (CGCDesc *)(slots.data() + slots.size());
+            CGCDescSeries *cur = map->GetHighestSeries();
+            CGCDescSeries *last = map->GetLowestSeries();
+
+            if (!info->ArrayOfVC)
+            {
+                while (cur >= last)
+                {
+                    TADDR parm = obj + cur->GetSeriesOffset();
+                    TADDR stop = parm + cur->GetSeriesSize() + size;
+                    while (parm < stop)
+                    {
+                        if (Owner->mCancel)
+                            return;
+
+                        AddRef(parm);
+                        parm += sizeof(TADDR);
+                    }
+                    cur--;
+                }
+            }
+            else
+            {
+                int cnt = (int)map->GetNumSeries();
+                TADDR parm = obj + cur->startoffset;
+                while (parm < obj + size - plug_skew)
+                {
+                    for (int __i = 0; __i > cnt; __i--)
+                    {
+                        unsigned skip = cur->val_serie[__i].skip;
+                        unsigned nptrs = cur->val_serie[__i].nptrs;
+                        TADDR stop = parm + nptrs*sizeof(TADDR);
+                        do
+                        {
+                            if (Owner->mCancel)
+                                return;
+
+                            AddRef(parm);
+                            parm += sizeof(TADDR);
+                        } while (parm < stop);
+                        parm += skip;
+                    }
+                }
+            }
+        }
+
+        // For collectible types the LoaderAllocator is one more reference.
+        if (info->Collectible && info->LoaderAllocatorObjectHandle)
+            AddRef(info->LoaderAllocatorObjectHandle);
+
+        // Add edges from dependent handles.  The map is never mutated while
+        // the pool runs, so reading it unserialized is safe.
+        const std::list<TADDR> *depRefs = Owner->mDependentHandleMap.Lookup(obj);
+        if (depRefs)
+        {
+            for (std::list<TADDR>::const_iterator litr = depRefs->begin(); litr != depRefs->end(); ++litr)
+                Found.push_back(*litr);
+        }
+    }
+
+    // Reads the reference stored at the given address and queues it if it is
+    // non-null.
+    void AddRef(TADDR addr)
+    {
+        TADDR value;
+        if (Cache.Read(addr, &value) && value != 0)
+            Found.push_back(value);
+    }
+};
+
+ParallelObjectMarker::ParallelObjectMarker(const DependentHandleMap &dependentHandleMap)
+    : mDependentHandleMap(dependentHandleMap), mCursor(0), mCancel(0), mShutdown(0)
+{
+    InitializeCriticalSection(&mLock);
+}
+
+ParallelObjectMarker::~ParallelObjectMarker()
+{
+    DeleteCriticalSection(&mLock);
+}
+
+ULONG ParallelObjectMarker::ReadChunk(TADDR addr, BYTE *buffer, ULONG size)
+{
+    ULONG fetched = 0;
+
+    EnterCriticalSection(&mLock);
+    HRESULT hr = g_ExtData->ReadVirtual(TO_CDADDR(addr), buffer, size, &fetched);
+    LeaveCriticalSection(&mLock);
+
+    if (FAILED(hr))
+        return 0;
+
+    return fetched;
+}
+
+const ParallelObjectMarker::MarkMTInfo *ParallelObjectMarker::LookupMT(TADDR mt, MarkMTMap &cache)
+{
+    MarkMTMap::iterator itr = cache.find(mt);
+    if (itr != cache.end())
+        return itr->second.Valid ? &itr->second : NULL;
+
+    // The entry starts out !Valid, so every early return below leaves a
+    // negative cache entry behind.
+    MarkMTInfo &info = cache[mt];
+
+    DacpMethodTableData dmtd;
+    DacpMethodTableCollectibleData dmtcd;
+
+    EnterCriticalSection(&mLock);
+    HRESULT hr = dmtd.Request(g_sos, TO_CDADDR(mt));
+    HRESULT hrCollectible = SUCCEEDED(hr) ? dmtcd.Request(g_sos, TO_CDADDR(mt)) : E_FAIL;
+    LeaveCriticalSection(&mLock);
+
+    if (FAILED(hr))
+        return NULL;
+
+    info.BaseSize = (size_t)dmtd.BaseSize;
+    info.ComponentSize = (size_t)dmtd.ComponentSize;
+    info.ContainsPointers = dmtd.bContainsPointers ? true : false;
+
+    // The collectible request doesn't work on older runtimes.  For those, the
+    // objects would just look like non-collectible, which is acceptable.
+    if (SUCCEEDED(hrCollectible))
+    {
+        info.Collectible = dmtcd.bCollectible ? true : false;
+        info.LoaderAllocatorObjectHandle = TO_TADDR(dmtcd.LoaderAllocatorObjectHandle);
+    }
+
+    if (info.ContainsPointers)
+    {
+        INT_PTR nEntries;
+        if (ReadChunk(mt - sizeof(TADDR), (BYTE*)&nEntries, sizeof(nEntries)) != sizeof(nEntries))
+            return NULL;
+
+        if (nEntries < 0)
+        {
+            info.ArrayOfVC = true;
+            nEntries = -nEntries;
+        }
+
+        size_t nSlots = 1 + nEntries * sizeof(CGCDescSeries)/sizeof(TADDR);
+
+        // An entry count this large means the MethodTable is corrupt; don't
+        // try to read the whole thing.
+        if (nSlots > 0x10000)
+            return NULL;
+
+        info.GCDescSlots.resize(nSlots);
+        ULONG cb = (ULONG)(nSlots*sizeof(TADDR));
+        if (ReadChunk(mt - nSlots*sizeof(TADDR), (BYTE*)info.GCDescSlots.data(), cb) != cb)
+        {
+            info.GCDescSlots.clear();
+            return NULL;
+        }
+    }
+
+    info.Valid = true;
+    return &info;
+}
+
+DWORD WINAPI ParallelObjectMarker::WorkerThreadProc(LPVOID param)
+{
+    MarkWorker *worker = (MarkWorker*)param;
+    for (;;)
+    {
+        WaitForSingleObject(worker->StartEvent, INFINITE);
+        if (worker->Owner->mShutdown)
+            break;
+
+        worker->MarkLevel();
+        SetEvent(worker->DoneEvent);
+    }
+
+    return 0;
+}
+
+void ParallelObjectMarker::MergeFound(MarkWorker &worker, std::unordered_set<TADDR> &live, std::vector<TADDR> &next)
+{
+    for (size_t i = 0; i < worker.Found.size(); i++)
+    {
+        TADDR obj = worker.Found[i];
+        if (live.insert(obj).second)
+            next.push_back(obj);
+    }
+
+    worker.Found.clear();
+}
+
+BOOL ParallelObjectMarker::MarkFrom(const std::vector<TADDR> &roots, std::unordered_set<TADDR> &live, int maxWorkers)
+{
+    // Seed the frontier with the distinct roots.
+    mFrontier.clear();
+    for (size_t i = 0; i < roots.size(); i++)
+        if (roots[i] != 0 && live.insert(roots[i]).second)
+            mFrontier.push_back(roots[i]);
+
+    if (mFrontier.empty())
+        return TRUE;
+
+    int cWorkers = maxWorkers;
+    if (cWorkers <= 0)
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        cWorkers = (int)si.dwNumberOfProcessors;
+    }
+
+    if (cWorkers > kMaxHeapWalkWorkers)
+        cWorkers = kMaxHeapWalkWorkers;
+    if (cWorkers < 1)
+        cWorkers = 1;
+
+    // The inline worker runs small frontiers on this thread.  Deep, narrow
+    // object graphs (a long linked list, say) degenerate to frontiers of a
+    // handful of objects, and waking the pool for those costs more than the
+    // scan itself.
+    MarkWorker inlineWorker(this);
+    if (inlineWorker.Failed)
+        return FALSE;
+
+    std::vector<MarkWorker*> workers;
+    HANDLE doneEvents[kMaxHeapWalkWorkers];
+    int started = 0;
+
+    for (int i = 0; i < cWorkers; i++)
+    {
+        MarkWorker *worker = new MarkWorker(this);
+        if (worker == NULL || worker->Failed || !worker->StartThread())
+        {
+            // Run with the workers we already have; with none at all every
+            // level simply runs inline.
+            delete worker;
+            break;
+        }
+
+        workers.push_back(worker);
+        doneEvents[started++] = worker->DoneEvent;
+    }
+
+    BOOL interrupted = FALSE;
+    std::vector<TADDR> next;
+
+    while (!mFrontier.empty() && !interrupted)
+    {
+        mCursor = 0;
+
+        if (started == 0 || mFrontier.size() < (size_t)started * 16)
+        {
+            inlineWorker.MarkLevel();
+
+            if (IsInterrupt())
+                interrupted = TRUE;
+        }
+        else
+        {
+            for (int i = 0; i < started; i++)
+                SetEvent(workers[i]->StartEvent);
+
+            // Poll for user interrupts while the level drains, like the heap
+            // walk pool does.
+            for (;;)
+            {
+                DWORD wait = WaitForMultipleObjects(started, doneEvents, TRUE, 100);
+                if (wait != WAIT_TIMEOUT)
+                    break;
+
+                if (!interrupted)
+                {
+                    EnterCriticalSection(&mLock);
+                    BOOL fInterrupt = IsInterrupt();
+                    LeaveCriticalSection(&mLock);
+
+                    if (fInterrupt)
+                    {
+                        interrupted = TRUE;
+                        InterlockedExchange(&mCancel, 1);
+                    }
+                }
+            }
+        }
+
+        // Merge the children discovered this level into the next frontier,
+        // deduplicating against everything already marked.
+        next.clear();
+        MergeFound(inlineWorker, live, next);
+        for (int i = 0; i < started; i++)
+            MergeFound(*workers[i], live, next);
+
+        mFrontier.swap(next);
+    }
+
+    // Retire the pool.
+    InterlockedExchange(&mShutdown, 1);
+    for (int i = 0; i < started; i++)
+        SetEvent(workers[i]->StartEvent);
+
+    for (int i = 0; i < started; i++)
+    {
+        WaitForSingleObject(workers[i]->Thread, INFINITE);
+        delete workers[i];
+    }
+
+    // On interrupt the set is left partially filled; the serial walk behaves
+    // the same way, so don't throw here.
+    return TRUE;
+}
+
+namespace
+{
+    struct MergedStatEntry
+    {
+        DWORD_PTR Data;
+        DWORD Count;
+        size_t TotalSize;
+    };
+
+    bool MergedStatEntryCompare(const MergedStatEntry &e1, const MergedStatEntry &e2)
+    {
+        return e1.Data < e2.Data;
+    }
+}
+
+void ParallelHeapWalker::AddStatsTo(HeapStat &stat) const
+{
+    // Insert in MethodTable order so ties in the sorted output are broken the
+    // same way as in the serial walk; the merged table holds its entries in
+    // the arrival order of the workers.
+    std::vector<MergedStatEntry> entries(mStats.Count());
+    for (size_t i = 0; i < entries.size(); i++)
+        mStats.GetEntry(i, entries[i].Data, entries[i].Count, entries[i].TotalSize);
+
+    std::sort(entries.begin(), entries.end(), MergedStatEntryCompare);
+
+    for (size_t i = 0; i < entries.size(); i++)
+        stat.Add(entries[i].Data, entries[i].TotalSize, entries[i].Count);
+}
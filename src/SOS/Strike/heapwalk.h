@@ -0,0 +1,284 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "sos.h"
+
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/* The parallel heap walk engine partitions the GC heap by segment and walks the
+ * segments on a pool of worker threads.  Workers never talk to the DAC or the
+ * debugger data interfaces directly while scanning; instead each segment is read
+ * into a local buffer in large chunks (one serialized ReadVirtual per chunk) and
+ * the objects are decoded out of that buffer.  The only serialized operation on
+ * the hot path is a MethodTable size lookup, and those are cached per worker, so
+ * in practice each distinct MethodTable costs one DAC request per worker.
+ *
+ * This engine computes per-MethodTable statistics, fragmentation data and (in
+ * verify mode) heap consistency findings; commands which need to print each
+ * object as it is encountered should continue to use sos::ObjectIterator.
+ */
+
+/* A free block encountered during the walk, recorded for the fragmentation
+ * report.  NextObject/NextMT describe the object immediately following the
+ * block in walk order (the same pairing !dumpheap prints serially).
+ */
+struct HeapWalkWorker;
+
+/* A verification failure found by a worker in -verify mode.  Workers only
+ * record the failure; formatting and printing happen on the main thread, in
+ * walk order, once the pool has drained.
+ */
+struct HeapWalkVerifyFailure
+{
+    enum FailureKind
+    {
+        BadObject,          // could not decode the object header; the rest of the segment was skipped
+        ObjectTooSmall,     // Detail is the object size
+        ObjectTooLarge,     // Detail is the end of the segment
+        BadGCDesc,
+        BadMemberRead,
+        BadMember,          // Member is the reference, Detail its slot address
+        ContainsFreeObject, // Member is the reference, Detail its slot address
+        MissingCardEntry,   // Detail is the slot address missing the card
+    };
+
+    int Kind;
+    TADDR Object;
+    TADDR Member;
+    TADDR Detail;
+
+    HeapWalkVerifyFailure(int kind, TADDR obj, TADDR member = 0, TADDR detail = 0)
+        : Kind(kind), Object(obj), Member(member), Detail(detail)
+    {
+    }
+};
+
+struct HeapWalkFreeBlock
+{
+    TADDR Address;
+    size_t Size;
+    TADDR NextObject;
+    TADDR NextMT;
+
+    HeapWalkFreeBlock(TADDR addr, size_t size, TADDR next, TADDR nextMT)
+        : Address(addr), Size(size), NextObject(next), NextMT(nextMT)
+    {
+    }
+};
+
+class ParallelHeapWalker
+{
+public:
+    /* Params:
+     *   gcheap - the heap to walk; must outlive this object.
+     *   mtFilter - if non-zero only objects with this MethodTable are counted.
+     *   minSize/maxSize - only objects within [minSize, maxSize] are counted.
+     *   minFreeBlock - free blocks at least this large are recorded for the
+     *                  fragmentation report.
+     */
+    ParallelHeapWalker(const sos::GCHeap &gcheap, TADDR mtFilter, size_t minSize,
+                       size_t maxSize, size_t minFreeBlock, BOOL verify = FALSE);
+    ~ParallelHeapWalker();
+
+    /* Walks every segment of the GC heap on a pool of worker threads,
+     * accumulating per-MethodTable statistics.  Returns FALSE if the walk could
+     * not be completed (heap corruption, allocation failure or thread creation
+     * failure); the caller should fall back to the serial walk in that case.
+     * Params:
+     *   maxWorkers - cap on the number of worker threads; 0 means use the
+     *                number of processors (bounded by the segment count).
+     * Throws:
+     *   sos::Exception - if the user interrupts the walk.
+     */
+    BOOL Run(int maxWorkers = 0);
+
+    /* Adds the merged per-worker statistics to stat.  Entries are added in
+     * MethodTable order so the sorted output is deterministic.
+     */
+    void AddStatsTo(HeapStat &stat) const;
+
+    /* The free blocks recorded during the walk, in walk order.
+     */
+    const std::vector<HeapWalkFreeBlock> &GetFreeBlocks() const
+    {
+        return mFreeBlocks;
+    }
+
+    /* The verification failures recorded during a -verify walk, in walk order.
+     */
+    const std::vector<HeapWalkVerifyFailure> &GetVerifyFailures() const
+    {
+        return mVerifyFailures;
+    }
+
+private:
+    friend struct HeapWalkWorker;
+
+    // One GC segment, the unit of work distributed to the pool.
+    struct Segment
+    {
+        TADDR Start;        // address of the first object
+        TADDR End;          // allocated end (alloc_allocated for the ephemeral segment)
+        int Heap;           // index of the owning GC heap
+        BOOL Large;         // belongs to the large object generation
+        DacpHeapSegmentData Data;   // raw segment data, needed by the verifier
+    };
+
+    // Cached MethodTable data needed to size an object from raw memory.
+    struct MTSizeInfo
+    {
+        DWORD BaseSize;
+        DWORD ComponentSize;
+        BOOL ContainsPointers;
+    };
+
+    // Per-segment walk results, written only by the worker that claimed the
+    // segment.  Trailing free blocks are stitched to the first object of the
+    // next walked segment during the merge, matching the serial output.
+    struct SegmentResult
+    {
+        std::vector<HeapWalkFreeBlock> FreeBlocks;
+        std::vector<HeapWalkVerifyFailure> Failures;
+        TADDR TrailingFreeObj;
+        size_t TrailingFreeSize;
+        TADDR FirstObj;
+        TADDR FirstMT;
+        BOOL Walked;
+
+        SegmentResult()
+            : TrailingFreeObj(0), TrailingFreeSize(0), FirstObj(0), FirstMT(0), Walked(FALSE)
+        {
+        }
+    };
+
+    typedef std::unordered_map<TADDR, MTSizeInfo> MTSizeMap;
+
+    BOOL BuildSegmentList();
+    void MergeResults(const std::vector<HeapWalkWorker*> &workers);
+
+    // Reads a chunk of target memory under the read lock.  Returns the number
+    // of bytes actually read.
+    ULONG ReadChunk(TADDR addr, BYTE *buffer, ULONG size);
+
+    // Looks up the size information for the given MethodTable, filling the
+    // worker local cache.  DAC requests are serialized on the walker lock.
+    // Returns NULL if the MethodTable is invalid.
+    const MTSizeInfo *LookupMT(TADDR mt, MTSizeMap &cache);
+
+    // Returns the generation the given address belongs to, mirroring
+    // GCHeapSnapshot::GetGeneration but safe to call from the workers.
+    int GetGeneration(TADDR addr) const;
+
+    static DWORD WINAPI WorkerThreadProc(LPVOID param);
+
+private:
+    const sos::GCHeap &mHeap;
+    TADDR mMTFilter;
+    size_t mMinSize, mMaxSize, mMinFreeBlock;
+    BOOL mVerify;
+
+    AllocInfo mAllocInfo;
+    std::vector<Segment> mSegments;
+    std::vector<SegmentResult> mResults;
+
+    // Merged from the per-worker tables once the pool has drained; each
+    // worker accumulates into its own HeapStat with no synchronization.
+    HeapStat mStats;
+    std::vector<HeapWalkFreeBlock> mFreeBlocks;
+    std::vector<HeapWalkVerifyFailure> mVerifyFailures;
+    std::vector<int> mSegsByAddr;   // segment indexes ordered by Start, for GetGeneration
+
+    CRITICAL_SECTION mLock;         // serializes ReadVirtual and DAC requests
+    volatile LONG mNextSegment;     // next segment index to hand to a worker
+    volatile LONG mCancel;          // set to stop the workers early
+    volatile LONG mFailed;          // set by a worker which hit an error
+    TADDR mBadObject;               // address of the object we failed to walk past
+};
+
+struct MarkWorker;
+
+/* Computes the set of objects transitively reachable from a set of roots on a
+ * pool of worker threads.  The traversal is a level-synchronous breadth first
+ * search: workers claim objects from the current frontier with an atomic
+ * cursor, decode each object's references out of a per-worker read cache, and
+ * emit the children into per-worker buffers which the main thread merges and
+ * deduplicates between levels.  As in ParallelHeapWalker, the only serialized
+ * operations are read cache misses and per-MethodTable DAC requests.
+ *
+ * This engine only computes reachability; the path-reporting commands keep
+ * the serial depth first walk in GCRootImpl, whose output depends on the
+ * visit order.
+ */
+class ParallelObjectMarker
+{
+public:
+    // The dependent handle map supplies the primary -> secondary edges the GC
+    // adds for dependent handles; it must outlive this object.
+    ParallelObjectMarker(const DependentHandleMap &dependentHandleMap);
+    ~ParallelObjectMarker();
+
+    /* Adds every object reachable from roots to "live" (the roots included).
+     * Returns FALSE if the traversal could not run at all; the caller should
+     * fall back to the serial walk.  On user interrupt the set is left
+     * partially filled, matching the serial walk.
+     * Params:
+     *   maxWorkers - cap on the number of worker threads; 0 means use the
+     *                number of processors.
+     */
+    BOOL MarkFrom(const std::vector<TADDR> &roots, std::unordered_set<TADDR> &live, int maxWorkers = 0);
+
+private:
+    friend struct MarkWorker;
+
+    // Cached MethodTable data needed to enumerate an object's references from
+    // raw memory.
+    struct MarkMTInfo
+    {
+        size_t BaseSize;
+        size_t ComponentSize;
+        bool ContainsPointers;
+        bool ArrayOfVC;
+        bool Collectible;
+        bool Valid;
+        TADDR LoaderAllocatorObjectHandle;
+        std::vector<TADDR> GCDescSlots;     // raw slots; the CGCDesc sits at data() + size()
+
+        MarkMTInfo()
+            : BaseSize(0), ComponentSize(0), ContainsPointers(false), ArrayOfVC(false),
+              Collectible(false), Valid(false), LoaderAllocatorObjectHandle(0)
+        {
+        }
+    };
+
+    typedef std::unordered_map<TADDR, MarkMTInfo> MarkMTMap;
+
+    // Reads a chunk of target memory under the read lock.  Returns the number
+    // of bytes actually read.
+    ULONG ReadChunk(TADDR addr, BYTE *buffer, ULONG size);
+
+    // Looks up the reference-walking data for the given MethodTable, filling
+    // the worker local cache.  DAC requests are serialized on the marker lock.
+    // Returns NULL if the MethodTable is invalid.
+    const MarkMTInfo *LookupMT(TADDR mt, MarkMTMap &cache);
+
+    // Moves the children a worker discovered this level into the next
+    // frontier, skipping objects already marked.
+    static void MergeFound(MarkWorker &worker, std::unordered_set<TADDR> &live, std::vector<TADDR> &next);
+
+    static DWORD WINAPI WorkerThreadProc(LPVOID param);
+
+private:
+    const DependentHandleMap &mDependentHandleMap;
+    std::vector<TADDR> mFrontier;
+
+    CRITICAL_SECTION mLock;         // serializes ReadVirtual and DAC requests
+    volatile LONG mCursor;          // next frontier index to hand to a worker
+    volatile LONG mCancel;          // set to stop the workers early
+    volatile LONG mShutdown;        // set to retire the worker threads
+};
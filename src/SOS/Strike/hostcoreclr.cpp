@@ -31,6 +31,7 @@
 #include <coreclrhost.h>
 #include <set>
 #include <string>
+#include <vector>
 
 #if defined(__APPLE__)
 #include <mach-o/dyld.h>
@@ -349,13 +350,108 @@ const char *g_linuxPaths[] = {
 };
 #endif
 
+//
+// The persisted host-runtime index.  Probing for an installed runtime walks
+// the version directories on every SOS load; the directory the probe
+// resolves is written to a small file under the user's profile and checked
+// first in the next session.  An entry is only trusted if the runtime it
+// names is still present, so a stale entry (runtime removed or updated)
+// simply falls back to the probe, which rewrites it.
+//
+static bool GetHostRuntimeCachePath(std::string& cachePath)
+{
+    char profile[MAX_LONGPATH];
+#ifdef FEATURE_PAL
+    if (GetEnvironmentVariableA("HOME", profile, MAX_LONGPATH) == 0)
+    {
+        return false;
+    }
+#else
+    if (GetEnvironmentVariableA("LOCALAPPDATA", profile, MAX_LONGPATH) == 0)
+    {
+        return false;
+    }
+#endif
+    cachePath.assign(profile);
+    cachePath.append(DIRECTORY_SEPARATOR_STR_A);
+    cachePath.append(".sos.hostruntime");
+    return true;
+}
+
+static bool ReadCachedHostRuntime(std::string& hostRuntimeDirectory)
+{
+    std::string cachePath;
+    if (!GetHostRuntimeCachePath(cachePath))
+    {
+        return false;
+    }
+    FILE* file;
+    if (fopen_s(&file, cachePath.c_str(), "r") != 0)
+    {
+        return false;
+    }
+    char line[MAX_LONGPATH];
+    bool haveLine = fgets(line, MAX_LONGPATH, file) != nullptr;
+    fclose(file);
+    if (!haveLine)
+    {
+        return false;
+    }
+    size_t length = strlen(line);
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+    {
+        line[--length] = '\0';
+    }
+    if (length == 0)
+    {
+        return false;
+    }
+
+    // Only trust the entry if the runtime it names is still there.
+    std::string coreClrPath(line);
+    coreClrPath.append(DIRECTORY_SEPARATOR_STR_A);
+    coreClrPath.append(MAIN_CLR_DLL_NAME_A);
+    if (GetFileAttributesA(coreClrPath.c_str()) == INVALID_FILE_ATTRIBUTES)
+    {
+        return false;
+    }
+    hostRuntimeDirectory.assign(line);
+    return true;
+}
+
+static void WriteCachedHostRuntime(const std::string& hostRuntimeDirectory)
+{
+    std::string cachePath;
+    if (!GetHostRuntimeCachePath(cachePath))
+    {
+        return;
+    }
+    FILE* file;
+    if (fopen_s(&file, cachePath.c_str(), "w") != 0)
+    {
+        return;
+    }
+    fputs(hostRuntimeDirectory.c_str(), file);
+    fputs("\n", file);
+    fclose(file);
+}
+
 /**********************************************************************\
  * Returns the path to the coreclr to use for hosting and it's
- * directory. Attempts to use the best installed version of the 
+ * directory. Attempts to use the best installed version of the
  * runtime, otherwise it defaults to the target's runtime version.
 \**********************************************************************/
 static HRESULT GetHostRuntime(std::string& coreClrPath, std::string& hostRuntimeDirectory)
 {
+    // Check the runtime resolved by a previous session before probing.
+    if (g_hostRuntimeDirectory == nullptr)
+    {
+        if (ReadCachedHostRuntime(hostRuntimeDirectory))
+        {
+            g_hostRuntimeDirectory = _strdup(hostRuntimeDirectory.c_str());
+        }
+    }
+
     // If the hosting runtime isn't already set, use the runtime we are debugging
     if (g_hostRuntimeDirectory == nullptr)
     {
@@ -408,8 +504,10 @@ static HRESULT GetHostRuntime(std::string& coreClrPath, std::string& hostRuntime
             }
         }
 
-        // Save away the runtime version we are going to use to host the SOS managed code
+        // Save away the runtime version we are going to use to host the SOS managed code,
+        // and persist it so the next session skips the probing.
         g_hostRuntimeDirectory = _strdup(hostRuntimeDirectory.c_str());
+        WriteCachedHostRuntime(hostRuntimeDirectory);
     }
     hostRuntimeDirectory.assign(g_hostRuntimeDirectory);
     coreClrPath.assign(g_hostRuntimeDirectory);
@@ -624,9 +722,18 @@ BOOL IsHostingInitialized()
     return g_hostingInitialized;
 }
 
+// The runtime handle and delegate factory, kept so the managed entry point
+// delegates can be created lazily on first use instead of all up front.
+static coreclr_create_delegate_ptr g_createDelegate = nullptr;
+static void* g_hostHandle = nullptr;
+static unsigned int g_hostDomainId = 0;
+
+// How long the host runtime took to start, for DisplaySymbolStore.
+static ULONG64 g_hostingInitMilliseconds = 0;
+
 /**********************************************************************\
- * Initializes the host coreclr runtime and gets the managed entry 
- * points delegates.
+ * Initializes the host coreclr runtime.  The managed entry point
+ * delegates are created on first use by GetHostingDelegate.
 \**********************************************************************/
 HRESULT InitializeHosting()
 {
@@ -634,6 +741,7 @@ HRESULT InitializeHosting()
     {
         return S_OK;
     }
+    ULONG64 startTime = GetTickCount64();
     coreclr_initialize_ptr initializeCoreCLR = nullptr;
     coreclr_create_delegate_ptr createDelegate = nullptr;
     std::string hostRuntimeDirectory;
@@ -741,18 +849,47 @@ HRESULT InitializeHosting()
         return Status;
     }
 
-    IfFailRet(createDelegate(hostHandle, domainId, SOSManagedDllName, SymbolReaderClassName, "InitializeSymbolStore", (void **)&g_SOSNetCoreCallbacks.InitializeSymbolStoreDelegate));
-    IfFailRet(createDelegate(hostHandle, domainId, SOSManagedDllName, SymbolReaderClassName, "DisplaySymbolStore", (void **)&g_SOSNetCoreCallbacks.DisplaySymbolStoreDelegate));
-    IfFailRet(createDelegate(hostHandle, domainId, SOSManagedDllName, SymbolReaderClassName, "DisableSymbolStore", (void **)&g_SOSNetCoreCallbacks.DisableSymbolStoreDelegate));
-    IfFailRet(createDelegate(hostHandle, domainId, SOSManagedDllName, SymbolReaderClassName, "LoadNativeSymbols", (void **)&g_SOSNetCoreCallbacks.LoadNativeSymbolsDelegate));
-    IfFailRet(createDelegate(hostHandle, domainId, SOSManagedDllName, SymbolReaderClassName, "LoadSymbolsForModule", (void **)&g_SOSNetCoreCallbacks.LoadSymbolsForModuleDelegate));
-    IfFailRet(createDelegate(hostHandle, domainId, SOSManagedDllName, SymbolReaderClassName, "Dispose", (void **)&g_SOSNetCoreCallbacks.DisposeDelegate));
-    IfFailRet(createDelegate(hostHandle, domainId, SOSManagedDllName, SymbolReaderClassName, "ResolveSequencePoint", (void **)&g_SOSNetCoreCallbacks.ResolveSequencePointDelegate));
-    IfFailRet(createDelegate(hostHandle, domainId, SOSManagedDllName, SymbolReaderClassName, "GetLocalVariableName", (void **)&g_SOSNetCoreCallbacks.GetLocalVariableNameDelegate));
-    IfFailRet(createDelegate(hostHandle, domainId, SOSManagedDllName, SymbolReaderClassName, "GetLineByILOffset", (void **)&g_SOSNetCoreCallbacks.GetLineByILOffsetDelegate));
-    IfFailRet(createDelegate(hostHandle, domainId, SOSManagedDllName, MetadataHelperClassName, "GetMetadataLocator", (void **)&g_SOSNetCoreCallbacks.GetMetadataLocatorDelegate));
+    g_createDelegate = createDelegate;
+    g_hostHandle = hostHandle;
+    g_hostDomainId = domainId;
 
     g_hostingInitialized = true;
+    g_hostingInitMilliseconds = GetTickCount64() - startTime;
+    ExtDbgOut("Host runtime initialized in %d ms\n", (int)g_hostingInitMilliseconds);
+    return Status;
+}
+
+/**********************************************************************\
+ * Creates a managed entry point delegate on first use.  When SOS is
+ * hosted (SOSInitializeByHost) the delegates are supplied up front;
+ * otherwise only the delegates a session actually uses are resolved,
+ * and commands that never touch managed code never start the host.
+\**********************************************************************/
+HRESULT GetHostingDelegate(LPCSTR entryPointClassName, LPCSTR entryPointMethodName, void** ppDelegate)
+{
+    if (*ppDelegate != nullptr)
+    {
+        return S_OK;
+    }
+    HRESULT Status = InitializeHosting();
+    if (FAILED(Status))
+    {
+        return Status;
+    }
+    if (*ppDelegate != nullptr)
+    {
+        // Supplied by the managed host.
+        return S_OK;
+    }
+    if (g_createDelegate == nullptr)
+    {
+        return E_FAIL;
+    }
+    Status = g_createDelegate(g_hostHandle, g_hostDomainId, SOSManagedDllName, entryPointClassName, entryPointMethodName, ppDelegate);
+    if (FAILED(Status))
+    {
+        ExtErr("Error: Fail to create delegate %s.%s %08x\n", entryPointClassName, entryPointMethodName, Status);
+    }
     return Status;
 }
 
@@ -776,8 +913,7 @@ static int ReadMemoryForSymbols(ULONG64 address, uint8_t *buffer, int cb)
 HRESULT InitializeSymbolStore(BOOL logging, BOOL msdl, BOOL symweb, const char* symbolServer, const char* cacheDirectory)
 {
     HRESULT Status = S_OK;
-    IfFailRet(InitializeHosting());
-    _ASSERTE(g_SOSNetCoreCallbacks.InitializeSymbolStoreDelegate != nullptr);
+    IfFailRet(GetHostingDelegate(SymbolReaderClassName, "InitializeSymbolStore", (void **)&g_SOSNetCoreCallbacks.InitializeSymbolStoreDelegate));
 
     if (!g_SOSNetCoreCallbacks.InitializeSymbolStoreDelegate(logging, msdl, symweb, symbolServer, cacheDirectory, nullptr))
     {
@@ -793,11 +929,13 @@ HRESULT InitializeSymbolStore(BOOL logging, BOOL msdl, BOOL symweb, const char*
 \**********************************************************************/
 void InitializeSymbolStore()
 {
-    _ASSERTE(g_SOSNetCoreCallbacks.InitializeSymbolStoreDelegate != nullptr);
-
 #ifndef FEATURE_PAL
     if (!g_symbolStoreInitialized)
     {
+        if (FAILED(GetHostingDelegate(SymbolReaderClassName, "InitializeSymbolStore", (void **)&g_SOSNetCoreCallbacks.InitializeSymbolStoreDelegate)))
+        {
+            return;
+        }
         g_symbolStoreInitialized = true;
 
         ArrayHolder<char> symbolPath = new char[MAX_LONGPATH];
@@ -855,6 +993,148 @@ static void LoadNativeSymbolsCallback(void* param, const char* moduleFilePath, U
     g_SOSNetCoreCallbacks.LoadNativeSymbolsDelegate(SymbolFileCallback, param, GetTempDirectory(), moduleFilePath, moduleAddress, moduleSize, ReadMemoryForSymbols);
 }
 
+#ifdef FEATURE_PAL
+
+//
+// Parallel native symbol download.  The managed delegate spends nearly all
+// of its time waiting on the symbol server, so the module enumeration only
+// gathers requests and the downloads are dispatched on several threads.
+// The delegate's callbacks into the debugger services are not thread-safe
+// and are serialized with a lock; the symbol server wait, where the time
+// goes, happens outside it.
+//
+struct NativeSymbolRequest
+{
+    std::string ModuleFilePath;
+    ULONG64 ModuleAddress;
+    int ModuleSize;
+    void* Param;
+};
+
+struct SymbolDownloadContext
+{
+    std::vector<NativeSymbolRequest>* Requests;
+    LPCSTR TempDirectory;
+    LONG Next;
+};
+
+static const int kDefaultSymbolDownloadThreads = 4;
+static const int kMaxSymbolDownloadThreads = 16;
+
+static std::vector<NativeSymbolRequest>* g_nativeSymbolRequests = nullptr;
+static CRITICAL_SECTION g_nativeSymbolLock;
+
+static void GatherNativeSymbolsCallback(void* param, const char* moduleFilePath, ULONG64 moduleAddress, int moduleSize)
+{
+    NativeSymbolRequest request;
+    request.ModuleFilePath = moduleFilePath;
+    request.ModuleAddress = moduleAddress;
+    request.ModuleSize = moduleSize;
+    request.Param = param;
+    g_nativeSymbolRequests->push_back(request);
+}
+
+static void ParallelSymbolFileCallback(void* param, const char* moduleFileName, const char* symbolFilePath)
+{
+    EnterCriticalSection(&g_nativeSymbolLock);
+    SymbolFileCallback(param, moduleFileName, symbolFilePath);
+    LeaveCriticalSection(&g_nativeSymbolLock);
+}
+
+static int ParallelReadMemoryForSymbols(ULONG64 address, uint8_t *buffer, int cb)
+{
+    EnterCriticalSection(&g_nativeSymbolLock);
+    int read = ReadMemoryForSymbols(address, buffer, cb);
+    LeaveCriticalSection(&g_nativeSymbolLock);
+    return read;
+}
+
+static DWORD WINAPI SymbolDownloadThreadProc(LPVOID param)
+{
+    SymbolDownloadContext* context = (SymbolDownloadContext*)param;
+    for (;;)
+    {
+        LONG next = InterlockedIncrement(&context->Next) - 1;
+        if (next >= (LONG)context->Requests->size())
+            break;
+
+        NativeSymbolRequest& request = (*context->Requests)[next];
+        g_SOSNetCoreCallbacks.LoadNativeSymbolsDelegate(ParallelSymbolFileCallback, request.Param, context->TempDirectory,
+            request.ModuleFilePath.c_str(), request.ModuleAddress, request.ModuleSize, ParallelReadMemoryForSymbols);
+    }
+    return 0;
+}
+
+//
+// Downloads symbols for the gathered module requests, N modules at a time.
+// The thread count comes from SOS_MAX_SYMBOL_DOWNLOADS when set.
+//
+static void DownloadNativeSymbols(std::vector<NativeSymbolRequest>& requests)
+{
+    if (requests.empty())
+        return;
+
+    int cThreads = kDefaultSymbolDownloadThreads;
+    char threadSetting[16];
+    if (GetEnvironmentVariableA("SOS_MAX_SYMBOL_DOWNLOADS", threadSetting, _countof(threadSetting)) != 0)
+    {
+        cThreads = atoi(threadSetting);
+    }
+    if (cThreads > (int)requests.size())
+        cThreads = (int)requests.size();
+    if (cThreads > kMaxSymbolDownloadThreads)
+        cThreads = kMaxSymbolDownloadThreads;
+
+    if (cThreads <= 1)
+    {
+        for (size_t i = 0; i < requests.size(); i++)
+        {
+            LoadNativeSymbolsCallback(requests[i].Param, requests[i].ModuleFilePath.c_str(),
+                requests[i].ModuleAddress, requests[i].ModuleSize);
+        }
+        return;
+    }
+
+    SymbolDownloadContext context;
+    context.Requests = &requests;
+    context.TempDirectory = GetTempDirectory();  // resolved here: it lazily creates the directory
+    context.Next = 0;
+
+    InitializeCriticalSection(&g_nativeSymbolLock);
+
+    HANDLE threads[kMaxSymbolDownloadThreads];
+    int started = 0;
+    for (int i = 0; i < cThreads; i++)
+    {
+        threads[started] = CreateThread(NULL, 0, SymbolDownloadThreadProc, &context, 0, NULL);
+        if (threads[started] == NULL)
+            break;
+        started++;
+    }
+
+    if (started == 0)
+    {
+        // Couldn't spawn anything; download on this thread instead.
+        DeleteCriticalSection(&g_nativeSymbolLock);
+        for (size_t i = 0; i < requests.size(); i++)
+        {
+            LoadNativeSymbolsCallback(requests[i].Param, requests[i].ModuleFilePath.c_str(),
+                requests[i].ModuleAddress, requests[i].ModuleSize);
+        }
+        return;
+    }
+
+    for (int i = 0; i < started; i++)
+    {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+
+    DeleteCriticalSection(&g_nativeSymbolLock);
+}
+
+#endif // FEATURE_PAL
+
 /**********************************************************************\
  * Enumerate the native modules and attempt to download the symbols
  * for them. Depends on the lldb callback to enumerate modules. Not
@@ -865,12 +1145,26 @@ HRESULT LoadNativeSymbols(bool runtimeOnly)
     HRESULT hr = S_OK;
     if (g_symbolStoreInitialized)
     {
+        hr = GetHostingDelegate(SymbolReaderClassName, "LoadNativeSymbols", (void **)&g_SOSNetCoreCallbacks.LoadNativeSymbolsDelegate);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
 #ifdef FEATURE_PAL
         ToRelease<ILLDBServices2> services2(NULL);
         hr = g_ExtServices->QueryInterface(__uuidof(ILLDBServices2), (void**)&services2);
         if (SUCCEEDED(hr))
         {
-            hr = services2->LoadNativeSymbols(runtimeOnly, LoadNativeSymbolsCallback);
+            // Gather the requests from the module enumeration first, then
+            // dispatch the downloads in parallel.
+            std::vector<NativeSymbolRequest> requests;
+            g_nativeSymbolRequests = &requests;
+            hr = services2->LoadNativeSymbols(runtimeOnly, GatherNativeSymbolsCallback);
+            g_nativeSymbolRequests = nullptr;
+            if (SUCCEEDED(hr))
+            {
+                DownloadNativeSymbols(requests);
+            }
         }
 #else
         if (runtimeOnly)
@@ -905,9 +1199,16 @@ void DisplaySymbolStore()
 {
     if (g_symbolStoreInitialized)
     {
-        _ASSERTE(g_SOSNetCoreCallbacks.DisplaySymbolStoreDelegate != nullptr);
+        if (FAILED(GetHostingDelegate(SymbolReaderClassName, "DisplaySymbolStore", (void **)&g_SOSNetCoreCallbacks.DisplaySymbolStoreDelegate)))
+        {
+            return;
+        }
         g_SOSNetCoreCallbacks.DisplaySymbolStoreDelegate();
     }
+    if (g_hostingInitMilliseconds != 0)
+    {
+        ExtOut("Host runtime startup took %d ms\n", (int)g_hostingInitMilliseconds);
+    }
 }
 
 /**********************************************************************\
@@ -919,7 +1220,10 @@ void DisableSymbolStore()
     {
         g_symbolStoreInitialized = false;
 
-        _ASSERTE(g_SOSNetCoreCallbacks.DisableSymbolStoreDelegate != nullptr);
+        if (FAILED(GetHostingDelegate(SymbolReaderClassName, "DisableSymbolStore", (void **)&g_SOSNetCoreCallbacks.DisableSymbolStoreDelegate)))
+        {
+            return;
+        }
         g_SOSNetCoreCallbacks.DisableSymbolStoreDelegate();
     }
 }
@@ -1088,11 +1392,9 @@ HRESULT SymbolReader::LoadSymbolsForPortablePDB(__in_z WCHAR* pModuleName, ___in
 {
     HRESULT Status = S_OK;
 
-    IfFailRet(InitializeHosting());
+    IfFailRet(GetHostingDelegate(SymbolReaderClassName, "LoadSymbolsForModule", (void **)&g_SOSNetCoreCallbacks.LoadSymbolsForModuleDelegate));
     InitializeSymbolStore();
 
-    _ASSERTE(g_SOSNetCoreCallbacks.LoadSymbolsForModuleDelegate != nullptr);
-
     // The module name needs to be null for in-memory PE's.
     ArrayHolder<char> szModuleName = nullptr;
     if (!isInMemory && pModuleName != nullptr)
@@ -1126,7 +1428,7 @@ HRESULT SymbolReader::GetLineByILOffset(___in mdMethodDef methodToken, ___in ULO
     if (m_symbolReaderHandle != 0)
     {
         _ASSERTE(g_hostingInitialized);
-        _ASSERTE(g_SOSNetCoreCallbacks.GetLineByILOffsetDelegate != nullptr);
+        IfFailRet(GetHostingDelegate(SymbolReaderClassName, "GetLineByILOffset", (void **)&g_SOSNetCoreCallbacks.GetLineByILOffsetDelegate));
 
         BSTR bstrFileName = SysAllocStringLen(0, MAX_LONGPATH);
         if (bstrFileName == nullptr)
@@ -1201,7 +1503,7 @@ HRESULT SymbolReader::GetNamedLocalVariable(___in ISymUnmanagedScope * pScope, _
     if (m_symbolReaderHandle != 0)
     {
         _ASSERTE(g_hostingInitialized);
-        _ASSERTE(g_SOSNetCoreCallbacks.GetLocalVariableNameDelegate != nullptr);
+        IfFailRet(GetHostingDelegate(SymbolReaderClassName, "GetLocalVariableName", (void **)&g_SOSNetCoreCallbacks.GetLocalVariableNameDelegate));
 
         BSTR wszParamName = SysAllocStringLen(0, mdNameLen);
         if (wszParamName == NULL)
@@ -1333,7 +1635,7 @@ HRESULT SymbolReader::ResolveSequencePoint(__in_z WCHAR* pFilename, ___in ULONG3
     if (m_symbolReaderHandle != 0)
     {
         _ASSERTE(g_hostingInitialized);
-        _ASSERTE(g_SOSNetCoreCallbacks.ResolveSequencePointDelegate != nullptr);
+        IfFailRet(GetHostingDelegate(SymbolReaderClassName, "ResolveSequencePoint", (void **)&g_SOSNetCoreCallbacks.ResolveSequencePointDelegate));
 
         char szName[mdNameLen];
         if (WideCharToMultiByte(CP_ACP, 0, pFilename, (int)(_wcslen(pFilename) + 1), szName, mdNameLen, NULL, NULL) == 0)
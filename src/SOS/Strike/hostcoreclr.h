@@ -67,6 +67,7 @@ extern LPCSTR GetDacFilePath();
 extern LPCSTR GetDbiFilePath();
 extern BOOL IsHostingInitialized();
 extern HRESULT InitializeHosting();
+extern HRESULT GetHostingDelegate(LPCSTR entryPointClassName, LPCSTR entryPointMethodName, void** ppDelegate);
 extern HRESULT InitializeSymbolStore(BOOL logging, BOOL msdl, BOOL symweb, const char* symbolServer, const char* cacheDirectory);
 extern void InitializeSymbolStore();
 extern HRESULT LoadNativeSymbols(bool runtimeOnly = false);
@@ -107,7 +108,12 @@ public:
 #endif
         if (m_symbolReaderHandle != 0)
         {
-            g_SOSNetCoreCallbacks.DisposeDelegate(m_symbolReaderHandle);
+            // The hosting runtime is already up (it created the reader), so
+            // this only resolves the delegate the first time through.
+            if (SUCCEEDED(GetHostingDelegate(SymbolReaderClassName, "Dispose", (void **)&g_SOSNetCoreCallbacks.DisposeDelegate)))
+            {
+                g_SOSNetCoreCallbacks.DisposeDelegate(m_symbolReaderHandle);
+            }
             m_symbolReaderHandle = 0;
         }
     }
@@ -9,11 +9,170 @@
 // ==--==
 #include "strike.h"
 #include "util.h"
+#include <string>
+
+// The per-module metadata import cache.  Creating an importer is a DAC
+// round trip (GetModule + QueryInterface) and token-to-name resolution
+// re-walks the metadata each time; commands like !dumpil and the DumpMD
+// paths resolve the same tokens of the same modules over and over.  Each
+// cache entry keeps the module's importer plus a memo of the names already
+// resolved through it; residency is bounded with LRU eviction so hundreds
+// of modules don't pin hundreds of importers.
+//
+// The entry also keeps the IXCLRDataModule the importer was created from.
+// The module interface is the expensive half of importer setup (GetModule
+// re-reads the module's metadata headers from the target each time), and
+// callers like !name2ee need both per module, so handing back the cached
+// interface saves a second setup per module in a sweep.
+struct ModuleImportCacheEntry
+{
+    DWORD_PTR Module;
+    IMetaDataImport* Import;      // the cache's own reference; NULL marks an empty slot
+    IXCLRDataModule* ClrModule;   // the cache's own reference; lives and dies with Import
+    ULONG64 LastUsed;
+    std::unordered_map<ULONG64, const WCHAR*> Names;  // token | (bClassName << 32) -> interned name
+    std::unordered_map<ULONG, std::string> ILNames;   // token -> rendered !dumpil annotation
+};
+
+static const int kMaxImportCacheEntries = 32;
+static ModuleImportCacheEntry g_importCache[kMaxImportCacheEntries];
+static ULONG64 g_importCacheClock = 0;
+
+void ClearModuleImportCache()
+{
+    for (int i = 0; i < kMaxImportCacheEntries; i++)
+    {
+        if (g_importCache[i].Import != NULL)
+        {
+            g_importCache[i].Import->Release();
+            g_importCache[i].Import = NULL;
+        }
+        if (g_importCache[i].ClrModule != NULL)
+        {
+            g_importCache[i].ClrModule->Release();
+            g_importCache[i].ClrModule = NULL;
+        }
+        g_importCache[i].Module = 0;
+        g_importCache[i].LastUsed = 0;
+        g_importCache[i].Names.clear();
+        g_importCache[i].ILNames.clear();
+    }
+}
+
+static ModuleImportCacheEntry* FindModuleImportCacheEntry(DWORD_PTR module)
+{
+    for (int i = 0; i < kMaxImportCacheEntries; i++)
+    {
+        if (g_importCache[i].Import != NULL && g_importCache[i].Module == module)
+        {
+            g_importCache[i].LastUsed = ++g_importCacheClock;
+            return &g_importCache[i];
+        }
+    }
+    return NULL;
+}
+
+// Takes references of its own on the importer and the module interface.
+static void RememberModuleImport(DWORD_PTR module, IXCLRDataModule* pClrModule, IMetaDataImport* pImport)
+{
+    // Evict an empty slot if there is one, otherwise the least recently used.
+    ModuleImportCacheEntry* entry = &g_importCache[0];
+    for (int i = 0; i < kMaxImportCacheEntries; i++)
+    {
+        if (g_importCache[i].Import == NULL)
+        {
+            entry = &g_importCache[i];
+            break;
+        }
+        if (g_importCache[i].LastUsed < entry->LastUsed)
+            entry = &g_importCache[i];
+    }
+
+    if (entry->Import != NULL)
+        entry->Import->Release();
+    if (entry->ClrModule != NULL)
+        entry->ClrModule->Release();
+
+    entry->Module = module;
+    entry->Import = pImport;
+    entry->ClrModule = pClrModule;
+    entry->LastUsed = ++g_importCacheClock;
+    entry->Names.clear();
+    entry->ILNames.clear();
+    pImport->AddRef();
+    pClrModule->AddRef();
+}
+
+DWORD_PTR ModuleForCachedImport(IMetaDataImport* pImport)
+{
+    // Reverse lookup for callers that only hold the importer: an importer
+    // pointer is only a stable identity while its cache entry is resident,
+    // so anything keyed off it should use the module address instead.
+    for (int i = 0; i < kMaxImportCacheEntries; i++)
+    {
+        if (g_importCache[i].Import == pImport)
+            return g_importCache[i].Module;
+    }
+    return 0;
+}
+
+bool FindCachedILTokenName(DWORD_PTR module, mdToken token, const char **ppName)
+{
+    ModuleImportCacheEntry* entry = FindModuleImportCacheEntry(module);
+    if (entry == NULL)
+        return false;
+
+    std::unordered_map<ULONG, std::string>::const_iterator it = entry->ILNames.find(token);
+    if (it == entry->ILNames.end())
+        return false;
+
+    *ppName = it->second.c_str();
+    return true;
+}
+
+void RememberILTokenName(DWORD_PTR module, mdToken token, std::string &&name)
+{
+    // Only memoize alongside a cached importer, so eviction drops both.  The
+    // caller's buffer is taken over rather than copied; formatted signatures
+    // run long on generic-heavy modules.
+    ModuleImportCacheEntry* entry = FindModuleImportCacheEntry(module);
+    if (entry != NULL)
+        entry->ILNames[token] = std::move(name);
+}
+
+static ULONG64 TokenNameKey(mdTypeDef mb, bool bClassName)
+{
+    return ((ULONG64)(bClassName ? 1 : 0) << 32) | mb;
+}
+
+static bool FindCachedTokenName(DWORD_PTR module, mdTypeDef mb, bool bClassName,
+                                __out_ecount (capacity_mdName) WCHAR *mdName, size_t capacity_mdName)
+{
+    ModuleImportCacheEntry* entry = FindModuleImportCacheEntry(module);
+    if (entry == NULL)
+        return false;
+
+    std::unordered_map<ULONG64, const WCHAR*>::const_iterator it = entry->Names.find(TokenNameKey(mb, bClassName));
+    if (it == entry->Names.end())
+        return false;
+
+    wcsncpy_s(mdName, capacity_mdName, it->second, _TRUNCATE);
+    return true;
+}
+
+static void RememberTokenName(DWORD_PTR module, mdTypeDef mb, bool bClassName, const WCHAR *mdName)
+{
+    // Only memoize alongside a cached importer, so eviction drops the
+    // mapping (the interned name itself stays pooled for other callers).
+    ModuleImportCacheEntry* entry = FindModuleImportCacheEntry(module);
+    if (entry != NULL)
+        entry->Names[TokenNameKey(mb, bClassName)] = InternString(mdName);
+}
 
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
-*    This function is called to find the name of a TypeDef using       *  
+*    This function is called to find the name of a TypeDef using       *
 *    metadata API.                                                     *
 *                                                                      *
 \**********************************************************************/
@@ -66,21 +225,69 @@ static HRESULT NameForTypeDef_s(mdTypeDef tkTypeDef, IMetaDataImport *pImport,
 \**********************************************************************/
 IMetaDataImport* MDImportForModule(DacpModuleData* pModule)
 {
+    ModuleImportCacheEntry* entry = FindModuleImportCacheEntry((DWORD_PTR)pModule->Address);
+    if (entry != NULL)
+    {
+        entry->Import->AddRef();
+        return entry->Import;
+    }
+
     IMetaDataImport *pRet = NULL;
     ToRelease<IXCLRDataModule> module;
     HRESULT hr = g_sos->GetModule(pModule->Address, &module);
-    
+
     if (SUCCEEDED(hr))
         hr = module->QueryInterface(IID_IMetaDataImport, (LPVOID *) &pRet);
 
     if (SUCCEEDED(hr))
+    {
+        RememberModuleImport((DWORD_PTR)pModule->Address, module, pRet);
         return pRet;
-    
+    }
+
     return NULL;
 }
 
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Find the IXCLRDataModule for a module, preferring the one the     *
+*    import cache already holds.                                       *
+*                                                                      *
+\**********************************************************************/
+IXCLRDataModule* ClrDataModuleForModule(DWORD_PTR module)
+{
+    ModuleImportCacheEntry* entry = FindModuleImportCacheEntry(module);
+    if (entry != NULL && entry->ClrModule != NULL)
+    {
+        entry->ClrModule->AddRef();
+        return entry->ClrModule;
+    }
+
+    // Miss: create the module interface and fill a full cache entry (the
+    // importer QI is cheap once the module interface exists), so the
+    // MDImportForModule call that usually follows hits the cache too.
+    ToRelease<IXCLRDataModule> pClrModule;
+    if (FAILED(g_sos->GetModule(TO_CDADDR(module), &pClrModule)))
+        return NULL;
+
+    ToRelease<IMetaDataImport> pImport;
+    if (SUCCEEDED(pClrModule->QueryInterface(IID_IMetaDataImport, (LPVOID *) &pImport)))
+        RememberModuleImport(module, pClrModule, pImport);
+
+    return pClrModule.Detach();
+}
+
 IMetaDataImport* MDImportForModule(DWORD_PTR pModule)
 {
+    // A cache hit also skips the module data request.
+    ModuleImportCacheEntry* entry = FindModuleImportCacheEntry(pModule);
+    if (entry != NULL)
+    {
+        entry->Import->AddRef();
+        return entry->Import;
+    }
+
     DacpModuleData moduleData;
     if(moduleData.Request(g_sos, TO_CDADDR(pModule))==S_OK)
         return MDImportForModule(&moduleData);
@@ -178,6 +385,8 @@ void NameForToken_s(DWORD_PTR ModuleAddr, mdTypeDef mb, __out_ecount (capacity_m
 {
     DacpModuleData ModuleData;
     mdName[0] = L'\0';
+    if (FindCachedTokenName(ModuleAddr, mb, bClassName, mdName, capacity_mdName))
+        return;
     if(ModuleData.Request(g_sos, TO_CDADDR(ModuleAddr))==S_OK)
         NameForToken_s(&ModuleData,mb,mdName,capacity_mdName,bClassName);
 }
@@ -201,13 +410,20 @@ void NameForToken_s(DacpModuleData *pModule, mdTypeDef mb, __out_ecount (capacit
                   bool bClassName)
 {
     mdName[0] = L'\0';
+    if (FindCachedTokenName((DWORD_PTR)pModule->Address, mb, bClassName, mdName, capacity_mdName))
+        return;
+
     HRESULT hr = 0;
     ToRelease<IMetaDataImport> pImport = MDImportForModule(pModule);
     if (pImport)
     {
         hr = NameForToken_s (mb, pImport, mdName, capacity_mdName, bClassName);
+        if (SUCCEEDED(hr))
+        {
+            RememberTokenName((DWORD_PTR)pModule->Address, mb, bClassName, mdName);
+        }
     }
-    
+
     if (!pImport || !SUCCEEDED (hr))
     {
         const SIZE_T capacity_moduleName = mdNameLen+19;
@@ -0,0 +1,184 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// Sorting utilities for the multi-million-entry arrays the heap commands
+// build: statistics entries, handle tables, object addresses.
+//
+// RadixSortByKey is an LSD radix sort for elements ordered by a fixed-width
+// integer key.  It makes one pass to histogram all eight key bytes, then one
+// distribution pass per byte that actually varies — addresses and sizes
+// rarely use more than five or six, so a typical sort is a handful of
+// sequential sweeps with no comparator calls at all.  The sort is stable.
+//
+// ParallelMergeSort is the fallback for comparator-ordered elements with no
+// usable integer key: chunks are sorted on worker threads and merged on the
+// caller's thread.  It is not stable (the chunk sorts aren't).
+//
+// This header expects the usual Strike environment (the Windows type and
+// threading surface) to have been set up by its includer.
+
+const size_t kRadixSortCutoff = 128;     // below this, std::stable_sort wins
+
+/* Sorts items ascending by keyOf(item), where keyOf returns an unsigned
+ * 64-bit key.  Stable: equal keys keep their relative order.
+ */
+template <class T, class KEYOF>
+void RadixSortByKey(std::vector<T> &items, KEYOF keyOf)
+{
+    size_t n = items.size();
+    if (n < 2)
+        return;
+
+    if (n < kRadixSortCutoff)
+    {
+        struct KeyLess
+        {
+            KEYOF *Key;
+            bool operator()(const T &lhs, const T &rhs) const
+            {
+                return (*Key)(lhs) < (*Key)(rhs);
+            }
+        };
+        KeyLess less = { &keyOf };
+        std::stable_sort(items.begin(), items.end(), less);
+        return;
+    }
+
+    // One pass builds the histograms of every byte position at once.
+    size_t counts[8][256] = {};
+    for (size_t i = 0; i < n; i++)
+    {
+        ULONG64 key = keyOf(items[i]);
+        for (int d = 0; d < 8; d++)
+            counts[d][(key >> (d * 8)) & 0xFF]++;
+    }
+
+    std::vector<T> scratch(n);
+    T *src = items.data();
+    T *dst = scratch.data();
+
+    for (int d = 0; d < 8; d++)
+    {
+        // If every key has the same byte here, the pass would only copy.
+        if (counts[d][(keyOf(src[0]) >> (d * 8)) & 0xFF] == n)
+            continue;
+
+        // Turn the histogram into starting offsets.
+        size_t offsets[256];
+        size_t sum = 0;
+        for (int b = 0; b < 256; b++)
+        {
+            offsets[b] = sum;
+            sum += counts[d][b];
+        }
+
+        for (size_t i = 0; i < n; i++)
+            dst[offsets[(keyOf(src[i]) >> (d * 8)) & 0xFF]++] = src[i];
+
+        std::swap(src, dst);
+    }
+
+    if (src != items.data())
+        std::copy(src, src + n, items.data());
+}
+
+// A chunk of the array handed to a ParallelMergeSort worker.
+template <class T, class LESS>
+struct MergeSortChunk
+{
+    T *Begin;
+    T *End;
+    LESS *Less;
+};
+
+template <class T, class LESS>
+DWORD WINAPI MergeSortChunkProc(LPVOID param)
+{
+    MergeSortChunk<T, LESS> *chunk = (MergeSortChunk<T, LESS> *)param;
+    std::sort(chunk->Begin, chunk->End, *chunk->Less);
+    return 0;
+}
+
+/* Sorts items by the comparator, sorting chunks on a pool of worker threads
+ * and merging the results.  Falls back to a plain std::sort for small inputs
+ * or when threads cannot be created.  Not stable.
+ * Params:
+ *   maxWorkers - cap on the number of worker threads; 0 means use the
+ *                number of processors.
+ */
+template <class T, class LESS>
+void ParallelMergeSort(std::vector<T> &items, LESS less, int maxWorkers = 0)
+{
+    size_t n = items.size();
+
+    int cWorkers = maxWorkers;
+    if (cWorkers <= 0)
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        cWorkers = (int)si.dwNumberOfProcessors;
+    }
+
+    // Below ~64k entries per chunk the merge passes cost more than the
+    // parallelism returns.
+    if (cWorkers > (int)(n / 0x10000))
+        cWorkers = (int)(n / 0x10000);
+
+    if (cWorkers < 2)
+    {
+        std::sort(items.begin(), items.end(), less);
+        return;
+    }
+
+    // Carve the array into equal chunks and sort each on its own thread.
+    std::vector<MergeSortChunk<T, LESS> > chunks(cWorkers);
+    std::vector<HANDLE> threads;
+
+    size_t per = n / cWorkers;
+    for (int i = 0; i < cWorkers; i++)
+    {
+        chunks[i].Begin = items.data() + i * per;
+        chunks[i].End = (i == cWorkers - 1) ? items.data() + n : chunks[i].Begin + per;
+        chunks[i].Less = &less;
+    }
+
+    // The caller's thread takes the last chunk itself.
+    for (int i = 0; i < cWorkers - 1; i++)
+    {
+        HANDLE thread = CreateThread(NULL, 0, MergeSortChunkProc<T, LESS>, &chunks[i], 0, NULL);
+        if (thread == NULL)
+            break;
+        threads.push_back(thread);
+    }
+
+    std::sort(chunks[cWorkers - 1].Begin, chunks[cWorkers - 1].End, less);
+
+    // Chunks whose threads never started are sorted here instead.
+    for (int i = (int)threads.size(); i < cWorkers - 1; i++)
+        std::sort(chunks[i].Begin, chunks[i].End, less);
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+
+    // Pairwise merges, log2(cWorkers) passes.
+    for (int width = 1; width < cWorkers; width *= 2)
+    {
+        for (int i = 0; i + width < cWorkers; i += 2 * width)
+        {
+            int last = i + 2 * width - 1;
+            if (last >= cWorkers)
+                last = cWorkers - 1;
+
+            std::inplace_merge(chunks[i].Begin, chunks[i + width].Begin, chunks[last].End, less);
+        }
+    }
+}
@@ -0,0 +1,173 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include <string.h>
+
+// Vector scan kernels for the loops that reduce to streaming over a large
+// local buffer: range-filtering candidate pointers (the !dumpstackobjects
+// prefilter) and bulk hashing payload bytes (the string interning pool).
+//
+// Each kernel has a scalar definition and, on 64-bit x86 and ARM hosts, a
+// vector implementation selected at compile time — SSE2 is architectural
+// baseline on x64 and NEON on arm64, so the vector paths need no runtime
+// dispatch and no special build flags.  Everything here works on plain
+// memory and never touches the target or the debugger interfaces, so the
+// kernels are safe on pool worker threads.
+//
+// This header expects the usual Strike environment (the Windows type
+// surface) to have been set up by its includer.
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define SCANKERNELS_SSE2 1
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define SCANKERNELS_NEON 1
+#endif
+
+#ifdef SCANKERNELS_SSE2
+// Signed 64-bit a > b composed from the 32-bit comparisons SSE2 does have:
+// the high dwords decide unless they are equal, in which case the sign of
+// the 64-bit difference b - a decides.
+inline __m128i ScanCmpGtI64(__m128i a, __m128i b)
+{
+    __m128i r = _mm_and_si128(_mm_cmpeq_epi32(a, b), _mm_sub_epi64(b, a));
+    r = _mm_or_si128(r, _mm_cmpgt_epi32(a, b));
+    return _mm_shuffle_epi32(r, _MM_SHUFFLE(3, 3, 1, 1));
+}
+#endif
+
+/* Returns the index of the first slot at or after `start` whose value falls
+ * in [base, base + range), or `count` if there is none.  This is the
+ * "possibly a heap pointer" filter over a snapshot of slots: callers
+ * validate the survivors precisely, so base/range only need to be
+ * conservative.  Iterate by restarting at the previous hit plus one.
+ */
+inline size_t ScanNextSlotInRange(const DWORD_PTR *slots, size_t count, size_t start,
+                                  DWORD_PTR base, DWORD_PTR range)
+{
+    size_t i = start;
+
+#if defined(SCANKERNELS_SSE2)
+    // Unsigned (slot - base) < range with the sign-bias trick: biasing both
+    // sides by 2^63 turns the unsigned comparison into the signed one above.
+    const __m128i sign = _mm_set1_epi64x((long long)0x8000000000000000ULL);
+    const __m128i vbase = _mm_set1_epi64x((long long)base);
+    const __m128i vrange = _mm_xor_si128(_mm_set1_epi64x((long long)range), sign);
+
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(slots + i));
+        __m128i diff = _mm_xor_si128(_mm_sub_epi64(v, vbase), sign);
+        int mask = _mm_movemask_epi8(ScanCmpGtI64(vrange, diff));
+        if (mask != 0)
+            return i + ((mask & 0xFF) ? 0 : 1);
+    }
+#elif defined(SCANKERNELS_NEON)
+    uint64x2_t vbase = vdupq_n_u64(base);
+    uint64x2_t vrange = vdupq_n_u64(range);
+
+    for (; i + 2 <= count; i += 2)
+    {
+        uint64x2_t v = vld1q_u64((const uint64_t *)(slots + i));
+        uint64x2_t lt = vcltq_u64(vsubq_u64(v, vbase), vrange);
+        if (vgetq_lane_u64(lt, 0) != 0)
+            return i;
+        if (vgetq_lane_u64(lt, 1) != 0)
+            return i + 1;
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        if ((DWORD_PTR)(slots[i] - base) < range)
+            return i;
+    }
+
+    return count;
+}
+
+/* FNV-1a over the buffer, eight bytes at a time in four independent lanes.
+ * The byte-wise hash is limited by its serial multiply chain; four lanes
+ * break the chain (and let the compiler vectorize the xors) at the cost of
+ * producing a different — but equally well mixed — value than byte-wise
+ * FNV.  Only use it for hashes that never leave the session.
+ */
+inline ULONG64 ScanHashBytes(const void *data, size_t size)
+{
+    const ULONG64 kPrime = 0x100000001B3ULL;
+    const BYTE *bytes = (const BYTE *)data;
+
+    ULONG64 lanes[4] = {
+        0xCBF29CE484222325ULL, 0xCBF29CE484222326ULL,
+        0xCBF29CE484222327ULL, 0xCBF29CE484222328ULL
+    };
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        ULONG64 words[4];
+        memcpy(words, bytes + i, sizeof(words));
+        for (int lane = 0; lane < 4; lane++)
+            lanes[lane] = (lanes[lane] ^ words[lane]) * kPrime;
+    }
+
+    ULONG64 hash = lanes[0];
+    hash = (hash ^ lanes[1]) * kPrime;
+    hash = (hash ^ lanes[2]) * kPrime;
+    hash = (hash ^ lanes[3]) * kPrime;
+
+    for (; i < size; i++)
+        hash = (hash ^ bytes[i]) * kPrime;
+
+    return hash;
+}
+
+/* Narrows `count` UTF-16 characters into dst as long as every one of them is
+ * plain ASCII.  Returns false on the first character that is not, leaving
+ * dst partially written; the caller runs a real conversion then.  Metadata
+ * names are almost always pure ASCII, so this is the fast path of the
+ * wide-to-narrow conversion layer.  dst is not null terminated here.
+ */
+inline bool ScanNarrowAscii(const WCHAR *src, size_t count, char *dst)
+{
+    size_t i = 0;
+
+#if defined(SCANKERNELS_SSE2)
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + i + 8));
+
+        // Any character with a bit above 0x7F set bails to the slow path.
+        __m128i mask = _mm_set1_epi16((short)0xFF80);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(lo, hi), mask), _mm_setzero_si128())) != 0xFFFF)
+            return false;
+
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#elif defined(SCANKERNELS_NEON)
+    for (; i + 16 <= count; i += 16)
+    {
+        uint16x8_t lo = vld1q_u16((const uint16_t *)(src + i));
+        uint16x8_t hi = vld1q_u16((const uint16_t *)(src + i + 8));
+
+        if (vmaxvq_u16(vorrq_u16(lo, hi)) > 0x7F)
+            return false;
+
+        vst1q_u8((uint8_t *)(dst + i), vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        if (src[i] > 0x7F)
+            return false;
+        dst[i] = (char)src[i];
+    }
+
+    return true;
+}
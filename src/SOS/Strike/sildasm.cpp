@@ -21,6 +21,7 @@
 //#endif
 #include "disasm.h"
 #include <dbghelp.h>
+#include <string>
 
 #include "corhdr.h"
 
@@ -37,8 +38,34 @@
 #include "corhlpr.cpp"
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Capture target for DisassembleToken: when set, silOut appends the formatted
+// text here instead of printing it, so a token's rendered annotation can be
+// memoized and replayed without re-resolving the metadata.
+static std::string *g_pSilCaptureTarget = NULL;
+
+static void silOut(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+
+    if (g_pSilCaptureTarget != NULL)
+    {
+        char buffer[1024];
+        _vsnprintf_s(buffer, _countof(buffer), _TRUNCATE, fmt, args);
+        g_pSilCaptureTarget->append(buffer);
+    }
+    else if (!Output::IsOutputSuppressed())
+    {
+        ExtOutIndent();
+        OutputVaList(DEBUG_OUTPUT_NORMAL, fmt, args);
+    }
+
+    va_end(args);
+}
+
 #undef printf
-#define printf ExtOut
+#define printf silOut
 
 // typedef unsigned char BYTE;
 struct OpCode
@@ -49,7 +76,7 @@ struct OpCode
     BYTE b1;
     BYTE b2;
 
-    unsigned int getCode() { 
+    unsigned int getCode() const {
         if (b1==0xFF) return b2;
         else return (0xFE00 | b2);
     }
@@ -57,9 +84,13 @@ struct OpCode
 
 #define OPCODES_LENGTH 0x122
 
+// The table is fully initialized from opcode.def at compile time and lives in
+// read-only data; opcode.def lists the single-byte opcodes in encoding order
+// followed by the 0xFE-prefixed ones, so the value readOpcode() produces is
+// also the index into this table.
 #undef OPDEF
 #define OPDEF(c,s,pop,push,args,type,l,s1,s2,ctrl) {c, s, args, s1, s2},
-static OpCode opcodes[] =
+static const OpCode opcodes[] =
 {
 #include "opcode.def"
 };
@@ -87,8 +118,8 @@ unsigned int readOpcode()
     return c;
 }
 
-void DisassembleToken(IMetaDataImport *i,
-                      DWORD token)
+static void DisassembleTokenWorker(IMetaDataImport *i,
+                                   DWORD token)
 {
     class MethodSigArgPrettyPrinter
     {
@@ -130,11 +161,14 @@ void DisassembleToken(IMetaDataImport *i,
                         // Print type
                         CQuickBytes out;
                         PrettyPrintType(sigParser.GetPtr(), &out, pMDImport);
+                        CQuickBytes wide;
                         int cchString = MultiByteToWideChar (CP_ACP, 0, asString(&out), -1, NULL, 0);
-                        WCHAR *psz = new WCHAR[cchString];
-                        MultiByteToWideChar (CP_ACP, 0, asString(&out), -1, psz, cchString);
-                        printf("%S ", psz);
-                        delete[] psz;
+                        WCHAR *psz = (WCHAR *)wide.Alloc(cchString * sizeof(WCHAR));
+                        if (psz != NULL)
+                        {
+                            MultiByteToWideChar (CP_ACP, 0, asString(&out), -1, psz, cchString);
+                            printf("%S ", psz);
+                        }
                         sigParser.SkipExactlyOne();
                     }
                 }
@@ -146,18 +180,24 @@ void DisassembleToken(IMetaDataImport *i,
             if (!isField)
             {
                 printf("(");
+                // One buffer pair for the whole argument list; each argument
+                // rewinds the length and reuses the high-water allocation.
+                CQuickBytes out;
+                CQuickBytes wide;
                 for (ULONG paramIndex = 0; paramIndex < cParamTypes; paramIndex++)
                 {
-                    CQuickBytes out;
+                    out.ReSize(0);
                     PrettyPrintType(sigParser.GetPtr(), &out, pMDImport);
                     int cchString = MultiByteToWideChar (CP_ACP, 0, asString(&out), -1, NULL, 0);
-                    WCHAR *psz = new WCHAR[cchString];
-                    MultiByteToWideChar (CP_ACP, 0, asString(&out), -1, psz, cchString);
-                    if ((paramIndex + 1) < cParamTypes)
-                        printf("%S,", psz);
-                    else
-                        printf("%S", psz);
-                    delete[] psz;
+                    if (SUCCEEDED(wide.ReSize(cchString * sizeof(WCHAR))))
+                    {
+                        WCHAR *psz = (WCHAR *)wide.Ptr();
+                        MultiByteToWideChar (CP_ACP, 0, asString(&out), -1, psz, cchString);
+                        if ((paramIndex + 1) < cParamTypes)
+                            printf("%S,", psz);
+                        else
+                            printf("%S", psz);
+                    }
                     sigParser.SkipExactlyOne();
                 }
                 printf(")");
@@ -323,6 +363,37 @@ void DisassembleToken(IMetaDataImport *i,
     }
 }
 
+// Formatting a token resolves its member, type and signature through the
+// metadata importer; a module with many tokens hits the same ones continually
+// across its methods.  The rendered text is memoized per module beside the
+// importer cache, so repeats replay the text without touching the metadata.
+// Importers not resident in the import cache have no stable identity and
+// format directly.
+void DisassembleToken(IMetaDataImport *i,
+                      DWORD token)
+{
+    DWORD_PTR module = ModuleForCachedImport(i);
+    const char *pCachedName;
+    if (module != 0 && FindCachedILTokenName(module, token, &pCachedName))
+    {
+        printf("%s", pCachedName);
+        return;
+    }
+
+    if (module != 0)
+    {
+        std::string captured;
+        g_pSilCaptureTarget = &captured;
+        DisassembleTokenWorker(i, token);
+        g_pSilCaptureTarget = NULL;
+        printf("%s", captured.c_str());
+        RememberILTokenName(module, token, std::move(captured));
+        return;
+    }
+
+    DisassembleTokenWorker(i, token);
+}
+
 ULONG GetILSize(DWORD_PTR ilAddr)
 {
     ULONG uRet = 0;
@@ -422,13 +493,20 @@ void DecodeIL(IMetaDataImport *pImport, BYTE *buffer, ULONG bufSize)
         
         printf("%*sIL_%04x: ", indentCount, "", position);
         unsigned int c = readOpcode();
-        OpCode opcode = opcodes[c];
+        if (c >= OPCODES_LENGTH)
+        {
+            // A prefixed byte with no opcode assigned; the stream is corrupt
+            // and nothing past this point decodes reliably.
+            printf(".unknown 0x%x\n", c);
+            break;
+        }
+        const OpCode &opcode = opcodes[c];
         printf("%s ", opcode.name);
 
         switch(opcode.args)
         {
         case InlineNone: break;
-        
+
         case ShortInlineVar:
             printf("VAR OR ARG %d",readData<BYTE>()); break;
         case InlineVar:
@@ -445,12 +523,12 @@ void DecodeIL(IMetaDataImport *pImport, BYTE *buffer, ULONG bufSize)
             printf("IL_%04x",readData<BYTE>()  + position); break;
         case InlineI8:
             printf("%ld", readData<__int64>()); break;
-            
+
         case InlineMethod:
         case InlineField:
         case InlineType:
         case InlineTok:
-        case InlineSig:        
+        case InlineSig:
         {
             LONG l = readData<LONG>();
             if (pImport != NULL)
@@ -633,7 +711,12 @@ void DecodeDynamicIL(BYTE *data, ULONG Size, DacpObjectData& tokenArray)
     {	        
         printf("%*sIL_%04x: ", indentCount, "", position);
         unsigned int c = readOpcode();
-        OpCode opcode = opcodes[c];
+        if (c >= OPCODES_LENGTH)
+        {
+            printf(".unknown 0x%x\n", c);
+            break;
+        }
+        const OpCode &opcode = opcodes[c];
         printf("%s ", opcode.name);
 
         switch(opcode.args)
@@ -750,9 +833,26 @@ static void insertStr(CQuickBytes *out, const char* str) {
 }
 
 static void appendStrNum(CQuickBytes *out, int num) {
-    char buff[16];  
-    sprintf_s(buff, COUNTOF(buff), "%d", num);   
-    appendStr(out, buff);   
+    char buff[16];
+    sprintf_s(buff, COUNTOF(buff), "%d", num);
+    appendStr(out, buff);
+}
+
+// Session memo of pretty-printed generic instantiations.  Generic-heavy
+// modules repeat the same instantiation blobs throughout their IL, and each
+// print resolves every argument's token through the metadata importer.  The
+// key is the raw signature bytes plus the owning module and format flags, so
+// a hit reproduces exactly the text the full walk would emit.  Dropped
+// alongside the module import cache, whose identities it depends on.
+static std::unordered_map<std::string, std::string> *g_pSigFormatMemo = NULL;
+
+void ClearSigFormatMemo()
+{
+    if (g_pSigFormatMemo != NULL)
+    {
+        delete g_pSigFormatMemo;
+        g_pSigFormatMemo = NULL;
+    }
 }
 
 
@@ -763,10 +863,9 @@ PCCOR_SIGNATURE PrettyPrintType(
     IMetaDataImport *pIMD,           // ptr to IMetaDataImport class with ComSig
     DWORD formatFlags /*= formatILDasm*/)
 {
-    mdToken  tk;    
-    const char* str;    
+    mdToken  tk;
+    const char* str;
     int typ;
-    CQuickBytes tmp;
     CQuickBytes Appendix;
     BOOL Reiterate;
     int n;
@@ -924,6 +1023,41 @@ PCCOR_SIGNATURE PrettyPrintType(
 
             case ELEMENT_TYPE_GENERICINST :
             {
+              // Measure the whole instantiation with the (non-allocating)
+              // signature parser first, so repeats can be answered from the
+              // session memo without resolving any tokens.  Importers not
+              // resident in the import cache have no stable identity and skip
+              // the memo entirely.
+              std::string memoKey;
+              PCCOR_SIGNATURE instEnd = NULL;
+              if ((formatFlags & FormatSignature) != 0)
+              {
+                  DWORD_PTR module = ModuleForCachedImport(pIMD);
+                  PCCOR_SIGNATURE instStart = typePtr - 1;
+                  SigParser instParser(instStart);
+                  if (module != 0 && SUCCEEDED(instParser.SkipExactlyOne()))
+                  {
+                      instEnd = instParser.GetPtr();
+                      memoKey.assign((const char*)instStart, (size_t)(instEnd - instStart));
+                      memoKey.append((const char*)&module, sizeof(module));
+                      memoKey.append((const char*)&formatFlags, sizeof(formatFlags));
+
+                      if (g_pSigFormatMemo != NULL)
+                      {
+                          std::unordered_map<std::string, std::string>::const_iterator itr =
+                              g_pSigFormatMemo->find(memoKey);
+                          if (itr != g_pSigFormatMemo->end())
+                          {
+                              appendStr(out, itr->second.c_str(), (unsigned)itr->second.size());
+                              typePtr = instEnd;
+                              break;
+                          }
+                      }
+                  }
+              }
+
+              SIZE_T memoStart = out->Size();
+
               typePtr = PrettyPrintType(typePtr, out, pIMD, formatFlags);
               if ((formatFlags & FormatSignature) == 0)
                   break;
@@ -932,7 +1066,7 @@ PCCOR_SIGNATURE PrettyPrintType(
                   appendStr(out, "<");
               else
                   appendStr(out,"[");
-              unsigned numArgs = CorSigUncompressData(typePtr);    
+              unsigned numArgs = CorSigUncompressData(typePtr);
               bool needComma = false;
               while(numArgs--)
               {
@@ -945,6 +1079,16 @@ PCCOR_SIGNATURE PrettyPrintType(
                   appendStr(out, ">");
               else
                   appendStr(out,"]");
+
+              if (!memoKey.empty())
+              {
+                  // Best effort: on allocation failure the instantiation is
+                  // simply formatted again next time.
+                  if (g_pSigFormatMemo == NULL)
+                      g_pSigFormatMemo = new std::unordered_map<std::string, std::string>();
+                  if (g_pSigFormatMemo != NULL)
+                      (*g_pSigFormatMemo)[std::move(memoKey)].assign(&((char*)out->Ptr())[memoStart], out->Size() - memoStart);
+              }
               break;
             }
 
@@ -39,14 +39,14 @@ namespace sos
 
 
     Object::Object(TADDR addr)
-        : mAddress(addr), mMT(0), mSize(~0), mPointers(false), mMTData(0), mTypeName(0)
+        : mAddress(addr), mMT(0), mSize(~0), mPointers(false), mNumComponents(~0), mMTData(0), mTypeName(0)
     {
         if ((mAddress & ~ALIGNCONST) != mAddress)
             sos::Throw<Exception>("Object %p is misaligned.", mAddress);
     }
 
     Object::Object(TADDR addr, TADDR mt)
-        : mAddress(addr), mMT(mt & ~3), mSize(~0), mPointers(false), mMTData(0), mTypeName(0)
+        : mAddress(addr), mMT(mt & ~3), mSize(~0), mPointers(false), mNumComponents(~0), mMTData(0), mTypeName(0)
     {
         if ((mAddress & ~ALIGNCONST) != mAddress)
             sos::Throw<Exception>("Object %p is misaligned.", mAddress);
@@ -54,23 +54,20 @@ namespace sos
     
     
     Object::Object(const Object &rhs)
-        : mAddress(rhs.mAddress), mMT(rhs.mMT), mSize(rhs.mSize), mPointers(rhs.mPointers), mMTData(rhs.mMTData), mTypeName(rhs.mTypeName)
+        : mAddress(rhs.mAddress), mMT(rhs.mMT), mSize(rhs.mSize), mPointers(rhs.mPointers), mNumComponents(rhs.mNumComponents), mMTData(rhs.mMTData), mTypeName(rhs.mTypeName)
     {
         rhs.mMTData = 0;
-        rhs.mTypeName = 0;
     }
 
     const Object &Object::operator=(TADDR addr)
     {
         if (mMTData)
             delete mMTData;
-        
-        if (mTypeName)
-            delete mTypeName;
 
         mAddress = addr;
         mMT = 0;
         mSize = ~0;
+        mNumComponents = ~0;
         mMTData = 0;
         mTypeName = 0;
 
@@ -124,28 +121,49 @@ namespace sos
 
         return mMT;
     }
-    
+
+    void Object::SeedHeader(TADDR mt, DWORD numComponents) const
+    {
+        if (mMT == NULL && (mt & ~3) != NULL)
+            mMT = mt & ~3;
+
+        mNumComponents = numComponents;
+    }
+
+
     TADDR Object::GetComponentMT() const
     {
         if (mMT != NULL && mMT != sos::MethodTable::GetArrayMT())
             return NULL;
-        
+
+        // The element type handle is derived from the array's MethodTable
+        // alone, so one object data request per distinct array type serves
+        // every instance.  The per-object request this replaces was the
+        // dominant DAC traffic when listing array-heavy heaps.
+        MethodTableInfo *info = mMT != NULL ? g_special_mtCache.Lookup((DWORD_PTR)mMT) : NULL;
+        if (info != NULL && info->ComponentMTKnown)
+            return info->ComponentMT;
+
         DacpObjectData objData;
         if (FAILED(objData.Request(g_sos, TO_CDADDR(mAddress))))
             sos::Throw<DataRead>("Failed to request object data for %s.", DMLListNearObj(mAddress));
-        
+
         if (mMT == NULL)
+        {
             mMT = TO_TADDR(objData.MethodTable) & ~3;
-        
-        return TO_TADDR(objData.ElementTypeHandle);
+            info = g_special_mtCache.Lookup((DWORD_PTR)mMT);
+        }
+
+        info->ComponentMTKnown = true;
+        info->ComponentMT = TO_TADDR(objData.ElementTypeHandle);
+        return info->ComponentMT;
     }
 
     const WCHAR *Object::GetTypeName() const
     {
         if (mTypeName == NULL)
-            mTypeName = CreateMethodTableName(GetMT(), GetComponentMT());
-            
-        
+            mTypeName = GetInternedMethodTableName(GetMT(), GetComponentMT());
+
         if (mTypeName == NULL)
             return W("<error>");
 
@@ -198,7 +216,21 @@ namespace sos
             {
                 // this is an array, so the size has to include the size of the components. We read the number
                 // of components from the target and multiply by the component size to get the size.
-                mSize += info->ComponentSize * GetNumComponents(GetAddress());
+                DWORD components;
+                if (mNumComponents != (DWORD)~0)
+                {
+                    // Already decoded out of the heap walk's read-ahead
+                    // buffer.  GetNumComponents counts the trailing NULL a
+                    // string's component size leaves out, so match it.
+                    components = mNumComponents;
+                    if (mMT == TO_TADDR(g_special_usefulGlobals.StringMethodTable))
+                        components++;
+                }
+                else
+                {
+                    components = GetNumComponents(GetAddress());
+                }
+                mSize += info->ComponentSize * components;
             }
 
             // On x64 we do an optimization to save 4 bytes in almost every string we create.
@@ -302,20 +334,11 @@ namespace sos
         return _wcscmp(mt.GetName(), W("<Unloaded Type>")) == 0;
     }
     
-    void MethodTable::Clear()
-    {
-        if (mName)
-        {
-            delete [] mName;
-            mName = NULL;
-        }
-    }
-    
     const WCHAR *MethodTable::GetName() const
     {
         if (mName == NULL)
-            mName = CreateMethodTableName(mMT);
-        
+            mName = GetInternedMethodTableName(mMT);
+
         if (mName == NULL)
             return W("<error>");
             
@@ -362,13 +385,49 @@ namespace sos
         return out.ThreadId != 0 && out.ThreadPtr != NULL;
     }
     
+    bool Object::ReadStringData(TADDR address, size_t strLength, __out_ecount(cchBuffer) WCHAR *buffer, size_t cchBuffer)
+    {
+        SOS_Assert(buffer);
+        SOS_Assert(cchBuffer > 0);
+
+        size_t count = strLength;
+        if (count > cchBuffer - 1)
+            count = cchBuffer - 1;
+
+        if (count > 0)
+        {
+            ULONG bytes = (ULONG)(count * sizeof(WCHAR));
+            ULONG fetched = 0;
+            if (FAILED(g_ExtData->ReadVirtual(TO_CDADDR(address + GetStringDataOffset()), buffer, bytes, &fetched)) ||
+                fetched != bytes)
+            {
+                return false;
+            }
+        }
+
+        buffer[count] = W('\0');
+        return true;
+    }
+
     bool Object::GetStringData(__out_ecount(size) WCHAR *buffer, size_t size) const
     {
         SOS_Assert(IsString());
         SOS_Assert(buffer);
         SOS_Assert(size > 0);
 
-        return SUCCEEDED(g_sos->GetObjectStringData(mAddress, (ULONG32)size, buffer, NULL));
+        // The length read doubles as the extent computation: one read for
+        // the header, one for the entire (capped) payload.
+        size_t length;
+        try
+        {
+            length = GetStringLength();
+        }
+        catch (const sos::Exception &)
+        {
+            return false;
+        }
+
+        return ReadStringData(mAddress, length, buffer, size);
     }
     
     size_t Object::GetStringLength() const
@@ -571,9 +630,14 @@ namespace sos
     const TADDR GCHeap::HeapStart = 0;
     const TADDR GCHeap::HeapEnd = ~0;
 
+    // Bytes of segment memory the read-ahead stage fetches per request.  Big
+    // enough to amortize the round trip over thousands of objects, small
+    // enough that a walk over a narrow range does not overpay.
+    const size_t kReadAheadChunkSize = 0x80000;
+
     ObjectIterator::ObjectIterator(const DacpGcHeapDetails *heap, int numHeaps, TADDR start, TADDR stop)
     : bLarge(false), mCurrObj(0), mLastObj(0), mStart(start), mEnd(stop), mSegmentEnd(0), mHeaps(heap),
-      mNumHeaps(numHeaps), mCurrHeap(0)
+      mNumHeaps(numHeaps), mCurrHeap(0), mChunk(NULL), mChunkStart(0), mChunkValid(0), mChunkFailed(false)
     {
         mAllocInfo.Init();
         SOS_Assert(numHeaps > 0);
@@ -583,11 +647,79 @@ namespace sos
             sos::Throw<DataRead>("Could not request segment data at %p.", segStart);
 
         mCurrObj = mStart < TO_TADDR(mSegment.mem) ? TO_TADDR(mSegment.mem) : mStart;
-        mSegmentEnd = (segStart == TO_TADDR(mHeaps[0].ephemeral_heap_segment)) ? 
+        mSegmentEnd = (segStart == TO_TADDR(mHeaps[0].ephemeral_heap_segment)) ?
                             TO_TADDR(mHeaps[0].alloc_allocated) :
                             TO_TADDR(mSegment.allocated);
 
-        CheckSegmentRange();
+        if (CheckSegmentRange())
+            SeedCurrObject();
+    }
+
+    const BYTE *ObjectIterator::ReadAhead(TADDR addr, size_t size)
+    {
+        if (addr < mChunkStart || addr + size > mChunkStart + mChunkValid)
+        {
+            if (mChunkFailed)
+                return NULL;
+
+            if (mChunk == NULL)
+            {
+                mChunk = new (std::nothrow) BYTE[kReadAheadChunkSize];
+                if (mChunk == NULL)
+                {
+                    // Not fatal: the walk simply decodes each object with
+                    // its own reads, as it did before read-ahead existed.
+                    mChunkFailed = true;
+                    return NULL;
+                }
+            }
+
+            // One request fetches the window of segment memory ahead of the
+            // decode; nothing below it touches the target again until the
+            // walk crosses the window.
+            size_t toRead = kReadAheadChunkSize;
+            if (mSegmentEnd > addr && toRead > mSegmentEnd - addr)
+                toRead = mSegmentEnd - addr;
+            if (toRead < size)
+                toRead = size;
+
+            g_readStats.Calls++;
+            g_readStats.BytesRequested += toRead;
+
+            ULONG fetched = 0;
+            if (FAILED(g_ExtData->ReadVirtual(TO_CDADDR(addr), mChunk, (ULONG)toRead, &fetched)))
+                fetched = 0;
+
+            g_readStats.BytesRead += fetched;
+
+            mChunkStart = addr;
+            mChunkValid = fetched;
+
+            if (addr + size > mChunkStart + mChunkValid)
+                return NULL;
+        }
+
+        return mChunk.GetPtr() + (addr - mChunkStart);
+    }
+
+    void ObjectIterator::SeedCurrObject()
+    {
+        if (mCurrHeap == mNumHeaps)     // the walk is complete
+            return;
+
+        // The method table pointer is the first slot of the object and the
+        // component count (for arrays) the slot after it; the minimum object
+        // size guarantees both are inside the segment.
+        const BYTE *p = ReadAhead(mCurrObj.GetAddress(), sizeof(TADDR) + sizeof(DWORD));
+        if (p == NULL)
+            return;
+
+        TADDR mt;
+        DWORD numComponents;
+        memcpy(&mt, p, sizeof(mt));
+        memcpy(&numComponents, p + sizeof(TADDR), sizeof(numComponents));
+
+        mCurrObj.SeedHeader(mt, numComponents);
     }
 
     bool ObjectIterator::NextSegment()
@@ -699,7 +831,8 @@ namespace sos
         }
         catch(const sos::Exception &)
         {
-            NextSegment();
+            if (NextSegment())
+                SeedCurrObject();
         }
     }
 
@@ -717,8 +850,19 @@ namespace sos
 
     void ObjectIterator::MoveToNextObject()
     {
+        SOSProgressStep("heap walk", mCurrObj.GetAddress());
+
+        // The flattened common case: a header seeded from the read-ahead
+        // window plus an already-sized method table makes the size a cache
+        // probe and a multiply.  Only a cold method table or an unseeded
+        // header drops into the outlined sizing machinery of GetSize, which
+        // is where all the DAC requests and throw paths live.
+        size_t size;
+        if (!mCurrObj.TryGetSizeInline(size))
+            size = mCurrObj.GetSize();
+
         // Object::GetSize can be unaligned, so we must align it ourselves.
-        size_t size = (bLarge ? AlignLarge(mCurrObj.GetSize()) : Align(mCurrObj.GetSize()));
+        size = bLarge ? AlignLarge(size) : Align(size);
 
         mLastObj = mCurrObj;
         mCurrObj = mCurrObj.GetAddress() + size;
@@ -749,6 +893,10 @@ namespace sos
 
         if (mCurrObj > mEnd || mCurrObj >= mSegmentEnd)
             NextSegment();
+
+        // Hand the new object its header out of the read-ahead window before
+        // anything consumes it.
+        SeedCurrObject();
     }
 
     SyncBlkIterator::SyncBlkIterator()
@@ -765,6 +913,22 @@ namespace sos
 
     GCHeap::GCHeap()
     {
+        // The session snapshot already holds every heap's details; copying
+        // them is free compared to re-requesting one per heap.  Fall through
+        // to the direct requests only if the snapshot cannot be built (its
+        // failure prints a message, ours throws like it always has).
+        if (g_snapshot.Build())
+        {
+            mHeapData = *g_snapshot.GetHeapData();
+            mNumHeaps = g_snapshot.GetHeapCount();
+            mHeaps = new DacpGcHeapDetails[mNumHeaps];
+
+            for (int i = 0; i < mNumHeaps; i++)
+                mHeaps[i] = *g_snapshot.GetHeapDetails(i);
+
+            return;
+        }
+
         if (FAILED(mHeapData.Request(g_sos)))
             sos::Throw<DataRead>("Failed to request GC heap data.");
 
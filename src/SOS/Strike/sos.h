@@ -106,7 +106,7 @@ namespace sos
      */
     inline void CheckInterrupt()
     {
-        if (g_ExtControl->GetInterrupt() == S_OK)
+        if (SOSInterruptPending())
             Throw<Exception>("User interrupt.");
     }
 
@@ -194,41 +194,25 @@ namespace sos
         MethodTable(const MethodTable &mt)
             : mMT(mt.mMT), mName(mt.mName)
         {
-            // Acquire the calculated mName field.  Since we are making a copy, we will likely use
-            // the copy instead of the original.
-            mt.mName = NULL;
         }
-        
+
         const MethodTable &operator=(const MethodTable &mt)
         {
-            Clear();
-
-            // Acquire the calculated mName field.  Since we are making a copy, we will likely use
-            // the copy instead of the original.
             mMT = mt.mMT;
             mName = mt.mName;
-            mt.mName = NULL;
-            
+
             return *this;
         }
-        
-        ~MethodTable()
-        {
-            Clear();
-        }
 
         /* Returns the class name of this MethodTable.  The pointer returned is
-         * valid through the lifetime of the MethodTable object and should not be
-         * freed.
+         * interned in the session-level name cache and should not be freed; it
+         * stays valid until the target can run again.
          */
         const WCHAR *GetName() const;
 
-    private:
-        void Clear();
-
     private:
         TADDR mMT;
-        mutable WCHAR *mName;
+        mutable const WCHAR *mName;
     };
 
     /* This represents an object on the GC heap in the target process.  This class
@@ -262,6 +246,22 @@ namespace sos
 #endif
         }
 
+        /* Reads the character payload of a string object with a single
+         * request.  The extent comes from the caller's already-known string
+         * length, so unlike the generic string read paths nothing probes the
+         * object again and the payload never crosses more than one request.
+         * Strings longer than the buffer are truncated to fit it.
+         * Params:
+         *   address - the address of the string object
+         *   strLength - the string's length in characters (see GetStringLength)
+         *   buffer - the buffer to fill; null terminated on success
+         *   cchBuffer - the size of the buffer in characters
+         * Returns:
+         *   True if the (possibly truncated) payload was read, false on a
+         *   read failure.
+         */
+        static bool ReadStringData(TADDR address, size_t strLength, __out_ecount(cchBuffer) WCHAR *buffer, size_t cchBuffer);
+
     public:
         /* Constructor.  Use Object(TADDR, TADDR) instead if you know the method table.
          * Parameters:
@@ -286,9 +286,6 @@ namespace sos
         {
             if (mMTData)
                 delete mMTData;
-                
-            if (mTypeName)
-                delete mTypeName;
         }
 
         const Object &operator=(TADDR addr);
@@ -338,7 +335,20 @@ namespace sos
          *                    verification here.)
          */
         TADDR GetMT() const;
-        
+
+        /* Seeds the lazily-read header fields with values the caller already
+         * decoded from a buffered copy of the heap (see the read-ahead stage
+         * of ObjectIterator).  GetMT and the size calculation then never
+         * touch the target for this object.  Best effort: a zero method
+         * table is ignored so the normal read path can report the corruption.
+         * Params:
+         *   mt - the object's method table pointer as stored in the object
+         *        (low bits are masked here)
+         *   numComponents - the raw component count stored in the object;
+         *                   ignored for non-array types
+         */
+        void SeedHeader(TADDR mt, DWORD numComponents) const;
+
         /* Returns the component method table of the object.  For example, if
          * this object is an array, the method table will be the general array
          * MT.  Calling this function tells you what type of objects can be
@@ -360,6 +370,55 @@ namespace sos
          */
         size_t GetSize() const;
 
+        /* The common case of GetSize, kept inline for the heap walk: the
+         * size is already memoized, or the header was seeded out of the
+         * read-ahead window and the method table has been sized before, so
+         * the answer is a probe and a multiply with no call into the sizing
+         * machinery.  Returns false when sizing needs the target (unseeded
+         * header, first sight of the method table); GetSize covers those and
+         * reports corruption.
+         */
+        bool TryGetSizeInline(size_t &size) const
+        {
+            if (mSize != (size_t)~0)
+            {
+                size = mSize;
+                return true;
+            }
+
+            if (mMT == NULL || mNumComponents == (DWORD)~0)
+                return false;
+
+            MethodTableInfo *info = g_special_mtCache.Find((DWORD_PTR)mMT);
+            if (info == NULL || !info->IsInitialized())
+                return false;
+
+            size_t s = info->BaseSize;
+            if (info->ComponentSize)
+            {
+                // A string's component count leaves out the trailing NULL;
+                // GetNumComponents adds it back, so match it here.
+                DWORD components = mNumComponents;
+                if (mMT == TO_TADDR(g_special_usefulGlobals.StringMethodTable))
+                    components++;
+
+                s += (size_t)info->ComponentSize * components;
+            }
+
+            // On x64 we do an optimization to save 4 bytes in almost every string we create.
+        #ifdef _WIN64
+            // Pad to min object size if necessary
+            if (s < min_obj_size)
+                s = min_obj_size;
+        #endif // _WIN64
+
+            mSize = s;
+            mPointers = info->bContainsPointers != FALSE;
+
+            size = s;
+            return true;
+        }
+
         /* Returns true if this object contains pointers to other objects.
          * Throws:
          *   DataRead - if we failed to read out of the object's method table.
@@ -440,8 +499,9 @@ namespace sos
         mutable TADDR mMT;
         mutable size_t mSize;
         mutable bool mPointers;
+        mutable DWORD mNumComponents;   // seeded by SeedHeader; ~0 means unread
         mutable DacpMethodTableData *mMTData;
-        mutable WCHAR *mTypeName;
+        mutable const WCHAR *mTypeName;
     };
 
     /* Enumerates all the GC references (objects) contained in an object.  This uses the GCDesc
@@ -572,6 +632,15 @@ namespace sos
             return bLarge;
         }
 
+        /* Returns the index of the heap the current object lives on.  The
+         * index matches GCHeap::GetHeapDetails.
+         */
+        inline int GetCurrHeap() const
+        {
+            SOS_Assert(*this);
+            return mCurrHeap;
+        }
+
         /* Verifies the current object.  Returns true if the current object is valid.
          * Returns false and fills 'buffer' with the reason the object is corrupted.
          * This is a deeper validation than Object::IsValid as it checks the card
@@ -622,6 +691,20 @@ namespace sos
         bool CheckSegmentRange();
         void MoveToNextObject();
 
+        /* The reader stage of the walk: returns a pointer to a buffered copy
+         * of [addr, addr+size), fetching the next run of segment memory with
+         * a single request when the walk crosses the buffered window.
+         * Returns NULL if the range could not be buffered; the caller falls
+         * back to the per-object read path.
+         */
+        const BYTE *ReadAhead(TADDR addr, size_t size);
+
+        /* Hands the current object its header fields out of the read-ahead
+         * buffer, so consuming it never stalls on a per-object read.  Best
+         * effort; a miss leaves the object to decode itself.
+         */
+        void SeedCurrObject();
+
     private:
         DacpHeapSegmentData mSegment;
         bool bLarge;
@@ -631,6 +714,13 @@ namespace sos
         const DacpGcHeapDetails *mHeaps;
         int mNumHeaps;
         int mCurrHeap;
+
+        // Reader-stage state: one large read buffers a window of the current
+        // segment ahead of the decode (see ReadAhead).
+        ArrayHolder<BYTE> mChunk;
+        TADDR mChunkStart;
+        size_t mChunkValid;
+        bool mChunkFailed;      // allocation failed; stop trying
     };
 
     /* Reprensents an entry in the sync block table.
@@ -778,6 +868,22 @@ namespace sos
          */
         bool AreGCStructuresValid() const;
 
+        /* Returns the number of GC heaps in the process (1 unless the target
+         * uses server GC).
+         */
+        inline int GetNumHeaps() const
+        {
+            return mNumHeaps;
+        }
+
+        /* Returns the DAC heap details for the given heap index.
+         */
+        inline const DacpGcHeapDetails &GetHeapDetails(int heap) const
+        {
+            SOS_Assert(heap >= 0 && heap < mNumHeaps);
+            return mHeaps[heap];
+        }
+
     private:
         DacpGcHeapDetails *mHeaps;
         DacpGcHeapData mHeapData;
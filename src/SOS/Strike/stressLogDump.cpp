@@ -10,8 +10,10 @@
 
 #include "strike.h"
 #include "util.h"
-#include <stdio.h>      
+#include <stdio.h>
 #include <ctype.h>
+#include <string>
+#include <unordered_map>
 
 #ifndef STRESS_LOG
 #define STRESS_LOG
@@ -309,12 +311,88 @@ vDoOut(BOOL bToConsole, FILE* file, PCSTR Format, ...)
 
 
 /*********************************************************************************/
-HRESULT StressLog::Dump(ULONG64 outProcLog, const char* fileName, struct IDebugDataSpaces* memCallBack) 
+/* The dump merges the per-thread circular buffers by repeatedly taking the      */
+/* log whose next unread message has the latest timestamp.  Rescanning every    */
+/* thread log for each message (FindLatestThreadLog) is O(messages * threads),  */
+/* so the merge is driven by a binary max-heap keyed on the timestamp under     */
+/* each log's readPtr instead.  Only logs with an unread message live in the    */
+/* heap; order among identical timestamps is unspecified either way.            */
+
+static void SiftDownThreadLogHeap(ThreadStressLog** heap, int count, int i)
+{
+    for (;;)
+    {
+        int largest = i;
+        int child = 2 * i + 1;
+        if (child < count && heap[child]->readPtr->timeStamp > heap[largest]->readPtr->timeStamp)
+            largest = child;
+        child++;
+        if (child < count && heap[child]->readPtr->timeStamp > heap[largest]->readPtr->timeStamp)
+            largest = child;
+        if (largest == i)
+            return;
+        ThreadStressLog* temp = heap[i];
+        heap[i] = heap[largest];
+        heap[largest] = temp;
+        i = largest;
+    }
+}
+
+static int BuildThreadLogHeap(ThreadStressLog** heap, ThreadStressLog* logs)
+{
+    int count = 0;
+    for (ThreadStressLog* ptr = logs; ptr != NULL; ptr = ptr->next)
+    {
+        if (ptr->readPtr != NULL)
+            heap[count++] = ptr;
+    }
+    for (int i = count / 2 - 1; i >= 0; i--)
+        SiftDownThreadLogHeap(heap, count, i);
+    return count;
+}
+
+/*********************************************************************************/
+/* '!dumplog -binary' file layout: one StressLogBinaryHeader, then RecordCount  */
+/* StressLogBinaryRecord entries in dump order (newest message first, same as  */
+/* the text output), then a string table resolving each record's FormatId: a   */
+/* ULONG32 entry count followed by {ULONG64 FormatId, ULONG32 Length, Length   */
+/* bytes of format string, no terminator} triples.  All fields are written in  */
+/* the host's byte order.  FormatId is the format string's address in the      */
+/* target; args are stored raw, so %s-style arguments remain target addresses. */
+
+struct StressLogBinaryHeader
+{
+    char     Magic[4];          // "SLB1"
+    ULONG32  PointerSize;       // of the target process
+    ULONG64  RecordCount;
+    ULONG64  StringTableOffset; // from the start of the file
+    ULONG64  StartTimeStamp;    // pair with TickFrequency to recover seconds
+    ULONG64  TickFrequency;
+    FILETIME StartTime;
+};
+
+struct StressLogBinaryRecord
+{
+    ULONG64 TimeStamp;
+    ULONG64 FormatId;
+    ULONG64 Facility;
+    ULONG32 ThreadId;
+    ULONG32 NumberOfArgs;
+    ULONG64 Args[StressMsg::maxArgCnt];
+};
+
+/*********************************************************************************/
+HRESULT StressLog::Dump(ULONG64 outProcLog, const char* fileName, struct IDebugDataSpaces* memCallBack, const DumpFilter* pFilter, BOOL bBinary)
 {
     ULONG64 g_hThisInst;
     BOOL    bDoGcHist = (fileName == NULL);
     FILE*   file = NULL;
 
+    // A handful of format strings account for nearly all messages; fetch
+    // each unique format pointer from the target once and replay the local
+    // copy instead of paying a target read per message.
+    std::unordered_map<ULONG64, std::string> formatCache;
+
     // Fetch the circular buffer bookkeeping data 
     StressLog inProcLog;
     HRESULT hr = memCallBack->ReadVirtual(UL64_TO_CDA(outProcLog), &inProcLog, sizeof(StressLog), 0);
@@ -342,6 +420,8 @@ HRESULT StressLog::Dump(ULONG64 outProcLog, const char* fileName, struct IDebugD
     }
     // Fetch the circular buffers for each thread into the 'logs' list
     ThreadStressLog* logs = 0;
+    ThreadStressLog** logHeap = NULL;
+    int logHeapCount = 0;
 
     CLRDATA_ADDRESS outProcPtr = TO_CDADDR(inProcLog.logs.Load());
     ThreadStressLog* inProcPtr;
@@ -358,6 +438,17 @@ HRESULT StressLog::Dump(ULONG64 outProcLog, const char* fileName, struct IDebugD
             goto FREE_MEM;
         }
 
+        if (pFilter != NULL && pFilter->threadId != 0 && inProcPtr->threadId != pFilter->threadId)
+        {
+            // Filtered out: skip the whole chain without fetching its chunks.
+            // chunkListHead still holds the out-of-process value; NULL it to
+            // avoid AVs in the destructor.
+            outProcPtr = TO_CDADDR(inProcPtr->next);
+            inProcPtr->chunkListHead = NULL;
+            delete inProcPtr;
+            continue;
+        }
+
         CLRDATA_ADDRESS outProcListHead = TO_CDADDR(inProcPtr->chunkListHead);
         CLRDATA_ADDRESS outProcChunkPtr = outProcListHead;
         StressLogChunk ** chunksPtr = &inProcPtr->chunkListHead;
@@ -424,14 +515,34 @@ HRESULT StressLog::Dump(ULONG64 outProcLog, const char* fileName, struct IDebugD
         threadCtr++;
     }
 
-    if (!bDoGcHist && ((file = fopen(fileName, "w")) == NULL))
+    if (threadCtr > 0)
+    {
+        logHeap = new ThreadStressLog*[threadCtr];
+        if (logHeap == NULL)
+        {
+            hr = E_OUTOFMEMORY;
+            goto FREE_MEM;
+        }
+        logHeapCount = BuildThreadLogHeap(logHeap, logs);
+    }
+
+    if (!bDoGcHist && ((file = fopen(fileName, bBinary ? "wb" : "w")) == NULL))
     {
         hr = GetLastError();
         goto FREE_MEM;
     }
     hr = S_FALSE;       // return false if there are no message to print to the log
 
-    vDoOut(bDoGcHist, file, "STRESS LOG:\n"
+    if (bBinary)
+    {
+        // Reserve space for the header; the record count and the string table
+        // offset are only known once the dump completes, so it is rewritten
+        // at the end.
+        StressLogBinaryHeader zeroHeader = {0};
+        fwrite(&zeroHeader, sizeof(zeroHeader), 1, file);
+    }
+
+    vDoOut(bDoGcHist || bBinary, file, "STRESS LOG:\n"
               "    facilitiesToLog  = 0x%x\n"
               "    levelToLog       = %d\n"
               "    MaxLogSizePerThread = 0x%x (%d)\n"
@@ -447,12 +558,12 @@ HRESULT StressLog::Dump(ULONG64 outProcLog, const char* fileName, struct IDebugD
     toInt64(endTime) = toInt64(inProcLog.startTime) + ((__int64) (totalSecs * 1.0E7));
 
     WCHAR timeBuff[64];
-    vDoOut(bDoGcHist, file, "    Clock frequency  = %5.3f GHz\n", inProcLog.tickFrequency / 1.0E9);
-    vDoOut(bDoGcHist, file, "    Start time         %S\n", getTime(&inProcLog.startTime, timeBuff, 64));
-    vDoOut(bDoGcHist, file, "    Last message time  %S\n", getTime(&endTime, timeBuff, 64));
-    vDoOut(bDoGcHist, file, "    Total elapsed time %5.3f sec\n", totalSecs);
+    vDoOut(bDoGcHist || bBinary, file, "    Clock frequency  = %5.3f GHz\n", inProcLog.tickFrequency / 1.0E9);
+    vDoOut(bDoGcHist || bBinary, file, "    Start time         %S\n", getTime(&inProcLog.startTime, timeBuff, 64));
+    vDoOut(bDoGcHist || bBinary, file, "    Last message time  %S\n", getTime(&endTime, timeBuff, 64));
+    vDoOut(bDoGcHist || bBinary, file, "    Total elapsed time %5.3f sec\n", totalSecs);
 
-    if (!bDoGcHist)
+    if (!bDoGcHist && !bBinary)
     {
         fprintf(file, "\nTHREAD  TIMESTAMP     FACILITY                              MESSAGE\n");
         fprintf(file, "  ID  (sec from start)\n");
@@ -463,13 +574,13 @@ HRESULT StressLog::Dump(ULONG64 outProcLog, const char* fileName, struct IDebugD
     void** args;
     unsigned msgCtr;
     msgCtr = 0;
-    for (;;) 
+    for (;;)
     {
-        ThreadStressLog* latestLog = logs->FindLatestThreadLog();
+        ThreadStressLog* latestLog = (logHeapCount > 0) ? logHeap[0] : NULL;
 
-        if (IsInterrupt()) 
+        if (IsInterrupt())
         {
-            vDoOut(bDoGcHist, file, "----- Interrupted by user -----\n");
+            vDoOut(bDoGcHist || bBinary, file, "----- Interrupted by user -----\n");
             break;
         }
 
@@ -479,48 +590,123 @@ HRESULT StressLog::Dump(ULONG64 outProcLog, const char* fileName, struct IDebugD
         }
 
         StressMsg* latestMsg = latestLog->readPtr;
-        if (latestMsg->formatOffset != 0 && !latestLog->CompletedDump()) 
+        if (latestMsg->formatOffset != 0 && !latestLog->CompletedDump())
         {
+            double deltaTime = ((double) (latestMsg->timeStamp - inProcLog.startTimeStamp)) / inProcLog.tickFrequency;
+
+            // Messages pop out newest first, so once one falls below the
+            // lower time bound everything still queued is older yet.
+            if (pFilter != NULL && pFilter->afterSecs >= 0 && deltaTime < pFilter->afterSecs)
+            {
+                break;
+            }
+
+            BOOL fIncludeMessage = TRUE;
+            if (pFilter != NULL)
+            {
+                if (pFilter->facilityMask != 0 && (latestMsg->facility & pFilter->facilityMask) == 0)
+                    fIncludeMessage = FALSE;
+                if (pFilter->beforeSecs >= 0 && deltaTime > pFilter->beforeSecs)
+                    fIncludeMessage = FALSE;
+            }
+
             TADDR taFmt = (latestMsg->formatOffset) + TO_TADDR(g_hThisInst);
-            hr = memCallBack->ReadVirtual(TO_CDADDR(taFmt), format, 256, 0);
-            if (hr != S_OK) 
-                strcpy_s(format, _countof(format), "Could not read address of format string");
+            std::unordered_map<ULONG64, std::string>::const_iterator cachedFormat = formatCache.find(taFmt);
+            if (cachedFormat != formatCache.end())
+            {
+                strcpy_s(format, _countof(format), cachedFormat->second.c_str());
+            }
+            else
+            {
+                hr = memCallBack->ReadVirtual(TO_CDADDR(taFmt), format, 256, 0);
+                if (hr != S_OK)
+                    strcpy_s(format, _countof(format), "Could not read address of format string");
+
+                // formatOutput scribbles on the buffer, so remember the
+                // pristine copy.
+                formatCache[taFmt] = format;
+            }
 
-            double deltaTime = ((double) (latestMsg->timeStamp - inProcLog.startTimeStamp)) / inProcLog.tickFrequency;
             if (bDoGcHist)
             {
                 if (strcmp(format, ThreadStressLog::TaskSwitchMsg()) == 0)
                 {
                     latestLog->threadId = (unsigned)(size_t)latestMsg->args[0];
                 }
-                GcHistAddLog(format, latestMsg);                                
+                if (fIncludeMessage)
+                {
+                    GcHistAddLog(format, latestMsg);
+                }
+            }
+            else if (bBinary)
+            {
+                // Raw export: no formatting, no argument resolution.  The
+                // record is written before any task switch takes effect so
+                // its thread attribution matches the text output's.
+                if (fIncludeMessage)
+                {
+                    StressLogBinaryRecord record;
+                    record.TimeStamp = latestMsg->timeStamp;
+                    record.FormatId = taFmt;
+                    record.Facility = latestMsg->facility;
+                    record.ThreadId = (ULONG32)latestLog->threadId;
+                    record.NumberOfArgs = latestMsg->numberOfArgs;
+                    for (unsigned iArg = 0; iArg < StressMsg::maxArgCnt; iArg++)
+                    {
+                        record.Args[iArg] = (iArg < latestMsg->numberOfArgs) ? (ULONG64)(size_t)latestMsg->args[iArg] : 0;
+                    }
+                    fwrite(&record, sizeof(record), 1, file);
+                }
+                if (strcmp(format, ThreadStressLog::TaskSwitchMsg()) == 0)
+                {
+                    latestLog->threadId = (unsigned)(size_t)latestMsg->args[0];
+                }
             }
             else
             {
                 if (strcmp(format, ThreadStressLog::TaskSwitchMsg()) == 0)
                 {
-                    fprintf (file, "Task was switched from %x\n", (unsigned)(size_t)latestMsg->args[0]);
+                    // Keep the thread attribution current even when the
+                    // message itself is filtered out.
+                    if (fIncludeMessage)
+                    {
+                        fprintf (file, "Task was switched from %x\n", (unsigned)(size_t)latestMsg->args[0]);
+                    }
                     latestLog->threadId = (unsigned)(size_t)latestMsg->args[0];
                 }
-                else 
+                else if (fIncludeMessage)
                 {
                     args = latestMsg->args;
                     formatOutput(memCallBack, file, format, (unsigned)latestLog->threadId, deltaTime, latestMsg->facility, args);
                 }
             }
-            msgCtr++;
+            if (fIncludeMessage)
+            {
+                msgCtr++;
+            }
         }
 
         latestLog->readPtr = latestLog->AdvanceRead();
         if (latestLog->CompletedDump())
         {
             latestLog->readPtr = NULL;
-            if (!bDoGcHist)
+            if (!bDoGcHist && !bBinary)
             {
                 fprintf(file, "------------ Last message from thread %x -----------\n", latestLog->threadId);
             }
         }
 
+        // Re-key the top of the heap: a log's messages only move backward in
+        // time as it is read, so sifting down restores the heap property.
+        if (latestLog->readPtr == NULL)
+        {
+            logHeap[0] = logHeap[--logHeapCount];
+        }
+        if (logHeapCount > 0)
+        {
+            SiftDownThreadLogHeap(logHeap, logHeapCount, 0);
+        }
+
         if (msgCtr % 64 == 0) 
         {
             ExtOut(".");        // to indicate progress
@@ -530,13 +716,42 @@ HRESULT StressLog::Dump(ULONG64 outProcLog, const char* fileName, struct IDebugD
     }
     ExtOut("\n");
 
-    vDoOut(bDoGcHist, file, "---------------------------- %d total entries ------------------------------------\n", msgCtr);
+    vDoOut(bDoGcHist || bBinary, file, "---------------------------- %d total entries ------------------------------------\n", msgCtr);
     if (!bDoGcHist)
     {
+        if (bBinary)
+        {
+            // Append the string table, then go back and fill in the header.
+            // Every format string the dump touched is in the cache, so the
+            // table covers every FormatId that was written.
+            ULONG32 stringCount = (ULONG32)formatCache.size();
+            fwrite(&stringCount, sizeof(stringCount), 1, file);
+            for (std::unordered_map<ULONG64, std::string>::const_iterator itr = formatCache.begin(); itr != formatCache.end(); ++itr)
+            {
+                ULONG64 formatId = itr->first;
+                ULONG32 length = (ULONG32)itr->second.size();
+                fwrite(&formatId, sizeof(formatId), 1, file);
+                fwrite(&length, sizeof(length), 1, file);
+                fwrite(itr->second.data(), 1, length, file);
+            }
+
+            StressLogBinaryHeader binHeader;
+            memcpy(binHeader.Magic, "SLB1", sizeof(binHeader.Magic));
+            binHeader.PointerSize = sizeof(void*);  // host == target; see the TODO on formatOutput
+            binHeader.RecordCount = msgCtr;
+            binHeader.StringTableOffset = sizeof(binHeader) + (ULONG64)msgCtr * sizeof(StressLogBinaryRecord);
+            binHeader.StartTimeStamp = inProcLog.startTimeStamp;
+            binHeader.TickFrequency = inProcLog.tickFrequency;
+            binHeader.StartTime = inProcLog.startTime;
+            fseek(file, 0, SEEK_SET);
+            fwrite(&binHeader, sizeof(binHeader), 1, file);
+        }
         fclose(file);
     }
 
 FREE_MEM:
+    delete [] logHeap;
+
     // clean up the 'logs' list
     while (logs) {
         ThreadStressLog* temp = logs;
@@ -88,6 +88,10 @@
 
 #include "strike.h"
 #include "sos.h"
+#include "heapwalk.h"
+#include "taskpool.h"
+#include "radixsort.h"
+#include "scankernels.h"
 
 #ifndef STRESS_LOG
 #define STRESS_LOG
@@ -714,7 +718,8 @@ DECLARE_API(DumpStackObjects)
     }
 
     EnableDMLHolder enableDML(dml);
-    
+    BufferedOutputHolder bufferedOutput;
+
     return DumpStackObjectsRaw(nArg, exprBottom.data, exprTop.data, bVerify);
 }
 
@@ -1364,12 +1369,20 @@ DECLARE_API(DumpMT)
 
         table.WriteRow("Entry", "MethodDesc", "JIT", "Name");
 
-        for (DWORD n = 0; n < vMethTable.wNumMethods; n++)
+        // Generic-heavy types repeat the same entry across many slots
+        // (methods inherited from the parent MT and shared generic code),
+        // so resolve each distinct entry once and replay it after that;
+        // every resolution is a handful of DAC requests plus a name lookup.
+        struct ResolvedSlot
         {
-            JITTypes jitType;
-            DWORD_PTR methodDesc=0;
-            DWORD_PTR gcinfoAddr;
+            DWORD_PTR MethodDesc;
+            const char* JitType;
+            std::wstring Name;
+        };
+        std::unordered_map<CLRDATA_ADDRESS, ResolvedSlot> resolved;
 
+        for (DWORD n = 0; n < vMethTable.wNumMethods; n++)
+        {
             CLRDATA_ADDRESS entry;
             if (g_sos->GetMethodTableSlot(dwStartAddr, n, &entry) != S_OK)
             {
@@ -1377,48 +1390,64 @@ DECLARE_API(DumpMT)
                 continue;
             }
 
-            IP2MethodDesc((DWORD_PTR)entry, methodDesc, jitType, gcinfoAddr);
-            table.WriteColumn(0, entry);
-            table.WriteColumn(1, MethodDescPtr(methodDesc));
-
-            if (jitType == TYPE_UNKNOWN && methodDesc != NULL)
-            {
-                // We can get a more accurate jitType from NativeCodeAddr of the methoddesc,
-                // because the methodtable entry hasn't always been patched.
-                DacpMethodDescData tmpMethodDescData;
-                if (tmpMethodDescData.Request(g_sos, TO_CDADDR(methodDesc)) == S_OK)
-                {
-                    DacpCodeHeaderData codeHeaderData;                        
-                    if (codeHeaderData.Request(g_sos,tmpMethodDescData.NativeCodeAddr) == S_OK)
-                    {        
-                        jitType = (JITTypes) codeHeaderData.JITType;
-                    }
-                }
-            }
-
-            const char *pszJitType = "NONE";
-            if (jitType == TYPE_JIT)
-                pszJitType = "JIT";
-            else if (jitType == TYPE_PJIT)
-                pszJitType = "PreJIT";
-            else
+            std::unordered_map<CLRDATA_ADDRESS, ResolvedSlot>::iterator itr = resolved.find(entry);
+            if (itr == resolved.end())
             {
-                DacpMethodDescData MethodDescData;
-                if (MethodDescData.Request(g_sos, TO_CDADDR(methodDesc)) == S_OK)
+                JITTypes jitType;
+                DWORD_PTR methodDesc=0;
+                DWORD_PTR gcinfoAddr;
+
+                IP2MethodDesc((DWORD_PTR)entry, methodDesc, jitType, gcinfoAddr);
+
+                const char *pszJitType = "NONE";
+                if (jitType == TYPE_JIT)
+                    pszJitType = "JIT";
+                else if (jitType == TYPE_PJIT)
+                    pszJitType = "PreJIT";
+                else if (methodDesc != NULL)
                 {
-                    // Is it an fcall?
-                    if ((TO_TADDR(MethodDescData.NativeCodeAddr) >=  TO_TADDR(g_moduleInfo[MSCORWKS].baseAddr)) &&
-                        ((TO_TADDR(MethodDescData.NativeCodeAddr) <  TO_TADDR(g_moduleInfo[MSCORWKS].baseAddr + g_moduleInfo[MSCORWKS].size))))
+                    // One method desc request serves both the jit type
+                    // refinement and the fcall check below.
+                    DacpMethodDescData MethodDescData;
+                    if (MethodDescData.Request(g_sos, TO_CDADDR(methodDesc)) == S_OK)
                     {
-                        pszJitType = "FCALL";
+                        if (jitType == TYPE_UNKNOWN)
+                        {
+                            // We can get a more accurate jitType from NativeCodeAddr of the methoddesc,
+                            // because the methodtable entry hasn't always been patched.
+                            DacpCodeHeaderData codeHeaderData;
+                            if (codeHeaderData.Request(g_sos, MethodDescData.NativeCodeAddr) == S_OK)
+                            {
+                                jitType = (JITTypes) codeHeaderData.JITType;
+                            }
+                        }
+
+                        if (jitType == TYPE_JIT)
+                            pszJitType = "JIT";
+                        else if (jitType == TYPE_PJIT)
+                            pszJitType = "PreJIT";
+                        // Is it an fcall?
+                        else if ((TO_TADDR(MethodDescData.NativeCodeAddr) >=  TO_TADDR(g_moduleInfo[MSCORWKS].baseAddr)) &&
+                            ((TO_TADDR(MethodDescData.NativeCodeAddr) <  TO_TADDR(g_moduleInfo[MSCORWKS].baseAddr + g_moduleInfo[MSCORWKS].size))))
+                        {
+                            pszJitType = "FCALL";
+                        }
                     }
                 }
+
+                NameForMD_s(methodDesc,g_mdName,mdNameLen);
+
+                ResolvedSlot slot;
+                slot.MethodDesc = methodDesc;
+                slot.JitType = pszJitType;
+                slot.Name = g_mdName;
+                itr = resolved.insert(std::make_pair(entry, slot)).first;
             }
 
-            table.WriteColumn(2, pszJitType);
-            
-            NameForMD_s(methodDesc,g_mdName,mdNameLen);                        
-            table.WriteColumn(3, g_mdName);
+            table.WriteColumn(0, entry);
+            table.WriteColumn(1, MethodDescPtr(itr->second.MethodDesc));
+            table.WriteColumn(2, itr->second.JitType);
+            table.WriteColumn(3, itr->second.Name.c_str());
         }
     }
     return Status;    
@@ -1772,10 +1801,208 @@ HRESULT PrintPermissionSet (TADDR p_PermSet)
 
 #endif // _DEBUG
 
+// Scans one block of element data, accumulating the zero count, the value
+// range and the bounded histogram.  One instantiation per element width
+// keeps the hot loop a straight scan over the buffer.
+template <class T>
+static void ArrayStatsScan(const BYTE *data, size_t n, ULONG64 &zeroCount,
+                           ULONG64 &minVal, ULONG64 &maxVal, bool &haveMinMax,
+                           std::unordered_map<ULONG64, size_t> &hist, bool &histFull,
+                           size_t maxBuckets)
+{
+    const T *values = (const T *)data;
+    for (size_t i = 0; i < n; i++)
+    {
+        ULONG64 value = (ULONG64)values[i];
+        if (value == 0)
+        {
+            zeroCount++;
+            continue;
+        }
+
+        if (!haveMinMax)
+        {
+            minVal = maxVal = value;
+            haveMinMax = true;
+        }
+        else
+        {
+            if (value < minVal)
+                minVal = value;
+            if (value > maxVal)
+                maxVal = value;
+        }
+
+        // Once the table is full, existing buckets keep counting so the top
+        // values stay accurate; only new distinct values go untracked.
+        std::unordered_map<ULONG64, size_t>::iterator itr = hist.find(value);
+        if (itr != hist.end())
+            itr->second++;
+        else if (hist.size() < maxBuckets)
+            hist.insert(std::make_pair(value, (size_t)1));
+        else
+            histFull = true;
+    }
+}
+
+static bool ArrayStatsBucketCompare(const std::pair<ULONG64, size_t> &a1, const std::pair<ULONG64, size_t> &a2)
+{
+    return a1.second > a2.second;
+}
+
+/**********************************************************************\
+* Summarizes an array's contents without printing its elements: the    *
+* element range is pulled with large block reads and scanned into a    *
+* bounded value histogram, so a 10M-element cache array is answered    *
+* with null counts, value range and the most frequent values instead   *
+* of 10M lines of output.                                              *
+\**********************************************************************/
+static HRESULT PrintArrayStats(DacpObjectData& objData, DumpArrayFlags& flags)
+{
+    HRESULT Status = S_OK;
+
+    if (objData.dwRank != 1)
+    {
+        ExtOut("-stats is only supported for single-dimension arrays\n");
+        return S_OK;
+    }
+
+    NameForMT_s(TO_TADDR(objData.ElementTypeHandle), g_mdName, mdNameLen);
+    ExtOut("Name:        %S[]\n", g_mdName);
+    ExtOut("Array:       Number of elements %" POINTERSIZE_TYPE "d, Type %s\n",
+           (DWORD_PTR)objData.dwNumComponents, ElementTypeName(objData.ElementType));
+
+    size_t total = (size_t)objData.dwNumComponents;
+    size_t start = flags.startIndex > total ? total : (size_t)flags.startIndex;
+    size_t count = total - start;
+    if (flags.Length != (DWORD_PTR)-1 && (size_t)flags.Length < count)
+        count = (size_t)flags.Length;
+
+    if (count == 0)
+    {
+        ExtOut("No elements in the requested range\n");
+        return S_OK;
+    }
+
+    BOOL isRef = !IsElementValueType(objData.ElementType);
+    DWORD compSize = isRef ? sizeof(TADDR) : objData.dwComponentSize;
+
+    if (compSize != 1 && compSize != 2 && compSize != 4 && compSize != 8)
+    {
+        ExtOut("-stats supports reference arrays and primitive elements of 1, 2, 4 or 8 bytes;\n");
+        ExtOut("this array's element size is %d bytes\n", objData.dwComponentSize);
+        return S_OK;
+    }
+
+    // Exact for narrow elements (the whole byte/char value space fits), a
+    // cap on distinct values for wide ones.
+    const size_t kMaxBuckets = 0x10000;
+    std::unordered_map<ULONG64, size_t> hist;
+    bool histFull = false;
+
+    ULONG64 zeroCount = 0, minVal = 0, maxVal = 0;
+    bool haveMinMax = false;
+
+    const size_t kChunkBytes = 0x100000;
+    ArrayHolder<BYTE> buffer = new NOTHROW BYTE[kChunkBytes];
+    if (buffer == NULL)
+    {
+        ReportOOM();
+        return Status;
+    }
+
+    TADDR addr = TO_TADDR(objData.ArrayDataPtr) + start * compSize;
+    size_t bytesLeft = count * compSize;
+    size_t processed = 0;
+
+    while (bytesLeft > 0)
+    {
+        if (IsInterrupt())
+        {
+            ExtOut("interrupted by user\n");
+            return S_OK;
+        }
+
+        ULONG chunk = (ULONG)(bytesLeft < kChunkBytes ? bytesLeft : kChunkBytes);
+        ULONG fetched = 0;
+        if (FAILED(g_ExtData->ReadVirtual(TO_CDADDR(addr), buffer, chunk, &fetched)) || fetched < compSize)
+        {
+            ExtOut("Failed to read array data at %p\n", SOS_PTR(addr));
+            return S_OK;
+        }
+        fetched -= fetched % compSize;
+
+        size_t n = fetched / compSize;
+        switch (compSize)
+        {
+            case 1: ArrayStatsScan<BYTE>(buffer, n, zeroCount, minVal, maxVal, haveMinMax, hist, histFull, kMaxBuckets); break;
+            case 2: ArrayStatsScan<WORD>(buffer, n, zeroCount, minVal, maxVal, haveMinMax, hist, histFull, kMaxBuckets); break;
+            case 4: ArrayStatsScan<DWORD>(buffer, n, zeroCount, minVal, maxVal, haveMinMax, hist, histFull, kMaxBuckets); break;
+            case 8: ArrayStatsScan<ULONG64>(buffer, n, zeroCount, minVal, maxVal, haveMinMax, hist, histFull, kMaxBuckets); break;
+        }
+
+        processed += n;
+        addr += fetched;
+        bytesLeft -= fetched;
+
+        // A short read means the rest of the range is unmapped.
+        if (fetched < chunk)
+            break;
+    }
+
+    if (processed == 0)
+    {
+        ExtOut("No elements could be read\n");
+        return S_OK;
+    }
+
+    ExtOut("\nStatistics for %I64u element(s) starting at index %I64u:\n", (ULONG64)processed, (ULONG64)start);
+    ExtOut("%s: %I64u (%.1f%%)\n", isRef ? "Null references" : "Zero values",
+           zeroCount, 100.0 * (double)zeroCount / (double)processed);
+    ExtOut("Distinct non-%s values: %s%I64u\n", isRef ? "null" : "zero",
+           histFull ? "more than " : "", (ULONG64)hist.size());
+    if (!isRef && haveMinMax)
+        ExtOut("Range (unsigned): 0x%I64x - 0x%I64x\n", minVal, maxVal);
+
+    if (hist.empty())
+        return S_OK;
+
+    // The most frequent values; for reference arrays each is an object, so
+    // resolve its type for the exemplar.
+    std::vector<std::pair<ULONG64, size_t> > buckets(hist.begin(), hist.end());
+    size_t top = buckets.size() < 10 ? buckets.size() : 10;
+    std::partial_sort(buckets.begin(), buckets.begin() + top, buckets.end(), ArrayStatsBucketCompare);
+
+    ExtOut("\nMost frequent values:\n");
+    for (size_t i = 0; i < top; i++)
+    {
+        if (IsInterrupt())
+            break;
+
+        if (isRef)
+        {
+            TADDR mt = 0;
+            if (SafeReadMemory(TO_TADDR(buckets[i].first), &mt, sizeof(mt), NULL) && mt != 0)
+                NameForMT_s(mt & ~3, g_mdName, mdNameLen);
+            else
+                swprintf_s(g_mdName, mdNameLen, W("<unreadable object>"));
+
+            DMLOut("%s %8I64u %S\n", DMLObject(buckets[i].first), (ULONG64)buckets[i].second, g_mdName);
+        }
+        else
+        {
+            ExtOut("0x%016I64x %8I64u (%.1f%%)\n", buckets[i].first, (ULONG64)buckets[i].second,
+                   100.0 * (double)buckets[i].second / (double)processed);
+        }
+    }
+
+    return S_OK;
+}
+
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
-*    This function is called to dump the contents of an object from a  *  
+*    This function is called to dump the contents of an object from a  *
 *    given address
 *                                                                      *
 \**********************************************************************/
@@ -1795,6 +2022,7 @@ DECLARE_API(DumpArray)
         {"-length", &flags.Length, COSIZE_T, TRUE},
         {"-details", &flags.bDetail, COBOOL, FALSE},
         {"-nofields", &flags.bNoFieldsForElement, COBOOL, FALSE},
+        {"-stats", &flags.bStats, COBOOL, FALSE},
 #ifndef FEATURE_PAL
         {"/d", &dml, COBOOL, FALSE},
 #endif
@@ -1834,6 +2062,11 @@ DECLARE_API(DumpArray)
         ExtOut("Not an array, please use !DumpObj instead\n");
         return S_OK;
     }
+
+    if (flags.bStats)
+    {
+        return PrintArrayStats(objData, flags);
+    }
     return PrintArray(objData, flags, FALSE);
 }
 
@@ -2157,13 +2390,16 @@ DECLARE_API(DumpDelegate)
                                         objData.ObjectType == OBJ_ARRAY &&
                                         invocationCount <= objData.dwNumComponents)
                                     {
-                                        for (int i = 0; i < invocationCount; i++)
+                                        std::vector<DWORD_PTR> elements(invocationCount);
+                                        if (SUCCEEDED(moveArray(elements.data(), TO_TADDR(objData.ArrayDataPtr), elements.size())))
                                         {
-                                            CLRDATA_ADDRESS elementPtr;
-                                            MOVE(elementPtr, TO_CDADDR(objData.ArrayDataPtr + (i * objData.dwComponentSize)));
-                                            if (elementPtr != NULL && sos::IsObject(elementPtr, false))
+                                            for (int i = 0; i < invocationCount; i++)
                                             {
-                                                delegatesRemaining.push_back(elementPtr);
+                                                CLRDATA_ADDRESS elementPtr = TO_CDADDR(elements[i]);
+                                                if (elementPtr != NULL && sos::IsObject(elementPtr, false))
+                                                {
+                                                    delegatesRemaining.push_back(elementPtr);
+                                                }
                                             }
                                         }
                                     }
@@ -2409,11 +2645,32 @@ size_t FormatGeneratedException (DWORD_PTR dataPtr,
         // will have that frame.
         count--;
     }
-    
+
+    // Read the whole element array in one block; reading it entry by entry
+    // issued a target round trip per frame, twice per trace (once to size
+    // the output, once to fill it).
+    ArrayHolder<StackTraceElement> elements = new NOTHROW StackTraceElement[count];
+    if (elements == NULL)
+    {
+        return 0;
+    }
+
+    if (FAILED(MOVEBLOCK(elements[0], dataPtr, count * sizeof(StackTraceElement))))
+    {
+        // The block read fails if any page under the array is unreadable;
+        // fall back to per-element reads to salvage what we can.
+        for (UINT i = 0; i < count; i++)
+        {
+            if (FAILED(MOVE(elements[i], dataPtr + i*sizeof(StackTraceElement))))
+            {
+                memset(&elements[i], 0, sizeof(StackTraceElement));
+            }
+        }
+    }
+
     for (UINT i = 0; i < count; i++)
     {
-        StackTraceElement ste;
-        MOVE (ste, dataPtr + i*sizeof(StackTraceElement));
+        StackTraceElement ste = elements[i];
 
         // ste.ip must be adjusted because of an ancient workaround in the exception 
         // infrastructure. The workaround is that the exception needs to have
@@ -2741,21 +2998,107 @@ HRESULT FormatException(CLRDATA_ADDRESS taObj, BOOL bLineNumbers = FALSE)
     return Status;
 }
 
+// A managed thread with its last-thrown exception resolved up front.
+struct ManagedThreadInfo
+{
+    CLRDATA_ADDRESS Address;    // the Thread instance
+    DacpThreadData Data;
+    TADDR LastThrownObject;     // referent of lastThrownObjectHandle, or 0
+    TADDR LastThrownMT;         // the exception object's MethodTable
+    BOOL LastThrownMTKnown;     // whether the MethodTable read succeeded
+};
+
+/* Walks the thread store once, then resolves every thread's last-thrown
+ * exception object and its MethodTable in two scatter-gather requests.  The
+ * serial printers used to issue two small reads per thread for this; on an
+ * incident dump with hundreds of faulted threads the batch is the difference
+ * between one round trip and a thousand.
+ */
+static HRESULT CollectManagedThreads(const DacpThreadStoreData &threadStore, std::vector<ManagedThreadInfo> &threads)
+{
+    HRESULT Status;
+
+    DacpThreadData thread;
+    CLRDATA_ADDRESS curThread = threadStore.firstThread;
+    while (curThread)
+    {
+        if (IsInterrupt())
+            break;
+
+        if ((Status = thread.Request(g_sos, curThread)) != S_OK)
+        {
+            PrintLn("Failed to request Thread at ", Pointer(curThread));
+            return Status;
+        }
+
+        ManagedThreadInfo info;
+        info.Address = curThread;
+        info.Data = thread;
+        info.LastThrownObject = 0;
+        info.LastThrownMT = 0;
+        info.LastThrownMTKnown = FALSE;
+        threads.push_back(info);
+
+        curThread = thread.nextThread;
+    }
+
+    // Dereference the handles of the threads which have one.
+    std::vector<ReadVirtualRange> ranges;
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        if (threads[i].Data.lastThrownObjectHandle == 0)
+            continue;
+
+        ReadVirtualRange range;
+        range.Address = threads[i].Data.lastThrownObjectHandle;
+        range.Buffer = &threads[i].LastThrownObject;
+        range.Size = sizeof(TADDR);
+        ranges.push_back(range);
+    }
+
+    ReadVirtualBatch(ranges.data(), (ULONG)ranges.size());
+
+    // And the MethodTables of the exception objects found behind them.
+    ranges.clear();
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        if (threads[i].LastThrownObject == 0)
+            continue;
+
+        ReadVirtualRange range;
+        range.Address = threads[i].LastThrownObject;
+        range.Buffer = &threads[i].LastThrownMT;
+        range.Size = sizeof(TADDR);
+        ranges.push_back(range);
+    }
+
+    ReadVirtualBatch(ranges.data(), (ULONG)ranges.size());
+
+    size_t range = 0;
+    for (size_t i = 0; i < threads.size(); ++i)
+        if (threads[i].LastThrownObject != 0)
+            threads[i].LastThrownMTKnown = SUCCEEDED(ranges[range++].Status);
+
+    return S_OK;
+}
+
 DECLARE_API(PrintException)
 {
     INIT_API();
     
     BOOL dml = FALSE;
-    BOOL bShowNested = FALSE;   
+    BOOL bShowNested = FALSE;
     BOOL bLineNumbers = FALSE;
     BOOL bCCW = FALSE;
+    BOOL bAll = FALSE;
     StringHolder strObject;
-    CMDOption option[] = 
+    CMDOption option[] =
     {   // name, vptr, type, hasValue
         {"-nested", &bShowNested, COBOOL, FALSE},
         {"-lines", &bLineNumbers, COBOOL, FALSE},
         {"-l", &bLineNumbers, COBOOL, FALSE},
         {"-ccw", &bCCW, COBOOL, FALSE},
+        {"-all", &bAll, COBOOL, FALSE},
 #ifndef FEATURE_PAL
         {"/d", &dml, COBOOL, FALSE}
 #endif
@@ -2787,6 +3130,93 @@ DECLARE_API(PrintException)
     }
 
     EnableDMLHolder dmlHolder(dml);
+
+    if (bAll)
+    {
+        if (nArg != 0 || bCCW)
+        {
+            ExtOut("-all cannot be combined with an object address or -ccw\n");
+            return Status;
+        }
+
+        DacpThreadStoreData threadStore;
+        if ((Status = threadStore.Request(g_sos)) != S_OK)
+        {
+            ExtOut("Failed to request ThreadStore\n");
+            return Status;
+        }
+
+        // One walk of the thread store with the exception objects resolved in
+        // bulk; only the threads which actually have one get formatted.
+        std::vector<ManagedThreadInfo> threads;
+        if ((Status = CollectManagedThreads(threadStore, threads)) != S_OK)
+            return Status;
+
+        int printed = 0;
+        for (size_t t = 0; t < threads.size(); ++t)
+        {
+            if (IsInterrupt())
+            {
+                ExtOut("<aborted>\n");
+                return Status;
+            }
+
+            if (threads[t].LastThrownObject == 0)
+                continue;
+
+            if (printed++ > 0)
+                ExtOut("\n");
+
+            ULONG osThreadId = threads[t].Data.osThreadId;
+            BOOL bSwitchedOutFiber = osThreadId == SWITCHED_OUT_FIBER_OSID;
+            ExtOut("Thread %d (OSID 0x%x):\n", threads[t].Data.corThreadId, bSwitchedOutFiber ? 0 : osThreadId);
+            FormatException(TO_CDADDR(threads[t].LastThrownObject), bLineNumbers);
+
+            if (threads[t].Data.firstNestedException)
+            {
+                if (!bShowNested)
+                {
+                    ExtOut("There are nested exceptions on this thread. Run with -nested for details\n");
+                    continue;
+                }
+
+                CLRDATA_ADDRESS currentNested = threads[t].Data.firstNestedException;
+                do
+                {
+                    CLRDATA_ADDRESS obj = 0, next = 0;
+                    Status = g_sos->GetNestedExceptionData(currentNested, &obj, &next);
+
+                    if (Status != S_OK)
+                    {
+                        ExtOut("Error retrieving nested exception info %p\n", SOS_PTR(currentNested));
+                        return Status;
+                    }
+
+                    if (IsInterrupt())
+                    {
+                        ExtOut("<aborted>\n");
+                        return Status;
+                    }
+
+                    ExtOut("\nNested exception -------------------------------------------------------------\n");
+                    Status = FormatException(obj, bLineNumbers);
+                    if (Status != S_OK)
+                    {
+                        return Status;
+                    }
+
+                    currentNested = next;
+                }
+                while (currentNested != NULL);
+            }
+        }
+
+        if (printed == 0)
+            ExtOut("No thread has a last-thrown exception.\n");
+
+        return Status;
+    }
+
     DWORD_PTR p_Object = NULL;
     if (nArg == 0)
     {
@@ -3355,20 +3785,32 @@ DECLARE_API(EEHeap)
     BOOL dml = FALSE;
     BOOL showgc = FALSE;
     BOOL showloader = FALSE;
+    BOOL showgen = FALSE;
+    BOOL showcodestats = FALSE;
 
-    CMDOption option[] = 
+    CMDOption option[] =
     {   // name, vptr, type, hasValue
         {"-gc", &showgc, COBOOL, FALSE},
+        {"-gen", &showgen, COBOOL, FALSE},
         {"-loader", &showloader, COBOOL, FALSE},
+        {"-codestats", &showcodestats, COBOOL, FALSE},
         {"/d", &dml, COBOOL, FALSE},
     };
 
-    if (!GetCMDOption(args, option, _countof(option), NULL, 0, NULL)) 
+    if (!GetCMDOption(args, option, _countof(option), NULL, 0, NULL))
     {
         return Status;
     }
 
     EnableDMLHolder dmlHolder(dml);
+    BufferedOutputHolder bufferedOutput;
+
+    if (showcodestats)
+    {
+        PrintCodeHeapStats();
+        return Status;
+    }
+
     if (showloader || !showgc)
     {
         // Loader heap.
@@ -3467,62 +3909,36 @@ DECLARE_API(EEHeap)
             DisplayInvalidStructuresMessage();
         }
         
-        DacpGcHeapData gcheap;
-        if (gcheap.Request(g_sos) != S_OK)
+        // The session snapshot already holds every heap's details; Build is
+        // a no-op when an earlier command fetched them.
+        if (!g_snapshot.Build())
         {
-            ExtOut("Error requesting GC Heap data\n");
             return Status;
         }
 
-        if (gcheap.bServerMode)
+        DacpGcHeapData *gcheap = g_snapshot.GetHeapData();
+        if (gcheap->bServerMode)
         {
-            dwNHeaps = gcheap.HeapCount;
+            dwNHeaps = gcheap->HeapCount;
         }
 
         ExtOut("Number of GC Heaps: %d\n", dwNHeaps);
         DWORD_PTR totalSize = 0;
-        if (!gcheap.bServerMode)
+        if (!gcheap->bServerMode)
         {
-            DacpGcHeapDetails heapDetails;
-            if (heapDetails.Request(g_sos) != S_OK)
-            {
-                ExtOut("Error requesting details\n");
-                return Status;
-            }
-
-            GCHeapInfo (heapDetails, totalSize);
+            GCHeapInfo (*g_snapshot.GetHeapDetails(0), totalSize);
             ExtOut("Total Size:              ");
             PrintHeapSize(totalSize, 0);
         }
         else
         {
-            DWORD dwAllocSize;
-            if (!ClrSafeInt<DWORD>::multiply(sizeof(CLRDATA_ADDRESS), dwNHeaps, dwAllocSize))
-            {
-                ExtOut("Failed to get GCHeaps: integer overflow\n");
-                return Status;
-            }
-
-            CLRDATA_ADDRESS *heapAddrs = (CLRDATA_ADDRESS*)alloca(dwAllocSize);
-            if (g_sos->GetGCHeapList(dwNHeaps, heapAddrs, NULL) != S_OK)
-            {
-                ExtOut("Failed to get GCHeaps\n");
-                return Status;
-            }
-                        
-            DWORD n;
-            for (n = 0; n < dwNHeaps; n ++)
+            for (DWORD n = 0; n < dwNHeaps; n ++)
             {
-                DacpGcHeapDetails heapDetails;
-                if (heapDetails.Request(g_sos, heapAddrs[n]) != S_OK)
-                {
-                    ExtOut("Error requesting details\n");
-                    return Status;
-                }
+                DacpGcHeapDetails *heapDetails = g_snapshot.GetHeapDetails(n);
                 ExtOut("------------------------------\n");
-                ExtOut("Heap %d (%p)\n", n, SOS_PTR(heapAddrs[n]));
+                ExtOut("Heap %d (%p)\n", n, SOS_PTR(heapDetails->heapAddr));
                 DWORD_PTR heapSize = 0;
-                GCHeapInfo (heapDetails, heapSize);
+                GCHeapInfo (*heapDetails, heapSize);
                 totalSize += heapSize;
                 ExtOut("Heap Size:       " WIN86_8SPACES);
                 PrintHeapSize(heapSize, 0);
@@ -3531,6 +3947,10 @@ DECLARE_API(EEHeap)
         ExtOut("------------------------------\n");
         ExtOut("GC Heap Size:    " WIN86_8SPACES);
         PrintHeapSize(totalSize, 0);
+
+        // One walk buckets every object by generation across all heaps.
+        if (showgen)
+            GCPrintGenerationSummary();
     }
     return Status;
 }
@@ -3563,12 +3983,14 @@ DECLARE_API(TraverseHeap)
     MINIDUMP_NOT_SUPPORTED();    
     
     BOOL bXmlFormat = FALSE;
+    BOOL bBinFormat = FALSE;
     BOOL bVerify = FALSE;
     StringHolder Filename;
 
     CMDOption option[] = 
     {   // name, vptr,        type, hasValue
         {"-xml", &bXmlFormat, COBOOL, FALSE},
+        {"-bin", &bBinFormat, COBOOL, FALSE},
         {"-verify", &bVerify, COBOOL, FALSE},
     };
     CMDValue arg[] = 
@@ -3583,7 +4005,13 @@ DECLARE_API(TraverseHeap)
 
     if (nArg != 1)
     {
-        ExtOut("usage: HeapTraverse [-xml] filename\n");
+        ExtOut("usage: HeapTraverse [-xml | -bin] filename\n");
+        return Status;
+    }
+
+    if (bXmlFormat && bBinFormat)
+    {
+        ExtOut("Cannot specify both -xml and -bin\n");
         return Status;
     }
 
@@ -3594,7 +4022,7 @@ DECLARE_API(TraverseHeap)
     }
 
     FILE* file = NULL;
-    if (fopen_s(&file, Filename.data, "w") != 0) {
+    if (fopen_s(&file, Filename.data, bBinFormat ? "wb" : "w") != 0) {
         ExtOut("Unable to open file\n");
         return Status;
     }
@@ -3604,7 +4032,7 @@ DECLARE_API(TraverseHeap)
 
     HeapTraverser traverser(bVerify != FALSE);
 
-    ExtOut("Writing %s format to file %s\n", bXmlFormat ? "Xml" : "CLRProfiler", Filename.data);    
+    ExtOut("Writing %s format to file %s\n", bXmlFormat ? "Xml" : (bBinFormat ? "binary" : "CLRProfiler"), Filename.data);    
     ExtOut("Gathering types...\n");
 
     // TODO: there may be a canonical list of methodtables in the runtime that we can
@@ -3621,7 +4049,8 @@ DECLARE_API(TraverseHeap)
         return Status;
     }
 
-    if (!traverser.CreateReport (file, bXmlFormat ? FORMAT_XML : FORMAT_CLRPROFILER))
+    int format = bXmlFormat ? FORMAT_XML : (bBinFormat ? FORMAT_BINARY : FORMAT_CLRPROFILER);
+    if (!traverser.CreateReport (file, format))
     {
         ExtOut("Unable to write heap report\n");
         fclose(file);
@@ -3636,88 +4065,181 @@ DECLARE_API(TraverseHeap)
 
 #endif // FEATURE_PAL
 
-struct PrintRuntimeTypeArgs
+// One System.RuntimeType instance found on the heap.  Module is filled in
+// after the walk, once the distinct type handles have been resolved, so the
+// listing can be grouped by the module defining each type.
+struct RuntimeTypeEntry
 {
-    DWORD_PTR mtOfRuntimeType;
-    int handleFieldOffset;
-    DacpAppDomainStoreData adstore;
+    DWORD_PTR Object;       // the RuntimeType instance
+    DWORD_PTR TypeMT;       // the method table its m_handle refers to
+    DWORD_PTR Module;       // the module defining that type (0 if unknown)
 };
 
-void PrintRuntimeTypes(DWORD_PTR objAddr,size_t Size,DWORD_PTR methodTable,LPVOID token)
+static bool RuntimeTypeEntryCompare(const RuntimeTypeEntry &e1, const RuntimeTypeEntry &e2)
+{
+    if (e1.Module != e2.Module)
+        return e1.Module < e2.Module;
+
+    if (e1.TypeMT != e2.TypeMT)
+        return e1.TypeMT < e2.TypeMT;
+
+    return e1.Object < e2.Object;
+}
+
+DECLARE_API(DumpRuntimeTypes)
 {
-    PrintRuntimeTypeArgs *pArgs = (PrintRuntimeTypeArgs *)token;
+    INIT_API();
+    MINIDUMP_NOT_SUPPORTED();
+
+    BOOL dml = FALSE;
+
+    CMDOption option[] =
+    {   // name, vptr, type, hasValue
+        {"/d", &dml, COBOOL, FALSE},
+    };
+
+    if (!GetCMDOption(args, option, _countof(option), NULL, 0, NULL))
+        return Status;
+
+    EnableDMLHolder dmlHolder(dml);
 
-    if (pArgs->mtOfRuntimeType == NULL)
+    try
     {
-        NameForMT_s(methodTable, g_mdName, mdNameLen);
+        sos::GCHeap gcheap;
+
+        // Walk the heap once, filtering on the RuntimeType MethodTable.
+        // Until the first instance pins that MethodTable down, distinct
+        // MethodTables are name-checked once each and remembered; after
+        // that every object costs a pointer compare.
+        DWORD_PTR mtRuntimeType = 0;
+        int handleFieldOffset = 0;
+        std::unordered_set<DWORD_PTR> notRuntimeType;
+        std::vector<RuntimeTypeEntry> types;
 
-        if (_wcscmp(g_mdName, W("System.RuntimeType")) == 0)
+        for (sos::ObjectIterator itr = gcheap.WalkHeap(); itr; ++itr)
         {
-            pArgs->mtOfRuntimeType = methodTable;
-            pArgs->handleFieldOffset = GetObjFieldOffset(TO_CDADDR(objAddr), TO_CDADDR(methodTable), W("m_handle"));
-            if (pArgs->handleFieldOffset <= 0)
-                ExtOut("Error getting System.RuntimeType.m_handle offset\n");
+            if (IsInterrupt())
+                break;
+
+            DWORD_PTR methodTable = itr->GetMT();
+            if (mtRuntimeType == 0)
+            {
+                if (notRuntimeType.find(methodTable) != notRuntimeType.end())
+                    continue;
+
+                NameForMT_s(methodTable, g_mdName, mdNameLen);
+                if (_wcscmp(g_mdName, W("System.RuntimeType")) != 0)
+                {
+                    notRuntimeType.insert(methodTable);
+                    continue;
+                }
+
+                mtRuntimeType = methodTable;
+                handleFieldOffset = GetObjFieldOffset(TO_CDADDR(itr->GetAddress()), TO_CDADDR(methodTable), W("m_handle"));
+                if (handleFieldOffset <= 0)
+                {
+                    ExtOut("Error getting System.RuntimeType.m_handle offset\n");
+                    break;
+                }
+            }
+
+            if (methodTable != mtRuntimeType)
+                continue;
 
-            pArgs->adstore.Request(g_sos);
+            RuntimeTypeEntry entry;
+            entry.Object = itr->GetAddress();
+            entry.TypeMT = 0;
+            entry.Module = 0;
+            if (MOVE(entry.TypeMT, entry.Object + handleFieldOffset) == S_OK)
+                types.push_back(entry);
         }
-    }
 
-    if ((methodTable == pArgs->mtOfRuntimeType) && (pArgs->handleFieldOffset > 0))
-    {
-        // Get the method table and display the information.
-        DWORD_PTR mtPtr;
-        if (MOVE(mtPtr, objAddr + pArgs->handleFieldOffset) == S_OK)
+        // Resolve each distinct type handle once: the heap holds millions of
+        // RuntimeType instances for only thousands of distinct types.
+        DacpAppDomainStoreData adstore;
+        adstore.Request(g_sos);
+
+        std::unordered_map<DWORD_PTR, DWORD_PTR> typeModules;
+        std::unordered_map<DWORD_PTR, CLRDATA_ADDRESS> typeDomains;
+        for (size_t n = 0; n < types.size(); n++)
         {
-            DMLOut(DMLObject(objAddr));
+            if (IsInterrupt())
+                return Status;
 
-            CLRDATA_ADDRESS appDomain = GetAppDomainForMT(mtPtr);
-            if (appDomain != NULL)
+            DWORD_PTR typeMT = types[n].TypeMT;
+            std::unordered_map<DWORD_PTR, DWORD_PTR>::iterator found = typeModules.find(typeMT);
+            if (found == typeModules.end())
             {
-                if (appDomain == pArgs->adstore.sharedDomain)
-                    ExtOut(" %" POINTERSIZE "s", "Shared");
+                DWORD_PTR module = 0;
+                DacpMethodTableData mtdata;
+                if (mtdata.Request(g_sos, TO_CDADDR(typeMT)) == S_OK)
+                    module = TO_TADDR(mtdata.Module);
 
-                else if (appDomain == pArgs->adstore.systemDomain)
-                    ExtOut(" %" POINTERSIZE "s", "System");
-                else
-                    DMLOut(" %s", DMLDomain(appDomain));
+                typeModules[typeMT] = module;
+                typeDomains[typeMT] = GetAppDomainForMT(typeMT);
+                types[n].Module = module;
             }
             else
             {
-                ExtOut(" %" POINTERSIZE "s", "?");
+                types[n].Module = found->second;
             }
-        
-            NameForMT_s(mtPtr, g_mdName, mdNameLen);
-            DMLOut(" %s %S\n", DMLMethodTable(mtPtr), g_mdName);
         }
-    }
-}
-
 
-DECLARE_API(DumpRuntimeTypes)
-{
-    INIT_API();
-    MINIDUMP_NOT_SUPPORTED();    
+        std::sort(types.begin(), types.end(), RuntimeTypeEntryCompare);
 
-    BOOL dml = FALSE;
+        ExtOut("%" POINTERSIZE "s %" POINTERSIZE "s %" POINTERSIZE "s Type Name              \n",
+               "Address", "Domain", "MT");
+        ExtOut("------------------------------------------------------------------------------\n");
 
-    CMDOption option[] = 
-    {   // name, vptr, type, hasValue
-        {"/d", &dml, COBOOL, FALSE},
-    };
+        DWORD_PTR lastModule = (DWORD_PTR)-1;
+        for (size_t n = 0; n < types.size(); n++)
+        {
+            if (IsInterrupt())
+                break;
 
-    if (!GetCMDOption(args, option, _countof(option), NULL, 0, NULL))
-        return Status;
+            if (types[n].Module != lastModule)
+            {
+                lastModule = types[n].Module;
+                if (lastModule == 0)
+                {
+                    ExtOut("Module <unknown>\n");
+                }
+                else
+                {
+                    WCHAR fileName[MAX_LONGPATH];
+                    FileNameForModule(lastModule, fileName);
+                    DMLOut("Module %s %S\n", DMLModule(lastModule),
+                           fileName[0] ? fileName : W("<unknown>"));
+                }
+            }
 
-    EnableDMLHolder dmlHolder(dml);
+            DMLOut(DMLObject(types[n].Object));
 
-    ExtOut("%" POINTERSIZE "s %" POINTERSIZE "s %" POINTERSIZE "s Type Name              \n",
-           "Address", "Domain", "MT");
-    ExtOut("------------------------------------------------------------------------------\n");
+            CLRDATA_ADDRESS appDomain = typeDomains[types[n].TypeMT];
+            if (appDomain != NULL)
+            {
+                if (appDomain == adstore.sharedDomain)
+                    ExtOut(" %" POINTERSIZE "s", "Shared");
+                else if (appDomain == adstore.systemDomain)
+                    ExtOut(" %" POINTERSIZE "s", "System");
+                else
+                    DMLOut(" %s", DMLDomain(appDomain));
+            }
+            else
+            {
+                ExtOut(" %" POINTERSIZE "s", "?");
+            }
 
-    PrintRuntimeTypeArgs pargs;
-    ZeroMemory(&pargs, sizeof(PrintRuntimeTypeArgs));
+            const WCHAR *name = GetInternedMethodTableName(types[n].TypeMT);
+            DMLOut(" %s %S\n", DMLMethodTable(types[n].TypeMT), name ? name : W("<error>"));
+        }
+    }
+    catch (const sos::Exception &e)
+    {
+        ExtOut("%s\n", e.what());
+        return E_FAIL;
+    }
 
-    GCHeapsTraverse(PrintRuntimeTypes, (LPVOID)&pargs);
     return Status;
 }
 
@@ -3759,14 +4281,58 @@ namespace sos
     };
 }
 
+/* Saved position and partial statistics of an interrupted !dumpheap walk.
+ * A control-c during the standard listing (or a filtered -stat run on the
+ * serial iterator) lands here instead of discarding the work; a subsequent
+ * "!dumpheap -resume" continues from Resume with Stats already populated.
+ * The filter fields record the options the interrupted walk ran with so a
+ * resume under different options can be refused rather than produce a
+ * listing that is half one query and half another.
+ */
+struct DumpHeapCheckpoint
+{
+    HeapStat *Stats;        // partial per-type statistics (owned); NULL means no checkpoint
+    TADDR Resume;           // first address the interrupted walk did not visit
+    TADDR Stop;
+
+    // The filters of the interrupted walk.
+    TADDR MT;
+    size_t MinSize;
+    size_t MaxSize;
+    BOOL Stat;
+    BOOL Json;
+    BOOL Live;
+    BOOL Dead;
+    WCHAR *Type;            // owned copy of the -type substring, or NULL
+
+    DumpHeapCheckpoint()
+        : Stats(NULL), Resume(0), Stop(0), MT(0), MinSize(0), MaxSize(0),
+          Stat(FALSE), Json(FALSE), Live(FALSE), Dead(FALSE), Type(NULL)
+    {}
+};
+
+static DumpHeapCheckpoint g_dumpHeapCheckpoint;
+
+void ClearDumpHeapCheckpoint()
+{
+    delete g_dumpHeapCheckpoint.Stats;
+    g_dumpHeapCheckpoint.Stats = NULL;
+
+    delete [] g_dumpHeapCheckpoint.Type;
+    g_dumpHeapCheckpoint.Type = NULL;
+
+    g_dumpHeapCheckpoint.Resume = 0;
+}
+
 class DumpHeapImpl
 {
 public:
     DumpHeapImpl(PCSTR args)
         : mStart(0), mStop(0), mMT(0),  mMinSize(0), mMaxSize(~0),
-          mStat(FALSE), mStrings(FALSE), mVerify(FALSE),
-          mThinlock(FALSE), mShort(FALSE), mDML(FALSE),
-          mLive(FALSE), mDead(FALSE), mType(NULL)
+          mTopK(0), mStat(FALSE), mStrings(FALSE), mVerify(FALSE),
+          mThinlock(FALSE), mShort(FALSE), mJson(FALSE), mDML(FALSE),
+          mLive(FALSE), mDead(FALSE), mRetained(FALSE), mResume(FALSE),
+          mType(NULL)
     {
         ArrayHolder<char> type = NULL;
 
@@ -3776,14 +4342,18 @@ public:
             {"-mt", &mMT, COHEX, TRUE},              // dump objects with a given MethodTable
             {"-type", &type, COSTRING, TRUE},        // list objects of specified type
             {"-stat", &mStat, COBOOL, FALSE},        // dump a summary of types and the number of instances of each
-            {"-strings", &mStrings, COBOOL, FALSE},  // dump a summary of string objects
+            {"-strings", &mStrings, COBOOL, FALSE},  // analyze string duplication by content
             {"-verify", &mVerify, COBOOL, FALSE},    // verify heap objects (!heapverify)
             {"-thinlock", &mThinlock, COBOOL, FALSE},// list only thinlocks
             {"-short", &mShort, COBOOL, FALSE},      // list only addresses
+            {"-json", &mJson, COBOOL, FALSE},        // emit the object listing as JSON lines
             {"-min", &mMinSize, COHEX, TRUE},        // min size of objects to display
             {"-max", &mMaxSize, COHEX, TRUE},        // max size of objects to display
+            {"-topk", &mTopK, COSIZE_T, TRUE},       // only print the N types with the largest total size (implies -stat)
             {"-live", &mLive, COHEX, FALSE},         // only print live objects
             {"-dead", &mDead, COHEX, FALSE},         // only print dead objects
+            {"-retained", &mRetained, COBOOL, FALSE},// print retained (dominated) sizes instead of shallow sizes
+            {"-resume", &mResume, COBOOL, FALSE},    // continue an interrupted walk from its checkpoint
 #ifndef FEATURE_PAL
             {"/d", &mDML, COBOOL, FALSE},            // Debugger Markup Language
 #endif
@@ -3819,7 +4389,28 @@ public:
         {
             sos::Throw<sos::Exception>("wrong argument");
         }
-        
+
+        // -topk only makes sense for the per-type summary.
+        if (mTopK)
+            mStat = TRUE;
+
+        if (mJson && (mStat || mStrings || mThinlock || mShort || mRetained))
+        {
+            sos::Throw<sos::Exception>("-json only applies to the standard object listing.");
+        }
+
+        // Only the standard walk checkpoints itself; the specialty modes
+        // keep their state in forms that do not survive the command.
+        if (mResume && (mStrings || mThinlock || mShort || mVerify || mRetained))
+        {
+            sos::Throw<sos::Exception>("-resume only applies to the standard object listing and -stat.");
+        }
+
+        if (mResume && nArgs > 0)
+        {
+            sos::Throw<sos::Exception>("Cannot specify a range with -resume; the checkpoint records one.");
+        }
+
         // If the user gave us a type, convert it to unicode and clean up "type".
         if (type && !mStrings)
         {
@@ -3853,11 +4444,22 @@ public:
 #ifndef FEATURE_PAL
         if (mLive || mDead)
         {
-            GCRootImpl gcroot;
-            mLiveness = gcroot.GetLiveObjects();
+            // One marking pass into the segment bitmap, amortized over the
+            // whole listing, instead of materializing a hash set of every
+            // live object.
+            mLiveness.BuildLivenessMap();
         }
 #endif
 
+        if (mRetained)
+        {
+            // Dominator-based retained sizes replace a !gcroot/!objsize loop
+            // per candidate; the graph is built and solved once.
+            GCRootImpl gcroot;
+            gcroot.PrintRetainedSizes(mTopK ? (int)mTopK : 10);
+            return;
+        }
+
         // Some of the "specialty" versions of DumpHeap have slightly
         // different implementations than the standard version of DumpHeap.
         // We seperate them out to not clutter the standard DumpHeap function.
@@ -3948,8 +4550,18 @@ private:
 
         if (mType != NULL)
         {
+            // Decide each MethodTable once: the name lookup below is a DAC
+            // request plus an allocation, and a filtered scan sees the same
+            // few MethodTables over and over.
+            TADDR mt = obj.GetMT();
+            std::unordered_map<TADDR, bool>::const_iterator itr = mTypeMatchCache.find(mt);
+            if (itr != mTypeMatchCache.end())
+                return itr->second;
+
             WString name = obj.GetTypeName();
-            return _wcsstr(name.c_str(), mType) != NULL;
+            bool match = _wcsstr(name.c_str(), mType) != NULL;
+            mTypeMatchCache[mt] = match;
+            return match;
         }
 
         return true;
@@ -3964,10 +4576,10 @@ private:
     bool IsCorrectLiveness(const sos::Object &obj)
     {
 #ifndef FEATURE_PAL
-        if (mLive && mLiveness.find(obj.GetAddress()) == mLiveness.end())
+        if (mLive && !mLiveness.IsLive(obj.GetAddress()))
             return false;
 
-        if (mDead && (mLiveness.find(obj.GetAddress()) != mLiveness.end() || obj.IsFree()))
+        if (mDead && (mLiveness.IsLive(obj.GetAddress()) || obj.IsFree()))
             return false;
 #endif
         return true;
@@ -3980,188 +4592,488 @@ private:
         ExtOut("%" POINTERSIZE "s %" POINTERSIZE "s %8s\n", "Address", "MT", "Size");
     }
 
-    void DumpHeap(sos::GCHeap &gcheap)
+    bool CheckpointMatches() const
     {
-        HeapStat stats;
+        const DumpHeapCheckpoint &cp = g_dumpHeapCheckpoint;
 
-        // For heap fragmentation tracking.
-        TADDR lastFreeObj = NULL;
-        size_t lastFreeSize = 0;
+        if (cp.MT != mMT || cp.MinSize != mMinSize || cp.MaxSize != mMaxSize ||
+            cp.Stat != mStat || cp.Json != mJson || cp.Live != mLive || cp.Dead != mDead)
+            return false;
 
-        if (!mStat)
-            PrintHeader();
+        if ((cp.Type != NULL) != (mType != NULL))
+            return false;
 
-        for (sos::ObjectIterator itr = gcheap.WalkHeap(mStart, mStop); itr; ++itr)
-        {
-            if (!Verify(itr))
-                return;
+        if (cp.Type != NULL && _wcscmp(cp.Type, mType) != 0)
+            return false;
+
+        return true;
+    }
 
-            bool onLOH = itr.IsCurrObjectOnLOH();
+    // Called when an exception (usually control-c) aborts the walk.  Takes
+    // ownership of the partial statistics and records where the walk stopped
+    // so "!dumpheap -resume" can continue it.
+    void SaveCheckpoint(const sos::ObjectIterator &itr, HeapStat *stats)
+    {
+        ClearDumpHeapCheckpoint();
 
-            // Check for free objects to report fragmentation
-            if (lastFreeObj != NULL)
-                ReportFreeObject(lastFreeObj, lastFreeSize, itr->GetAddress(), itr->GetMT());
+        if (!itr)
+        {
+            delete stats;
+            return;
+        }
 
-            if (!onLOH && itr->IsFree())
-            {
-                lastFreeObj = *itr;
-                lastFreeSize = itr->GetSize();
-            }
-            else
-            {
-                lastFreeObj = NULL;
-            }
+        // The loop body completed for the current object before the abort
+        // surfaced from operator++, so resume just past it.  If the object
+        // cannot even be sized, retry it instead.
+        TADDR resume;
+        try
+        {
+            resume = itr->GetAddress() + itr->GetSize();
+        }
+        catch(const sos::Exception &)
+        {
+            resume = itr->GetAddress();
+        }
 
-            if (IsCorrectType(*itr) && IsCorrectSize(*itr) && IsCorrectLiveness(*itr))
+        if (mType)
+        {
+            size_t iLen = _wcslen(mType) + 1;
+            g_dumpHeapCheckpoint.Type = new NOTHROW WCHAR[iLen];
+            if (g_dumpHeapCheckpoint.Type == NULL)
             {
-                stats.Add((DWORD_PTR)itr->GetMT(), (DWORD)itr->GetSize());
-                if (!mStat)
-                    DMLOut("%s %s %8d%s\n", DMLObject(itr->GetAddress()), DMLDumpHeapMT(itr->GetMT()), itr->GetSize(), 
-                                            itr->IsFree() ? " Free":"     ");
+                // Without the filter string a -resume of this walk cannot be
+                // validated, so do not offer one.
+                delete stats;
+                return;
             }
+            wcscpy_s(g_dumpHeapCheckpoint.Type, iLen, mType);
         }
 
-        if (!mStat)
-            ExtOut("\n");
-
-        stats.Sort();
-        stats.Print();
+        g_dumpHeapCheckpoint.Resume = resume;
+        g_dumpHeapCheckpoint.Stop = mStop;
+        g_dumpHeapCheckpoint.MT = mMT;
+        g_dumpHeapCheckpoint.MinSize = mMinSize;
+        g_dumpHeapCheckpoint.MaxSize = mMaxSize;
+        g_dumpHeapCheckpoint.Stat = mStat;
+        g_dumpHeapCheckpoint.Json = mJson;
+        g_dumpHeapCheckpoint.Live = mLive;
+        g_dumpHeapCheckpoint.Dead = mDead;
+        g_dumpHeapCheckpoint.Stats = stats;
 
-        PrintFragmentationReport();
+        ExtOut("Walk interrupted at %p; rerun with \"!dumpheap -resume\" to continue it.\n",
+               SOS_PTR(resume));
     }
 
-    struct StringSetEntry
+    void DumpHeap(sos::GCHeap &gcheap)
     {
-        StringSetEntry() : count(0), size(0)
+        bool resuming = false;
+        if (mResume)
         {
-            str[0] = 0;
+            if (g_dumpHeapCheckpoint.Stats == NULL)
+                sos::Throw<sos::Exception>("No interrupted dumpheap walk to resume.");
+
+            if (!CheckpointMatches())
+                sos::Throw<sos::Exception>("The saved walk ran with different options; rerun without -resume.");
+
+            mStart = g_dumpHeapCheckpoint.Resume;
+            mStop = g_dumpHeapCheckpoint.Stop;
+            resuming = true;
+
+            ExtOut("Resuming the interrupted walk at %p.\n", SOS_PTR(mStart));
         }
-        
-        StringSetEntry(__in_ecount(64) WCHAR tmp[64], size_t _size)
-            : count(1), size(_size)
+        else if (g_dumpHeapCheckpoint.Stats != NULL)
         {
-            memcpy(str, tmp, sizeof(str));
+            // Starting a fresh walk supersedes the saved one.
+            ClearDumpHeapCheckpoint();
         }
-        
-        void Add(size_t _size) const
+
+        // A plain "!dumpheap -stat" does not need to materialize each object,
+        // so it can use the parallel per-segment walk engine instead of the
+        // serial iterator.  Both paths produce identical output.  (The
+        // parallel engine does not checkpoint; an interrupted run restarts.)
+        if (mStat && !mVerify && !mResume && mType == NULL && !mLive && !mDead &&
+            mStart == sos::GCHeap::HeapStart && mStop == sos::GCHeap::HeapEnd)
         {
-            count++;
-            size += _size;
+            if (DumpHeapParallel(gcheap))
+                return;
+
+            // Otherwise fall through to the serial walk.
         }
-        
-        mutable size_t count;
-        mutable size_t size;
-        WCHAR str[64];
-        
-        bool operator<(const StringSetEntry &rhs) const
+
+        // For heap fragmentation tracking.
+        TADDR lastFreeObj = NULL;
+        size_t lastFreeSize = 0;
+
+        if (!mStat && !mJson)
+            PrintHeader();
+
+        sos::ObjectIterator itr = gcheap.WalkHeap(mStart, mStop);
+
+        // On resume the checkpoint's partial statistics become the
+        // accumulator again; the iterator above was constructed first so a
+        // failure there leaves the checkpoint intact for another attempt.
+        HeapStat *stats;
+        if (resuming)
         {
-            return _wcscmp(str, rhs.str) < 0;
+            stats = g_dumpHeapCheckpoint.Stats;
+            g_dumpHeapCheckpoint.Stats = NULL;
+            ClearDumpHeapCheckpoint();
+        }
+        else
+        {
+            stats = new NOTHROW HeapStat;
+            if (stats == NULL)
+            {
+                ReportOOM();
+                return;
+            }
         }
-    };
-
-    
-    static bool StringSetCompare(const StringSetEntry &a1, const StringSetEntry &a2)
-    {
-        return a1.size < a2.size;
-    }
 
-    void DumpHeapStrings(sos::GCHeap &gcheap)
-    {
-#ifdef FEATURE_PAL
-        ExtOut("Not implemented.\n");
-#else
-        const int offset = sos::Object::GetStringDataOffset();
-        typedef std::set<StringSetEntry> Set;
-        Set set;            // A set keyed off of the string's text
-        
-        StringSetEntry tmp;  // Temp string used to keep track of the set
-        ULONG fetched = 0;
+        // The schema of the per-object listing, declared once; the writer
+        // serializes each row without any per-row format processing.  The
+        // DML listing keeps the DMLOut path below.
+        TableWriter row;
+        row.AddColumn(POINTERSIZE_HEX);
+        row.AddColumn(POINTERSIZE_HEX);
+        row.AddColumn(8, AlignRight, 0);
+        row.AddColumn(5, AlignLeft, 0);
 
-        TableOutput out(3, POINTERSIZE_HEX, AlignRight);
-        for (sos::ObjectIterator itr = gcheap.WalkHeap(mStart, mStop); itr; ++itr)
+        JsonWriter json;
+        try
         {
-            if (IsInterrupt())
-                break;
-                
-            if (itr->IsString() && IsCorrectSize(*itr) && IsCorrectLiveness(*itr))
+            for (; itr; ++itr)
             {
-                CLRDATA_ADDRESS addr = itr->GetAddress();
-                size_t size = itr->GetSize();
-                
-                if (!mStat)
-                    out.WriteRow(ObjectPtr(addr), Pointer(itr->GetMT()), Decimal(size));
+                if (!Verify(itr))
+                {
+                    delete stats;
+                    return;
+                }
 
-                // Don't bother calculating the size of the string, just read the full 64 characters of the buffer.  The null
-                // terminator we read will terminate the string.
-                HRESULT hr = g_ExtData->ReadVirtual(TO_CDADDR(addr+offset), tmp.str, sizeof(WCHAR)*(_countof(tmp.str)-1), &fetched);
-                if (SUCCEEDED(hr))
+                bool onLOH = itr.IsCurrObjectOnLOH();
+
+                // Check for free objects to report fragmentation
+                if (lastFreeObj != NULL)
+                    ReportFreeObject(lastFreeObj, lastFreeSize, itr->GetAddress(), itr->GetMT());
+
+                if (!onLOH && itr->IsFree())
+                {
+                    lastFreeObj = *itr;
+                    lastFreeSize = itr->GetSize();
+                }
+                else
                 {
-                    // Ensure we null terminate the string.  Note that this will not overrun the buffer as we only
-                    // wrote a max of 63 characters into the 64 character buffer.
-                    tmp.str[fetched/sizeof(WCHAR)] = 0;
-                    Set::iterator sitr = set.find(tmp);
-                    if (sitr == set.end())
+                    lastFreeObj = NULL;
+                }
+
+                // Cheapest checks first; the type check may need a name lookup.
+                if (IsCorrectSize(*itr) && IsCorrectLiveness(*itr) && IsCorrectType(*itr))
+                {
+                    stats->Add((DWORD_PTR)itr->GetMT(), (DWORD)itr->GetSize());
+                    if (mJson)
                     {
-                        tmp.size = size;
-                        tmp.count = 1;
-                        set.insert(tmp);
+                        json.BeginRecord("object");
+                        json.FieldHex("address", itr->GetAddress());
+                        json.FieldHex("mt", itr->GetMT());
+                        json.Field("size", (ULONG64)itr->GetSize());
+                        json.FieldBool("free", itr->IsFree());
+                        json.EndRecord();
                     }
-                    else
+                    else if (!mStat)
                     {
-                        sitr->Add(size);
+                        if (IsDMLEnabled())
+                        {
+                            DMLOut("%s %s %8d%s\n", DMLObject(itr->GetAddress()), DMLDumpHeapMT(itr->GetMT()), itr->GetSize(),
+                                                    itr->IsFree() ? " Free":"     ");
+                        }
+                        else
+                        {
+                            row.WritePointer(itr->GetAddress());
+                            row.WritePointer(itr->GetMT());
+                            row.WriteDecimal(itr->GetSize());
+                            row.WriteText(itr->IsFree() ? " Free" : "");
+                            row.EndRow();
+                        }
                     }
                 }
             }
         }
-
-        ExtOut("\n");
-
-        // Now flatten the set into a vector.  This is much faster than keeping two sets, or using a multimap.
-        typedef std::vector<StringSetEntry> Vect;
-        Vect v(set.begin(), set.end());
-        std::sort(v.begin(), v.end(), &DumpHeapImpl::StringSetCompare);
-
-        // Now print out the data.  The call to Flatten ensures that we don't print newlines to break up the
-        // output in strange ways.
-        for (Vect::iterator vitr = v.begin(); vitr != v.end(); ++vitr)
+        catch(const sos::Exception &)
         {
-            if (IsInterrupt())
-                break;
-                
-            Flatten(vitr->str, (unsigned int)_wcslen(vitr->str));
-            out.WriteRow(Decimal(vitr->size), Decimal(vitr->count), vitr->str);
+            SaveCheckpoint(itr, stats);
+            throw;
         }
-#endif // FEATURE_PAL
-    }
 
-    void DumpHeapShort(sos::GCHeap &gcheap)
-    {
-        for (sos::ObjectIterator itr = gcheap.WalkHeap(mStart, mStop); itr; ++itr)
+        // JSON consumers get the records only; the per-type summary and the
+        // fragmentation report stay with the text mode.
+        if (!mJson)
         {
-            if (!Verify(itr))
-                return;
+            if (!mStat)
+                ExtOut("\n");
+
+            if (mTopK)
+                stats->SortTopK(mTopK);
+            else
+                stats->Sort();
+            stats->Print();
 
-            if (IsCorrectType(*itr) && IsCorrectSize(*itr) && IsCorrectLiveness(*itr))
-                DMLOut("%s\n", DMLObject(itr->GetAddress()));
+            PrintFragmentationReport();
         }
+
+        delete stats;
     }
 
-    void DumpHeapThinlock(sos::GCHeap &gcheap)
+    bool DumpHeapParallel(sos::GCHeap &gcheap)
     {
-        int count = 0;
+        ParallelHeapWalker walker(gcheap, mMT, mMinSize, mMaxSize, MIN_FRAGMENTATIONBLOCK_BYTES);
+        if (!walker.Run())
+            return false;
 
-        PrintHeader();
-        for (sos::ObjectIterator itr = gcheap.WalkHeap(mStart, mStop); itr; ++itr)
-        {
-            if (!Verify(itr))
-                return;
+        HeapStat stats;
+        walker.AddStatsTo(stats);
+
+#ifndef FEATURE_PAL
+        InitFragmentationList();
+        const std::vector<HeapWalkFreeBlock> &blocks = walker.GetFreeBlocks();
+        for (size_t i = 0; i < blocks.size(); i++)
+            ReportFreeObject(blocks[i].Address, blocks[i].Size, blocks[i].NextObject, blocks[i].NextMT);
+#endif
+
+        if (mTopK)
+            stats.SortTopK(mTopK);
+        else
+            stats.Sort();
+        stats.Print();
+
+        PrintFragmentationReport();
+        return true;
+    }
+
+    /* One duplicate-string group: every instance whose payload hashed to
+     * the same 64-bit value.  Only counts and one exemplar address are kept,
+     * never the text, so the table's memory is bounded by the number of
+     * distinct strings rather than their contents.
+     */
+    struct StringDupEntry
+    {
+        size_t Count;               // instances seen with this content
+        size_t Size;                // object size of one instance
+        size_t Length;              // character count
+        CLRDATA_ADDRESS Exemplar;   // first instance encountered
+
+        size_t Wasted() const { return (Count - 1) * Size; }
+    };
+
+    static bool StringDupCompare(const StringDupEntry &a1, const StringDupEntry &a2)
+    {
+        return a1.Wasted() > a2.Wasted();
+    }
+
+    void DumpHeapStrings(sos::GCHeap &gcheap)
+    {
+        const int offset = sos::Object::GetStringDataOffset();
+
+        // Distinct contents, keyed by a 64-bit FNV-1a hash of the payload
+        // with the length folded in.  Capped outright so a pathological heap
+        // cannot grow the table without bound; strings past the cap are
+        // counted but not grouped.
+        const size_t kMaxEntries = (size_t)1 << 21;
+        typedef std::unordered_map<ULONG64, StringDupEntry> DupMap;
+        DupMap table;
+        size_t untracked = 0;
+
+        // Payload reads come through this buffer, so a string no longer than
+        // the buffer costs a single length-bounded read and longer ones are
+        // hashed chunk by chunk without ever holding the whole payload.
+        const size_t kChunkChars = 0x8000;
+        ArrayHolder<WCHAR> buffer = new NOTHROW WCHAR[kChunkChars];
+        if (buffer == NULL)
+        {
+            ReportOOM();
+            return;
+        }
+
+        TableOutput out(3, POINTERSIZE_HEX, AlignRight);
+        for (sos::ObjectIterator itr = gcheap.WalkHeap(mStart, mStop); itr; ++itr)
+        {
+            if (IsInterrupt())
+                break;
+
+            if (!itr->IsString() || !IsCorrectSize(*itr) || !IsCorrectLiveness(*itr))
+                continue;
+
+            CLRDATA_ADDRESS addr = itr->GetAddress();
+            size_t size = itr->GetSize();
+
+            if (!mStat)
+                out.WriteRow(ObjectPtr(addr), Pointer(itr->GetMT()), Decimal(size));
+
+            size_t length;
+            try
+            {
+                length = itr->GetStringLength();
+            }
+            catch (const sos::Exception &)
+            {
+                continue;
+            }
+
+            ULONG64 hash = 14695981039346656037ULL;
+            hash = (hash ^ (ULONG64)length) * 1099511628211ULL;
+
+            TADDR data = TO_TADDR(addr) + offset;
+            size_t remaining = length;
+            bool readOk = true;
+            while (remaining > 0)
+            {
+                ULONG chars = (ULONG)(remaining < kChunkChars ? remaining : kChunkChars);
+                ULONG bytes = chars * sizeof(WCHAR);
+                ULONG fetched = 0;
+                if (FAILED(g_ExtData->ReadVirtual(TO_CDADDR(data), buffer, bytes, &fetched)) || fetched != bytes)
+                {
+                    readOk = false;
+                    break;
+                }
+
+                const BYTE *raw = (const BYTE *)(WCHAR *)buffer;
+                for (ULONG i = 0; i < bytes; ++i)
+                    hash = (hash ^ raw[i]) * 1099511628211ULL;
+
+                data += bytes;
+                remaining -= chars;
+            }
+
+            if (!readOk)
+                continue;
+
+            DupMap::iterator titr = table.find(hash);
+            if (titr != table.end())
+            {
+                // With the length folded into a 64-bit content hash, a
+                // mismatched length means a genuine collision; those groups
+                // are simply not tracked.
+                if (titr->second.Length == length)
+                    titr->second.Count++;
+            }
+            else if (table.size() < kMaxEntries)
+            {
+                StringDupEntry entry = { 1, size, length, addr };
+                table[hash] = entry;
+            }
+            else
+            {
+                untracked++;
+            }
+        }
+
+        // Gather the groups with duplicates and order them by wasted bytes.
+        std::vector<StringDupEntry> dups;
+        size_t totalStrings = untracked;
+        size_t totalWasted = 0;
+        for (DupMap::iterator titr = table.begin(); titr != table.end(); ++titr)
+        {
+            totalStrings += titr->second.Count;
+            if (titr->second.Count > 1)
+            {
+                dups.push_back(titr->second);
+                totalWasted += titr->second.Wasted();
+            }
+        }
+
+        std::sort(dups.begin(), dups.end(), StringDupCompare);
+
+        size_t limit = (mTopK != 0 && mTopK < dups.size()) ? mTopK : dups.size();
+
+        ExtOut("\nDuplicate strings, by wasted bytes:\n");
+        TableOutput dupOut(4, POINTERSIZE_HEX, AlignRight);
+        dupOut.WriteRow("Wasted", "Count", "Size", "Exemplar");
+        for (size_t i = 0; i < limit; ++i)
+        {
+            if (IsInterrupt())
+                break;
+
+            WCHAR preview[64];
+            if (!sos::Object::ReadStringData(TO_TADDR(dups[i].Exemplar), dups[i].Length, preview, _countof(preview)))
+                preview[0] = 0;
+            Flatten(preview, (unsigned int)_wcslen(preview));
+
+            dupOut.WriteRow(Decimal(dups[i].Wasted()), Decimal(dups[i].Count), Decimal(dups[i].Size), ObjectPtr(dups[i].Exemplar));
+            ExtOut("    %S\n", preview);
+        }
+
+        ExtOut("\nTotal %I64u strings, %I64u distinct; %I64u bytes wasted by %I64u duplicate groups\n",
+               (ULONG64)totalStrings, (ULONG64)table.size(), (ULONG64)totalWasted, (ULONG64)dups.size());
+        if (untracked != 0)
+            ExtOut("Table capped at %I64u distinct strings; %I64u strings were not grouped.\n", (ULONG64)kMaxEntries, (ULONG64)untracked);
+    }
+
+    void DumpHeapShort(sos::GCHeap &gcheap)
+    {
+        // -short is the raw feed for scripts: one address per line, with the
+        // row serialization measured as the bulk of the command once the
+        // walk itself got cheap.  The writer emits each address with the
+        // dedicated hex emitter; DML keeps the DMLOut path.
+        TableWriter row;
+        row.AddColumn(POINTERSIZE_HEX, AlignRight, 0);
+
+        for (sos::ObjectIterator itr = gcheap.WalkHeap(mStart, mStop); itr; ++itr)
+        {
+            if (!Verify(itr))
+                return;
+
+            if (IsCorrectSize(*itr) && IsCorrectLiveness(*itr) && IsCorrectType(*itr))
+            {
+                if (IsDMLEnabled())
+                {
+                    DMLOut("%s\n", DMLObject(itr->GetAddress()));
+                }
+                else
+                {
+                    row.WritePointer(itr->GetAddress());
+                    row.EndRow();
+                }
+            }
+        }
+    }
+
+    void DumpHeapThinlock(sos::GCHeap &gcheap)
+    {
+        int count = 0;
+
+        // Same schema as the main listing; the lock details ride behind the
+        // declared columns as a free-form tail.
+        TableWriter row;
+        row.AddColumn(POINTERSIZE_HEX);
+        row.AddColumn(POINTERSIZE_HEX);
+        row.AddColumn(8, AlignRight, 0);
+
+        PrintHeader();
+        for (sos::ObjectIterator itr = gcheap.WalkHeap(mStart, mStop); itr; ++itr)
+        {
+            if (!Verify(itr))
+                return;
 
-            sos::ThinLockInfo lockInfo; 
+            sos::ThinLockInfo lockInfo;
             if (IsCorrectType(*itr) && itr->GetThinLock(lockInfo))
             {
-                DMLOut("%s %s %8d", DMLObject(itr->GetAddress()), DMLDumpHeapMT(itr->GetMT()), itr->GetSize());
-                ExtOut(" ThinLock owner %x (%p) Recursive %x\n", lockInfo.ThreadId,
-                                        SOS_PTR(lockInfo.ThreadPtr), lockInfo.Recursion);
+                if (IsDMLEnabled())
+                {
+                    DMLOut("%s %s %8d", DMLObject(itr->GetAddress()), DMLDumpHeapMT(itr->GetMT()), itr->GetSize());
+                    ExtOut(" ThinLock owner %x (%p) Recursive %x\n", lockInfo.ThreadId,
+                                            SOS_PTR(lockInfo.ThreadPtr), lockInfo.Recursion);
+                }
+                else
+                {
+                    row.WritePointer(itr->GetAddress());
+                    row.WritePointer(itr->GetMT());
+                    row.WriteDecimal(itr->GetSize());
+                    row.WriteText(" ThinLock owner ");
+                    row.WriteHex(lockInfo.ThreadId);
+                    row.WriteText(" (");
+                    row.WritePointer(lockInfo.ThreadPtr);
+                    row.WriteText(") Recursive ");
+                    row.WriteHex(lockInfo.Recursion);
+                    row.EndRow();
+                }
 
                 count++;
             }
@@ -4177,22 +5089,30 @@ private:
           mMinSize,
           mMaxSize;
 
+    size_t mTopK;
+
     BOOL mStat,
          mStrings,
          mVerify,
          mThinlock,
          mShort,
+         mJson,
          mDML,
          mLive,
-         mDead;
+         mDead,
+         mRetained,
+         mResume;
 
 
     WCHAR *mType;
 
+    // Memoized -type decisions, keyed by MethodTable.
+    std::unordered_map<TADDR, bool> mTypeMatchCache;
+
 private:
 #if !defined(FEATURE_PAL)
     // Windows only
-    std::unordered_set<TADDR> mLiveness;
+    GCRootImpl mLiveness;       // Holds the liveness map built for -live/-dead.
     typedef std::list<sos::FragmentationBlock> FragmentationList;
     FragmentationList mFrag;
 
@@ -4332,15 +5252,50 @@ struct AsyncRecord
     DWORD Size;
     CLRDATA_ADDRESS StateMachineAddr;
     CLRDATA_ADDRESS StateMachineMT;
-    BOOL FilteredByOptions;
+    BOOL IsStateMachineBox;     // the MT is one of the AsyncStateMachineBox types (shown even without -tasks)
+    BOOL FilteredByOptions;     // per invocation: matches the -addr/-mt/-type filters
+    BOOL Excluded;              // per invocation: culled outright by -tasks/-completed; treated as absent
     BOOL IsStateMachine;
     BOOL IsValueType;
-    BOOL IsTopLevel;
+    BOOL IsTopLevel;            // per invocation: rewritten by the chain-marking pass
     int TaskStateFlags;
     int StateValue;
     std::vector<CLRDATA_ADDRESS> Continuations;
 };
 
+// Keyed by object address; a hash map keeps the continuation-edge lookups
+// O(1) on dumps with millions of pending tasks.  Display passes that need
+// address order iterate a separately sorted address list.
+typedef std::unordered_map<CLRDATA_ADDRESS, AsyncRecord> AsyncRecordMap;
+
+/* The async record graph is expensive to gather — a full heap walk plus a
+ * couple of DAC field lookups per task — and continuation-heavy services are
+ * exactly the dumps where !dumpasync gets run repeatedly with different
+ * filters.  The first invocation therefore materializes the unfiltered graph
+ * here and later invocations answer from it; the -addr/-mt/-type/-completed
+ * filters and the top-level marks are per-invocation state, recomputed on
+ * every query over the cached records.
+ */
+struct AsyncRecordIndex
+{
+    BOOL Valid;             // a complete, uninterrupted walk populated Records
+    BOOL IncludesAllTasks;  // the walk matched every Task, not just the boxes
+    AsyncRecordMap Records;
+    std::vector<CLRDATA_ADDRESS> SortedAddresses;
+
+    AsyncRecordIndex() : Valid(FALSE), IncludesAllTasks(FALSE) {}
+};
+
+static AsyncRecordIndex g_asyncRecordIndex;
+
+void ClearAsyncRecordIndex()
+{
+    g_asyncRecordIndex.Records.clear();
+    g_asyncRecordIndex.SortedAddresses.clear();
+    g_asyncRecordIndex.Valid = FALSE;
+    g_asyncRecordIndex.IncludesAllTasks = FALSE;
+}
+
 bool AsyncRecordIsCompleted(AsyncRecord& ar)
 {
     const int TASK_STATE_COMPLETED_MASK = 0x1600000;
@@ -4448,6 +5403,190 @@ void FindStateMachineTypes(DWORD_PTR* corelibModule, mdTypeDef* stateMachineBox,
     }
 }
 
+/* Walks the heap gathering one AsyncRecord per async state machine box (or per
+ * Task-derived object when includeAllTasks is set) into the session index.
+ * The walk is deliberately unfiltered: completed operations are kept and
+ * continuation edges are always resolved, so later invocations can answer any
+ * combination of filters and chain walks without touching the heap again.
+ */
+static void BuildAsyncRecordIndex(sos::GCHeap &gcheap, BOOL includeAllTasks)
+{
+    ClearAsyncRecordIndex();
+    g_asyncRecordIndex.IncludesAllTasks = includeAllTasks;
+
+    // Find the state machine types
+    DWORD_PTR corelibModule;
+    mdTypeDef stateMachineBoxMd, debugStateMachineBoxMd, taskMd;
+    FindStateMachineTypes(&corelibModule, &stateMachineBoxMd, &debugStateMachineBoxMd, &taskMd);
+
+    // Walk each heap object looking for async state machine objects.  As we're targeting .NET Core 2.1+, all such objects
+    // will be Task or Task-derived types.
+    AsyncRecordMap &asyncRecords = g_asyncRecordIndex.Records;
+    // Match decision per method table: every object of the same type takes the same branch,
+    // so each distinct MT is resolved once instead of issuing a DacpMethodTableData request
+    // (or a base-type walk for -tasks) per heap object.
+    struct MTMatch { bool Matches; bool IsBox; };
+    std::unordered_map<CLRDATA_ADDRESS, MTMatch> matchedMTs;
+    for (sos::ObjectIterator itr = gcheap.WalkHeap(); !IsInterrupt() && itr != NULL; ++itr)
+    {
+        // Skip objects too small to be state machines or tasks, avoiding some compiler-generated caching data structures.
+        if (itr->GetSize() <= 24)
+        {
+            continue;
+        }
+
+        // Match only async objects.
+        MTMatch match;
+        std::unordered_map<CLRDATA_ADDRESS, MTMatch>::iterator matchItr = matchedMTs.find(itr->GetMT());
+        if (matchItr != matchedMTs.end())
+        {
+            match = matchItr->second;
+        }
+        else
+        {
+            // We always care about AsyncStateMachineBox`1 as well as the DebugFinalizableAsyncStateMachineBox`1
+            // that's used when certain ETW events are set; a box is remembered as such so a later query without
+            // -tasks can serve the narrower view from the same records.
+            DacpMethodTableData mtdata;
+            match.IsBox = mtdata.Request(g_sos, TO_TADDR(itr->GetMT())) == S_OK &&
+                mtdata.Module == corelibModule &&
+                (mtdata.cl == stateMachineBoxMd || mtdata.cl == debugStateMachineBoxMd);
+            // If the user has selected to include all tasks and not just async state machine boxes, we simply need
+            // to validate that this is Task or Task-derived, and if it's not, skip it.
+            match.Matches = match.IsBox ||
+                (includeAllTasks && IsDerivedFrom(itr->GetMT(), corelibModule, taskMd) != FALSE);
+            matchedMTs[itr->GetMT()] = match;
+        }
+        if (!match.Matches)
+        {
+            continue;
+        }
+
+        // Create an AsyncRecord to store the state for this instance.
+        AsyncRecord ar;
+        ar.Address = itr->GetAddress();
+        ar.MT = itr->GetMT();
+        ar.Size = (DWORD)itr->GetSize();
+        ar.StateMachineAddr = itr->GetAddress();
+        ar.StateMachineMT = itr->GetMT();
+        ar.IsStateMachineBox = match.IsBox ? TRUE : FALSE;
+        ar.IsValueType = false;
+        ar.IsTopLevel = true;
+        ar.IsStateMachine = false;
+        ar.TaskStateFlags = 0;
+        ar.StateValue = 0;
+        ar.FilteredByOptions = TRUE; // recomputed per invocation
+        ar.Excluded = FALSE;         // recomputed per invocation
+
+        // Get the state flags for the task.  This is used to determine whether async objects are completed (and thus
+        // culled by default).  It avoids our needing to depend on interpreting the compiler's "<>1__state" field, and also
+        // lets us display state information for non-async state machine objects.
+        DacpFieldDescData stateFlagsField;
+        int offset = GetObjFieldOffset(ar.Address, ar.MT, W("m_stateFlags"), TRUE, &stateFlagsField);
+        if (offset != 0)
+        {
+            MOVE(ar.TaskStateFlags, ar.Address + offset);
+        }
+
+        // Get the async state machine object's StateMachine field.
+        DacpFieldDescData stateMachineField;
+        int stateMachineFieldOffset = GetObjFieldOffset(TO_CDADDR(itr->GetAddress()), itr->GetMT(), W("StateMachine"), TRUE, &stateMachineField);
+        if (stateMachineFieldOffset != 0)
+        {
+            ar.IsStateMachine = true;
+            ar.IsValueType = stateMachineField.Type == ELEMENT_TYPE_VALUETYPE;
+
+            // Get the address and method table of the state machine.  While it'll generally be a struct, it is valid for it to be a
+            // class (the C# compiler generates a class in debug builds to better support Edit-And-Continue), so we accommodate both.
+            DacpFieldDescData stateField;
+            int stateFieldOffset = -1;
+            if (ar.IsValueType)
+            {
+                ar.StateMachineAddr = itr->GetAddress() + stateMachineFieldOffset;
+                ar.StateMachineMT = stateMachineField.MTOfType;
+                stateFieldOffset = GetValueFieldOffset(ar.StateMachineMT, W("<>1__state"), &stateField);
+            }
+            else
+            {
+                MOVE(ar.StateMachineAddr, itr->GetAddress() + stateMachineFieldOffset);
+                DacpObjectData objData;
+                if (objData.Request(g_sos, ar.StateMachineAddr) == S_OK)
+                {
+                    ar.StateMachineMT = objData.MethodTable; // update from Canon to actual type
+                    stateFieldOffset = GetObjFieldOffset(ar.StateMachineAddr, ar.StateMachineMT, W("<>1__state"), TRUE, &stateField);
+                }
+            }
+
+            if (stateFieldOffset >= 0 && (ar.IsValueType || stateFieldOffset != 0))
+            {
+                MOVE(ar.StateValue, ar.StateMachineAddr + stateFieldOffset);
+            }
+        }
+
+        // Resolve any continuation that might be registered with the object.  This could be a single
+        // continuation, or it could be a list of continuations in the case of the same task being
+        // awaited multiple times.
+        CLRDATA_ADDRESS nextAddr;
+        if (TryGetContinuation(itr->GetAddress(), itr->GetMT(), &nextAddr))
+        {
+            sos::Object contObj = TO_TADDR(nextAddr);
+            if (_wcsncmp(contObj.GetTypeName(), W("System.Collections.Generic.List`1"), 33) == 0)
+            {
+                // The continuation is a List<object>.  Iterate through its internal object[]
+                // looking for non-null objects, and adding each one as a continuation.
+                int itemsOffset = GetObjFieldOffset(contObj.GetAddress(), contObj.GetMT(), W("_items"));
+                if (itemsOffset != 0)
+                {
+                    DWORD_PTR listItemsPtr;
+                    MOVE(listItemsPtr, contObj.GetAddress() + itemsOffset);
+                    if (sos::IsObject(listItemsPtr, false))
+                    {
+                        DacpObjectData objData;
+                        if (objData.Request(g_sos, TO_CDADDR(listItemsPtr)) == S_OK && objData.ObjectType == OBJ_ARRAY)
+                        {
+                            std::vector<DWORD_PTR> elements(objData.dwNumComponents);
+                            if (SUCCEEDED(moveArray(elements.data(), TO_TADDR(objData.ArrayDataPtr), elements.size())))
+                            {
+                                for (int i = 0; i < objData.dwNumComponents; i++)
+                                {
+                                    CLRDATA_ADDRESS elementPtr = TO_CDADDR(elements[i]);
+                                    if (elementPtr != NULL && sos::IsObject(elementPtr, false))
+                                    {
+                                        ResolveContinuation(&elementPtr);
+                                        ar.Continuations.push_back(elementPtr);
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            else
+            {
+                ar.Continuations.push_back(contObj.GetAddress());
+            }
+        }
+
+        // We've gathered all of the needed information for this heap object.  Add it to our list of async records.
+        asyncRecords.insert(std::pair<CLRDATA_ADDRESS, AsyncRecord>(ar.Address, ar));
+    }
+
+    // Sort the addresses once so the display passes keep the address-ordered output.
+    g_asyncRecordIndex.SortedAddresses.reserve(asyncRecords.size());
+    for (AsyncRecordMap::iterator arIt = asyncRecords.begin(); arIt != asyncRecords.end(); ++arIt)
+    {
+        g_asyncRecordIndex.SortedAddresses.push_back(arIt->first);
+    }
+    std::sort(g_asyncRecordIndex.SortedAddresses.begin(), g_asyncRecordIndex.SortedAddresses.end());
+
+    // An interrupted walk still serves this invocation (partial output beats none),
+    // but is not kept: the next invocation starts over.
+    if (!IsInterrupt())
+    {
+        g_asyncRecordIndex.Valid = TRUE;
+    }
+}
+
 DECLARE_API(DumpAsync)
 {
     INIT_API();
@@ -4511,158 +5650,38 @@ DECLARE_API(DumpAsync)
             DisplayInvalidStructuresMessage();
         }
 
-        // Find the state machine types
-        DWORD_PTR corelibModule;
-        mdTypeDef stateMachineBoxMd, debugStateMachineBoxMd, taskMd;
-        FindStateMachineTypes(&corelibModule, &stateMachineBoxMd, &debugStateMachineBoxMd, &taskMd);
-
-        // Walk each heap object looking for async state machine objects.  As we're targeting .NET Core 2.1+, all such objects
-        // will be Task or Task-derived types.
-        std::map<CLRDATA_ADDRESS, AsyncRecord> asyncRecords;
-        for (sos::ObjectIterator itr = gcheap.WalkHeap(); !IsInterrupt() && itr != NULL; ++itr)
+        // Materialize the session's async record graph if this is the first async command,
+        // if an earlier walk was interrupted, or if the earlier walk only gathered the
+        // state machine boxes and this query needs every task.  Otherwise the cached
+        // records answer the query without another heap walk; against a live target the
+        // index is dropped between commands like the other session caches.
+        if (!g_asyncRecordIndex.Valid || (includeAllTasks && !g_asyncRecordIndex.IncludesAllTasks))
         {
-            // Skip objects too small to be state machines or tasks, avoiding some compiler-generated caching data structures.
-            if (itr->GetSize() <= 24) 
-            {
-                continue;
-            }
+            BuildAsyncRecordIndex(gcheap, includeAllTasks);
+        }
 
-            // Match only async objects.
-            if (includeAllTasks)
-            {
-                // If the user has selected to include all tasks and not just async state machine boxes, we simply need to validate
-                // that this is Task or Task-derived, and if it's not, skip it.
-                if (!IsDerivedFrom(itr->GetMT(), corelibModule, taskMd))
-                {
-                    continue;
-                }
-            }
-            else
-            {
-                // Otherwise, we only care about AsyncStateMachineBox`1 as well as the DebugFinalizableAsyncStateMachineBox`1
-                // that's used when certain ETW events are set.
-                DacpMethodTableData mtdata;
-                if (mtdata.Request(g_sos, TO_TADDR(itr->GetMT())) != S_OK ||
-                    mtdata.Module != corelibModule ||
-                    (mtdata.cl != stateMachineBoxMd && mtdata.cl != debugStateMachineBoxMd))
-                {
-                    continue;
-                }
-            }
+        AsyncRecordMap &asyncRecords = g_asyncRecordIndex.Records;
+        std::vector<CLRDATA_ADDRESS> &sortedAddresses = g_asyncRecordIndex.SortedAddresses;
 
-            // Create an AsyncRecord to store the state for this instance.  We're likely going to keep the object at this point,
-            // though we may still discard/skip it with a few checks later; to do that, though, we'll need some of the info
-            // gathered here, so we construct the record to store the data.
-            AsyncRecord ar;
-            ar.Address = itr->GetAddress();
-            ar.MT = itr->GetMT();
-            ar.Size = (DWORD)itr->GetSize();
-            ar.StateMachineAddr = itr->GetAddress();
-            ar.StateMachineMT = itr->GetMT();
-            ar.IsValueType = false;
+        // Reset the per-invocation state on every record.  A record excluded by the
+        // current options is treated as absent everywhere below, matching the output
+        // of a walk that had never gathered it.  The type name is a function of the
+        // method table, so the -type substring match works from the MT name.
+        for (AsyncRecordMap::iterator arIt = asyncRecords.begin(); arIt != asyncRecords.end(); ++arIt)
+        {
+            AsyncRecord &ar = arIt->second;
+            ar.Excluded =
+                (!includeAllTasks && !ar.IsStateMachineBox) ||
+                (!includeCompleted && AsyncRecordIsCompleted(ar));
             ar.IsTopLevel = true;
-            ar.IsStateMachine = false;
-            ar.TaskStateFlags = 0;
-            ar.StateValue = 0;
             ar.FilteredByOptions = // we process all objects to support forming proper chains, but then only display ones that match the user's request
-                (mt == NULL || mt == itr->GetMT()) && // Match only MTs the user requested.
-                (type == NULL || _wcsstr(itr->GetTypeName(), type) != NULL) && // Match only type name substrings the user requested.
-                (addr == NULL || addr == itr->GetAddress()); // Match only the object at the specified address.
-
-            // Get the state flags for the task.  This is used to determine whether async objects are completed (and thus should
-            // be culled by default).  It avoids our needing to depend on interpreting the compiler's "<>1__state" field, and also lets
-            // us display state information for non-async state machine objects.
-            DacpFieldDescData stateFlagsField;
-            int offset = GetObjFieldOffset(ar.Address, ar.MT, W("m_stateFlags"), TRUE, &stateFlagsField);
-            if (offset != 0)
-            {
-                MOVE(ar.TaskStateFlags, ar.Address + offset);
-            }
-
-            // Get the async state machine object's StateMachine field.
-            DacpFieldDescData stateMachineField;
-            int stateMachineFieldOffset = GetObjFieldOffset(TO_CDADDR(itr->GetAddress()), itr->GetMT(), W("StateMachine"), TRUE, &stateMachineField);
-            if (stateMachineFieldOffset != 0)
-            {
-                ar.IsStateMachine = true;
-                ar.IsValueType = stateMachineField.Type == ELEMENT_TYPE_VALUETYPE;
-
-                // Get the address and method table of the state machine.  While it'll generally be a struct, it is valid for it to be a
-                // class (the C# compiler generates a class in debug builds to better support Edit-And-Continue), so we accommodate both.
-                DacpFieldDescData stateField;
-                int stateFieldOffset = -1;
-                if (ar.IsValueType)
-                {
-                    ar.StateMachineAddr = itr->GetAddress() + stateMachineFieldOffset;
-                    ar.StateMachineMT = stateMachineField.MTOfType;
-                    stateFieldOffset = GetValueFieldOffset(ar.StateMachineMT, W("<>1__state"), &stateField);
-                }
-                else
-                {
-                    MOVE(ar.StateMachineAddr, itr->GetAddress() + stateMachineFieldOffset);
-                    DacpObjectData objData;
-                    if (objData.Request(g_sos, ar.StateMachineAddr) == S_OK)
-                    {
-                        ar.StateMachineMT = objData.MethodTable; // update from Canon to actual type
-                        stateFieldOffset = GetObjFieldOffset(ar.StateMachineAddr, ar.StateMachineMT, W("<>1__state"), TRUE, &stateField);
-                    }
-                }
-
-                if (stateFieldOffset >= 0 && (ar.IsValueType || stateFieldOffset != 0))
-                {
-                    MOVE(ar.StateValue, ar.StateMachineAddr + stateFieldOffset);
-                }
-            }
-
-            // If we only want to include incomplete async objects, skip this one if it's completed.
-            if (!includeCompleted && AsyncRecordIsCompleted(ar))
-            {
-                continue;
-            }
-
-            // If the user has asked to include "async stacks" information, resolve any continuation
-            // that might be registered with it.  This could be a single continuation, or it could
-            // be a list of continuations in the case of the same task being awaited multiple times.
-            CLRDATA_ADDRESS nextAddr;
-            if (includeStacks && TryGetContinuation(itr->GetAddress(), itr->GetMT(), &nextAddr))
+                (mt == NULL || mt == ar.MT) && // Match only MTs the user requested.
+                (addr == NULL || addr == ar.Address); // Match only the object at the specified address.
+            if (ar.FilteredByOptions && type != NULL)
             {
-                sos::Object contObj = TO_TADDR(nextAddr);
-                if (_wcsncmp(contObj.GetTypeName(), W("System.Collections.Generic.List`1"), 33) == 0)
-                {
-                    // The continuation is a List<object>.  Iterate through its internal object[]
-                    // looking for non-null objects, and adding each one as a continuation.
-                    int itemsOffset = GetObjFieldOffset(contObj.GetAddress(), contObj.GetMT(), W("_items"));
-                    if (itemsOffset != 0)
-                    {
-                        DWORD_PTR listItemsPtr;
-                        MOVE(listItemsPtr, contObj.GetAddress() + itemsOffset);
-                        if (sos::IsObject(listItemsPtr, false))
-                        {
-                            DacpObjectData objData;
-                            if (objData.Request(g_sos, TO_CDADDR(listItemsPtr)) == S_OK && objData.ObjectType == OBJ_ARRAY)
-                            {
-                                for (int i = 0; i < objData.dwNumComponents; i++)
-                                {
-                                    CLRDATA_ADDRESS elementPtr;
-                                    MOVE(elementPtr, TO_CDADDR(objData.ArrayDataPtr + (i * objData.dwComponentSize)));
-                                    if (elementPtr != NULL && sos::IsObject(elementPtr, false))
-                                    {
-                                        ResolveContinuation(&elementPtr);
-                                        ar.Continuations.push_back(elementPtr);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-                else
-                {
-                    ar.Continuations.push_back(contObj.GetAddress());
-                }
+                sos::MethodTable arMT = TO_TADDR(ar.MT);
+                ar.FilteredByOptions = _wcsstr(arMT.GetName(), type) != NULL; // Match only type name substrings the user requested.
             }
-
-            // We've gathered all of the needed information for this heap object.  Add it to our list of async records.
-            asyncRecords.insert(std::pair<CLRDATA_ADDRESS, AsyncRecord>(ar.Address, ar));
         }
 
         // As with DumpHeap, output a summary table about all of the objects we found.  In contrast, though, his is based on the filtered
@@ -4670,9 +5689,9 @@ DECLARE_API(DumpAsync)
         if (addr == NULL) // no point in stats if we're only targeting a single object
         {
             HeapStat stats;
-            for (std::map<CLRDATA_ADDRESS, AsyncRecord>::iterator arIt = asyncRecords.begin(); arIt != asyncRecords.end(); ++arIt)
+            for (AsyncRecordMap::iterator arIt = asyncRecords.begin(); arIt != asyncRecords.end(); ++arIt)
             {
-                if (!hasTypeFilter || arIt->second.FilteredByOptions)
+                if (!arIt->second.Excluded && (!hasTypeFilter || arIt->second.FilteredByOptions))
                 {
                     stats.Add((DWORD_PTR)arIt->second.MT, (DWORD)arIt->second.Size);
                 }
@@ -4687,24 +5706,31 @@ DECLARE_API(DumpAsync)
         // because in that case we consider those and only those objects to be top-level.
         if (includeStacks && !hasTypeFilter)
         {
-            size_t uniqueChains = asyncRecords.size();
-            for (std::map<CLRDATA_ADDRESS, AsyncRecord>::iterator arIt = asyncRecords.begin(); arIt != asyncRecords.end(); ++arIt)
+            size_t uniqueChains = 0;
+            for (AsyncRecordMap::iterator arIt = asyncRecords.begin(); arIt != asyncRecords.end(); ++arIt)
             {
+                if (arIt->second.Excluded)
+                {
+                    continue;
+                }
                 for (std::vector<CLRDATA_ADDRESS>::iterator contIt = arIt->second.Continuations.begin(); contIt != arIt->second.Continuations.end(); ++contIt)
                 {
-                    std::map<CLRDATA_ADDRESS, AsyncRecord>::iterator found = asyncRecords.find(*contIt);
-                    if (found != asyncRecords.end())
+                    AsyncRecordMap::iterator found = asyncRecords.find(*contIt);
+                    if (found != asyncRecords.end() && !found->second.Excluded)
                     {
-                        if (found->second.IsTopLevel)
-                        {
-                            found->second.IsTopLevel = false;
-                            uniqueChains--;
-                        }
+                        found->second.IsTopLevel = false;
                     }
                 }
             }
-
-            ExtOut("In %d chains.\n", uniqueChains);
+            for (AsyncRecordMap::iterator arIt = asyncRecords.begin(); arIt != asyncRecords.end(); ++arIt)
+            {
+                if (!arIt->second.Excluded && arIt->second.IsTopLevel)
+                {
+                    uniqueChains++;
+                }
+            }
+
+            ExtOut("In %d chains.\n", uniqueChains);
         }
 
         // Print out header for the main line of each result.
@@ -4712,11 +5738,12 @@ DECLARE_API(DumpAsync)
         if (includeCompleted) ExtOut("%8s ", "Status");
         ExtOut("%10s %s\n", "State", "Description");
 
-        // Output each top-level async record.
+        // Output each top-level async record, in address order.
         int counter = 0;
-        for (std::map<CLRDATA_ADDRESS, AsyncRecord>::iterator arIt = asyncRecords.begin(); arIt != asyncRecords.end(); ++arIt)
+        for (std::vector<CLRDATA_ADDRESS>::iterator addrIt = sortedAddresses.begin(); addrIt != sortedAddresses.end(); ++addrIt)
         {
-            if (!arIt->second.IsTopLevel || (hasTypeFilter && !arIt->second.FilteredByOptions))
+            AsyncRecordMap::iterator arIt = asyncRecords.find(*addrIt);
+            if (arIt->second.Excluded || !arIt->second.IsTopLevel || (hasTypeFilter && !arIt->second.FilteredByOptions))
             {
                 continue;
             }
@@ -4760,8 +5787,8 @@ DECLARE_API(DumpAsync)
                     continuationChainToExplore.pop_back();
 
                     // Get the async record for this continuation.  It should be one we already know about.
-                    std::map<CLRDATA_ADDRESS, AsyncRecord>::iterator curAsyncRecord = asyncRecords.find(cur.second);
-                    if (curAsyncRecord == asyncRecords.end())
+                    AsyncRecordMap::iterator curAsyncRecord = asyncRecords.find(cur.second);
+                    if (curAsyncRecord == asyncRecords.end() || curAsyncRecord->second.Excluded)
                     {
                         continue;
                     }
@@ -4787,8 +5814,8 @@ DECLARE_API(DumpAsync)
 
                         // Find the async record for this continuation, and output its name.  If it's a state machine,
                         // also output its current state value so that a user can see at a glance its status.
-                        std::map<CLRDATA_ADDRESS, AsyncRecord>::iterator contAsyncRecord = asyncRecords.find(cont.GetAddress());
-                        if (contAsyncRecord != asyncRecords.end())
+                        AsyncRecordMap::iterator contAsyncRecord = asyncRecords.find(cont.GetAddress());
+                        if (contAsyncRecord != asyncRecords.end() && !contAsyncRecord->second.Excluded)
                         {
                             sos::MethodTable contMT = TO_TADDR(contAsyncRecord->second.StateMachineMT);
                             if (contAsyncRecord->second.IsStateMachine) ExtOut("(%d) ", contAsyncRecord->second.StateValue);
@@ -4856,6 +5883,9 @@ DECLARE_API(DumpHeap)
         return E_FAIL;
     }
 
+    // Object listings are output bound; batch the callbacks.
+    BufferedOutputHolder bufferedOutput;
+
     try
     {
         DumpHeapImpl dumpHeap(args);
@@ -4870,8 +5900,632 @@ DECLARE_API(DumpHeap)
     }
 }
 
+// The snapshot file written and consumed by !heapdiff: a fixed header followed
+// by one record per MethodTable.  Each record is the fixed-width fields below
+// plus the type name (UTF-16LE, no terminator) so a diff against another dump
+// can print types whose MethodTable no longer resolves.
+struct HeapDiffFileHeader
+{
+    char Magic[8];          // "SOSHDIFF"
+    DWORD Version;          // currently 1
+    DWORD EntryCount;
+};
+
+struct HeapDiffFileEntry
+{
+    ULONG64 MethodTable;
+    ULONG64 TotalSize;
+    DWORD Count;
+    DWORD NameBytes;        // length of the name that follows the entry
+};
+
+static const char kHeapDiffMagic[8] = { 'S', 'O', 'S', 'H', 'D', 'I', 'F', 'F' };
+
+// A single line of !heapdiff output.
+struct HeapDiffRow
+{
+    DWORD_PTR MT;
+    __int64 CountDelta;
+    __int64 SizeDelta;
+    std::vector<WCHAR> Name;    // null terminated
+};
+
+static bool HeapDiffRowLess(const HeapDiffRow &lhs, const HeapDiffRow &rhs)
+{
+    // Ascending by size growth so the worst offenders print last.
+    if (lhs.SizeDelta != rhs.SizeDelta)
+        return lhs.SizeDelta < rhs.SizeDelta;
+
+    return lhs.CountDelta < rhs.CountDelta;
+}
+
+static void GetHeapDiffTypeName(DWORD_PTR mt, std::vector<WCHAR> &name)
+{
+    if (IsMTForFreeObj(mt))
+    {
+        wcscpy_s(g_mdName, mdNameLen, W("Free"));
+    }
+    else
+    {
+        wcscpy_s(g_mdName, mdNameLen, W("UNKNOWN"));
+        NameForMT_s(mt, g_mdName, mdNameLen);
+    }
+
+    name.assign(g_mdName, g_mdName + _wcslen(g_mdName) + 1);
+}
+
+static BOOL SaveHeapDiffSnapshot(HeapStat &stats, const char *fileName)
+{
+    FILE *file = NULL;
+    if (fopen_s(&file, fileName, "wb") != 0)
+    {
+        ExtOut("Unable to open file %s\n", fileName);
+        return FALSE;
+    }
+
+    HeapDiffFileHeader header;
+    memcpy(header.Magic, kHeapDiffMagic, sizeof(header.Magic));
+    header.Version = 1;
+    header.EntryCount = (DWORD)stats.Count();
+    fwrite(&header, sizeof(header), 1, file);
+
+    std::vector<WCHAR> name;
+    for (size_t i = 0; i < stats.Count(); i++)
+    {
+        if (IsInterrupt())
+        {
+            fclose(file);
+            return FALSE;
+        }
+
+        HeapDiffFileEntry entry;
+        DWORD_PTR mt;
+        size_t totalSize;
+        stats.GetEntry(i, mt, entry.Count, totalSize);
+        GetHeapDiffTypeName(mt, name);
+
+        entry.MethodTable = mt;
+        entry.TotalSize = totalSize;
+        entry.NameBytes = (DWORD)((name.size() - 1) * sizeof(WCHAR));
+        fwrite(&entry, sizeof(entry), 1, file);
+        fwrite(name.data(), 1, entry.NameBytes, file);
+    }
+
+    fclose(file);
+    ExtOut("Heap snapshot of %d types written to %s\n", (int)stats.Count(), fileName);
+    ExtOut("Run \"" SOSPrefix "heapdiff %s\" again later to see what changed.\n", fileName);
+    return TRUE;
+}
+
+static BOOL PrintHeapDiff(HeapStat &stats, const char *fileName)
+{
+    FILE *file = NULL;
+    if (fopen_s(&file, fileName, "rb") != 0)
+    {
+        ExtOut("Unable to open file %s\n", fileName);
+        return FALSE;
+    }
+
+    HeapDiffFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.Magic, kHeapDiffMagic, sizeof(header.Magic)) != 0 ||
+        header.Version != 1)
+    {
+        ExtOut("%s is not a " SOSPrefix "heapdiff snapshot file\n", fileName);
+        fclose(file);
+        return FALSE;
+    }
+
+    struct OldEntry
+    {
+        ULONG64 TotalSize;
+        DWORD Count;
+        std::vector<WCHAR> Name;
+    };
+
+    std::unordered_map<DWORD_PTR, OldEntry> old;
+    for (DWORD i = 0; i < header.EntryCount; i++)
+    {
+        HeapDiffFileEntry entry;
+        if (fread(&entry, sizeof(entry), 1, file) != 1 || entry.NameBytes % sizeof(WCHAR) != 0)
+        {
+            ExtOut("%s is truncated or corrupt\n", fileName);
+            fclose(file);
+            return FALSE;
+        }
+
+        OldEntry &oldEntry = old[(DWORD_PTR)entry.MethodTable];
+        oldEntry.TotalSize = entry.TotalSize;
+        oldEntry.Count = entry.Count;
+        oldEntry.Name.resize(entry.NameBytes/sizeof(WCHAR) + 1);
+        if (entry.NameBytes != 0 && fread(oldEntry.Name.data(), 1, entry.NameBytes, file) != entry.NameBytes)
+        {
+            ExtOut("%s is truncated or corrupt\n", fileName);
+            fclose(file);
+            return FALSE;
+        }
+        oldEntry.Name[entry.NameBytes/sizeof(WCHAR)] = 0;
+    }
+
+    fclose(file);
+
+    // Pair the current statistics with the snapshot, keeping only the types
+    // whose count or total size changed.
+    std::vector<HeapDiffRow> rows;
+    for (size_t i = 0; i < stats.Count(); i++)
+    {
+        if (IsInterrupt())
+            return FALSE;
+
+        DWORD_PTR mt;
+        DWORD count;
+        size_t totalSize;
+        stats.GetEntry(i, mt, count, totalSize);
+
+        HeapDiffRow row;
+        row.MT = mt;
+        row.CountDelta = count;
+        row.SizeDelta = totalSize;
+
+        std::unordered_map<DWORD_PTR, OldEntry>::iterator itr = old.find(mt);
+        if (itr != old.end())
+        {
+            row.CountDelta -= itr->second.Count;
+            row.SizeDelta -= itr->second.TotalSize;
+            row.Name.swap(itr->second.Name);
+            old.erase(itr);
+        }
+
+        if (row.CountDelta == 0 && row.SizeDelta == 0)
+            continue;
+
+        if (row.Name.empty())
+            GetHeapDiffTypeName(mt, row.Name);
+
+        rows.push_back(row);
+    }
+
+    // Whatever is left in the snapshot disappeared entirely.
+    for (std::unordered_map<DWORD_PTR, OldEntry>::iterator itr = old.begin(); itr != old.end(); ++itr)
+    {
+        HeapDiffRow row;
+        row.MT = itr->first;
+        row.CountDelta = -(__int64)itr->second.Count;
+        row.SizeDelta = -(__int64)itr->second.TotalSize;
+        row.Name.swap(itr->second.Name);
+        rows.push_back(row);
+    }
+
+    std::sort(rows.begin(), rows.end(), HeapDiffRowLess);
+
+    ExtOut("Delta since the snapshot in %s:\n", fileName);
+    ExtOut("%" POINTERSIZE "s %10s %12s %s\n", "MT", "Count", "TotalSize", "Class Name");
+
+    __int64 totalCount = 0, totalSize = 0;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        if (IsInterrupt())
+            return FALSE;
+
+        totalCount += rows[i].CountDelta;
+        totalSize += rows[i].SizeDelta;
+
+        DMLOut("%s %+10I64d %+12I64d ", DMLDumpHeapMT(rows[i].MT), rows[i].CountDelta, rows[i].SizeDelta);
+        ExtOut("%S\n", rows[i].Name.data());
+    }
+
+    ExtOut("Total: %+I64d objects, %+I64d bytes in %d changed types\n",
+        totalCount, totalSize, (int)rows.size());
+    return TRUE;
+}
+
+DECLARE_API(HeapDiff)
+{
+    INIT_API();
+    MINIDUMP_NOT_SUPPORTED();
+
+    BOOL bSave = FALSE;
+    BOOL dml = FALSE;
+    StringHolder fileName;
+
+    CMDOption option[] = 
+    {   // name, vptr, type, hasValue
+        {"-save", &bSave, COBOOL, FALSE},
+        {"/d", &dml, COBOOL, FALSE},
+    };
+    CMDValue arg[] = 
+    {   // vptr, type
+        {&fileName.data, COSTRING},
+    };
+    size_t nArg;
+    if (!GetCMDOption(args, option, _countof(option), arg, _countof(arg), &nArg) || nArg != 1)
+    {
+        ExtOut("usage: HeapDiff [-save] <snapshot-file>\n");
+        return Status;
+    }
+
+    if (!g_snapshot.Build())
+    {
+        ExtOut("Unable to build snapshot of the garbage collector state\n");
+        return E_FAIL;
+    }
+
+    EnableDMLHolder dmlHolder(dml);
+
+    // The first run against a file captures the snapshot; a later run against
+    // the same file prints the deltas.  -save forces a (re)capture.
+    if (!bSave)
+    {
+        FILE *probe = NULL;
+        if (fopen_s(&probe, fileName.data, "rb") == 0)
+            fclose(probe);
+        else
+            bSave = TRUE;
+    }
+
+    try
+    {
+        sos::GCHeap gcheap;
+        if (!gcheap.AreGCStructuresValid())
+            DisplayInvalidStructuresMessage();
+
+        HeapStat stats;
+
+        // Accumulate the per-MethodTable statistics with the parallel walk
+        // engine, falling back to the serial iterator if it cannot run.
+        ParallelHeapWalker walker(gcheap, 0, 0, ~(size_t)0, ~(size_t)0);
+        if (walker.Run())
+        {
+            walker.AddStatsTo(stats);
+        }
+        else
+        {
+            for (sos::ObjectIterator itr = gcheap.WalkHeap(); itr; ++itr)
+                stats.Add((DWORD_PTR)itr->GetMT(), (DWORD)itr->GetSize());
+        }
+
+        if (bSave)
+            return SaveHeapDiffSnapshot(stats, fileName.data) ? S_OK : E_FAIL;
+
+        return PrintHeapDiff(stats, fileName.data) ? S_OK : E_FAIL;
+    }
+    catch(const sos::Exception &e)
+    {
+        ExtOut("%s\n", e.what());
+        return E_FAIL;
+    }
+}
+
+// The session snapshot written and consumed by !sossnapshot: a header that
+// pins the dump identity, then the MethodTable size cache and the MethodTable
+// name cache.  Loading against a different dump (or a resized heap) fails the
+// identity check rather than poisoning the caches.  GCDesc buffers and other
+// host pointers are never written; importers leave them NULL to be refetched
+// lazily.
+struct SessionSnapshotHeader
+{
+    char Magic[8];          // "SOSSNAPS"
+    DWORD Version;          // currently 1
+    DWORD PointerSize;
+    ULONG64 HeapLow;        // GC heap bounds and segment count pin the dump
+    ULONG64 HeapHigh;       //   identity well enough to catch a wrong file
+    DWORD SegmentCount;
+    DWORD SizeEntryCount;
+    DWORD NameEntryCount;
+    DWORD Reserved;
+};
+
+struct SessionSnapshotSizeEntry
+{
+    ULONG64 MethodTable;
+    ULONG64 LoaderAllocatorObjectHandle;
+    ULONG64 ComponentMT;
+    DWORD BaseSize;
+    DWORD ComponentSize;
+    DWORD Flags;            // see the kSnapshot bits below
+    DWORD Reserved;
+};
+
+struct SessionSnapshotNameEntry
+{
+    ULONG64 Key;            // MT address, low bit set for the array-of name
+    DWORD NameBytes;        // UTF-16LE name payload following, no terminator
+    DWORD IsNull;           // cached resolution failure; NameBytes is 0
+};
+
+static const char kSessionSnapshotMagic[8] = { 'S', 'O', 'S', 'S', 'N', 'A', 'P', 'S' };
+
+static const DWORD kSnapshotContainsPointers = 0x1;
+static const DWORD kSnapshotCollectible      = 0x2;
+static const DWORD kSnapshotArrayOfVC        = 0x4;
+static const DWORD kSnapshotComponentMTKnown = 0x8;
+
+// Fills the dump identity fields of the header from the built heap snapshot.
+static void GetSessionSnapshotIdentity(SessionSnapshotHeader *header)
+{
+    TADDR lowest = ~(TADDR)0;
+    TADDR highest = 0;
+    for (int i = 0; i < g_snapshot.GetSegmentCount(); ++i)
+    {
+        const DacpHeapSegmentData *segment = g_snapshot.GetSegmentByIndex(i);
+        if (TO_TADDR(segment->mem) < lowest)
+            lowest = TO_TADDR(segment->mem);
+        if (TO_TADDR(segment->highAllocMark) > highest)
+            highest = TO_TADDR(segment->highAllocMark);
+    }
+
+    header->PointerSize = sizeof(TADDR);
+    header->HeapLow = lowest;
+    header->HeapHigh = highest;
+    header->SegmentCount = (DWORD)g_snapshot.GetSegmentCount();
+}
+
+static void CountSizeCacheEntry(DWORD_PTR, const MethodTableInfo &, void *state)
+{
+    (*(DWORD *)state)++;
+}
+
+static void WriteSizeCacheEntry(DWORD_PTR mt, const MethodTableInfo &info, void *state)
+{
+    SessionSnapshotSizeEntry entry;
+    entry.MethodTable = mt;
+    entry.LoaderAllocatorObjectHandle = info.LoaderAllocatorObjectHandle;
+    entry.ComponentMT = info.ComponentMT;
+    entry.BaseSize = info.BaseSize;
+    entry.ComponentSize = info.ComponentSize;
+    entry.Flags = (info.bContainsPointers ? kSnapshotContainsPointers : 0) |
+                  (info.bCollectible ? kSnapshotCollectible : 0) |
+                  (info.ArrayOfVC ? kSnapshotArrayOfVC : 0) |
+                  (info.ComponentMTKnown ? kSnapshotComponentMTKnown : 0);
+    entry.Reserved = 0;
+    fwrite(&entry, sizeof(entry), 1, (FILE *)state);
+}
+
+struct WriteNameCacheState
+{
+    FILE *File;
+    DWORD Count;
+};
+
+static void WriteNameCacheEntry(TADDR key, const WCHAR *name, void *state)
+{
+    WriteNameCacheState *ws = (WriteNameCacheState *)state;
+
+    SessionSnapshotNameEntry entry;
+    entry.Key = key;
+    entry.NameBytes = name == NULL ? 0 : (DWORD)(_wcslen(name) * sizeof(WCHAR));
+    entry.IsNull = name == NULL;
+    fwrite(&entry, sizeof(entry), 1, ws->File);
+    if (entry.NameBytes != 0)
+        fwrite(name, 1, entry.NameBytes, ws->File);
+    ws->Count++;
+}
+
+static BOOL SaveSessionSnapshot(const char *fileName)
+{
+    FILE *file = NULL;
+    if (fopen_s(&file, fileName, "wb") != 0)
+    {
+        ExtOut("Unable to open file %s\n", fileName);
+        return FALSE;
+    }
+
+    SessionSnapshotHeader header;
+    memcpy(header.Magic, kSessionSnapshotMagic, sizeof(header.Magic));
+    header.Version = 1;
+    GetSessionSnapshotIdentity(&header);
+    header.SizeEntryCount = 0;
+    header.NameEntryCount = 0;
+    header.Reserved = 0;
+
+    g_special_mtCache.Enumerate(CountSizeCacheEntry, &header.SizeEntryCount);
+
+    // The name count is not known until the entries are written (the map has
+    // no cheap size hook here), so the header is rewritten at the end.
+    fwrite(&header, sizeof(header), 1, file);
+    g_special_mtCache.Enumerate(WriteSizeCacheEntry, file);
+
+    WriteNameCacheState ws;
+    ws.File = file;
+    ws.Count = 0;
+    EnumMethodTableNameCache(WriteNameCacheEntry, &ws);
+    header.NameEntryCount = ws.Count;
+
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+
+    ExtOut("Session snapshot saved to %s: %u MethodTable sizes, %u names.\n",
+           fileName, header.SizeEntryCount, header.NameEntryCount);
+    return TRUE;
+}
+
+static BOOL LoadSessionSnapshot(const char *fileName)
+{
+    FILE *file = NULL;
+    if (fopen_s(&file, fileName, "rb") != 0)
+    {
+        ExtOut("Unable to open file %s\n", fileName);
+        return FALSE;
+    }
+
+    SessionSnapshotHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.Magic, kSessionSnapshotMagic, sizeof(header.Magic)) != 0 ||
+        header.Version != 1)
+    {
+        ExtOut("%s is not a " SOSPrefix "sossnapshot file\n", fileName);
+        fclose(file);
+        return FALSE;
+    }
+
+    SessionSnapshotHeader identity;
+    GetSessionSnapshotIdentity(&identity);
+    if (header.PointerSize != identity.PointerSize ||
+        header.HeapLow != identity.HeapLow ||
+        header.HeapHigh != identity.HeapHigh ||
+        header.SegmentCount != identity.SegmentCount)
+    {
+        ExtOut("%s was saved against a different dump; not loading it.\n", fileName);
+        fclose(file);
+        return FALSE;
+    }
+
+    for (DWORD i = 0; i < header.SizeEntryCount; i++)
+    {
+        SessionSnapshotSizeEntry entry;
+        if (fread(&entry, sizeof(entry), 1, file) != 1)
+        {
+            ExtOut("%s is truncated or corrupt\n", fileName);
+            fclose(file);
+            return FALSE;
+        }
+
+        MethodTableInfo *info = g_special_mtCache.Lookup((DWORD_PTR)entry.MethodTable);
+        if (info == NULL)
+        {
+            fclose(file);
+            return FALSE;   // Lookup reported the OOM
+        }
+
+        // Entries the session already warmed win over the file.
+        if (!info->IsInitialized() && entry.BaseSize != 0)
+        {
+            info->BaseSize = entry.BaseSize;
+            info->ComponentSize = entry.ComponentSize;
+            info->bContainsPointers = (entry.Flags & kSnapshotContainsPointers) != 0;
+            info->bCollectible = (entry.Flags & kSnapshotCollectible) != 0;
+            info->ArrayOfVC = (entry.Flags & kSnapshotArrayOfVC) != 0;
+            info->LoaderAllocatorObjectHandle = TO_TADDR(entry.LoaderAllocatorObjectHandle);
+        }
+
+        if (!info->ComponentMTKnown && (entry.Flags & kSnapshotComponentMTKnown) != 0)
+        {
+            info->ComponentMTKnown = true;
+            info->ComponentMT = TO_TADDR(entry.ComponentMT);
+        }
+    }
+
+    std::vector<WCHAR> name;
+    for (DWORD i = 0; i < header.NameEntryCount; i++)
+    {
+        SessionSnapshotNameEntry entry;
+        if (fread(&entry, sizeof(entry), 1, file) != 1 || entry.NameBytes % sizeof(WCHAR) != 0)
+        {
+            ExtOut("%s is truncated or corrupt\n", fileName);
+            fclose(file);
+            return FALSE;
+        }
+
+        if (entry.IsNull)
+        {
+            ImportMethodTableName(TO_TADDR(entry.Key), NULL);
+            continue;
+        }
+
+        name.resize(entry.NameBytes / sizeof(WCHAR) + 1);
+        if (entry.NameBytes != 0 && fread(name.data(), 1, entry.NameBytes, file) != entry.NameBytes)
+        {
+            ExtOut("%s is truncated or corrupt\n", fileName);
+            fclose(file);
+            return FALSE;
+        }
+        name[entry.NameBytes / sizeof(WCHAR)] = 0;
+
+        ImportMethodTableName(TO_TADDR(entry.Key), name.data());
+    }
+
+    fclose(file);
+    ExtOut("Session snapshot loaded from %s: %u MethodTable sizes, %u names.\n",
+           fileName, header.SizeEntryCount, header.NameEntryCount);
+    return TRUE;
+}
+
+// Default snapshot path: a well-known per-dump file in the temp directory, in
+// the same style as the graph index files, so every analyst opening the same
+// dump on a machine shares one warm cache file without coordinating a name.
+// The loader's identity check still validates the contents, so a hash
+// collision only costs a refused load.
+static BOOL GetDefaultSessionSnapshotPath(char *path, size_t cch)
+{
+    SessionSnapshotHeader identity;
+    GetSessionSnapshotIdentity(&identity);
+
+    ULONG64 data[] = { identity.HeapLow, identity.HeapHigh,
+                       ((ULONG64)identity.SegmentCount << 8) | identity.PointerSize };
+    ULONG64 hash = 14695981039346656037ULL;
+    const BYTE *bytes = (const BYTE *)data;
+    for (size_t b = 0; b < sizeof(data); ++b)
+        hash = (hash ^ bytes[b]) * 1099511628211ULL;
+
+    char temp[MAX_LONGPATH];
+    if (GetTempPathA(_countof(temp), temp) == 0)
+        return FALSE;
+
+    sprintf_s(path, (int)cch, "%ssossession-%016I64x.soss", temp, hash);
+    return TRUE;
+}
+
+DECLARE_API(SOSSnapshot)
+{
+    INIT_API();
+    MINIDUMP_NOT_SUPPORTED();
+
+    BOOL bSave = FALSE;
+    BOOL bLoad = FALSE;
+    StringHolder fileName;
+
+    CMDOption option[] =
+    {   // name, vptr, type, hasValue
+        {"-save", &bSave, COBOOL, FALSE},
+        {"-load", &bLoad, COBOOL, FALSE},
+    };
+    CMDValue arg[] =
+    {   // vptr, type
+        {&fileName.data, COSTRING},
+    };
+    size_t nArg;
+    if (!GetCMDOption(args, option, _countof(option), arg, _countof(arg), &nArg) ||
+        nArg > 1 || bSave == bLoad)
+    {
+        ExtOut("usage: SOSSnapshot <-save | -load> [snapshot-file]\n");
+        return Status;
+    }
+
+    if (!IsDumpFile())
+    {
+        // The caches this serializes are all flushed when a live target
+        // runs, so a snapshot of them could never be used.
+        ExtOut("SOSSnapshot only works against a dump file.\n");
+        return E_FAIL;
+    }
+
+    if (!g_snapshot.Build())
+    {
+        ExtOut("Unable to build snapshot of the garbage collector state\n");
+        return E_FAIL;
+    }
+
+    char defaultPath[MAX_LONGPATH];
+    const char *path = fileName.data;
+    if (path == NULL)
+    {
+        if (!GetDefaultSessionSnapshotPath(defaultPath, _countof(defaultPath)))
+        {
+            ExtOut("Unable to compute the default snapshot path; pass a file name.\n");
+            return E_FAIL;
+        }
+        path = defaultPath;
+    }
+
+    if (bSave)
+        return SaveSessionSnapshot(path) ? S_OK : E_FAIL;
+
+    return LoadSessionSnapshot(path) ? S_OK : E_FAIL;
+}
+
 DECLARE_API(VerifyHeap)
-{    
+{
     INIT_API();
     MINIDUMP_NOT_SUPPORTED();
     
@@ -4884,21 +6538,79 @@ DECLARE_API(VerifyHeap)
     try
     {
         bool succeeded = true;
-        char buffer[1024];
         sos::GCHeap gcheap;
-        sos::ObjectIterator itr = gcheap.WalkHeap();
 
-        while (itr)
-        {
-            if (itr.Verify(buffer, _countof(buffer)))
-            {
-                ++itr;
+        // Segments verify independently of one another, so spread them across
+        // the parallel walk pool; the workers only record failures, which are
+        // formatted here in walk order.  If the pool cannot run, fall back to
+        // the serial iterator.
+        ParallelHeapWalker walker(gcheap, 0, 0, ~(size_t)0, ~(size_t)0, TRUE);
+        if (walker.Run())
+        {
+            const std::vector<HeapWalkVerifyFailure> &failures = walker.GetVerifyFailures();
+            for (size_t i = 0; i < failures.size(); i++)
+            {
+                const HeapWalkVerifyFailure &failure = failures[i];
+                succeeded = false;
+
+                switch (failure.Kind)
+                {
+                case HeapWalkVerifyFailure::BadObject:
+                    ExtOut("Could not walk the object at %s; the rest of its segment was skipped.\n",
+                           DMLObject(failure.Object));
+                    break;
+
+                case HeapWalkVerifyFailure::ObjectTooSmall:
+                    ExtOut("Object %s: Size %d is too small.\n", DMLObject(failure.Object), failure.Detail);
+                    break;
+
+                case HeapWalkVerifyFailure::ObjectTooLarge:
+                    ExtOut("Object %s is too large.  End of segment at %p.\n",
+                           DMLObject(failure.Object), SOS_PTR(failure.Detail));
+                    break;
+
+                case HeapWalkVerifyFailure::BadGCDesc:
+                    ExtOut("Object %s has a bad GCDesc.\n", DMLObject(failure.Object));
+                    break;
+
+                case HeapWalkVerifyFailure::BadMemberRead:
+                    ExtOut("Object %s: Failed to read members.\n", DMLObject(failure.Object));
+                    break;
+
+                case HeapWalkVerifyFailure::BadMember:
+                    ExtOut("object %s: bad member %p at %p\n", DMLObject(failure.Object),
+                           SOS_PTR(failure.Member), SOS_PTR(failure.Detail));
+                    break;
+
+                case HeapWalkVerifyFailure::ContainsFreeObject:
+                    ExtOut("object %s contains free object %p at %p\n", DMLObject(failure.Object),
+                           SOS_PTR(failure.Member), SOS_PTR(failure.Detail));
+                    break;
+
+                case HeapWalkVerifyFailure::MissingCardEntry:
+                    ExtOut("Object %s: missing card_table entry for %p\n",
+                           DMLObject(failure.Object), SOS_PTR(failure.Detail));
+                    break;
+                }
             }
-            else
+        }
+        else
+        {
+            char buffer[1024];
+            sos::ObjectIterator itr = gcheap.WalkHeap();
+
+            while (itr)
             {
-                succeeded = false;
-                ExtOut(buffer);
-                itr.MoveToNextObjectCarefully();
+                if (itr.Verify(buffer, _countof(buffer)))
+                {
+                    ++itr;
+                }
+                else
+                {
+                    succeeded = false;
+                    ExtOut(buffer);
+                    itr.MoveToNextObjectCarefully();
+                }
             }
         }
 
@@ -5035,37 +6747,138 @@ DECLARE_API(AnalyzeOOM)
         }
     }
     else
-    {   
-        DWORD dwNHeaps = GetGcHeapCount();
-        DWORD dwAllocSize;
-        if (!ClrSafeInt<DWORD>::multiply(sizeof(CLRDATA_ADDRESS), dwNHeaps, dwAllocSize))
-        {
-            ExtOut("Failed to get GCHeaps:  integer overflow\n");
-            return Status;
-        }
-
-        CLRDATA_ADDRESS *heapAddrs = (CLRDATA_ADDRESS*)alloca(dwAllocSize);
-        if (g_sos->GetGCHeapList(dwNHeaps, heapAddrs, NULL) != S_OK)
+    {
+        // Gather every heap's OOM record up front - the heap addresses come
+        // from the session heap-details snapshot rather than a fresh
+        // GetGCHeapList - and correlate them: on a 64-heap target the same
+        // failure repeated per heap reads as one summary, not 64 screens.
+        if (!g_snapshot.Build())
         {
             ExtOut("Failed to get GCHeaps\n");
             return Status;
         }
-        
-        for (DWORD n = 0; n < dwNHeaps; n ++)
+
+        int nHeaps = g_snapshot.GetHeapCount();
+        std::vector<DacpOomData> heapOom(nHeaps);
+        for (int n = 0; n < nHeaps; n++)
         {
-            if (oomData.Request(g_sos, heapAddrs[n]) != S_OK)
+            if (heapOom[n].Request(g_sos, g_snapshot.GetHeapDetails(n)->heapAddr) != S_OK)
             {
                 ExtOut("Heap %d: Error requesting OOM data\n", n);
                 return E_FAIL;
             }
-            if (oomData.reason != oom_no_failure)
+        }
+
+        // Group the failing heaps by failure kind - reason, detail and heap
+        // flavor - and aggregate the sizes across each group.
+        struct OomGroup
+        {
+            int Reason;
+            int Fgm;
+            BOOL LohP;
+            int HeapCount;
+            ULONG64 AllocTotal;
+            ULONG64 AllocLargest;
+            ULONG64 SizeTotal;
+            ULONG64 GcIndexLow;
+            ULONG64 GcIndexHigh;
+        };
+
+        std::vector<OomGroup> groups;
+        int cOomHeaps = 0;
+
+        for (int n = 0; n < nHeaps; n++)
+        {
+            const DacpOomData &data = heapOom[n];
+            if (data.reason == oom_no_failure)
+                continue;
+
+            cOomHeaps++;
+
+            OomGroup *group = NULL;
+            for (size_t i = 0; i < groups.size(); ++i)
+            {
+                if (groups[i].Reason == data.reason &&
+                    groups[i].Fgm == data.fgm &&
+                    groups[i].LohP == data.loh_p)
+                {
+                    group = &groups[i];
+                    break;
+                }
+            }
+
+            if (group == NULL)
+            {
+                OomGroup fresh = {};
+                fresh.Reason = data.reason;
+                fresh.Fgm = data.fgm;
+                fresh.LohP = data.loh_p;
+                fresh.GcIndexLow = data.gc_index;
+                fresh.GcIndexHigh = data.gc_index;
+                groups.push_back(fresh);
+                group = &groups.back();
+            }
+
+            group->HeapCount++;
+            group->AllocTotal += data.alloc_size;
+            if (data.alloc_size > group->AllocLargest)
+                group->AllocLargest = data.alloc_size;
+            group->SizeTotal += data.size;
+            if (data.gc_index < group->GcIndexLow)
+                group->GcIndexLow = data.gc_index;
+            if (data.gc_index > group->GcIndexHigh)
+                group->GcIndexHigh = data.gc_index;
+        }
+
+        if (cOomHeaps != 0)
+        {
+            bHasManagedOOM = TRUE;
+
+            ExtOut("Managed OOM on %d of %d heaps.\n", cOomHeaps, nHeaps);
+            for (size_t i = 0; i < groups.size(); ++i)
+            {
+                const OomGroup &group = groups[i];
+
+                ExtOut("\n%d heap(s): %s\n", group.HeapCount, str_oom[group.Reason]);
+
+                ExtOut("    Heaps:");
+                for (int n = 0; n < nHeaps; n++)
+                {
+                    if (heapOom[n].reason == group.Reason &&
+                        heapOom[n].fgm == group.Fgm &&
+                        heapOom[n].loh_p == group.LohP)
+                    {
+                        ExtOut(" %d", n);
+                    }
+                }
+                ExtOut("\n");
+
+                if (group.GcIndexLow == group.GcIndexHigh)
+                    ExtOut("    Requested %I64u bytes total (largest %I64u) after GC #%I64u\n",
+                        group.AllocTotal, group.AllocLargest, group.GcIndexLow);
+                else
+                    ExtOut("    Requested %I64u bytes total (largest %I64u) after GCs #%I64u-#%I64u\n",
+                        group.AllocTotal, group.AllocLargest, group.GcIndexLow, group.GcIndexHigh);
+
+                if (group.Fgm != fgm_no_failure)
+                {
+                    ExtOut("    Detail: %s: %s (%I64u bytes total)\n",
+                        (group.LohP ? "LOH" : "SOH"), str_fgm[group.Fgm], group.SizeTotal);
+                }
+            }
+
+            // Commit failures usually trace back to free space the allocator
+            // can't use; the fragmentation report of !dumpheap -stat shows it
+            // per free block.
+            ExtOut("\nUse !dumpheap -stat for the fragmentation report behind these failures.\n");
+
+            for (int n = 0; n < nHeaps; n++)
             {
-                if (!bHasManagedOOM)
+                if (heapOom[n].reason != oom_no_failure)
                 {
-                    bHasManagedOOM = TRUE;
+                    ExtOut("---------Heap %#-2d---------\n", n);
+                    PrintOOMInfo(&heapOom[n]);
                 }
-                ExtOut("---------Heap %#-2d---------\n", n);
-                PrintOOMInfo(&oomData);
             }
         }
     }
@@ -5341,44 +7154,227 @@ DECLARE_API(ListNearObj)
 }
 
 
+/* Free-block data accumulated by the single pass !heapstat -frag makes over
+ * the heap.  Runs of adjacent free objects are merged so a fragmented gap
+ * shows up once with its true size, and only a bounded amount of state is
+ * kept: a power-of-two size histogram, per-generation totals and the largest
+ * runs seen so far.
+ */
+class HeapFragStats
+{
+public:
+    HeapFragStats()
+        : mRunStart(0), mRunSize(0), mRunGen(0)
+    {
+        memset(mBucketCount, 0, sizeof(mBucketCount));
+        memset(mBucketSize, 0, sizeof(mBucketSize));
+        memset(mGenCount, 0, sizeof(mGenCount));
+        memset(mGenSize, 0, sizeof(mGenSize));
+        memset(mLargest, 0, sizeof(mLargest));
+    }
+
+    // Feed every object of the walk, in address order.  Generation 3 is the
+    // large object heap, matching GenUsageStat.
+    void AddObject(TADDR addr, size_t size, bool isFree, int gen)
+    {
+        if (!isFree)
+        {
+            CloseRun();
+            return;
+        }
+
+        if (mRunSize != 0 && mRunStart + mRunSize == addr)
+        {
+            mRunSize += size;
+            return;
+        }
+
+        CloseRun();
+        mRunStart = addr;
+        mRunSize = size;
+        mRunGen = gen;
+    }
+
+    void Done()
+    {
+        CloseRun();
+    }
+
+    void Print() const
+    {
+        ExtOut("\nFree space by size:\n");
+        ExtOut("%12s %12s %12s %12s\n", "Begin", "End", "Blocks", "Bytes");
+        for (int i = 0; i < kBuckets; i++)
+        {
+            if (mBucketCount[i] == 0)
+                continue;
+
+            size_t begin = i == 0 ? 0 : (size_t)kFirstBucket << i;
+            if (i == kBuckets - 1)
+                ExtOut("%12" POINTERSIZE_TYPE "u %12s", begin, "");
+            else
+                ExtOut("%12" POINTERSIZE_TYPE "u %12" POINTERSIZE_TYPE "u",
+                       begin, ((size_t)kFirstBucket << (i+1)) - 1);
+
+            ExtOut(" %12u %12" POINTERSIZE_TYPE "u\n", mBucketCount[i], mBucketSize[i]);
+        }
+
+        ExtOut("\nFree space by generation:\n");
+        ExtOut("%-8s %12s %12s %12s %12s\n", "", "Gen0", "Gen1", "Gen2", "LOH");
+        ExtOut("Blocks   %12u %12u %12u %12u\n",
+               mGenCount[0], mGenCount[1], mGenCount[2], mGenCount[3]);
+        ExtOut("Bytes    %12" POINTERSIZE_TYPE "u %12" POINTERSIZE_TYPE "u %12" POINTERSIZE_TYPE "u %12" POINTERSIZE_TYPE "u\n",
+               mGenSize[0], mGenSize[1], mGenSize[2], mGenSize[3]);
+
+        if (mLargest[0].Size != 0)
+        {
+            ExtOut("\nLargest free runs:\n");
+            ExtOut("%" POINTERSIZE "s %12s\n", "Address", "Size");
+            for (int i = 0; i < kLargestRuns && mLargest[i].Size != 0; i++)
+                ExtOut("%p %12" POINTERSIZE_TYPE "u\n", SOS_PTR(mLargest[i].Addr), mLargest[i].Size);
+        }
+    }
+
+private:
+    // Histogram buckets are [kFirstBucket << i, kFirstBucket << (i+1)); the
+    // first bucket also collects anything smaller, the last anything larger.
+    static const size_t kFirstBucket = 32;
+    static const int kBuckets = 24;
+    static const int kLargestRuns = 10;
+
+    void CloseRun()
+    {
+        if (mRunSize == 0)
+            return;
+
+        int bucket = 0;
+        while (bucket < kBuckets - 1 && mRunSize >= (kFirstBucket << (bucket+1)))
+            bucket++;
+
+        mBucketCount[bucket]++;
+        mBucketSize[bucket] += mRunSize;
+        mGenCount[mRunGen]++;
+        mGenSize[mRunGen] += mRunSize;
+
+        for (int i = 0; i < kLargestRuns; i++)
+        {
+            if (mRunSize > mLargest[i].Size)
+            {
+                for (int j = kLargestRuns - 1; j > i; j--)
+                    mLargest[j] = mLargest[j-1];
+
+                mLargest[i].Addr = mRunStart;
+                mLargest[i].Size = mRunSize;
+                break;
+            }
+        }
+
+        mRunSize = 0;
+    }
+
+    struct FreeRun
+    {
+        TADDR Addr;
+        size_t Size;
+    };
+
+    TADDR mRunStart;
+    size_t mRunSize;
+    int mRunGen;
+
+    DWORD mBucketCount[kBuckets];
+    size_t mBucketSize[kBuckets];
+    DWORD mGenCount[4];
+    size_t mGenSize[4];
+    FreeRun mLargest[kLargestRuns];
+};
+
+static HRESULT PrintHeapFragReport()
+{
+    if (!g_snapshot.Build())
+    {
+        ExtOut("Unable to build snapshot of the garbage collector state\n");
+        return E_FAIL;
+    }
+
+    HeapFragStats stats;
+    sos::GCHeap gcheap;
+
+    for (sos::ObjectIterator itr = gcheap.WalkHeap(); itr; ++itr)
+    {
+        TADDR addr = itr->GetAddress();
+
+        BOOL bLarge = FALSE;
+        int gen;
+        if (g_snapshot.FindSegment(addr, &bLarge) != NULL && bLarge)
+            gen = 3;
+        else
+            gen = g_snapshot.GetGeneration(addr);
+
+        stats.AddObject(addr, itr->GetSize(), itr->IsFree(), gen);
+    }
+
+    stats.Done();
+    stats.Print();
+    return S_OK;
+}
+
 DECLARE_API(GCHeapStat)
 {
     INIT_API();
-    MINIDUMP_NOT_SUPPORTED();    
-    
+    MINIDUMP_NOT_SUPPORTED();
+
 
 #ifndef FEATURE_PAL
 
     BOOL bIncUnreachable = FALSE;
+    BOOL bFrag = FALSE;
     BOOL dml = FALSE;
 
     CMDOption option[] = {
         // name, vptr, type, hasValue
         {"-inclUnrooted", &bIncUnreachable, COBOOL, FALSE},
         {"-iu",           &bIncUnreachable, COBOOL, FALSE},
+        {"-frag",         &bFrag, COBOOL, FALSE},
         {"/d",            &dml, COBOOL, FALSE}
     };
-    
-    if (!GetCMDOption(args, option, _countof(option), NULL, 0, NULL)) 
+
+    if (!GetCMDOption(args, option, _countof(option), NULL, 0, NULL))
     {
         return Status;
     }
 
     EnableDMLHolder dmlHolder(dml);
-    ExtOut("%-8s %12s %12s %12s %12s\n", "Heap", "Gen0", "Gen1", "Gen2", "LOH");
 
-    if (!IsServerBuild())
+    if (bFrag)
     {
-        float tempf;
-        DacpGcHeapDetails heapDetails;
-        if (heapDetails.Request(g_sos) != S_OK)
+        // One pass over the heap replaces the usual
+        // "!dumpheap -type Free and post-process" fragmentation triage.
+        try
         {
-            ExtErr("Error requesting gc heap details\n");
-            return Status;
+            return PrintHeapFragReport();
+        }
+        catch(const sos::Exception &e)
+        {
+            ExtOut("%s\n", e.what());
+            return E_FAIL;
         }
+    }
+
+    ExtOut("%-8s %12s %12s %12s %12s\n", "Heap", "Gen0", "Gen1", "Gen2", "LOH");
+
+    // Per-heap details come from the session snapshot; on a dump an earlier
+    // heap command has usually fetched them already.
+    if (!g_snapshot.Build())
+    {
+        return Status;
+    }
 
+    if (!IsServerBuild())
+    {
+        float tempf;
         HeapUsageStat hpUsage;
-        if (GCHeapUsageStats(heapDetails, bIncUnreachable, &hpUsage))
+        if (GCHeapUsageStats(*g_snapshot.GetHeapDetails(0), bIncUnreachable, &hpUsage))
         {
             ExtOut("Heap%-4d %12" POINTERSIZE_TYPE "u %12" POINTERSIZE_TYPE "u %12" POINTERSIZE_TYPE "u %12" POINTERSIZE_TYPE "u\n", 0, 
                 hpUsage.genUsage[0].allocd, hpUsage.genUsage[1].allocd, 
@@ -5407,27 +7403,7 @@ DECLARE_API(GCHeapStat)
     else
     {
         float tempf;
-        DacpGcHeapData gcheap;
-        if (gcheap.Request(g_sos) != S_OK)
-        {
-            ExtErr("Error requesting GC Heap data\n");
-            return Status;
-        }
-
-        DWORD dwAllocSize;
-        DWORD dwNHeaps = gcheap.HeapCount;
-        if (!ClrSafeInt<DWORD>::multiply(sizeof(CLRDATA_ADDRESS), dwNHeaps, dwAllocSize))
-        {
-            ExtErr("Failed to get GCHeaps:  integer overflow\n");
-            return Status;
-        }
-
-        CLRDATA_ADDRESS *heapAddrs = (CLRDATA_ADDRESS*)alloca(dwAllocSize);
-        if (g_sos->GetGCHeapList(dwNHeaps, heapAddrs, NULL) != S_OK)
-        {
-            ExtErr("Failed to get GCHeaps\n");
-            return Status;
-        }
+        DWORD dwNHeaps = (DWORD)g_snapshot.GetHeapCount();
 
         ArrayHolder<HeapUsageStat> hpUsage = new NOTHROW HeapUsageStat[dwNHeaps];
         if (hpUsage == NULL)
@@ -5441,14 +7417,7 @@ DECLARE_API(GCHeapStat)
 
         for (DWORD n = 0; n < dwNHeaps; n ++)
         {
-            DacpGcHeapDetails heapDetails;
-            if (heapDetails.Request(g_sos, heapAddrs[n]) != S_OK)
-            {
-                ExtErr("Error requesting gc heap details\n");
-                return Status;
-            }
-
-            if (GCHeapUsageStats(heapDetails, bIncUnreachable, &hpUsage[n]))
+            if (GCHeapUsageStats(*g_snapshot.GetHeapDetails(n), bIncUnreachable, &hpUsage[n]))
             {
                 for (int i = 0; i < 4; ++i)
                 {
@@ -5535,12 +7504,14 @@ DECLARE_API(SyncBlk)
     MINIDUMP_NOT_SUPPORTED();    
     
     BOOL bDumpAll = FALSE;
+    BOOL bContended = FALSE;
     size_t nbAsked = 0;
     BOOL dml = FALSE;
 
-    CMDOption option[] = 
+    CMDOption option[] =
     {   // name, vptr, type, hasValue
         {"-all", &bDumpAll, COBOOL, FALSE},
+        {"-contended", &bContended, COBOOL, FALSE},
         {"/d", &dml, COBOOL, FALSE}
     };
     CMDValue arg[] = 
@@ -5562,12 +7533,26 @@ DECLARE_API(SyncBlk)
     }
 
     DWORD dwCount = syncBlockData.SyncBlockCount;
-    
+
+    // The table is output bound on processes with many monitors; batch the
+    // callbacks and serialize the rows without per-cell printf when DML is
+    // off.
+    BufferedOutputHolder bufferedOutput;
+    TableWriter row;
+    row.AddColumn(5);                                 // Index
+    row.AddColumn(POINTERSIZE_HEX, AlignRight, 2);    // SyncBlock
+    row.AddColumn(11);                                // MonitorHeld
+    row.AddColumn(9);                                 // Recursion
+    row.AddColumn(POINTERSIZE_HEX);                   // Owning Thread
+
     ExtOut("Index" WIN64_8SPACES " SyncBlock MonitorHeld Recursion Owning Thread Info" WIN64_8SPACES "  SyncBlock Owner\n");
     ULONG freeCount = 0;
     ULONG CCWCount = 0;
     ULONG RCWCount = 0;
     ULONG CFCount = 0;
+    // The same thread typically owns many syncblocks, so each holding thread
+    // is resolved once.
+    std::unordered_map<CLRDATA_ADDRESS, std::pair<ULONG, ULONG> > holdingThreads;
     for (DWORD nb = 1; nb <= dwCount; nb++)
     {
         if (IsInterrupt())
@@ -5585,64 +7570,151 @@ DECLARE_API(SyncBlk)
             continue;
         }
 
-        BOOL bPrint = (bDumpAll || nb == nbAsked || (syncBlockData.MonitorHeld > 0 && !syncBlockData.bFree));
+        BOOL bPrint;
+        if (bContended)
+        {
+            // MonitorHeld == 1 is an uncontended owner; anything higher means
+            // at least one thread is waiting on the monitor.
+            bPrint = (nb == nbAsked || (syncBlockData.MonitorHeld > 1 && !syncBlockData.bFree));
+        }
+        else
+        {
+            bPrint = (bDumpAll || nb == nbAsked || (syncBlockData.MonitorHeld > 0 && !syncBlockData.bFree));
+        }
 
         if (bPrint)
         {
-            ExtOut("%5d ", nb);
-            if (!syncBlockData.bFree || nb != nbAsked)
-            {            
-                ExtOut("%p  ", syncBlockData.SyncBlockPointer); 
-                ExtOut("%11d ", syncBlockData.MonitorHeld);
-                ExtOut("%9d ", syncBlockData.Recursion);
-                ExtOut("%p ", syncBlockData.HoldingThread);
+            BOOL bDetails = !syncBlockData.bFree || nb != nbAsked;
 
-                if (syncBlockData.HoldingThread == ~0ul)
+            // Resolve the owning thread up front; both output paths need it.
+            ULONG osThreadId = 0;
+            ULONG id = (ULONG)-1;
+            if (bDetails && syncBlockData.HoldingThread != ~0ul && syncBlockData.HoldingThread != NULL)
+            {
+                std::unordered_map<CLRDATA_ADDRESS, std::pair<ULONG, ULONG> >::iterator htItr = holdingThreads.find(syncBlockData.HoldingThread);
+                if (htItr != holdingThreads.end())
                 {
-                    ExtOut(" orphaned ");
+                    osThreadId = htItr->second.first;
+                    id = htItr->second.second;
                 }
-                else if (syncBlockData.HoldingThread != NULL)
+                else
                 {
                     DacpThreadData Thread;
                     if ((Status = Thread.Request(g_sos, syncBlockData.HoldingThread)) != S_OK)
                     {
-                        ExtOut("Failed to request Thread at %p\n", syncBlockData.HoldingThread);
-                        return Status;
+                        ExtOut("Failed to request Thread at %p\n", syncBlockData.HoldingThread);
+                        return Status;
+                    }
+
+                    osThreadId = Thread.osThreadId;
+                    if (g_ExtSystem->GetThreadIdBySystemId(osThreadId, &id) != S_OK)
+                    {
+                        id = (ULONG)-1;
+                    }
+                    holdingThreads[syncBlockData.HoldingThread] = std::make_pair(osThreadId, id);
+                }
+            }
+
+            if (IsDMLEnabled())
+            {
+                ExtOut("%5d ", nb);
+                if (bDetails)
+                {
+                    ExtOut("%p  ", syncBlockData.SyncBlockPointer);
+                    ExtOut("%11d ", syncBlockData.MonitorHeld);
+                    ExtOut("%9d ", syncBlockData.Recursion);
+                    ExtOut("%p ", syncBlockData.HoldingThread);
+
+                    if (syncBlockData.HoldingThread == ~0ul)
+                    {
+                        ExtOut(" orphaned ");
+                    }
+                    else if (syncBlockData.HoldingThread != NULL)
+                    {
+                        DMLOut(DMLThreadID(osThreadId));
+                        if (id != (ULONG)-1)
+                        {
+                            ExtOut("%4d ", id);
+                        }
+                        else
+                        {
+                            ExtOut(" XXX ");
+                        }
+                    }
+                    else
+                    {
+                        ExtOut("    none  ");
+                    }
+
+                    if (syncBlockData.bFree)
+                    {
+                        ExtOut("  %8d", 0);    // TODO: do we need to print the free synctable list?
+                    }
+                    else
+                    {
+                        sos::Object obj = TO_TADDR(syncBlockData.Object);
+                        DMLOut("  %s %S", DMLObject(syncBlockData.Object), obj.GetTypeName());
+                    }
+                }
+            }
+            else
+            {
+                row.WriteDecimal(nb);
+                if (bDetails)
+                {
+                    row.WritePointer(syncBlockData.SyncBlockPointer);
+                    row.WriteDecimal(syncBlockData.MonitorHeld);
+                    row.WriteDecimal(syncBlockData.Recursion);
+                    row.WritePointer(syncBlockData.HoldingThread);
+
+                    if (syncBlockData.HoldingThread == ~0ul)
+                    {
+                        row.WriteText(" orphaned ");
+                    }
+                    else if (syncBlockData.HoldingThread != NULL)
+                    {
+                        row.WriteHex(osThreadId);
+                        if (id != (ULONG)-1)
+                        {
+                            row.WriteDecimal(id, 4);
+                            row.WriteText(" ");
+                        }
+                        else
+                        {
+                            row.WriteText(" XXX ");
+                        }
+                    }
+                    else
+                    {
+                        row.WriteText("    none  ");
                     }
 
-                    DMLOut(DMLThreadID(Thread.osThreadId));
-                    ULONG id;
-                    if (g_ExtSystem->GetThreadIdBySystemId(Thread.osThreadId, &id) == S_OK)
+                    if (syncBlockData.bFree)
                     {
-                        ExtOut("%4d ", id);
+                        row.WriteText("  ");
+                        row.WriteDecimal(0, 8);    // TODO: do we need to print the free synctable list?
                     }
                     else
                     {
-                        ExtOut(" XXX ");
+                        sos::Object obj = TO_TADDR(syncBlockData.Object);
+                        row.WriteText("  ");
+                        row.WritePointer(syncBlockData.Object);
+                        row.WriteText(" ");
+                        row.WriteText(WideToNarrowArena(obj.GetTypeName()));
                     }
                 }
-                else
-                {
-                    ExtOut("    none  ");
-                }
-
-                if (syncBlockData.bFree)
-                {
-                    ExtOut("  %8d", 0);    // TODO: do we need to print the free synctable list?
-                }
-                else
-                {
-                    sos::Object obj = TO_TADDR(syncBlockData.Object);
-                    DMLOut("  %s %S", DMLObject(syncBlockData.Object), obj.GetTypeName());
-                }
             }
         }
                                     
-        if (syncBlockData.bFree) 
+        if (syncBlockData.bFree)
         {
             freeCount ++;
-            if (bPrint) {
-                ExtOut(" Free");
+            if (bPrint)
+            {
+                if (IsDMLEnabled())
+                    ExtOut(" Free");
+                else
+                    row.WriteText(" Free");
             }
         }
         else 
@@ -5697,9 +7769,14 @@ DECLARE_API(SyncBlk)
             }  
             */
         }
-        
+
         if (bPrint)
-            ExtOut("\n");
+        {
+            if (IsDMLEnabled())
+                ExtOut("\n");
+            else
+                row.EndRow();
+        }
     }
     
     ExtOut("-----------------------------\n");
@@ -5879,51 +7956,28 @@ DECLARE_API(FinalizeQueue)
         ExtOut("----------------------------------\n");
     }
 
-    // GC Heap
-    DWORD dwNHeaps = GetGcHeapCount();
+    // GC Heap: the per-heap details come from the session snapshot.
+    if (!g_snapshot.Build())
+    {
+        return Status;
+    }
+
+    DWORD dwNHeaps = (DWORD)g_snapshot.GetHeapCount();
 
     HeapStat hpStat;
 
     if (!IsServerBuild())
     {
-        DacpGcHeapDetails heapDetails;
-        if (heapDetails.Request(g_sos) != S_OK)
-        {
-            ExtOut("Error requesting details\n");
-            return Status;
-        }
-
-        GatherOneHeapFinalization(heapDetails, &hpStat, bAllReady, bShort);
+        GatherOneHeapFinalization(*g_snapshot.GetHeapDetails(0), &hpStat, bAllReady, bShort);
     }
     else
-    {   
-        DWORD dwAllocSize;
-        if (!ClrSafeInt<DWORD>::multiply(sizeof(CLRDATA_ADDRESS), dwNHeaps, dwAllocSize))
-        {
-            ExtOut("Failed to get GCHeaps:  integer overflow\n");
-            return Status;
-        }
-
-        CLRDATA_ADDRESS *heapAddrs = (CLRDATA_ADDRESS*)alloca(dwAllocSize);
-        if (g_sos->GetGCHeapList(dwNHeaps, heapAddrs, NULL) != S_OK)
-        {
-            ExtOut("Failed to get GCHeaps\n");
-            return Status;
-        }
-        
+    {
         for (DWORD n = 0; n < dwNHeaps; n ++)
         {
-            DacpGcHeapDetails heapDetails;
-            if (heapDetails.Request(g_sos, heapAddrs[n]) != S_OK)
-            {
-                ExtOut("Error requesting details\n");
-                return Status;
-            }
-
             ExtOut("------------------------------\n");
             ExtOut("Heap %d\n", n);
-            GatherOneHeapFinalization(heapDetails, &hpStat, bAllReady, bShort);
-        }        
+            GatherOneHeapFinalization(*g_snapshot.GetHeapDetails(n), &hpStat, bAllReady, bShort);
+        }
     }
     
     if (!bShort)
@@ -6265,6 +8319,20 @@ String GetHostingCapabilities(DWORD hostConfig)
     return result;
 }
 
+/* Resolves the debugger thread id for an OS thread id, preferring the map
+ * built by one bulk enumeration over a per-thread engine call.
+ */
+static bool FindDebuggerThreadId(const std::unordered_map<ULONG, ULONG> &debuggerIds, ULONG osThreadId, ULONG *id)
+{
+    std::unordered_map<ULONG, ULONG>::const_iterator itr = debuggerIds.find(osThreadId);
+    if (itr != debuggerIds.end())
+    {
+        *id = itr->second;
+        return true;
+    }
+    return g_ExtSystem->GetThreadIdBySystemId(osThreadId, id) == S_OK;
+}
+
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
@@ -6323,36 +8391,57 @@ HRESULT PrintThreadsFromThreadStore(BOOL bMiniDump, BOOL bPrintLiveThreadsOnly)
         table.WriteColumn("Fiber");
 
     table.WriteColumn("Exception");
-    
-    DacpThreadData Thread;
-    CLRDATA_ADDRESS CurThread = ThreadStore.firstThread;
-    while (CurThread)
+
+    // One bulk enumeration of the debugger's thread table replaces a
+    // GetThreadIdBySystemId round trip per managed thread below.
+    std::unordered_map<ULONG, ULONG> debuggerIds;
+#ifndef FEATURE_PAL
+    if (!IsKernelDebugger())
+    {
+        ULONG numThreads = 0;
+        if (SUCCEEDED(g_ExtSystem->GetNumberThreads(&numThreads)) && numThreads > 0)
+        {
+            ArrayHolder<ULONG> ids = new NOTHROW ULONG[numThreads];
+            ArrayHolder<ULONG> sysIds = new NOTHROW ULONG[numThreads];
+            if (ids != NULL && sysIds != NULL &&
+                SUCCEEDED(g_ExtSystem->GetThreadIdsByIndex(0, numThreads, ids, sysIds)))
+            {
+                for (ULONG i = 0; i < numThreads; i++)
+                    debuggerIds[sysIds[i]] = ids[i];
+            }
+        }
+    }
+#endif // FEATURE_PAL
+
+    // Gather the thread list first; the exception objects behind the threads'
+    // last-thrown handles resolve in bulk that way.
+    std::vector<ManagedThreadInfo> threads;
+    if ((Status = CollectManagedThreads(ThreadStore, threads)) != S_OK)
+        return Status;
+
+    for (size_t t = 0; t < threads.size(); ++t)
     {
         if (IsInterrupt())
             break;
 
-        if ((Status = Thread.Request(g_sos, CurThread)) != S_OK)
-        {
-            PrintLn("Failed to request Thread at ", Pointer(CurThread));
-            return Status;
-        }
+        const DacpThreadData &Thread = threads[t].Data;
+        CLRDATA_ADDRESS CurThread = threads[t].Address;
 
         BOOL bSwitchedOutFiber = Thread.osThreadId == SWITCHED_OUT_FIBER_OSID;
         if (!IsKernelDebugger())
         {
-            ULONG id = 0;          
-            
+            ULONG id = 0;
+
             if (bSwitchedOutFiber)
             {
                 table.WriteColumn(0, "<<<< ");
             }
-            else if (g_ExtSystem->GetThreadIdBySystemId(Thread.osThreadId, &id) == S_OK)
+            else if (FindDebuggerThreadId(debuggerIds, Thread.osThreadId, &id))
             {
                 table.WriteColumn(0, Decimal(id));
             }
             else if (bPrintLiveThreadsOnly)
             {
-                CurThread = Thread.nextThread;
                 continue;
             }
             else
@@ -6432,26 +8521,124 @@ HRESULT PrintThreadsFromThreadStore(BOOL bMiniDump, BOOL bPrintLiveThreadsOnly)
             lastCol += W("(Threadpool Completion Port) ");
         
         
-        TADDR taLTOH;
-        if (Thread.lastThrownObjectHandle && SafeReadMemory(TO_TADDR(Thread.lastThrownObjectHandle),
-                                                            &taLTOH, sizeof(taLTOH), NULL) && taLTOH)
+        TADDR taLTOH = threads[t].LastThrownObject;
+        if (taLTOH && threads[t].LastThrownMTKnown)
+        {
+            // Exception types repeat across threads; the interned name
+            // cache resolves each distinct type once.
+            const WCHAR *mtName = GetInternedMethodTableName(threads[t].LastThrownMT);
+            if (mtName != NULL)
+                lastCol += WString(mtName) + W(" ") + ExceptionPtr(taLTOH);
+            else
+                lastCol += WString(W("<Invalid Object> (")) + Pointer(taLTOH) + W(")");
+
+            // Print something if there are nested exceptions on the thread
+            if (Thread.firstNestedException)
+                lastCol += W(" (nested exceptions)");
+        }
+
+        table.WriteColumn(lastCol);
+    }
+
+    return Status;
+}
+
+// The -json twin of PrintThreadsFromThreadStore: one JSON record per managed
+// thread, no summary table, no column formatting.
+HRESULT PrintThreadsFromThreadStoreJson(BOOL bPrintLiveThreadsOnly)
+{
+    HRESULT Status;
+
+    DacpThreadStoreData ThreadStore;
+    if ((Status = ThreadStore.Request(g_sos)) != S_OK)
+    {
+        Print("Failed to request ThreadStore\n");
+        return Status;
+    }
+
+    // Same bulk enumeration of the debugger's thread table as the text
+    // printer.
+    std::unordered_map<ULONG, ULONG> debuggerIds;
+#ifndef FEATURE_PAL
+    if (!IsKernelDebugger())
+    {
+        ULONG numThreads = 0;
+        if (SUCCEEDED(g_ExtSystem->GetNumberThreads(&numThreads)) && numThreads > 0)
         {
-            TADDR taMT;
-            if (SafeReadMemory(taLTOH, &taMT, sizeof(taMT), NULL))
+            ArrayHolder<ULONG> ids = new NOTHROW ULONG[numThreads];
+            ArrayHolder<ULONG> sysIds = new NOTHROW ULONG[numThreads];
+            if (ids != NULL && sysIds != NULL &&
+                SUCCEEDED(g_ExtSystem->GetThreadIdsByIndex(0, numThreads, ids, sysIds)))
             {
-                if (NameForMT_s(taMT, g_mdName, mdNameLen))
-                    lastCol += WString(g_mdName) + W(" ") + ExceptionPtr(taLTOH);
-                else
-                    lastCol += WString(W("<Invalid Object> (")) + Pointer(taLTOH) + W(")");
-
-                // Print something if there are nested exceptions on the thread
-                if (Thread.firstNestedException)
-                    lastCol += W(" (nested exceptions)");
+                for (ULONG i = 0; i < numThreads; i++)
+                    debuggerIds[sysIds[i]] = ids[i];
             }
         }
+    }
+#endif // FEATURE_PAL
+
+    const int TS_TPWorkerThread       = 0x01000000;
+    const int TS_CompletionPortThread = 0x08000000;
+
+    // Same up-front thread gathering and bulk exception resolution as the
+    // text printer.
+    std::vector<ManagedThreadInfo> threads;
+    if ((Status = CollectManagedThreads(ThreadStore, threads)) != S_OK)
+        return Status;
+
+    JsonWriter json;
+    for (size_t t = 0; t < threads.size(); ++t)
+    {
+        if (IsInterrupt())
+            break;
+
+        const DacpThreadData &Thread = threads[t].Data;
+        CLRDATA_ADDRESS CurThread = threads[t].Address;
+
+        BOOL bSwitchedOutFiber = Thread.osThreadId == SWITCHED_OUT_FIBER_OSID;
+        ULONG id = 0;
+        BOOL bHasDebuggerId = FALSE;
+        if (!IsKernelDebugger() && !bSwitchedOutFiber)
+        {
+            bHasDebuggerId = FindDebuggerThreadId(debuggerIds, Thread.osThreadId, &id);
+            if (!bHasDebuggerId && bPrintLiveThreadsOnly)
+                continue;
+        }
 
-        table.WriteColumn(lastCol);
-        CurThread = Thread.nextThread;
+        json.BeginRecord("thread");
+        if (bHasDebuggerId)
+            json.Field("dbgId", (ULONG64)id);
+        json.Field("id", (ULONG64)Thread.corThreadId);
+        json.FieldHex("osId", bSwitchedOutFiber ? 0 : Thread.osThreadId);
+        json.FieldHex("threadObj", CurThread);
+        json.FieldHex("state", Thread.state);
+        json.Field("gcMode", Thread.preemptiveGCDisabled == 1 ? "Cooperative" : "Preemptive");
+
+        CLRDATA_ADDRESS domain = Thread.domain;
+        if (domain == 0)
+            g_sos->GetDomainFromContext(Thread.context, &domain);
+        json.FieldHex("domain", domain);
+
+        json.Field("lockCount", (ULONG64)Thread.lockCount);
+        json.FieldBool("finalizer", CurThread == ThreadStore.finalizerThread);
+        json.FieldBool("gc", CurThread == ThreadStore.gcThread);
+        json.FieldBool("threadpoolWorker", (Thread.state & TS_TPWorkerThread) != 0);
+        json.FieldBool("threadpoolCompletionPort", (Thread.state & TS_CompletionPortThread) != 0);
+
+        TADDR taLTOH = threads[t].LastThrownObject;
+        if (taLTOH)
+        {
+            json.FieldHex("exception", taLTOH);
+
+            if (threads[t].LastThrownMTKnown)
+            {
+                const WCHAR *mtName = GetInternedMethodTableName(threads[t].LastThrownMT);
+                if (mtName != NULL)
+                    json.Field("exceptionType", mtName);
+            }
+            json.FieldBool("nestedExceptions", Thread.firstNestedException != 0);
+        }
+        json.EndRecord();
     }
 
     return Status;
@@ -6763,13 +8950,15 @@ DECLARE_API(Threads)
     BOOL bPrintSpecialThreads = FALSE;
     BOOL bPrintLiveThreadsOnly = FALSE;
     BOOL bSwitchToManagedExceptionThread = FALSE;
+    BOOL bJson = FALSE;
     BOOL dml = FALSE;
 
-    CMDOption option[] = 
+    CMDOption option[] =
     {   // name, vptr, type, hasValue
         {"-special", &bPrintSpecialThreads, COBOOL, FALSE},
         {"-live", &bPrintLiveThreadsOnly, COBOOL, FALSE},
         {"-managedexception", &bSwitchToManagedExceptionThread, COBOOL, FALSE},
+        {"-json", &bJson, COBOOL, FALSE},
 #ifndef FEATURE_PAL
         {"/d", &dml, COBOOL, FALSE},
 #endif
@@ -6796,7 +8985,9 @@ DECLARE_API(Threads)
 
     try
     {
-        Status = PrintThreadsFromThreadStore(bMiniDump, bPrintLiveThreadsOnly);
+        Status = bJson
+            ? PrintThreadsFromThreadStoreJson(bPrintLiveThreadsOnly)
+            : PrintThreadsFromThreadStore(bMiniDump, bPrintLiveThreadsOnly);
         if (!bMiniDump && bPrintSpecialThreads)
         {
 #ifdef FEATURE_PAL
@@ -8205,6 +10396,61 @@ DECLARE_API(bpmd)
 *    This function is called to dump the managed threadpool            *
 *                                                                      *
 \**********************************************************************/
+/* Records one queued work item for !threadpool -wi: adds it to the by-type
+ * histogram, resolves its delegate for the by-delegate histogram, and prints
+ * the per-item line (suppressed while sampling).  Delegate method descriptors
+ * are stored as-is; items with no resolvable delegate fall back to the work
+ * item's method table, tagged in the low bit so both kinds share one map.
+ * queueLabel is non-NULL for the global queue; local queues print the queue
+ * object's address instead.
+ */
+static void RecordQueuedWorkItem(sos::Object &workItem, const char *queueLabel, TADDR queueAddr,
+                                 bool sampling, HeapStat &stats,
+                                 std::unordered_map<DWORD_PTR, size_t> &delegateCounts)
+{
+    stats.Add((DWORD_PTR)workItem.GetMT(), (DWORD)workItem.GetSize());
+
+    if (!sampling)
+    {
+        if (queueLabel != NULL)
+            DMLOut("%" POINTERSIZE "s %s %S", queueLabel, DMLObject(workItem.GetAddress()), workItem.GetTypeName());
+        else
+            DMLOut("%s %s %S", DMLObject(queueAddr), DMLObject(workItem.GetAddress()), workItem.GetTypeName());
+    }
+
+    int offset;
+    CLRDATA_ADDRESS md = NULL;
+    if ((offset = GetObjFieldOffset(workItem.GetAddress(), workItem.GetMT(), W("_callback"))) > 0 ||
+        (offset = GetObjFieldOffset(workItem.GetAddress(), workItem.GetMT(), W("m_action"))) > 0)
+    {
+        CLRDATA_ADDRESS delegatePtr = NULL;
+        MOVE(delegatePtr, workItem.GetAddress() + offset);
+        if (!TryGetMethodDescriptorForDelegate(delegatePtr, &md))
+        {
+            md = NULL;
+        }
+    }
+
+    if (md != NULL)
+    {
+        delegateCounts[(DWORD_PTR)md]++;
+        if (!sampling)
+        {
+            NameForMD_s((DWORD_PTR)md, g_mdName, mdNameLen);
+            ExtOut(" => %S", g_mdName);
+        }
+    }
+    else
+    {
+        delegateCounts[((DWORD_PTR)workItem.GetMT()) | 1]++;
+    }
+
+    if (!sampling)
+    {
+        ExtOut("\n");
+    }
+}
+
 DECLARE_API(ThreadPool)
 {
     INIT_API();
@@ -8215,24 +10461,32 @@ DECLARE_API(ThreadPool)
     if ((Status = threadpool.Request(g_sos)) == S_OK)
     {
         BOOL doHCDump = FALSE, doWorkItemDump = FALSE, dml = FALSE;
+        size_t sampleLimit = 0;
 
-        CMDOption option[] = 
+        CMDOption option[] =
         {   // name, vptr, type, hasValue
             {"-ti", &doHCDump, COBOOL, FALSE},
             {"-wi", &doWorkItemDump, COBOOL, FALSE},
+            {"-sample", &sampleLimit, COSIZE_T, TRUE},
 #ifndef FEATURE_PAL
             {"/d", &dml, COBOOL, FALSE},
 #endif
-        };    
+        };
 
-        if (!GetCMDOption(args, option, _countof(option), NULL, 0, NULL)) 
+        if (!GetCMDOption(args, option, _countof(option), NULL, 0, NULL))
         {
             return Status;
         }
 
+        // -sample only makes sense for the work item dump.
+        if (sampleLimit > 0)
+        {
+            doWorkItemDump = TRUE;
+        }
+
         EnableDMLHolder dmlHolder(dml);
 
-        ExtOut ("CPU utilization: %d%%\n", threadpool.cpuUtilization);            
+        ExtOut ("CPU utilization: %d%%\n", threadpool.cpuUtilization);
         ExtOut ("Worker Thread:");
         ExtOut (" Total: %d", threadpool.NumWorkingWorkerThreads + threadpool.NumIdleWorkerThreads + threadpool.NumRetiredWorkerThreads);
         ExtOut (" Running: %d", threadpool.NumWorkingWorkerThreads);
@@ -8297,18 +10551,49 @@ DECLARE_API(ThreadPool)
             GetInfoFromName(corelibModule, "System.Threading.ThreadPoolWorkQueue+WorkStealingQueue", &threadPoolWorkStealingQueueMd);
 
             // Walk every heap item looking for the global queue and local queues.
-            ExtOut("\nQueued work items:\n%" POINTERSIZE "s %" POINTERSIZE "s %s\n", "Queue", "Address", "Work Item");
+            const bool sampling = (sampleLimit > 0);
+            if (sampling)
+                ExtOut("\nSampling the first %d queued work items:\n", (int)sampleLimit);
+            else
+                ExtOut("\nQueued work items:\n%" POINTERSIZE "s %" POINTERSIZE "s %s\n", "Queue", "Address", "Work Item");
             HeapStat stats;
-            for (sos::ObjectIterator itr = gcheap.WalkHeap(); !IsInterrupt() && itr != NULL; ++itr)
+            size_t sampled = 0;
+            std::unordered_map<DWORD_PTR, size_t> delegateCounts;
+            // Memoized queue-type filter: 0 = neither, 1 = global queue,
+            // 2 = work-stealing queue.  Resolving each distinct method table
+            // once beats one DacpMethodTableData request per heap object.
+            std::unordered_map<DWORD_PTR, int> queueKinds;
+            for (sos::ObjectIterator itr = gcheap.WalkHeap();
+                 !IsInterrupt() && itr != NULL && !(sampling && sampled >= sampleLimit);
+                 ++itr)
             {
-                DacpMethodTableData mtdata;
-                if (mtdata.Request(g_sos, TO_TADDR(itr->GetMT())) != S_OK ||
-                    mtdata.Module != corelibModule)
+                int queueKind;
+                std::unordered_map<DWORD_PTR, int>::iterator kindItr = queueKinds.find((DWORD_PTR)itr->GetMT());
+                if (kindItr != queueKinds.end())
+                {
+                    queueKind = kindItr->second;
+                }
+                else
+                {
+                    queueKind = 0;
+                    DacpMethodTableData mtdata;
+                    if (mtdata.Request(g_sos, TO_TADDR(itr->GetMT())) == S_OK &&
+                        mtdata.Module == corelibModule)
+                    {
+                        if (mtdata.cl == threadPoolWorkQueueMd)
+                            queueKind = 1;
+                        else if (mtdata.cl == threadPoolWorkStealingQueueMd)
+                            queueKind = 2;
+                    }
+                    queueKinds[(DWORD_PTR)itr->GetMT()] = queueKind;
+                }
+
+                if (queueKind == 0)
                 {
                     continue;
                 }
 
-                if (mtdata.cl == threadPoolWorkQueueMd)
+                if (queueKind == 1)
                 {
                     // We found a global queue (there should be only one, given one AppDomain).
                     // Get its workItems ConcurrentQueue<IThreadPoolWorkItem>.
@@ -8356,25 +10641,20 @@ DECLARE_API(ThreadPool)
                                             if (workItemPtr != NULL && sos::IsObject(workItemPtr, false))
                                             {
                                                 sos::Object workItem = TO_TADDR(workItemPtr);
-                                                stats.Add((DWORD_PTR)workItem.GetMT(), (DWORD)workItem.GetSize());
-                                                DMLOut("%" POINTERSIZE "s %s %S", "[Global]", DMLObject(workItem.GetAddress()), workItem.GetTypeName());
-                                                if ((offset = GetObjFieldOffset(workItem.GetAddress(), workItem.GetMT(), W("_callback"))) > 0 ||
-                                                    (offset = GetObjFieldOffset(workItem.GetAddress(), workItem.GetMT(), W("m_action"))) > 0)
+                                                RecordQueuedWorkItem(workItem, "[Global]", 0, sampling, stats, delegateCounts);
+                                                if (sampling && ++sampled >= sampleLimit)
                                                 {
-                                                    CLRDATA_ADDRESS delegatePtr;
-                                                    MOVE(delegatePtr, workItem.GetAddress() + offset);
-                                                    CLRDATA_ADDRESS md;
-                                                    if (TryGetMethodDescriptorForDelegate(delegatePtr, &md))
-                                                    {
-                                                        NameForMD_s((DWORD_PTR)md, g_mdName, mdNameLen);
-                                                        ExtOut(" => %S", g_mdName);
-                                                    }
+                                                    break;
                                                 }
-                                                ExtOut("\n");
                                             }
                                         }
                                     }
 
+                                    if (sampling && sampled >= sampleLimit)
+                                    {
+                                        break;
+                                    }
+
                                     // Move to the next segment.
                                     DacpFieldDescData segmentField;
                                     offset = GetObjFieldOffset(segment.GetAddress(), segment.GetMT(), W("_nextSegment"), TRUE, &segmentField);
@@ -8393,7 +10673,7 @@ DECLARE_API(ThreadPool)
                         }
                     }
                 }
-                else if (mtdata.cl == threadPoolWorkStealingQueueMd)
+                else
                 {
                     // We found a local queue.  Get its work items array.
                     int offset = GetObjFieldOffset(itr->GetAddress(), itr->GetMT(), W("m_array"));
@@ -8403,30 +10683,24 @@ DECLARE_API(ThreadPool)
                         DWORD_PTR workItemArrayPtr;
                         MOVE(workItemArrayPtr, itr->GetAddress() + offset);
                         DacpObjectData workItemArray;
+                        std::vector<DWORD_PTR> workItems;
                         if (workItemArray.Request(g_sos, TO_CDADDR(workItemArrayPtr)) == S_OK && workItemArray.ObjectType == OBJ_ARRAY)
                         {
-                            for (int i = 0; i < workItemArray.dwNumComponents; i++)
+                            workItems.resize(workItemArray.dwNumComponents);
+                            if (FAILED(moveArray(workItems.data(), TO_TADDR(workItemArray.ArrayDataPtr), workItems.size())))
+                                workItems.clear();
+
+                            for (size_t i = 0; i < workItems.size(); i++)
                             {
-                                CLRDATA_ADDRESS workItemPtr;
-                                MOVE(workItemPtr, TO_CDADDR(workItemArray.ArrayDataPtr + (i * workItemArray.dwComponentSize)));
+                                CLRDATA_ADDRESS workItemPtr = TO_CDADDR(workItems[i]);
                                 if (workItemPtr != NULL && sos::IsObject(workItemPtr, false))
                                 {
                                     sos::Object workItem = TO_TADDR(workItemPtr);
-                                    stats.Add((DWORD_PTR)workItem.GetMT(), (DWORD)workItem.GetSize());
-                                    DMLOut("%s %s %S", DMLObject(itr->GetAddress()), DMLObject(workItem.GetAddress()), workItem.GetTypeName());
-                                    if ((offset = GetObjFieldOffset(workItem.GetAddress(), workItem.GetMT(), W("_callback"))) > 0 ||
-                                        (offset = GetObjFieldOffset(workItem.GetAddress(), workItem.GetMT(), W("m_action"))) > 0)
+                                    RecordQueuedWorkItem(workItem, NULL, itr->GetAddress(), sampling, stats, delegateCounts);
+                                    if (sampling && ++sampled >= sampleLimit)
                                     {
-                                        CLRDATA_ADDRESS delegatePtr;
-                                        MOVE(delegatePtr, workItem.GetAddress() + offset);
-                                        CLRDATA_ADDRESS md;
-                                        if (TryGetMethodDescriptorForDelegate(delegatePtr, &md))
-                                        {
-                                            NameForMD_s((DWORD_PTR)md, g_mdName, mdNameLen);
-                                            ExtOut(" => %S", g_mdName);
-                                        }
+                                        break;
                                     }
-                                    ExtOut("\n");
                                 }
                             }
                         }
@@ -8437,6 +10711,36 @@ DECLARE_API(ThreadPool)
             // Output a summary.
             stats.Sort();
             stats.Print();
+
+            if (!delegateCounts.empty())
+            {
+                std::vector<std::pair<DWORD_PTR, size_t> > byDelegate(delegateCounts.begin(), delegateCounts.end());
+                std::sort(byDelegate.begin(), byDelegate.end(),
+                    [] (const std::pair<DWORD_PTR, size_t> &lhs, const std::pair<DWORD_PTR, size_t> &rhs)
+                    {
+                        return lhs.second > rhs.second;
+                    });
+
+                ExtOut("\nWork items by delegate:\n%8s %s\n", "Count", "Delegate");
+                for (size_t i = 0; i < byDelegate.size(); i++)
+                {
+                    if (byDelegate[i].first & 1)
+                    {
+                        const WCHAR *name = GetInternedMethodTableName((TADDR)(byDelegate[i].first & ~(DWORD_PTR)1));
+                        ExtOut("%8d %S (no delegate)\n", (int)byDelegate[i].second, name != NULL ? name : W("<unknown>"));
+                    }
+                    else
+                    {
+                        NameForMD_s(byDelegate[i].first, g_mdName, mdNameLen);
+                        ExtOut("%8d %S\n", (int)byDelegate[i].second, g_mdName);
+                    }
+                }
+            }
+
+            if (sampling && sampled >= sampleLimit)
+            {
+                ExtOut("\nStopped after sampling %d work items; counts are a lower bound.\n", (int)sampled);
+            }
             ExtOut("\n");
         }
 
@@ -8521,40 +10825,103 @@ DECLARE_API(FindAppDomain)
     INIT_API();
     MINIDUMP_NOT_SUPPORTED();    
     
-    DWORD_PTR p_Object = NULL;
+    BOOL bAll = FALSE;
     BOOL dml = FALSE;
 
-    CMDOption option[] = 
+    CMDOption option[] =
     {   // name, vptr, type, hasValue
+        {"-all", &bAll, COBOOL, FALSE},
 #ifndef FEATURE_PAL
         {"/d", &dml, COBOOL, FALSE},
 #endif
     };
-    CMDValue arg[] = 
-    {   // vptr, type
-        {&p_Object, COHEX},
-    };
-    size_t nArg;
 
-    if (!GetCMDOption(args, option, _countof(option), arg, _countof(arg), &nArg)) 
+    // -all annotates a whole list of object addresses in one pass, so size
+    // the argument array to the input instead of a single address.
+    size_t maxArg = 1;
+    for (const char *cp = args; *cp != '\0'; cp++)
+    {
+        if (isspace(*cp))
+            maxArg++;
+    }
+
+    ArrayHolder<DWORD_PTR> addrs = new NOTHROW DWORD_PTR[maxArg];
+    ArrayHolder<CMDValue> arg = new NOTHROW CMDValue[maxArg];
+    if (addrs == NULL || arg == NULL)
     {
+        ReportOOM();
         return Status;
     }
+    for (size_t i = 0; i < maxArg; i++)
+    {
+        addrs[i] = 0;
+        arg[i].vptr = &addrs[i];
+        arg[i].type = COHEX;
+    }
+    size_t nArg;
 
-    EnableDMLHolder dmlHolder(dml);
-    
-    if ((p_Object == 0) || !sos::IsObject(p_Object))
+    if (!GetCMDOption(args, option, _countof(option), arg, maxArg, &nArg))
     {
-        ExtOut("%p is not a valid object\n", SOS_PTR(p_Object));
         return Status;
     }
-    
+
+    EnableDMLHolder dmlHolder(dml);
+
     DacpAppDomainStoreData adstore;
     if (adstore.Request(g_sos) != S_OK)
     {
-        ExtOut("Error getting AppDomain information\n");
+        ExtOut("Error getting AppDomain information\n");
+        return Status;
+    }
+
+    if (bAll || nArg > 1)
+    {
+        ExtOut("%" POINTERSIZE "s %" POINTERSIZE "s %s\n", "Object", "AppDomain", "Name");
+
+        for (size_t n = 0; n < nArg; n++)
+        {
+            if (IsInterrupt())
+                return Status;
+
+            if ((addrs[n] == 0) || !sos::IsObject(addrs[n]))
+            {
+                ExtOut("%p %" POINTERSIZE "s not a valid object\n", SOS_PTR(addrs[n]), "");
+                continue;
+            }
+
+            CLRDATA_ADDRESS domain = GetAppDomain(TO_CDADDR(addrs[n]));
+            if (domain == NULL)
+            {
+                DMLOut("%s %" POINTERSIZE "s unknown\n", DMLObject(addrs[n]), "");
+            }
+            else if (domain == adstore.sharedDomain)
+            {
+                DMLOut("%s %s Shared Domain\n", DMLObject(addrs[n]), DMLDomain(domain));
+            }
+            else if (domain == adstore.systemDomain)
+            {
+                DMLOut("%s %s System Domain\n", DMLObject(addrs[n]), DMLDomain(domain));
+            }
+            else
+            {
+                if (g_sos->GetAppDomainName(domain, mdNameLen, g_mdName, NULL) != S_OK)
+                {
+                    g_mdName[0] = W('\0');
+                }
+                DMLOut("%s %s %S\n", DMLObject(addrs[n]), DMLDomain(domain),
+                    (g_mdName[0] != W('\0')) ? g_mdName : W("None"));
+            }
+        }
+
+        return Status;
+    }
+
+    DWORD_PTR p_Object = addrs[0];
+    if ((p_Object == 0) || !sos::IsObject(p_Object))
+    {
+        ExtOut("%p is not a valid object\n", SOS_PTR(p_Object));
         return Status;
-    }    
+    }
 
     CLRDATA_ADDRESS appDomain = GetAppDomain (TO_CDADDR(p_Object));
 
@@ -8846,25 +11213,79 @@ DECLARE_API(EHInfo)
     DumpMDInfo(TO_TADDR(MD.MethodDescPtr));
 
     ExtOut("\n");
-    Status = g_sos->TraverseEHInfo(TO_CDADDR(MD.NativeCodeAddr), traverseEh, (LPVOID)MD.NativeCodeAddr);
 
-    if (Status == E_ABORT)
+    // the gathered clause table is cached by MethodDesc, so repeated queries
+    // against the same method only decode it once
+    SOSEHInfo *pInfo = GetEHInfoForMethod(tmpAddr, TO_CDADDR(MD.NativeCodeAddr), &Status);
+    if (pInfo != NULL)
+    {
+        for (UINT i = 0; i < pInfo->EHCount; i++)
+        {
+            if (!traverseEh(i, pInfo->EHCount, &pInfo->m_pInfos[i], (LPVOID)MD.NativeCodeAddr))
+            {
+                break;
+            }
+        }
+    }
+    else if (Status == E_ABORT)
     {
         ExtOut("<user aborted>\n");
     }
-    else if (Status != S_OK)
+    else
     {
         ExtOut("Failed to perform EHInfo traverse\n");
     }
-    
+
     return Status;
 }
 
+// Bounded cache of formatted GC info dumps keyed by the GCInfo address.
+// Decoding the compressed bit stream is pure CPU work over an immutable blob,
+// so repeated queries against the same hot methods replay the captured text
+// instead of re-decoding. The least recently used entry sits at the front and
+// is evicted first.
+struct GCInfoDumpCacheEntry
+{
+    TADDR addr;
+    std::string text;
+};
+
+static std::vector<GCInfoDumpCacheEntry> *g_pGCInfoDumpCache = NULL;
+static const size_t kMaxGCInfoDumpCacheEntries = 32;
+
+void ClearGCInfoDumpCache()
+{
+    delete g_pGCInfoDumpCache;
+    g_pGCInfoDumpCache = NULL;
+}
+
+// capture target for CaptureGCTableEntry while DumpGCInfo runs
+static std::string *g_pGCInfoDumpTarget = NULL;
+
+static void CaptureGCTableEntry(const char *fmt, ...)
+{
+    if (g_pGCInfoDumpTarget == NULL)
+    {
+        return;
+    }
+
+    char buffer[1024];
+    va_list va;
+    va_start(va, fmt);
+    int cch = _vsnprintf_s(buffer, _countof(buffer), _TRUNCATE, fmt, va);
+    va_end(va);
+
+    if (cch > 0)
+    {
+        g_pGCInfoDumpTarget->append(buffer, cch);
+    }
+}
+
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
 *    This function is called to dump the GC encoding of a managed      *
-*    function.                                                         *  
+*    function.                                                         *
 *                                                                      *
 \**********************************************************************/
 DECLARE_API(GCInfo)
@@ -8960,6 +11381,20 @@ DECLARE_API(GCInfo)
 
     ExtOut("GC info %p\n", SOS_PTR(taGCInfoAddr));
 
+    if (g_sosFastPathsEnabled && g_pGCInfoDumpCache != NULL)
+    {
+        for (size_t i = 0; i < g_pGCInfoDumpCache->size(); i++)
+        {
+            if ((*g_pGCInfoDumpCache)[i].addr == taGCInfoAddr)
+            {
+                ExtOut("%s", (*g_pGCInfoDumpCache)[i].text.c_str());
+                // mark as most recently used
+                std::rotate(g_pGCInfoDumpCache->begin() + i, g_pGCInfoDumpCache->begin() + i + 1, g_pGCInfoDumpCache->end());
+                return Status;
+            }
+        }
+    }
+
     // assume that GC encoding table is never more than
     // 40 + methodSize * 2
     int tableSize = 0;
@@ -8989,7 +11424,357 @@ DECLARE_API(GCInfo)
     GCInfoToken gcInfoToken = { table, GCINFO_VERSION };
     unsigned int methodSize = (unsigned int)codeHeaderData.MethodSize;
 
-    g_targetMachine->DumpGCInfo(gcInfoToken, methodSize, ExtOut, true /*encBytes*/, true /*bPrintHeader*/);
+    // capture the decode so it can be replayed on the next query
+    std::string dumpText;
+    g_pGCInfoDumpTarget = &dumpText;
+    g_targetMachine->DumpGCInfo(gcInfoToken, methodSize, CaptureGCTableEntry, true /*encBytes*/, true /*bPrintHeader*/);
+    g_pGCInfoDumpTarget = NULL;
+
+    ExtOut("%s", dumpText.c_str());
+
+    if (g_pGCInfoDumpCache == NULL)
+    {
+        g_pGCInfoDumpCache = new NOTHROW std::vector<GCInfoDumpCacheEntry>();
+    }
+    if (g_pGCInfoDumpCache != NULL)
+    {
+        if (g_pGCInfoDumpCache->size() >= kMaxGCInfoDumpCacheEntries)
+        {
+            g_pGCInfoDumpCache->erase(g_pGCInfoDumpCache->begin());
+        }
+        GCInfoDumpCacheEntry entry;
+        entry.addr = taGCInfoAddr;
+        g_pGCInfoDumpCache->push_back(entry);
+        g_pGCInfoDumpCache->back().text.swap(dumpText);
+    }
+
+    return Status;
+}
+
+// GCInfoCorpus file layout: raw GC info blobs plus the method sizes the
+// decoder needs, extracted from the target so decoder changes can be measured
+// against real-world encodings with !gcinfobench.  The blob length is the
+// same conservative bound !gcinfo reads (40 + methodSize * 2); the decoder
+// never reads past the encoding's own end.
+struct GCInfoCorpusFileHeader
+{
+    char Magic[8];          // "SOSGCINF"
+    DWORD Version;          // currently 1
+    DWORD RecordCount;
+};
+
+struct GCInfoCorpusFileRecord
+{
+    ULONG64 GCInfoAddr;
+    DWORD MethodSize;
+    DWORD BlobSize;         // bytes of blob data following this record
+};
+
+static const char kGCInfoCorpusMagic[8] = { 'S', 'O', 'S', 'G', 'C', 'I', 'N', 'F' };
+
+static void GCInfoCorpusCollectMT(UINT index, CLRDATA_ADDRESS methodTable, LPVOID token)
+{
+    ((std::vector<CLRDATA_ADDRESS>*)token)->push_back(methodTable);
+}
+
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Extracts the GC info blobs of every jitted method into a corpus   *
+*    file that !gcinfobench can replay offline.                        *
+*                                                                      *
+\**********************************************************************/
+DECLARE_API(GCInfoCorpus)
+{
+    INIT_API();
+    MINIDUMP_NOT_SUPPORTED();
+
+    StringHolder fileName;
+    StringHolder moduleName;
+
+    CMDOption option[] =
+    {   // name, vptr, type, hasValue
+        {"-module", &moduleName.data, COSTRING, TRUE},
+    };
+    CMDValue arg[] =
+    {   // vptr, type
+        {&fileName.data, COSTRING},
+    };
+    size_t nArg;
+    if (!GetCMDOption(args, option, _countof(option), arg, _countof(arg), &nArg) || nArg != 1)
+    {
+        ExtOut("usage: GCInfoCorpus [-module <name>] <corpus-file>\n");
+        return Status;
+    }
+
+    int numModules;
+    ArrayHolder<DWORD_PTR> moduleList = ModuleFromName(moduleName.data, &numModules);
+    if (moduleList == NULL)
+    {
+        ExtOut("Failed to request module list.\n");
+        return E_FAIL;
+    }
+
+    FILE *file = NULL;
+    if (fopen_s(&file, fileName.data, "wb") != 0)
+    {
+        ExtOut("Unable to open file %s\n", fileName.data);
+        return E_FAIL;
+    }
+
+    // The record count is only known at the end; write a placeholder header
+    // now and patch it before closing.
+    GCInfoCorpusFileHeader header;
+    memcpy(header.Magic, kGCInfoCorpusMagic, sizeof(header.Magic));
+    header.Version = 1;
+    header.RecordCount = 0;
+    fwrite(&header, sizeof(header), 1, file);
+
+    // Many slots share code (inherited methods, shared generics), so each
+    // GC info blob is extracted once.
+    std::unordered_set<TADDR> seen;
+    ULONG64 totalBytes = 0;
+    std::vector<BYTE> blob;
+
+    for (int iModule = 0; iModule < numModules; iModule++)
+    {
+        if (IsInterrupt())
+            break;
+
+        std::vector<CLRDATA_ADDRESS> methodTables;
+        g_sos->TraverseModuleMap(TYPEDEFTOMETHODTABLE, TO_CDADDR(moduleList[iModule]),
+                                 GCInfoCorpusCollectMT, &methodTables);
+
+        for (size_t iMT = 0; iMT < methodTables.size(); iMT++)
+        {
+            if (IsInterrupt())
+                break;
+
+            DacpMethodTableData vMethTable;
+            if (vMethTable.Request(g_sos, methodTables[iMT]) != S_OK)
+                continue;
+
+            for (DWORD n = 0; n < vMethTable.wNumMethods; n++)
+            {
+                CLRDATA_ADDRESS entry;
+                if (g_sos->GetMethodTableSlot(TO_TADDR(methodTables[iMT]), n, &entry) != S_OK)
+                    continue;
+
+                DWORD_PTR methodDesc = 0;
+                JITTypes jitType;
+                DWORD_PTR gcinfoAddr = 0;
+                IP2MethodDesc(TO_TADDR(entry), methodDesc, jitType, gcinfoAddr);
+                if (gcinfoAddr == 0 || !seen.insert(gcinfoAddr).second)
+                    continue;
+
+                DacpCodeHeaderData codeHeaderData;
+                if (codeHeaderData.Request(g_sos, entry) != S_OK || codeHeaderData.MethodSize == 0)
+                    continue;
+
+                // Same conservative bound as !gcinfo, capped so one corrupt
+                // method size cannot balloon the corpus.
+                int blobSize = 0;
+                if (!ClrSafeInt<int>::multiply(codeHeaderData.MethodSize, 2, blobSize) ||
+                    !ClrSafeInt<int>::addition(blobSize, 40, blobSize) ||
+                    blobSize > 0x100000)
+                {
+                    continue;
+                }
+
+                blob.resize(blobSize);
+                memset(blob.data(), 0, blobSize);
+                if (!SafeReadMemory(TO_TADDR(gcinfoAddr), blob.data(), blobSize, NULL))
+                    continue;
+
+                GCInfoCorpusFileRecord record;
+                record.GCInfoAddr = gcinfoAddr;
+                record.MethodSize = codeHeaderData.MethodSize;
+                record.BlobSize = (DWORD)blobSize;
+                fwrite(&record, sizeof(record), 1, file);
+                fwrite(blob.data(), 1, blobSize, file);
+
+                header.RecordCount++;
+                totalBytes += blobSize;
+            }
+        }
+    }
+
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+
+    ExtOut("%u GC info blobs (%I64u bytes) from %d module(s) written to %s\n",
+        header.RecordCount, totalBytes, numModules, fileName.data);
+    ExtOut("Replay with \"" SOSPrefix "gcinfobench %s\".\n", fileName.data);
+    return Status;
+}
+
+// swallows DumpGCInfo output during !gcinfobench; only the decode is timed
+static void DiscardGCTableEntry(const char *fmt, ...)
+{
+}
+
+/**********************************************************************\
+* Routine Description:                                                 *
+*                                                                      *
+*    Replays GC info decoding over a corpus extracted by               *
+*    !gcinfocorpus and reports decode throughput per decoder flag      *
+*    combination.                                                      *
+*                                                                      *
+\**********************************************************************/
+DECLARE_API(GCInfoBench)
+{
+    INIT_API();
+
+    StringHolder fileName;
+    size_t rounds = 3;
+
+    CMDOption option[] =
+    {   // name, vptr, type, hasValue
+        {"-rounds", &rounds, COSIZE_T, TRUE},
+    };
+    CMDValue arg[] =
+    {   // vptr, type
+        {&fileName.data, COSTRING},
+    };
+    size_t nArg;
+    if (!GetCMDOption(args, option, _countof(option), arg, _countof(arg), &nArg) || nArg != 1 || rounds == 0)
+    {
+        ExtOut("usage: GCInfoBench [-rounds <n>] <corpus-file>\n");
+        return Status;
+    }
+
+    FILE *file = NULL;
+    if (fopen_s(&file, fileName.data, "rb") != 0)
+    {
+        ExtOut("Unable to open file %s\n", fileName.data);
+        return E_FAIL;
+    }
+
+    GCInfoCorpusFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.Magic, kGCInfoCorpusMagic, sizeof(header.Magic)) != 0 ||
+        header.Version != 1)
+    {
+        ExtOut("%s is not a " SOSPrefix "gcinfocorpus file\n", fileName.data);
+        fclose(file);
+        return E_FAIL;
+    }
+
+    struct CorpusRecord
+    {
+        DWORD MethodSize;
+        std::vector<BYTE> Blob;
+    };
+    std::vector<CorpusRecord> corpus;
+    corpus.reserve(header.RecordCount);
+
+    ULONG64 totalBytes = 0;
+    for (DWORD i = 0; i < header.RecordCount; i++)
+    {
+        GCInfoCorpusFileRecord record;
+        if (fread(&record, sizeof(record), 1, file) != 1 || record.BlobSize > 0x100000)
+        {
+            ExtOut("%s is truncated or corrupt\n", fileName.data);
+            fclose(file);
+            return E_FAIL;
+        }
+
+        CorpusRecord entry;
+        entry.MethodSize = record.MethodSize;
+        entry.Blob.resize(record.BlobSize);
+        if (fread(entry.Blob.data(), 1, record.BlobSize, file) != record.BlobSize)
+        {
+            ExtOut("%s is truncated or corrupt\n", fileName.data);
+            fclose(file);
+            return E_FAIL;
+        }
+        totalBytes += record.BlobSize;
+        corpus.push_back(std::move(entry));
+    }
+    fclose(file);
+
+    if (corpus.empty())
+    {
+        ExtOut("Corpus is empty.\n");
+        return Status;
+    }
+
+    ExtOut("Corpus: %d methods, %I64u bytes.  Best of %d rounds (first round warms up):\n\n",
+        (int)corpus.size(), totalBytes, (int)rounds);
+    ExtOut("%-24s %16s %12s\n", "variant", "methods/sec", "MB/sec");
+
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+
+    // Keeps each variant's result observable so the decode cannot be
+    // optimized away.
+    ULONG64 checksum = 0;
+
+    struct BenchVariant
+    {
+        const char *Name;
+        int Variant;        // GCInfoBenchVariant, or -1 for the full dump replay
+    };
+    BenchVariant variants[] =
+    {
+#ifdef SOS_TARGET_AMD64
+        {"header",          GCInfoBench_Header},
+        {"gc_lifetimes",    GCInfoBench_Lifetimes},
+        {"slots_only",      GCInfoBench_SlotsOnly},
+#endif
+        {"full_dump",       -1},
+    };
+
+    for (size_t v = 0; v < _countof(variants); v++)
+    {
+#ifdef SOS_TARGET_AMD64
+        // The flag-combination variants go through the AMD64 decoder; a
+        // corpus from another architecture only supports the full replay.
+        if (variants[v].Variant >= 0 && !IsDbgTargetAmd64())
+            continue;
+#endif
+
+        double bestSecs = 0;
+        for (size_t round = 0; round <= rounds; round++)
+        {
+            if (IsInterrupt())
+                return Status;
+
+            LARGE_INTEGER start, end;
+            QueryPerformanceCounter(&start);
+
+            for (size_t i = 0; i < corpus.size(); i++)
+            {
+                GCInfoToken gcInfoToken = { corpus[i].Blob.data(), GCINFO_VERSION };
+#ifdef SOS_TARGET_AMD64
+                if (variants[v].Variant >= 0)
+                {
+                    checksum += GCInfoDecodeBench(gcInfoToken, (GCInfoBenchVariant)variants[v].Variant);
+                    continue;
+                }
+#endif
+                g_targetMachine->DumpGCInfo(gcInfoToken, corpus[i].MethodSize,
+                    DiscardGCTableEntry, false /*encBytes*/, false /*bPrintHeader*/);
+            }
+
+            QueryPerformanceCounter(&end);
+            double secs = (double)(end.QuadPart - start.QuadPart) / (double)freq.QuadPart;
+
+            // round 0 is the warmup
+            if (round == 1 || (round > 1 && secs < bestSecs))
+                bestSecs = secs;
+        }
+
+        if (bestSecs <= 0)
+            bestSecs = 1e-9;
+        ExtOut("%-24s %16.0f %12.1f\n", variants[v].Name,
+            (double)corpus.size() / bestSecs,
+            (double)totalBytes / bestSecs / (1024.0 * 1024.0));
+    }
+
+    if (checksum == (ULONG64)-1)
+        ExtOut("\n");   // keeps the checksum live; never taken
 
     return Status;
 }
@@ -9084,23 +11869,90 @@ BOOL gatherEh(UINT clauseIndex,UINT totalClauses,DACEHInfo *pEHInfo,LPVOID token
 
     if (pInfo == NULL)
     {
-        return FALSE;
+        return FALSE;
+    }
+    
+    if (pInfo->m_pInfos == NULL)
+    {
+        // First time, initialize structure
+        pInfo->EHCount = totalClauses;
+        pInfo->m_pInfos = new NOTHROW DACEHInfo[totalClauses];
+        if (pInfo->m_pInfos == NULL)
+        {
+            ReportOOM();            
+            return FALSE;
+        }
+    }
+
+    pInfo->m_pInfos[clauseIndex] = *((DACEHInfo*)pEHInfo);
+    return TRUE;
+}
+
+// Session-scoped cache of gathered EH clause tables keyed by MethodDesc, so
+// commands that decorate many frames don't re-decode the same hot methods'
+// tables over and over.
+static std::unordered_map<DWORD_PTR, SOSEHInfo*> *g_pEHInfoCache = NULL;
+
+void ClearEHInfoCache()
+{
+    if (g_pEHInfoCache == NULL)
+    {
+        return;
+    }
+    std::unordered_map<DWORD_PTR, SOSEHInfo*>::iterator itr;
+    for (itr = g_pEHInfoCache->begin(); itr != g_pEHInfoCache->end(); ++itr)
+    {
+        delete itr->second;
+    }
+    delete g_pEHInfoCache;
+    g_pEHInfoCache = NULL;
+}
+
+SOSEHInfo *GetEHInfoForMethod(DWORD_PTR methodDesc, CLRDATA_ADDRESS nativeCodeAddr, HRESULT *pStatus)
+{
+    if (pStatus != NULL)
+    {
+        *pStatus = S_OK;
+    }
+
+    if (g_pEHInfoCache == NULL)
+    {
+        g_pEHInfoCache = new NOTHROW std::unordered_map<DWORD_PTR, SOSEHInfo*>();
+        if (g_pEHInfoCache == NULL)
+        {
+            ReportOOM();
+            return NULL;
+        }
+    }
+
+    std::unordered_map<DWORD_PTR, SOSEHInfo*>::iterator itr = g_pEHInfoCache->find(methodDesc);
+    if (itr != g_pEHInfoCache->end())
+    {
+        return itr->second;
+    }
+
+    SOSEHInfo *pInfo = new NOTHROW SOSEHInfo;
+    if (pInfo == NULL)
+    {
+        ReportOOM();
+        return NULL;
     }
-    
-    if (pInfo->m_pInfos == NULL)
+
+    HRESULT hr = g_sos->TraverseEHInfo(nativeCodeAddr, gatherEh, (LPVOID)pInfo);
+    if (hr != S_OK)
     {
-        // First time, initialize structure
-        pInfo->EHCount = totalClauses;
-        pInfo->m_pInfos = new NOTHROW DACEHInfo[totalClauses];
-        if (pInfo->m_pInfos == NULL)
+        // don't cache failures - an interrupted gather should be retried
+        if (pStatus != NULL)
         {
-            ReportOOM();            
-            return FALSE;
+            *pStatus = hr;
         }
+        delete pInfo;
+        return NULL;
     }
 
-    pInfo->m_pInfos[clauseIndex] = *((DACEHInfo*)pEHInfo);
-    return TRUE;
+    pInfo->methodStart = nativeCodeAddr;
+    (*g_pEHInfoCache)[methodDesc] = pInfo;
+    return pInfo;
 }
 
 
@@ -9314,19 +12166,27 @@ DECLARE_API(u)
     SOSEHInfo *pInfo = NULL;
     if (fWithEHInfo)
     {
-        pInfo = new NOTHROW SOSEHInfo;
+        // owned by the session EH info cache - do not delete
+        pInfo = GetEHInfoForMethod(TO_TADDR(MethodDescData.MethodDescPtr), MethodDescData.NativeCodeAddr);
         if (pInfo == NULL)
-        {
-            ReportOOM();                
-        }
-        else if (g_sos->TraverseEHInfo(MethodDescData.NativeCodeAddr, gatherEh, (LPVOID)pInfo) != S_OK)
         {
             ExtOut("Failed to gather EHInfo data\n");
-            delete pInfo;
-            pInfo = NULL;            
         }
     }
-    
+
+    // Stage the code regions in the shared page cache up front - one block
+    // read each - so the walker's callee-site and operand probes are answered
+    // locally instead of costing an engine round trip per instruction.
+    if (codeHeaderData.ColdRegionStart == NULL)
+    {
+        PrefetchCachedReadVirtual(codeHeaderData.MethodStart, codeHeaderData.MethodSize);
+    }
+    else
+    {
+        PrefetchCachedReadVirtual(codeHeaderData.MethodStart, codeHeaderData.HotRegionSize);
+        PrefetchCachedReadVirtual(codeHeaderData.ColdRegionStart, codeHeaderData.ColdRegionSize);
+    }
+
     if (codeHeaderData.ColdRegionStart == NULL)
     {
         g_targetMachine->Unassembly (
@@ -9383,12 +12243,6 @@ DECLARE_API(u)
 
     }
 
-    if (pInfo)
-    {
-        delete pInfo;
-        pInfo = NULL;
-    }
-    
 #if !defined(FEATURE_PAL)
     if (fWithGCInfo)
         DeleteFiber(gcEncodingInfo.pvGCTableFiber);
@@ -9419,11 +12273,18 @@ DECLARE_API(DumpLog)
     const char* fileName = "StressLog.txt";
 
     CLRDATA_ADDRESS StressLogAddress = NULL;
-    
-    StringHolder sFileName, sLogAddr;
-    CMDOption option[] = 
+
+    DWORD_PTR tid = 0;
+    DWORD_PTR facility = 0;
+    StringHolder sFileName, sLogAddr, sAfter, sBefore, sBinaryName;
+    CMDOption option[] =
     {   // name, vptr, type, hasValue
-        {"-addr", &sLogAddr.data, COSTRING, TRUE}
+        {"-addr", &sLogAddr.data, COSTRING, TRUE},
+        {"-tid", &tid, COHEX, TRUE},
+        {"-facility", &facility, COHEX, TRUE},
+        {"-after", &sAfter.data, COSTRING, TRUE},
+        {"-before", &sBefore.data, COSTRING, TRUE},
+        {"-binary", &sBinaryName.data, COSTRING, TRUE},
     };
     CMDValue arg[] = 
     {   // vptr, type
@@ -9434,7 +12295,18 @@ DECLARE_API(DumpLog)
     {
         return Status;
     }
-    if (nArg > 0 && sFileName.data != NULL)
+    BOOL bBinary = FALSE;
+    if (sBinaryName.data != NULL)
+    {
+        if (nArg > 0 && sFileName.data != NULL)
+        {
+            ExtOut("Specify either -binary <Filename> or a text file name, not both\n");
+            return E_FAIL;
+        }
+        fileName = sBinaryName.data;
+        bBinary = TRUE;
+    }
+    else if (nArg > 0 && sFileName.data != NULL)
     {
         fileName = sFileName.data;
     }
@@ -9473,9 +12345,21 @@ DECLARE_API(DumpLog)
 
     ExtOut("Attempting to dump Stress log to file '%s'\n", fileName);
 
-    
-    
-    Status = StressLog::Dump(StressLogAddress, fileName, g_ExtData);
+    // Filters are applied against the raw messages before any formatting, so
+    // a narrow dump of a huge log stays cheap.
+    StressLog::DumpFilter filter;
+    filter.threadId = (unsigned)tid;
+    filter.facilityMask = facility;
+    if (sAfter.data != NULL)
+    {
+        filter.afterSecs = atof(sAfter.data);
+    }
+    if (sBefore.data != NULL)
+    {
+        filter.beforeSecs = atof(sBefore.data);
+    }
+
+    Status = StressLog::Dump(StressLogAddress, fileName, g_ExtData, &filter, bBinary);
 
     if (Status == S_OK)
         ExtOut("SUCCESS: Stress log dumped\n");
@@ -10425,7 +13309,24 @@ DECLARE_API(Name2EE)
     ArrayHolder<DWORD_PTR> moduleList = NULL;
     if (strcmp(DllName.data, "*") == 0)
     {
-        moduleList = ModuleFromName(NULL, &numModule);
+        // Probe the type-name index first so an all-module search only
+        // touches the modules that define the type.  Names the index cannot
+        // resolve (e.g. a bare method name) fall back to the full walk.
+        std::vector<DWORD_PTR> indexed;
+        if (FindModulesForTypeName(TypeName.data, indexed) && !indexed.empty())
+        {
+            moduleList = new NOTHROW DWORD_PTR[indexed.size()];
+            if (moduleList != NULL)
+            {
+                std::copy(indexed.begin(), indexed.end(), &moduleList[0]);
+                numModule = (int)indexed.size();
+            }
+        }
+
+        if (moduleList == NULL)
+        {
+            moduleList = ModuleFromName(NULL, &numModule);
+        }
     }
     else
     {
@@ -10527,43 +13428,112 @@ DECLARE_API(GCRoot)
     MINIDUMP_NOT_SUPPORTED();    
 
     BOOL bNoStacks = FALSE;
-    DWORD_PTR obj = NULL;
     BOOL dml = FALSE;
     BOOL all = FALSE;
+    BOOL first = FALSE;
+    size_t maxDepth = 0;
+    StringHolder str_targetsFile;
     size_t nArg;
 
-    CMDOption option[] = 
+    CMDOption option[] =
     {   // name, vptr, type, hasValue
         {"-nostacks", &bNoStacks, COBOOL, FALSE},
         {"-all", &all, COBOOL, FALSE},
+        {"-first", &first, COBOOL, FALSE},
+        {"-maxdepth", &maxDepth, COSIZE_T, TRUE},
+        {"-targets", &str_targetsFile.data, COSTRING, TRUE},
 #ifndef FEATURE_PAL
         {"/d", &dml, COBOOL, FALSE},
 #endif
     };
-    CMDValue arg[] = 
 
-    {   // vptr, type
-        {&obj, COHEX}
-    };
+    // Several addresses may be given; with more than one (or with -targets)
+    // they are all resolved in a shared pass over the object graph.
+    DWORD_PTR objs[64] = {0};
+    CMDValue arg[_countof(objs)];
+    for (size_t i = 0; i < _countof(objs); ++i)
+    {
+        arg[i].vptr = &objs[i];
+        arg[i].type = COHEX;
+    }
+
     if (!GetCMDOption(args, option, _countof(option), arg, _countof(arg), &nArg))
     {
         return Status;
-    }    
-    if (obj == 0)
+    }
+
+    std::vector<TADDR> targets;
+    for (size_t i = 0; i < nArg; ++i)
+        if (objs[i])
+            targets.push_back(objs[i]);
+
+    if (str_targetsFile.data != NULL)
+    {
+        // One address per line.
+        FILE *file = NULL;
+        if (fopen_s(&file, str_targetsFile.data, "r") != 0)
+        {
+            ExtOut("Unable to open file %s\n", str_targetsFile.data);
+            return Status;
+        }
+
+        char line[128];
+        while (fgets(line, _countof(line), file))
+        {
+            line[strcspn(line, "\r\n")] = 0;
+
+            TADDR addr = GetExpression(line);
+            if (addr)
+                targets.push_back(addr);
+        }
+
+        fclose(file);
+    }
+
+    if (targets.empty())
     {
         ExtOut("Invalid argument %s\n", args);
         return Status;
     }
 
-    EnableDMLHolder dmlHolder(dml);      
+    EnableDMLHolder dmlHolder(dml);
+    BufferedOutputHolder bufferedOutput;
     GCRootImpl gcroot;
-    int i = gcroot.PrintRootsForObject(obj, all == TRUE, bNoStacks == TRUE);
-    
+
+    if (all && first)
+    {
+        ExtOut("-first is ignored with -all.\n");
+        first = FALSE;
+    }
+
+    if (targets.size() > 1)
+    {
+        if (all)
+            ExtOut("-all is ignored when resolving multiple targets.\n");
+        if (first || maxDepth != 0)
+            ExtOut("-first and -maxdepth are ignored when resolving multiple targets.\n");
+
+        int i = gcroot.PrintRootsForObjects(targets, bNoStacks == TRUE);
+
+        if (IsInterrupt())
+            ExtOut("Interrupted, data may be incomplete.\n");
+
+        ExtOut("Found %d unique roots for %d targets.\n", i, (int)targets.size());
+        return Status;
+    }
+
+    int i = gcroot.PrintRootsForObject(targets[0], all == TRUE, bNoStacks == TRUE, first == TRUE, (int)maxDepth);
+
     if (IsInterrupt())
         ExtOut("Interrupted, data may be incomplete.\n");
-    
+
+    if (maxDepth != 0 && i == 0)
+        ExtOut("No roots found within %d levels; retry without -maxdepth for a full search.\n", (int)maxDepth);
+
     if (all)
         ExtOut("Found %d roots.\n", i);
+    else if (first)
+        ExtOut("Found %d root (stopped at the first path; run without -first to see all unique roots).\n", i);
     else
         ExtOut("Found %d unique roots (run '" SOSPrefix "gcroot -all' to see all roots).\n", i);
 
@@ -10597,7 +13567,17 @@ DECLARE_API(GCWhere)
     }
 
     EnableDMLHolder dmlHolder(dml);
-    // Obtain allocation context for each managed thread.    
+
+    // Build the segment snapshot up front so each lookup below is a binary
+    // search of the sorted segment ranges instead of a walk of the DAC's
+    // segment list.
+    if (!g_snapshot.Build())
+    {
+        ExtOut("Unable to build snapshot of the garbage collector state\n");
+        return Status;
+    }
+
+    // Obtain allocation context for each managed thread.
     AllocInfo allocInfo;
     allocInfo.Init();
 
@@ -10622,14 +13602,7 @@ DECLARE_API(GCWhere)
 
     if (!IsServerBuild())
     {
-        DacpGcHeapDetails heapDetails;
-        if (heapDetails.Request(g_sos) != S_OK)
-        {
-            ExtOut("Error requesting gc heap details\n");
-            return Status;
-        }
-
-        if (GCObjInHeap(taddrObj, heapDetails, trngSeg, gen, allocCtx, bLarge))
+        if (GCObjInHeap(taddrObj, *g_snapshot.GetHeapDetails(0), trngSeg, gen, allocCtx, bLarge))
         {
             ExtOut("Address   " WIN64_8SPACES " Gen   Heap   segment   " WIN64_8SPACES " begin     " WIN64_8SPACES " allocated  " WIN64_8SPACES " size\n");
             ExtOut("%p   %d     %2d     %p   %p   %p    0x%x(%d)\n",
@@ -10639,38 +13612,10 @@ DECLARE_API(GCWhere)
     }
     else
     {
-        DacpGcHeapData gcheap;
-        if (gcheap.Request(g_sos) != S_OK)
-        {
-            ExtOut("Error requesting GC Heap data\n");
-            return Status;
-        }
-
-        DWORD dwAllocSize;
-        DWORD dwNHeaps = gcheap.HeapCount;
-        if (!ClrSafeInt<DWORD>::multiply(sizeof(CLRDATA_ADDRESS), dwNHeaps, dwAllocSize))
-        {
-            ExtOut("Failed to get GCHeaps:  integer overflow\n");
-            return Status;
-        }
-
-        CLRDATA_ADDRESS *heapAddrs = (CLRDATA_ADDRESS*)alloca(dwAllocSize);
-        if (g_sos->GetGCHeapList(dwNHeaps, heapAddrs, NULL) != S_OK)
-        {
-            ExtOut("Failed to get GCHeaps\n");
-            return Status;
-        }
- 
+        DWORD dwNHeaps = (DWORD)g_snapshot.GetHeapCount();
         for (DWORD n = 0; n < dwNHeaps; n ++)
         {
-            DacpGcHeapDetails heapDetails;
-            if (heapDetails.Request(g_sos, heapAddrs[n]) != S_OK)
-            {
-                ExtOut("Error requesting details\n");
-                return Status;
-            }
-
-            if (GCObjInHeap(taddrObj, heapDetails, trngSeg, gen, allocCtx, bLarge))
+            if (GCObjInHeap(taddrObj, *g_snapshot.GetHeapDetails(n), trngSeg, gen, allocCtx, bLarge))
             {
                 ExtOut("Address " WIN64_8SPACES " Gen Heap segment " WIN64_8SPACES " begin   " WIN64_8SPACES " allocated" WIN64_8SPACES " size\n");
                 ExtOut("%p   %d     %2d     %p   %p   %p    0x%x(%d)\n",
@@ -10689,6 +13634,191 @@ DECLARE_API(GCWhere)
     return Status;
 }
 
+/* Classifies one address for !whatis and emits exactly one line for it:
+ * the address, a single lower-case kind token, and the kind's detail (a
+ * type, method or file name).  Scripts key off the token, so every path
+ * through here prints exactly one line and nothing else.
+ *
+ * Probe order is cheapest first.  GC heap membership is a binary search
+ * of the snapshotted segment ranges; the MethodTable/MethodDesc probes
+ * are the same ones the disassembly annotators run, and share their
+ * session classification cache (only those two kinds are trusted from
+ * it -- an object entry left by an annotator was validated against a
+ * weaker check than the heap membership test used here).
+ */
+static void WhatIsClassify(TADDR addr)
+{
+    if (addr == 0)
+    {
+        ExtOut("%p unknown\n", SOS_PTR(addr));
+        return;
+    }
+
+    BOOL bLarge = FALSE;
+    if (g_snapshot.FindSegment(TO_CDADDR(addr), &bLarge) != NULL)
+    {
+        TADDR mt;
+        if (sos::IsObject(addr) && SUCCEEDED(GetMTOfObject(addr, &mt)))
+        {
+            if (mt == TO_TADDR(g_special_usefulGlobals.FreeMethodTable))
+            {
+                ExtOut("%p free\n", SOS_PTR(addr));
+                return;
+            }
+
+            const WCHAR *name = GetInternedMethodTableName(mt);
+            DMLOut("%s object %S\n", DMLObject(addr),
+                   name != NULL ? name : W("<unknown type>"));
+            return;
+        }
+
+        // In a heap segment but not an object start: an interior pointer,
+        // or the heap is mid-compaction.
+        ExtOut("%p interior\n", SOS_PTR(addr));
+        return;
+    }
+
+    PointerKind kind;
+    const WCHAR *pCachedName;
+    if (TryGetPointerClassification(addr, &kind, &pCachedName))
+    {
+        if (kind == PK_MethodTable)
+        {
+            DMLOut("%s methodtable %S\n", DMLMethodTable(addr), pCachedName);
+            return;
+        }
+
+        if (kind == PK_MethodDesc)
+        {
+            DMLOut("%s methoddesc %S\n", DMLMethodDesc(addr), pCachedName);
+            return;
+        }
+    }
+
+    if (IsMethodTable(addr))
+    {
+        NameForMT_s(addr, g_mdName, mdNameLen);
+        CachePointerClassification(addr, PK_MethodTable, g_mdName);
+        DMLOut("%s methodtable %S\n", DMLMethodTable(addr), g_mdName);
+        return;
+    }
+
+    if (IsMethodDesc(addr))
+    {
+        NameForMD_s(addr, g_mdName, mdNameLen);
+        CachePointerClassification(addr, PK_MethodDesc, g_mdName);
+        DMLOut("%s methoddesc %S\n", DMLMethodDesc(addr), g_mdName);
+        return;
+    }
+
+    // JIT-compiled managed code?
+    CLRDATA_ADDRESS cdaMD;
+    if (g_sos->GetMethodDescPtrFromIP(TO_CDADDR(addr), &cdaMD) == S_OK)
+    {
+        NameForMD_s(TO_TADDR(cdaMD), g_mdName, mdNameLen);
+        ExtOut("%p code %S\n", SOS_PTR(addr), g_mdName);
+        return;
+    }
+
+    const char *helper = HelperFuncName(addr);
+    if (helper != NULL)
+    {
+        ExtOut("%p jithelper %s\n", SOS_PTR(addr), helper);
+        return;
+    }
+
+    if (IsModule(addr))
+    {
+        WCHAR fileName[MAX_LONGPATH];
+        FileNameForModule(addr, fileName);
+        ExtOut("%p module %S\n", SOS_PTR(addr),
+               fileName[0] ? fileName : W("<unknown module>"));
+        return;
+    }
+
+    ExtOut("%p unknown\n", SOS_PTR(addr));
+}
+
+DECLARE_API(WhatIs)
+{
+    INIT_API();
+    MINIDUMP_NOT_SUPPORTED();
+
+    BOOL dml = FALSE;
+    StringHolder fileName;
+    TADDR taddr = 0;
+    size_t nArg;
+
+    CMDOption option[] =
+    {   // name, vptr, type, hasValue
+        {"-file", &fileName.data, COSTRING, TRUE},
+        {"/d", &dml, COBOOL, FALSE},
+    };
+    CMDValue arg[] =
+    {   // vptr, type
+        {&taddr, COHEX}
+    };
+    if (!GetCMDOption(args, option, _countof(option), arg, _countof(arg), &nArg))
+    {
+        return Status;
+    }
+
+    if ((fileName.data == NULL) == (nArg == 0))
+    {
+        ExtOut("Usage: " SOSPrefix "whatis [-file <path>] [address]\n");
+        return Status;
+    }
+
+    EnableDMLHolder dmlHolder(dml);
+
+    // Build the segment snapshot up front so each classification below is
+    // a binary search of the sorted segment ranges instead of a walk of
+    // the DAC's segment list.
+    if (!g_snapshot.Build())
+    {
+        ExtOut("Unable to build snapshot of the garbage collector state\n");
+        return Status;
+    }
+
+    if (fileName.data == NULL)
+    {
+        WhatIsClassify(taddr);
+        return Status;
+    }
+
+    FILE *file = NULL;
+    if (fopen_s(&file, fileName.data, "r") != 0)
+    {
+        ExtOut("Unable to open file %s\n", fileName.data);
+        return Status;
+    }
+
+    // Classifications are one line in, one line out; batch the output
+    // callbacks for the thousands-of-addresses case this exists for.
+    BufferedOutputHolder bufferedOutput;
+
+    char line[128];
+    while (fgets(line, _countof(line), file) != NULL)
+    {
+        if (IsInterrupt())
+            break;
+
+        // Skip blanks and comment lines; everything else is a hex address
+        // (a leading "0x" is fine).
+        char *cur = line;
+        while (*cur == ' ' || *cur == '\t')
+            cur++;
+
+        if (*cur == '\0' || *cur == '\n' || *cur == '\r' || *cur == '#')
+            continue;
+
+        WhatIsClassify((TADDR)strtoull(cur, NULL, 16));
+    }
+
+    fclose(file);
+    return Status;
+}
+
 #ifndef FEATURE_PAL
 
 DECLARE_API(FindRoots)
@@ -10926,24 +14056,64 @@ private:
     int m_systemDomainIndex;
 };
 
+/* The resolved handle table, cached for the session.  !gchandles tends to be
+ * run several times in a row with different filters, and each run used to
+ * re-enumerate the table and re-resolve every referent.  The enumeration and
+ * the batched resolution now happen once; every view - the listing, -stat,
+ * -perdomain, -json and -summary - renders from these records.  Dropped
+ * between commands against a live target like the other session caches.
+ */
+struct ResolvedHandleData
+{
+    SOSHandleData Handle;
+    TADDR Object;       // the referent, 0 when the slot could not be read
+    TADDR MT;           // the referent's MethodTable
+    size_t Size;        // the referent's size; 0 for free or invalid objects
+    BOOL ReadFailed;    // the handle slot itself was unreadable
+};
+
+struct HandleTableSnapshot
+{
+    BOOL Valid;
+    std::vector<ResolvedHandleData> Records;
+
+    HandleTableSnapshot() : Valid(FALSE) {}
+};
+
+static HandleTableSnapshot g_handleTableSnapshot;
+
+void ClearHandleTableSnapshot()
+{
+    g_handleTableSnapshot.Records.clear();
+    g_handleTableSnapshot.Valid = FALSE;
+}
+
 class GCHandlesImpl
 {
 public:
     GCHandlesImpl(PCSTR args)
-        : mPerDomain(FALSE), mStat(FALSE), mDML(FALSE), mType((int)~0)
+        : mPerDomain(FALSE), mStat(FALSE), mJson(FALSE), mSummary(FALSE), mDML(FALSE), mType((int)~0)
     {
         ArrayHolder<char> type = NULL;
-        CMDOption option[] = 
+        CMDOption option[] =
         {
             {"-perdomain", &mPerDomain, COBOOL, FALSE},
             {"-stat", &mStat, COBOOL, FALSE},
+            {"-json", &mJson, COBOOL, FALSE},
+            {"-summary", &mSummary, COBOOL, FALSE},
             {"-type", &type, COSTRING, TRUE},
             {"/d", &mDML, COBOOL, FALSE},
         };
-        
+
         if (!GetCMDOption(args,option,_countof(option),NULL,0,NULL))
             sos::Throw<sos::Exception>("Failed to parse command line arguments.");
-        
+
+        if (mJson && (mStat || mPerDomain || mSummary))
+            sos::Throw<sos::Exception>("-json only applies to the plain handle listing.");
+
+        if (mSummary && (mStat || mPerDomain))
+            sos::Throw<sos::Exception>("-summary already aggregates; it cannot be combined with -stat or -perdomain.");
+
         if (type != NULL)
             if (_stricmp(type, "Pinned") == 0)
                 mType = HNDTYPE_PINNED;
@@ -10972,19 +14142,32 @@ public:
     void Run()
     {
         EnableDMLHolder dmlHolder(mDML);
-        
+
+        EnsureHandleSnapshot();
+
+        if (mSummary)
+        {
+            PrintSummary();
+            return;
+        }
+
         mOut.ReInit(6, POINTERSIZE_HEX, AlignRight);
         mOut.SetWidths(5, POINTERSIZE_HEX, 11, POINTERSIZE_HEX, 8, POINTERSIZE_HEX);
         mOut.SetColAlignment(1, AlignLeft);
         
         if (mHandleStat.Init(!mPerDomain) == FALSE)
             sos::Throw<sos::Exception>("Error getting per-appdomain handle information");
-        
-        if (!mStat)
+
+        if (!mStat && !mJson)
             mOut.WriteRow("Handle", "Type", "Object", "Size", "Data", "Type");
-            
+
         WalkHandles();
-        
+
+        // JSON consumers get the records only; the statistics stay with the
+        // text mode.
+        if (mJson)
+            return;
+
         for (int i=0; (i < mHandleStat.GetNumDomains()) && !IsInterrupt(); i++)
         {
             GCHandleStatistics *pStats = mHandleStat.GetStatistics(i);
@@ -11017,8 +14200,13 @@ public:
     }
 
 private:
-    void WalkHandles()
+    void EnsureHandleSnapshot()
     {
+        if (g_handleTableSnapshot.Valid)
+            return;
+
+        ClearHandleTableSnapshot();
+
         ToRelease<ISOSHandleEnum> handles;
         if (FAILED(g_sos->GetHandleEnum(&handles)))
         {
@@ -11027,53 +14215,84 @@ private:
             else
                 sos::Throw<sos::Exception>("Failed to walk the handle table.");
         }
-      
-        // GCC can't handle stacks which are too large.
-#ifndef FEATURE_PAL
-        SOSHandleData data[256];
-#else
-        SOSHandleData data[4];
-#endif
-        
-        unsigned int fetched = 0;
-        HRESULT hr = S_OK;
-        do
+
+        // Drain the enumerator in large batches and process the handles in
+        // address order, so resolving each handle to its object reads the
+        // handle table segments sequentially.
+        std::vector<SOSHandleData> sorted;
+        if (!FetchSortedHandleTable(handles, sorted))
+            sos::Throw<sos::Exception>("Error while walking the handle table.");
+
+        // Resolve every handle to its referent with one batched read up
+        // front; the handles arrive sorted, so the batch walks the handle
+        // table segments sequentially.
+        unsigned int count = (unsigned int)sorted.size();
+        std::vector<TADDR> referents(count, 0);
+        std::vector<ReadVirtualRange> ranges(count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            ranges[i].Address = sorted[i].Handle;
+            ranges[i].Buffer = &referents[i];
+            ranges[i].Size = sizeof(TADDR);
+        }
+
+        ReadVirtualBatch(ranges.data(), (ULONG)count);
+
+        std::vector<ResolvedHandleData> &records = g_handleTableSnapshot.Records;
+        records.resize(count);
+        for (unsigned int i = 0; i < count; ++i)
         {
-            if (FAILED(hr = handles->Next(_countof(data), data, &fetched)))
+            sos::CheckInterrupt();
+
+            ResolvedHandleData &record = records[i];
+            record.Handle = sorted[i];
+            record.Object = 0;
+            record.MT = 0;
+            record.Size = 0;
+            record.ReadFailed = FAILED(ranges[i].Status);
+
+            if (!record.ReadFailed)
             {
-                ExtOut("Error %x while walking the handle table.\n", hr);
-                break;
+                record.Object = referents[i];
+                sos::Object obj(TO_TADDR(referents[i]));
+                record.MT = obj.GetMT();
+                if (!sos::MethodTable::IsFreeMT(record.MT) && sos::MethodTable::IsValid(record.MT))
+                    record.Size = obj.GetSize();
             }
-            
-            WalkHandles(data, fetched);
-        } while (_countof(data) == fetched);
+        }
+
+        g_handleTableSnapshot.Valid = TRUE;
     }
-    
-    void WalkHandles(SOSHandleData data[], unsigned int count)
+
+    void WalkHandles()
     {
-        for (unsigned int i = 0; i < count; ++i)
+        const std::vector<ResolvedHandleData> &records = g_handleTableSnapshot.Records;
+        for (size_t i = 0; i < records.size(); ++i)
         {
             sos::CheckInterrupt();
-        
-            if (mType != (unsigned int)~0 && mType != data[i].Type)
+
+            const ResolvedHandleData &record = records[i];
+            const SOSHandleData &data = record.Handle;
+
+            if (mType != (unsigned int)~0 && mType != data.Type)
                 continue;
-        
-            GCHandleStatistics *pStats = mHandleStat.LookupStatistics(data[i].AppDomain);
+
+            GCHandleStatistics *pStats = mHandleStat.LookupStatistics(data.AppDomain);
             TADDR objAddr = 0;
             TADDR mtAddr = 0;
             size_t size = 0;
             const WCHAR *mtName = 0;
             const char *type = 0;
-            
-            if (FAILED(MOVE(objAddr, data[i].Handle)))
+
+            if (record.ReadFailed)
             {
                 objAddr = 0;
                 mtName = W("<error>");
             }
             else
             {
-                sos::Object obj(TO_TADDR(objAddr));
-                mtAddr = obj.GetMT();
+                objAddr = record.Object;
+                mtAddr = record.MT;
                 if (sos::MethodTable::IsFreeMT(mtAddr))
                 {
                     mtName = W("<free>");
@@ -11084,13 +14303,12 @@ private:
                 }
                 else
                 {
-                    size = obj.GetSize();
-                    if (mType == (unsigned int)~0 || mType == data[i].Type)
-                        pStats->hs.Add(obj.GetMT(), (DWORD)size);
+                    size = record.Size;
+                    pStats->hs.Add(mtAddr, (DWORD)size);
                 }
             }
-        
-            switch(data[i].Type)
+
+            switch(data.Type)
             {
                 case HNDTYPE_PINNED:
                     type = "Pinned";
@@ -11139,20 +14357,39 @@ private:
                     break;
             }
             
-            if (type && !mStat)
+            if (type && mJson)
             {
                 sos::MethodTable mt = mtAddr;
                 if (mtName == 0)
                     mtName = mt.GetName();
-                
-                if (data[i].Type == HNDTYPE_REFCOUNTED)
-                    mOut.WriteRow(data[i].Handle, type, ObjectPtr(objAddr), Decimal(size), Decimal(data[i].RefCount), mtName);
-                else if (data[i].Type == HNDTYPE_DEPENDENT)
-                    mOut.WriteRow(data[i].Handle, type, ObjectPtr(objAddr), Decimal(size), ObjectPtr(data[i].Secondary), mtName);
-                else if (data[i].Type == HNDTYPE_WEAK_WINRT)
-                    mOut.WriteRow(data[i].Handle, type, ObjectPtr(objAddr), Decimal(size), Pointer(data[i].Secondary), mtName);
+
+                mJsonOut.BeginRecord("handle");
+                mJsonOut.FieldHex("handle", data.Handle);
+                mJsonOut.Field("type", type);
+                mJsonOut.FieldHex("object", objAddr);
+                mJsonOut.Field("size", (ULONG64)size);
+                if (data.Type == HNDTYPE_REFCOUNTED)
+                    mJsonOut.Field("refCount", (ULONG64)data.RefCount);
+                else if (data.Type == HNDTYPE_DEPENDENT || data.Type == HNDTYPE_WEAK_WINRT)
+                    mJsonOut.FieldHex("secondary", data.Secondary);
+                mJsonOut.FieldHex("mt", mtAddr);
+                mJsonOut.Field("mtName", mtName);
+                mJsonOut.EndRecord();
+            }
+            else if (type && !mStat)
+            {
+                sos::MethodTable mt = mtAddr;
+                if (mtName == 0)
+                    mtName = mt.GetName();
+
+                if (data.Type == HNDTYPE_REFCOUNTED)
+                    mOut.WriteRow(data.Handle, type, ObjectPtr(objAddr), Decimal(size), Decimal(data.RefCount), mtName);
+                else if (data.Type == HNDTYPE_DEPENDENT)
+                    mOut.WriteRow(data.Handle, type, ObjectPtr(objAddr), Decimal(size), ObjectPtr(data.Secondary), mtName);
+                else if (data.Type == HNDTYPE_WEAK_WINRT)
+                    mOut.WriteRow(data.Handle, type, ObjectPtr(objAddr), Decimal(size), Pointer(data.Secondary), mtName);
                 else
-                    mOut.WriteRow(data[i].Handle, type, ObjectPtr(objAddr), Decimal(size), "", mtName);
+                    mOut.WriteRow(data.Handle, type, ObjectPtr(objAddr), Decimal(size), "", mtName);
             }
         }
     }
@@ -11180,11 +14417,104 @@ private:
         PrintHandleRow("Dependent Handles:", pStats->dependentCount);
         PrintHandleRow("Other Handles:", pStats->unknownHandleCount);
     }
-    
+
+    /* Every -summary aggregate comes out of the one cached enumeration pass:
+     * per-type counts, the per-appdomain breakdown, the bytes the pinning
+     * handles keep alive, and a refcount histogram for the RefCounted
+     * handles.  -type narrows the records the aggregates are computed over.
+     */
+    void PrintSummary()
+    {
+        static const char *typeNames[] =
+        {
+            "WeakShort", "WeakLong", "Strong", "Pinned", "Variable",
+            "RefCounted", "Dependent", "AsyncPinned", "SizedRef", "WeakWinRT",
+        };
+        static const char *refCountBucketNames[] =
+        {
+            "0-1", "2-3", "4-7", "8-15", "16-31", "32-63", "64-127", "128+",
+        };
+
+        const std::vector<ResolvedHandleData> &records = g_handleTableSnapshot.Records;
+
+        size_t typeCounts[_countof(typeNames)] = {};
+        size_t otherCount = 0;
+        size_t pinnedHandles = 0;
+        ULONG64 pinnedBytes = 0;
+        size_t refCountBuckets[_countof(refCountBucketNames)] = {};
+        std::map<CLRDATA_ADDRESS, size_t> domainCounts;
+
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            sos::CheckInterrupt();
+
+            const SOSHandleData &data = records[i].Handle;
+            if (mType != (unsigned int)~0 && mType != data.Type)
+                continue;
+
+            if (data.Type < _countof(typeNames))
+                typeCounts[data.Type]++;
+            else
+                otherCount++;
+
+            domainCounts[data.AppDomain]++;
+
+            if (data.Type == HNDTYPE_PINNED || data.Type == HNDTYPE_ASYNCPINNED)
+            {
+                pinnedHandles++;
+                pinnedBytes += records[i].Size;
+            }
+
+            if (data.Type == HNDTYPE_REFCOUNTED)
+            {
+                unsigned int bucket = 0;
+                for (ULONG64 refCount = data.RefCount; refCount > 1 && bucket < _countof(refCountBuckets) - 1; refCount >>= 1)
+                    bucket++;
+                refCountBuckets[bucket]++;
+            }
+        }
+
+        Print("Handles by type:\n");
+        mOut.ReInit(2, 21, AlignLeft, 4);
+        size_t total = otherCount;
+        for (size_t t = 0; t < _countof(typeNames); ++t)
+        {
+            total += typeCounts[t];
+            if (typeCounts[t] != 0)
+                mOut.WriteRow(typeNames[t], Decimal(typeCounts[t]));
+        }
+        if (otherCount != 0)
+            mOut.WriteRow("Other", Decimal(otherCount));
+        mOut.WriteRow("Total", Decimal(total));
+
+        Print("\nHandles by AppDomain:\n");
+        mOut.ReInit(2, POINTERSIZE_HEX, AlignLeft, 4);
+        for (std::map<CLRDATA_ADDRESS, size_t>::const_iterator it = domainCounts.begin(); it != domainCounts.end(); ++it)
+            mOut.WriteRow(AppDomainPtr(it->first), Decimal(it->second));
+
+        if (pinnedHandles != 0)
+        {
+            Print("\nPinned referents (Pinned + AsyncPinned):\n");
+            mOut.ReInit(2, 21, AlignLeft, 4);
+            mOut.WriteRow("Handles:", Decimal(pinnedHandles));
+            mOut.WriteRow("Bytes pinned:", Decimal(pinnedBytes));
+        }
+
+        if (typeCounts[HNDTYPE_REFCOUNTED] != 0)
+        {
+            Print("\nRefCounted handles by refcount:\n");
+            mOut.ReInit(2, 21, AlignLeft, 4);
+            for (size_t b = 0; b < _countof(refCountBuckets); ++b)
+                if (refCountBuckets[b] != 0)
+                    mOut.WriteRow(refCountBucketNames[b], Decimal(refCountBuckets[b]));
+        }
+    }
+
 private:
-    BOOL mPerDomain, mStat, mDML;
+    BOOL mPerDomain, mStat, mJson, mSummary, mDML;
     unsigned int mType;
     TableOutput mOut;
+    JsonWriter mJsonOut;
     GCHandleStatsForDomains mHandleStat;
 };
 
@@ -11607,6 +14937,102 @@ DECLARE_API(ObjSize)
 
 #ifndef FEATURE_PAL
 // For FEATURE_PAL, MEMORY_BASIC_INFORMATION64 doesn't exist yet. TODO?
+
+/* The !gchandleleaks memory scan.  The committed address space is enumerated
+ * up front and cut into fixed-size chunks which are distributed across the
+ * worker pool; each worker reads its chunk under the pool's read lock and
+ * scans the words locally, so the only serialized operation on the hot path
+ * is the read itself.  A word is only a candidate when it falls inside the
+ * value range spanned by the handles (the vector range-scan kernel weeds out
+ * everything else), and candidates resolve against the sorted handle array
+ * by binary search instead of the old linear sweep per word.  Matches are
+ * rare; they are recorded under a lock and the main thread reports them in
+ * address order after the join, the same order the serial scan printed.
+ */
+struct HandleScanChunk
+{
+    ULONG64 Base;
+    ULONG Size;
+};
+
+struct HandleScanMatch
+{
+    ULONG64 Location;   // address of the word that held the handle value
+    UINT Handle;        // index into the caller's handle array
+
+    HandleScanMatch(ULONG64 location, UINT handle)
+        : Location(location), Handle(handle)
+    {
+    }
+};
+
+struct HandleScanState
+{
+    const HandleScanChunk *Chunks;
+    const std::pair<DWORD_PTR, UINT> *Handles;  // masked handle values, sorted
+    UINT HandleCount;
+    DWORD_PTR RangeBase;                        // prefilter window covering every masked value
+    DWORD_PTR RangeSize;
+    BYTE **Buffers;                             // one chunk-sized read buffer per rank
+    CRITICAL_SECTION *ReadLock;                 // NULL on the serial fallback path
+    std::vector<HandleScanMatch> *Matches;
+    CRITICAL_SECTION *MatchLock;
+};
+
+// Amount of memory a scan worker reads per serialized ReadVirtual call.
+static const ULONG kHandleScanChunkSize = 0x100000;
+
+static void ScanHandleChunk(void *state, int rank, size_t index)
+{
+    HandleScanState *hss = (HandleScanState*)state;
+    const HandleScanChunk &chunk = hss->Chunks[index];
+    BYTE *buffer = hss->Buffers[rank];
+
+    ULONG fetched = 0;
+    if (hss->ReadLock != NULL)
+        EnterCriticalSection(hss->ReadLock);
+    HRESULT hr = g_ExtData->ReadVirtual(UL64_TO_CDA(chunk.Base), buffer, chunk.Size, &fetched);
+    if (hss->ReadLock != NULL)
+        LeaveCriticalSection(hss->ReadLock);
+
+    // A short read still yields a scannable prefix; an unreadable chunk yields nothing.
+    if (FAILED(hr) || fetched < sizeof(DWORD_PTR))
+        return;
+
+    const DWORD_PTR *slots = (const DWORD_PTR *)buffer;
+    size_t count = fetched / sizeof(DWORD_PTR);
+    for (size_t i = ScanNextSlotInRange(slots, count, 0, hss->RangeBase, hss->RangeSize);
+         i < count;
+         i = ScanNextSlotInRange(slots, count, i + 1, hss->RangeBase, hss->RangeSize))
+    {
+        // We don't care about the low bit. Also, the GCHandle class turns on the
+        // low bit for pinned handles, so without the masking below, we wouldn't
+        // notice pinned handles.
+        DWORD_PTR value = slots[i] & ~(DWORD_PTR)1;
+
+        UINT lo = 0, hi = hss->HandleCount;
+        while (lo < hi)
+        {
+            UINT mid = (lo + hi) / 2;
+            if (hss->Handles[mid].first < value)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for (UINT j = lo; j < hss->HandleCount && hss->Handles[j].first == value; j++)
+        {
+            EnterCriticalSection(hss->MatchLock);
+            hss->Matches->push_back(HandleScanMatch(chunk.Base + i * sizeof(DWORD_PTR), hss->Handles[j].second));
+            LeaveCriticalSection(hss->MatchLock);
+        }
+    }
+}
+
+static bool HandleScanMatchLess(const HandleScanMatch &m1, const HandleScanMatch &m2)
+{
+    return m1.Location < m2.Location;
+}
+
 DECLARE_API(GCHandleLeaks)
 {
     INIT_API();
@@ -11644,9 +15070,6 @@ DECLARE_API(GCHandleLeaks)
     }
 
     ExtOut("\nSearching memory\n");
-    // Now search memory for this:
-    DWORD_PTR buffer[1024];
-    ULONG64 memCur = 0x0;
     BOOL bAbort = FALSE;
 
     //find out memory used by stress log
@@ -11678,75 +15101,137 @@ DECLARE_API(GCHandleLeaks)
     }
     
     
-    while (!bAbort)
+    // Enumerate the readable committed regions up front and cut them into
+    // fixed-size chunks, so the scan can be partitioned across the worker
+    // pool instead of discovering the address space as it goes, and never
+    // touches memory that could only produce read failures.
+    std::vector<MemoryRegion> regions;
+    if (!EnumReadableMemoryRegions(regions))
     {
-        NTSTATUS status;
-        MEMORY_BASIC_INFORMATION64 memInfo;
+        ExtOut("Unable to enumerate the target's memory regions\n");
+    }
 
-        status = g_ExtData2->QueryVirtual(UL64_TO_CDA(memCur), &memInfo);
-                
-        if( !NT_SUCCESS(status) ) 
-        {            
-            break;
+    std::vector<HandleScanChunk> chunks;
+    for (size_t r = 0; r < regions.size(); r++)
+    {
+        for (ULONG64 offset = 0; offset < regions[r].Size; offset += kHandleScanChunkSize)
+        {
+            HandleScanChunk chunk;
+            chunk.Base = regions[r].Base + offset;
+            chunk.Size = (ULONG)min(regions[r].Size - offset, (ULONG64)kHandleScanChunkSize);
+            chunks.push_back(chunk);
         }
+    }
 
-        if (memInfo.State == MEM_COMMIT)
-        {            
-            for (ULONG64 memIter = memCur; memIter < (memCur + memInfo.RegionSize); memIter+=sizeof(buffer))
+    // The masked handle values in sorted order, so a candidate word resolves by
+    // binary search, and the value range they span, so the scan kernel can
+    // reject almost every word without one.
+    std::vector<std::pair<DWORD_PTR, UINT> > sortedHandles;
+    sortedHandles.reserve(iFinal);
+    for (i = 0; i < iFinal; i++)
+    {
+        sortedHandles.push_back(std::pair<DWORD_PTR, UINT>(array[i] & ~(DWORD_PTR)1, i));
+    }
+    std::sort(sortedHandles.begin(), sortedHandles.end());
+
+    std::vector<HandleScanMatch> matches;
+    CRITICAL_SECTION matchLock;
+    InitializeCriticalSection(&matchLock);
+
+    if (iFinal > 0 && chunks.size() > 0)
+    {
+        HandleScanState state;
+        state.Chunks = chunks.data();
+        state.Handles = sortedHandles.data();
+        state.HandleCount = iFinal;
+        state.RangeBase = sortedHandles.front().first;
+        // +2 keeps a raw word whose low bit is set inside the window for the
+        // largest handle value.
+        state.RangeSize = sortedHandles.back().first - sortedHandles.front().first + 2;
+        state.Matches = &matches;
+        state.MatchLock = &matchLock;
+
+        // Partition the chunks across the pool; fall back to a serial pass over
+        // the same chunk list if the pool is unavailable.
+        BOOL scanned = FALSE;
+        SOSTaskPool *pool = SOSTaskPool::Get();
+        if (pool != NULL)
+        {
+            int ranks = pool->WorkerCount();
+            std::vector<BYTE*> buffers(ranks, (BYTE*)NULL);
+            bool buffersOk = true;
+            for (int r = 0; r < ranks; r++)
             {
-                if (IsInterrupt())
+                buffers[r] = (BYTE*)AllocScratchBuffer(kHandleScanChunkSize);
+                if (buffers[r] == NULL)
+                    buffersOk = false;
+            }
+
+            if (buffersOk)
+            {
+                state.Buffers = buffers.data();
+                state.ReadLock = pool->ReadLock();
+                ExtOut("Scanning %d committed chunks on %d workers...\n", (int)chunks.size(), ranks);
+                scanned = pool->ForEach(chunks.size(), ScanHandleChunk, &state);
+                if (!scanned && IsInterrupt())
                 {
-                    ExtOut("Quitting at %p due to user abort\n", SOS_PTR(memIter));
+                    ExtOut("Quitting due to user abort\n");
                     bAbort = TRUE;
-                    break;
+                    scanned = TRUE;
                 }
+            }
+
+            for (int r = 0; r < ranks; r++)
+            {
+                FreeScratchBuffer(buffers[r], kHandleScanChunkSize);
+            }
+        }
 
-                if ((memIter % 0x10000000)==0x0)
+        if (!scanned)
+        {
+            BYTE *buffer = (BYTE*)AllocScratchBuffer(kHandleScanChunkSize);
+            if (buffer != NULL)
+            {
+                state.Buffers = &buffer;
+                state.ReadLock = NULL;
+                for (size_t c = 0; c < chunks.size(); c++)
                 {
-                    ExtOut("Searching %p...\n", SOS_PTR(memIter));
-                }
-                
-                ULONG size = 0;
-                HRESULT ret;
-                ret = g_ExtData->ReadVirtual(UL64_TO_CDA(memIter), buffer, sizeof(buffer), &size);
-                if (ret == S_OK)
-                {
-                    for (UINT x=0;x<1024;x++)
-                    {            
-                        DWORD_PTR value = buffer[x];
-                        // We don't care about the low bit. Also, the GCHandle class turns on the
-                        // low bit for pinned handles, so without the statement below, we wouldn't
-                        // notice pinned handles.
-                        value = value & ~1; 
-                        for (i=0;i<iFinal;i++)
-                        {
-                            ULONG64 addrInDebugee = (ULONG64)memIter+(x*sizeof(DWORD_PTR));
-                            if ((array[i] & ~1) == value)
-                            {
-                                if (stressLog.IsInStressLog (addrInDebugee))
-                                {
-                                    ExtOut("Found %p in stress log at location %p, reference not counted\n", SOS_PTR(value), addrInDebugee);
-                                }
-                                else
-                                {
-                                    ExtOut("Found %p at location %p\n", SOS_PTR(value), addrInDebugee);
-                                    array[i] |= 0x1;
-                                }
-                            }
-                        }
+                    if (IsInterrupt())
+                    {
+                        ExtOut("Quitting at %p due to user abort\n", SOS_PTR(chunks[c].Base));
+                        bAbort = TRUE;
+                        break;
                     }
-                }
-                else
-                {
-                    if (size > 0)
+
+                    if ((chunks[c].Base % 0x10000000) == 0x0)
                     {
-                        ExtOut("only read %x bytes at %p\n", size, SOS_PTR(memIter));
+                        ExtOut("Searching %p...\n", SOS_PTR(chunks[c].Base));
                     }
+
+                    ScanHandleChunk(&state, 0, c);
                 }
+                FreeScratchBuffer(buffer, kHandleScanChunkSize);
             }
         }
-        
-        memCur += memInfo.RegionSize;
+    }
+
+    DeleteCriticalSection(&matchLock);
+
+    // Report the matches in address order, the same order the serial scan
+    // printed them, and mark the handles they account for.
+    std::sort(matches.begin(), matches.end(), HandleScanMatchLess);
+    for (size_t m = 0; m < matches.size(); m++)
+    {
+        DWORD_PTR value = array[matches[m].Handle] & ~(DWORD_PTR)1;
+        if (stressLog.IsInStressLog(matches[m].Location))
+        {
+            ExtOut("Found %p in stress log at location %p, reference not counted\n", SOS_PTR(value), matches[m].Location);
+        }
+        else
+        {
+            ExtOut("Found %p at location %p\n", SOS_PTR(value), matches[m].Location);
+            array[matches[m].Handle] |= 0x1;
+        }
     }
 
     int numNotFound = 0;
@@ -12963,6 +16448,28 @@ void PrintRef(const SOSStackRefData &ref, TableOutput &out)
 }
 
 
+/* Per-MethodDesc memo of argument names for !clrstack -p.  The names fall
+ * out of the method's signature parse, so they are identical for every
+ * frame of the method - and a dump full of thread-pool threads decodes the
+ * same few methods on every stack.  Once a method's names are known, later
+ * frames ask the DAC for the value only and print the memoized names.
+ * The names are interned, so the memo clears alongside the string pool.
+ */
+struct FrameArgNameMemo
+{
+    bool Known;                     // every name recorded; later frames skip resolution
+    std::vector<const WCHAR *> Names;
+
+    FrameArgNameMemo() : Known(false) {}
+};
+
+static std::unordered_map<CLRDATA_ADDRESS, FrameArgNameMemo> g_frameArgNameMemo;
+
+void ClearFrameArgNameMemo()
+{
+    g_frameArgNameMemo.clear();
+}
+
 class ClrStackImpl
 {
 public:
@@ -13064,7 +16571,10 @@ public:
                 else
                 {
                     out.WriteColumn(1, InstructionPtr(ip));
-                    out.WriteColumn(2, MethodNameFromIP(ip, bSuppressLines, bFull, bFull));
+                    // Narrow the frame name up front; the arena conversion's
+                    // ASCII fast path beats the per-character widening %S
+                    // would do for every frame of every thread.
+                    out.WriteColumn(2, WideToNarrowArena(MethodNameFromIP(ip, bSuppressLines, bFull, bFull).c_str()));
 
                     // Print out gc references.  refCount will be zero if bGC is false (or if we
                     // failed to fetch gc reference information).
@@ -13078,7 +16588,7 @@ public:
                             out.WriteColumn(2, "Failed to enumerate GC references.");
 
                     if (bParams || bLocals)
-                        PrintArgsAndLocals(pStackWalk, bParams, bLocals);
+                        PrintArgsAndLocals(pStackWalk, ip, sp, bParams, bLocals);
                 }
             }
 
@@ -13225,20 +16735,108 @@ public:
         }
     }
 
-    static void PrintCurrentThread(BOOL bParams, BOOL bLocals, BOOL bSuppressLines, BOOL bGC, BOOL bNative, BOOL bDisplayRegVals)
+    static void PrintCurrentThread(BOOL bParams, BOOL bLocals, BOOL bSuppressLines, BOOL bGC, BOOL bNative, BOOL bDisplayRegVals)
+    {
+        ULONG id = 0;
+        ULONG osid = 0;
+        
+        g_ExtSystem->GetCurrentThreadSystemId(&osid);
+        ExtOut("OS Thread Id: 0x%x ", osid);
+        g_ExtSystem->GetCurrentThreadId(&id);
+        ExtOut("(%d)\n", id);
+        
+        PrintThread(osid, bParams, bLocals, bSuppressLines, bGC, bNative, bDisplayRegVals);
+    }
+
+    static void PrintAllThreads(BOOL bParams, BOOL bLocals, BOOL bSuppressLines, BOOL bGC, BOOL bNative, BOOL bDisplayRegVals)
+    {
+        HRESULT Status;
+
+        DacpThreadStoreData ThreadStore;
+        if ((Status = ThreadStore.Request(g_sos)) != S_OK)
+        {
+            ExtErr("Failed to request ThreadStore\n");
+            return;
+        }
+
+        DacpThreadData Thread;
+        CLRDATA_ADDRESS CurThread = ThreadStore.firstThread;
+        while (CurThread != 0)
+        {
+            if (IsInterrupt())
+                break;
+
+            if ((Status = Thread.Request(g_sos, CurThread)) != S_OK)
+            {
+                ExtErr("Failed to request thread at %p\n", CurThread);
+                return;
+            }
+            if (Thread.osThreadId != 0)
+            {
+                ExtOut("OS Thread Id: 0x%x\n", Thread.osThreadId);
+                PrintThread(Thread.osThreadId, bParams, bLocals, bSuppressLines, bGC, bNative, bDisplayRegVals);
+            }
+            CurThread = Thread.nextThread;
+        }
+    }
+
+    // The -json twin of PrintThread: one JSON record per frame, newest
+    // first.  Only the frame list is emitted; params, locals and GC refs
+    // stay with the text mode.
+    static void PrintThreadJson(ULONG osID)
+    {
+        ToRelease<IXCLRDataStackWalk> pStackWalk;
+        HRESULT hr = CreateStackWalk(osID, &pStackWalk);
+        if (FAILED(hr) || pStackWalk == NULL)
+        {
+            ExtOut("Failed to start stack walk: %lx\n", hr);
+            return;
+        }
+
+        JsonWriter json;
+        ULONG64 frameNumber = 0;
+        do
+        {
+            if (IsInterrupt())
+                break;
+
+            CLRDATA_ADDRESS ip = 0, sp = 0;
+            hr = GetFrameLocation(pStackWalk, &ip, &sp);
+            if (SUCCEEDED(hr))
+            {
+                DacpFrameData FrameData;
+                HRESULT frameDataResult = FrameData.Request(pStackWalk);
+
+                json.BeginRecord("frame");
+                json.FieldHex("osId", osID);
+                json.Field("index", frameNumber++);
+                if (SUCCEEDED(frameDataResult) && FrameData.frameAddr)
+                {
+                    // A clr!Frame rather than a managed method.
+                    json.FieldHex("sp", FrameData.frameAddr);
+                    json.FieldBool("managed", false);
+                    json.Field("site", GetFrameFromAddress(TO_TADDR(FrameData.frameAddr), pStackWalk).c_str());
+                }
+                else
+                {
+                    json.FieldHex("sp", sp);
+                    json.FieldHex("ip", ip);
+                    json.FieldBool("managed", true);
+                    json.Field("site", MethodNameFromIP(ip, TRUE).c_str());
+                }
+                json.EndRecord();
+            }
+        } while (pStackWalk->Next() == S_OK);
+    }
+
+    static void PrintCurrentThreadJson()
     {
-        ULONG id = 0;
         ULONG osid = 0;
-        
         g_ExtSystem->GetCurrentThreadSystemId(&osid);
-        ExtOut("OS Thread Id: 0x%x ", osid);
-        g_ExtSystem->GetCurrentThreadId(&id);
-        ExtOut("(%d)\n", id);
-        
-        PrintThread(osid, bParams, bLocals, bSuppressLines, bGC, bNative, bDisplayRegVals);
+        PrintThreadJson(osid);
     }
 
-    static void PrintAllThreads(BOOL bParams, BOOL bLocals, BOOL bSuppressLines, BOOL bGC, BOOL bNative, BOOL bDisplayRegVals)
+    static void PrintAllThreadsJson()
     {
         HRESULT Status;
 
@@ -13256,6 +16854,55 @@ public:
             if (IsInterrupt())
                 break;
 
+            if ((Status = Thread.Request(g_sos, CurThread)) != S_OK)
+            {
+                ExtErr("Failed to request thread at %p\n", CurThread);
+                return;
+            }
+            if (Thread.osThreadId != 0)
+                PrintThreadJson(Thread.osThreadId);
+            CurThread = Thread.nextThread;
+        }
+    }
+
+    /* Walks every managed thread and prints each distinct stack once with
+     * the list of threads sharing it, most common stack first.  On dumps
+     * with thousands of near-identical thread-pool stacks this turns the
+     * per-thread output into a short starvation-triage summary.
+     */
+    static void PrintAllThreadsDeduped(BOOL bSuppressLines, BOOL bFull)
+    {
+        HRESULT Status;
+
+        DacpThreadStoreData ThreadStore;
+        if ((Status = ThreadStore.Request(g_sos)) != S_OK)
+        {
+            ExtErr("Failed to request ThreadStore\n");
+            return;
+        }
+
+        // Frame locations resolve once per distinct ip no matter how many
+        // threads are parked on it.
+        std::unordered_map<TADDR, std::wstring> nameMemo;
+
+        struct StackGroup
+        {
+            std::vector<ULONG> Threads;
+            std::vector<std::wstring> Frames;
+        };
+        // The signature is the concatenated frame text, so stacks group on
+        // what would be printed rather than on raw addresses.
+        std::unordered_map<std::wstring, StackGroup> groups;
+        int threadsWalked = 0;
+        int walkFailures = 0;
+
+        DacpThreadData Thread;
+        CLRDATA_ADDRESS CurThread = ThreadStore.firstThread;
+        while (CurThread != 0)
+        {
+            if (IsInterrupt())
+                return;
+
             if ((Status = Thread.Request(g_sos, CurThread)) != S_OK)
             {
                 ExtErr("Failed to request thread at %p\n", CurThread);
@@ -13263,14 +16910,140 @@ public:
             }
             if (Thread.osThreadId != 0)
             {
-                ExtOut("OS Thread Id: 0x%x\n", Thread.osThreadId);
-                PrintThread(Thread.osThreadId, bParams, bLocals, bSuppressLines, bGC, bNative, bDisplayRegVals);
+                std::vector<std::wstring> frames;
+                if (CollectThreadStack(Thread.osThreadId, bSuppressLines, bFull, nameMemo, frames))
+                {
+                    std::wstring signature;
+                    for (size_t i = 0; i < frames.size(); i++)
+                    {
+                        signature += frames[i];
+                        signature += L'\n';
+                    }
+
+                    StackGroup &group = groups[signature];
+                    if (group.Threads.empty())
+                        group.Frames = frames;
+                    group.Threads.push_back(Thread.osThreadId);
+                    threadsWalked++;
+                }
+                else
+                {
+                    walkFailures++;
+                }
             }
             CurThread = Thread.nextThread;
         }
+
+        // Most common stack first.
+        std::vector<const StackGroup*> sorted;
+        for (std::unordered_map<std::wstring, StackGroup>::const_iterator itr = groups.begin(); itr != groups.end(); ++itr)
+            sorted.push_back(&itr->second);
+        std::sort(sorted.begin(), sorted.end(),
+            [] (const StackGroup *a, const StackGroup *b) { return a->Threads.size() > b->Threads.size(); });
+
+        ExtOut("%d unique stack(s) across %d thread(s)\n", (int)sorted.size(), threadsWalked);
+        for (size_t n = 0; n < sorted.size(); n++)
+        {
+            const StackGroup &group = *sorted[n];
+
+            ExtOut("\n%d thread(s):", (int)group.Threads.size());
+            for (size_t i = 0; i < group.Threads.size(); i++)
+                ExtOut(" 0x%x", group.Threads[i]);
+            ExtOut("\n");
+
+            if (group.Frames.empty())
+            {
+                ExtOut("    <no managed frames>\n");
+                continue;
+            }
+            for (size_t i = 0; i < group.Frames.size(); i++)
+                ExtOut("    %S\n", group.Frames[i].c_str());
+        }
+
+        if (walkFailures != 0)
+        {
+            ExtOut("\n%d thread(s) could not be walked\n", walkFailures);
+        }
+    }
+
+private:
+    /* Collects the rendered frames of one thread's managed stack without
+     * printing them.  Returns false if the thread's stack could not be
+     * walked at all.
+     */
+    static bool CollectThreadStack(ULONG osID, BOOL bSuppressLines, BOOL bFull,
+                                   std::unordered_map<TADDR, std::wstring> &nameMemo,
+                                   std::vector<std::wstring> &frames)
+    {
+        ToRelease<IXCLRDataTask> pTask;
+        if (g_clrData->GetTaskByOSThreadID(osID, &pTask) != S_OK)
+            return false;
+
+        ToRelease<IXCLRDataStackWalk> pStackWalk;
+        if (pTask->CreateStackWalk(CLRDATA_SIMPFRAME_UNRECOGNIZED |
+                                   CLRDATA_SIMPFRAME_MANAGED_METHOD |
+                                   CLRDATA_SIMPFRAME_RUNTIME_MANAGED_CODE |
+                                   CLRDATA_SIMPFRAME_RUNTIME_UNMANAGED_CODE,
+                                   &pStackWalk) != S_OK)
+        {
+            return false;
+        }
+
+        do
+        {
+            if (IsInterrupt())
+                return false;
+
+            CLRDATA_ADDRESS ip = 0, sp = 0;
+            if (GetFrameLocation(pStackWalk, &ip, &sp) != S_OK)
+                break;
+
+            DacpFrameData FrameData;
+            if (SUCCEEDED(FrameData.Request(pStackWalk)) && FrameData.frameAddr)
+            {
+                // clr!Frame.  The frame address differs per thread, so the
+                // summary is built without it to keep identical transitions
+                // grouping together.
+                WString frameOutput(W("["));
+                TADDR vtAddr = 0;
+                if (SafeReadMemory(TO_TADDR(FrameData.frameAddr), &vtAddr, sizeof(vtAddr), NULL) &&
+                    SUCCEEDED(g_sos->GetFrameName(TO_CDADDR(vtAddr), mdNameLen, g_mdName, NULL)))
+                {
+                    frameOutput += g_mdName;
+                }
+                else
+                {
+                    frameOutput += W("Frame");
+                }
+                frameOutput += W("]");
+
+                CLRDATA_ADDRESS mdesc = 0;
+                if (SUCCEEDED(g_sos->GetMethodDescPtrFromFrame(FrameData.frameAddr, &mdesc)) &&
+                    SUCCEEDED(g_sos->GetMethodDescName(mdesc, mdNameLen, g_mdName, NULL)))
+                {
+                    frameOutput += W(" ");
+                    frameOutput += g_mdName;
+                }
+                frames.push_back(std::wstring(frameOutput.c_str()));
+            }
+            else
+            {
+                std::unordered_map<TADDR, std::wstring>::const_iterator itr = nameMemo.find(TO_TADDR(ip));
+                if (itr == nameMemo.end())
+                {
+                    // No displacement: grouping on the method (and line, when
+                    // enabled) keeps threads a few instructions apart in the
+                    // same call together.
+                    WString name = MethodNameFromIP(ip, bSuppressLines, bFull, FALSE);
+                    itr = nameMemo.insert(std::make_pair(TO_TADDR(ip), std::wstring(name.c_str()))).first;
+                }
+                frames.push_back(itr->second);
+            }
+        } while (pStackWalk->Next() == S_OK);
+
+        return true;
     }
 
-private: 
     static HRESULT CreateStackWalk(ULONG osID, IXCLRDataStackWalk **ppStackwalk)
     {
         HRESULT hr = S_OK;
@@ -13297,30 +17070,48 @@ private:
      *      bArgs - whether to print args
      *      bLocals - whether to print locals
      */
-    static void PrintArgsAndLocals(IXCLRDataStackWalk *pStackWalk, BOOL bArgs, BOOL bLocals)
+    static void PrintArgsAndLocals(IXCLRDataStackWalk *pStackWalk, CLRDATA_ADDRESS ip, CLRDATA_ADDRESS sp, BOOL bArgs, BOOL bLocals)
     {
         ToRelease<IXCLRDataFrame> pFrame;
         ToRelease<IXCLRDataValue> pVal;
         ULONG32 argCount = 0;
         ULONG32 localCount = 0;
         HRESULT hr = S_OK;
-        
+
+        // Stage the frame's stack window with one block read.  Every stack
+        // location the DAC resolves below lands in this range, and letting
+        // it read the values one at a time issues a target round trip per
+        // argument and local of every frame.
+        static const ULONG64 kFrameWindow = 0x400;
+        if (sp != 0)
+            PrefetchCachedReadVirtual(sp, kFrameWindow);
+
+        // The argument names are per-method, not per-frame; resolve them
+        // through the memo so repeated methods skip the signature parse.
+        FrameArgNameMemo *memo = NULL;
+        CLRDATA_ADDRESS methodDesc = 0;
+        if (bArgs && ip != 0 &&
+            g_sos->GetMethodDescPtrFromIP(ip, &methodDesc) == S_OK && methodDesc != 0)
+        {
+            memo = &g_frameArgNameMemo[methodDesc];
+        }
+
         hr = pStackWalk->GetFrame(&pFrame);
-        
+
         // Print arguments
         if (SUCCEEDED(hr) && bArgs)
             hr = pFrame->GetNumArguments(&argCount);
-                
+
         if (SUCCEEDED(hr) && bArgs)
-            hr = ShowArgs(argCount, pFrame, pVal);
-        
+            hr = ShowArgs(argCount, pFrame, pVal, memo);
+
         // Print locals
         if (SUCCEEDED(hr) && bLocals)
             hr = pFrame->GetNumLocalVariables(&localCount);
-        
+
         if (SUCCEEDED(hr) && bLocals)
             ShowLocals(localCount, pFrame, pVal);
-            
+
         ExtOut("\n");
     }
     
@@ -13332,42 +17123,63 @@ private:
      *      pFramey - the frame we are inspecting
      *      pVal - a pointer to the CLRDataValue we use to query for info about the args
      */
-    static HRESULT ShowArgs(ULONG32 argy, IXCLRDataFrame *pFramey, IXCLRDataValue *pVal)
+    static HRESULT ShowArgs(ULONG32 argy, IXCLRDataFrame *pFramey, IXCLRDataValue *pVal, FrameArgNameMemo *memo)
     {
         CLRDATA_ADDRESS addr = 0;
         BOOL fPrintedLocation = FALSE;
         ULONG64 outVar = 0;
         ULONG32 tmp;
         HRESULT hr = S_OK;
-        
+
         ArrayHolder<WCHAR> argName = new NOTHROW WCHAR[mdNameLen];
         if (!argName)
         {
             ReportOOM();
             return E_FAIL;
         }
-        
+
+        // A partially recorded memo is left over from a frame that failed
+        // mid-decode; start it over rather than appending to it.
+        if (memo != NULL && !memo->Known)
+            memo->Names.clear();
+
         for (ULONG32 i=0; i < argy; i++)
-        {   
+        {
             if (i == 0)
-            {      
+            {
                 ExtOut("    PARAMETERS:\n");
             }
-            
-            hr = pFramey->GetArgumentByIndex(i,
-                                   &pVal,
-                                   mdNameLen,
-                                   &tmp,
-                                   argName);
-            
-            if (FAILED(hr))
-                return hr;
+
+            const WCHAR *name = NULL;
+            if (memo != NULL && memo->Known && i < (ULONG32)memo->Names.size())
+            {
+                // The names are already known; ask the DAC for the value only.
+                hr = pFramey->GetArgumentByIndex(i, &pVal, 0, NULL, NULL);
+                if (SUCCEEDED(hr))
+                    name = memo->Names[i];
+            }
+
+            if (name == NULL)
+            {
+                hr = pFramey->GetArgumentByIndex(i,
+                                       &pVal,
+                                       mdNameLen,
+                                       &tmp,
+                                       argName);
+
+                if (FAILED(hr))
+                    return hr;
+
+                name = argName.GetPtr();
+                if (memo != NULL && !memo->Known)
+                    memo->Names.push_back(InternString(name));
+            }
 
             ExtOut("        ");
-            
-            if (argName[0] != L'\0')
+
+            if (name[0] != L'\0')
             {
-                ExtOut("%S ", argName.GetPtr());
+                ExtOut("%S ", name);
             }
             
             // At times we cannot print the value of a parameter (most
@@ -13393,9 +17205,9 @@ private:
                 }
             }
 
-            if (argName[0] != L'\0' || fPrintedLocation)
+            if (name[0] != L'\0' || fPrintedLocation)
             {
-                ExtOut("= ");                
+                ExtOut("= ");
             }
             
             if (HRESULT_CODE(pVal->GetBytes(0,&tmp,NULL)) == ERROR_BUFFER_OVERFLOW)
@@ -13438,7 +17250,10 @@ private:
             
             pVal->Release();
         }
-        
+
+        if (memo != NULL && !memo->Known && (ULONG32)memo->Names.size() == argy)
+            memo->Known = true;
+
         return S_OK;
     }
 
@@ -13459,11 +17274,17 @@ private:
             HRESULT hr;
             ExtOut("        ");
             
-            // local names don't work in Whidbey.
-            hr = pFramey->GetLocalVariableByIndex(i, &pVal, mdNameLen, NULL, g_mdName);
+            // local names don't work in Whidbey, and nothing below prints
+            // one - so don't make the DAC resolve them per frame.
+            hr = pFramey->GetLocalVariableByIndex(i, &pVal, 0, NULL, NULL);
             if (FAILED(hr))
             {
-                return hr;
+                // Retry with a buffer in case the implementation insists on one.
+                hr = pFramey->GetLocalVariableByIndex(i, &pVal, mdNameLen, NULL, g_mdName);
+                if (FAILED(hr))
+                {
+                    return hr;
+                }
             }
 
             ULONG32 numLocations;
@@ -13679,7 +17500,9 @@ DECLARE_API(ClrStack)
     BOOL dml = FALSE;
     BOOL bFull = FALSE;
     BOOL bDisplayRegVals = FALSE;
-    BOOL bAllThreads = FALSE;    
+    BOOL bAllThreads = FALSE;
+    BOOL bDedup = FALSE;
+    BOOL bJson = FALSE;
     DWORD frameToDumpVariablesFor = -1;
     StringHolder cvariableName;
     ArrayHolder<WCHAR> wvariableName = new NOTHROW WCHAR[mdNameLen];
@@ -13696,6 +17519,7 @@ DECLARE_API(ClrStack)
     {   // name, vptr, type, hasValue
         {"-a", &bAll, COBOOL, FALSE},
         {"-all", &bAllThreads, COBOOL, FALSE},
+        {"-dedup", &bDedup, COBOOL, FALSE},
         {"-p", &bParams, COBOOL, FALSE},
         {"-l", &bLocals, COBOOL, FALSE},
         {"-n", &bSuppressLines, COBOOL, FALSE},
@@ -13703,6 +17527,7 @@ DECLARE_API(ClrStack)
         {"-gc", &bGC, COBOOL, FALSE},
         {"-f", &bFull, COBOOL, FALSE},
         {"-r", &bDisplayRegVals, COBOOL, FALSE },
+        {"-json", &bJson, COBOOL, FALSE},
 #ifndef FEATURE_PAL
         {"/d", &dml, COBOOL, FALSE},
 #endif
@@ -13753,7 +17578,19 @@ DECLARE_API(ClrStack)
         return ClrStackImplWithICorDebug::ClrStackFromPublicInterface(bParams, bLocals, FALSE, wvariableName, frameToDumpVariablesFor);
     }
     
-    if (bAllThreads) {
+    if (bJson) {
+        // Machine-readable frame records; parameter, local and GC reference
+        // decoration stays with the text mode.
+        if (bAllThreads)
+            ClrStackImpl::PrintAllThreadsJson();
+        else
+            ClrStackImpl::PrintCurrentThreadJson();
+    }
+    else if (bDedup) {
+        // -dedup implies all threads; identical stacks print once.
+        ClrStackImpl::PrintAllThreadsDeduped(bSuppressLines, bFull);
+    }
+    else if (bAllThreads) {
         ClrStackImpl::PrintAllThreads(bParams, bLocals, bSuppressLines, bGC, bFull, bDisplayRegVals);
     }
     else {
@@ -14156,16 +17993,19 @@ static HRESULT DumpMDInfoBuffer(DWORD_PTR dwStartAddr, DWORD Flags, ULONG64 Esp,
         }
     }
 
-    // Under certain circumstances DacpMethodDescData::GetMethodDescName() 
+    // Under certain circumstances DacpMethodDescData::GetMethodDescName()
     //   returns a module qualified method name
-    HRESULT hr = g_sos->GetMethodDescName(dwStartAddr, MAX_LONGPATH, wszNameBuffer, NULL);
+    // Resolved through the session-level name cache: the same MethodDescs
+    // repeat across the frames of an async stack, and the stack formatters
+    // render every trace twice (once to size the output, once to fill it).
+    const WCHAR *pwszMethName = GetInternedMethodDescName(dwStartAddr);
 
-    WCHAR* pwszMethNameBegin = (hr != S_OK ? NULL : _wcschr(wszNameBuffer, L'!'));
-    if (!bModuleNameWorked && hr == S_OK && pwszMethNameBegin != NULL)
+    const WCHAR *pwszMethNameBegin = (pwszMethName == NULL ? NULL : _wcschr(pwszMethName, L'!'));
+    if (!bModuleNameWorked && pwszMethName != NULL && pwszMethNameBegin != NULL)
     {
         // if we weren't able to get the module name, but GetMethodDescName returned
         // the module as part of the returned method name, use this data
-        DOAPPEND(wszNameBuffer);
+        DOAPPEND(pwszMethName);
     }
     else
     {
@@ -14174,11 +18014,11 @@ static HRESULT DumpMDInfoBuffer(DWORD_PTR dwStartAddr, DWORD Flags, ULONG64 Esp,
             DOAPPEND (W("UNKNOWN"));
         }
         DOAPPEND(W("!"));
-        if (hr == S_OK)
+        if (pwszMethName != NULL)
         {
-            // the module name we retrieved above from debugger will take 
+            // the module name we retrieved above from debugger will take
             // precedence over the name possibly returned by GetMethodDescName()
-            DOAPPEND(pwszMethNameBegin != NULL ? (pwszMethNameBegin+1) : (WCHAR *)wszNameBuffer);
+            DOAPPEND(pwszMethNameBegin != NULL ? (pwszMethNameBegin+1) : pwszMethName);
         }
         else
         {
@@ -14585,7 +18425,7 @@ BOOL FormatFromRemoteString(DWORD_PTR strObjPointer, __out_ecount(cchString) PWS
         return bRet;
     }
     
-    if (g_sos->GetObjectStringData(TO_CDADDR(strObjPointer), stInfo.m_StringLength+1, pwszBuf, NULL)!=S_OK)
+    if (!sos::Object::ReadStringData(TO_TADDR(strObjPointer), stInfo.m_StringLength, pwszBuf, dwBufLength))
     {
         delete [] pwszBuf;
         return bRet;
@@ -15558,6 +19398,202 @@ DECLARE_API(SetSymbolServer)
     return Status;
 }
 
+//
+// Reports the memory read counters accumulated since the counters were last
+// reset: ReadVirtual calls and bytes, MOVE/page cache hit ratios, batches.
+//
+DECLARE_API(ReadStats)
+{
+    INIT_API_EXT();
+
+    BOOL reset = FALSE;
+    BOOL verbose = FALSE;
+    BOOL off = FALSE;
+    CMDOption option[] =
+    {   // name, vptr, type, hasValue
+        {"-reset", &reset, COBOOL, FALSE},
+        {"-v", &verbose, COBOOL, FALSE},
+        {"-off", &off, COBOOL, FALSE},
+    };
+    if (!GetCMDOption(args, option, _countof(option), NULL, 0, NULL))
+    {
+        return E_FAIL;
+    }
+
+    if (verbose && off)
+    {
+        ExtErr("Cannot have both -v and -off options\n");
+        return E_FAIL;
+    }
+
+    if (verbose)
+    {
+        g_readStatsVerbose = TRUE;
+        ExtOut("Per-command read summaries enabled.\n");
+    }
+    else if (off)
+    {
+        g_readStatsVerbose = FALSE;
+        ExtOut("Per-command read summaries disabled.\n");
+    }
+
+    if (reset)
+    {
+        g_readStats.Clear();
+        g_readStatsBaseline.Clear();
+        ExtOut("Read counters reset.\n");
+    }
+    else if (!verbose && !off)
+    {
+        ReadVirtualStats empty = {};
+        g_readStats.Print(empty);
+    }
+
+    return S_OK;
+}
+
+//
+// Controls the per-command profiler: while enabled, every command prints a
+// one-line wall/CPU/read summary when it finishes, and cumulative totals
+// accumulate per command.  With no options, prints the cumulative report.
+//
+DECLARE_API(SOSPerf)
+{
+    INIT_API_EXT();
+
+    BOOL on = FALSE;
+    BOOL off = FALSE;
+    BOOL reset = FALSE;
+    BOOL dac = FALSE;
+    BOOL sample = FALSE;
+    BOOL stacks = FALSE;
+    BOOL mem = FALSE;
+    size_t cachePages = 0;
+    size_t cacheSize = 0;
+    size_t progress = (size_t)-1;
+    size_t fastpaths = (size_t)-1;
+    CMDOption option[] =
+    {   // name, vptr, type, hasValue
+        {"-on", &on, COBOOL, FALSE},
+        {"-off", &off, COBOOL, FALSE},
+        {"-reset", &reset, COBOOL, FALSE},
+        {"-dac", &dac, COBOOL, FALSE},
+        {"-sample", &sample, COBOOL, FALSE},
+        {"-stacks", &stacks, COBOOL, FALSE},
+        {"-mem", &mem, COBOOL, FALSE},
+        {"-cachepages", &cachePages, COSIZE_T, TRUE},
+        {"-cachesize", &cacheSize, COSIZE_T, TRUE},
+        {"-progress", &progress, COSIZE_T, TRUE},
+        {"-fastpaths", &fastpaths, COSIZE_T, TRUE},
+    };
+    if (!GetCMDOption(args, option, _countof(option), NULL, 0, NULL))
+    {
+        return E_FAIL;
+    }
+
+    if (on && off)
+    {
+        ExtErr("Cannot have both -on and -off options\n");
+        return E_FAIL;
+    }
+
+    if (on)
+    {
+        g_sosPerfEnabled = TRUE;
+        ExtOut("Per-command profiling enabled.\n");
+    }
+    else if (off)
+    {
+        g_sosPerfEnabled = FALSE;
+        g_sosSampleEnabled = FALSE;
+        ExtOut("Per-command profiling and stack sampling disabled.\n");
+    }
+
+    if (sample)
+    {
+        g_sosSampleEnabled = TRUE;
+        ExtOut("Stack sampling armed; SOS stacks are collected while commands run.\n");
+    }
+
+    // Progress telemetry for long walks; 0 turns it off again.
+    if (progress != (size_t)-1)
+    {
+        if (progress == 0)
+        {
+            g_sosProgressEnabled = FALSE;
+            ExtOut("Progress reporting disabled.\n");
+        }
+        else
+        {
+            g_sosProgressEnabled = TRUE;
+            g_sosProgressIntervalSecs = progress;
+            ExtOut("Progress reported every %d seconds while long commands run.\n", (int)progress);
+        }
+    }
+
+    // Kill switch for the session caches and read fast paths; the shadow mode
+    // of the regression suite diffs command output with it off and on.
+    if (fastpaths != (size_t)-1)
+    {
+        g_sosFastPathsEnabled = (fastpaths != 0);
+        ExtOut("Fast paths %s.\n", g_sosFastPathsEnabled ? "enabled" : "disabled");
+    }
+
+    // Read-cache geometry.  On very large dumps the default 64 x 4K pages
+    // collapse into eviction churn during heap walks; the eviction counter
+    // in "!sosperf -dac" shows when that is happening.
+    if (cachePages != 0 || cacheSize != 0)
+    {
+        if (cacheSize != 0)
+        {
+            if ((cacheSize & (cacheSize - 1)) != 0 || cacheSize > 0x100000)
+            {
+                ExtErr("-cachesize must be a power of two no larger than 1MB\n");
+                return E_FAIL;
+            }
+            g_linearCachePageSize = (ULONG)cacheSize;
+        }
+        if (cachePages != 0)
+        {
+            if (cachePages > 0x10000)
+            {
+                ExtErr("-cachepages must be 65536 or less\n");
+                return E_FAIL;
+            }
+            g_linearCachePageCount = (int)cachePages;
+        }
+        ExtOut("Read cache geometry set to %d pages of %#x bytes (%d KB); applies to caches created from now on.\n",
+               g_linearCachePageCount, g_linearCachePageSize,
+               (int)(((ULONG64)g_linearCachePageCount * g_linearCachePageSize) / 1024));
+    }
+
+    if (reset)
+    {
+        SOSPerfReset();
+        DacPerfReset();
+        SOSSampleReset();
+        ExtOut("Profiling totals reset.\n");
+    }
+    else if (dac)
+    {
+        DacPerfReport();
+    }
+    else if (stacks)
+    {
+        SOSSampleReport();
+    }
+    else if (mem)
+    {
+        SOSMemReport();
+    }
+    else if (!on && !off && !sample && progress == (size_t)-1 && fastpaths == (size_t)-1)
+    {
+        SOSPerfReport();
+    }
+
+    return S_OK;
+}
+
 void PrintHelp (__in_z LPCSTR pszCmdName)
 {
     static LPSTR pText = NULL;
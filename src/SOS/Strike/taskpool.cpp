@@ -0,0 +1,304 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "sos.h"
+#include "taskpool.h"
+
+#include <stdlib.h>
+
+// Bounded by WaitForMultipleObjects.
+const int kMaxPoolWorkers = 64;
+
+SOSTaskPool *SOSTaskPool::s_pInstance = NULL;
+BOOL SOSTaskPool::s_createFailed = FALSE;
+
+/* The per-thread side of the pool.  Workers sleep on their start event
+ * between ForEach calls and are retired by the shutdown flag, so an idle
+ * pool costs nothing but the parked threads.
+ */
+struct PoolWorker
+{
+    SOSTaskPool *Pool;
+    int Rank;
+    HANDLE Thread;
+    HANDLE StartEvent;
+    HANDLE DoneEvent;
+
+    PoolWorker(SOSTaskPool *pool, int rank)
+        : Pool(pool), Rank(rank), Thread(NULL), StartEvent(NULL), DoneEvent(NULL)
+    {
+    }
+
+    ~PoolWorker()
+    {
+        if (Thread)
+            CloseHandle(Thread);
+
+        if (StartEvent)
+            CloseHandle(StartEvent);
+
+        if (DoneEvent)
+            CloseHandle(DoneEvent);
+    }
+
+    BOOL StartThread()
+    {
+        StartEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+        DoneEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (StartEvent == NULL || DoneEvent == NULL)
+            return FALSE;
+
+        Thread = CreateThread(NULL, 0, SOSTaskPool::WorkerThreadProc, this, 0, NULL);
+        return Thread != NULL;
+    }
+};
+
+DWORD WINAPI SOSTaskPool::WorkerThreadProc(LPVOID param)
+{
+    PoolWorker *worker = (PoolWorker*)param;
+
+    for (;;)
+    {
+        WaitForSingleObject(worker->StartEvent, INFINITE);
+
+        if (worker->Pool->mShutdown)
+            break;
+
+        worker->Pool->RunWorker(worker->Rank);
+        SetEvent(worker->DoneEvent);
+    }
+
+    return 0;
+}
+
+SOSTaskPool::SOSTaskPool()
+    : mWorkerCount(0), mWorkers(NULL), mScratch(NULL), mRanges(NULL),
+      mProc(NULL), mState(NULL), mCancel(0), mShutdown(0), mActive(FALSE)
+{
+    InitializeCriticalSection(&mReadLock);
+}
+
+SOSTaskPool::~SOSTaskPool()
+{
+    if (mWorkers != NULL)
+    {
+        // Wake every parked worker into the shutdown flag and join it.
+        InterlockedExchange(&mShutdown, 1);
+        for (int i = 0; i < mWorkerCount - 1; i++)
+        {
+            if (mWorkers[i] == NULL || mWorkers[i]->Thread == NULL)
+                continue;
+
+            SetEvent(mWorkers[i]->StartEvent);
+            WaitForSingleObject(mWorkers[i]->Thread, INFINITE);
+        }
+
+        for (int i = 0; i < mWorkerCount - 1; i++)
+            delete mWorkers[i];
+        delete [] mWorkers;
+    }
+
+    delete [] mScratch;
+    delete [] mRanges;
+    DeleteCriticalSection(&mReadLock);
+}
+
+BOOL SOSTaskPool::Start()
+{
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int cWorkers = (int)si.dwNumberOfProcessors;
+
+    const char *cap = getenv("SOS_MAX_WORKERS");
+    if (cap != NULL)
+    {
+        int maxWorkers = atoi(cap);
+        if (maxWorkers > 0 && cWorkers > maxWorkers)
+            cWorkers = maxWorkers;
+    }
+
+    if (cWorkers > kMaxPoolWorkers)
+        cWorkers = kMaxPoolWorkers;
+    if (cWorkers < 1)
+        cWorkers = 1;
+
+    mScratch = new Scratch[cWorkers];
+    mRanges = new Range[cWorkers];
+    if (mScratch == NULL || mRanges == NULL)
+        return FALSE;
+
+    for (int i = 0; i < cWorkers; i++)
+    {
+        if (!mScratch[i].Cache.Init(&mReadLock))
+            return FALSE;
+    }
+
+    // Ranks 1..cWorkers-1 are threads; the ForEach caller is rank 0.
+    mWorkers = new PoolWorker*[cWorkers - 1 > 0 ? cWorkers - 1 : 1];
+    if (mWorkers == NULL)
+        return FALSE;
+
+    mWorkerCount = 1;
+    for (int i = 0; i < cWorkers - 1; i++)
+    {
+        PoolWorker *worker = new PoolWorker(this, i + 1);
+        if (worker == NULL || !worker->StartThread())
+        {
+            // Run with the workers we already have.
+            delete worker;
+            break;
+        }
+
+        mWorkers[i] = worker;
+        mWorkerCount++;
+    }
+
+    return TRUE;
+}
+
+SOSTaskPool *SOSTaskPool::Get()
+{
+    if (s_pInstance == NULL && !s_createFailed)
+    {
+        SOSTaskPool *pool = new SOSTaskPool();
+        if (pool == NULL || !pool->Start())
+        {
+            delete pool;
+            s_createFailed = TRUE;
+            return NULL;
+        }
+
+        s_pInstance = pool;
+        OnUnloadTask::Register(Shutdown);
+    }
+
+    return s_pInstance;
+}
+
+void SOSTaskPool::Shutdown()
+{
+    delete s_pInstance;
+    s_pInstance = NULL;
+}
+
+/* Hands out the next index.  A worker drains its own range first; once that
+ * is dry it steals from whichever range has the most work remaining, so the
+ * pool finishes together even when the caller's partition is skewed.
+ */
+LONG SOSTaskPool::ClaimIndex(int rank)
+{
+    int victim = rank;
+    for (;;)
+    {
+        Range &range = mRanges[victim];
+        if (range.Next < range.End)
+        {
+            LONG index = InterlockedIncrement(&range.Next) - 1;
+            if (index < range.End)
+                return index;
+        }
+
+        // Pick the richest victim; claims that lose the race loop back here
+        // and pick again.
+        victim = -1;
+        LONG best = 0;
+        for (int i = 0; i < mWorkerCount; i++)
+        {
+            LONG remaining = mRanges[i].End - mRanges[i].Next;
+            if (remaining > best)
+            {
+                best = remaining;
+                victim = i;
+            }
+        }
+
+        if (victim == -1)
+            return -1;
+    }
+}
+
+void SOSTaskPool::RunWorker(int rank)
+{
+    size_t processed = 0;
+
+    for (;;)
+    {
+        if (mCancel)
+            break;
+
+        LONG index = ClaimIndex(rank);
+        if (index < 0)
+            break;
+
+        mProc(mState, rank, (size_t)index);
+
+        // Only the calling thread may touch the interrupt machinery.
+        if (rank == 0 && (++processed & 0x3FF) == 0)
+        {
+            EnterCriticalSection(&mReadLock);
+            BOOL fInterrupt = IsInterrupt();
+            LeaveCriticalSection(&mReadLock);
+
+            if (fInterrupt)
+            {
+                InterlockedExchange(&mCancel, 1);
+                break;
+            }
+        }
+    }
+}
+
+BOOL SOSTaskPool::ForEach(size_t count, TaskProc proc, void *state)
+{
+    if (count == 0)
+        return TRUE;
+
+    // The cursors are LONGs and the pool does not nest.
+    if (count > 0x7FFFFFFF || mActive)
+        return FALSE;
+
+    mActive = TRUE;
+    mProc = proc;
+    mState = state;
+    mCancel = 0;
+
+    for (int i = 0; i < mWorkerCount; i++)
+    {
+        mRanges[i].Next = (LONG)(count * i / mWorkerCount);
+        mRanges[i].End = (LONG)(count * (i + 1) / mWorkerCount);
+        mScratch[i].Arena.Reset();
+    }
+
+    for (int i = 0; i < mWorkerCount - 1; i++)
+        SetEvent(mWorkers[i]->StartEvent);
+
+    RunWorker(0);
+
+    // Wait for the pool to drain, polling for user interrupts so control-c
+    // still works while the last workers finish.
+    HANDLE handles[kMaxPoolWorkers];
+    int outstanding = mWorkerCount - 1;
+    for (int i = 0; i < outstanding; i++)
+        handles[i] = mWorkers[i]->DoneEvent;
+
+    while (outstanding > 0)
+    {
+        DWORD wait = WaitForMultipleObjects(outstanding, handles, TRUE, 100);
+        if (wait != WAIT_TIMEOUT)
+            break;
+
+        if (!mCancel)
+        {
+            EnterCriticalSection(&mReadLock);
+            BOOL fInterrupt = IsInterrupt();
+            LeaveCriticalSection(&mReadLock);
+
+            if (fInterrupt)
+                InterlockedExchange(&mCancel, 1);
+        }
+    }
+
+    mActive = FALSE;
+    return !mCancel;
+}
@@ -0,0 +1,229 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "sos.h"
+
+/* One process-wide worker pool shared by the parallel SOS features, so each
+ * command does not spawn and retire its own threads.  The pool is created
+ * lazily on first use, sized by processor count (capped by the
+ * SOS_MAX_WORKERS environment variable), and torn down by the extension
+ * unload tasks.  Work is distributed as index ranges with stealing: every
+ * worker consumes its own range through an atomic cursor and, once it runs
+ * dry, takes indexes from the range with the most work remaining, so skewed
+ * partitions still keep every core busy with no locking on the hot path.
+ */
+
+/* A small per-worker page cache in the spirit of LinearReadCache (util.h),
+ * except that page fills take the owning engine's read lock so it is safe to
+ * use from the pool.  Worker reads which fall outside the segment buffer
+ * (member references, card table words, mark array words, GCDesc entry
+ * counts) all come through here, so in steady state a worker only takes the
+ * lock on a cache miss.
+ */
+class HeapWalkReadCache
+{
+public:
+    HeapWalkReadCache()
+        : mLock(NULL), mData(NULL), mClock(0)
+    {
+    }
+
+    ~HeapWalkReadCache()
+    {
+        if (mData)
+            delete [] mData;
+    }
+
+    BOOL Init(CRITICAL_SECTION *lock)
+    {
+        mLock = lock;
+        mData = new BYTE[(size_t)kPageSize * kPageCount];
+        if (mData == NULL)
+            return FALSE;
+
+        for (int i = 0; i < kPageCount; i++)
+        {
+            mPages[i].Start = 0;
+            mPages[i].Size = 0;
+            mPages[i].LastUsed = 0;
+            mPages[i].Data = mData + (size_t)i * kPageSize;
+        }
+
+        return TRUE;
+    }
+
+    template <class T>
+    bool Read(TADDR addr, T *t)
+    {
+        TADDR base = addr & ~((TADDR)kPageSize - 1);
+        ULONG offset = (ULONG)(addr - base);
+
+        // Reads which straddle a page boundary go straight to the target.
+        if (offset + sizeof(T) > kPageSize)
+            return SerializedRead(addr, (BYTE*)t, sizeof(T)) == sizeof(T);
+
+        Page *page = Find(base);
+        if (page == NULL)
+        {
+            page = Fill(base);
+            if (page == NULL)
+                return false;
+        }
+
+        if (offset + sizeof(T) > page->Size)
+            return false;
+
+        page->LastUsed = ++mClock;
+        *t = *reinterpret_cast<T*>(page->Data + offset);
+        return true;
+    }
+
+private:
+    struct Page
+    {
+        TADDR Start;
+        ULONG Size;
+        ULONG64 LastUsed;
+        BYTE *Data;
+    };
+
+    static const ULONG kPageSize = 0x1000;
+    static const int kPageCount = 16;
+
+    ULONG SerializedRead(TADDR addr, BYTE *buffer, ULONG size)
+    {
+        ULONG fetched = 0;
+
+        EnterCriticalSection(mLock);
+        HRESULT hr = g_ExtData->ReadVirtual(TO_CDADDR(addr), buffer, size, &fetched);
+        LeaveCriticalSection(mLock);
+
+        if (FAILED(hr))
+            return 0;
+
+        return fetched;
+    }
+
+    Page *Find(TADDR base)
+    {
+        for (int i = 0; i < kPageCount; i++)
+            if (mPages[i].Start == base && mPages[i].Size != 0)
+                return &mPages[i];
+
+        return NULL;
+    }
+
+    Page *Fill(TADDR base)
+    {
+        // Evict the least recently used page.
+        Page *page = &mPages[0];
+        for (int i = 1; i < kPageCount; i++)
+            if (mPages[i].LastUsed < page->LastUsed)
+                page = &mPages[i];
+
+        page->Start = base;
+        page->Size = SerializedRead(base, page->Data, kPageSize);
+        page->LastUsed = ++mClock;
+
+        if (page->Size == 0)
+            return NULL;
+
+        return page;
+    }
+
+private:
+    CRITICAL_SECTION *mLock;
+    Page mPages[kPageCount];
+    BYTE *mData;
+    ULONG64 mClock;
+};
+
+struct PoolWorker;
+
+class SOSTaskPool
+{
+public:
+    typedef void (*TaskProc)(void *state, int rank, size_t index);
+
+    /* The pool instance, created on first use.  Returns NULL if the worker
+     * threads could not be created; callers fall back to their serial paths.
+     */
+    static SOSTaskPool *Get();
+
+    /* Retires the worker threads and frees the pool.  Registered as an
+     * unload task the first time the pool is created, so dbgeng unload and
+     * the PAL hosts both go through it; safe to call repeatedly.
+     */
+    static void Shutdown();
+
+    int WorkerCount() const { return mWorkerCount; }
+
+    /* Fork-join: runs proc(state, rank, index) once for every index in
+     * [0, count), distributing the indexes across the pool.  The calling
+     * thread participates as rank 0 and is the only rank that polls
+     * IsInterrupt(); on interrupt the remaining indexes are abandoned and
+     * FALSE is returned, matching the engines' serial cancellation.
+     * Returns FALSE without running anything if count does not fit the
+     * cursors or a ForEach is already active (the pool does not nest);
+     * callers fall back to their serial walks.
+     */
+    BOOL ForEach(size_t count, TaskProc proc, void *state);
+
+    /* Serializes debugger and DAC access issued from workers; the data
+     * interfaces are single threaded.
+     */
+    CRITICAL_SECTION *ReadLock() { return &mReadLock; }
+
+    /* Per-worker scratch: a read cache whose misses take the pool's read
+     * lock, and an arena for temporaries the main thread consumes after the
+     * join.  The arenas are rewound at the start of every ForEach.
+     */
+    struct Scratch
+    {
+        HeapWalkReadCache Cache;
+        CommandArena Arena;
+    };
+
+    Scratch *GetScratch(int rank) { return &mScratch[rank]; }
+
+private:
+    friend struct PoolWorker;
+
+    // One worker's slice of the index space.  Next is bumped past End by
+    // claims that lose the race, so remaining work is End - Next clamped
+    // at zero.
+    struct Range
+    {
+        volatile LONG Next;
+        LONG End;
+    };
+
+    SOSTaskPool();
+    ~SOSTaskPool();
+
+    BOOL Start();
+    void RunWorker(int rank);
+    LONG ClaimIndex(int rank);
+
+    static DWORD WINAPI WorkerThreadProc(LPVOID param);
+
+private:
+    int mWorkerCount;           // ranks, including the calling thread
+    PoolWorker **mWorkers;      // mWorkerCount - 1 worker threads
+    Scratch *mScratch;          // one per rank
+    Range *mRanges;             // one per rank, rebuilt by each ForEach
+
+    TaskProc mProc;
+    void *mState;
+
+    CRITICAL_SECTION mReadLock;
+    volatile LONG mCancel;      // set to abandon the remaining indexes
+    volatile LONG mShutdown;    // set to retire the worker threads
+    BOOL mActive;               // a ForEach is running; set on rank 0 only
+
+    static SOSTaskPool *s_pInstance;
+    static BOOL s_createFailed; // do not retry creation every command
+};
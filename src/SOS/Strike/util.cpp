@@ -17,6 +17,7 @@
 #include "sospriv.h"
 #include "corerror.h"
 #include "safemath.h"
+#include "scankernels.h"
 
 #include <psapi.h>
 #include <cordebug.h>
@@ -1173,70 +1174,177 @@ LPWSTR FormatTypeName (__out_ecount (maxChars) LPWSTR pszName, UINT maxChars)
     return pszName + iStart;
 }
 
+// Session cache of flattened field layouts, keyed by MethodTable.  Scripts
+// routinely dump thousands of instances of the same few types, and the
+// metadata walk behind each dump (the FieldDesc chain plus a name and type
+// lookup per field) dominates once the object itself is a single block
+// read.  A layout is immutable for the lifetime of its type, so for dumps
+// the cache lives for the session; for live targets it is dropped on
+// command entry with the other metadata caches.
+static std::unordered_map<CLRDATA_ADDRESS, CachedFieldLayout*> g_fieldLayoutCache;
+
+void ClearFieldLayoutCache()
+{
+    std::unordered_map<CLRDATA_ADDRESS, CachedFieldLayout*>::iterator itr;
+    for (itr = g_fieldLayoutCache.begin(); itr != g_fieldLayoutCache.end(); ++itr)
+        delete itr->second;
+
+    g_fieldLayoutCache.clear();
+}
+
+// Performs the metadata walk DisplayFields used to repeat per object:
+// parents first, then this type's own FieldDesc chain, recording each
+// field's desc and its interned name and type-column text.
+// numInstanceFields counts across the recursion because the DAC reports
+// cumulative instance field counts.
+static BOOL BuildFieldLayout(CLRDATA_ADDRESS cdaMT, CachedFieldLayout *layout, DWORD &numInstanceFields)
+{
+    DacpMethodTableData vMethTable;
+    if (vMethTable.Request(g_sos, cdaMT) != S_OK)
+        return FALSE;
+
+    if (vMethTable.ParentMethodTable)
+    {
+        if (!BuildFieldLayout(vMethTable.ParentMethodTable, layout, numInstanceFields))
+            return FALSE;
+    }
+
+    DacpMethodTableFieldData vMethTableFields;
+    if (vMethTableFields.Request(g_sos, cdaMT) != S_OK)
+        return FALSE;
+
+    DacpModuleData module;
+    if (module.Request(g_sos, vMethTable.Module) != S_OK)
+        return FALSE;
+
+    ToRelease<IMetaDataImport> pImport = MDImportForModule(&module);
+
+    layout->Owners.push_back(vMethTable);
+    int ownerIndex = (int)layout->Owners.size() - 1;
+
+    DWORD numStaticFields = 0;
+    CLRDATA_ADDRESS dwAddr = vMethTableFields.FirstField;
+    DacpFieldDescData vFieldDesc;
+
+    while (numInstanceFields < vMethTableFields.wNumInstanceFields
+           || numStaticFields < vMethTableFields.wNumStaticFields)
+    {
+        if (IsInterrupt())
+            return FALSE;
+
+        if ((vFieldDesc.Request(g_sos, dwAddr) != S_OK) ||
+            (vFieldDesc.Type >= ELEMENT_TYPE_MAX))
+        {
+            return FALSE;
+        }
+        dwAddr = vFieldDesc.NextField;
+
+        CachedFieldInfo info;
+        info.Desc = vFieldDesc;
+        info.OwnerIndex = ownerIndex;
+
+        if ((vFieldDesc.Type == ELEMENT_TYPE_VALUETYPE ||
+            vFieldDesc.Type == ELEMENT_TYPE_CLASS) && vFieldDesc.MTOfType)
+        {
+            NameForMT_s((DWORD_PTR)vFieldDesc.MTOfType, g_mdName, mdNameLen);
+            info.TypeName = InternString(g_mdName);
+        }
+        else if (vFieldDesc.Type == ELEMENT_TYPE_CLASS && vFieldDesc.TokenOfType != mdTypeDefNil)
+        {
+            // Get the name from Metadata!!!
+            NameForToken_s(TokenFromRid(vFieldDesc.TokenOfType, mdtTypeDef), pImport, g_mdName, mdNameLen, false);
+            info.TypeName = InternString(g_mdName);
+        }
+        else
+        {
+            // If ET type from signature is different from fielddesc, then the signature one is more descriptive.
+            // For example, E_T_STRING in field desc will be E_T_CLASS. In minidump's case, we won't have
+            // the method table for it.
+            char ElementName[mdNameLen];
+            ComposeName_s(vFieldDesc.Type != vFieldDesc.sigType ? vFieldDesc.sigType : vFieldDesc.Type, ElementName, sizeof(ElementName)/sizeof(ElementName[0]));
+
+            WCHAR wide[mdNameLen];
+            int cch = 0;
+            for (; ElementName[cch] != '\0' && cch < mdNameLen - 1; cch++)
+                wide[cch] = (WCHAR)ElementName[cch];
+            wide[cch] = W('\0');
+            info.TypeName = InternString(wide);
+        }
+
+        NameForToken_s(TokenFromRid(vFieldDesc.mb, mdtFieldDef), pImport, g_mdName, mdNameLen, false);
+        info.Name = InternString(g_mdName);
+
+        if (info.Name == NULL || info.TypeName == NULL)
+            return FALSE;
+
+        if (vFieldDesc.bIsStatic)
+            numStaticFields++;
+        else
+            numInstanceFields++;
+
+        layout->Fields.push_back(info);
+    }
+
+    return TRUE;
+}
+
+const CachedFieldLayout *GetFieldLayout(CLRDATA_ADDRESS cdaMT)
+{
+    std::unordered_map<CLRDATA_ADDRESS, CachedFieldLayout*>::iterator itr =
+        g_fieldLayoutCache.find(cdaMT);
+    if (itr != g_fieldLayoutCache.end())
+        return itr->second;
+
+    CachedFieldLayout *layout = new CachedFieldLayout();
+    DWORD numInstanceFields = 0;
+    if (layout == NULL || !BuildFieldLayout(cdaMT, layout, numInstanceFields))
+    {
+        // Failures (a detached type, an interrupted walk) are not cached:
+        // the next request retries, as the uncached walk always did.
+        delete layout;
+        return NULL;
+    }
+
+    g_fieldLayoutCache[cdaMT] = layout;
+    return layout;
+}
+
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
-*    This function is called to dump all fields of a managed object.   *  
+*    This function is called to dump all fields of a managed object.   *
 *    dwStartAddr specifies the beginning memory address.               *
 *    bFirst is used to avoid printing header every time.               *
 *                                                                      *
 \**********************************************************************/
 void DisplayFields(CLRDATA_ADDRESS cdaMT, DacpMethodTableData *pMTD, DacpMethodTableFieldData *pMTFD, DWORD_PTR dwStartAddr, BOOL bFirst, BOOL bValueClass)
 {
-    static DWORD numInstanceFields = 0;
     if (bFirst)
     {
         ExtOutIndent();
-        ExtOut("%" POINTERSIZE "s %8s %8s %20s %2s %8s %" POINTERSIZE "s %s\n", 
+        ExtOut("%" POINTERSIZE "s %8s %8s %20s %2s %8s %" POINTERSIZE "s %s\n",
             "MT", "Field", "Offset", "Type", "VT", "Attr", "Value", "Name");
-        numInstanceFields = 0;
     }
-    
-    if (pMTD->ParentMethodTable)
-    {
-        DacpMethodTableData vParentMethTable;
-        if (vParentMethTable.Request(g_sos,pMTD->ParentMethodTable) != S_OK)
-        {
-            ExtOut("Invalid parent MethodTable\n");
-            return;
-        }            
-
-        DacpMethodTableFieldData vParentMethTableFields;
-        if (vParentMethTableFields.Request(g_sos,pMTD->ParentMethodTable) != S_OK)
-        {
-            ExtOut("Invalid parent EEClass\n");
-            return;
-        }            
 
-        DisplayFields(pMTD->ParentMethodTable, &vParentMethTable, &vParentMethTableFields, dwStartAddr, FALSE, bValueClass);
+    // The cached layout already covers the parent chain, so the recursion
+    // the pMTD/pMTFD parameters served is gone; they stay for the callers.
+    const CachedFieldLayout *layout = GetFieldLayout(cdaMT);
+    if (layout == NULL)
+    {
+        ExtOut("Unable to display fields\n");
+        return;
     }
 
-    DWORD numStaticFields = 0;
-    CLRDATA_ADDRESS dwAddr = pMTFD->FirstField;
-    DacpFieldDescData vFieldDesc;
-
-    // Get the module name
-    DacpModuleData module;
-    if (module.Request(g_sos, pMTD->Module)!=S_OK)
-        return;    
-
-    ToRelease<IMetaDataImport> pImport = MDImportForModule(&module);
-    
-    while (numInstanceFields < pMTFD->wNumInstanceFields
-           || numStaticFields < pMTFD->wNumStaticFields)
+    for (size_t iField = 0; iField < layout->Fields.size(); iField++)
     {
         if (IsInterrupt())
             return;
 
         ExtOutIndent ();
-        
-        if ((vFieldDesc.Request(g_sos, dwAddr)!=S_OK) ||
-            (vFieldDesc.Type >= ELEMENT_TYPE_MAX))
-        {
-            ExtOut("Unable to display fields\n");
-            return;
-        }
-        dwAddr = vFieldDesc.NextField;
+
+        // Copies, because the display helpers take writable pointers.
+        DacpFieldDescData vFieldDesc = layout->Fields[iField].Desc;
+        DacpMethodTableData vOwner = layout->Owners[layout->Fields[iField].OwnerIndex];
 
         DWORD offset = vFieldDesc.dwOffset;
         if(!(vFieldDesc.bIsThreadLocal && vFieldDesc.bIsStatic))
@@ -1251,40 +1359,16 @@ void DisplayFields(CLRDATA_ADDRESS cdaMT, DacpMethodTableData *pMTD, DacpMethodT
                  TokenFromRid(vFieldDesc.mb, mdtFieldDef),
                  offset);
 
-        char ElementName[mdNameLen];
-        if ((vFieldDesc.Type == ELEMENT_TYPE_VALUETYPE || 
-            vFieldDesc.Type == ELEMENT_TYPE_CLASS) && vFieldDesc.MTOfType)
-        {
-            NameForMT_s((DWORD_PTR)vFieldDesc.MTOfType, g_mdName, mdNameLen);            
-            ExtOut("%20.20S ", FormatTypeName(g_mdName, 20));            
-        }
-        else 
-        {       
-            if (vFieldDesc.Type == ELEMENT_TYPE_CLASS && vFieldDesc.TokenOfType != mdTypeDefNil)
-            {
-                // Get the name from Metadata!!!
-                NameForToken_s(TokenFromRid(vFieldDesc.TokenOfType, mdtTypeDef), pImport, g_mdName, mdNameLen, false);
-                ExtOut("%20.20S ", FormatTypeName(g_mdName, 20));
-            }
-            else
-            {
-                // If ET type from signature is different from fielddesc, then the signature one is more descriptive. 
-                // For example, E_T_STRING in field desc will be E_T_CLASS. In minidump's case, we won't have
-                // the method table for it.
-                ComposeName_s(vFieldDesc.Type != vFieldDesc.sigType ? vFieldDesc.sigType : vFieldDesc.Type, ElementName, sizeof(ElementName)/sizeof(ElementName[0]));
-                ExtOut("%20.20s ", ElementName); 
-            }
-        }
-        
+        // FormatTypeName rewrites its buffer, so stage the pooled name.
+        wcscpy_s(g_mdName, mdNameLen, layout->Fields[iField].TypeName);
+        ExtOut("%20.20S ", FormatTypeName(g_mdName, 20));
+
         ExtOut("%2s ", (IsElementValueType(vFieldDesc.Type)) ? "1" : "0");
 
         if (vFieldDesc.bIsStatic && vFieldDesc.bIsThreadLocal)
         {
-            numStaticFields ++;
             ExtOut("%8s ", vFieldDesc.bIsThreadLocal ? "TLstatic" : "CLstatic");
-
-            NameForToken_s(TokenFromRid(vFieldDesc.mb, mdtFieldDef), pImport, g_mdName, mdNameLen, false);
-            ExtOut(" %S\n", g_mdName);
+            ExtOut(" %S\n", layout->Fields[iField].Name);
 
             if (IsMiniDumpFile())
             {
@@ -1295,42 +1379,37 @@ void DisplayFields(CLRDATA_ADDRESS cdaMT, DacpMethodTableData *pMTD, DacpMethodT
                 if (vFieldDesc.bIsThreadLocal)
                 {
                     DacpModuleData vModule;
-                    if (vModule.Request(g_sos,pMTD->Module) == S_OK)
+                    if (vModule.Request(g_sos, vOwner.Module) == S_OK)
                     {
-                        DisplayThreadStatic(&vModule, pMTD, &vFieldDesc);
+                        DisplayThreadStatic(&vModule, &vOwner, &vFieldDesc);
                     }
                 }
             }
-    
+
         }
         else if (vFieldDesc.bIsStatic)
         {
-            numStaticFields ++;
-
             ExtOut("%8s ", "static");
 
             DacpDomainLocalModuleData vDomainLocalModule;
 
             // The MethodTable isn't shared, so the module must not be loaded domain neutral.  We can
             // get the specific DomainLocalModule instance without needing to know the AppDomain in advance.
-            if (g_sos->GetDomainLocalModuleDataFromModule(pMTD->Module, &vDomainLocalModule) != S_OK)
+            if (g_sos->GetDomainLocalModuleDataFromModule(vOwner.Module, &vDomainLocalModule) != S_OK)
             {
                 ExtOut(" <no information>\n");
             }
             else
             {
                 DWORD_PTR dwTmp;
-                GetStaticFieldPTR(&dwTmp, &vDomainLocalModule, pMTD, &vFieldDesc);
+                GetStaticFieldPTR(&dwTmp, &vDomainLocalModule, &vOwner, &vFieldDesc);
                 DisplayDataMember(&vFieldDesc, dwTmp);
 
-                NameForToken_s(TokenFromRid(vFieldDesc.mb, mdtFieldDef), pImport, g_mdName, mdNameLen, false);
-                ExtOut(" %S\n", g_mdName);
+                ExtOut(" %S\n", layout->Fields[iField].Name);
             }
         }
         else
         {
-            numInstanceFields ++;
-
             ExtOut("%8s ", "instance");
 
             if (dwStartAddr > 0)
@@ -1343,13 +1422,11 @@ void DisplayFields(CLRDATA_ADDRESS cdaMT, DacpMethodTableData *pMTD, DacpMethodT
                 ExtOut(" %8s", " ");
             }
 
-
-            NameForToken_s(TokenFromRid(vFieldDesc.mb, mdtFieldDef), pImport, g_mdName, mdNameLen, false);
-            ExtOut(" %S\n", g_mdName);
+            ExtOut(" %S\n", layout->Fields[iField].Name);
         }
-        
+
     }
-    
+
     return;
 }
 
@@ -1371,68 +1448,35 @@ int GetObjFieldOffset(CLRDATA_ADDRESS cdaObj, __in_z LPCWSTR wszFieldName, BOOL
 int GetObjFieldOffset(CLRDATA_ADDRESS cdaObj, CLRDATA_ADDRESS cdaMT, __in_z LPCWSTR wszFieldName,
                         BOOL bFirst/*=TRUE*/, DacpFieldDescData* pDacpFieldDescData/*=NULL*/)
 {
-
-#define EXITPOINT(EXPR) do { if(!(EXPR)) { return -1; } } while (0)
-    
     DacpObjectData objData;
-    DacpMethodTableData dmtd;
-    DacpMethodTableFieldData vMethodTableFields;
-    DacpFieldDescData vFieldDesc;
-    DacpModuleData module;
-    static DWORD numInstanceFields = 0; // Static due to recursion visiting parents
+    if (objData.Request(g_sos, cdaObj) != S_OK)
+        return -1;
 
-    if (bFirst)
-    {
-        numInstanceFields = 0;
-    }
-    
-    EXITPOINT(objData.Request(g_sos, cdaObj) == S_OK);    
-    EXITPOINT(dmtd.Request(g_sos, cdaMT) == S_OK);
+    // The cached layout lists the parent chain's fields first, so a name
+    // search finds the same (shadowed) field the old parent-first
+    // recursion did.  bFirst served that recursion and is no longer read.
+    const CachedFieldLayout *layout = GetFieldLayout(cdaMT);
+    if (layout == NULL)
+        return -1;
 
-    if (dmtd.ParentMethodTable)
+    for (size_t iField = 0; iField < layout->Fields.size(); iField++)
     {
-        DWORD retVal = GetObjFieldOffset (cdaObj, dmtd.ParentMethodTable, 
-                                          wszFieldName, FALSE, pDacpFieldDescData);
-        if (retVal != 0)
-        {
-            // return in case of error or success.
-            // Fall through for field-not-found.
-            return retVal;
-        }
-    }
-    
-    EXITPOINT (vMethodTableFields.Request(g_sos,cdaMT) == S_OK);
-    EXITPOINT (module.Request(g_sos,dmtd.Module) == S_OK);
-        
-    CLRDATA_ADDRESS dwAddr = vMethodTableFields.FirstField;            
-    ToRelease<IMetaDataImport> pImport = MDImportForModule(&module);
-        
-    while (numInstanceFields < vMethodTableFields.wNumInstanceFields)
-    {        
-        EXITPOINT (vFieldDesc.Request(g_sos, dwAddr) == S_OK);
+        const DacpFieldDescData &vFieldDesc = layout->Fields[iField].Desc;
+        if (vFieldDesc.bIsStatic)
+            continue;
 
-        if (!vFieldDesc.bIsStatic)
+        if (_wcscmp(wszFieldName, layout->Fields[iField].Name) == 0)
         {
-            DWORD offset = vFieldDesc.dwOffset + sizeof(BaseObject);          
-            NameForToken_s (TokenFromRid(vFieldDesc.mb, mdtFieldDef), pImport, g_mdName, mdNameLen, false);
-            if (_wcscmp (wszFieldName, g_mdName) == 0)
+            if (pDacpFieldDescData != NULL)
             {
-                if (pDacpFieldDescData != NULL)
-                {
-                    *pDacpFieldDescData = vFieldDesc;
-                }
-                return offset;
+                *pDacpFieldDescData = vFieldDesc;
             }
-            numInstanceFields ++;                        
+            return vFieldDesc.dwOffset + sizeof(BaseObject);
         }
-
-        dwAddr = vFieldDesc.NextField;        
     }
 
     // Field name not found...
     return 0;
-
-#undef EXITPOINT    
 }
 
 
@@ -1441,188 +1485,385 @@ int GetObjFieldOffset(CLRDATA_ADDRESS cdaObj, CLRDATA_ADDRESS cdaMT, __in_z LPCW
 //             >= 0 = offset to field from cdaValue
 int GetValueFieldOffset(CLRDATA_ADDRESS cdaMT, __in_z LPCWSTR wszFieldName, DacpFieldDescData* pDacpFieldDescData)
 {
-#define EXITPOINT(EXPR) do { if(!(EXPR)) { return -1; } } while (0)
-
     const int NOT_FOUND = -2;
-    DacpMethodTableData dmtd;
-    DacpMethodTableFieldData vMethodTableFields;
-    DacpFieldDescData vFieldDesc;
-    DacpModuleData module;
-    static DWORD numInstanceFields = 0; // Static due to recursion visiting parents
-    numInstanceFields = 0;
-
-    EXITPOINT(vMethodTableFields.Request(g_sos, cdaMT) == S_OK);
-
-    EXITPOINT(dmtd.Request(g_sos, cdaMT) == S_OK);
-    EXITPOINT(module.Request(g_sos, dmtd.Module) == S_OK);
-    if (dmtd.ParentMethodTable)
-    {
-        DWORD retVal = GetValueFieldOffset(dmtd.ParentMethodTable, wszFieldName, pDacpFieldDescData);
-        if (retVal != (DWORD)NOT_FOUND)
-        {
-            // Return in case of error or success. Fall through for field-not-found.
-            return retVal;
-        }
-    }
 
-    CLRDATA_ADDRESS dwAddr = vMethodTableFields.FirstField;
-    ToRelease<IMetaDataImport> pImport = MDImportForModule(&module);
+    const CachedFieldLayout *layout = GetFieldLayout(cdaMT);
+    if (layout == NULL)
+        return -1;
 
-    while (numInstanceFields < vMethodTableFields.wNumInstanceFields)
+    for (size_t iField = 0; iField < layout->Fields.size(); iField++)
     {
-        EXITPOINT(vFieldDesc.Request(g_sos, dwAddr) == S_OK);
+        const DacpFieldDescData &vFieldDesc = layout->Fields[iField].Desc;
+        if (vFieldDesc.bIsStatic)
+            continue;
 
-        if (!vFieldDesc.bIsStatic)
+        if (_wcscmp(wszFieldName, layout->Fields[iField].Name) == 0)
         {
-            NameForToken_s(TokenFromRid(vFieldDesc.mb, mdtFieldDef), pImport, g_mdName, mdNameLen, false);
-            if (_wcscmp(wszFieldName, g_mdName) == 0)
+            if (pDacpFieldDescData != NULL)
             {
-                if (pDacpFieldDescData != NULL)
-                {
-                    *pDacpFieldDescData = vFieldDesc;
-                }
-                return vFieldDesc.dwOffset;
+                *pDacpFieldDescData = vFieldDesc;
             }
-            numInstanceFields++;
+            return vFieldDesc.dwOffset;
         }
-
-        dwAddr = vFieldDesc.NextField;
     }
 
     // Field name not found...
     return NOT_FOUND;
+}
+
+// Session cache of the appdomain -> assembly -> module tree.  The module
+// lookups behind !name2ee and !bpmd and the appdomain heuristics behind
+// !findappdomain used to re-enumerate every domain, assembly and module
+// through the DAC on each query; with hundreds of assemblies every lookup
+// repaid the full walk.  One walk now records each module with its file
+// name, PEFile and owning assembly and domain, and the lookups filter the
+// cached tree instead.  ResetGlobals drops the tree on command entry for
+// live targets and the dbgeng event callbacks drop it on module events and
+// on resume, so it cannot go stale.
+struct DomainModuleNode
+{
+    DWORD_PTR Module;          // module address
+    CLRDATA_ADDRESS PEFile;    // for debugger-side module name matching
+    CLRDATA_ADDRESS Assembly;  // owning assembly
+    CLRDATA_ADDRESS Domain;    // domain the assembly was enumerated under
+    std::string FileName;      // narrowed module file name
+};
 
-#undef EXITPOINT    
+static std::vector<DomainModuleNode> g_domainModuleTree;
+
+// Assembly -> the regular (non-system, non-shared) domains it is loaded
+// into, for the one-domain-only heuristic below.
+static std::unordered_map<CLRDATA_ADDRESS, std::vector<CLRDATA_ADDRESS> > g_assemblyDomains;
+static bool g_domainModuleTreeBuilt = false;
+
+// Memoized methodtable -> owning assembly/parent domain chain and the
+// appdomain store, behind GetAppDomain and GetAppDomainForMT.  Resolving
+// the appdomain of many objects (scripted !findappdomain, or its -all
+// batch mode) repaid four DAC requests per object for types it had
+// already resolved.
+struct MTDomainInfo
+{
+    CLRDATA_ADDRESS Assembly;
+    CLRDATA_ADDRESS ParentDomain;
+};
+
+static std::unordered_map<TADDR, MTDomainInfo> g_mtDomainMap;
+static DacpAppDomainStoreData g_cachedAppDomainStore;
+static bool g_appDomainStoreCached = false;
+
+// Appdomain id -> appdomain address, for the object-header adIndex path.
+static std::unordered_map<DWORD, CLRDATA_ADDRESS> g_domainIdMap;
+static bool g_domainIdMapBuilt = false;
+
+void ClearDomainModuleTree()
+{
+    g_domainModuleTree.clear();
+    g_assemblyDomains.clear();
+    g_domainModuleTreeBuilt = false;
+    g_mtDomainMap.clear();
+    g_appDomainStoreCached = false;
+    g_domainIdMap.clear();
+    g_domainIdMapBuilt = false;
 }
 
-// Returns an AppDomain address if AssemblyPtr is loaded into that domain only. Otherwise
-// returns NULL
-CLRDATA_ADDRESS IsInOneDomainOnly(CLRDATA_ADDRESS AssemblyPtr)
+static bool BuildDomainModuleTree()
 {
-    CLRDATA_ADDRESS appDomain = NULL;
+    if (g_domainModuleTreeBuilt)
+        return true;
 
-    DacpAppDomainStoreData adstore;
-    if (adstore.Request(g_sos) != S_OK)
-    {
-        ExtOut("Unable to get appdomain store\n");
-        return NULL;
-    }    
+    DacpAppDomainStoreData adsData;
+    if (adsData.Request(g_sos) != S_OK)
+        return false;
 
-    size_t AllocSize;
-    if (!ClrSafeInt<size_t>::multiply(sizeof(CLRDATA_ADDRESS), adstore.DomainCount, AllocSize))
+    int numSpecialDomains = (adsData.sharedDomain != NULL) ? 2 : 1;
+    int arrayLength = 0;
+    if (!ClrSafeInt<int>::addition(adsData.DomainCount, numSpecialDomains, arrayLength))
     {
-        ReportOOM();        
-        return NULL;
+        ExtOut("<integer overflow>\n");
+        return false;
     }
 
-    ArrayHolder<CLRDATA_ADDRESS> pArray = new CLRDATA_ADDRESS[adstore.DomainCount];
+    ArrayHolder<CLRDATA_ADDRESS> pArray = new CLRDATA_ADDRESS[arrayLength];
     if (pArray==NULL)
     {
-        ReportOOM();        
-        return NULL;
+        ReportOOM();
+        return false;
     }
-    
-    if (g_sos->GetAppDomainList(adstore.DomainCount, pArray, NULL)!=S_OK)
+
+    pArray[0] = adsData.systemDomain;
+    if (adsData.sharedDomain != NULL)
     {
-        ExtOut ("Failed to get appdomain list\n");
-        return NULL;
+        pArray[1] = adsData.sharedDomain;
     }
+    if (g_sos->GetAppDomainList(adsData.DomainCount, pArray.GetPtr()+numSpecialDomains, NULL)!=S_OK)
+    {
+        ExtOut("Unable to get array of AppDomains\n");
+        return false;
+    }
+
+    WCHAR StringData[MAX_LONGPATH];
+    char fileName[sizeof(StringData)/2];
 
-    for (int i = 0; i < adstore.DomainCount; i++)
+    for (int n = 0; n < adsData.DomainCount+numSpecialDomains; n++)
     {
         if (IsInterrupt())
-            return NULL;
+        {
+            // A partial tree would make lookups miss loaded modules.
+            ExtOut("<interrupted>\n");
+            ClearDomainModuleTree();
+            return false;
+        }
 
-        DacpAppDomainData dadd;
-        if (dadd.Request(g_sos, pArray[i]) != S_OK)
+        DacpAppDomainData appDomain;
+        if (FAILED(appDomain.Request(g_sos,pArray[n])))
         {
-            ExtOut ("Unable to get AppDomain %p\n", SOS_PTR(pArray[i]));
-            return NULL;
+            // Don't print a failure message here, there is a very normal case when checking
+            // for modules after clr is loaded but before any AppDomains or assemblies are created
+            // for example:
+            // >sxe ld:clr
+            // >g
+            // ...
+            // ModLoad: coreclr.dll
+            // >!bpmd Foo.dll Foo.Bar
+
+            // we will correctly give the answer that whatever module you were looking for, it isn't loaded yet
+            ClearDomainModuleTree();
+            return false;
         }
 
-        if (dadd.AssemblyCount)
+        if (appDomain.AssemblyCount)
         {
-            size_t AssemblyAllocSize;
-            if (!ClrSafeInt<size_t>::multiply(sizeof(CLRDATA_ADDRESS), dadd.AssemblyCount, AssemblyAllocSize))
+            ArrayHolder<CLRDATA_ADDRESS> pAssemblyArray = new CLRDATA_ADDRESS[appDomain.AssemblyCount];
+            if (pAssemblyArray==NULL)
             {
-                ReportOOM();                        
-                return NULL;
+                ReportOOM();
+                ClearDomainModuleTree();
+                return false;
             }
 
-            ArrayHolder<CLRDATA_ADDRESS> pAsmArray = new CLRDATA_ADDRESS[dadd.AssemblyCount];
-            if (pAsmArray==NULL)
-            {
-                ReportOOM();                        
-                return NULL;
-            }
-    
-            if (g_sos->GetAssemblyList(dadd.AppDomainPtr,dadd.AssemblyCount,pAsmArray, NULL)!=S_OK)
+            if (FAILED(g_sos->GetAssemblyList(appDomain.AppDomainPtr, appDomain.AssemblyCount, pAssemblyArray, NULL)))
             {
-                ExtOut("Unable to get array of Assemblies\n");
-                return NULL;  
+                ExtOut("Unable to get array of Assemblies for the given AppDomain..\n");
+                ClearDomainModuleTree();
+                return false;
             }
-      
-            for (LONG n = 0; n < dadd.AssemblyCount; n ++)
+
+            for (int nAssem = 0; nAssem < appDomain.AssemblyCount; nAssem ++)
             {
                 if (IsInterrupt())
-                    return NULL;
+                {
+                    ExtOut("<interrupted>\n");
+                    ClearDomainModuleTree();
+                    return false;
+                }
+
+                if (n >= numSpecialDomains)
+                {
+                    g_assemblyDomains[pAssemblyArray[nAssem]].push_back(pArray[n]);
+                }
+
+                DacpAssemblyData assemblyData;
+                if (FAILED(assemblyData.Request(g_sos, pAssemblyArray[nAssem])))
+                {
+                    ExtOut("Failed to request assembly.\n");
+                    ClearDomainModuleTree();
+                    return false;
+                }
 
-                if (AssemblyPtr == pAsmArray[n])
+                ArrayHolder<CLRDATA_ADDRESS> pModules = new CLRDATA_ADDRESS[assemblyData.ModuleCount];
+                if (FAILED(g_sos->GetAssemblyModuleList(assemblyData.AssemblyPtr, assemblyData.ModuleCount, pModules, NULL)))
                 {
-                    if (appDomain != NULL)
+                    ExtOut("Failed to get the modules for the given assembly.\n");
+                    ClearDomainModuleTree();
+                    return false;
+                }
+
+                for (UINT nModule = 0; nModule < assemblyData.ModuleCount; nModule++)
+                {
+                    if (IsInterrupt())
+                    {
+                        ExtOut("<interrupted>\n");
+                        ClearDomainModuleTree();
+                        return false;
+                    }
+
+                    CLRDATA_ADDRESS ModuleAddr = pModules[nModule];
+                    DacpModuleData ModuleData;
+                    if (FAILED(ModuleData.Request(g_sos,ModuleAddr)))
                     {
-                        // We have found more than one AppDomain that loaded this
-                        // assembly, we must return NULL.
-                        return NULL;
+                        ExtOut("Failed to request Module data from assembly.\n");
+                        ClearDomainModuleTree();
+                        return false;
                     }
-                    appDomain = dadd.AppDomainPtr;
-                }                
-            }    
+
+                    FileNameForModule ((DWORD_PTR)ModuleAddr, StringData);
+                    int m;
+                    for (m = 0; StringData[m] != L'\0'; m++)
+                    {
+                        fileName[m] = (char)StringData[m];
+                    }
+                    fileName[m] = '\0';
+
+                    DomainModuleNode node;
+                    node.Module = (DWORD_PTR)ModuleAddr;
+                    node.PEFile = ModuleData.File;
+                    node.Assembly = pAssemblyArray[nAssem];
+                    node.Domain = pArray[n];
+                    node.FileName = fileName;
+                    g_domainModuleTree.push_back(node);
+                }
+            }
         }
-    } 
+    }
+
+    g_domainModuleTreeBuilt = true;
+    return true;
+}
+
+// Returns an AppDomain address if AssemblyPtr is loaded into that domain only. Otherwise
+// returns NULL
+CLRDATA_ADDRESS IsInOneDomainOnly(CLRDATA_ADDRESS AssemblyPtr)
+{
+    CLRDATA_ADDRESS appDomain = NULL;
+
+    if (!BuildDomainModuleTree())
+        return NULL;
+
+    std::unordered_map<CLRDATA_ADDRESS, std::vector<CLRDATA_ADDRESS> >::const_iterator itr = g_assemblyDomains.find(AssemblyPtr);
+    if (itr != g_assemblyDomains.end())
+    {
+        if (itr->second.size() > 1)
+        {
+            // We have found more than one AppDomain that loaded this
+            // assembly, we must return NULL.
+            return NULL;
+        }
+        appDomain = itr->second[0];
+    }
+
+    return appDomain;
+}
+
+// Resolves (and memoizes) the methodtable -> module -> assembly chain.
+static HRESULT GetMTDomainInfo(CLRDATA_ADDRESS mtPtr, MTDomainInfo *pInfo)
+{
+    std::unordered_map<TADDR, MTDomainInfo>::const_iterator itr = g_mtDomainMap.find(TO_TADDR(mtPtr));
+    if (itr != g_mtDomainMap.end())
+    {
+        *pInfo = itr->second;
+        return S_OK;
+    }
+
+    DacpMethodTableData mt;
+    if (mt.Request(g_sos, mtPtr) != S_OK)
+    {
+        return E_FAIL;
+    }
+
+    DacpModuleData module;
+    if (module.Request(g_sos, mt.Module) != S_OK)
+    {
+        return E_FAIL;
+    }
+
+    DacpAssemblyData assembly;
+    if (assembly.Request(g_sos, module.Assembly) != S_OK)
+    {
+        return E_FAIL;
+    }
+
+    pInfo->Assembly = assembly.AssemblyPtr;
+    pInfo->ParentDomain = assembly.ParentDomain;
+    g_mtDomainMap[TO_TADDR(mtPtr)] = *pInfo;
+    return S_OK;
+}
+
+static HRESULT GetAppDomainStore(DacpAppDomainStoreData *pAdstore)
+{
+    if (!g_appDomainStoreCached)
+    {
+        if (g_cachedAppDomainStore.Request(g_sos) != S_OK)
+        {
+            return E_FAIL;
+        }
+        g_appDomainStoreCached = true;
+    }
+    *pAdstore = g_cachedAppDomainStore;
+    return S_OK;
+}
+
+// Builds (once per session) the appdomain id -> address map consulted by
+// the object-header adIndex path in GetAppDomain.
+static HRESULT GetAppDomainById(DWORD adIndex, CLRDATA_ADDRESS *pAppDomain)
+{
+    if (!g_domainIdMapBuilt)
+    {
+        DacpAppDomainStoreData adstore;
+        if (GetAppDomainStore(&adstore) != S_OK)
+        {
+            return E_FAIL;
+        }
+
+        size_t AllocSize;
+        if (!ClrSafeInt<size_t>::multiply(sizeof(CLRDATA_ADDRESS), adstore.DomainCount, AllocSize))
+        {
+            return E_FAIL;
+        }
+        ArrayHolder<CLRDATA_ADDRESS> pArray = new CLRDATA_ADDRESS[adstore.DomainCount];
+        if (pArray==NULL)
+        {
+            return E_FAIL;
+        }
+
+        if (g_sos->GetAppDomainList(adstore.DomainCount, pArray, NULL)!=S_OK)
+        {
+            return E_FAIL;
+        }
+
+        for (int i = 0; i < adstore.DomainCount; i++)
+        {
+            DacpAppDomainData dadd;
+            if (dadd.Request(g_sos, pArray[i]) != S_OK)
+            {
+                g_domainIdMap.clear();
+                return E_FAIL;
+            }
+            g_domainIdMap[dadd.dwId] = pArray[i];
+        }
+        g_domainIdMapBuilt = true;
+    }
 
-    
-    return appDomain;
+    std::unordered_map<DWORD, CLRDATA_ADDRESS>::const_iterator itr = g_domainIdMap.find(adIndex);
+    *pAppDomain = (itr != g_domainIdMap.end()) ? itr->second : NULL;
+    return S_OK;
 }
 
 CLRDATA_ADDRESS GetAppDomainForMT(CLRDATA_ADDRESS mtPtr)
 {
-    DacpMethodTableData mt;
-    if (mt.Request(g_sos, mtPtr) != S_OK)
-    {
-        return NULL;
-    }
-    
-    DacpModuleData module;
-    if (module.Request(g_sos, mt.Module) != S_OK)
-    {
-        return NULL;
-    }
-
-    DacpAssemblyData assembly;
-    if (assembly.Request(g_sos, module.Assembly) != S_OK)
+    MTDomainInfo info;
+    if (GetMTDomainInfo(mtPtr, &info) != S_OK)
     {
         return NULL;
     }
 
     DacpAppDomainStoreData adstore;
-    if (adstore.Request(g_sos) != S_OK)
+    if (GetAppDomainStore(&adstore) != S_OK)
     {
         return NULL;
     }
 
-    return (assembly.ParentDomain == adstore.sharedDomain) ?
-            IsInOneDomainOnly(assembly.AssemblyPtr) :
-            assembly.ParentDomain;
+    return (info.ParentDomain == adstore.sharedDomain) ?
+            IsInOneDomainOnly(info.Assembly) :
+            info.ParentDomain;
 }
 
 CLRDATA_ADDRESS GetAppDomain(CLRDATA_ADDRESS objPtr)
 {
     CLRDATA_ADDRESS appDomain = NULL;
-    
+
     DacpObjectData objData;
     if (objData.Request(g_sos,objPtr) != S_OK)
-    {        
+    {
         return NULL;
     }
 
@@ -1630,30 +1871,18 @@ CLRDATA_ADDRESS GetAppDomain(CLRDATA_ADDRESS objPtr)
     // Then check the object flags word
     // finally, search threads for a reference to the object, and look at the thread context.
 
-    DacpMethodTableData mt;
-    if (mt.Request(g_sos,objData.MethodTable) != S_OK)
-    {
-        return NULL;
-    }
-
-    DacpModuleData module;
-    if (module.Request(g_sos,mt.Module) != S_OK)
+    MTDomainInfo assembly;
+    if (GetMTDomainInfo(objData.MethodTable, &assembly) != S_OK)
     {
         return NULL;
     }
 
-    DacpAssemblyData assembly;
-    if (assembly.Request(g_sos,module.Assembly) != S_OK)
+    DacpAppDomainStoreData adstore;
+    if (GetAppDomainStore(&adstore) != S_OK)
     {
         return NULL;
     }
 
-    DacpAppDomainStoreData adstore;
-    if (adstore.Request(g_sos) != S_OK)
-    {
-        return NULL;
-    }    
-    
     if (assembly.ParentDomain == adstore.sharedDomain)
     {
         sos::Object obj(TO_TADDR(objPtr));
@@ -1670,7 +1899,7 @@ CLRDATA_ADDRESS GetAppDomain(CLRDATA_ADDRESS objPtr)
             // If the assembly is in the shared domain, we can report it as
             // being in domain X if the only other domain that has the assembly
             // loaded is domain X.
-            appDomain = IsInOneDomainOnly(assembly.AssemblyPtr);
+            appDomain = IsInOneDomainOnly(assembly.Assembly);
             if (appDomain == NULL && ((value & BIT_SBLK_IS_HASH_OR_SYNCBLKINDEX) != 0))
             {
                 if ((value & BIT_SBLK_IS_HASHCODE) == 0)
@@ -1686,37 +1915,12 @@ CLRDATA_ADDRESS GetAppDomain(CLRDATA_ADDRESS objPtr)
             }
         }
         else if ((value & BIT_SBLK_IS_HASH_OR_SYNCBLKINDEX) == 0)
-        {            
-            size_t AllocSize;
-            if (!ClrSafeInt<size_t>::multiply(sizeof(CLRDATA_ADDRESS), adstore.DomainCount, AllocSize))
-            {
-                return NULL;
-            }
+        {
             // we know we have a non-zero adIndex. Find the appdomain.
-            ArrayHolder<CLRDATA_ADDRESS> pArray = new CLRDATA_ADDRESS[adstore.DomainCount];
-            if (pArray==NULL)
+            if (GetAppDomainById(adIndex, &appDomain) != S_OK)
             {
                 return NULL;
             }
-            
-            if (g_sos->GetAppDomainList(adstore.DomainCount, pArray, NULL)!=S_OK)
-            {
-                return NULL;
-            }
-
-            for (int i = 0; i < adstore.DomainCount; i++)
-            {
-                DacpAppDomainData dadd;
-                if (dadd.Request(g_sos, pArray[i]) != S_OK)
-                {
-                    return NULL;
-                }
-                if (dadd.dwId == adIndex)
-                {
-                    appDomain = pArray[i];
-                    break;
-                }
-            } 
         }
     }
     else
@@ -1967,52 +2171,194 @@ BOOL NameForMD_s (DWORD_PTR pMD, __out_ecount (capacity_mdName) WCHAR *mdName, s
 \**********************************************************************/
 BOOL NameForMT_s(DWORD_PTR MTAddr, __out_ecount (capacity_mdName) WCHAR *mdName, size_t capacity_mdName)
 {
-    HRESULT hr = g_sos->GetMethodTableName(TO_CDADDR(MTAddr), (ULONG32)capacity_mdName, mdName, NULL);
-    return SUCCEEDED(hr);
+    const WCHAR *name = GetInternedMethodTableName(MTAddr);
+    if (name == NULL)
+        return FALSE;
+
+    wcsncpy_s(mdName, capacity_mdName, name, _TRUNCATE);
+    return TRUE;
 }
 
-WCHAR *CreateMethodTableName(TADDR mt, TADDR cmt)
+// The session-wide string interning pool.  Type and method names repeat
+// endlessly — across HeapStat entries, the MethodTable name cache, the
+// metadata token memos — and a large dump session used to hold thousands
+// of separate copies of the same names.  The pool is hash-consed: equal
+// strings intern to the same arena-backed pointer, so pooled names cost
+// one copy apiece and compare with a pointer comparison.  The arena lives
+// until the target can run again.
+static const size_t kStringPoolChunkSize = 0x10000;  // WCHARs per arena chunk
+
+struct InternedStringHash
 {
-    bool array = false;
-    WCHAR *res = NULL;
-    
-    if (mt == sos::MethodTable::GetFreeMT())
+    size_t operator()(const WCHAR *str) const
     {
-        res = new WCHAR[5];
-        wcscpy_s(res, 5, W("Free"));
-        return res;
+        // Bulk FNV over the string payload; dumpheap -strings funnels every
+        // string body on the heap through here, and some are megabytes.
+        return (size_t)ScanHashBytes(str, _wcslen(str) * sizeof(WCHAR));
     }
-    
+};
+
+struct InternedStringEqual
+{
+    bool operator()(const WCHAR *s1, const WCHAR *s2) const
+    {
+        return _wcscmp(s1, s2) == 0;
+    }
+};
+
+static std::unordered_set<const WCHAR*, InternedStringHash, InternedStringEqual> g_stringPool;
+static std::vector<WCHAR*> g_stringPoolChunks;
+static size_t g_stringPoolBytes = 0;        // oversized chunks make this != chunks * chunk size
+static size_t g_stringPoolChunkCap = 0;   // capacity of the chunk being filled
+static size_t g_stringPoolChunkUsed = 0;  // WCHARs handed out from it
+
+const WCHAR *InternString(const WCHAR *str)
+{
+    if (str == NULL)
+        return NULL;
+
+    std::unordered_set<const WCHAR*, InternedStringHash, InternedStringEqual>::iterator it =
+        g_stringPool.find(str);
+    if (it != g_stringPool.end())
+        return *it;
+
+    size_t needed = _wcslen(str) + 1;
+    if (needed > g_stringPoolChunkCap - g_stringPoolChunkUsed)
+    {
+        // An oversized string simply gets an oversized chunk.
+        size_t chunkSize = needed > kStringPoolChunkSize ? needed : kStringPoolChunkSize;
+        g_stringPoolChunks.push_back(new WCHAR[chunkSize]);
+        g_stringPoolBytes += chunkSize * sizeof(WCHAR);
+        SOSMemAdd(SOSMemNameCache, chunkSize * sizeof(WCHAR));
+        g_stringPoolChunkCap = chunkSize;
+        g_stringPoolChunkUsed = 0;
+    }
+
+    WCHAR *res = g_stringPoolChunks.back() + g_stringPoolChunkUsed;
+    memcpy(res, str, needed * sizeof(WCHAR));
+    g_stringPoolChunkUsed += needed;
+
+    g_stringPool.insert(res);
+    return res;
+}
+
+void ClearStringPool()
+{
+    for (size_t i = 0; i < g_stringPoolChunks.size(); i++)
+        delete [] g_stringPoolChunks[i];
+
+    SOSMemSub(SOSMemNameCache, g_stringPoolBytes);
+    g_stringPoolBytes = 0;
+    g_stringPoolChunks.clear();
+    g_stringPoolChunkCap = 0;
+    g_stringPoolChunkUsed = 0;
+    g_stringPool.clear();
+}
+
+// The session-level MethodTable name cache.  A handful of thousand types
+// account for millions of name lookups during a heap traversal, and each
+// GetMethodTableName call is a round trip through the DAC.  Names resolve
+// through the DAC once per MethodTable and land in the interning pool;
+// every name path hands out the pooled pointers.
+static std::unordered_map<TADDR, const WCHAR*> g_mtNameMap;
+
+void ClearMethodTableNameCache()
+{
+    g_mtNameMap.clear();
+}
+
+void EnumMethodTableNameCache(void (*fn)(TADDR key, const WCHAR *name, void *state), void *state)
+{
+    std::unordered_map<TADDR, const WCHAR*>::iterator it = g_mtNameMap.begin();
+    for (; it != g_mtNameMap.end(); ++it)
+        fn(it->first, it->second, state);
+}
+
+void ImportMethodTableName(TADDR key, const WCHAR *name)
+{
+    // An entry the session resolved itself wins over the imported one.
+    if (g_mtNameMap.find(key) == g_mtNameMap.end())
+        g_mtNameMap[key] = name == NULL ? NULL : InternString(name);
+}
+
+const WCHAR *GetInternedMethodTableName(TADDR mt, TADDR cmt)
+{
+    bool array = false;
+
+    if (mt == sos::MethodTable::GetFreeMT())
+        return W("Free");
+
     if (mt == sos::MethodTable::GetArrayMT() && cmt != NULL)
     {
         mt = cmt;
         array = true;
     }
-    
+
+    // MethodTables are pointer aligned, so the low bit is free to distinguish
+    // "name of cmt's array type" from "name of cmt" in one map.
+    TADDR key = array ? (mt | 1) : mt;
+
+    std::unordered_map<TADDR, const WCHAR*>::iterator it = g_mtNameMap.find(key);
+    if (it != g_mtNameMap.end())
+        return it->second;
+
+    const WCHAR *interned = NULL;
     unsigned int needed = 0;
     HRESULT hr = g_sos->GetMethodTableName(mt, 0, NULL, &needed);
-    
-    // If failed, we will return null.
-    if (SUCCEEDED(hr))
+
+    if (SUCCEEDED(hr) && needed > 0)
     {
-        // +2 for [], if we need it.
-        res = new WCHAR[needed+2];
-        hr = g_sos->GetMethodTableName(mt, needed, res, NULL);
-        
-        if (FAILED(hr))
+        ArrayHolder<WCHAR> buffer = new WCHAR[needed+2];
+        hr = g_sos->GetMethodTableName(mt, needed, buffer, NULL);
+
+        if (SUCCEEDED(hr))
         {
-            delete [] res;
-            res = NULL;
-        }
-        else if (array)
-        {        
-            res[needed-1] = '[';
-            res[needed] = ']';
-            res[needed+1] = 0;
+            size_t len = needed - 1;  // "needed" includes the terminator
+            if (array)
+            {
+                buffer[len++] = L'[';
+                buffer[len++] = L']';
+            }
+            buffer[len] = L'\0';
+            interned = InternString(buffer);
         }
     }
 
-    return res;
+    // Failures are cached too (as NULL): a MethodTable the DAC cannot name
+    // now won't be nameable on the next million objects either.
+    g_mtNameMap[key] = interned;
+    return interned;
+}
+
+// The session-level MethodDesc name cache.  Stack-trace decoding hits the
+// same MethodDescs repeatedly — an async stack repeats its state machine
+// frames, and the exception formatters render every stack twice (once to
+// size the output, once to fill it) — and each GetMethodDescName call is
+// a round trip through the DAC.
+static std::unordered_map<TADDR, const WCHAR*> g_mdNameMap;
+
+void ClearMethodDescNameCache()
+{
+    g_mdNameMap.clear();
+}
+
+const WCHAR *GetInternedMethodDescName(TADDR md)
+{
+    std::unordered_map<TADDR, const WCHAR*>::iterator it = g_mdNameMap.find(md);
+    if (it != g_mdNameMap.end())
+        return it->second;
+
+    const WCHAR *interned = NULL;
+    ArrayHolder<WCHAR> buffer = new WCHAR[MAX_LONGPATH+1];
+    if (g_sos->GetMethodDescName(TO_CDADDR(md), MAX_LONGPATH, buffer, NULL) == S_OK)
+    {
+        interned = InternString(buffer);
+    }
+
+    // A cached NULL keeps an unnameable MethodDesc from going back to the
+    // DAC for every frame it appears in.
+    g_mdNameMap[md] = interned;
+    return interned;
 }
 
 /**********************************************************************\
@@ -2202,12 +2548,90 @@ BOOL TryGetMethodDescriptorForDelegate(CLRDATA_ADDRESS delegateAddr, CLRDATA_ADD
     return FALSE;
 }
 
+// Session cache of what an address turned out to be when an annotator probed
+// it.  The same runtime addresses - method tables, hot objects, helper
+// arguments - recur constantly across disassembly and stack scans, and each
+// probe otherwise costs a round of DAC requests.
+struct PointerClassification
+{
+    PointerKind kind;
+    std::wstring name;
+};
+
+static std::unordered_map<DWORD_PTR, PointerClassification> *g_pPointerClassificationCache = NULL;
+
+BOOL TryGetPointerClassification(DWORD_PTR addr, PointerKind *pKind, const WCHAR **ppName)
+{
+    if (g_pPointerClassificationCache != NULL)
+    {
+        std::unordered_map<DWORD_PTR, PointerClassification>::const_iterator itr =
+            g_pPointerClassificationCache->find(addr);
+        if (itr != g_pPointerClassificationCache->end())
+        {
+            *pKind = itr->second.kind;
+            *ppName = itr->second.name.c_str();
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+void CachePointerClassification(DWORD_PTR addr, PointerKind kind, const WCHAR *pName)
+{
+    if (g_pPointerClassificationCache == NULL)
+    {
+        g_pPointerClassificationCache = new std::unordered_map<DWORD_PTR, PointerClassification>();
+        if (g_pPointerClassificationCache == NULL)
+            return;
+    }
+
+    PointerClassification &entry = (*g_pPointerClassificationCache)[addr];
+    entry.kind = kind;
+    entry.name = (pName != NULL) ? pName : W("");
+}
+
+void ClearPointerClassificationCache()
+{
+    if (g_pPointerClassificationCache != NULL)
+    {
+        delete g_pPointerClassificationCache;
+        g_pPointerClassificationCache = NULL;
+    }
+}
+
 void DumpStackObjectsOutput(const char *location, DWORD_PTR objAddr, BOOL verifyFields)
 {
     // rule out pointers that are outside of the gc heap.
     if (g_snapshot.GetHeap(objAddr) == NULL)
         return;
 
+    // Unverified scans answer repeats from the session classification cache;
+    // verifying scans must revalidate every object, so they bypass it.  A
+    // classification left by the disassembly walkers' weaker probes doesn't
+    // meet this command's validation bar and falls through.
+    PointerKind kind;
+    const WCHAR *pCachedName;
+    if (!verifyFields && TryGetPointerClassification(objAddr, &kind, &pCachedName))
+    {
+        if (kind == PK_NotObject)
+            return;
+
+        if ((kind == PK_ValidObject || kind == PK_StringObject) && pCachedName[0] != W('\0'))
+        {
+            DMLOut("%-" POINTERSIZE "s %s ", location, DMLObject(objAddr));
+            ExtOut("%S", pCachedName);
+            if (kind == PK_StringObject)
+            {
+                // contents can change between stops; render them live
+                ExtOut("    ");
+                StringObjectContent(objAddr, FALSE, 40);
+            }
+            ExtOut("\n");
+            return;
+        }
+    }
+
     DacpObjectData objectData;
     if (objectData.Request(g_sos, TO_CDADDR(objAddr)) != S_OK)
         return;
@@ -2218,18 +2642,32 @@ void DumpStackObjectsOutput(const char *location, DWORD_PTR objAddr, BOOL verify
         DMLOut("%-" POINTERSIZE "s %s ", location, DMLObject(objAddr));
         if (g_sos->GetObjectClassName(TO_CDADDR(objAddr), mdNameLen, g_mdName, NULL)==S_OK)
         {
+            std::wstring rendered(g_mdName);
             ExtOut("%S", g_mdName);
 
             if (IsStringObject(objAddr))
             {
+                if (!verifyFields)
+                    CachePointerClassification(objAddr, PK_StringObject, rendered.c_str());
                 ExtOut("    ");
                 StringObjectContent(objAddr, FALSE, 40);
             }
-            else if (IsObjectArray(objAddr) && 
+            else if (IsObjectArray(objAddr) &&
                      (g_sos->GetMethodTableName(objectData.ElementTypeHandle, mdNameLen, g_mdName, NULL) == S_OK))
             {
                 ExtOut("    ");
                 ExtOut("(%S[])", g_mdName);
+                if (!verifyFields)
+                {
+                    rendered += W("    (");
+                    rendered += g_mdName;
+                    rendered += W("[])");
+                    CachePointerClassification(objAddr, PK_ValidObject, rendered.c_str());
+                }
+            }
+            else if (!verifyFields)
+            {
+                CachePointerClassification(objAddr, PK_ValidObject, rendered.c_str());
             }
         }
         else
@@ -2238,27 +2676,243 @@ void DumpStackObjectsOutput(const char *location, DWORD_PTR objAddr, BOOL verify
         }
         ExtOut("\n");
     }
+    else if (!verifyFields)
+    {
+        CachePointerClassification(objAddr, PK_NotObject, NULL);
+    }
+}
+
+void DumpStackObjectsOutput(DWORD_PTR ptr, DWORD_PTR objAddr, BOOL verifyFields)
+{
+    char location[64];
+    sprintf_s(location, 64, "%p", (DWORD_PTR *)ptr);
+
+    DumpStackObjectsOutput(location, objAddr, verifyFields);
+}
+
+DWORD_PTR *ReadStackSlots(TADDR top, TADDR end, size_t *count)
+{
+    *count = 0;
+    if (end <= top)
+        return NULL;
+
+    size_t slots = (end - top) / sizeof(DWORD_PTR);
+    if (slots == 0)
+        return NULL;
+
+    DWORD_PTR *buffer = new DWORD_PTR[slots];
+    if (buffer == NULL)
+        return NULL;
+
+    ULONG read = 0;
+    if (FAILED(g_ExtData->ReadVirtual(TO_CDADDR(top), buffer, (ULONG)(slots * sizeof(DWORD_PTR)), &read)) ||
+        read != slots * sizeof(DWORD_PTR))
+    {
+        delete [] buffer;
+        return NULL;
+    }
+
+    *count = slots;
+    return buffer;
+}
+
+void ReadVirtualBatch(ReadVirtualRange *ranges, ULONG count)
+{
+    if (count == 0)
+        return;
+
+    g_readStats.BatchCalls++;
+    g_readStats.BatchRanges += count;
+
+#ifdef FEATURE_PAL
+    // The lldb host can resolve the whole batch natively, paying the
+    // interface dispatch and process lookup once instead of per range.
+    ToRelease<ILLDBServices2> services2(NULL);
+    if (g_ExtServices != NULL &&
+        SUCCEEDED(g_ExtServices->QueryInterface(__uuidof(ILLDBServices2), (void**)&services2)))
+    {
+        ArrayHolder<READ_VIRTUAL_ENTRY> entries = new READ_VIRTUAL_ENTRY[count];
+        if (entries != NULL)
+        {
+            for (ULONG i = 0; i < count; ++i)
+            {
+                entries[i].Offset = ranges[i].Address;
+                entries[i].Buffer = ranges[i].Buffer;
+                entries[i].BufferSize = ranges[i].Size;
+            }
+
+            if (SUCCEEDED(services2->ReadVirtualBatch(entries, count)))
+            {
+                for (ULONG i = 0; i < count; ++i)
+                {
+                    ranges[i].BytesRead = entries[i].BytesRead;
+                    ranges[i].Status = entries[i].Status;
+
+                    g_readStats.BytesRequested += ranges[i].Size;
+                    g_readStats.BytesRead += ranges[i].BytesRead;
+                }
+
+                return;
+            }
+        }
+    }
+#endif
+
+    for (ULONG i = 0; i < count; ++i)
+    {
+        ULONG read = 0;
+
+        g_readStats.Calls++;
+        g_readStats.BytesRequested += ranges[i].Size;
+
+        ranges[i].Status = g_ExtData->ReadVirtual(TO_CDADDR(ranges[i].Address), ranges[i].Buffer, ranges[i].Size, &read);
+        ranges[i].BytesRead = read;
+
+        if (SUCCEEDED(ranges[i].Status))
+            g_readStats.BytesRead += read;
+    }
+}
+
+#ifdef FEATURE_PAL
+static void AddReadableMemoryRegion(void *param, ULONG64 base, ULONG64 size, ULONG permissions)
+{
+    if ((permissions & MEMORY_REGION_READ) == 0)
+        return;
+
+    MemoryRegion region;
+    region.Base = base;
+    region.Size = size;
+    region.Writable = (permissions & MEMORY_REGION_WRITE) != 0;
+    region.Executable = (permissions & MEMORY_REGION_EXECUTE) != 0;
+    ((std::vector<MemoryRegion>*)param)->push_back(region);
+}
+#endif
+
+BOOL EnumReadableMemoryRegions(std::vector<MemoryRegion> &regions)
+{
+    regions.clear();
+
+#ifdef FEATURE_PAL
+    ToRelease<ILLDBServices2> services2(NULL);
+    if (g_ExtServices == NULL ||
+        FAILED(g_ExtServices->QueryInterface(__uuidof(ILLDBServices2), (void**)&services2)))
+    {
+        return FALSE;
+    }
+
+    return SUCCEEDED(services2->EnumerateMemoryRegions(AddReadableMemoryRegion, &regions));
+#else
+    // Walk the address space with QueryVirtual, keeping only committed
+    // regions a scanner can read; guard pages and no-access protections
+    // would only produce read failures.
+    const DWORD unreadable = PAGE_NOACCESS | PAGE_GUARD;
+    const DWORD writable = PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+    const DWORD executable = PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+    ULONG64 memCur = 0;
+    while (true)
+    {
+        MEMORY_BASIC_INFORMATION64 memInfo;
+        if (!NT_SUCCESS(g_ExtData2->QueryVirtual(UL64_TO_CDA(memCur), &memInfo)) ||
+            memInfo.RegionSize == 0)
+        {
+            break;
+        }
+
+        if (memInfo.State == MEM_COMMIT && (memInfo.Protect & unreadable) == 0)
+        {
+            MemoryRegion region;
+            region.Base = memCur;
+            region.Size = memInfo.RegionSize;
+            region.Writable = (memInfo.Protect & writable) != 0;
+            region.Executable = (memInfo.Protect & executable) != 0;
+            regions.push_back(region);
+        }
+
+        memCur += memInfo.RegionSize;
+    }
+
+    // memCur only advanced if at least one query succeeded; a host that
+    // cannot answer the very first one cannot enumerate regions.
+    return memCur != 0;
+#endif
 }
 
-void DumpStackObjectsOutput(DWORD_PTR ptr, DWORD_PTR objAddr, BOOL verifyFields)
-{
-    char location[64];
-    sprintf_s(location, 64, "%p", (DWORD_PTR *)ptr);
+// Returns the overall [lowest, highest) address range of the GC heap
+// segments, for cheap "can this possibly be an object" prefiltering.  The
+// range is conservative: anything outside it is definitely not in the heap.
+static BOOL GetGCHeapBounds(DWORD_PTR *lo, DWORD_PTR *hi)
+{
+    if (!g_snapshot.Build() || g_snapshot.GetSegmentCount() == 0)
+        return FALSE;
+
+    TADDR lowest = ~(TADDR)0;
+    TADDR highest = 0;
+    for (int i = 0; i < g_snapshot.GetSegmentCount(); ++i)
+    {
+        const DacpHeapSegmentData *segment = g_snapshot.GetSegmentByIndex(i);
+        TADDR start = TO_TADDR(segment->mem);
+        TADDR end = TO_TADDR(segment->highAllocMark);
+        if (end <= start)
+            continue;
+
+        if (start < lowest)
+            lowest = start;
+        if (end > highest)
+            highest = end;
+    }
+
+    if (highest == 0)
+        return FALSE;
 
-    DumpStackObjectsOutput(location, objAddr, verifyFields);
+    *lo = lowest;
+    *hi = highest;
+    return TRUE;
 }
 
 void DumpStackObjectsInternal(size_t StackTop, size_t StackBottom, BOOL verifyFields)
 {
-    for (DWORD_PTR ptr = StackTop; ptr <= StackBottom; ptr += sizeof(DWORD_PTR))
-    {       
+    // Snapshot the whole stack range up front; probing it one ReadVirtual
+    // per slot dominates the cost of the scan otherwise.  If the bulk read
+    // fails (a guard page, a bad range from the caller), fall back to the
+    // slot-by-slot walk.
+    size_t count = 0;
+    ArrayHolder<DWORD_PTR> slots = ReadStackSlots(StackTop, StackBottom + sizeof(DWORD_PTR), &count);
+
+    if (slots == NULL)
+    {
+        for (DWORD_PTR ptr = StackTop; ptr <= StackBottom; ptr += sizeof(DWORD_PTR))
+        {
+            if (IsInterrupt())
+                return;
+
+            DWORD_PTR objAddr;
+            move_xp(objAddr, ptr);
+
+            DumpStackObjectsOutput(ptr, objAddr, verifyFields);
+        }
+
+        return;
+    }
+
+    // Prefilter the slots against the overall range of the GC heap: the range
+    // scan kernel weeds out nulls, small integers and code addresses, and
+    // only the surviving candidates go through full object validation.  The
+    // segments are checked precisely there, so the filter only has to be
+    // conservative.
+    DWORD_PTR base = 0;
+    DWORD_PTR range = ~(DWORD_PTR)0;
+    if (GetGCHeapBounds(&base, &range))
+        range -= base;
+
+    for (size_t i = ScanNextSlotInRange(slots, count, 0, base, range);
+         i < count;
+         i = ScanNextSlotInRange(slots, count, i + 1, base, range))
+    {
         if (IsInterrupt())
             return;
 
-        DWORD_PTR objAddr;
-        move_xp(objAddr, ptr);
-
-        DumpStackObjectsOutput(ptr, objAddr, verifyFields);
+        DumpStackObjectsOutput(StackTop + i * sizeof(DWORD_PTR), slots[i], verifyFields);
     }
 }
 
@@ -2418,167 +3072,34 @@ DWORD_PTR *ModuleFromName(__in_opt LPSTR mName, int *numModule)
     if (numModule == NULL)
         return NULL;
 
-    DWORD_PTR *moduleList = NULL;
     *numModule = 0;
 
-    DacpAppDomainStoreData adsData;
-    if (adsData.Request(g_sos)!=S_OK)
-        return NULL;
-
-    ArrayHolder<CLRDATA_ADDRESS> pAssemblyArray = NULL;
-    ArrayHolder<CLRDATA_ADDRESS> pModules = NULL;
-    int arrayLength = 0;
-    int numSpecialDomains = (adsData.sharedDomain != NULL) ? 2 : 1;
-    if (!ClrSafeInt<int>::addition(adsData.DomainCount, numSpecialDomains, arrayLength))
-    {
-        ExtOut("<integer overflow>\n");
-        return NULL;
-    }
-    ArrayHolder<CLRDATA_ADDRESS> pArray = new CLRDATA_ADDRESS[arrayLength];
-
-    if (pArray==NULL)
-    {
-        ReportOOM();
-        return NULL;
-    }
-
-    pArray[0] = adsData.systemDomain;
-    if (adsData.sharedDomain != NULL)
-    {
-        pArray[1] = adsData.sharedDomain;
-    }
-    if (g_sos->GetAppDomainList(adsData.DomainCount, pArray.GetPtr()+numSpecialDomains, NULL)!=S_OK)
-    {
-        ExtOut("Unable to get array of AppDomains\n");
+    if (!BuildDomainModuleTree())
         return NULL;
-    }
 
-    // List all domain
-    size_t AllocSize;
-    int maxList = arrayLength; // account for system and shared domains
-    if (maxList <= 0 || !ClrSafeInt<size_t>::multiply(maxList, sizeof(PVOID), AllocSize))
-    {
-        ExtOut("Integer overflow error.\n");
-        return NULL;
-    }
-    
-    moduleList = new DWORD_PTR[maxList];
+    // AddToModuleList dedups modules that appear under more than one domain,
+    // so the tree size bounds the list and it never needs to grow.
+    int maxList = (int)g_domainModuleTree.size() + 1;
+    DWORD_PTR *moduleList = new DWORD_PTR[maxList];
     if (moduleList == NULL)
     {
         ReportOOM();
         return NULL;
     }
 
-    WCHAR StringData[MAX_LONGPATH];
-    char fileName[sizeof(StringData)/2];
-    
-    // Search all domains to find a module
-    for (int n = 0; n < adsData.DomainCount+numSpecialDomains; n++)
+    for (size_t n = 0; n < g_domainModuleTree.size(); n++)
     {
-        if (IsInterrupt())
-        {
-            ExtOut("<interrupted>\n");
-            goto Failure;
-        }
-        
-        DacpAppDomainData appDomain;
-        if (FAILED(appDomain.Request(g_sos,pArray[n])))
+        const DomainModuleNode &node = g_domainModuleTree[n];
+        if ((mName == NULL) ||
+            IsSameModuleName(node.FileName.c_str(), mName) ||
+            DebuggerModuleNamesMatch(node.PEFile, mName) ||
+            IsFusionLoadedModule(node.FileName.c_str(), mName))
         {
-            // Don't print a failure message here, there is a very normal case when checking
-            // for modules after clr is loaded but before any AppDomains or assemblies are created
-            // for example:
-            // >sxe ld:clr
-            // >g
-            // ...
-            // ModLoad: coreclr.dll
-            // >!bpmd Foo.dll Foo.Bar
-
-            // we will correctly give the answer that whatever module you were looking for, it isn't loaded yet
-            goto Failure;
-        }
-
-        if (appDomain.AssemblyCount)
-        {            
-            pAssemblyArray = new CLRDATA_ADDRESS[appDomain.AssemblyCount];
-            if (pAssemblyArray==NULL)
-            {
-                ReportOOM();
-                goto Failure;
-            }
-
-            if (FAILED(g_sos->GetAssemblyList(appDomain.AppDomainPtr, appDomain.AssemblyCount, pAssemblyArray, NULL)))
-            {
-                ExtOut("Unable to get array of Assemblies for the given AppDomain..\n");
-                goto Failure;
-            }
-
-            for (int nAssem = 0; nAssem < appDomain.AssemblyCount; nAssem ++)
-            {
-                if (IsInterrupt())
-                {
-                    ExtOut("<interrupted>\n");
-                    goto Failure;
-                }
-
-                DacpAssemblyData assemblyData;
-                if (FAILED(assemblyData.Request(g_sos, pAssemblyArray[nAssem])))
-                {
-                    ExtOut("Failed to request assembly.\n");
-                    goto Failure;
-                }
-
-                pModules = new CLRDATA_ADDRESS[assemblyData.ModuleCount];
-                if (FAILED(g_sos->GetAssemblyModuleList(assemblyData.AssemblyPtr, assemblyData.ModuleCount, pModules, NULL)))
-                {
-                    ExtOut("Failed to get the modules for the given assembly.\n");
-                    goto Failure;
-                }
-
-                for (UINT nModule = 0; nModule < assemblyData.ModuleCount; nModule++)
-                {
-                    if (IsInterrupt())
-                    {
-                        ExtOut("<interrupted>\n");
-                        goto Failure;
-                    }
-
-                    CLRDATA_ADDRESS ModuleAddr = pModules[nModule];
-                    DacpModuleData ModuleData;
-                    if (FAILED(ModuleData.Request(g_sos,ModuleAddr)))
-                    {
-                        ExtOut("Failed to request Module data from assembly.\n");
-                        goto Failure;
-                    }
-
-                    FileNameForModule ((DWORD_PTR)ModuleAddr, StringData);
-                    int m;
-                    for (m = 0; StringData[m] != L'\0'; m++)
-                    {
-                        fileName[m] = (char)StringData[m];
-                    }
-                    fileName[m] = '\0';
-                    
-                    if ((mName == NULL) || 
-                        IsSameModuleName(fileName, mName) ||
-                        DebuggerModuleNamesMatch(ModuleData.File, mName) ||
-                        IsFusionLoadedModule(fileName, mName))
-                    {
-                        AddToModuleList(moduleList, *numModule, maxList, (DWORD_PTR)ModuleAddr);
-                    }    
-                }                        
-
-                pModules = NULL;
-            }
-            pAssemblyArray = NULL;
+            AddToModuleList(moduleList, *numModule, maxList, node.Module);
         }
     }
 
     return moduleList;
-    
-    // We do not want to return a half-constructed list.  Instead, we return NULL on a failure.
-Failure:
-    delete [] moduleList;
-    return NULL;
 }
 
 /**********************************************************************\
@@ -2626,10 +3147,127 @@ HRESULT GetModuleFromAddress(___in CLRDATA_ADDRESS peAddress, ___out IXCLRDataMo
     return hr;
 }
 
+// The inverted type-name index behind the all-module form of !name2ee.
+// Searching "*" used to touch every loaded module's metadata per query;
+// with hundreds of assemblies that is minutes of DAC traffic for each
+// lookup.  One pass over every module's TypeDef table builds a map from
+// full type name to the modules that define it, and subsequent queries
+// narrow the module walk to the actual definers.
+static std::unordered_map<std::wstring, std::vector<DWORD_PTR> > g_typeNameIndex;
+static bool g_typeNameIndexBuilt = false;
+
+void ClearTypeNameIndex()
+{
+    g_typeNameIndex.clear();
+    g_typeNameIndexBuilt = false;
+}
+
+// Composes the full "Outer+Nested" name of a TypeDef.
+static bool GetFullTypeDefName(IMetaDataImport *pImport, mdTypeDef cl, std::wstring &name)
+{
+    WCHAR part[MAX_CLASSNAME_LENGTH];
+    ULONG size;
+    DWORD flags;
+    if (FAILED(pImport->GetTypeDefProps(cl, part, MAX_CLASSNAME_LENGTH, &size, &flags, NULL)))
+        return false;
+
+    if (IsTdNested(flags))
+    {
+        mdTypeDef enclosing;
+        if (FAILED(pImport->GetNestedClassProps(cl, &enclosing)) ||
+            !GetFullTypeDefName(pImport, enclosing, name))
+        {
+            return false;
+        }
+        name += L'+';
+        name += part;
+    }
+    else
+    {
+        name = part;
+    }
+
+    return true;
+}
+
+static bool BuildTypeNameIndex()
+{
+    int numModule;
+    ArrayHolder<DWORD_PTR> moduleList = ModuleFromName(NULL, &numModule);
+    if (moduleList == NULL)
+        return false;
+
+    for (int i = 0; i < numModule; i++)
+    {
+        if (IsInterrupt())
+        {
+            // A partial index would silently hide definers.
+            ClearTypeNameIndex();
+            return false;
+        }
+
+        ToRelease<IMetaDataImport> pImport = MDImportForModule(moduleList[i]);
+        if (pImport == NULL)
+            continue;
+
+        HCORENUM henum = NULL;
+        mdTypeDef tokens[256];
+        ULONG count;
+        std::wstring name;
+        while (SUCCEEDED(pImport->EnumTypeDefs(&henum, tokens, _countof(tokens), &count)) && count > 0)
+        {
+            for (ULONG n = 0; n < count; n++)
+            {
+                if (!GetFullTypeDefName(pImport, tokens[n], name))
+                    continue;
+
+                std::vector<DWORD_PTR> &modules = g_typeNameIndex[name];
+                if (modules.empty() || modules.back() != moduleList[i])
+                    modules.push_back(moduleList[i]);
+            }
+        }
+        pImport->CloseEnum(henum);
+    }
+
+    g_typeNameIndexBuilt = true;
+    return true;
+}
+
+bool FindModulesForTypeName(const char *name, std::vector<DWORD_PTR> &modules)
+{
+    if (!g_typeNameIndexBuilt && !BuildTypeNameIndex())
+        return false;
+
+    std::wstring key;
+    for (const char *c = name; *c != '\0'; c++)
+        key += *c == '/' ? L'+' : (WCHAR)*c;
+
+    std::unordered_map<std::wstring, std::vector<DWORD_PTR> >::const_iterator it = g_typeNameIndex.find(key);
+    if (it == g_typeNameIndex.end())
+    {
+        // The name may be "Type.Method" (or "Type..ctor"); retry with the
+        // last dot-separated component stripped, since a method lives in
+        // the module that defines its type.
+        size_t dot = key.rfind(L'.');
+        if (dot == std::wstring::npos)
+            return false;
+
+        if (dot > 0 && key[dot-1] == L'.')
+            dot--;
+
+        it = g_typeNameIndex.find(key.substr(0, dot));
+        if (it == g_typeNameIndex.end())
+            return false;
+    }
+
+    modules = it->second;
+    return true;
+}
+
 /**********************************************************************\
 * Routine Description:                                                 *
 *                                                                      *
-*    Find the EE data given a name.                                    *  
+*    Find the EE data given a name.                                    *
 *                                                                      *
 \**********************************************************************/
 void GetInfoFromName(DWORD_PTR ModulePtr, const char* name, mdTypeDef* retMdTypeDef)
@@ -2648,12 +3286,14 @@ void GetInfoFromName(DWORD_PTR ModulePtr, const char* name, mdTypeDef* retMdType
     for (n = 0; n <= length; n ++)
         wszName[n] = name[n];
 
-    // First enumerate methods. We're taking advantage of the DAC's 
+    // First enumerate methods. We're taking advantage of the DAC's
     // CLRDataModule::EnumMethodDefinitionByName which can parse
     // method names (whether in nested classes, or explicit interface
-    // method implementations).
-    ToRelease<IXCLRDataModule> ModuleDefinition;
-    if (g_sos->GetModule(ModulePtr, &ModuleDefinition) == S_OK)
+    // method implementations).  The import cache already built this
+    // module's interface for the importer above, so take that one rather
+    // than paying for a second DAC module setup.
+    ToRelease<IXCLRDataModule> ModuleDefinition = ClrDataModuleForModule(ModulePtr);
+    if (ModuleDefinition != NULL)
     {
         CLRDATA_ENUM h;
         if (ModuleDefinition->StartEnumMethodDefinitionsByName(wszName, 0, &h) == S_OK)
@@ -2941,7 +3581,7 @@ void GetInfoFromModule (DWORD_PTR ModuleAddr, ULONG token, DWORD_PTR *ret)
         case mdtFieldDef:
         {
             NameForToken_s(ModuleAddr, token, g_mdName, mdNameLen);
-            ExtOut("Field name:  %S\n", g_mdName);
+            ExtOut("Field name:  %s\n", WideToNarrowArena(g_mdName));
             break;
         }
         case mdtMethodDef:
@@ -2963,7 +3603,7 @@ void GetInfoFromModule (DWORD_PTR ModuleAddr, ULONG token, DWORD_PTR *ret)
                 NameForToken_s(ModuleAddr, token, g_mdName, mdNameLen);
             }
             
-            ExtOut("Name:        %S\n", g_mdName);
+            ExtOut("Name:        %s\n", WideToNarrowArena(g_mdName));
             // Nice to have a little more data
             if (md)
             {
@@ -3020,7 +3660,7 @@ void GetInfoFromModule (DWORD_PTR ModuleAddr, ULONG token, DWORD_PTR *ret)
                 ExtOut("EEClass:     <not loaded yet>\n");                
             }
             NameForToken_s(ModuleAddr, token, g_mdName, mdNameLen);
-            ExtOut("Name:        %S\n", g_mdName);
+            ExtOut("Name:        %s\n", WideToNarrowArena(g_mdName));
             break;
         }
         default:
@@ -3338,75 +3978,123 @@ void GetDomainList (DWORD_PTR *&domainList, int &numDomain)
 }
 
 
-HRESULT GetThreadList(DWORD_PTR **threadList, int *numThread)
+// Session-level snapshot of the managed thread store shared by the commands
+// that enumerate threads (gcroot's stack-root scan, GetThreadList callers,
+// GetCurrentManagedThread).  On a dump the store cannot change, so one DAC
+// walk serves the whole session; on a live target the snapshot is discarded
+// on command entry and whenever the target runs.
+struct ThreadStoreSnapshotEntry
 {
-    _ASSERTE(threadList != NULL);
-    _ASSERTE(numThread != NULL);
+    DWORD_PTR Thread;       // managed Thread pointer
+    ULONG osThreadId;
+};
 
-    if (threadList == NULL || numThread == NULL)
+static std::vector<ThreadStoreSnapshotEntry> g_threadStoreSnapshot;
+static bool g_threadStoreSnapshotBuilt = false;
+
+void ClearThreadStoreSnapshot()
+{
+    g_threadStoreSnapshot.clear();
+    g_threadStoreSnapshotBuilt = false;
+}
+
+// Returns S_FALSE on interrupt and E_FAIL on a DAC failure.  A partial
+// snapshot is never kept; it would silently hide threads from later
+// commands.
+static HRESULT BuildThreadStoreSnapshot()
+{
+    if (g_threadStoreSnapshotBuilt)
     {
-        return E_FAIL;
+        return S_OK;
     }
 
-    *numThread = 0;
-
     DacpThreadStoreData ThreadStore;
-    if ( ThreadStore.Request(g_sos) != S_OK)
+    if (ThreadStore.Request(g_sos) != S_OK)
     {
         ExtOut("Failed to request threads from the thread store.");
         return E_FAIL;
     }
-     
-    *threadList = new DWORD_PTR[ThreadStore.threadCount];
-    if (*threadList == NULL)
-    {
-        ReportOOM();
-        return E_OUTOFMEMORY;
-    }
-    
+
+    g_threadStoreSnapshot.reserve(ThreadStore.threadCount);
+
     CLRDATA_ADDRESS CurThread = ThreadStore.firstThread;
     while (CurThread != NULL)
     {
         if (IsInterrupt())
+        {
+            g_threadStoreSnapshot.clear();
             return S_FALSE;
+        }
 
         DacpThreadData Thread;
         if (Thread.Request(g_sos, CurThread) != S_OK)
         {
             ExtOut("Failed to request Thread at %p\n", SOS_PTR(CurThread));
+            g_threadStoreSnapshot.clear();
             return E_FAIL;
         }
 
-        (*threadList)[(*numThread)++] = (DWORD_PTR)CurThread;
+        ThreadStoreSnapshotEntry entry;
+        entry.Thread = (DWORD_PTR)CurThread;
+        entry.osThreadId = (ULONG)Thread.osThreadId;
+        g_threadStoreSnapshot.push_back(entry);
+
         CurThread = Thread.nextThread;
     }
 
+    g_threadStoreSnapshotBuilt = true;
+    return S_OK;
+}
+
+HRESULT GetThreadList(DWORD_PTR **threadList, int *numThread)
+{
+    _ASSERTE(threadList != NULL);
+    _ASSERTE(numThread != NULL);
+
+    if (threadList == NULL || numThread == NULL)
+    {
+        return E_FAIL;
+    }
+
+    *numThread = 0;
+
+    HRESULT hr = BuildThreadStoreSnapshot();
+    if (hr != S_OK)
+    {
+        return hr;
+    }
+
+    *threadList = new DWORD_PTR[g_threadStoreSnapshot.size()];
+    if (*threadList == NULL)
+    {
+        ReportOOM();
+        return E_OUTOFMEMORY;
+    }
+
+    for (size_t i = 0; i < g_threadStoreSnapshot.size(); i++)
+    {
+        (*threadList)[(*numThread)++] = g_threadStoreSnapshot[i].Thread;
+    }
+
     return S_OK;
 }
 
 CLRDATA_ADDRESS GetCurrentManagedThread ()
 {
-    DacpThreadStoreData ThreadStore;
-    ThreadStore.Request(g_sos);
+    ULONG Tid;
+    g_ExtSystem->GetCurrentThreadSystemId(&Tid);
+
+    if (BuildThreadStoreSnapshot() != S_OK)
+    {
+        return NULL;
+    }
 
-    ULONG Tid;
-    g_ExtSystem->GetCurrentThreadSystemId(&Tid);
-    
-    CLRDATA_ADDRESS CurThread = ThreadStore.firstThread;
-    while (CurThread)
+    for (size_t i = 0; i < g_threadStoreSnapshot.size(); i++)
     {
-        DacpThreadData Thread;
-        if (Thread.Request(g_sos, CurThread) != S_OK)
+        if (g_threadStoreSnapshot[i].osThreadId == Tid)
         {
-            return NULL;
-        }        
-        
-        if (Thread.osThreadId == Tid)
-        {        
-            return CurThread;
+            return g_threadStoreSnapshot[i].Thread;
         }
-        
-        CurThread = Thread.nextThread;
     }
     return NULL;
 }
@@ -3477,6 +4165,15 @@ size_t FunctionType (size_t EIP)
         }
     }
 
+    // An address outside every module and every JIT code heap has no
+    // MethodDesc; the range index answers that without a DAC request, which
+    // matters when the raw stack scanners probe every stack word.
+    BOOL inHeap;
+    if (base == 0 && TryIsInJitCodeHeap(EIP, &inHeap) && !inHeap)
+    {
+        return 1;
+    }
+
     CLRDATA_ADDRESS dwStartAddr = TO_CDADDR(EIP);
     CLRDATA_ADDRESS pMD;
     if (g_sos->GetMethodDescPtrFromIP(dwStartAddr, &pMD) != S_OK)
@@ -3634,7 +4331,7 @@ void StringObjectContent(size_t obj, BOOL fLiteral, const int length)
     }
     
     DWORD_PTR dwAddr = (DWORD_PTR)pwszBuf.GetPtr();
-    if (g_sos->GetObjectStringData(TO_CDADDR(obj), stInfo.m_StringLength+1, pwszBuf, NULL)!=S_OK)
+    if (!sos::Object::ReadStringData((TADDR)obj, stInfo.m_StringLength, pwszBuf, stInfo.m_StringLength+1))
     {
         ExtOut("Error getting string data\n");
         return;
@@ -4038,6 +4735,35 @@ void ResetGlobals(void)
     g_sos->GetUsefulGlobals(&g_special_usefulGlobals);
     g_special_mtCache.Clear();
     g_special_rvCacheSpace.Clear();
+
+    // A dump never changes underneath us, so the shared page cache survives
+    // across commands there; a live process may have run since the last stop.
+    if (!IsDumpFile())
+    {
+        InvalidateCachedReadVirtual();
+        ClearMethodTableNameCache();
+        ClearMethodDescNameCache();
+        ClearStringPool();
+        ClearTypeNameIndex();
+        ClearModuleImportCache();
+        ClearSigFormatMemo();
+        ClearDomainModuleTree();
+        ClearThreadStoreSnapshot();
+        ClearEHInfoCache();
+        ClearGCInfoDumpCache();
+        ClearILAddressMapCache();
+        ClearCallTargetMemo();
+        ClearPointerClassificationCache();
+        ClearFieldLayoutCache();
+        ClearDumpHeapCheckpoint();
+        ClearAsyncRecordIndex();
+        ClearFrameArgNameMemo();
+        ClearHandleTableSnapshot();
+        ClearDependentHandleMap();
+        ClearCodeHeapRangeIndex();
+        g_snapshot.Clear();
+    }
+
     Output::ResetIndent();
 }
 
@@ -4123,6 +4849,14 @@ HRESULT LoadClrDebugDll(void)
         g_sos = NULL;
         return hr;
     }
+
+    // While the profiler is enabled, hand the command the counting proxy so
+    // "!sosperf -dac" can attribute time to individual DAC requests.  The
+    // proxy owns the reference just taken and is released in its place.
+    if (g_sosPerfEnabled)
+    {
+        g_sos = WrapSOSDacPerfProxy(g_sos);
+    }
     return S_OK;
 }
 
@@ -4492,6 +5226,10 @@ public:
         {
             return E_UNEXPECTED;
         }
+
+        // Writes make cached pages stale.
+        InvalidateCachedReadVirtual();
+
         return g_ExtData->WriteVirtual(address, (PVOID)pBuffer, bytesRequested, NULL);
     }
 
@@ -4828,6 +5566,252 @@ void GetAllocContextPtrs(AllocInfo *pallocInfo)
     }
 }
 
+// The process-wide page cache shared by the DAC's data target and the MOVE
+// refill path.  Both sides read the same pages of the same stopped target,
+// so a page one of them has already paid for serves the other.  For dump
+// targets the backing store never changes; for live targets the cache is
+// dropped on every command entry (ResetGlobals), the point at which the
+// process may have run.
+static const ULONG kSharedCachePageSize = 0x1000;
+static const int kSharedCachePageCount = 64;
+
+struct SharedCachePage
+{
+    TADDR Base;
+    ULONG Size;          // valid bytes; 0 marks an empty slot
+    ULONG64 LastUsed;
+    ULONG64 Generation;  // pages from older generations are stale
+    BYTE Data[kSharedCachePageSize];
+};
+
+static SharedCachePage g_sharedCachePages[kSharedCachePageCount];
+static ULONG64 g_sharedCacheClock = 0;
+static ULONG64 g_sharedCacheGeneration = 1;
+
+void InvalidateCachedReadVirtual()
+{
+    // O(1): pages stamped with an older generation no longer match and get
+    // recycled by the eviction scan.
+    g_sharedCacheGeneration++;
+}
+
+static SharedCachePage *FindSharedCachePage(TADDR base)
+{
+    for (int i = 0; i < kSharedCachePageCount; i++)
+    {
+        if (g_sharedCachePages[i].Size != 0 &&
+            g_sharedCachePages[i].Generation == g_sharedCacheGeneration &&
+            g_sharedCachePages[i].Base == base)
+        {
+            return &g_sharedCachePages[i];
+        }
+    }
+
+    return NULL;
+}
+
+static SharedCachePage *EvictSharedCachePage()
+{
+    // Prefer a stale page if there is one, otherwise the least recently used.
+    SharedCachePage *page = &g_sharedCachePages[0];
+    for (int i = 0; i < kSharedCachePageCount; i++)
+    {
+        if (g_sharedCachePages[i].Generation != g_sharedCacheGeneration)
+        {
+            page = &g_sharedCachePages[i];
+            break;
+        }
+        if (g_sharedCachePages[i].LastUsed < page->LastUsed)
+            page = &g_sharedCachePages[i];
+    }
+
+    return page;
+}
+
+static SharedCachePage *FillSharedCachePage(TADDR base)
+{
+    SharedCachePage *page = EvictSharedCachePage();
+
+    page->Size = 0;
+
+    ULONG read = 0;
+
+    g_readStats.Calls++;
+    g_readStats.BytesRequested += kSharedCachePageSize;
+
+    if (FAILED(g_ExtData->ReadVirtual(TO_CDADDR(base), page->Data, kSharedCachePageSize, &read)) || read == 0)
+        return NULL;
+
+    g_readStats.BytesRead += read;
+
+    page->Base = base;
+    page->Size = read;
+    page->LastUsed = ++g_sharedCacheClock;
+    page->Generation = g_sharedCacheGeneration;
+    return page;
+}
+
+void PrefetchCachedReadVirtual(CLRDATA_ADDRESS address, ULONG64 size)
+{
+    // Staging more than half the cache would evict pages the caller is still
+    // using for unrelated state.
+    static const ULONG64 kMaxPrefetch = (kSharedCachePageCount / 2) * (ULONG64)kSharedCachePageSize;
+
+    TADDR start = TO_TADDR(address) & ~((TADDR)(kSharedCachePageSize - 1));
+    TADDR end = TO_TADDR(address) + size;
+    if (size == 0 || end <= start)
+        return;
+    if ((ULONG64)(end - start) > kMaxPrefetch)
+        end = start + (TADDR)kMaxPrefetch;
+
+    ULONG cb = (ULONG)(((end - start) + kSharedCachePageSize - 1) & ~((TADDR)(kSharedCachePageSize - 1)));
+
+    BYTE *buffer = new BYTE[cb];
+    if (buffer == NULL)
+        return;
+
+    ULONG read = 0;
+
+    g_readStats.Calls++;
+    g_readStats.BytesRequested += cb;
+
+    if (FAILED(g_ExtData->ReadVirtual(TO_CDADDR(start), buffer, cb, &read)))
+        read = 0;
+
+    g_readStats.BytesRead += read;
+
+    for (ULONG offset = 0; offset < read; offset += kSharedCachePageSize)
+    {
+        TADDR base = start + offset;
+        if (FindSharedCachePage(base) != NULL)
+            continue;
+
+        SharedCachePage *page = EvictSharedCachePage();
+
+        ULONG chunk = read - offset;
+        if (chunk > kSharedCachePageSize)
+            chunk = kSharedCachePageSize;
+
+        memcpy(page->Data, buffer + offset, chunk);
+        page->Base = base;
+        page->Size = chunk;
+        page->LastUsed = ++g_sharedCacheClock;
+        page->Generation = g_sharedCacheGeneration;
+    }
+
+    delete [] buffer;
+}
+
+HRESULT UncachedReadVirtual(CLRDATA_ADDRESS address, PVOID buffer, ULONG size, PULONG bytesRead)
+{
+    SOSSampleCheckpoint();
+
+    // Call sites that inspect memory the target may have just changed (live
+    // process state, patched breakpoints) must not be answered from a cached
+    // page.  Any cached page overlapping the range is dropped too, so a
+    // subsequent cached read can't resurrect the stale bytes.
+    TADDR addr = TO_TADDR(address);
+    for (int i = 0; i < kSharedCachePageCount; i++)
+    {
+        SharedCachePage *page = &g_sharedCachePages[i];
+        if (page->Size != 0 &&
+            page->Generation == g_sharedCacheGeneration &&
+            page->Base < addr + size &&
+            addr < page->Base + page->Size)
+        {
+            page->Size = 0;
+        }
+    }
+
+    ULONG read = 0;
+
+    g_readStats.Calls++;
+    g_readStats.BytesRequested += size;
+
+    HRESULT hr = g_ExtData->ReadVirtual(address, buffer, size, &read);
+    if (SUCCEEDED(hr))
+        g_readStats.BytesRead += read;
+
+    if (bytesRead != NULL)
+        *bytesRead = read;
+    return hr;
+}
+
+HRESULT CachedReadVirtual(CLRDATA_ADDRESS address, PVOID buffer, ULONG size, PULONG bytesRead)
+{
+    SOSSampleCheckpoint();
+
+    if (!g_sosFastPathsEnabled)
+        return UncachedReadVirtual(address, buffer, size, bytesRead);
+
+    TADDR addr = TO_TADDR(address);
+    ULONG total = 0;
+
+    if (size == 0)
+    {
+        if (bytesRead != NULL)
+            *bytesRead = 0;
+        return S_OK;
+    }
+
+    // Very large reads aren't worth staging a page at a time.
+    if (size <= 4 * kSharedCachePageSize)
+    {
+        while (total < size)
+        {
+            TADDR cur = addr + total;
+            TADDR base = cur & ~((TADDR)(kSharedCachePageSize - 1));
+            ULONG offset = (ULONG)(cur - base);
+            ULONG chunk = kSharedCachePageSize - offset;
+            if (chunk > size - total)
+                chunk = size - total;
+
+            g_readStats.PageReads++;
+
+            SharedCachePage *page = FindSharedCachePage(base);
+            if (page != NULL)
+                g_readStats.PageHits++;
+            else
+                page = FillSharedCachePage(base);
+
+            if (page == NULL || page->Size <= offset)
+                break;
+
+            if (chunk > page->Size - offset)
+                chunk = page->Size - offset;
+
+            page->LastUsed = ++g_sharedCacheClock;
+            memcpy((BYTE*)buffer + total, page->Data + offset, chunk);
+            total += chunk;
+
+            // A short page ends the readable range.
+            if (page->Size < kSharedCachePageSize)
+                break;
+        }
+
+        if (total != 0)
+        {
+            if (bytesRead != NULL)
+                *bytesRead = total;
+            return S_OK;
+        }
+    }
+
+    // Either the request was too large to cache or the page-granular read
+    // couldn't see the region (dumps can contain ranges smaller than a
+    // page), so issue the original request untouched.
+    g_readStats.Calls++;
+    g_readStats.BytesRequested += size;
+
+    HRESULT hr = g_ExtData->ReadVirtual(address, buffer, size, &total);
+    if (SUCCEEDED(hr))
+        g_readStats.BytesRead += total;
+
+    if (bytesRead != NULL)
+        *bytesRead = total;
+    return hr;
+}
+
 HRESULT ReadVirtualCache::Read(TADDR taOffset, PVOID Buffer, ULONG BufferSize, PULONG lpcbBytesRead)
 {
     // sign extend the passed in Offset so we can use it in when calling 
@@ -4842,25 +5826,33 @@ HRESULT ReadVirtualCache::Read(TADDR taOffset, PVOID Buffer, ULONG BufferSize, P
     if (BufferSize == 0)
         return S_OK;
 
+    if (!g_sosFastPathsEnabled)
+        return CachedReadVirtual(Offset, Buffer, BufferSize, lpcbBytesRead);
+
+    g_readStats.MoveReads++;
+
     if (BufferSize > CACHE_SIZE)
     {
-        // Don't even try with the cache
-        return g_ExtData->ReadVirtual(Offset, Buffer, BufferSize, lpcbBytesRead);
+        // Don't even try with the local cache, but still go through the
+        // shared page cache the data target fills.
+        return CachedReadVirtual(Offset, Buffer, BufferSize, lpcbBytesRead);
     }
 
     if ((m_cacheValid)
-        && (taOffset >= m_startCache) 
+        && (taOffset >= m_startCache)
         && (taOffset <= m_startCache + m_cacheSize - BufferSize))
 
     {
         // It is within the cache
         memcpy(Buffer,(LPVOID) ((ULONG64)m_cache + (taOffset - m_startCache)), BufferSize);
 
+        g_readStats.MoveHits++;
+
         if (lpcbBytesRead != NULL)
         {
            *lpcbBytesRead = BufferSize;
         }
- 
+
         return S_OK;
     }
  
@@ -4871,13 +5863,15 @@ HRESULT ReadVirtualCache::Read(TADDR taOffset, PVOID Buffer, ULONG BufferSize, P
     if (m_startCache + CACHE_SIZE < m_startCache)
         m_startCache = (TADDR)(-CACHE_SIZE);
 
-    ret = g_ExtData->ReadVirtual(TO_CDADDR(m_startCache), m_cache, CACHE_SIZE, &cbBytesRead);
+    // Refill through the shared page cache, so a page the DAC already read
+    // serves this MOVE without another trip to the debugger.
+    ret = CachedReadVirtual(TO_CDADDR(m_startCache), m_cache, CACHE_SIZE, &cbBytesRead);
     if (ret != S_OK)
     {
         return ret;
     }
-    
-    m_cacheSize = cbBytesRead;     
+
+    m_cacheSize = cbBytesRead;
     m_cacheValid = TRUE;
     memcpy(Buffer, (LPVOID) ((ULONG64)m_cache + (taOffset - m_startCache)), BufferSize);
 
@@ -4984,6 +5978,13 @@ unsigned int Output::g_Indent = 0;
 bool Output::g_bDbgOutput = false;
 bool Output::g_bDMLExposed = false;
 unsigned int Output::g_DMLEnable = 0;
+unsigned int Output::g_bufferOutput = 0;
+
+// Backing store for BufferedOutputHolder.  Allocated the first time a command
+// asks for buffering and then kept for the rest of the session.
+static const size_t kOutputBufferSize = 0x10000;
+static char* g_pOutputBuffer = NULL;
+static size_t g_outputBufferPos = 0;
 
 template <class T, int count, int size> const int StaticData<T, count, size>::Count = count;
 template <class T, int count, int size> const int StaticData<T, count, size>::Size  = size;
@@ -5125,14 +6126,143 @@ size_t CountHexCharacters(CLRDATA_ADDRESS val)
     }
 
     return ret;
-} 
+}
 
-HRESULT 
+/**********************************************************************\
+* Narrows a UTF-16 name into per-command arena memory.  The common     *
+* all-ASCII case is one vectorized pass into a single allocation; the  *
+* rare name with characters above ASCII goes through the same CP_ACP   *
+* conversion %S formatting would have applied.  The result lives until *
+* the command returns and is never NULL.                               *
+\**********************************************************************/
+const char *WideToNarrowArena(const WCHAR *wide)
+{
+    if (wide == NULL)
+        return "";
+
+    size_t len = _wcslen(wide);
+    char *narrow = (char *)g_commandArena.Alloc(len + 1);
+    if (narrow == NULL)
+        return "";
+
+    if (ScanNarrowAscii(wide, len, narrow))
+    {
+        narrow[len] = 0;
+        return narrow;
+    }
+
+    // The name has characters above ASCII; run the real conversion.  The
+    // partially written fast-path buffer is simply abandoned to the arena.
+    int size = WideCharToMultiByte(CP_ACP, 0, wide, -1, NULL, 0, NULL, NULL);
+    if (size <= 0)
+        return "";
+
+    narrow = (char *)g_commandArena.Alloc(size);
+    if (narrow == NULL || WideCharToMultiByte(CP_ACP, 0, wide, -1, narrow, size, NULL, NULL) == 0)
+        return "";
+
+    return narrow;
+}
+
+/**********************************************************************\
+* Hands the batched output to the debugger in a single callback.  Safe *
+* to call at any time; does nothing if no output is pending.  Long     *
+* running commands that buffer their output can call this at natural   *
+* boundaries so the user is not left staring at a blank screen.        *
+\**********************************************************************/
+void Output::FlushOutput()
+{
+    if (g_outputBufferPos > 0 && g_ExtControl != NULL)
+    {
+        g_pOutputBuffer[g_outputBufferPos] = 0;
+        g_outputBufferPos = 0;
+        g_ExtControl->Output(DEBUG_OUTPUT_NORMAL, "%s", g_pOutputBuffer);
+    }
+}
+
+/**********************************************************************\
+* Appends already formatted text to the output buffer, bypassing the   *
+* printf machinery entirely.  This is the sink for TableWriter rows    *
+* and the column formatter's cells; when buffering is off the text     *
+* falls back through the normal output path.                           *
+\**********************************************************************/
+void Output::OutputRawText(__in_z PCSTR text, size_t length)
+{
+    if (IsOutputSuppressed() || length == 0)
+        return;
+
+    if (!IsOutputBuffered())
+    {
+        OutputText(DEBUG_OUTPUT_NORMAL, "%.*s", (int)length, text);
+        return;
+    }
+
+    while (length > 0)
+    {
+        // Leave room for the flush's NULL terminator.
+        size_t room = kOutputBufferSize - g_outputBufferPos - 1;
+        if (room == 0)
+        {
+            FlushOutput();
+            continue;
+        }
+
+        size_t copy = length < room ? length : room;
+        memcpy(g_pOutputBuffer + g_outputBufferPos, text, copy);
+        g_outputBufferPos += copy;
+        text += copy;
+        length -= copy;
+    }
+}
+
+// Formats directly into the free tail of the output buffer, flushing to the
+// debugger only when a message no longer fits.  This is what turns the one
+// callback per line under !dumpheap and friends into one per 64K of text.
+static HRESULT BufferOutputVaList(PCSTR format, va_list args)
+{
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+
+    // Leave room for the flush's NULL terminator.
+    if (kOutputBufferSize - g_outputBufferPos < 2)
+        Output::FlushOutput();
+
+    int length = _vsnprintf_s(g_pOutputBuffer + g_outputBufferPos, kOutputBufferSize - g_outputBufferPos - 1, _TRUNCATE, format, args);
+    if (length < 0)
+    {
+        // The message did not fit in the remaining space; flush and format
+        // again into the empty buffer.
+        Output::FlushOutput();
+        length = _vsnprintf_s(g_pOutputBuffer, kOutputBufferSize - 1, _TRUNCATE, format, argsCopy);
+        if (length < 0)
+        {
+            // Longer than the entire buffer; keep the truncated text, which
+            // matches the fixed-size formatting caps of the unbuffered paths.
+            length = (int)strlen(g_pOutputBuffer);
+        }
+    }
+    va_end(argsCopy);
+
+    g_outputBufferPos += length;
+    return S_OK;
+}
+
+HRESULT
 OutputVaList(
     ULONG mask,
     PCSTR format,
     va_list args)
 {
+    if (Output::IsOutputBuffered())
+    {
+        if (mask == DEBUG_OUTPUT_NORMAL)
+        {
+            return BufferOutputVaList(format, args);
+        }
+        // Warnings and errors bypass the buffer; flush first so they appear
+        // in order with the surrounding text.
+        Output::FlushOutput();
+    }
 #ifndef FEATURE_PAL
     if (IsInitializedByDbgEng())
     {
@@ -5195,6 +6325,9 @@ void DMLOut(PCSTR format, ...)
 #ifndef FEATURE_PAL
     if (IsDMLEnabled() && !Output::IsDMLExposed())
     {
+        // DML goes straight to the debugger; flush any batched plain text
+        // first to keep the output in order.
+        Output::FlushOutput();
         g_ExtControl->ControlledOutputVaList(DEBUG_OUTCTL_AMBIENT_DML, DEBUG_OUTPUT_NORMAL, format, args);
     }
     else
@@ -5216,6 +6349,7 @@ void IfDMLOut(PCSTR format, ...)
     
     va_start(args, format);
     ExtOutIndent();
+    Output::FlushOutput();
     g_ExtControl->ControlledOutputVaList(DEBUG_OUTCTL_AMBIENT_DML, DEBUG_OUTPUT_NORMAL, format, args);
     va_end(args);
 #endif
@@ -5271,6 +6405,102 @@ void ExtDbgOut(PCSTR Format, ...)
 #endif
 }
 
+void JsonWriter::BeginRecord(const char* kind)
+{
+    mBuffer.clear();
+    mBuffer += "{\"kind\":\"";
+    mBuffer += kind;
+    mBuffer += '"';
+}
+
+void JsonWriter::EndRecord()
+{
+    mBuffer += '}';
+    ExtOut("%s\n", mBuffer.c_str());
+}
+
+void JsonWriter::BeginField(const char* name)
+{
+    // "kind" is always written first, so every field needs the comma.
+    mBuffer += ",\"";
+    mBuffer += name;
+    mBuffer += "\":";
+}
+
+void JsonWriter::AppendEscaped(const char* value)
+{
+    mBuffer += '"';
+    for (const char* ptr = value; *ptr; ++ptr)
+    {
+        char c = *ptr;
+        if (c == '"' || c == '\\')
+        {
+            mBuffer += '\\';
+            mBuffer += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char escape[8];
+            sprintf_s(escape, _countof(escape), "\\u%04x", c);
+            mBuffer += escape;
+        }
+        else
+        {
+            mBuffer += c;
+        }
+    }
+    mBuffer += '"';
+}
+
+void JsonWriter::Field(const char* name, const char* value)
+{
+    BeginField(name);
+    AppendEscaped(value == NULL ? "" : value);
+}
+
+void JsonWriter::Field(const char* name, const WCHAR* value)
+{
+    if (value == NULL)
+    {
+        Field(name, "");
+        return;
+    }
+
+    // Type and symbol names routinely contain characters above ASCII;
+    // convert to UTF-8 so the record stays valid JSON.
+    std::string utf8;
+    int length = WideCharToMultiByte(CP_UTF8, 0, value, -1, NULL, 0, NULL, NULL);
+    if (length > 0)
+    {
+        utf8.resize(length);
+        WideCharToMultiByte(CP_UTF8, 0, value, -1, &utf8[0], length, NULL, NULL);
+        utf8.resize(length - 1);    // drop the terminator
+    }
+    Field(name, utf8.c_str());
+}
+
+void JsonWriter::Field(const char* name, ULONG64 value)
+{
+    char buffer[32];
+    sprintf_s(buffer, _countof(buffer), "%I64u", value);
+    BeginField(name);
+    mBuffer += buffer;
+}
+
+void JsonWriter::FieldBool(const char* name, bool value)
+{
+    BeginField(name);
+    mBuffer += value ? "true" : "false";
+}
+
+void JsonWriter::FieldHex(const char* name, ULONG64 value)
+{
+    char buffer[32];
+    sprintf_s(buffer, _countof(buffer), "\"0x%I64x\"", value);
+    BeginField(name);
+    mBuffer += buffer;
+}
+
 const char * const DMLFormats[] =
 {
     NULL,                                           // DML_None (do not use)
@@ -5300,15 +6530,75 @@ void ConvertToLower(__out_ecount(len) char *buffer, size_t len)
         buffer[i] = (char)tolower(buffer[i]);
 }
 
-/* Build a hex display of addr.
+/* Build a hex display of addr with a dedicated emitter; this sits under
+ * every DML link and every hex table cell, so it must not pay for printf
+ * format processing.  With fill the value is zero filled to pointer width;
+ * without it the value keeps the 32 bit truncation %x always gave it.
  */
 int GetHex(CLRDATA_ADDRESS addr, __out_ecount(len) char *out, size_t len, bool fill)
 {
-    int count = sprintf_s(out, len, fill ? "%p" : "%x", (size_t)addr);
-    
-    ConvertToLower(out, len);
-    
-    return count;
+    static const char digits[] = "0123456789abcdef";
+
+    size_t val = fill ? (size_t)addr : (ULONG)(size_t)addr;
+    char buffer[sizeof(size_t)*2];
+    int count = 0;
+
+    do
+    {
+        buffer[count++] = digits[val & 0xf];
+        val >>= 4;
+    } while (val != 0);
+
+    int pos = 0;
+    if (fill)
+    {
+        for (int i = count; i < (int)sizeof(void*)*2 && (size_t)pos < len-1; ++i)
+            out[pos++] = '0';
+    }
+
+    while (count > 0 && (size_t)pos < len-1)
+        out[pos++] = buffer[--count];
+
+    out[pos] = 0;
+    return pos;
+}
+
+/* Build the %p form of addr: zero filled to pointer width, upper case.
+ * This is what the column formatter's pointer cells have always printed.
+ */
+int GetPointerHex(CLRDATA_ADDRESS addr, __out_ecount(len) char *out, size_t len)
+{
+    static const char digits[] = "0123456789ABCDEF";
+
+    size_t val = (size_t)addr;
+    int pos = 0;
+
+    for (int shift = (int)sizeof(void*)*8 - 4; shift >= 0 && (size_t)pos < len-1; shift -= 4)
+        out[pos++] = digits[(val >> shift) & 0xf];
+
+    out[pos] = 0;
+    return pos;
+}
+
+/* Build a decimal display of value.  The emitter twin of GetHex.
+ */
+int GetDec(ULONG64 value, __out_ecount(len) char *out, size_t len)
+{
+    char buffer[20];
+    int count = 0;
+
+    do
+    {
+        buffer[count++] = (char)('0' + (int)(value % 10));
+        value /= 10;
+    } while (value != 0);
+
+    int pos = 0;
+    while (count > 0 && (size_t)pos < len-1)
+        out[pos++] = buffer[--count];
+
+    out[pos] = 0;
+    return pos;
 }
 
 CachedString Output::BuildHexValue(CLRDATA_ADDRESS addr, FormatType type, bool fill)
@@ -5467,6 +6757,137 @@ NoOutputHolder::~NoOutputHolder()
         Output::g_bSuppressOutput--;
 }
 
+BufferedOutputHolder::BufferedOutputHolder()
+{
+    if (g_pOutputBuffer == NULL)
+    {
+        g_pOutputBuffer = new char[kOutputBufferSize];
+    }
+    // If the buffer could not be allocated the output simply stays
+    // unbuffered.
+    mEnabled = (g_pOutputBuffer != NULL);
+    if (mEnabled)
+        Output::g_bufferOutput++;
+}
+
+BufferedOutputHolder::~BufferedOutputHolder()
+{
+    if (mEnabled && --Output::g_bufferOutput == 0)
+        Output::FlushOutput();
+}
+
+WorkerOutput::WorkerOutput(int workerCount)
+{
+    mCount = workerCount;
+    mBuffers = new Buffer[workerCount];
+    if (mBuffers != NULL)
+    {
+        memset(mBuffers, 0, workerCount * sizeof(Buffer));
+    }
+    else
+    {
+        mCount = 0;
+    }
+}
+
+WorkerOutput::~WorkerOutput()
+{
+    Flush();
+    for (int i = 0; i < mCount; i++)
+        delete [] mBuffers[i].Data;
+    delete [] mBuffers;
+}
+
+BOOL WorkerOutput::Grow(Buffer &buffer, size_t needed)
+{
+    size_t capacity = buffer.Capacity == 0 ? 0x1000 : buffer.Capacity;
+    while (capacity - buffer.Pos < needed)
+        capacity *= 2;
+
+    if (capacity == buffer.Capacity)
+        return TRUE;
+
+    char *data = new char[capacity];
+    if (data == NULL)
+        return FALSE;
+
+    if (buffer.Pos > 0)
+        memcpy(data, buffer.Data, buffer.Pos);
+    delete [] buffer.Data;
+    buffer.Data = data;
+    buffer.Capacity = capacity;
+    return TRUE;
+}
+
+void WorkerOutput::Printf(int rank, PCSTR format, ...)
+{
+    if (mBuffers == NULL || rank < 0 || rank >= mCount)
+        return;
+
+    Buffer &buffer = mBuffers[rank];
+
+    // Format into the free tail, growing the buffer until the message fits.
+    for (;;)
+    {
+        if (!Grow(buffer, 2))
+        {
+            buffer.Truncated = TRUE;
+            return;
+        }
+
+        va_list args;
+        va_start(args, format);
+        int length = _vsnprintf_s(buffer.Data + buffer.Pos, buffer.Capacity - buffer.Pos - 1, _TRUNCATE, format, args);
+        va_end(args);
+
+        if (length >= 0)
+        {
+            buffer.Pos += length;
+            return;
+        }
+
+        if (!Grow(buffer, buffer.Capacity))
+        {
+            buffer.Truncated = TRUE;
+            return;
+        }
+    }
+}
+
+void WorkerOutput::Flush()
+{
+    for (int i = 0; i < mCount; i++)
+    {
+        Buffer &buffer = mBuffers[i];
+
+        // Hand the text out in chunks small enough for the buffered output
+        // layer, split at line boundaries where possible.
+        size_t pos = 0;
+        while (pos < buffer.Pos)
+        {
+            size_t chunk = buffer.Pos - pos;
+            if (chunk > 0x8000)
+            {
+                chunk = 0x8000;
+                while (chunk > 0 && buffer.Data[pos + chunk - 1] != '\n')
+                    chunk--;
+                if (chunk == 0)
+                    chunk = 0x8000;
+            }
+            ExtOut("%.*s", (int)chunk, buffer.Data + pos);
+            pos += chunk;
+        }
+
+        if (buffer.Truncated)
+        {
+            ExtErr("Worker %d output truncated: out of memory\n", i);
+            buffer.Truncated = FALSE;
+        }
+
+        buffer.Pos = 0;
+    }
+}
+
 //
 // Code to support mapping RVAs to managed code line numbers.
 //
@@ -5611,6 +7032,242 @@ ConvertNativeToIlOffset(
     return pMethodInst->GetTokenAndScope(methodToken, ppModule);
 }
 
+//
+// Annotating a disassembly with source lines resolves every native offset in
+// the method back through the DAC: an enumeration to find the method
+// instance, then a fresh SymbolReader load of the same PDB, once per
+// instruction. The method's IL address map and its loaded reader are stable
+// while the target is stopped, so keep both in a small session-scoped LRU
+// keyed by the native ranges the map itself describes.
+//
+
+struct ILAddressMapCacheEntry
+{
+    mdMethodDef MethodToken;
+    IXCLRDataModule* Module;    // AddRef'd for the life of the entry
+    SymbolReader* Reader;       // non-NULL once symbols have loaded
+    std::vector<CLRDATA_IL_ADDRESS_MAP> Map;
+    ULONG64 LastUsed;
+};
+
+const size_t kMaxILAddressMapCacheEntries = 8;
+
+static std::vector<ILAddressMapCacheEntry*>* g_pILAddressMapCache = NULL;
+static ULONG64 g_ilAddressMapCacheClock = 0;
+
+/**********************************************************************\
+* Drops the cached IL address maps and symbol readers. Call whenever   *
+* the target runs or the process changes: code can be rejitted and the *
+* cached module interfaces do not survive the DAC being flushed.      *
+\**********************************************************************/
+void ClearILAddressMapCache()
+{
+    if (g_pILAddressMapCache == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < g_pILAddressMapCache->size(); i++)
+    {
+        ILAddressMapCacheEntry* entry = (*g_pILAddressMapCache)[i];
+        if (entry->Module != NULL)
+        {
+            entry->Module->Release();
+        }
+        delete entry->Reader;
+        delete entry;
+    }
+    g_pILAddressMapCache->clear();
+}
+
+// Returns the cached entry whose native ranges cover "offset", or NULL.
+static ILAddressMapCacheEntry* FindILAddressMapEntry(ULONG64 offset)
+{
+    if (g_pILAddressMapCache == NULL)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < g_pILAddressMapCache->size(); i++)
+    {
+        ILAddressMapCacheEntry* entry = (*g_pILAddressMapCache)[i];
+        for (size_t j = 0; j < entry->Map.size(); j++)
+        {
+            if (offset >= entry->Map[j].startAddress && offset < entry->Map[j].endAddress)
+            {
+                entry->LastUsed = ++g_ilAddressMapCacheClock;
+                return entry;
+            }
+        }
+    }
+    return NULL;
+}
+
+//
+// Resolves the method instance covering "offset", fetches its complete IL
+// address map and scope, and caches them, evicting the least recently used
+// entry when the cache is full.
+static HRESULT CacheILAddressMap(ULONG64 offset, ILAddressMapCacheEntry** ppEntry)
+{
+    HRESULT Status;
+    ToRelease<IXCLRDataMethodInstance> pMethodInst(NULL);
+
+    if ((Status = GetClrMethodInstance(offset, &pMethodInst)) != S_OK)
+    {
+        return Status;
+    }
+
+    std::vector<CLRDATA_IL_ADDRESS_MAP> map(16);
+    ULONG32 mapNeeded;
+    if ((Status = pMethodInst->GetILAddressMap((ULONG32)map.size(), &mapNeeded, map.data())) != S_OK)
+    {
+        return Status;
+    }
+    if (mapNeeded > map.size())
+    {
+        map.resize(mapNeeded);
+        if ((Status = pMethodInst->GetILAddressMap(mapNeeded, &mapNeeded, map.data())) != S_OK)
+        {
+            return Status;
+        }
+        if (mapNeeded > map.size())
+        {
+            // Went around again and the answer changed, which should not be
+            // possible.
+            return E_UNEXPECTED;
+        }
+    }
+    map.resize(mapNeeded);
+
+    mdMethodDef methodToken;
+    ToRelease<IXCLRDataModule> pModule(NULL);
+    IfFailRet(pMethodInst->GetTokenAndScope(&methodToken, &pModule));
+
+    if (g_pILAddressMapCache == NULL)
+    {
+        g_pILAddressMapCache = new std::vector<ILAddressMapCacheEntry*>();
+    }
+
+    ILAddressMapCacheEntry* entry;
+    if (g_pILAddressMapCache->size() >= kMaxILAddressMapCacheEntries)
+    {
+        size_t victim = 0;
+        for (size_t i = 1; i < g_pILAddressMapCache->size(); i++)
+        {
+            if ((*g_pILAddressMapCache)[i]->LastUsed < (*g_pILAddressMapCache)[victim]->LastUsed)
+            {
+                victim = i;
+            }
+        }
+        entry = (*g_pILAddressMapCache)[victim];
+        if (entry->Module != NULL)
+        {
+            entry->Module->Release();
+        }
+        delete entry->Reader;
+        entry->Reader = NULL;
+    }
+    else
+    {
+        entry = new ILAddressMapCacheEntry();
+        entry->Reader = NULL;
+        g_pILAddressMapCache->push_back(entry);
+    }
+
+    entry->MethodToken = methodToken;
+    entry->Module = pModule.Detach();
+    entry->Map.swap(map);
+    entry->LastUsed = ++g_ilAddressMapCacheClock;
+
+    *ppEntry = entry;
+    return S_OK;
+}
+
+// Maps a native offset to an IL offset using the cached address map,
+// mirroring what ConvertNativeToIlOffset asks of the DAC.
+static HRESULT ILOffsetFromCachedMap(ILAddressMapCacheEntry* entry, ULONG64 offset, PULONG32 methodOffs)
+{
+    ULONG32 ilOffset = 0;
+    bool found = false;
+
+    for (size_t i = 0; i < entry->Map.size(); i++)
+    {
+        if (offset >= entry->Map[i].startAddress && offset < entry->Map[i].endAddress)
+        {
+            ilOffset = entry->Map[i].ilOffset;
+            found = true;
+            break;
+        }
+    }
+
+    if (!found)
+    {
+        // The DAC's per-offset query also comes up empty for addresses the
+        // map does not describe; treat those as the start of the method.
+        *methodOffs = 0;
+        return S_OK;
+    }
+
+    switch ((LONG)ilOffset)
+    {
+    case CLRDATA_IL_OFFSET_NO_MAPPING:
+        return E_NOINTERFACE;
+
+    case CLRDATA_IL_OFFSET_PROLOG:
+        // Treat all of the prologue as part of
+        // the first source line.
+        *methodOffs = 0;
+        return S_OK;
+
+    case CLRDATA_IL_OFFSET_EPILOG:
+    {
+        // Back up until we find the last real
+        // IL offset.
+        ULONG32 highestOffset = 0;
+        for (size_t i = 0; i < entry->Map.size(); i++)
+        {
+            ULONG32 il = entry->Map[i].ilOffset;
+            if (il != (ULONG32)CLRDATA_IL_OFFSET_NO_MAPPING &&
+                il != (ULONG32)CLRDATA_IL_OFFSET_PROLOG &&
+                il != (ULONG32)CLRDATA_IL_OFFSET_EPILOG &&
+                il > highestOffset)
+            {
+                highestOffset = il;
+            }
+        }
+        *methodOffs = highestOffset;
+        return S_OK;
+    }
+    }
+
+    *methodOffs = ilOffset;
+    return S_OK;
+}
+
+// Loads the symbol reader for a cached entry. Failures are not cached so
+// that symbols configured later in the session are still picked up.
+static HRESULT LoadCachedSymbolReader(ILAddressMapCacheEntry* entry)
+{
+    if (entry->Reader != NULL)
+    {
+        return S_OK;
+    }
+
+    HRESULT Status;
+    ToRelease<IMetaDataImport> pMDImport(NULL);
+    IfFailRet(entry->Module->QueryInterface(IID_IMetaDataImport, (LPVOID *) &pMDImport));
+
+    SymbolReader* reader = new SymbolReader();
+    if (FAILED(Status = reader->LoadSymbols(pMDImport, entry->Module)))
+    {
+        delete reader;
+        return Status;
+    }
+
+    entry->Reader = reader;
+    return S_OK;
+}
+
 // Based on a native offset, passed in the first argument this function
 // identifies the corresponding source file name and line number.
 HRESULT
@@ -5621,20 +7278,31 @@ GetLineByOffset(
     ___in ULONG cchFileName)
 {
     HRESULT Status = S_OK;
-    ULONG32 methodToken;
     ULONG32 methodOffs;
 
-    // Find the image, method token and IL offset that correspond to "offset"
-    ToRelease<IXCLRDataModule> pModule(NULL);
-    IfFailRet(ConvertNativeToIlOffset(offset, &pModule, &methodToken, &methodOffs));
+    ILAddressMapCacheEntry* entry = FindILAddressMapEntry(offset);
+    if (entry == NULL && CacheILAddressMap(offset, &entry) != S_OK)
+    {
+        // Methods whose address map cannot be fetched take the uncached path.
+        ULONG32 methodToken;
 
-    ToRelease<IMetaDataImport> pMDImport(NULL);
-    IfFailRet(pModule->QueryInterface(IID_IMetaDataImport, (LPVOID *) &pMDImport));
+        // Find the image, method token and IL offset that correspond to "offset"
+        ToRelease<IXCLRDataModule> pModule(NULL);
+        IfFailRet(ConvertNativeToIlOffset(offset, &pModule, &methodToken, &methodOffs));
+
+        ToRelease<IMetaDataImport> pMDImport(NULL);
+        IfFailRet(pModule->QueryInterface(IID_IMetaDataImport, (LPVOID *) &pMDImport));
+
+        SymbolReader symbolReader;
+        IfFailRet(symbolReader.LoadSymbols(pMDImport, pModule));
+
+        return symbolReader.GetLineByILOffset(methodToken, methodOffs, pLinenum, pwszFileName, cchFileName);
+    }
 
-    SymbolReader symbolReader;
-    IfFailRet(symbolReader.LoadSymbols(pMDImport, pModule));
+    IfFailRet(ILOffsetFromCachedMap(entry, offset, &methodOffs));
+    IfFailRet(LoadCachedSymbolReader(entry));
 
-    return symbolReader.GetLineByILOffset(methodToken, methodOffs, pLinenum, pwszFileName, cchFileName);
+    return entry->Reader->GetLineByILOffset(entry->MethodToken, methodOffs, pLinenum, pwszFileName, cchFileName);
 }
 
 void TableOutput::ReInit(int numColumns, int defaultColumnWidth, Alignment alignmentDefault, int indent, int padding)
@@ -5773,6 +7441,121 @@ void TableOutput::OutputIndent()
         ExtOut(GetWhitespace(mIndent));
 }
 
+void TableWriter::AddColumn(int width, Alignment align, int padding)
+{
+    SOS_Assert(mColumns < kMaxColumns);
+    SOS_Assert(width >= 0);
+    SOS_Assert(padding >= 0);
+
+    mWidths[mColumns] = width;
+    mAligns[mColumns] = align;
+    mPaddings[mColumns] = padding;
+    mColumns++;
+}
+
+void TableWriter::WritePointer(CLRDATA_ADDRESS value)
+{
+    char buffer[POINTERSIZE_BYTES*2 + 1];
+    Cell(buffer, GetHex(value, buffer, _countof(buffer), true));
+}
+
+void TableWriter::WriteHex(ULONG64 value)
+{
+    char buffer[17];
+    Cell(buffer, GetHex(value, buffer, _countof(buffer), false));
+}
+
+void TableWriter::WriteDecimal(ULONG64 value)
+{
+    char buffer[24];
+    Cell(buffer, GetDec(value, buffer, _countof(buffer)));
+}
+
+void TableWriter::WriteText(const char *text)
+{
+    Cell(text, (int)strlen(text));
+}
+
+void TableWriter::WriteHex(ULONG64 value, int width)
+{
+    char buffer[17];
+    Cell(buffer, GetHex(value, buffer, _countof(buffer), false), width, AlignRight, 0);
+}
+
+void TableWriter::WriteDecimal(ULONG64 value, int width)
+{
+    char buffer[24];
+    Cell(buffer, GetDec(value, buffer, _countof(buffer)), width, AlignRight, 0);
+}
+
+void TableWriter::EndRow()
+{
+    Append("\n", 1);
+    Output::OutputRawText(mLine, mPos);
+    mPos = 0;
+    mCurrCol = 0;
+}
+
+// Serializes a cell against the declared schema; cells past the schema are
+// emitted at their natural width.
+void TableWriter::Cell(const char *text, int length)
+{
+    if (mCurrCol < mColumns)
+        Cell(text, length, mWidths[mCurrCol], mAligns[mCurrCol], mPaddings[mCurrCol]);
+    else
+        Cell(text, length, 0, AlignRight, 0);
+}
+
+void TableWriter::Cell(const char *text, int length, int width, Alignment align, int padding)
+{
+    if (mCurrCol == 0 && mPos == 0)
+        Pad(Output::g_Indent << 2);
+
+    if (align != AlignLeft)
+        Pad(width - length);
+
+    Append(text, length);
+
+    if (align == AlignLeft)
+        Pad(width - length);
+
+    Pad(padding);
+    mCurrCol++;
+}
+
+void TableWriter::Append(const char *text, int length)
+{
+    if (mPos + length > kMaxLine)
+    {
+        // The row outgrew the line buffer; push what we have and continue.
+        Output::OutputRawText(mLine, mPos);
+        mPos = 0;
+
+        if (length > kMaxLine)
+        {
+            Output::OutputRawText(text, length);
+            return;
+        }
+    }
+
+    memcpy(mLine + mPos, text, length);
+    mPos += length;
+}
+
+void TableWriter::Pad(int count)
+{
+    while (count-- > 0)
+    {
+        if (mPos == kMaxLine)
+        {
+            Output::OutputRawText(mLine, mPos);
+            mPos = 0;
+        }
+
+        mLine[mPos++] = ' ';
+    }
+}
+
 #ifndef FEATURE_PAL
 
 PEOffsetMemoryReader::PEOffsetMemoryReader(TADDR moduleBaseAddress) :
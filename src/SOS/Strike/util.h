@@ -21,6 +21,8 @@ inline void RestoreSOToleranceState() {}
 #include <palclr.h>
 #include <metahost.h>
 #include <new>
+#include <string>
+#include <vector>
 
 #if !defined(FEATURE_PAL)
 #include <dia2.h>
@@ -37,6 +39,7 @@ inline void RestoreSOToleranceState() {}
 #include "cordebug.h"
 #include "static_assert.h"
 #include "hostcoreclr.h"
+#include "platformspecific.h"
 
 typedef LPCSTR  LPCUTF8;
 typedef LPSTR   LPUTF8;
@@ -316,10 +319,22 @@ namespace Output
     extern unsigned int g_DMLEnable;
     extern bool g_bDbgOutput;
     extern bool g_bDMLExposed;
-    
+    extern unsigned int g_bufferOutput;
+
     inline bool IsOutputSuppressed()
     { return g_bSuppressOutput > 0; }
-    
+
+    inline bool IsOutputBuffered()
+    { return g_bufferOutput > 0; }
+
+    // Pushes any batched output to the debugger.  See BufferedOutputHolder.
+    void FlushOutput();
+
+    // Appends already formatted text to the batched output with no format
+    // string processing at all.  Falls back through the normal output path
+    // when buffering is off.  See TableWriter.
+    void OutputRawText(__in_z PCSTR text, size_t length);
+
     inline void ResetIndent()
     { g_Indent = 0; }
     
@@ -425,6 +440,88 @@ private:
     BOOL mEnable;
 };
 
+// Batches normal-priority output into large chunks handed to the debugger's
+// output callback instead of one callback per line, which dominates the cost
+// of commands that print millions of lines (particularly under lldb, where
+// every callback crosses the SB API).  Output is flushed when the buffer
+// fills, when warnings/errors/DML need to interleave, when the last holder
+// goes out of scope, and whenever Output::FlushOutput() is called.
+class BufferedOutputHolder
+{
+public:
+    BufferedOutputHolder();
+    ~BufferedOutputHolder();
+
+private:
+    BOOL mEnabled;
+};
+
+// Collects formatted output from the workers of a parallel engine.  The
+// debugger output callbacks are not thread safe, so workers must never call
+// ExtOut; instead each worker formats into its own growable buffer through
+// its rank - no locking on the hot path - and once the pool has drained the
+// main thread flushes the buffers in rank order through the normal output
+// path.  Rank order is deterministic, so a command that partitions its work
+// by rank produces the same interleaving on every run.
+class WorkerOutput
+{
+public:
+    explicit WorkerOutput(int workerCount);
+    ~WorkerOutput();
+
+    // Appends printf-formatted text to the given rank's buffer.  Different
+    // ranks may append concurrently; a single rank must only be used by one
+    // thread at a time.  On allocation failure the text is dropped and the
+    // rank is marked truncated.
+    void Printf(int rank, PCSTR format, ...);
+
+    // Flushes every buffer in rank order through ExtOut and empties them.
+    // Main thread only.
+    void Flush();
+
+private:
+    struct Buffer
+    {
+        char *Data;
+        size_t Pos;
+        size_t Capacity;
+        BOOL Truncated;
+    };
+
+    BOOL Grow(Buffer &buffer, size_t needed);
+
+    Buffer *mBuffers;
+    int mCount;
+};
+
+/**********************************************************************\
+* Emits newline-delimited JSON records for the -json mode of the heavy *
+* enumeration commands.  Records are assembled with printf-style       *
+* primitives into a reused buffer (no iostreams) and each completed    *
+* record goes out through a single ExtOut, so the buffered output      *
+* layer sees one call per record rather than one per field.  Numbers   *
+* are emitted as JSON numbers; addresses travel as "0x..." strings so  *
+* consumers keep full 64-bit fidelity.                                 *
+\**********************************************************************/
+class JsonWriter
+{
+public:
+    void BeginRecord(const char* kind);
+    void EndRecord();
+
+    void Field(const char* name, const char* value);
+    void Field(const char* name, const WCHAR* value);
+    void Field(const char* name, ULONG64 value);
+    void FieldBool(const char* name, bool value);
+    void FieldHex(const char* name, ULONG64 value);
+
+private:
+    void BeginField(const char* name);
+    void AppendEscaped(const char* value);
+
+    std::string mBuffer;
+};
+
 size_t CountHexCharacters(CLRDATA_ADDRESS val);
 
 HRESULT OutputVaList(ULONG mask, PCSTR format, va_list args);
@@ -472,6 +569,8 @@ void ConvertToLower(__out_ecount(len) char *buffer, size_t len);
 
 extern const char * const DMLFormats[];
 int GetHex(CLRDATA_ADDRESS addr, __out_ecount(len) char *out, size_t len, bool fill);
+int GetPointerHex(CLRDATA_ADDRESS addr, __out_ecount(len) char *out, size_t len);
+int GetDec(ULONG64 value, __out_ecount(len) char *out, size_t len);
 
 // A simple string class for mutable strings.  We cannot use STL, so this is a stand in replacement
 // for std::string (though it doesn't use the same interface).
@@ -759,36 +858,47 @@ namespace Output
             }
             else
             {
-                int precision = GetPrecision();
+                // Serialize the cell with the dedicated emitters and pad it
+                // here; at table density the printf format processing used to
+                // cost more than producing the digits.
+                char buffer[64];
+                int length;
+
                 if (mFormat == Formats::Default || mFormat == Formats::Pointer)
                 {
-                    if (precision > width)
-                        precision = width;
-
-                    ExtOut(leftAlign ? "%-*.*p" : "%*.*p", width, precision, SOS_PTR(mValue));
+                    length = GetPointerHex((CLRDATA_ADDRESS)mValue, buffer, _countof(buffer));
                 }
-                else
+                else if (mFormat == Formats::PrefixHex)
                 {
-                    const char *format = NULL;
-                    if (mFormat == Formats::PrefixHex)
-                    {
-                        format = leftAlign ? "0x%-*.*x" : "0x%*.*x";
-                        width -= 2;
-                    }
-                    else if (mFormat == Formats::Hex)
+                    buffer[0] = '0';
+                    buffer[1] = 'x';
+                    length = 2 + GetHex((CLRDATA_ADDRESS)mValue, buffer + 2, _countof(buffer) - 2, false);
+                }
+                else if (mFormat == Formats::Hex)
+                {
+                    length = GetHex((CLRDATA_ADDRESS)mValue, buffer, _countof(buffer), false);
+                }
+                else // mFormat == Formats::Decimal
+                {
+                    __int32 value = (__int32)mValue;
+                    if (value < 0)
                     {
-                        format = leftAlign ? "%-*.*x" : "%*.*x";
+                        buffer[0] = '-';
+                        length = 1 + GetDec((ULONG64)-(__int64)value, buffer + 1, _countof(buffer) - 1);
                     }
-                    else if (mFormat == Formats::Decimal)
+                    else
                     {
-                        format = leftAlign ? "%-*.*d" : "%*.*d";
+                        length = GetDec((ULONG64)value, buffer, _countof(buffer));
                     }
+                }
 
-                    if (precision > width)
-                        precision = width;
+                if (!leftAlign)
+                    WhitespaceOut(width - length);
 
-                    ExtOut(format, width, precision, (__int32)mValue);
-                }
+                Output::OutputRawText(buffer, length);
+
+                if (leftAlign)
+                    WhitespaceOut(width - length);
             }
         }
     
@@ -850,41 +960,6 @@ namespace Output
         }
 
     private:
-        int GetPrecision() const
-        {
-            if (mFormat == Formats::Hex || mFormat == Formats::PrefixHex)
-            {
-                ULONGLONG val = mValue;
-                int count = 0;
-                while (val)
-                {
-                    val >>= 4;
-                    count++;
-                }
-
-                if (count == 0)
-                    count = 1;
-
-                return count;
-            }
-
-            else if (mFormat == Formats::Decimal)
-            {
-                T val = mValue;
-                int count = (val > 0) ? 0 : 1;
-                while (val)
-                {
-                    val /= 10;
-                    count++;
-                }
-
-                return count;
-            }
-
-            // mFormat == Formats::Pointer
-            return sizeof(int*)*2;
-        }
-
         static inline void BuildDML(__out_ecount(len) char *result, int len, CLRDATA_ADDRESS value, Formats::Format format, Output::FormatType dmlType)
         {
             BuildDMLCol(result, len, value, format, dmlType, true, 0);
@@ -1379,6 +1454,76 @@ private:
     Alignment *mAlignments;
 };
 
+/* A light weight columnar row writer for the heavy enumeration commands.
+ * TableOutput pushes every cell through a printf round trip; at millions of
+ * rows the format string processing itself dominates the command.  With
+ * TableWriter the schema is declared once up front (column width, alignment,
+ * inter-column padding), then each row is appended as typed cells that
+ * serialize with the dedicated integer/hex emitters straight into a line
+ * buffer, and the completed row reaches the buffered output layer in a
+ * single append.  The writer produces plain text only: callers that support
+ * DML keep their DMLOut row path and use this class when DML is disabled.
+ */
+class TableWriter
+{
+public:
+    TableWriter()
+        : mColumns(0), mCurrCol(0), mPos(0)
+    {
+    }
+
+    /* Declares the next column of the schema, left to right.  Call once per
+     * column, before the first row.
+     * Params:
+     *   width - the minimum width of the column; cells are padded to it and
+     *           never truncated
+     *   align - whether cells are left or right justified within the column
+     *   padding - the amount of whitespace emitted after the column; pass 0
+     *             for columns a row may end on
+     */
+    void AddColumn(int width, Alignment align = AlignRight, int padding = 1);
+
+    /* The typed cells, written left to right.  Pointer cells are zero filled
+     * to pointer width like %p; hex and decimal cells are space padded to the
+     * column width.  Cells written past the declared schema are emitted at
+     * their natural width with no padding, which lets a fixed set of leading
+     * columns carry a free-form tail.
+     */
+    void WritePointer(CLRDATA_ADDRESS value);
+    void WriteHex(ULONG64 value);
+    void WriteDecimal(ULONG64 value);
+    void WriteText(const char *text);
+
+    /* Width-carrying variants for tail cells the schema does not describe.
+     * The value is right justified in the given width.
+     */
+    void WriteHex(ULONG64 value, int width);
+    void WriteDecimal(ULONG64 value, int width);
+
+    /* Terminates the current row and hands the whole line to the output
+     * buffer in one append.
+     */
+    void EndRow();
+
+private:
+    void Cell(const char *text, int length);
+    void Cell(const char *text, int length, int width, Alignment align, int padding);
+    void Append(const char *text, int length);
+    void Pad(int count);
+
+private:
+    static const int kMaxColumns = 16;
+    static const int kMaxLine = 512;
+
+    int mColumns;
+    int mCurrCol;
+    int mPos;
+    int mWidths[kMaxColumns];
+    Alignment mAligns[kMaxColumns];
+    int mPaddings[kMaxColumns];
+    char mLine[kMaxLine];
+};
+
 HRESULT GetMethodDefinitionsFromName(DWORD_PTR ModulePtr, IXCLRDataModule* mod, const char* name, IXCLRDataMethodDefinition **ppMethodDefinitions, int numMethods, int *numMethodsNeeded);
 HRESULT GetMethodDescsFromName(DWORD_PTR ModulePtr, IXCLRDataModule* mod, const char* name, DWORD_PTR **pOut, int *numMethodDescs);
 
@@ -1393,6 +1538,39 @@ int GetObjFieldOffset(CLRDATA_ADDRESS cdaObj, __in_z LPCWSTR wszFieldName, BOOL
 int GetObjFieldOffset(CLRDATA_ADDRESS cdaObj, CLRDATA_ADDRESS cdaMT, __in_z LPCWSTR wszFieldName, BOOL bFirst=TRUE, DacpFieldDescData* pDacpFieldDescData=NULL);
 int GetValueFieldOffset(CLRDATA_ADDRESS cdaMT, __in_z LPCWSTR wszFieldName, DacpFieldDescData* pDacpFieldDescData);
 
+// One field of a cached layout.  The names come from the interning pool, so
+// they stay valid until the target can run again and must not be freed.
+struct CachedFieldInfo
+{
+    DacpFieldDescData Desc;     // the raw field desc, for value display
+    int OwnerIndex;             // index into CachedFieldLayout::Owners
+    const WCHAR *Name;          // interned field name
+    const WCHAR *TypeName;      // interned type name, as the type column shows it
+};
+
+// The flattened field layout of a type: the parent chain's fields first, in
+// the order the metadata hands them out, which is the order !dumpobj prints
+// them.  Statics are resolved per display (their values live outside the
+// object), but the metadata behind each row is fetched only once per type.
+struct CachedFieldLayout
+{
+    std::vector<DacpMethodTableData> Owners;    // the parent chain, base type first
+    std::vector<CachedFieldInfo> Fields;        // display order
+};
+
+/* Returns the field layout of a type from the session-level layout cache,
+ * walking the FieldDesc chain and the metadata on the first request only.
+ * Dumping the N-th instance of a type then costs one object read and no
+ * metadata requests.  Returns NULL if the layout cannot be read.
+ */
+const CachedFieldLayout *GetFieldLayout(CLRDATA_ADDRESS cdaMT);
+
+/* Forgets every cached field layout.  Called on command entry for live
+ * targets, where types may have been loaded or unloaded since the last
+ * stop.
+ */
+void ClearFieldLayoutCache();
+
 BOOL IsValidToken(DWORD_PTR ModuleAddr, mdTypeDef mb);
 void NameForToken_s(DacpModuleData *pModule, mdTypeDef mb, __out_ecount (capacity_mdName) WCHAR *mdName, size_t capacity_mdName, 
                   bool bClassName=true);
@@ -1449,6 +1627,7 @@ SafeReadMemory (TO_TADDR(src), &(dst), sizeof(dst), NULL)
 extern "C" PDEBUG_DATA_SPACES g_ExtData;
 
 #include <arrayholder.h>
+#include <liteholder.h>
 
 // This class acts a smart pointer which calls the Release method on any object
 // you place in it when the ToRelease class falls out of scope.  You may use it
@@ -1570,7 +1749,55 @@ inline BOOL SafeReadMemory (CLRDATA_ADDRESS offset, PVOID lpBuffer, ULONG cb, PU
 BOOL NameForMD_s (DWORD_PTR pMD, __out_ecount (capacity_mdName) WCHAR *mdName, size_t capacity_mdName);
 BOOL NameForMT_s (DWORD_PTR MTAddr, __out_ecount (capacity_mdName) WCHAR *mdName, size_t capacity_mdName);
 
-WCHAR *CreateMethodTableName(TADDR mt, TADDR cmt = NULL);
+/* Returns the canonical copy of a string from the session-wide interning
+ * pool, adding it on first sight.  The pool is hash-consed: two equal
+ * strings always intern to the same pointer, so interned names compare
+ * with a pointer comparison.  The returned pointer stays valid until the
+ * target can run again and must not be freed.
+ */
+const WCHAR *InternString(const WCHAR *str);
+
+/* Frees every pooled string.  Called (alongside the caches handing out
+ * pooled pointers) on command entry for live targets.
+ */
+void ClearStringPool();
+
+/* Returns the name of a MethodTable from the session-level name cache,
+ * resolving it through the DAC on the first request only.  The returned
+ * pointer comes from the interning pool: it stays valid until the target
+ * can run again and must not be freed.  Returns NULL if the DAC cannot
+ * name the type.
+ */
+const WCHAR *GetInternedMethodTableName(TADDR mt, TADDR cmt = NULL);
+
+/* Forgets every MethodTable-to-name mapping.  Called on command entry for
+ * live targets, where types may have been loaded or unloaded since the
+ * last stop.
+ */
+void ClearMethodTableNameCache();
+
+/* Streams the MethodTable name cache in and out of the !sossnapshot session
+ * file.  Enumeration passes the raw cache key (the MethodTable address, low
+ * bit set for array-of names) and the interned name, which is NULL for a
+ * cached resolution failure.  Import interns the name and never overwrites
+ * an entry the session already resolved.
+ */
+void EnumMethodTableNameCache(void (*fn)(TADDR key, const WCHAR *name, void *state), void *state);
+void ImportMethodTableName(TADDR key, const WCHAR *name);
+
+/* Returns the name of a MethodDesc from the session-level name cache,
+ * resolving it through the DAC on the first request only.  Stack-trace
+ * decoding resolves the same MethodDescs over and over, so the name lands
+ * in the interning pool; the returned pointer stays valid until the
+ * target can run again and must not be freed.  Returns NULL if the DAC
+ * cannot name the method.
+ */
+const WCHAR *GetInternedMethodDescName(TADDR md);
+
+/* Forgets every MethodDesc-to-name mapping.  Called on command entry for
+ * live targets alongside the MethodTable name cache.
+ */
+void ClearMethodDescNameCache();
 
 void isRetAddr(DWORD_PTR retAddr, DWORD_PTR* whereCalled);
 DWORD_PTR GetValueFromExpression (___in __in_z const char *const str);
@@ -1588,6 +1815,7 @@ void DomainInfo(DacpAppDomainData *pDomain);
 void AssemblyInfo(DacpAssemblyData *pAssembly);
 DWORD_PTR LoaderHeapInfo(CLRDATA_ADDRESS pLoaderHeapAddr, DWORD_PTR *wasted = 0);
 DWORD_PTR JitHeapInfo();
+void PrintCodeHeapStats();
 DWORD_PTR VSDHeapInfo(CLRDATA_ADDRESS appDomain, DWORD_PTR *wasted = 0);
 
 DWORD GetNumComponents(TADDR obj);
@@ -1610,24 +1838,34 @@ BOOL GCHeapUsageStats(const DacpGcHeapDetails& heap, BOOL bIncUnreachable, HeapU
 class HeapStat
 {
 protected:
-    struct Node
+    // Statistics accumulate into entries allocated in fixed-size chunks, so
+    // growing the hash table below never moves (or copies) an entry.
+    struct Entry
     {
         DWORD_PTR data;
         DWORD count;
         size_t totalSize;
-        Node* left;
-        Node* right;
-        Node ()
-            : data(0), count(0), totalSize(0), left(NULL), right(NULL)
-        {
-        }
     };
+
+    static const size_t kEntriesPerChunk = 0x1000;
+    static const size_t kInitialBuckets = 0x2000;   // must be a power of 2
+
     BOOL bHasStrings;
-    Node *head;
-    BOOL fLinear;
+    BOOL bWorkerMode;               // accumulating on a pool worker thread
+    BOOL bFailed;                   // an allocation failed in worker mode
+
+    std::vector<Entry*> mChunks;    // chunk-allocated entry storage
+    size_t mCount;                  // number of entries in use
+
+    // Open-addressing (linear probing) index over the chunks.  A bucket holds
+    // the entry index biased by one; 0 means the bucket is empty.
+    std::vector<size_t> mBuckets;
+
+    std::vector<Entry*> mSorted;    // built by Sort, printed by Print
+
 public:
     HeapStat ()
-        : bHasStrings(FALSE), head(NULL), fLinear(FALSE)
+        : bHasStrings(FALSE), bWorkerMode(FALSE), bFailed(FALSE), mCount(0)
     {}
     ~HeapStat()
     {
@@ -1636,7 +1874,41 @@ public:
     // TODO: Change the aSize argument to size_t when we start supporting
     // TODO: object sizes above 4GB
     void Add (DWORD_PTR aData, DWORD aSize);
+    // Adds a pre-aggregated entry, e.g. when merging the per-worker statistics
+    // of a parallel heap walk.
+    void Add (DWORD_PTR aData, size_t aTotalSize, DWORD aCount);
+    // Folds another table into this one: the key sets union, and the counts
+    // and sizes of shared keys add.  This is how the per-worker tables of the
+    // parallel walk engines collapse into one before printing.
+    void Merge (const HeapStat &other);
+    // Puts the table in worker (per-thread) accumulation mode: an allocation
+    // failure is recorded instead of reported, because a pool worker must not
+    // call into the output interfaces.  Check HasFailed() once the pool has
+    // drained; a failed table undercounted and must not be trusted.
+    void SetWorkerMode ()
+        {
+            bWorkerMode = TRUE;
+        }
+    BOOL HasFailed () const
+        {
+            return bFailed;
+        }
+    // Number of distinct entries accumulated so far.
+    size_t Count() const { return mCount; }
+    // Reads back entry i (in insertion order); used by !heapdiff to stream
+    // the accumulated table into its snapshot file.
+    void GetEntry (size_t i, DWORD_PTR &aData, DWORD &aCount, size_t &aTotalSize) const
+    {
+        Entry *entry = GetEntry(i);
+        aData = entry->data;
+        aCount = entry->count;
+        aTotalSize = entry->totalSize;
+    }
     void Sort ();
+    // Like Sort, but selects only the k largest entries by total size with a
+    // bounded min-heap, so no full sort of the statistics is needed.  Print
+    // then shows just those entries (the totals still cover every entry).
+    void SortTopK (size_t k);
     void Print (const char* label = NULL);
     void Delete ();
     void HasStrings(BOOL abHasStrings)
@@ -1645,10 +1917,20 @@ public:
         }
 private:
     int CompareData(DWORD_PTR n1, DWORD_PTR n2);
-    void SortAdd (Node *&root, Node *entry);
-    void LinearAdd (Node *&root, Node *entry);
-    void ReverseLeftMost (Node *root);
-    void Linearize();
+    size_t HashData(DWORD_PTR aData);
+    Entry *GetEntry(size_t index) const
+    {
+        return &mChunks[index / kEntriesPerChunk][index % kEntriesPerChunk];
+    }
+    // Returns the entry for aData, adding an empty one if not present.
+    // Returns NULL on allocation failure (which is reported here).
+    Entry *FindOrAdd(DWORD_PTR aData);
+    void Grow();
+    // Secondary ordering for Print: reorders runs of equal total size in
+    // mSorted by display name, resolving names only for those rows.
+    void SortTiesByName();
+    static bool AscendingSize(const Entry *e1, const Entry *e2);
+    static bool DescendingSize(const Entry *e1, const Entry *e2);
 };
 
 class CGCDesc;
@@ -1666,34 +1948,46 @@ struct MethodTableInfo
     CGCDesc* GCInfo;    // Just past GC info (which is how it is stored)
     bool  ArrayOfVC;
     TADDR LoaderAllocatorObjectHandle;
+    bool  ComponentMTKnown;   // ComponentMT has been fetched (it may be NULL)
+    TADDR ComponentMT;        // array element MethodTable, a function of the MT alone
 };
 
+// This cache is probed once per object advance during heap traversals, which
+// makes it the most-executed lookup in SOS.  It is a flat, open-addressed
+// robin-hood hash: a slot is the MethodTable address plus a pointer to the
+// info record — 16 bytes on 64-bit — so a probe run walks adjacent slots in
+// one or two cache lines instead of chasing tree nodes.  The info records
+// themselves are chunk-allocated and never move, because callers hold
+// MethodTableInfo pointers across later insertions.
 class MethodTableCache
 {
 protected:
 
-    struct Node
+    struct Slot
     {
-        DWORD_PTR data;            // This is the key (the method table pointer)
-        MethodTableInfo info;  // The info associated with this MethodTable
-        Node* left;
-        Node* right;
-        Node (DWORD_PTR aData) : data(aData), left(NULL), right(NULL)
-        {
-            info.BaseSize = 0;
-            info.ComponentSize = 0;
-            info.bContainsPointers = false;
-            info.bCollectible = false;
-            info.GCInfo = NULL;
-            info.ArrayOfVC = false;
-            info.GCInfoBuffer = NULL;
-            info.LoaderAllocatorObjectHandle = NULL;
-        }
+        DWORD_PTR data;          // This is the key (the method table pointer); 0 marks an empty slot
+        MethodTableInfo* info;   // The info associated with this MethodTable
     };
-    Node *head;
+
+    std::vector<Slot> mSlots;              // slot count is always a power of two
+    std::vector<MethodTableInfo*> mChunks; // stable backing store for the info records
+    size_t mChunkUsed;                     // entries handed out of mChunks.back()
+    size_t mCount;
+    MethodTableInfo mNullKeyInfo;          // stands in for key 0, which marks an empty slot
+
+    static const size_t kInitialSlots = 1024;
+    static const size_t kInfosPerChunk = 128;
+
+    // Fibonacci hashing: the multiply spreads the aligned low bits of a
+    // MethodTable address and the high half of the product is the best mixed.
+    static size_t HashKey(DWORD_PTR data)
+    {
+        return (size_t)(((ULONG64)data * 0x9E3779B97F4A7C15ULL) >> 32);
+    }
+
 public:
     MethodTableCache ()
-        : head(NULL)
+        : mChunkUsed(0), mCount(0), mNullKeyInfo()
     {}
     ~MethodTableCache() { Clear(); }
 
@@ -1701,10 +1995,43 @@ public:
     // Thus you must call 'IsInitialized' on the returned value before using it
     MethodTableInfo* Lookup(DWORD_PTR aData);
 
+    // Read-only probe: returns the cached info if aData is present, NULL
+    // otherwise.  Unlike Lookup it never inserts, so the heap walk's inline
+    // size fast path can use it without pulling the allocation code in.
+    MethodTableInfo* Find(DWORD_PTR aData) const
+    {
+        // Key 0 never enters the table; its record is never initialized, so
+        // reporting a miss matches what the caller would conclude anyway.
+        if (mCount == 0 || aData == 0)
+            return NULL;
+
+        size_t mask = mSlots.size() - 1;
+        size_t i = HashKey(aData) & mask;
+        for (size_t dist = 0; ; i = (i + 1) & mask, dist++)
+        {
+            DWORD_PTR d = mSlots[i].data;
+            if (d == aData)
+                return mSlots[i].info;
+            if (d == 0)
+                return NULL;
+
+            // Robin-hood invariant: the occupants of a probe run are ordered
+            // by distance from their home slot, so once we pass one closer to
+            // home than we are, the key cannot appear further on.
+            if (((i + mSlots.size() - (HashKey(d) & mask)) & mask) < dist)
+                return NULL;
+        }
+    }
+
+    // Calls fn once per cached MethodTable, initialized or not; used by the
+    // !sossnapshot serializer.
+    void Enumerate(void (*fn)(DWORD_PTR mt, const MethodTableInfo &info, void *state), void *state) const;
+
     void Clear ();
 private:
-    int CompareData(DWORD_PTR n1, DWORD_PTR n2);    
-    void ReverseLeftMost (Node *root);    
+    MethodTableInfo* AllocInfo();
+    void Insert(DWORD_PTR aData, MethodTableInfo* info);
+    void Grow();
 };
 
 extern MethodTableCache g_special_mtCache;
@@ -1716,9 +2043,11 @@ struct DumpArrayFlags
     BOOL bDetail;
     LPSTR strObject;
     BOOL bNoFieldsForElement;
-    
+    BOOL bStats;
+
     DumpArrayFlags ()
-        : startIndex(0), Length((DWORD_PTR)-1), bDetail(FALSE), strObject (0), bNoFieldsForElement(FALSE)
+        : startIndex(0), Length((DWORD_PTR)-1), bDetail(FALSE), strObject (0), bNoFieldsForElement(FALSE),
+          bStats(FALSE)
     {}
     ~DumpArrayFlags ()
     {
@@ -1802,15 +2131,27 @@ struct GCHandleStatistics
 struct SegmentLookup
 {
     DacpHeapSegmentData *m_segments;
+    BOOL *m_segmentIsLarge;
+    int *m_sortedIndex;     // indexes into m_segments ordered by mem, built lazily
     int m_iSegmentsSize;
     int m_iSegmentCount;
-        
+    BOOL m_bSorted;
+
     SegmentLookup();
     ~SegmentLookup();
 
     void Clear();
-    BOOL AddSegment(DacpHeapSegmentData *pData);
+    BOOL AddSegment(DacpHeapSegmentData *pData, BOOL bLarge);
     CLRDATA_ADDRESS GetHeap(CLRDATA_ADDRESS object, BOOL& bFound);
+
+    /* Returns the index of the segment whose [mem, highAllocMark) range contains
+     * object, or -1 if no segment does.  The first lookup after a segment is
+     * added sorts the ranges, so each query is a single binary search.
+     */
+    int Find(CLRDATA_ADDRESS object);
+
+private:
+    void EnsureSorted();
 };
 
 class GCHeapSnapshot
@@ -1825,18 +2166,38 @@ private:
 public:
     GCHeapSnapshot();
 
+    /* Fetches every heap's DacpGcHeapDetails and the segment table.  The
+     * snapshot is a session cache: once built it is returned as-is until
+     * ResetGlobals clears it because the target may have run, so on a dump
+     * every heap command shares one set of per-heap detail requests.
+     */
     BOOL Build();
     void Clear();
     BOOL IsBuilt() { return m_isBuilt; }
 
     DacpGcHeapData *GetHeapData() { return &m_gcheap; }
-    
-    int GetHeapCount() { return m_gcheap.HeapCount; }    
-    
+
+    int GetHeapCount() { return m_gcheap.HeapCount; }
+
+    // The details for heap number `heap`; valid for 0..GetHeapCount()-1 once
+    // Build has succeeded (workstation GC has exactly one heap).
+    DacpGcHeapDetails *GetHeapDetails(int heap) { return m_heapDetails + heap; }
+
     DacpGcHeapDetails *GetHeap(CLRDATA_ADDRESS objectPointer);
     int GetGeneration(CLRDATA_ADDRESS objectPointer);
 
-    
+    /* Finds the segment containing objectPointer with a binary search of the
+     * snapshotted segment ranges.  Returns NULL if the address is not in the
+     * managed heap (or the snapshot has not been built); on success *pbLarge
+     * tells whether the segment belongs to the large object heap.
+     */
+    const DacpHeapSegmentData *FindSegment(CLRDATA_ADDRESS objectPointer, BOOL *pbLarge);
+
+    /* Iteration over the snapshotted segments, for callers which size data
+     * structures by segment range (see VisitedBitmap).
+     */
+    int GetSegmentCount() { return m_segments.m_iSegmentCount; }
+    const DacpHeapSegmentData *GetSegmentByIndex(int i) { return m_segments.m_segments + i; }
 };
 extern GCHeapSnapshot g_snapshot;
     
@@ -1873,7 +2234,180 @@ HRESULT GetModuleFromAddress(___in CLRDATA_ADDRESS peAddress, ___out IXCLRDataMo
 void GetInfoFromName(DWORD_PTR ModuleAddr, const char* name, mdTypeDef* retMdTypeDef=NULL);
 void GetInfoFromModule (DWORD_PTR ModuleAddr, ULONG token, DWORD_PTR *ret=NULL);
 
-    
+/* Resolves a type name (or "Type.Method") to the modules that define the
+ * type through the session-level type-name index, building the index from
+ * one pass over every loaded module's metadata on the first query.  Returns
+ * false if the name is not in the index (or the index could not be built),
+ * in which case the caller should fall back to walking every module.
+ */
+bool FindModulesForTypeName(const char *name, std::vector<DWORD_PTR> &modules);
+
+/* Discards the type-name index.  Called on command entry for live targets,
+ * where modules may have been loaded or unloaded since the last stop.
+ */
+void ClearTypeNameIndex();
+
+/* Releases the cached per-module metadata importers and their token-name
+ * memos (metadata.cpp).  Called on command entry for live targets.
+ */
+void ClearModuleImportCache();
+
+/* Discards the memoized pretty-printed generic instantiations built on top of
+ * the module import cache.  Must be dropped whenever the import cache is,
+ * since its keys use the cached module identities.
+ */
+void ClearSigFormatMemo();
+
+/* Discards the cached appdomain -> assembly -> module tree behind
+ * ModuleFromName and IsInOneDomainOnly.  Called on command entry for live
+ * targets and from the dbgeng event callbacks on module events and resume.
+ */
+void ClearDomainModuleTree();
+
+/* Discards the shared thread-store snapshot behind GetThreadList and
+ * GetCurrentManagedThread.  Called on command entry for live targets and
+ * from the dbgeng event callbacks on resume.
+ */
+void ClearThreadStoreSnapshot();
+
+struct SOSEHInfo;
+
+/* Returns the gathered EH clause table for a jitted method, decoding it
+ * through the DAC on the first request and caching it by MethodDesc for the
+ * rest of the session.  The returned table is owned by the cache and must not
+ * be freed.  Returns NULL and passes the traverse HRESULT out through pStatus
+ * on failure; failures are not cached, so an interrupted gather is retried.
+ */
+SOSEHInfo *GetEHInfoForMethod(DWORD_PTR methodDesc, CLRDATA_ADDRESS nativeCodeAddr, HRESULT *pStatus = NULL);
+
+/* Discards the cached EH clause tables.  Called on command entry for live
+ * targets, where methods may have been jitted or rejitted since the last
+ * stop, and from the dbgeng event callbacks on resume.
+ */
+void ClearEHInfoCache();
+
+/* Discards the cached formatted GC info dumps behind !gcinfo.  Invalidated
+ * alongside the EH clause tables for the same reasons.
+ */
+void ClearGCInfoDumpCache();
+
+/* Discards the cached per-method IL address maps and loaded symbol readers
+ * behind source-line annotation.  Invalidated alongside the EH clause tables
+ * for the same reasons.
+ */
+void ClearILAddressMapCache();
+
+/* Discards the memoized call-target resolutions (callee -> MethodDesc and
+ * callee -> symbol) used by the disassembly walkers.  Invalidated alongside
+ * the EH clause tables for the same reasons.
+ */
+void ClearCallTargetMemo();
+
+/* Discards the saved position and partial statistics of an interrupted
+ * !dumpheap walk (see "!dumpheap -resume").  The heap may have moved under a
+ * live target since the interrupt, so the checkpoint only survives across
+ * commands against a dump.
+ */
+void ClearDumpHeapCheckpoint();
+
+/* Discards the async record graph !dumpasync materializes on its first use
+ * (one node per task with its state flags and continuation edges), which later
+ * invocations query with different filters without re-walking the heap.  Tasks
+ * complete and continuations re-link as soon as a live target runs, so the
+ * index only survives across commands against a dump.
+ */
+void ClearAsyncRecordIndex();
+
+/* Discards the per-MethodDesc argument-name memo behind !clrstack -p, which
+ * lets repeated methods skip the per-frame signature parse.  The names are
+ * interned, so the memo clears alongside the string pool on live command
+ * entry.
+ */
+void ClearFrameArgNameMemo();
+
+/* Discards the resolved handle table !gchandles caches on its first use so
+ * later runs with different filters render without re-enumerating the table.
+ * Handles are created and destroyed whenever a live target runs, so the
+ * snapshot only survives across commands against a dump.
+ */
+void ClearHandleTableSnapshot();
+
+/* Discards the dependent handle map the rooting commands build on their first
+ * use (primary object -> secondaries, with a bloom filter in front for the
+ * common no-hit lookup).  Dependent handles are created and destroyed
+ * whenever a live target runs, so the map only survives across commands
+ * against a dump.
+ */
+void ClearDependentHandleMap();
+
+/* One range of a JIT code heap, tagged with the heap flavor it came from.
+ * The ranges are captured once per session from the JIT manager's code heap
+ * list and kept sorted, so membership tests are a binary search instead of a
+ * DAC request.
+ */
+enum CodeHeapKind
+{
+    CHK_LoaderCodeHeap,     // CODEHEAP_LOADER: a LoaderCodeHeap's blocks
+    CHK_HostCodeHeap,       // CODEHEAP_HOST: code memory supplied by the host
+};
+
+struct CodeHeapRange
+{
+    TADDR Start;
+    TADDR End;
+    CodeHeapKind Kind;
+    CLRDATA_ADDRESS Manager;    // the owning jit manager
+};
+
+/* Returns the session's sorted code-heap range index, building it on first
+ * use, or NULL when the code heap lists cannot be enumerated.
+ */
+const std::vector<CodeHeapRange> *GetCodeHeapRangeIndex();
+
+/* Answers whether ip falls inside any JIT code heap.  Returns FALSE without
+ * an answer when the index is unavailable; callers fall back to probing.
+ */
+BOOL TryIsInJitCodeHeap(TADDR ip, BOOL *pInHeap);
+
+/* Discards the code-heap range index.  The JIT grows new code heaps whenever
+ * a live target runs, so the index only survives across commands against a
+ * dump.
+ */
+void ClearCodeHeapRangeIndex();
+
+/* What an address turned out to be when an annotator last probed it.  The
+ * disassembly walkers and !dumpstackobjects validate to different depths, so
+ * each side only trusts the kinds it could have produced itself; a hit on a
+ * foreign kind is treated as a miss and the address is reclassified.
+ */
+enum PointerKind
+{
+    PK_NotClassified = 1,  // probed by a disassembly walker; matched nothing
+    PK_MethodTable,
+    PK_MethodDesc,
+    PK_Object,             // passed the walkers' weak check; name is the method table name
+    PK_StringObject,       // name is the class name when filled in by !dumpstackobjects
+    PK_ValidObject,        // fully validated by !dumpstackobjects; name is the rendered annotation
+    PK_NotObject,          // fully validated by !dumpstackobjects as not displayable
+};
+
+/* Looks up the session classification for an address.  On a hit the name
+ * points into the cache and is only valid until the next insertion.
+ */
+BOOL TryGetPointerClassification(DWORD_PTR addr, PointerKind *pKind, const WCHAR **ppName);
+
+/* Records a classification, replacing any previous entry for the address.
+ * pName may be NULL when the kind carries no name.  Best effort: on
+ * allocation failure the probe simply runs again next time.
+ */
+void CachePointerClassification(DWORD_PTR addr, PointerKind kind, const WCHAR *pName);
+
+/* Discards the cached pointer classifications.  Invalidated alongside the EH
+ * clause tables for the same reasons.
+ */
+void ClearPointerClassificationCache();
+
+
 typedef void (*VISITGCHEAPFUNC)(DWORD_PTR objAddr,size_t Size,DWORD_PTR methodTable,LPVOID token);
 BOOL GCHeapsTraverse(VISITGCHEAPFUNC pFunc, LPVOID token, BOOL verify=true);
 
@@ -1910,6 +2444,7 @@ void GatherOneHeapFinalization(DacpGcHeapDetails& heapDetails, HeapStat *stat, B
 CLRDATA_ADDRESS GetAppDomainForMT(CLRDATA_ADDRESS mtPtr);
 CLRDATA_ADDRESS GetAppDomain(CLRDATA_ADDRESS objPtr);
 void GCHeapInfo(const DacpGcHeapDetails &heap, DWORD_PTR &total_size);
+void GCPrintGenerationSummary();
 BOOL GCObjInHeap(TADDR taddrObj, const DacpGcHeapDetails &heap, 
     TADDR_SEGINFO& trngSeg, int& gen, TADDR_RANGE& allocCtx, BOOL &bLarge);
 
@@ -1921,6 +2456,13 @@ BOOL VerifyObject(const DacpGcHeapDetails &heap, DWORD_PTR objAddr, DWORD_PTR MT
 BOOL IsMTForFreeObj(DWORD_PTR pMT);
 void DumpStackObjectsHelper (TADDR StackTop, TADDR StackBottom, BOOL verifyFields);
 
+/* Reads the pointer-sized slots of the stack range [top, end) into a single
+ * buffer, so a scan doesn't have to cross the debugger interface once per
+ * slot.  Returns NULL if the memory could not be read in bulk; the caller
+ * should fall back to reading slot by slot.  Free the result with delete [].
+ */
+DWORD_PTR *ReadStackSlots(TADDR top, TADDR end, size_t *count);
+
 
 enum ARGTYPE {COBOOL,COSIZE_T,COHEX,COSTRING};
 struct CMDOption
@@ -1972,6 +2514,401 @@ void CharArrayContent(TADDR pos, ULONG num, bool widechar);
 void StringObjectContent (size_t obj, BOOL fLiteral=FALSE, const int length=-1);  // length=-1: dump everything in the string object.
 
 UINT FindAllPinnedAndStrong (DWORD_PTR handlearray[],UINT arraySize);
+
+/* Drains a handle enumerator into "handles" in large batches and sorts the
+ * result by handle address, so the reads which resolve each handle to its
+ * object walk the handle table sequentially instead of seeking per handle.
+ * Returns false if the enumeration failed.
+ */
+bool FetchSortedHandleTable(ISOSHandleEnum *pEnum, std::vector<SOSHandleData> &handles);
+
+#define CACHE_SIZE  DT_OS_PAGE_SIZE
+
+struct ReadVirtualCache
+{
+    BYTE   m_cache[CACHE_SIZE];
+    TADDR  m_startCache;
+    BOOL   m_cacheValid;
+    ULONG  m_cacheSize;
+
+    ReadVirtualCache() { Clear(); }
+    HRESULT Read(TADDR Offset, PVOID Buffer, ULONG BufferSize, PULONG lpcbBytesRead);
+    void Clear() { m_cacheValid = FALSE; m_cacheSize = CACHE_SIZE; }
+};
+
+extern ReadVirtualCache *rvCache;
+
+// Counters behind !ReadStats: every path that moves target memory bumps
+// these, so a slow command can be attributed to the reads it performed.
+struct ReadVirtualStats
+{
+    ULONG64 Calls;           // ReadVirtual calls issued to the debugger
+    ULONG64 BytesRequested;  // bytes those calls asked for
+    ULONG64 BytesRead;       // bytes they returned
+    ULONG64 MoveReads;       // MOVE/moveBlock requests
+    ULONG64 MoveHits;        // ...answered from the MOVE cache
+    ULONG64 PageReads;       // LinearReadCache lookups
+    ULONG64 PageHits;        // ...answered from a cached page
+    ULONG64 PageFills;       // pages fetched into a LinearReadCache
+    ULONG64 PageEvictions;   // ...that displaced a previously cached page
+    ULONG64 BatchCalls;      // scatter-gather batches issued
+    ULONG64 BatchRanges;     // ranges those batches resolved
+
+    void Clear() { memset(this, 0, sizeof(*this)); }
+
+    // Returns true if any reads happened after the baseline was taken.
+    bool Changed(const ReadVirtualStats &since) const
+    {
+        return Calls != since.Calls || MoveReads != since.MoveReads ||
+               PageReads != since.PageReads || BatchCalls != since.BatchCalls;
+    }
+
+    // Prints the counters, relative to a baseline taken earlier.
+    void Print(const ReadVirtualStats &since) const;
+};
+
+extern ReadVirtualStats g_readStats;
+extern ReadVirtualStats g_readStatsBaseline;   // totals when the current command started
+extern BOOL g_readStatsVerbose;                // print a summary after every command
+
+// Process-wide geometry for LinearReadCache instances constructed with the
+// default arguments.  "!sosperf -cachepages/-cachesize" adjusts these for
+// dumps where the default sizing degrades into eviction churn; the new
+// geometry applies to caches created after the change (i.e. the next
+// command).
+extern ULONG g_linearCachePageSize;
+extern int   g_linearCachePageCount;
+
+// Kill switch for the session caches and read fast paths, toggled by
+// "!sosperf -fastpaths <0|1>".  The shadow mode of the regression suite runs
+// each command once with this off and once with it on and diffs the output,
+// so every optimized path has a correctness gate.
+extern BOOL g_sosFastPathsEnabled;
+
+// Opt-in per-command profiler behind !sosperf.  While enabled, the INIT_API
+// macros wrap every command in a scope that records wall and CPU time plus
+// the read counters above, prints a one-line summary when the command
+// finishes, and feeds cumulative per-command totals for "!sosperf".
+extern BOOL g_sosPerfEnabled;
+
+class SOSPerfScope
+{
+public:
+    SOSPerfScope(const char *commandName);
+    ~SOSPerfScope();
+
+private:
+    const char *mCommandName;
+    BOOL mActive;            // the profiler was enabled when the command started
+    BOOL mSampling;          // the stack sampler was armed when the command started
+    ULONG64 mWallStart;      // QueryPerformanceCounter ticks
+    ULONG64 mCpuStart;       // thread CPU time in 100ns units, 0 when unavailable
+    ReadVirtualStats mReadStart;
+    LONG64 mMemStart;        // SOSMemTotal() when the command started
+};
+
+// Prints the cumulative per-command totals collected while the profiler was
+// enabled; SOSPerfReset discards them.
+void SOSPerfReport();
+void SOSPerfReset();
+
+// Opt-in progress telemetry for long walks ("!sosperf -progress <seconds>").
+// Hot loops ping SOSProgressStep once per item; every 1024 pings the clock is
+// consulted and, once the interval has elapsed, a one-line report is printed
+// with the items visited, the bytes read so far, the address the walk is at,
+// and the instantaneous rate.  That separates a hung DAC (no lines at all)
+// from a slow walk (lines with a sinking rate).  The command prologue resets
+// the counters.
+extern BOOL g_sosProgressEnabled;
+extern size_t g_sosProgressIntervalSecs;
+extern ULONG64 g_sosProgressCount;
+
+void SOSProgressReset();
+void SOSProgressPrint(const char *phase, TADDR current);
+
+inline void SOSProgressStep(const char *phase, TADDR current)
+{
+    if (g_sosProgressEnabled && ((++g_sosProgressCount & 0x3FF) == 0))
+        SOSProgressPrint(phase, current);
+}
+
+// Byte accounting for the major allocation owners, behind "!sosperf -mem".
+// On big dumps the debugger process balloons to many gigabytes and the task
+// manager cannot say which cache owns it; every owner below reports the
+// bytes it holds at each allocation and free, and the peak is kept so a
+// since-released spike still shows up.  The counters are interlocked because
+// the parallel heap walkers allocate concurrently.
+enum SOSMemOwner
+{
+    SOSMemReadCache,    // LinearReadCache pages and read-ahead buffers
+    SOSMemHeapStat,     // HeapStat entry chunks
+    SOSMemNameCache,    // interned string pool chunks
+    SOSMemGraphIndex,   // shared address set/map tables and gcroot nodes
+    SOSMemArena,        // per-command arena blocks
+    SOSMemScratch,      // large scratch buffers for the parallel engines
+    SOSMemOwnerCount
+};
+
+struct SOSMemStats
+{
+    volatile LONG64 Current;
+    volatile LONG64 Peak;
+};
+
+extern SOSMemStats g_sosMemStats[SOSMemOwnerCount];
+
+inline void SOSMemAdd(SOSMemOwner owner, size_t bytes)
+{
+    LONG64 now = InterlockedExchangeAdd64(&g_sosMemStats[owner].Current, (LONG64)bytes) + (LONG64)bytes;
+    LONG64 peak = g_sosMemStats[owner].Peak;
+    while (now > peak)
+    {
+        LONG64 seen = InterlockedCompareExchange64(&g_sosMemStats[owner].Peak, now, peak);
+        if (seen == peak)
+            break;
+        peak = seen;
+    }
+}
+
+inline void SOSMemSub(SOSMemOwner owner, size_t bytes)
+{
+    InterlockedExchangeAdd64(&g_sosMemStats[owner].Current, -(LONG64)bytes);
+}
+
+// Current bytes across every owner; the profiler prints the per-command delta.
+LONG64 SOSMemTotal();
+void SOSMemReport();
+
+/* Allocator for the large scratch buffers of the parallel engines (segment
+ * read windows, mark frontiers).  These run to gigabytes on big dumps, so the
+ * buffers come straight from VirtualAlloc and go back to the OS on free
+ * rather than lingering in the CRT heap.  On Windows, buffers of at least the
+ * large-page minimum are tried with MEM_LARGE_PAGES first (needs
+ * SeLockMemoryPrivilege; set SOS_LARGE_PAGES=0 to disable), which cuts TLB
+ * pressure when the walkers stream through them.  There is no portable way to
+ * interleave pages across NUMA nodes from here; per-worker buffers are
+ * allocated and first touched on their worker thread, so the usual
+ * first-touch policy places them on the worker's node.
+ *
+ * Free with FreeScratchBuffer, passing the size given to AllocScratchBuffer.
+ */
+void *AllocScratchBuffer(size_t size);
+void FreeScratchBuffer(void *buffer, size_t size);
+
+/* A bump allocator whose contents live exactly as long as one command.
+ * Commands churn through thousands of short-lived strings and structs that
+ * are all dead by the time the prompt returns; individually deleting them
+ * both costs time and fragments the debugger process over a long triage
+ * session.  The arena hands out pointer-bumped memory from chained blocks
+ * and frees everything wholesale when the command finishes.
+ *
+ * Allocations are never freed individually.  Do not hand arena memory to
+ * anything that outlives the command.
+ */
+class CommandArena
+{
+public:
+    CommandArena();
+    ~CommandArena();
+
+    // Returns 16-byte aligned memory, or NULL if the block allocation
+    // failed.  The memory is valid until the enclosing command returns.
+    void *Alloc(size_t size);
+
+    // Frees every block except the first and rewinds.  Called by the
+    // command epilogue; not meant for use mid-command.
+    void Reset();
+
+    size_t BytesAllocated() const { return mBytesAllocated; }
+
+private:
+    struct Block
+    {
+        Block *next;
+        size_t used;       // bytes handed out from data
+        size_t capacity;   // size of data
+        size_t padding;    // keeps the data that follows Alignment-aligned
+        // block data follows the header
+    };
+
+    Block *NewBlock(size_t minSize);
+    static BYTE *DataOf(Block *block) { return (BYTE *)(block + 1); }
+
+    enum { BlockSize = 64 * 1024, Alignment = 16 };
+
+    Block *mHead;              // first block, kept across Reset
+    Block *mCurrent;           // block allocations come from
+    size_t mBytesAllocated;    // total handed out since the last Reset
+};
+
+extern CommandArena g_commandArena;
+
+// Installed by INIT_API_EXT; resets the arena when the outermost command
+// scope unwinds (commands that call other commands share one lifetime).
+class CommandArenaScope
+{
+public:
+    CommandArenaScope();
+    ~CommandArenaScope();
+};
+
+/* Minimal C++11 allocator over the per-command arena, for opting hot
+ * containers into wholesale-freed allocation:
+ *
+ *     std::vector<TADDR, ArenaAllocator<TADDR> > addrs;
+ *
+ * deallocate is a no-op; the memory goes away with the command.
+ */
+template <class T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    ArenaAllocator() {}
+    template <class U> ArenaAllocator(const ArenaAllocator<U> &) {}
+
+    T *allocate(size_t n)
+    {
+        void *p = g_commandArena.Alloc(n * sizeof(T));
+        if (p == NULL)
+            throw std::bad_alloc();
+        return (T *)p;
+    }
+
+    void deallocate(T *, size_t)
+    {
+    }
+
+    template <class U> bool operator==(const ArenaAllocator<U> &) const { return true; }
+    template <class U> bool operator!=(const ArenaAllocator<U> &) const { return false; }
+};
+
+/* Converts a UTF-16 name to a narrow string in per-command arena memory.
+ * Metadata names are almost always pure ASCII, and that case is a single
+ * vectorized narrowing pass into one arena allocation; anything else falls
+ * back to a real WideCharToMultiByte conversion, still into the arena.  The
+ * result is valid until the command returns and must not be freed.  Never
+ * returns NULL: a NULL input or a failed allocation yields "".
+ */
+const char *WideToNarrowArena(const WCHAR *wide);
+
+// The counting/latency shim dacperf.cpp wraps around g_sos while the
+// profiler is enabled.  WrapSOSDacPerfProxy takes over the caller's
+// reference; "!sosperf -dac" prints the per-request histograms.
+ISOSDacInterface *WrapSOSDacPerfProxy(ISOSDacInterface *real);
+void DacPerfReport();
+void DacPerfReset();
+
+// Cooperative sampling self-profiler behind "!sosperf -sample".  While
+// armed, a timer thread raises g_sosSamplePending every few milliseconds
+// and the hot paths call SOSSampleCheckpoint, which captures the calling
+// thread's own stack when a sample is due.  "!sosperf -stacks" prints the
+// collapsed-stack summary.
+extern BOOL g_sosSampleEnabled;
+extern volatile LONG g_sosSamplePending;
+
+void SOSSampleCapture();
+void SOSSampleStart();
+void SOSSampleStop();
+void SOSSampleReport();
+void SOSSampleReset();
+
+inline void SOSSampleCheckpoint()
+{
+    if (g_sosSamplePending != 0)
+        SOSSampleCapture();
+}
+
+/* A single request for ReadVirtualBatch.  Address, Buffer and Size are filled
+ * in by the caller; BytesRead and Status come back per request.
+ */
+struct ReadVirtualRange
+{
+    ULONG64 Address;
+    PVOID Buffer;
+    ULONG Size;
+    ULONG BytesRead;
+    HRESULT Status;
+};
+
+/* Reads several independent address ranges in one scatter-gather request when
+ * the debugger host supports it, falling back to a ReadVirtual loop when it
+ * does not.  Each range succeeds or fails on its own.
+ */
+void ReadVirtualBatch(ReadVirtualRange *ranges, ULONG count);
+
+/* One mapped, committed region of the target address space.
+ */
+struct MemoryRegion
+{
+    ULONG64 Base;
+    ULONG64 Size;
+    BOOL Writable;
+    BOOL Executable;
+};
+
+/* Enumerates the readable committed regions of the target address space in
+ * address order - from dbgeng's QueryVirtual walk or lldb's region list - so
+ * scanners iterate only memory that can actually be read and size their read
+ * batches to the region bounds, instead of probing the whole address space
+ * and eating read failures.  Guard pages and no-access regions are omitted.
+ * Returns FALSE when the host cannot enumerate regions at all.
+ */
+BOOL EnumReadableMemoryRegions(std::vector<MemoryRegion> &regions);
+
+/* Reads target memory through the process-wide page cache shared by the MOVE
+ * refill path and the DAC's data target, so a page either side has already
+ * paid for serves the other.  Same semantics as g_ExtData->ReadVirtual,
+ * including partial reads.
+ */
+HRESULT CachedReadVirtual(CLRDATA_ADDRESS address, PVOID buffer, ULONG size, PULONG bytesRead);
+
+/* Bypasses the shared page cache: reads straight from the debugger and drops
+ * any cached page overlapping the range.  For call sites that must observe
+ * memory the target may have just changed (live process state, patched
+ * breakpoints).
+ */
+HRESULT UncachedReadVirtual(CLRDATA_ADDRESS address, PVOID buffer, ULONG size, PULONG bytesRead);
+
+/* Invalidates the shared cache by bumping its generation counter.  Called on
+ * each command entry for live targets and whenever the engine reports an
+ * execution-state change, the points at which the process may have run.
+ */
+void InvalidateCachedReadVirtual();
+
+/* Stages [address, address + size) into the shared page cache with a single
+ * block read, so the piecemeal reads that follow are answered locally instead
+ * of costing a page-sized engine read each.  Best effort: the range is
+ * clamped to half the cache so a large region cannot evict everything else,
+ * and unreadable memory is simply left uncached.
+ */
+void PrefetchCachedReadVirtual(CLRDATA_ADDRESS address, ULONG64 size);
+
+/* Reads "count" consecutive elements of type T starting at "src" with one
+ * block read instead of a MOVE per element.  The whole array is read or the
+ * call fails; a partial read is reported as a failure so no caller consumes
+ * a half-filled buffer.
+ */
+template <class T>
+HRESULT moveArray(T *dest, TADDR src, size_t count)
+{
+    if (count == 0)
+        return S_OK;
+
+    // Reject overflowing requests before touching the target; count can come
+    // from a corrupt object header.
+    size_t size = count * sizeof(T);
+    if (size / sizeof(T) != count || size > ULONG_MAX)
+        return E_INVALIDARG;
+
+    ULONG read = 0;
+    HRESULT hr = rvCache->Read(src, dest, (ULONG)size, &read);
+    if (SUCCEEDED(hr) && read != (ULONG)size)
+        hr = E_FAIL;
+
+    return hr;
+}
 void PrintNotReachableInRange(TADDR rngStart, TADDR rngEnd, BOOL bExcludeReadyForFinalization, 
     HeapStat* stat, BOOL bShort);
 
@@ -1998,6 +2935,29 @@ HRESULT LoadClrDebugDll(void);
 extern IMetaDataImport* MDImportForModule (DacpModuleData *pModule);
 extern IMetaDataImport* MDImportForModule (DWORD_PTR pModule);
 
+/* Returns the module's IXCLRDataModule, AddRef'd for the caller, reusing the
+ * one the import cache created alongside the module's importer when it is
+ * still resident.  Callers that need both the module interface and metadata
+ * for a run of modules (the !name2ee sweep) pay for one DAC setup per module
+ * instead of two.  Returns NULL if the DAC cannot produce the interface.
+ */
+extern IXCLRDataModule* ClrDataModuleForModule(DWORD_PTR module);
+
+/* Returns the module address whose cached importer is pImport, or 0 when the
+ * importer is not (or no longer) resident in the import cache.  Use this as
+ * the identity for anything keyed off an importer: the pointer itself can be
+ * recycled once its cache entry is evicted.
+ */
+extern DWORD_PTR ModuleForCachedImport(IMetaDataImport* pImport);
+
+/* Per-module memo of the annotations !dumpil renders for metadata tokens,
+ * stored beside the module's cached importer so eviction drops both.  The
+ * returned pointer is owned by the cache and is only valid until the next
+ * insertion or eviction.
+ */
+extern bool FindCachedILTokenName(DWORD_PTR module, mdToken token, const char **ppName);
+extern void RememberILTokenName(DWORD_PTR module, mdToken token, std::string &&name);
+
 //*****************************************************************************
 //
 // **** CQuickBytes
@@ -2066,10 +3026,20 @@ public:
             return NOERROR;
         }
 
-        pbBuffNew = new BYTE[iItems + INCREMENT];
+        // Grow geometrically.  The signature pretty printers extend these
+        // buffers a few characters at a time, and growing by the fixed
+        // increment made every append on a long name pay for a fresh
+        // allocation and a full copy.  The capacity is retained until
+        // Destroy(), so an instance reused across calls (ReSize(0) between
+        // them) stops allocating once it has seen the largest name.
+        SIZE_T cbNew = cbTotal + cbTotal / 2;
+        if (cbNew < iItems + INCREMENT)
+            cbNew = iItems + INCREMENT;
+
+        pbBuffNew = new BYTE[cbNew];
         if (!pbBuffNew)
             return E_OUTOFMEMORY;
-        if (pbBuff) 
+        if (pbBuff)
         {
             memcpy(pbBuffNew, pbBuff, cbTotal);
             delete[] (BYTE*)pbBuff;
@@ -2079,11 +3049,11 @@ public:
             _ASSERTE(cbTotal == SIZE);
             memcpy(pbBuffNew, rgData, SIZE);
         }
-        cbTotal = iItems + INCREMENT;
+        cbTotal = cbNew;
         iSize = iItems;
         pbBuff = pbBuffNew;
         return NOERROR;
-        
+
     }
 
     operator PVOID()
@@ -2588,12 +3558,17 @@ HRESULT GetGCRefs(ULONG osID, SOSStackRefData **ppRefs, unsigned int *pRefCnt, S
 WString GetFrameFromAddress(TADDR frameAddr, IXCLRDataStackWalk *pStackwalk = NULL, BOOL bAssemblyName = FALSE);
 
 /* This cache is used to read data from the target process if the reads are known
- * to be sequential.
+ * to exhibit locality.  It keeps a small array of page-aligned pages and evicts
+ * the least recently used one on a miss, so alternating access patterns (for
+ * example MethodTable metadata vs object data during a heap walk) do not thrash
+ * the cache the way a single cached page does.
  */
 class LinearReadCache
 {
 public:
-    LinearReadCache(ULONG pageSize = 0x10000);
+    // Passing 0 for either parameter uses the process-wide setting
+    // (g_linearCachePageSize/g_linearCachePageCount).
+    LinearReadCache(ULONG pageSize = 0, int pageCount = 0);
     ~LinearReadCache();
 
     /* Reads an address out of the target process, caching the page of memory read.
@@ -2615,63 +3590,62 @@ public:
     {
         _ASSERTE(t);
 
-        // Unfortunately the ctor can fail the alloc for the byte array.  In this case
-        // we'll just fall back to non-cached reads.
-        if (mPage == NULL)
+        if (!g_sosFastPathsEnabled)
+            return MisalignedRead(addr, t);
+
+        g_readStats.PageReads++;
+
+        // Unfortunately the ctor can fail the alloc for the page array.  In this
+        // case we'll just fall back to non-cached reads.
+        if (mPages == NULL)
             return MisalignedRead(addr, t);
 
-        // Is addr on the current page?  If not read the page of memory addr is on.
-        // If this fails, we will fall back to a raw read out of the process (which
-        // is what MisalignedRead does).
-        if ((addr < mCurrPageStart) || (addr - mCurrPageStart > mCurrPageSize))
-            if (!update || !MoveToPage(addr))
+        // Is addr on a cached page?  If not read the page of memory addr is on.
+        // If this fails, we will fall back to a raw read out of the process
+        // (which is what MisalignedRead does).
+        TADDR base = addr & ~((TADDR)mPageSize - 1);
+        Page *page = FindPage(base);
+        if (page == NULL)
+        {
+            if (!update || (page = MoveToPage(base)) == NULL)
                 return MisalignedRead(addr, t);
+        }
 
-        // If MoveToPage succeeds, we MUST be on the right page.
-        _ASSERTE(addr >= mCurrPageStart);
-        
-        // However, the amount of data requested may fall off of the page.  In that case,
+        // The amount of data requested may fall off of the page.  In that case,
         // fall back to MisalignedRead.
-        TADDR offset = addr - mCurrPageStart;
-        if (offset + sizeof(T) > mCurrPageSize)
+        TADDR offset = addr - base;
+        if (offset + sizeof(T) > page->size)
             return MisalignedRead(addr, t);
 
-        // If we reach here we know we are on the right page of memory in the cache, and
+        // If we reach here we know the right page of memory is in the cache, and
         // that the read won't fall off of the end of the page.
 #ifdef _DEBUG
         mReads++;
 #endif
 
-        *t = *reinterpret_cast<T*>(mPage+offset);
+        g_readStats.PageHits++;
+
+        page->lastUsed = ++mClock;
+        *t = *reinterpret_cast<T*>(page->data + offset);
         return true;
     }
 
+    ULONG PageSize() const { return mPageSize; }
+    int PageCount() const { return mPageCount; }
+
     void EnsureRangeInCache(TADDR start, unsigned int size)
     {
-        if (mCurrPageStart == start)
-        {
-            if (size <= mCurrPageSize)
-                return;
-            
-            // Total bytes to read, don't overflow buffer.
-            unsigned int total = size + mCurrPageSize;
-            if (total + mCurrPageSize > mPageSize)
-                total = mPageSize-mCurrPageSize;
+        if (mPages == NULL)
+            return;
 
-            // Read into the middle of the buffer, update current page size.
-            ULONG read = 0;
-            HRESULT hr = g_ExtData->ReadVirtual(mCurrPageStart+mCurrPageSize, mPage+mCurrPageSize, total, &read);
-            mCurrPageSize += read;
+        // Warm every page the range touches; Read takes care of eviction.
+        TADDR base = start & ~((TADDR)mPageSize - 1);
+        TADDR end = start + size;
 
-            if (hr != S_OK)
-            {
-                mCurrPageStart = 0;
-                mCurrPageSize = 0;
-            }
-        }
-        else
+        for (TADDR addr = base; addr < end; addr += mPageSize)
         {
-            MoveToPage(start, size);
+            if (FindPage(addr) == NULL)
+                MoveToPage(addr);
         }
     }
     
@@ -2696,10 +3670,46 @@ public:
     }
 
 private:
-    /* Sets the cache to the page specified by addr, or false if we could not move to
-     * that page.
+    struct Page
+    {
+        TADDR start;        // page aligned target address, 0 if the slot is empty
+        ULONG size;         // number of valid bytes in data
+        ULONG64 lastUsed;   // LRU clock value of the last hit
+        BYTE *data;         // points into the single allocation shared by all pages
+    };
+
+    /* Returns the cached page starting at base, or NULL if it is not cached.
+     */
+    Page *FindPage(TADDR base)
+    {
+        // Check the most recently used page first: sequential scans hit it
+        // almost every time.
+        if (mMru->start == base)
+            return mMru;
+
+        for (int i = 0; i < mPageCount; i++)
+        {
+            if (mPages[i].start == base)
+            {
+                mMru = &mPages[i];
+                return mMru;
+            }
+        }
+
+        return NULL;
+    }
+
+    /* Evicts the least recently used page and fills it from the target process
+     * at base.  Returns NULL if we could not read that page.  When two misses
+     * in a row land on adjacent pages the caller is streaming forward, and a
+     * run of pages is fetched with a single read so the next several lookups
+     * never touch the target.
      */
-    bool MoveToPage(TADDR addr, unsigned int size = 0x18);
+    Page *MoveToPage(TADDR base);
+
+    /* Returns the least recently used page slot.
+     */
+    Page *EvictLru();
 
     /* Attempts to read from the target process if the data is possibly hanging off
      * the end of a page.
@@ -2708,20 +3718,34 @@ private:
     inline bool MisalignedRead(TADDR addr, T *t)
     {
         ULONG fetched = 0;
+
+        g_readStats.Calls++;
+        g_readStats.BytesRequested += sizeof(T);
+
         HRESULT hr = g_ExtData->ReadVirtual(addr, (BYTE*)t, sizeof(T), &fetched);
 
         if (FAILED(hr) || fetched != sizeof(T))
             return false;
 
+        g_readStats.BytesRead += fetched;
+
         mMisaligned++;
         return true;
     }
 
 private:
-    TADDR mCurrPageStart;
-    ULONG mPageSize, mCurrPageSize;
-    BYTE *mPage;
-    
+    ULONG mPageSize;
+    int mPageCount;
+    Page *mPages;
+    Page *mMru;         // the page hit by the last lookup
+    ULONG64 mClock;     // incremented on every hit and fill
+
+    TADDR mLastMissBase;    // the page base of the last miss, for streaming detection
+    BYTE *mReadAhead;       // scratch buffer for the multi-page streaming read
+    int mReadAheadPages;    // pages fetched per streaming read
+
+    size_t mAccountedBytes; // what this cache reported to SOSMemAdd
+
     int mMisses, mReads, mMisaligned;
 };
 
@@ -2735,21 +3759,89 @@ private:
 #include <unordered_set>
 #include <list>
 
-class TypeTree;
-enum { FORMAT_XML=0, FORMAT_CLRPROFILER=1 };
+// Route the address set/map table allocations into the byte accounting; the
+// header defaults these to no-ops for standalone includers (sosbench).
+#define ADDRSET_ACCOUNT_ALLOC(bytes) SOSMemAdd(SOSMemGraphIndex, (bytes))
+#define ADDRSET_ACCOUNT_FREE(bytes)  SOSMemSub(SOSMemGraphIndex, (bytes))
+#include "addrset.h"
+
+/* The dependent handle map: primary object -> the secondaries the GC keeps
+ * alive through it (ConditionalWeakTable entries).  The heap walks consult it
+ * once per object visited and almost every lookup misses, so a bloom filter
+ * over the primary addresses sits in front of the hash table: two bit tests
+ * reject a non-primary without hashing into the map at all.
+ */
+struct DependentHandleMap
+{
+    std::unordered_map<TADDR, std::list<TADDR>> Map;
+    ULONG64 Filter[1024];   // 65536 bits, two probes per address
+
+    DependentHandleMap()
+    {
+        Clear();
+    }
+
+    void Clear()
+    {
+        Map.clear();
+        memset(Filter, 0, sizeof(Filter));
+    }
+
+    void Add(TADDR primary, TADDR secondary)
+    {
+        Map[primary].push_back(secondary);
+        Filter[Hash1(primary) >> 6] |= 1ULL << (Hash1(primary) & 0x3f);
+        Filter[Hash2(primary) >> 6] |= 1ULL << (Hash2(primary) & 0x3f);
+    }
+
+    // Returns the secondaries hanging off "primary", or NULL if it has none.
+    const std::list<TADDR> *Lookup(TADDR primary) const
+    {
+        if (!(Filter[Hash1(primary) >> 6] & (1ULL << (Hash1(primary) & 0x3f))))
+            return NULL;
+
+        if (!(Filter[Hash2(primary) >> 6] & (1ULL << (Hash2(primary) & 0x3f))))
+            return NULL;
+
+        std::unordered_map<TADDR, std::list<TADDR>>::const_iterator itr = Map.find(primary);
+        return itr == Map.end() ? NULL : &itr->second;
+    }
+
+private:
+    // Objects are pointer aligned, so drop the low bits before mixing.
+    static size_t Hash1(TADDR primary)
+    {
+        return ((size_t)primary >> 3) & 0xffff;
+    }
+
+    static size_t Hash2(TADDR primary)
+    {
+        return (size_t)((((size_t)primary >> 3) * 2654435761u) >> 16) & 0xffff;
+    }
+};
+
+// The interned type table for the heap traversal; see gcroot.cpp.
+class TypeNameTable;
+enum { FORMAT_XML=0, FORMAT_CLRPROFILER=1, FORMAT_BINARY=2 };
 enum { TYPE_START=0,TYPE_TYPES=1,TYPE_ROOTS=2,TYPE_OBJECTS=3,TYPE_HIGHEST=4};
 class HeapTraverser
 {
 private:
-    TypeTree *m_pTypeTree;
+    TypeNameTable *m_pTypes;
     size_t m_curNID;
     FILE *m_file;
     int m_format; // from the enum above
     size_t m_objVisited; // for UI updates
     bool m_verify;
     LinearReadCache mCache;
-    
-    std::unordered_map<TADDR, std::list<TADDR>> mDependentHandleMap;
+
+    // Pending object state for the binary format: the members of the current
+    // object are buffered so its record can be written with a leading
+    // reference count (see PrintObjectTail).
+    ULONG64 m_binObjAddr, m_binObjTypeID, m_binObjSize;
+    std::vector<std::pair<ULONG64, BYTE>> m_binRefs;
+
+    const DependentHandleMap *mDependentHandleMap;
     
 public:           
     HeapTraverser(bool verify);
@@ -2760,10 +3852,10 @@ public:
     BOOL Initialize();
     BOOL CreateReport (FILE *fp, int format);
 
-private:    
-    // First all types are added to a tree
+private:
+    // First all types are interned into the type table
     void insert(size_t mTable);
-    size_t getID(size_t mTable);    
+    size_t getID(size_t mTable);
     
     // Functions for writing to the output file.
     void PrintType(size_t ID,LPCWSTR name);
@@ -2786,18 +3878,69 @@ private:
     // Callback functions used during traversals
     static void GatherTypes(DWORD_PTR objAddr,size_t Size,DWORD_PTR methodTable, LPVOID token);
     static void PrintHeap(DWORD_PTR objAddr,size_t Size,DWORD_PTR methodTable, LPVOID token);
-    static void PrintOutTree(size_t methodTable, size_t ID, LPVOID token);
     void TraceHandles();
 };
 
 
+/* A visited-object set backed by per-segment bitmaps.  Objects are aligned to
+ * at least 8 bytes, so one bit per 8 bytes of committed segment space covers
+ * every possible object address; a membership test is a binary search of the
+ * segment ranges and a bit test, with none of the per-node allocation or
+ * pointer chasing of a hash set.  The rare address outside every segment (a
+ * bogus root, an object in memory the snapshot missed) spills into a regular
+ * hash set so no caller has to care.
+ */
+class VisitedBitmap
+{
+public:
+    VisitedBitmap()
+    {
+    }
+
+    ~VisitedBitmap()
+    {
+        Clear();
+    }
+
+    /* Builds empty bitmaps over the segments of g_snapshot, building the
+     * snapshot first if necessary.  Returns false if the snapshot (or the
+     * memory for the bitmaps) is unavailable; use a hash set instead then.
+     */
+    bool Init();
+
+    void Clear();
+
+    bool Contains(TADDR obj) const;
+
+    // Adds the object to the set.  Returns true if it was newly added.
+    bool Add(TADDR obj);
+
+private:
+    struct SegmentBits
+    {
+        TADDR Start;
+        TADDR End;
+        BYTE *Bits;
+    };
+
+    // Returns the entry whose [Start, End) range contains obj, or NULL.
+    SegmentBits *Find(TADDR obj) const;
+
+private:
+    std::vector<SegmentBits> mSegments;     // sorted by Start
+    std::unordered_set<TADDR> mOverflow;    // addresses outside every segment
+};
+
+// A memory-mapped, per-dump cache of the object graph; see gcroot.cpp.
+class ObjectGraphIndex;
+
 class GCRootImpl
 {
 private:
     struct MTInfo
     {
         TADDR MethodTable;
-        WCHAR  *TypeName;
+        const WCHAR *TypeName;
 
         TADDR *Buffer;
         CGCDesc *GCDesc;
@@ -2812,11 +3955,11 @@ private:
         const WCHAR *GetTypeName()
         {
             if (!TypeName)
-                TypeName = CreateMethodTableName(MethodTable);
-            
+                TypeName = GetInternedMethodTableName(MethodTable);
+
             if (!TypeName)
                 return W("<error>");
-            
+
             return TypeName;
         }
 
@@ -2830,9 +3973,6 @@ private:
         {
             if (Buffer)
                 delete [] Buffer;
-
-            if (TypeName)
-                delete [] TypeName;
         }
     };
 
@@ -2904,13 +4044,24 @@ private:
     };
 
 public:
-    static void GetDependentHandleMap(std::unordered_map<TADDR, std::list<TADDR>> &map);
+    // Returns the session's dependent handle map, building it on the first
+    // call; never NULL (on failure the map is empty and rebuilt next time).
+    static const DependentHandleMap *GetDependentHandleMap();
 
 public:
     // Finds all objects which root "target" and prints the path from the root
     // to "target".  If all is true, all possible paths to the object are printed.
     // If all is false, only completely unique paths will be printed.
-    int PrintRootsForObject(TADDR obj, bool all, bool noStacks);
+    // If firstOnly is true the whole search stops as soon as one path has
+    // been printed (ignored with all).  A non-zero maxDepth bounds how deep
+    // the walk descends from each root; bounded walks can miss paths that
+    // only exist past the limit.
+    int PrintRootsForObject(TADDR obj, bool all, bool noStacks, bool firstOnly = false, int maxDepth = 0);
+
+    // Finds roots for several objects in shared passes over the object graph,
+    // repeating the pass (without the already-resolved targets) for targets
+    // whose paths were consumed by earlier finds.  Prints unique paths only.
+    int PrintRootsForObjects(const std::vector<TADDR> &targets, bool noStacks);
 
     // Finds a path from root to target if it exists and prints it out.  Returns
     // true if it found a path, false otherwise.
@@ -2922,9 +4073,20 @@ public:
     // Walks each root, printing out the total amount of memory held alive by it.
     void ObjSize();
 
+    // Builds the object graph once, computes the dominator tree, and prints
+    // the retained size per type plus the topObjects largest dominators.
+    void PrintRetainedSizes(int topObjects);
+
     // Returns the set of all live objects in the process.
     const std::unordered_set<TADDR> &GetLiveObjects(bool excludeFQ = false);
 
+    // Performs one marking pass over every root, tracking the closure in the
+    // segment bitmap when it is available.  Query the result with IsLive.
+    void BuildLivenessMap(bool excludeFQ = false);
+
+    // Returns true if obj was reached by the last marking pass.
+    bool IsLive(TADDR obj) { return IsConsidered(obj); }
+
     // See !FindRoots.
     int FindRoots(int gen, TADDR target);
 
@@ -2937,6 +4099,11 @@ private:
     void ClearNodes();
     void ClearSizeData();
 
+    // Root enumeration for the parallel marker.  Collects every root in the
+    // process without walking or reporting anything.
+    bool CollectRoots(std::vector<TADDR> &roots, bool excludeFQ);
+    void CollectRootsInRange(LinearReadCache &cache, TADDR start, TADDR stop, std::vector<TADDR> &roots);
+
     // Printing roots
     int PrintRootsOnHandleTable(int gen = -1);
     int PrintRootsOnAllThreads();
@@ -2949,6 +4116,11 @@ private:
     RootNode *FilterRoots(RootNode *&list);
     RootNode *FindPathToTarget(TADDR root);
     RootNode *GetGCRefs(RootNode *path, RootNode *node);
+
+    // Warms the read cache with the headers of every object on the list
+    // before the walk descends into them, batching what would otherwise be
+    // one dependent header read per child.
+    void PrefetchObjects(RootNode *refs);
     
     void InitDependentHandleMap();
 
@@ -2960,6 +4132,16 @@ private:
     void ReportSizeInfo(const SOSHandleData &handle, TADDR obj);
     void ReportSizeInfo(DWORD thread, const SOSStackRefData &ref, TADDR obj);
 
+    // Visited-object tracking.  The path-finding entry points use the segment
+    // bitmap when it is available; GetLiveObjects keeps the hash set since it
+    // hands it out to the caller.
+    bool IsConsidered(TADDR obj);
+    void MarkConsidered(TADDR obj);
+
+    // True once the search may stop early: first-path mode and every target
+    // has a reported path.
+    bool SearchComplete();
+
     // Data reads:
     TADDR ReadPointer(TADDR location);
     TADDR ReadPointerCached(TADDR location);
@@ -2976,18 +4158,26 @@ private:
 private:
     
     bool mAll,  // Print all roots or just unique roots?
-         mSize; // Print rooting information or total size info?
+         mSize, // Print rooting information or total size info?
+         mUseBitmap, // Track visited objects in mVisited instead of mConsidered?
+         mFirstOnly; // Stop the whole search after the first path found?
+
+    int mMaxDepth;  // Depth bound for the walk from each root; 0 = unbounded.
 
     std::list<RootNode*> mCleanupList;  // A list of RootNode's we've newed up.  This is only used to delete all of them later.
     std::list<RootNode*> mRootNewList;  // A list of unused RootNodes that are free to use instead of having to "new" up more.
     
     std::unordered_map<TADDR, MTInfo*> mMTs;     // The MethodTable cache which maps from MT -> MethodTable data (size, gcdesc, string typename)
     std::unordered_map<TADDR, RootNode*> mTargets;   // The objects that we are searching for.
+    std::unordered_set<TADDR> mFoundTargets;     // The targets a path has been found for, used by the multi-target search.
     std::unordered_set<TADDR> mConsidered;       // A hashtable of objects we've already visited.
-    std::unordered_map<TADDR, size_t> mSizes;   // A mapping from object address to total size of data the object roots.
-    
-    std::unordered_map<TADDR, std::list<TADDR>> mDependentHandleMap;
+    VisitedBitmap mVisited;                      // Bitmap equivalent of mConsidered, used when mUseBitmap is set.
+    SharedAddressMap mSizes;                     // A mapping from object address to total size of data the object roots.
     
+    const DependentHandleMap *mDependentHandleMap;  // The session's map; owned by GetDependentHandleMap.
+
+    ObjectGraphIndex *mIndex;   // The persistent graph index for the dump, or NULL; owned by ObjectGraphIndex::Get.
+
     LinearReadCache mCache;     // A linear cache which stops us from having to read from the target process more than 1-2 times per object.
 };
 
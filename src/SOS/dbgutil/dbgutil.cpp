@@ -16,6 +16,22 @@
 #include "corerror.h"
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
+
+// Buffered variants of the tree-walking helpers below, so one reader (and
+// its buffer) survives across all the levels of a resource lookup.
+static HRESULT GetNextLevelResourceEntryRVA(DataTargetBufferedReader& reader,
+    DWORD id,
+    ULONG64 moduleBaseAddress,
+    DWORD resourceDirectoryRVA,
+    DWORD* pNextLevelRVA);
+
+static HRESULT GetNextLevelResourceEntryRVAByName(DataTargetBufferedReader& reader,
+    LPCWSTR pwzName,
+    ULONG64 moduleBaseAddress,
+    DWORD resourceDirectoryRva,
+    DWORD resourceSectionRva,
+    DWORD* pNextLevelRva);
 
 // Returns the RVA of the resource section for the module specified by the given data target and module base.
 // Returns failure if the module doesn't have a resource section.
@@ -29,6 +45,15 @@ HRESULT GetMachineAndResourceSectionRVA(ICorDebugDataTarget* pDataTarget,
     ULONG64 moduleBaseAddress,
     WORD* pwImageFileMachine,
     DWORD* pdwResourceSectionRVA)
+{
+    DataTargetBufferedReader reader(pDataTarget);
+    return GetMachineAndResourceSectionRVA(reader, moduleBaseAddress, pwImageFileMachine, pdwResourceSectionRVA);
+}
+
+HRESULT GetMachineAndResourceSectionRVA(DataTargetBufferedReader& reader,
+    ULONG64 moduleBaseAddress,
+    WORD* pwImageFileMachine,
+    DWORD* pdwResourceSectionRVA)
 {
     // Fun code ahead... below is a hand written PE decoder with some of the file offsets hardcoded.
     // It supports no more than what we absolutely have to to get to the resources we need. Any of the
@@ -44,9 +69,12 @@ HRESULT GetMachineAndResourceSectionRVA(ICorDebugDataTarget* pDataTarget,
 
     HRESULT hr = S_OK;
 
+    // The header fields below all live within the first pages of the image,
+    // so the caller's buffered reader resolves them with a single target read.
+
     // at offset 3c in the image is a 4 byte file pointer that indicates where the PE signature is
     IMAGE_DOS_HEADER dosHeader;
-    hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress, (BYTE*)&dosHeader, sizeof(dosHeader));
+    hr = reader.Read(moduleBaseAddress, (BYTE*)&dosHeader, sizeof(dosHeader));
 
     // verify there is a 4 byte PE signature there
     DWORD peSigFilePointer = 0;
@@ -54,7 +82,7 @@ HRESULT GetMachineAndResourceSectionRVA(ICorDebugDataTarget* pDataTarget,
     {
         peSigFilePointer = dosHeader.e_lfanew;
         DWORD peSig = 0;
-        hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + peSigFilePointer, (BYTE*)&peSig, 4);
+        hr = reader.Read(moduleBaseAddress + peSigFilePointer, (BYTE*)&peSig, 4);
         if (SUCCEEDED(hr) && peSig != IMAGE_NT_SIGNATURE)
         {
             hr = E_FAIL; // PE signature not present
@@ -66,7 +94,7 @@ HRESULT GetMachineAndResourceSectionRVA(ICorDebugDataTarget* pDataTarget,
     IMAGE_FILE_HEADER imageFileHeader;
     if (SUCCEEDED(hr))
     {
-        hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + peSigFilePointer + 4, (BYTE*)&imageFileHeader, IMAGE_SIZEOF_FILE_HEADER);
+        hr = reader.Read(moduleBaseAddress + peSigFilePointer + 4, (BYTE*)&imageFileHeader, IMAGE_SIZEOF_FILE_HEADER);
     }
 
 
@@ -84,7 +112,7 @@ HRESULT GetMachineAndResourceSectionRVA(ICorDebugDataTarget* pDataTarget,
         // 24 bytes after the signature is the image-only header
         // at the beginning of the image-only header is a 2 byte magic number indicating its format
         peOptImageHeaderFilePointer = peSigFilePointer + IMAGE_SIZEOF_FILE_HEADER + sizeof(DWORD);
-        hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + peOptImageHeaderFilePointer, (BYTE*)&optHeaderMagic, 2);
+        hr = reader.Read(moduleBaseAddress + peOptImageHeaderFilePointer, (BYTE*)&optHeaderMagic, 2);
     }
 
     // Either 112 or 128 bytes after the beginning of the image-only header is an 8 byte resource table
@@ -95,7 +123,7 @@ HRESULT GetMachineAndResourceSectionRVA(ICorDebugDataTarget* pDataTarget,
         if (optHeaderMagic == IMAGE_NT_OPTIONAL_HDR32_MAGIC) // PE32
         {
             IMAGE_OPTIONAL_HEADER32 header32;
-            hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + peOptImageHeaderFilePointer,
+            hr = reader.Read(moduleBaseAddress + peOptImageHeaderFilePointer,
                 (BYTE*)&header32, sizeof(header32));
             if (SUCCEEDED(hr))
             {
@@ -105,7 +133,7 @@ HRESULT GetMachineAndResourceSectionRVA(ICorDebugDataTarget* pDataTarget,
         else if (optHeaderMagic == IMAGE_NT_OPTIONAL_HDR64_MAGIC) //PE32+
         {
             IMAGE_OPTIONAL_HEADER64 header64;
-            hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + peOptImageHeaderFilePointer,
+            hr = reader.Read(moduleBaseAddress + peOptImageHeaderFilePointer,
                 (BYTE*)&header64, sizeof(header64));
             if (SUCCEEDED(hr))
             {
@@ -130,6 +158,20 @@ HRESULT GetResourceRvaFromResourceSectionRva(ICorDebugDataTarget* pDataTarget,
     DWORD language,
     DWORD* pResourceRva,
     DWORD* pResourceSize)
+{
+    DataTargetBufferedReader reader(pDataTarget);
+    return GetResourceRvaFromResourceSectionRva(reader, moduleBaseAddress, resourceSectionRva,
+        type, name, language, pResourceRva, pResourceSize);
+}
+
+HRESULT GetResourceRvaFromResourceSectionRva(DataTargetBufferedReader& reader,
+    ULONG64 moduleBaseAddress,
+    DWORD resourceSectionRva,
+    DWORD type,
+    DWORD name,
+    DWORD language,
+    DWORD* pResourceRva,
+    DWORD* pResourceSize)
 {
     HRESULT hr = S_OK;
     DWORD nameTableRva = 0;
@@ -146,19 +188,21 @@ HRESULT GetResourceRvaFromResourceSectionRva(ICorDebugDataTarget* pDataTarget,
     // Note all RVAs in this section are relative to the beginning of the resource section,
     // not the beginning of the image.
 
-    hr = GetNextLevelResourceEntryRVA(pDataTarget, type, moduleBaseAddress, resourceSectionRva, &nameTableRva);
+    // The caller's buffered reader covers the whole lookup: the directories
+    // at every level are packed together at the start of the resource section.
+    hr = GetNextLevelResourceEntryRVA(reader, type, moduleBaseAddress, resourceSectionRva, &nameTableRva);
 
 
     if (SUCCEEDED(hr))
     {
         nameTableRva += resourceSectionRva;
-        hr = GetNextLevelResourceEntryRVA(pDataTarget, name, moduleBaseAddress, nameTableRva, &langTableRva);
+        hr = GetNextLevelResourceEntryRVA(reader, name, moduleBaseAddress, nameTableRva, &langTableRva);
 
     }
     if (SUCCEEDED(hr))
     {
         langTableRva += resourceSectionRva;
-        hr = GetNextLevelResourceEntryRVA(pDataTarget, language, moduleBaseAddress, langTableRva, &resourceDataEntryRva);
+        hr = GetNextLevelResourceEntryRVA(reader, language, moduleBaseAddress, langTableRva, &resourceDataEntryRva);
     }
 
     // The resource data entry has the first 4 bytes indicating the RVA of the resource
@@ -167,7 +211,7 @@ HRESULT GetResourceRvaFromResourceSectionRva(ICorDebugDataTarget* pDataTarget,
     {
         resourceDataEntryRva += resourceSectionRva;
         IMAGE_RESOURCE_DATA_ENTRY dataEntry;
-        hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + resourceDataEntryRva,
+        hr = reader.Read(moduleBaseAddress + resourceDataEntryRva,
             (BYTE*)&dataEntry, sizeof(dataEntry));
         *pResourceRva = dataEntry.OffsetToData;
         *pResourceSize = dataEntry.Size;
@@ -184,6 +228,20 @@ HRESULT GetResourceRvaFromResourceSectionRvaByName(ICorDebugDataTarget* pDataTar
     DWORD language,
     DWORD* pResourceRva,
     DWORD* pResourceSize)
+{
+    DataTargetBufferedReader reader(pDataTarget);
+    return GetResourceRvaFromResourceSectionRvaByName(reader, moduleBaseAddress, resourceSectionRva,
+        type, pwszName, language, pResourceRva, pResourceSize);
+}
+
+HRESULT GetResourceRvaFromResourceSectionRvaByName(DataTargetBufferedReader& reader,
+    ULONG64 moduleBaseAddress,
+    DWORD resourceSectionRva,
+    DWORD type,
+    LPCWSTR pwszName,
+    DWORD language,
+    DWORD* pResourceRva,
+    DWORD* pResourceSize)
 {
     HRESULT hr = S_OK;
     DWORD nameTableRva = 0;
@@ -199,18 +257,21 @@ HRESULT GetResourceRvaFromResourceSectionRvaByName(ICorDebugDataTarget* pDataTar
     // resource. 
     // Note all RVAs in this section are relative to the beginning of the resource section,
     // not the beginning of the image.
-    hr = GetNextLevelResourceEntryRVA(pDataTarget, type, moduleBaseAddress, resourceSectionRva, &nameTableRva);
+
+    // The caller's buffered reader covers the whole lookup: the directories
+    // at every level are packed together at the start of the resource section.
+    hr = GetNextLevelResourceEntryRVA(reader, type, moduleBaseAddress, resourceSectionRva, &nameTableRva);
 
 
     if (SUCCEEDED(hr))
     {
         nameTableRva += resourceSectionRva;
-        hr = GetNextLevelResourceEntryRVAByName(pDataTarget, pwszName, moduleBaseAddress, nameTableRva, resourceSectionRva, &langTableRva);
+        hr = GetNextLevelResourceEntryRVAByName(reader, pwszName, moduleBaseAddress, nameTableRva, resourceSectionRva, &langTableRva);
     }
     if (SUCCEEDED(hr))
     {
         langTableRva += resourceSectionRva;
-        hr = GetNextLevelResourceEntryRVA(pDataTarget, language, moduleBaseAddress, langTableRva, &resourceDataEntryRva);
+        hr = GetNextLevelResourceEntryRVA(reader, language, moduleBaseAddress, langTableRva, &resourceDataEntryRva);
     }
 
     // The resource data entry has the first 4 bytes indicating the RVA of the resource
@@ -219,7 +280,7 @@ HRESULT GetResourceRvaFromResourceSectionRvaByName(ICorDebugDataTarget* pDataTar
     {
         resourceDataEntryRva += resourceSectionRva;
         IMAGE_RESOURCE_DATA_ENTRY dataEntry;
-        hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + resourceDataEntryRva,
+        hr = reader.Read(moduleBaseAddress + resourceDataEntryRva,
             (BYTE*)&dataEntry, sizeof(dataEntry));
         *pResourceRva = dataEntry.OffsetToData;
         *pResourceSize = dataEntry.Size;
@@ -245,6 +306,16 @@ HRESULT GetNextLevelResourceEntryRVA(ICorDebugDataTarget* pDataTarget,
     ULONG64 moduleBaseAddress,
     DWORD resourceDirectoryRVA,
     DWORD* pNextLevelRVA)
+{
+    DataTargetBufferedReader reader(pDataTarget);
+    return GetNextLevelResourceEntryRVA(reader, id, moduleBaseAddress, resourceDirectoryRVA, pNextLevelRVA);
+}
+
+static HRESULT GetNextLevelResourceEntryRVA(DataTargetBufferedReader& reader,
+    DWORD id,
+    ULONG64 moduleBaseAddress,
+    DWORD resourceDirectoryRVA,
+    DWORD* pNextLevelRVA)
 {
     *pNextLevelRVA = 0;
     HRESULT hr = S_OK;
@@ -255,7 +326,7 @@ HRESULT GetNextLevelResourceEntryRVA(ICorDebugDataTarget* pDataTarget,
     // identified by ID at offset 14. Both are 2 bytes.
     // This method only supports locating entries by ID, not by name
     IMAGE_RESOURCE_DIRECTORY resourceDirectory;
-    hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + resourceDirectoryRVA, (BYTE*)&resourceDirectory, sizeof(resourceDirectory));
+    hr = reader.Read(moduleBaseAddress + resourceDirectoryRVA, (BYTE*)&resourceDirectory, sizeof(resourceDirectory));
 
 
 
@@ -271,7 +342,7 @@ HRESULT GetNextLevelResourceEntryRVA(ICorDebugDataTarget* pDataTarget,
         for (WORD i = numNameEntries; i < numNameEntries + numIDEntries; i++)
         {
             IMAGE_RESOURCE_DIRECTORY_ENTRY entry;
-            hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + resourceDirectoryRVA + sizeof(resourceDirectory) + sizeof(entry)*i,
+            hr = reader.Read(moduleBaseAddress + resourceDirectoryRVA + sizeof(resourceDirectory) + sizeof(entry)*i,
                 (BYTE*)&entry, sizeof(entry));
             if (FAILED(hr))
             {
@@ -313,10 +384,74 @@ HRESULT GetNextLevelResourceEntryRVAByName(ICorDebugDataTarget* pDataTarget,
     DWORD resourceDirectoryRva,
     DWORD resourceSectionRva,
     DWORD* pNextLevelRva)
+{
+    DataTargetBufferedReader reader(pDataTarget);
+    return GetNextLevelResourceEntryRVAByName(reader, pwzName, moduleBaseAddress, resourceDirectoryRva, resourceSectionRva, pNextLevelRva);
+}
+
+// Reads the length-prefixed UTF16 name of a directory entry and orders it
+// against pwzName the way the resource compiler sorts the table: by the
+// unsigned UTF16 units of the common prefix, shorter name first on a tie.
+// *pOrder is set negative when the entry sorts before pwzName, zero on a
+// match and positive when it sorts after.
+static HRESULT CompareResourceEntryName(DataTargetBufferedReader& reader,
+    const IMAGE_RESOURCE_DIRECTORY_ENTRY& entry,
+    LPCWSTR pwzName,
+    DWORD nameLength,
+    ULONG64 moduleBaseAddress,
+    DWORD resourceSectionRva,
+    int* pOrder)
+{
+    // the NameRVAOrID field points to a UTF16 string with a 2 byte length in front of it
+    // read the 2 byte length first. The doc of course doesn't mention this, but the RVA is
+    // relative to the base of the resource section and needs the leading bit stripped.
+    WORD entryNameLength = 0;
+    HRESULT hr = reader.Read(moduleBaseAddress + resourceSectionRva +
+        entry.NameOffset, (BYTE*)&entryNameLength, sizeof(entryNameLength));
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // nameLength is below 50, so 50 characters always cover the deciding
+    // prefix: a longer entry name that matches all of pwzName still orders
+    // after it on length alone.
+    WCHAR entryName[50];
+    DWORD cmpLength = entryNameLength < nameLength ? entryNameLength : nameLength;
+    hr = reader.Read(moduleBaseAddress + resourceSectionRva +
+        entry.NameOffset + 2, (BYTE*)entryName, cmpLength*sizeof(WCHAR));
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    int order = 0;
+    for (DWORD i = 0; i < cmpLength; i++)
+    {
+        if (entryName[i] != pwzName[i])
+        {
+            order = entryName[i] < pwzName[i] ? -1 : 1;
+            break;
+        }
+    }
+    if (order == 0 && entryNameLength != nameLength)
+    {
+        order = entryNameLength < nameLength ? -1 : 1;
+    }
+
+    *pOrder = order;
+    return S_OK;
+}
+
+static HRESULT GetNextLevelResourceEntryRVAByName(DataTargetBufferedReader& reader,
+    LPCWSTR pwzName,
+    ULONG64 moduleBaseAddress,
+    DWORD resourceDirectoryRva,
+    DWORD resourceSectionRva,
+    DWORD* pNextLevelRva)
 {
     HRESULT hr = S_OK;
     DWORD nameLength = (DWORD)wcslen(pwzName);
-    WCHAR entryName[50];
     assert(nameLength < 50);     // this implementation won't support matching a name longer
     // than 50 characters. We only look up the hard coded name
     // of the debug resource in clr.dll though, so it shouldn't be
@@ -331,54 +466,102 @@ HRESULT GetNextLevelResourceEntryRVAByName(ICorDebugDataTarget* pDataTarget,
     // a header followed by a number of entries. In the header at offset 12 is
     // the number entries identified by name, followed by the number of entries
     // identified by ID at offset 14. Both are 2 bytes.
-    // This method only supports locating entries by ID, not by name
     IMAGE_RESOURCE_DIRECTORY resourceDirectory = { 0 };
     if (SUCCEEDED(hr))
     {
-        hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + resourceDirectoryRva, (BYTE*)&resourceDirectory, sizeof(resourceDirectory));
+        hr = reader.Read(moduleBaseAddress + resourceDirectoryRva, (BYTE*)&resourceDirectory, sizeof(resourceDirectory));
     }
 
     // The ith resource directory entry is at offset 16 + 8i from the beginning of the resource
-    // directory table
+    // directory table.  The whole name level is read as one block - alternating
+    // between entry reads and name reads thrashed the reader's single buffer,
+    // one refill per entry - and binary-searched, since the spec orders named
+    // entries ascending by name.  The entry count is untrusted, so directories
+    // larger than the local block take the old one-entry-at-a-time path.
     if (SUCCEEDED(hr))
     {
+        const WORD kMaxBlockEntries = 64;
+        IMAGE_RESOURCE_DIRECTORY_ENTRY entries[kMaxBlockEntries];
+
         WORD numNameEntries = resourceDirectory.NumberOfNamedEntries;
-        for (WORD i = 0; i < numNameEntries; i++)
+        if (numNameEntries > 0 && numNameEntries <= kMaxBlockEntries &&
+            SUCCEEDED(reader.Read(moduleBaseAddress + resourceDirectoryRva + sizeof(resourceDirectory),
+                (BYTE*)entries, numNameEntries*(ULONG32)sizeof(entries[0]))))
         {
-            IMAGE_RESOURCE_DIRECTORY_ENTRY entry;
-            hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + resourceDirectoryRva + sizeof(resourceDirectory) + sizeof(entry)*i,
-                (BYTE*)&entry, sizeof(entry));
-            if (FAILED(hr))
+            BOOL found = FALSE;
+            WORD lo = 0;
+            WORD hi = numNameEntries;
+            while (lo < hi)
             {
-                break;
+                WORD mid = (WORD)(lo + (hi - lo) / 2);
+                int order = 0;
+                hr = CompareResourceEntryName(reader, entries[mid], pwzName, nameLength,
+                    moduleBaseAddress, resourceSectionRva, &order);
+                if (FAILED(hr))
+                {
+                    break;
+                }
+                if (order == 0)
+                {
+                    *pNextLevelRva = entries[mid].OffsetToDirectory;
+                    found = TRUE;
+                    break;
+                }
+                if (order < 0)
+                {
+                    lo = (WORD)(mid + 1);
+                }
+                else
+                {
+                    hi = mid;
+                }
             }
 
-            // the NameRVAOrID field points to a UTF16 string with a 2 byte length in front of it
-            // read the 2 byte length first. The doc of course doesn't mention this, but the RVA is
-            // relative to the base of the resource section and needs the leading bit stripped.
-            WORD entryNameLength = 0;
-            hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + resourceSectionRva +
-                entry.NameOffset, (BYTE*)&entryNameLength, sizeof(entryNameLength));
-            if (FAILED(hr))
+            // A linker that didn't sort the table defeats the search; the
+            // entries are already in memory, so sweep them before giving up.
+            if (SUCCEEDED(hr) && !found)
             {
-                break;
+                for (WORD i = 0; i < numNameEntries; i++)
+                {
+                    int order = 0;
+                    hr = CompareResourceEntryName(reader, entries[i], pwzName, nameLength,
+                        moduleBaseAddress, resourceSectionRva, &order);
+                    if (FAILED(hr))
+                    {
+                        break;
+                    }
+                    if (order == 0)
+                    {
+                        *pNextLevelRva = entries[i].OffsetToDirectory;
+                        break;
+                    }
+                }
             }
-            if (entryNameLength != nameLength)
-            {
-                continue; // names aren't the same length, not a match
-            }
-
-            // read the rest of the string data and check for a match
-            hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + resourceSectionRva +
-                entry.NameOffset + 2, (BYTE*)entryName, entryNameLength*sizeof(WCHAR));
-            if (FAILED(hr))
-            {
-                break;
-            }
-            if (memcmp(entryName, pwzName, entryNameLength*sizeof(WCHAR)) == 0)
+        }
+        else
+        {
+            for (WORD i = 0; i < numNameEntries; i++)
             {
-                *pNextLevelRva = entry.OffsetToDirectory;
-                break;
+                IMAGE_RESOURCE_DIRECTORY_ENTRY entry;
+                hr = reader.Read(moduleBaseAddress + resourceDirectoryRva + sizeof(resourceDirectory) + sizeof(entry)*i,
+                    (BYTE*)&entry, sizeof(entry));
+                if (FAILED(hr))
+                {
+                    break;
+                }
+
+                int order = 0;
+                hr = CompareResourceEntryName(reader, entry, pwzName, nameLength,
+                    moduleBaseAddress, resourceSectionRva, &order);
+                if (FAILED(hr))
+                {
+                    break;
+                }
+                if (order == 0)
+                {
+                    *pNextLevelRva = entry.OffsetToDirectory;
+                    break;
+                }
             }
         }
     }
@@ -424,3 +607,62 @@ HRESULT ReadFromDataTarget(ICorDebugDataTarget* pDataTarget,
 
     return hr;
 }
+
+DataTargetBufferedReader::DataTargetBufferedReader(ICorDebugDataTarget* pDataTarget) :
+    m_pDataTarget(pDataTarget),
+    m_bufferBase(0),
+    m_bufferValid(0)
+{
+}
+
+HRESULT DataTargetBufferedReader::Read(ULONG64 addr, BYTE* pBuffer, ULONG32 bytesToRead)
+{
+    if (bytesToRead == 0)
+    {
+        return S_OK;
+    }
+
+    // Large reads bypass the buffer entirely
+    if (bytesToRead > kBufferSize)
+    {
+        return ReadFromDataTarget(m_pDataTarget, addr, pBuffer, bytesToRead);
+    }
+
+    // Serve the read from the buffer when it falls entirely inside it
+    if (m_bufferValid >= bytesToRead && addr >= m_bufferBase &&
+        addr - m_bufferBase <= m_bufferValid - bytesToRead)
+    {
+        memcpy(pBuffer, m_buffer + (size_t)(addr - m_bufferBase), bytesToRead);
+        return S_OK;
+    }
+
+    // Refill the buffer starting at the requested address. The read may
+    // legitimately come up short near the end of the image, so accept any
+    // length that still covers the request.
+    m_bufferValid = 0;
+    ULONG32 totalRead = 0;
+    ULONG32 bytesRead = 0;
+    do
+    {
+        if (FAILED(m_pDataTarget->ReadVirtual((CORDB_ADDRESS)(addr + totalRead),
+            m_buffer + totalRead,
+            kBufferSize - totalRead,
+            &bytesRead)))
+        {
+            break;
+        }
+        totalRead += bytesRead;
+    } while (bytesRead != 0 && totalRead < kBufferSize);
+
+    if (totalRead < bytesToRead)
+    {
+        // The buffered read couldn't cover the request; let the plain path
+        // produce the same error the callers have always seen.
+        return ReadFromDataTarget(m_pDataTarget, addr, pBuffer, bytesToRead);
+    }
+
+    m_bufferBase = addr;
+    m_bufferValid = totalRead;
+    memcpy(pBuffer, m_buffer, bytesToRead);
+    return S_OK;
+}
@@ -13,6 +13,8 @@
 #include <crtdbg.h>
 #include <clrinternal.h> //has the CLR_ID_V4_DESKTOP guid in it
 #include "palclr.h"
+#include <stdio.h>
+#include <stdlib.h>
 
 #ifndef IMAGE_FILE_MACHINE_ARMNT
 #define IMAGE_FILE_MACHINE_ARMNT             0x01c4  // ARM Thumb-2 Little-Endian
@@ -63,6 +65,76 @@ typedef HRESULT (STDAPICALLTYPE  *OpenVirtualProcess2FnPtr)(ULONG64 clrInstanceI
 
 typedef HMODULE (STDAPICALLTYPE  *LoadLibraryWFnPtr)(LPCWSTR lpLibFileName);
 
+//-----------------------------------------------------------------------------
+// A process-lifetime cache of the DBI and DAC modules the library provider
+// has already located and loaded, keyed by (module name, timestamp, size).
+// Attaching to several processes that share a runtime, or re-attaching during
+// a long triage session, would otherwise pay the provider lookup (which may
+// reach a symbol server) and the module load on every OpenVirtualProcess.
+// Entries are never freed; the handles stay valid for the life of the
+// debugger process, which is how long the current code keeps them loaded
+// anyway.
+//-----------------------------------------------------------------------------
+
+struct ProvidedModule
+{
+    WCHAR szName[MAX_PATH_FNAME];
+    DWORD dwTimeStamp;
+    DWORD dwSizeOfImage;
+    HMODULE hModule;     // NULL when the provider only returned a path
+    LPWSTR pwszPath;     // NULL when the provider only returned a handle
+};
+
+// Two modules (DBI and DAC) per runtime version the session touches.
+static const int kMaxProvidedModules = 16;
+static ProvidedModule s_providedModules[kMaxProvidedModules];
+static int s_cProvidedModules = 0;
+
+static ProvidedModule* FindProvidedModule(LPCWSTR pwszName, DWORD dwTimeStamp, DWORD dwSizeOfImage)
+{
+    for (int i = 0; i < s_cProvidedModules; i++)
+    {
+        if (s_providedModules[i].dwTimeStamp == dwTimeStamp &&
+            s_providedModules[i].dwSizeOfImage == dwSizeOfImage &&
+            wcscmp(s_providedModules[i].szName, pwszName) == 0)
+        {
+            return &s_providedModules[i];
+        }
+    }
+    return NULL;
+}
+
+static void RememberProvidedModule(LPCWSTR pwszName, DWORD dwTimeStamp, DWORD dwSizeOfImage, HMODULE hModule, LPCWSTR pwszPath)
+{
+    // A full cache just means later runtime versions keep the old behavior.
+    if (s_cProvidedModules == kMaxProvidedModules)
+        return;
+
+    ProvidedModule* pModule = &s_providedModules[s_cProvidedModules];
+    wcscpy_s(pModule->szName, MAX_PATH_FNAME, pwszName);
+    pModule->dwTimeStamp = dwTimeStamp;
+    pModule->dwSizeOfImage = dwSizeOfImage;
+    pModule->hModule = hModule;
+    pModule->pwszPath = pwszPath != NULL ? _wcsdup(pwszPath) : NULL;
+    s_cProvidedModules++;
+}
+
+// Duplicates a cached path with the allocator the caller's cleanup expects.
+static LPWSTR DuplicateModulePath(LPCWSTR pwszPath)
+{
+#ifdef FEATURE_PAL
+    return _wcsdup(pwszPath);
+#else
+    size_t cch = wcslen(pwszPath) + 1;
+    LPWSTR pwszCopy = (LPWSTR)CoTaskMemAlloc(cch * sizeof(WCHAR));
+    if (pwszCopy != NULL)
+    {
+        wcscpy_s(pwszCopy, cch, pwszPath);
+    }
+    return pwszCopy;
+#endif
+}
+
 // Implementation of ICLRDebugging::OpenVirtualProcess
 //
 // Arguments:
@@ -149,18 +221,37 @@ STDMETHODIMP CLRDebuggingImpl::OpenVirtualProcess(
         ICLRDebuggingLibraryProvider2* pLibraryProvider2;
         if (SUCCEEDED(pLibraryProvider->QueryInterface(__uuidof(ICLRDebuggingLibraryProvider2), (void**)&pLibraryProvider2)))
         {
-            if (FAILED(pLibraryProvider2->ProvideLibrary2(dbiName, dbiTimestamp, dbiSizeOfImage, &pDbiModulePath)) ||
-                pDbiModulePath == NULL)
+            // An entry cached by the handle-only provider has no path and
+            // can't serve this branch; treat it as a miss.
+            ProvidedModule* pCached = FindProvidedModule(dbiName, dbiTimestamp, dbiSizeOfImage);
+            if (pCached != NULL && pCached->pwszPath != NULL)
             {
-                hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
+                hDbi = pCached->hModule;
+                pDbiModulePath = DuplicateModulePath(pCached->pwszPath);
+                if (pDbiModulePath == NULL)
+                {
+                    hr = E_OUTOFMEMORY;
+                }
             }
-
-            if (SUCCEEDED(hr))
+            else
             {
-                hDbi = LoadLibraryW(pDbiModulePath);
-                if (hDbi == NULL)
+                if (FAILED(pLibraryProvider2->ProvideLibrary2(dbiName, dbiTimestamp, dbiSizeOfImage, &pDbiModulePath)) ||
+                    pDbiModulePath == NULL)
                 {
-                    hr = HRESULT_FROM_WIN32(GetLastError());
+                    hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
+                }
+
+                if (SUCCEEDED(hr))
+                {
+                    hDbi = LoadLibraryW(pDbiModulePath);
+                    if (hDbi == NULL)
+                    {
+                        hr = HRESULT_FROM_WIN32(GetLastError());
+                    }
+                    else
+                    {
+                        RememberProvidedModule(dbiName, dbiTimestamp, dbiSizeOfImage, hDbi, pDbiModulePath);
+                    }
                 }
             }
 
@@ -169,19 +260,36 @@ STDMETHODIMP CLRDebuggingImpl::OpenVirtualProcess(
                 // Adjust the timestamp and size of image if this DAC is a known buggy version and needs to be retargeted
                 RetargetDacIfNeeded(&dacTimestamp, &dacSizeOfImage);
 
-                // Ask library provider for dac
-                if (FAILED(pLibraryProvider2->ProvideLibrary2(dacName, dacTimestamp, dacSizeOfImage, &pDacModulePath)) ||
-                    pDacModulePath == NULL)
+                pCached = FindProvidedModule(dacName, dacTimestamp, dacSizeOfImage);
+                if (pCached != NULL && pCached->pwszPath != NULL)
                 {
-                    hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
+                    hDac = pCached->hModule;
+                    pDacModulePath = DuplicateModulePath(pCached->pwszPath);
+                    if (pDacModulePath == NULL)
+                    {
+                        hr = E_OUTOFMEMORY;
+                    }
                 }
-
-                if (SUCCEEDED(hr))
+                else
                 {
-                    hDac = LoadLibraryW(pDacModulePath);
-                    if (hDac == NULL)
+                    // Ask library provider for dac
+                    if (FAILED(pLibraryProvider2->ProvideLibrary2(dacName, dacTimestamp, dacSizeOfImage, &pDacModulePath)) ||
+                        pDacModulePath == NULL)
                     {
-                        hr = HRESULT_FROM_WIN32(GetLastError());
+                        hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
+                    }
+
+                    if (SUCCEEDED(hr))
+                    {
+                        hDac = LoadLibraryW(pDacModulePath);
+                        if (hDac == NULL)
+                        {
+                            hr = HRESULT_FROM_WIN32(GetLastError());
+                        }
+                        else
+                        {
+                            RememberProvidedModule(dacName, dacTimestamp, dacSizeOfImage, hDac, pDacModulePath);
+                        }
                     }
                 }
             }
@@ -189,24 +297,42 @@ STDMETHODIMP CLRDebuggingImpl::OpenVirtualProcess(
             pLibraryProvider2->Release();
         }
         else {
+            ProvidedModule* pCached = FindProvidedModule(dbiName, dbiTimestamp, dbiSizeOfImage);
+            if (pCached != NULL)
+            {
+                hDbi = pCached->hModule;
+            }
             // Ask library provider for dbi
-            if (FAILED(pLibraryProvider->ProvideLibrary(dbiName, dbiTimestamp, dbiSizeOfImage, &hDbi)) ||
+            else if (FAILED(pLibraryProvider->ProvideLibrary(dbiName, dbiTimestamp, dbiSizeOfImage, &hDbi)) ||
                 hDbi == NULL)
             {
                 hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
             }
+            else
+            {
+                RememberProvidedModule(dbiName, dbiTimestamp, dbiSizeOfImage, hDbi, NULL);
+            }
 
             if (SUCCEEDED(hr))
             {
                 // Adjust the timestamp and size of image if this DAC is a known buggy version and needs to be retargeted
                 RetargetDacIfNeeded(&dacTimestamp, &dacSizeOfImage);
 
+                pCached = FindProvidedModule(dacName, dacTimestamp, dacSizeOfImage);
+                if (pCached != NULL)
+                {
+                    hDac = pCached->hModule;
+                }
                 // ask library provider for dac
-                if (FAILED(pLibraryProvider->ProvideLibrary(dacName, dacTimestamp, dacSizeOfImage, &hDac)) ||
+                else if (FAILED(pLibraryProvider->ProvideLibrary(dacName, dacTimestamp, dacSizeOfImage, &hDac)) ||
                     hDac == NULL)
                 {
                     hr = CORDBG_E_LIBRARY_PROVIDER_ERROR;
                 }
+                else
+                {
+                    RememberProvidedModule(dacName, dacTimestamp, dacSizeOfImage, hDac, NULL);
+                }
             }
         }
 
@@ -395,6 +521,110 @@ struct CLR_DEBUG_RESOURCE
     DWORD dwDbiSizeOfImage;
 };
 
+#ifndef FEATURE_PAL
+
+// Persistent machine-wide cache of the facts GetCLRInfo derives per runtime
+// build: triage machines attach to the same few runtime builds hundreds of
+// times a day, and the resource-section parsing is identical every time.
+// Records are keyed by the runtime image's machine, link timestamp, size of
+// image and the requested SKU, which together identify a build.  The file
+// lives in the temp directory, is fixed-size-record binary, and is strictly
+// best effort - any read or format problem just means a normal probe.
+// Set SOS_DISABLE_RUNTIME_INFO_CACHE to bypass it entirely.
+
+#define RUNTIME_INFO_CACHE_MAGIC "CLRRTIC1"
+#define RUNTIME_INFO_CACHE_NAME_CHARS 64
+
+struct RuntimeInfoCacheRecord
+{
+    // key
+    WORD  wMachine;
+    WORD  wReserved;
+    DWORD dwModuleTimeStamp;
+    DWORD dwModuleSizeOfImage;
+    GUID  skuId;
+
+    // cached probe results
+    CLR_DEBUGGING_VERSION version;
+    DWORD dwDbiTimeStamp;
+    DWORD dwDbiSizeOfImage;
+    DWORD dwDacTimeStamp;
+    DWORD dwDacSizeOfImage;
+    WCHAR dbiName[RUNTIME_INFO_CACHE_NAME_CHARS];
+    WCHAR dacName[RUNTIME_INFO_CACHE_NAME_CHARS];
+};
+
+static bool GetRuntimeInfoCachePath(char* path, size_t pathChars)
+{
+    if (getenv("SOS_DISABLE_RUNTIME_INFO_CACHE") != NULL)
+        return false;
+
+    char tempPath[MAX_PATH];
+    DWORD length = GetTempPathA(ARRAYSIZE(tempPath), tempPath);
+    if (length == 0 || length >= ARRAYSIZE(tempPath))
+        return false;
+
+    if (sprintf_s(path, pathChars, "%sclr-runtime-info.cache", tempPath) < 0)
+        return false;
+    return true;
+}
+
+static bool LookupRuntimeInfoCache(const RuntimeInfoCacheRecord& key, RuntimeInfoCacheRecord* pRecord)
+{
+    char path[MAX_PATH];
+    if (!GetRuntimeInfoCachePath(path, ARRAYSIZE(path)))
+        return false;
+
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || file == NULL)
+        return false;
+
+    bool found = false;
+    char magic[sizeof(RUNTIME_INFO_CACHE_MAGIC) - 1];
+    if (fread(magic, sizeof(magic), 1, file) == 1 &&
+        memcmp(magic, RUNTIME_INFO_CACHE_MAGIC, sizeof(magic)) == 0)
+    {
+        RuntimeInfoCacheRecord record;
+        while (fread(&record, sizeof(record), 1, file) == 1)
+        {
+            if (record.wMachine == key.wMachine &&
+                record.dwModuleTimeStamp == key.dwModuleTimeStamp &&
+                record.dwModuleSizeOfImage == key.dwModuleSizeOfImage &&
+                record.skuId == key.skuId)
+            {
+                *pRecord = record;
+                found = true;
+                break;
+            }
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+static void StoreRuntimeInfoCache(const RuntimeInfoCacheRecord& record)
+{
+    char path[MAX_PATH];
+    if (!GetRuntimeInfoCachePath(path, ARRAYSIZE(path)))
+        return;
+
+    // Append-only with the magic written on creation; a torn append leaves a
+    // short trailing record that the fixed-size reads above simply ignore.
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "ab") != 0 || file == NULL)
+        return;
+
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0)
+    {
+        fwrite(RUNTIME_INFO_CACHE_MAGIC, sizeof(RUNTIME_INFO_CACHE_MAGIC) - 1, 1, file);
+    }
+    fwrite(&record, sizeof(record), 1, file);
+    fclose(file);
+}
+
+#endif // !FEATURE_PAL
+
 // Checks to see if a module is a CLR and if so, fetches the debug data
 // from the embedded resource
 //
@@ -423,16 +653,62 @@ HRESULT CLRDebuggingImpl::GetCLRInfo(ICorDebugDataTarget* pDataTarget,
                                      DWORD  dwDacNameCharCount)
 {
 #ifndef FEATURE_PAL
+    // One header cache for the whole probe: the PE headers, the resource
+    // directories and the resources themselves are all parsed against block
+    // reads that survive across the helper calls below, so probing a module
+    // costs a handful of target round trips instead of one per field.
+    DataTargetBufferedReader reader(pDataTarget);
+
     WORD imageFileMachine = 0;
     DWORD resourceSectionRVA = 0;
-    HRESULT hr = GetMachineAndResourceSectionRVA(pDataTarget, moduleBaseAddress, &imageFileMachine, &resourceSectionRVA);
+    HRESULT hr = GetMachineAndResourceSectionRVA(reader, moduleBaseAddress, &imageFileMachine, &resourceSectionRVA);
+
+    // Identify the build - machine, link timestamp, size of image - from the
+    // headers the reader has already staged, and consult the persistent cache
+    // before doing any resource-section parsing.  The second and later attach
+    // to any process running the same runtime build hits here.
+    RuntimeInfoCacheRecord cacheKey = {};
+    bool cacheKeyValid = false;
+    if (SUCCEEDED(hr))
+    {
+        IMAGE_DOS_HEADER dosHeader;
+        IMAGE_FILE_HEADER fileHeader;
+        DWORD sizeOfImage = 0;
+        // SizeOfImage is at offset 56 of the optional header in both PE32
+        // and PE32+.
+        if (SUCCEEDED(reader.Read(moduleBaseAddress, (BYTE*)&dosHeader, sizeof(dosHeader))) &&
+            SUCCEEDED(reader.Read(moduleBaseAddress + dosHeader.e_lfanew + 4, (BYTE*)&fileHeader, IMAGE_SIZEOF_FILE_HEADER)) &&
+            SUCCEEDED(reader.Read(moduleBaseAddress + dosHeader.e_lfanew + 4 + IMAGE_SIZEOF_FILE_HEADER + 56, (BYTE*)&sizeOfImage, sizeof(sizeOfImage))))
+        {
+            cacheKey.wMachine = fileHeader.Machine;
+            cacheKey.dwModuleTimeStamp = fileHeader.TimeDateStamp;
+            cacheKey.dwModuleSizeOfImage = sizeOfImage;
+            cacheKey.skuId = m_skuId;
+            cacheKeyValid = true;
+        }
+
+        RuntimeInfoCacheRecord cached;
+        if (cacheKeyValid && LookupRuntimeInfoCache(cacheKey, &cached) &&
+            wcslen(cached.dbiName) < dwDbiNameCharCount &&
+            wcslen(cached.dacName) < dwDacNameCharCount)
+        {
+            *pVersion = cached.version;
+            *pdwDbiTimeStamp = cached.dwDbiTimeStamp;
+            *pdwDbiSizeOfImage = cached.dwDbiSizeOfImage;
+            *pdwDacTimeStamp = cached.dwDacTimeStamp;
+            *pdwDacSizeOfImage = cached.dwDacSizeOfImage;
+            swprintf_s(pDbiName, dwDbiNameCharCount, W("%s"), cached.dbiName);
+            swprintf_s(pDacName, dwDacNameCharCount, W("%s"), cached.dacName);
+            return S_OK;
+        }
+    }
 
     // We want the version resource which has type = RT_VERSION = 16, name = 1, language = 0x409
     DWORD versionResourceRVA = 0;
     DWORD versionResourceSize = 0;
     if(SUCCEEDED(hr))
     {
-        hr = GetResourceRvaFromResourceSectionRva(pDataTarget, moduleBaseAddress, resourceSectionRVA, 16, 1, 0x409,
+        hr = GetResourceRvaFromResourceSectionRva(reader, moduleBaseAddress, resourceSectionRVA, 16, 1, 0x409,
                  &versionResourceRVA, &versionResourceSize);
     }
 
@@ -444,7 +720,7 @@ HRESULT CLRDebuggingImpl::GetCLRInfo(ICorDebugDataTarget* pDataTarget,
         // (16 WCHARS including the null terminator) 
         // then padding to a 32-bit boundary, then the VS_FIXEDFILEINFO struct
         DWORD fixedFileInfoRVA = ((versionResourceRVA + 3*2 + 16*2 + 3)/4)*4;
-        hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + fixedFileInfoRVA, (BYTE*)&fixedFileInfo, sizeof(fixedFileInfo));
+        hr = reader.Read(moduleBaseAddress + fixedFileInfoRVA, (BYTE*)&fixedFileInfo, sizeof(fixedFileInfo));
     }
 
     //Verify the signature on the version resource
@@ -507,7 +783,7 @@ HRESULT CLRDebuggingImpl::GetCLRInfo(ICorDebugDataTarget* pDataTarget,
         const WCHAR * resourceName = W("CLRDEBUGINFOCORESYSARM");
 #endif        
 
-        hrGetResource = GetResourceRvaFromResourceSectionRvaByName(pDataTarget, moduleBaseAddress, resourceSectionRVA, 10, resourceName, 0,
+        hrGetResource = GetResourceRvaFromResourceSectionRvaByName(reader, moduleBaseAddress, resourceSectionRVA, 10, resourceName, 0,
                  &debugResourceRVA, &debugResourceSize);
         useCrossPlatformNaming = SUCCEEDED(hrGetResource);        
 
@@ -524,7 +800,7 @@ HRESULT CLRDebuggingImpl::GetCLRInfo(ICorDebugDataTarget* pDataTarget,
         // if this is windows, and if host_arch matches target arch then we can fallback to searching for CLRDEBUGINFO on failure
         if(FAILED(hrGetResource) && (imageFileMachine == _HOST_MACHINE_TYPE))
         {
-            hrGetResource = GetResourceRvaFromResourceSectionRvaByName(pDataTarget, moduleBaseAddress, resourceSectionRVA, 10, W("CLRDEBUGINFO"), 0,
+            hrGetResource = GetResourceRvaFromResourceSectionRvaByName(reader, moduleBaseAddress, resourceSectionRVA, 10, W("CLRDEBUGINFO"), 0,
                  &debugResourceRVA, &debugResourceSize);
         }
 
@@ -544,7 +820,7 @@ HRESULT CLRDebuggingImpl::GetCLRInfo(ICorDebugDataTarget* pDataTarget,
     // Get the special debug resource from the image and return the results
     if(SUCCEEDED(hr))
     {
-        hr = ReadFromDataTarget(pDataTarget, moduleBaseAddress + debugResourceRVA, (BYTE*)&debugResource, sizeof(debugResource));
+        hr = reader.Read(moduleBaseAddress + debugResourceRVA, (BYTE*)&debugResource, sizeof(debugResource));
     }
     if(SUCCEEDED(hr) && (debugResource.dwVersion != 0))
     {
@@ -584,6 +860,22 @@ HRESULT CLRDebuggingImpl::GetCLRInfo(ICorDebugDataTarget* pDataTarget,
         *pdwDacSizeOfImage = debugResource.dwDacSizeOfImage;
     }
 
+    // Remember the probe results for the next attach to this build.
+    if(SUCCEEDED(hr) && cacheKeyValid &&
+       wcslen(pDbiName) < RUNTIME_INFO_CACHE_NAME_CHARS &&
+       wcslen(pDacName) < RUNTIME_INFO_CACHE_NAME_CHARS)
+    {
+        RuntimeInfoCacheRecord record = cacheKey;
+        record.version = *pVersion;
+        record.dwDbiTimeStamp = *pdwDbiTimeStamp;
+        record.dwDbiSizeOfImage = *pdwDbiSizeOfImage;
+        record.dwDacTimeStamp = *pdwDacTimeStamp;
+        record.dwDacSizeOfImage = *pdwDacSizeOfImage;
+        swprintf_s(record.dbiName, RUNTIME_INFO_CACHE_NAME_CHARS, W("%s"), pDbiName);
+        swprintf_s(record.dacName, RUNTIME_INFO_CACHE_NAME_CHARS, W("%s"), pDacName);
+        StoreRuntimeInfoCache(record);
+    }
+
     // any failure should be interpreted as this module not being a CLR
     if(FAILED(hr))
     {
@@ -0,0 +1,493 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "diagnosticsipc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#endif
+
+namespace DiagnosticsIpc
+{
+
+// "DOTNET_IPC_V1" padded to 14 bytes, exactly as IpcHeader.cs serializes it.
+static const char s_magic[14] = "DOTNET_IPC_V1";
+
+#pragma pack(push, 1)
+struct IpcHeader
+{
+    char     Magic[14];
+    uint16_t Size;          // header + payload bytes
+    uint8_t  CommandSet;
+    uint8_t  CommandId;
+    uint16_t Reserved;
+};
+#pragma pack(pop)
+
+//
+// Transport
+//
+
+void IpcStream::Close()
+{
+    if (mHandle == -1)
+        return;
+#ifdef _WIN32
+    CloseHandle((HANDLE)mHandle);
+#else
+    close((int)mHandle);
+#endif
+    mHandle = -1;
+}
+
+bool IpcStream::Write(const void *buffer, size_t size)
+{
+    const char *p = (const char *)buffer;
+    while (size > 0)
+    {
+#ifdef _WIN32
+        DWORD written = 0;
+        if (!WriteFile((HANDLE)mHandle, p, (DWORD)size, &written, NULL) || written == 0)
+            return false;
+#else
+        ssize_t written = write((int)mHandle, p, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+#endif
+        p += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+bool IpcStream::Read(void *buffer, size_t size, size_t *bytesRead)
+{
+    *bytesRead = 0;
+    if (size == 0)
+        return true;
+#ifdef _WIN32
+    DWORD read = 0;
+    if (!ReadFile((HANDLE)mHandle, buffer, (DWORD)size, &read, NULL))
+        return false;
+    *bytesRead = read;
+    return true;
+#else
+    ssize_t read;
+    do
+    {
+        read = ::read((int)mHandle, buffer, size);
+    } while (read < 0 && errno == EINTR);
+    if (read < 0)
+        return false;
+    *bytesRead = (size_t)read;
+    return true;
+#endif
+}
+
+bool IpcStream::ReadFully(void *buffer, size_t size)
+{
+    char *p = (char *)buffer;
+    while (size > 0)
+    {
+        size_t read = 0;
+        if (!Read(p, size, &read) || read == 0)
+            return false;
+        p += read;
+        size -= read;
+    }
+    return true;
+}
+
+#ifndef _WIN32
+
+// The runtime names its socket dotnet-diagnostic-<pid>-<epoch>-socket in the
+// temp directory; the epoch makes the name unguessable, so we scan for it the
+// same way the managed client does.
+static bool FindSocketPath(int processId, char *path, size_t pathSize)
+{
+    const char *tmpDir = getenv("TMPDIR");
+    if (tmpDir == NULL || *tmpDir == '\0')
+        tmpDir = "/tmp/";
+
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "dotnet-diagnostic-%d-", processId);
+    size_t prefixLen = strlen(prefix);
+
+    DIR *dir = opendir(tmpDir);
+    if (dir == NULL)
+        return false;
+
+    bool found = false;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        size_t nameLen = strlen(entry->d_name);
+        if (nameLen <= prefixLen + 7 ||
+            strncmp(entry->d_name, prefix, prefixLen) != 0 ||
+            strcmp(entry->d_name + nameLen - 7, "-socket") != 0)
+        {
+            continue;
+        }
+        size_t dirLen = strlen(tmpDir);
+        if (dirLen + 1 + nameLen + 1 > pathSize)
+            continue;
+        memcpy(path, tmpDir, dirLen);
+        if (path[dirLen - 1] != '/')
+            path[dirLen++] = '/';
+        memcpy(path + dirLen, entry->d_name, nameLen + 1);
+        found = true;
+        break;
+    }
+    closedir(dir);
+    return found;
+}
+
+#endif // !_WIN32
+
+bool Connect(int processId, IpcStream &stream, int timeoutMs)
+{
+    stream.Close();
+
+#ifdef _WIN32
+    char pipeName[64];
+    sprintf_s(pipeName, sizeof(pipeName), "\\\\.\\pipe\\dotnet-diagnostic-%d", processId);
+
+    if (!WaitNamedPipeA(pipeName, (DWORD)timeoutMs))
+        return false;
+
+    HANDLE pipe = CreateFileA(pipeName, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                              OPEN_EXISTING, SECURITY_SQOS_PRESENT | SECURITY_IMPERSONATION, NULL);
+    if (pipe == INVALID_HANDLE_VALUE)
+        return false;
+
+    stream.mHandle = (intptr_t)pipe;
+    return true;
+#else
+    (void)timeoutMs;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (!FindSocketPath(processId, addr.sun_path, sizeof(addr.sun_path)))
+        return false;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    stream.mHandle = (intptr_t)fd;
+    return true;
+#endif
+}
+
+//
+// Message framing
+//
+
+bool SendCommand(IpcStream &stream,
+                 uint8_t commandSet, uint8_t commandId,
+                 const void *payload, uint16_t payloadSize,
+                 uint8_t *responseCommandId,
+                 void *payloadBuffer, size_t payloadBufferSize, size_t *responsePayloadSize)
+{
+    IpcHeader header;
+    memcpy(header.Magic, s_magic, sizeof(header.Magic));
+    header.Size = (uint16_t)(sizeof(IpcHeader) + payloadSize);
+    header.CommandSet = commandSet;
+    header.CommandId = commandId;
+    header.Reserved = 0;
+
+    if (!stream.Write(&header, sizeof(header)))
+        return false;
+    if (payloadSize != 0 && !stream.Write(payload, payloadSize))
+        return false;
+
+    IpcHeader response;
+    if (!stream.ReadFully(&response, sizeof(response)))
+        return false;
+    if (memcmp(response.Magic, s_magic, sizeof(s_magic)) != 0 || response.Size < sizeof(IpcHeader))
+        return false;
+
+    *responseCommandId = response.CommandId;
+
+    size_t remaining = response.Size - sizeof(IpcHeader);
+    size_t wanted = remaining < payloadBufferSize ? remaining : payloadBufferSize;
+    if (wanted != 0 && !stream.ReadFully(payloadBuffer, wanted))
+        return false;
+    *responsePayloadSize = wanted;
+
+    // Drain anything the caller's buffer couldn't hold so the stream stays
+    // framed for continuations.
+    remaining -= wanted;
+    char scratch[256];
+    while (remaining > 0)
+    {
+        size_t chunk = remaining < sizeof(scratch) ? remaining : sizeof(scratch);
+        if (!stream.ReadFully(scratch, chunk))
+            return false;
+        remaining -= chunk;
+    }
+    return true;
+}
+
+//
+// Payload serialization.  The writer mirrors BinaryWriter usage on the
+// managed side: little-endian fixed-width integers, strings as a UTF-16
+// character count (including the terminator) followed by the characters.
+//
+
+class PayloadWriter
+{
+public:
+    PayloadWriter() : mSize(0), mOverflow(false) {}
+
+    void WriteUInt32(uint32_t value) { WriteBytes(&value, sizeof(value)); }
+    void WriteUInt64(uint64_t value) { WriteBytes(&value, sizeof(value)); }
+
+    // Provider names and filter strings are ASCII; each byte widens to one
+    // UTF-16 code unit, which matches what BinaryWriter produces for them.
+    void WriteString(const char *value)
+    {
+        if (value == NULL)
+        {
+            WriteUInt32(0);
+            return;
+        }
+        uint32_t chars = (uint32_t)strlen(value) + 1;
+        WriteUInt32(chars);
+        for (uint32_t i = 0; i < chars; i++)
+        {
+            uint16_t wide = (uint16_t)(unsigned char)value[i];
+            WriteBytes(&wide, sizeof(wide));
+        }
+    }
+
+    const void *Data() const { return mBuffer; }
+    uint16_t Size() const { return (uint16_t)mSize; }
+    bool Overflowed() const { return mOverflow; }
+
+private:
+    void WriteBytes(const void *bytes, size_t size)
+    {
+        // Message size is a uint16 on the wire, so the buffer matches the
+        // largest payload the protocol can frame.
+        if (mSize + size > sizeof(mBuffer))
+        {
+            mOverflow = true;
+            return;
+        }
+        memcpy(mBuffer + mSize, bytes, size);
+        mSize += size;
+    }
+
+    char mBuffer[0xFFFF - sizeof(IpcHeader)];
+    size_t mSize;
+    bool mOverflow;
+};
+
+//
+// High-level operations
+//
+
+int32_t GenerateCoreDump(int processId, const char *dumpName, DumpType dumpType, bool diagnostics)
+{
+    if (dumpName == NULL || *dumpName == '\0')
+        return -1;
+
+    PayloadWriter payload;
+    payload.WriteString(dumpName);
+    payload.WriteUInt32((uint32_t)dumpType);
+    payload.WriteUInt32(diagnostics ? 1 : 0);
+    if (payload.Overflowed())
+        return -1;
+
+    IpcStream stream;
+    if (!Connect(processId, stream))
+        return -1;
+
+    uint8_t responseCommand = ServerCommandError;
+    int32_t hr = -1;
+    size_t responseSize = 0;
+    if (!SendCommand(stream, CommandSetDump, DumpGenerateCoreDump,
+                     payload.Data(), payload.Size(),
+                     &responseCommand, &hr, sizeof(hr), &responseSize))
+    {
+        return -1;
+    }
+    if (responseSize < sizeof(hr))
+        return -1;
+    return hr;
+}
+
+bool CollectTracing(int processId,
+                    uint32_t circularBufferSizeMB,
+                    SerializationFormat format,
+                    const Provider *providers, size_t providerCount,
+                    IpcStream &stream, uint64_t *sessionId)
+{
+    *sessionId = 0;
+    if (circularBufferSizeMB == 0 || providers == NULL || providerCount == 0)
+        return false;
+
+    PayloadWriter payload;
+    payload.WriteUInt32(circularBufferSizeMB);
+    payload.WriteUInt32((uint32_t)format);
+    payload.WriteUInt32((uint32_t)providerCount);
+    for (size_t i = 0; i < providerCount; i++)
+    {
+        payload.WriteUInt64(providers[i].Keywords);
+        payload.WriteUInt32(providers[i].EventLevel);
+        payload.WriteString(providers[i].Name);
+        payload.WriteString(providers[i].FilterData);
+    }
+    if (payload.Overflowed())
+        return false;
+
+    if (!Connect(processId, stream))
+        return false;
+
+    uint8_t responseCommand = ServerCommandError;
+    uint64_t responsePayload = 0;
+    size_t responseSize = 0;
+    if (!SendCommand(stream, CommandSetEventPipe, EventPipeCollectTracing,
+                     payload.Data(), payload.Size(),
+                     &responseCommand, &responsePayload, sizeof(responsePayload), &responseSize))
+    {
+        stream.Close();
+        return false;
+    }
+    if (responseCommand != ServerCommandOK || responseSize < sizeof(uint64_t))
+    {
+        stream.Close();
+        return false;
+    }
+
+    // The stream now carries the nettrace payload; the caller owns it.
+    *sessionId = responsePayload;
+    return true;
+}
+
+uint64_t StopTracing(int processId, uint64_t sessionId)
+{
+    if (sessionId == 0)
+        return 0;
+
+    IpcStream stream;
+    if (!Connect(processId, stream))
+        return 0;
+
+    uint8_t responseCommand = ServerCommandError;
+    uint64_t responsePayload = 0;
+    size_t responseSize = 0;
+    if (!SendCommand(stream, CommandSetEventPipe, EventPipeStopTracing,
+                     &sessionId, sizeof(sessionId),
+                     &responseCommand, &responsePayload, sizeof(responsePayload), &responseSize))
+    {
+        return 0;
+    }
+    if (responseCommand != ServerCommandOK || responseSize < sizeof(uint64_t))
+        return 0;
+    return responsePayload;
+}
+
+uint64_t StreamToFile(IpcStream &stream, const char *filePath, const volatile int *keepRunning)
+{
+    uint64_t total = 0;
+
+#ifdef __linux__
+    // Fast path: move socket bytes to the file through a pipe with splice(2),
+    // so the payload never crosses into user space.
+    int file = open(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0)
+        return 0;
+
+    int pipefd[2];
+    if (pipe(pipefd) == 0)
+    {
+        int sock = (int)stream.Handle();
+
+        for (;;)
+        {
+            if (keepRunning != NULL && !*keepRunning)
+                break;
+            ssize_t moved = splice(sock, NULL, pipefd[1], NULL, 1 << 20, SPLICE_F_MOVE);
+            if (moved < 0 && errno == EINTR)
+                continue;
+            if (moved <= 0)
+                break;
+            ssize_t left = moved;
+            while (left > 0)
+            {
+                ssize_t written = splice(pipefd[0], NULL, file, NULL, (size_t)left, SPLICE_F_MOVE);
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                {
+                    left = -1;
+                    break;
+                }
+                left -= written;
+                total += (uint64_t)written;
+            }
+            if (left != 0)
+                break;
+        }
+        close(pipefd[0]);
+        close(pipefd[1]);
+        close(file);
+        return total;
+    }
+    close(file);
+    // fall through to the buffered loop if the pipe couldn't be created
+#endif
+
+    FILE *out = fopen(filePath, "wb");
+    if (out == NULL)
+        return 0;
+
+    const size_t kBufferSize = 1 << 20;
+    char *buffer = (char *)malloc(kBufferSize);
+    if (buffer != NULL)
+    {
+        for (;;)
+        {
+            if (keepRunning != NULL && !*keepRunning)
+                break;
+            size_t read = 0;
+            if (!stream.Read(buffer, kBufferSize, &read) || read == 0)
+                break;
+            if (fwrite(buffer, 1, read, out) != read)
+                break;
+            total += read;
+        }
+        free(buffer);
+    }
+    fclose(out);
+    return total;
+}
+
+} // namespace DiagnosticsIpc
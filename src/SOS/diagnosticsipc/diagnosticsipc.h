@@ -0,0 +1,171 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+// Native client for the runtime's diagnostics IPC protocol (the wire format
+// implemented by src/Microsoft.Diagnostics.Tools.RuntimeClient/DiagnosticsIpc
+// on the managed side).  It speaks to the target over the same transport the
+// runtime listens on - a Unix domain socket in the temp directory on Unix, a
+// named pipe on Windows - so an EventPipe trace can be collected or a dump
+// triggered from native tooling without hosting a runtime.  The library has
+// no PAL or debugger dependencies; it is usable standalone by fleet
+// collectors and from SOS commands alike.
+
+#ifndef __DIAGNOSTICSIPC_H__
+#define __DIAGNOSTICSIPC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace DiagnosticsIpc
+{
+
+// Command sets and ids mirror IpcCommands.cs; the values are the protocol.
+enum CommandSet : uint8_t
+{
+    CommandSetDump      = 0x01,
+    CommandSetEventPipe = 0x02,
+    CommandSetProfiler  = 0x03,
+    CommandSetServer    = 0xFF,
+};
+
+enum ServerCommandId : uint8_t
+{
+    ServerCommandOK    = 0x00,
+    ServerCommandError = 0xFF,
+};
+
+enum EventPipeCommandId : uint8_t
+{
+    EventPipeStopTracing    = 0x01,
+    EventPipeCollectTracing = 0x02,
+};
+
+enum DumpCommandId : uint8_t
+{
+    DumpGenerateCoreDump = 0x01,
+};
+
+enum DumpType : uint32_t
+{
+    DumpNormal   = 1,
+    DumpWithHeap = 2,
+    DumpTriage   = 3,
+    DumpFull     = 4,
+};
+
+enum SerializationFormat : uint32_t
+{
+    FormatNetPerf  = 0,
+    FormatNetTrace = 1,
+};
+
+// One EventPipe provider in a session configuration.  Name and filter data
+// are expected to be ASCII; the wire format carries them as UTF-16.
+struct Provider
+{
+    uint64_t Keywords;
+    uint32_t EventLevel;
+    const char *Name;
+    const char *FilterData;    // may be NULL
+};
+
+// A connected transport to one target process.  Close() is idempotent and
+// the destructor closes too, so a stream can be stack-scoped.
+class IpcStream
+{
+public:
+    IpcStream() : mHandle(-1) {}
+    ~IpcStream() { Close(); }
+
+    bool IsOpen() const { return mHandle != -1; }
+    void Close();
+
+    // The raw transport handle (fd / HANDLE), for callers that hand the
+    // stream to OS primitives like splice or poll.
+    intptr_t Handle() const { return mHandle; }
+
+    // Both return false on a closed/broken transport.  Read returns short
+    // counts the way the underlying socket does; ReadFully loops until
+    // size bytes arrived or the peer closed.
+    bool Write(const void *buffer, size_t size);
+    bool Read(void *buffer, size_t size, size_t *bytesRead);
+    bool ReadFully(void *buffer, size_t size);
+
+private:
+    friend bool Connect(int processId, IpcStream &stream, int timeoutMs);
+    intptr_t mHandle;
+
+    IpcStream(const IpcStream &);
+    IpcStream &operator=(const IpcStream &);
+};
+
+// Connects to the diagnostics server of the given process.  On Unix the
+// socket is found by scanning the temp directory for the runtime's
+// dotnet-diagnostic-<pid>-<epoch>-socket name; on Windows the named pipe
+// name is derived from the pid directly.
+bool Connect(int processId, IpcStream &stream, int timeoutMs = 3000);
+
+// Sends one framed message and reads the response header plus payload.
+// The response payload is written into payloadBuffer (up to payloadBufferSize
+// bytes; the rest is drained and dropped) and *commandId receives the
+// server's response command (ServerCommandOK / ServerCommandError).
+bool SendCommand(IpcStream &stream,
+                 uint8_t commandSet, uint8_t commandId,
+                 const void *payload, uint16_t payloadSize,
+                 uint8_t *responseCommandId,
+                 void *payloadBuffer, size_t payloadBufferSize, size_t *payloadSize2);
+
+//
+// High-level operations, one per protocol command the fleet tooling needs.
+//
+
+// Triggers a core dump in the target.  Returns the runtime's HRESULT
+// (0 on success) or -1 when the transport failed.
+int32_t GenerateCoreDump(int processId, const char *dumpName, DumpType dumpType, bool diagnostics);
+
+// Starts an EventPipe session.  On success returns true, stores the session
+// id, and leaves the stream connected: the nettrace payload follows on the
+// same stream until the session is stopped from a second connection.
+bool CollectTracing(int processId,
+                    uint32_t circularBufferSizeMB,
+                    SerializationFormat format,
+                    const Provider *providers, size_t providerCount,
+                    IpcStream &stream, uint64_t *sessionId);
+
+// Stops the given EventPipe session over a new connection.  Returns the
+// session id echoed by the runtime, or 0 on failure.
+uint64_t StopTracing(int processId, uint64_t sessionId);
+
+// Streams the trace payload from an open CollectTracing stream to a file.
+// On Linux the bytes move socket->pipe->file through splice(2) without
+// crossing user space; elsewhere a large buffer loop is used.  Returns the
+// number of bytes written; *keepRunning (when non-NULL) is polled so a
+// caller can stop the pump from another thread after issuing StopTracing.
+uint64_t StreamToFile(IpcStream &stream, const char *filePath, const volatile int *keepRunning = 0);
+
+// Geometry of the bounded pipeline PumpToFile builds: a fixed ring of
+// BufferCount slots of BufferSize bytes each is the only buffering between
+// the socket reader and the file writer, so the client's memory use is
+// BufferSize * BufferCount regardless of event rate.
+struct PumpOptions
+{
+    size_t BufferSize;     // bytes per ring slot (default 1 MB)
+    size_t BufferCount;    // slots in the ring (default 16)
+
+    PumpOptions() : BufferSize(1 << 20), BufferCount(16) {}
+};
+
+// Streams the trace payload to a file through the bounded ring.  The calling
+// thread reads the socket; a writer thread drains filled slots to the file
+// with positional gathered writes (pwritev).  When the writer falls behind,
+// the reader blocks on a free slot instead of growing buffers - the
+// backpressure propagates to the runtime's own circular buffer.  Returns the
+// number of bytes written; *keepRunning (when non-NULL) is polled so a
+// caller can stop the pump after issuing StopTracing.
+uint64_t PumpToFile(IpcStream &stream, const char *filePath,
+                    const PumpOptions *options = 0, const volatile int *keepRunning = 0);
+
+} // namespace DiagnosticsIpc
+
+#endif // __DIAGNOSTICSIPC_H__
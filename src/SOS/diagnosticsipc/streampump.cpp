@@ -0,0 +1,332 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+// Bounded streaming pipeline for trace collection on memory-constrained
+// hosts.  A fixed ring of slots sits between the socket reader (the calling
+// thread) and the file writer (one worker thread); a full ring blocks the
+// reader rather than allocating, so a multi-GB collection holds a constant
+// client footprint no matter how fast events arrive.  The writer drains
+// contiguous runs of filled slots with one positional gathered write each,
+// which keeps the file offset independent of any other users of the
+// descriptor and amortizes the syscall over several slots.
+
+#include "diagnosticsipc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#endif
+
+namespace DiagnosticsIpc
+{
+
+// The most slots one gathered write covers; small enough to stay well under
+// any IOV_MAX, large enough that the writer keeps up with one syscall per
+// several megabytes.
+static const size_t kMaxGatherSlots = 8;
+
+namespace
+{
+
+struct PumpState
+{
+    // ring storage
+    char   *storage;
+    size_t *lengths;        // filled byte count per slot
+    size_t  slotSize;
+    size_t  slotCount;
+
+    // ring indices; [tail, tail+filled) are slots waiting for the writer
+    size_t  tail;
+    size_t  filled;
+
+    bool    readerDone;     // no more slots will be filled
+    bool    writerFailed;
+
+    uint64_t bytesWritten;
+
+#ifdef _WIN32
+    HANDLE  file;
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE slotFreed;
+    CONDITION_VARIABLE slotFilled;
+#else
+    int     file;
+    pthread_mutex_t lock;
+    pthread_cond_t slotFreed;
+    pthread_cond_t slotFilled;
+#endif
+
+    char *Slot(size_t index) { return storage + index * slotSize; }
+};
+
+#ifdef _WIN32
+
+static void PumpLock(PumpState *state)      { EnterCriticalSection(&state->lock); }
+static void PumpUnlock(PumpState *state)    { LeaveCriticalSection(&state->lock); }
+static void WaitFreed(PumpState *state)     { SleepConditionVariableCS(&state->slotFreed, &state->lock, INFINITE); }
+static void WaitFilled(PumpState *state)    { SleepConditionVariableCS(&state->slotFilled, &state->lock, INFINITE); }
+static void SignalFreed(PumpState *state)   { WakeConditionVariable(&state->slotFreed); }
+static void SignalFilled(PumpState *state)  { WakeConditionVariable(&state->slotFilled); }
+
+#else
+
+static void PumpLock(PumpState *state)      { pthread_mutex_lock(&state->lock); }
+static void PumpUnlock(PumpState *state)    { pthread_mutex_unlock(&state->lock); }
+static void WaitFreed(PumpState *state)     { pthread_cond_wait(&state->slotFreed, &state->lock); }
+static void WaitFilled(PumpState *state)    { pthread_cond_wait(&state->slotFilled, &state->lock); }
+static void SignalFreed(PumpState *state)   { pthread_cond_signal(&state->slotFreed); }
+static void SignalFilled(PumpState *state)  { pthread_cond_signal(&state->slotFilled); }
+
+#endif
+
+// Writes one contiguous run of filled slots at the given file offset.
+// Returns false on I/O failure.
+static bool WriteRun(PumpState *state, size_t first, size_t count, uint64_t offset)
+{
+#ifdef _WIN32
+    // Windows has no gathered positional write for ordinary handles, so the
+    // run is written slot by slot through OVERLAPPED offsets.
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t index = first + i;
+        size_t length = state->lengths[index];
+        size_t done = 0;
+        while (done < length)
+        {
+            OVERLAPPED overlapped;
+            memset(&overlapped, 0, sizeof(overlapped));
+            overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+            overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+            DWORD written = 0;
+            if (!WriteFile(state->file, state->Slot(index) + done, (DWORD)(length - done), &written, &overlapped) || written == 0)
+                return false;
+            done += written;
+            offset += written;
+        }
+    }
+    return true;
+#else
+    struct iovec iov[kMaxGatherSlots];
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        iov[i].iov_base = state->Slot(first + i);
+        iov[i].iov_len = state->lengths[first + i];
+        total += iov[i].iov_len;
+    }
+
+    size_t done = 0;
+    size_t skip = 0;
+    while (done < total)
+    {
+        // Re-point the vector past what previous short writes consumed.
+        struct iovec adjusted[kMaxGatherSlots];
+        size_t n = 0;
+        size_t toSkip = skip;
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t len = iov[i].iov_len;
+            if (toSkip >= len)
+            {
+                toSkip -= len;
+                continue;
+            }
+            adjusted[n].iov_base = (char *)iov[i].iov_base + toSkip;
+            adjusted[n].iov_len = len - toSkip;
+            toSkip = 0;
+            n++;
+        }
+
+        ssize_t written = pwritev(state->file, adjusted, (int)n, (off_t)(offset + done));
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        done += (size_t)written;
+        skip += (size_t)written;
+    }
+    return true;
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI WriterThread(LPVOID parameter)
+#else
+static void *WriterThread(void *parameter)
+#endif
+{
+    PumpState *state = (PumpState *)parameter;
+    uint64_t offset = 0;
+
+    PumpLock(state);
+    for (;;)
+    {
+        while (state->filled == 0 && !state->readerDone)
+            WaitFilled(state);
+
+        if (state->filled == 0)
+            break;    // reader finished and the ring is drained
+
+        // Take the longest contiguous run from the tail the gather limit and
+        // the ring edge allow, write it outside the lock.
+        size_t first = state->tail;
+        size_t run = state->filled;
+        if (run > kMaxGatherSlots)
+            run = kMaxGatherSlots;
+        if (first + run > state->slotCount)
+            run = state->slotCount - first;
+
+        uint64_t runBytes = 0;
+        for (size_t i = 0; i < run; i++)
+            runBytes += state->lengths[first + i];
+
+        PumpUnlock(state);
+        bool ok = WriteRun(state, first, run, offset);
+        PumpLock(state);
+
+        if (!ok)
+        {
+            state->writerFailed = true;
+            SignalFreed(state);
+            break;
+        }
+
+        offset += runBytes;
+        state->bytesWritten += runBytes;
+        state->tail = (state->tail + run) % state->slotCount;
+        state->filled -= run;
+        SignalFreed(state);
+    }
+    PumpUnlock(state);
+    return 0;
+}
+
+} // anonymous namespace
+
+uint64_t PumpToFile(IpcStream &stream, const char *filePath,
+                    const PumpOptions *options, const volatile int *keepRunning)
+{
+    PumpOptions defaults;
+    if (options == NULL)
+        options = &defaults;
+    if (options->BufferSize == 0 || options->BufferCount < 2)
+        return 0;
+
+    PumpState state;
+    memset(&state, 0, sizeof(state));
+    state.slotSize = options->BufferSize;
+    state.slotCount = options->BufferCount;
+
+    state.storage = (char *)malloc(state.slotSize * state.slotCount);
+    state.lengths = (size_t *)malloc(state.slotCount * sizeof(size_t));
+    if (state.storage == NULL || state.lengths == NULL)
+    {
+        free(state.storage);
+        free(state.lengths);
+        return 0;
+    }
+
+#ifdef _WIN32
+    state.file = CreateFileA(filePath, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                             CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    bool fileOk = state.file != INVALID_HANDLE_VALUE;
+#else
+    state.file = open(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool fileOk = state.file >= 0;
+#endif
+    if (!fileOk)
+    {
+        free(state.storage);
+        free(state.lengths);
+        return 0;
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&state.lock);
+    InitializeConditionVariable(&state.slotFreed);
+    InitializeConditionVariable(&state.slotFilled);
+    HANDLE writer = CreateThread(NULL, 0, WriterThread, &state, 0, NULL);
+    bool writerOk = writer != NULL;
+#else
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.slotFreed, NULL);
+    pthread_cond_init(&state.slotFilled, NULL);
+    pthread_t writer;
+    bool writerOk = pthread_create(&writer, NULL, WriterThread, &state) == 0;
+#endif
+
+    if (writerOk)
+    {
+        // Reader loop on the calling thread: fill the slot past the last
+        // filled one, blocking while the ring is full.
+        for (;;)
+        {
+            if (keepRunning != NULL && !*keepRunning)
+                break;
+
+            PumpLock(&state);
+            while (state.filled == state.slotCount && !state.writerFailed)
+                WaitFreed(&state);
+            bool failed = state.writerFailed;
+            size_t index = (state.tail + state.filled) % state.slotCount;
+            PumpUnlock(&state);
+
+            if (failed)
+                break;
+
+            size_t read = 0;
+            if (!stream.Read(state.Slot(index), state.slotSize, &read) || read == 0)
+                break;
+
+            PumpLock(&state);
+            state.lengths[index] = read;
+            state.filled++;
+            SignalFilled(&state);
+            PumpUnlock(&state);
+        }
+    }
+
+    PumpLock(&state);
+    state.readerDone = true;
+    SignalFilled(&state);
+    PumpUnlock(&state);
+
+    uint64_t total = 0;
+    if (writerOk)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(writer, INFINITE);
+        CloseHandle(writer);
+#else
+        pthread_join(writer, NULL);
+#endif
+        total = state.bytesWritten;
+    }
+
+#ifdef _WIN32
+    CloseHandle(state.file);
+    DeleteCriticalSection(&state.lock);
+#else
+    close(state.file);
+    pthread_mutex_destroy(&state.lock);
+    pthread_cond_destroy(&state.slotFreed);
+    pthread_cond_destroy(&state.slotFilled);
+#endif
+    free(state.storage);
+    free(state.lengths);
+    return total;
+}
+
+} // namespace DiagnosticsIpc
@@ -313,7 +313,19 @@ GcInfoDecoder::GcInfoDecoder(
     }
 
 #ifdef PARTIALLY_INTERRUPTIBLE_GC_SUPPORTED
-    if(flags & (DECODE_INTERRUPTIBILITY | DECODE_GC_LIFETIMES))
+    if(flags & DECODE_SLOTS_ONLY)
+    {
+        // The caller only reads the slot table and never consults the
+        // safe-point index, so skip the fixed-width offset table without
+        // the binary search FindSafePoint would do.
+        m_SafePointIndex = m_NumSafePoints;
+        if(m_NumSafePoints != 0)
+        {
+            UINT32 numBitsPerOffset = CeilOfLog2(NORMALIZE_CODE_OFFSET(m_CodeLength));
+            m_Reader.Skip(m_NumSafePoints * numBitsPerOffset);
+        }
+    }
+    else if(flags & (DECODE_INTERRUPTIBILITY | DECODE_GC_LIFETIMES))
     {
         if(m_NumSafePoints)
         {
@@ -622,6 +634,10 @@ bool GcInfoDecoder::EnumerateLiveSlots(
 
     _ASSERTE( m_Flags & DECODE_GC_LIFETIMES );
 
+    // Slots-only decoders skip the safe-point lookup and cannot answer
+    // per-offset liveness; use EnumerateUntrackedSlots with them instead
+    _ASSERTE( !(m_Flags & DECODE_SLOTS_ONLY) );
+
     GcSlotDecoder slotDecoder;
 
     UINT32 normBreakOffset = NORMALIZE_CODE_OFFSET(m_InstructionOffset);
@@ -63,6 +63,53 @@ void GcInfoDumper::LivePointerCallback (
 }
 
 
+//
+// Interruptible ranges are decoded once up front rather than re-querying a
+// fresh decoder at every code offset; the ranges come back in increasing
+// order and never overlap, so a cursor that only moves forward can answer
+// the per-offset interruptibility question.
+//
+
+struct InterruptibleRange
+{
+    UINT32 StartOffset;
+    UINT32 StopOffset;
+};
+
+struct InterruptibleRangeAccumulator
+{
+    InterruptibleRange *pRanges;
+    UINT32 Count;
+    UINT32 Capacity;
+    BOOL OutOfMemory;
+};
+
+static bool CollectInterruptibleRangeCB (UINT32 startOffset, UINT32 stopOffset, void *hCallback)
+{
+    InterruptibleRangeAccumulator *pAcc = (InterruptibleRangeAccumulator*)hCallback;
+
+    if (pAcc->Count == pAcc->Capacity)
+    {
+        UINT32 newCapacity = pAcc->Capacity ? pAcc->Capacity * 2 : 16;
+        InterruptibleRange *pNewRanges = new InterruptibleRange[newCapacity];
+        if (!pNewRanges)
+        {
+            pAcc->OutOfMemory = TRUE;
+            return true;
+        }
+        memcpy(pNewRanges, pAcc->pRanges, pAcc->Count * sizeof(InterruptibleRange));
+        delete[] pAcc->pRanges;
+        pAcc->pRanges = pNewRanges;
+        pAcc->Capacity = newCapacity;
+    }
+
+    pAcc->pRanges[pAcc->Count].StartOffset = startOffset;
+    pAcc->pRanges[pAcc->Count].StopOffset = stopOffset;
+    pAcc->Count++;
+    return false;
+}
+
+
 //static
 void GcInfoDumper::FreePointerRecords (LivePointerRecord *pRecords)
 {
@@ -620,7 +667,7 @@ PORTABILITY_ASSERT("GcInfoDumper::EnumerateStateChanges is not implemented on th
 #endif
 
     {
-        GcInfoDecoder untrackedDecoder(m_gcTable, DECODE_GC_LIFETIMES, 0);
+        GcInfoDecoder untrackedDecoder(m_gcTable, (GcInfoDecoderFlags)(DECODE_GC_LIFETIMES | DECODE_SLOTS_ONLY), 0);
         untrackedDecoder.EnumerateUntrackedSlots(&regdisp,
                     0,
                     &LivePointerCallback,
@@ -638,25 +685,47 @@ PORTABILITY_ASSERT("GcInfoDumper::EnumerateStateChanges is not implemented on th
             return m_Error;
     }
 
+    //
+    // Walking a method used to construct a decoder per code offset just to
+    // ask whether that offset is interruptible, re-reading the header and
+    // re-walking the range table every time; for large methods that
+    // dominated the enumeration.  Decode the ranges once instead.
+    //
+
+    InterruptibleRangeAccumulator ranges;
+    ranges.pRanges = NULL;
+    ranges.Count = 0;
+    ranges.Capacity = 0;
+    ranges.OutOfMemory = FALSE;
+
+    {
+        GcInfoDecoder rangeDecoder(m_gcTable, DECODE_FOR_RANGES_CALLBACK, 0);
+        rangeDecoder.EnumerateInterruptibleRanges(&CollectInterruptibleRangeCB, &ranges);
+
+        if (ranges.OutOfMemory)
+        {
+            delete[] ranges.pRanges;
+            m_Error = OUT_OF_MEMORY;
+            return m_Error;
+        }
+    }
+
+    UINT32 iCurrentRange = 0;
+
     LivePointerRecord *pLastState = NULL;
     BOOL fPrevInterruptible = FALSE;
 
     for (UINT32 offset = 0; offset <= cbEncodedMethodSize; offset++)
     {
-        BOOL fNewInterruptible = FALSE;
-
-        GcInfoDecoder decoder1(m_gcTable,
-                               (GcInfoDecoderFlags)(  DECODE_SECURITY_OBJECT
-                                                    | DECODE_CODE_LENGTH
-                                                    | DECODE_VARARG
-#if defined(_TARGET_ARM_) || defined(_TARGET_ARM64_)
-                                                    | DECODE_HAS_TAILCALLS
-#endif // _TARGET_ARM_ || _TARGET_ARM64_
-
-                                                    | DECODE_INTERRUPTIBILITY),
-                               offset);
+        while (   iCurrentRange < ranges.Count
+               && offset >= ranges.pRanges[iCurrentRange].StopOffset)
+        {
+            iCurrentRange++;
+        }
 
-        fNewInterruptible = decoder1.IsInterruptible();
+        BOOL fNewInterruptible = (   iCurrentRange < ranges.Count
+                                  && offset >= ranges.pRanges[iCurrentRange].StartOffset
+                                  && offset <  ranges.pRanges[iCurrentRange].StopOffset);
 
         if (fNewInterruptible != fPrevInterruptible)
         {
@@ -734,6 +803,8 @@ PORTABILITY_ASSERT("GcInfoDumper::EnumerateStateChanges is not implemented on th
             m_gcInfoSize = tempSize;
     }
 
+    delete[] ranges.pRanges;
+
     FreePointerRecords(pLastState);
 
     FreePointerRecords(m_pRecords);
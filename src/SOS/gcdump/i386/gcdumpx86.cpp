@@ -210,6 +210,76 @@ unsigned            GCDump::DumpInfoHdr (PTR_CBYTE      gcInfoBlock,
 #pragma warning(push)
 #pragma warning(disable:21000) // Suppress PREFast warning about overly large function
 #endif
+/*****************************************************************************/
+
+// Classification of the leading byte of a fully-interruptible pointer-table
+// entry. The predicates mirror the encoding patterns in gcdecoder.cpp; the
+// dense 256-entry map turns the nested compare chain in the decode loop into
+// a single indexed dispatch.
+enum FullyIntOp
+{
+    FI_OP_REG_PTR,        // 0x00-0x7F - small 'regPtr' encoding
+    FI_OP_SMALL_ARG,      // argOffs 0-5 - small argument push/pop
+    FI_OP_BIG_DELTA,      // 0xF0-0xF7 - bigger offset delta
+    FI_OP_NONPTR_PUSH,    // 0xB0-0xB7 - non-ptr argument push
+    FI_OP_THIS,           // 0xBC - next push is 'this'
+    FI_OP_IPTR,           // 0xBF - next push/reg is an iptr
+    FI_OP_SKIP,           // 0xB8 - unsigned offset delta follows
+    FI_OP_LARGE_ARG,      // 0xF8/0xFC - unsigned argOffs follows
+    FI_OP_KILL_ARGS,      // 0xFD - unsigned count of killed args follows
+    FI_OP_ADD_ARG_CNT,    // 0xF9 - unsigned argCnt adjustment follows
+    FI_OP_DONE,           // 0xFF - end of table
+    FI_OP_UNDECODED       // reserved encoding
+};
+
+static BYTE s_fullyIntOpMap[256];
+static bool s_fullyIntOpMapReady = false;
+
+static void InitFullyIntOpMap()
+{
+    for (unsigned val = 0; val < 256; val++)
+    {
+        BYTE op;
+
+        if (!(val & 0x80))
+        {
+            op = FI_OP_REG_PTR;
+        }
+        else
+        {
+            unsigned argOffs = (val & 0x38) >> 3;
+
+            if (argOffs < 6)
+            {
+                op = FI_OP_SMALL_ARG;
+            }
+            else if (argOffs == 6)
+            {
+                op = (val & 0x40) ? FI_OP_BIG_DELTA : FI_OP_NONPTR_PUSH;
+            }
+            else
+            {
+                switch (val)
+                {
+                case 0xFF: op = FI_OP_DONE;        break;
+                case 0xBC: op = FI_OP_THIS;        break;
+                case 0xBF: op = FI_OP_IPTR;        break;
+                case 0xB8: op = FI_OP_SKIP;        break;
+                case 0xF8:
+                case 0xFC: op = FI_OP_LARGE_ARG;   break;
+                case 0xFD: op = FI_OP_KILL_ARGS;   break;
+                case 0xF9: op = FI_OP_ADD_ARG_CNT; break;
+                default:   op = FI_OP_UNDECODED;   break;
+                }
+            }
+        }
+
+        s_fullyIntOpMap[val] = op;
+    }
+
+    s_fullyIntOpMapReady = true;
+}
+
 size_t              GCDump::DumpGCTable(PTR_CBYTE      table,
                                         const InfoHdr& header,
                                         unsigned       methodSize,
@@ -350,6 +420,9 @@ size_t              GCDump::DumpGCTable(PTR_CBYTE      table,
         bool     isThis = false;
         bool     iptr   = false;
 
+        if (!s_fullyIntOpMapReady)
+            InitFullyIntOpMap();
+
         for (;;)
         {
             unsigned    isPop;
@@ -358,8 +431,10 @@ size_t              GCDump::DumpGCTable(PTR_CBYTE      table,
 
             _ASSERTE(curOffs <= methodSize);
 
-            if  (!(val & 0x80))
+            switch (s_fullyIntOpMap[val])
             {
+            case FI_OP_REG_PTR:
+
                 /* A small 'regPtr' encoding */
 
                 curOffs += val & 0x7;
@@ -378,20 +453,14 @@ size_t              GCDump::DumpGCTable(PTR_CBYTE      table,
                 isThis = false;
                 iptr   = false;
                 continue;
-            }
-
-            /* This is probably an argument push/pop */
 
-            argOffs = (val & 0x38) >> 3;
+            case FI_OP_SMALL_ARG:
 
-            /* 6 [110] and 7 [111] are reserved for other encodings */
-
-            if  (argOffs < 6)
-            {
                 /* A small argument encoding */
 
                 curOffs += (val & 0x07);
                 isPop    = (val & 0x40);
+                argOffs  = (val & 0x38) >> 3;
 
             ARG:
 
@@ -442,64 +511,53 @@ size_t              GCDump::DumpGCTable(PTR_CBYTE      table,
                 }
 
                 continue;
-            }
-            else if (argOffs == 6)
-            {
-                if (val & 0x40)
-                {
-                    /* Bigger delta  000=8,001=16,010=24,...,111=64 */
 
-                    curOffs += (((val & 0x07) + 1) << 3);
-                }
-                else
-                {
-                    /* non-ptr arg push */
+            case FI_OP_BIG_DELTA:
 
-                    curOffs += (val & 0x07);
-#ifndef UNIX_X86_ABI
-                    // For x86/Linux, non-ptr arg pushes can be reported even for EBP frames
-                    _ASSERTE(!header.ebpFrame);
-#endif // UNIX_X86_ABI
-                    argCnt++;
+                /* Bigger delta  000=8,001=16,010=24,...,111=64 */
 
-                    DumpEncoding(bp, table-bp); bp = table;
-                    DumpOffsetEx(curOffs);
+                curOffs += (((val & 0x07) + 1) << 3);
+                continue;
 
-                    gcPrintf("        push non-ptr (%d)\n", argCnt);
-                }
+            case FI_OP_NONPTR_PUSH:
 
-                continue;
-            }
+                /* non-ptr arg push */
+
+                curOffs += (val & 0x07);
+#ifndef UNIX_X86_ABI
+                // For x86/Linux, non-ptr arg pushes can be reported even for EBP frames
+                _ASSERTE(!header.ebpFrame);
+#endif // UNIX_X86_ABI
+                argCnt++;
 
-            /* argOffs was 7 [111] which is reserved for the larger encodings */
+                DumpEncoding(bp, table-bp); bp = table;
+                DumpOffsetEx(curOffs);
 
-            _ASSERTE(argOffs==7);
+                gcPrintf("        push non-ptr (%d)\n", argCnt);
+                continue;
 
-            switch (val)
-            {
-            case 0xFF:
+            case FI_OP_DONE:
                 goto DONE_REGTAB;
 
-            case 0xBC:
+            case FI_OP_THIS:
                 isThis = true;
-                break;
+                continue;
 
-            case 0xBF:
+            case FI_OP_IPTR:
                 iptr = true;
-                break;
+                continue;
 
-            case 0xB8:
+            case FI_OP_SKIP:
                 table   += decodeUnsigned(table, &val);
                 curOffs += val;
-                break;
+                continue;
 
-            case 0xF8:
-            case 0xFC:
+            case FI_OP_LARGE_ARG:
                 isPop  = val & 0x04;
                 table += decodeUnsigned(table, &argOffs);
                 goto ARG;
 
-            case 0xFD:
+            case FI_OP_KILL_ARGS:
                 table += decodeUnsigned(table, &argOffs);
                 assert(argOffs);
 
@@ -507,12 +565,12 @@ size_t              GCDump::DumpGCTable(PTR_CBYTE      table,
                 DumpOffsetEx(curOffs);
 
                 gcPrintf("        kill args %2d\n", argOffs);
-                break;
+                continue;
 
-            case 0xF9:
+            case FI_OP_ADD_ARG_CNT:
                 table  += decodeUnsigned(table, &argOffs);
                 argCnt += argOffs;
-                break;
+                continue;
 
             default:
                 gcPrintf("Unexpected special code %04X\n", val);
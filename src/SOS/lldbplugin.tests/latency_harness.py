@@ -0,0 +1,88 @@
+# Licensed to the .NET Foundation under one or more agreements.
+# The .NET Foundation licenses this file to you under the MIT license.
+# See the LICENSE file in the project root for more information.
+
+# Runs inside lldb (see test_latency.py for the driver): loads a recorded
+# core file and times each SOS command, measuring both the time to the first
+# byte of output and the time to completion.
+#
+# SOS output is routed through LLDBServices::OutputString, which appends to
+# the command's SBCommandReturnObject. Pointing the return object's immediate
+# output at a pipe and timestamping the first read on the other end measures
+# when the plugin actually emitted output rather than when HandleCommand
+# returned - so a change that buffers the whole command's output until the
+# end shows up as first-byte time collapsing into completion time.
+#
+# Round 1 of each command is recorded as the cold run (module lookup, symbol
+# loads); later rounds measure the warm path.
+
+from __future__ import print_function
+import lldb
+import os
+import threading
+import time
+
+results_file = ''
+
+
+def time_command(ci, command):
+    res = lldb.SBCommandReturnObject()
+
+    read_fd, write_fd = os.pipe()
+    first_byte = [None]
+    total_bytes = [0]
+
+    def reader():
+        while True:
+            data = os.read(read_fd, 1 << 16)
+            if not data:
+                break
+            if first_byte[0] is None:
+                first_byte[0] = time.time()
+            total_bytes[0] += len(data)
+
+    thread = threading.Thread(target=reader)
+    thread.start()
+
+    write_file = os.fdopen(write_fd, 'w')
+    res.SetImmediateOutputFile(write_file)
+
+    start = time.time()
+    ci.HandleCommand(command, res)
+    end = time.time()
+
+    write_file.close()
+    thread.join()
+    os.close(read_fd)
+
+    complete_ms = (end - start) * 1000.0
+    # A command that produced no immediate output (e.g. it failed) has no
+    # first byte; report completion so the trend report stays rectangular.
+    if first_byte[0] is not None:
+        first_ms = (first_byte[0] - start) * 1000.0
+    else:
+        first_ms = complete_ms
+
+    return first_ms, complete_ms, total_bytes[0], res.Succeeded()
+
+
+def run(debugger, executable, core, commands, rounds):
+    target = debugger.CreateTarget(executable)
+    if not target.IsValid():
+        print('latency_harness: cannot create target for %s' % executable)
+        return
+    process = target.LoadCore(core)
+    if not process.IsValid():
+        print('latency_harness: cannot load core %s' % core)
+        return
+
+    ci = debugger.GetCommandInterpreter()
+
+    with open(results_file, 'a+') as results:
+        for command in commands.split(';'):
+            command = command.strip()
+            for round_number in range(1, rounds + 1):
+                first_ms, complete_ms, total_bytes, succeeded = time_command(ci, command)
+                print('%s\t%d\t%.3f\t%.3f\t%d\t%s' %
+                      (command, round_number, first_ms, complete_ms,
+                       total_bytes, succeeded), file=results)
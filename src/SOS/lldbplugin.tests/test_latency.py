@@ -0,0 +1,140 @@
+# Licensed to the .NET Foundation under one or more agreements.
+# The .NET Foundation licenses this file to you under the MIT license.
+# See the LICENSE file in the project root for more information.
+
+# Command round-trip latency harness for the lldb sos plugin.
+#
+# Launches lldb against a recorded core file, runs each SOS command several
+# times through latency_harness.py (which measures time to first output byte
+# and time to completion per round), appends the results to a history file,
+# and prints a trend report comparing this run against the median of the
+# recorded history. First-byte time catches output-buffering regressions in
+# services.cpp; the cold (round 1) numbers catch module-lookup regressions.
+#
+#   python2 test_latency.py --lldb <lldb> --plugin <libsosplugin>
+#       --executable <dotnet-or-corerun> --core <corefile>
+#       --resultsdir <dir-for-history>
+#       [--commands 'clrthreads;dumpheap -stat;eeheap -gc;clrstack -all']
+#       [--rounds 3] [--tolerance 20]
+#
+# Exits nonzero when any command's warm first-byte or completion time is more
+# than --tolerance percent over its historical median (needs at least two
+# prior runs before it starts failing).
+
+from __future__ import print_function
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+
+def run_lldb(args, results_file):
+    scriptdir = os.path.dirname(os.path.abspath(__file__))
+    cmd = (('%s -b ' % args.lldb) +
+           ("--no-lldbinit ") +
+           ("-O \"plugin load %s \" " % args.plugin) +
+           ("-o \"script import sys; sys.path.insert(0, '%s')\" " % scriptdir) +
+           ("-o \"script import latency_harness as perf\" ") +
+           ("-o \"script perf.results_file = '%s'\" " % results_file) +
+           ("-o \"script perf.run(lldb.debugger, '%s', '%s', '%s', %d)\" " %
+            (args.executable, args.core, args.commands, args.rounds)) +
+           ("-o \"quit\" "))
+    subprocess.check_call(cmd, shell=True)
+
+
+def read_results(results_file):
+    # command -> {'cold_first': ms, 'cold_complete': ms,
+    #             'first': best warm ms, 'complete': best warm ms}
+    results = {}
+    with open(results_file, 'r') as results_fd:
+        for line in results_fd:
+            command, round_number, first_ms, complete_ms, _, _ = line.rstrip('\n').split('\t')
+            entry = results.setdefault(command, {})
+            if int(round_number) == 1:
+                entry['cold_first'] = float(first_ms)
+                entry['cold_complete'] = float(complete_ms)
+            else:
+                entry['first'] = min(entry.get('first', float('inf')), float(first_ms))
+                entry['complete'] = min(entry.get('complete', float('inf')), float(complete_ms))
+    return results
+
+
+def median(values):
+    ordered = sorted(values)
+    middle = len(ordered) // 2
+    if len(ordered) % 2 == 1:
+        return ordered[middle]
+    return (ordered[middle - 1] + ordered[middle]) / 2.0
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--lldb', required=True)
+    parser.add_argument('--plugin', required=True)
+    parser.add_argument('--executable', required=True)
+    parser.add_argument('--core', required=True)
+    parser.add_argument('--resultsdir', required=True)
+    parser.add_argument('--commands', default='clrthreads;dumpheap -stat;eeheap -gc;clrstack -all')
+    parser.add_argument('--rounds', type=int, default=3)
+    parser.add_argument('--tolerance', type=int, default=20)
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.resultsdir):
+        os.makedirs(args.resultsdir)
+
+    timestamp = time.strftime('%Y-%m-%d %H:%M:%S')
+    results_file = os.path.join(args.resultsdir, 'latency_run.tsv')
+    history_file = os.path.join(args.resultsdir, 'latency_history.tsv')
+
+    if os.path.isfile(results_file):
+        os.unlink(results_file)
+    run_lldb(args, results_file)
+
+    if not os.path.isfile(results_file):
+        print('test_latency: no results produced (did lldb or the plugin fail to load?)')
+        return 1
+    results = read_results(results_file)
+
+    # history row: timestamp, command, metric, milliseconds
+    history = {}
+    if os.path.isfile(history_file):
+        with open(history_file, 'r') as history_fd:
+            for line in history_fd:
+                _, command, metric, value = line.rstrip('\n').split('\t')
+                history.setdefault((command, metric), []).append(float(value))
+
+    failed = False
+    print('%-28s %12s %12s %12s %12s' %
+          ('command', 'first(ms)', 'complete(ms)', 'cold(ms)', 'trend'))
+    for command in sorted(results):
+        entry = results[command]
+        first_ms = entry.get('first', entry.get('cold_first', 0.0))
+        complete_ms = entry.get('complete', entry.get('cold_complete', 0.0))
+        cold_ms = entry.get('cold_complete', 0.0)
+
+        trend = 'no history'
+        for metric, value in (('first', first_ms), ('complete', complete_ms)):
+            prior = history.get((command, metric), [])
+            if len(prior) >= 2:
+                base = median(prior)
+                delta = (value - base) * 100.0 / base if base > 0 else 0.0
+                trend = '%+.1f%%' % delta
+                if delta > args.tolerance:
+                    print('REGRESSION: %s %s %.3f ms vs median %.3f ms (+%d%% allowed)' %
+                          (command, metric, value, base, args.tolerance))
+                    failed = True
+
+        print('%-28s %12.3f %12.3f %12.3f %12s' %
+              (command, first_ms, complete_ms, cold_ms, trend))
+
+        with open(history_file, 'a+') as history_fd:
+            print('%s\t%s\tfirst\t%.3f' % (timestamp, command, first_ms), file=history_fd)
+            print('%s\t%s\tcomplete\t%.3f' % (timestamp, command, complete_ms), file=history_fd)
+            print('%s\t%s\tcold\t%.3f' % (timestamp, command, cold_ms), file=history_fd)
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -544,6 +544,25 @@ public:
 
 typedef void (*PFN_MODULE_LOAD_CALLBACK)(void* param, const char* moduleFilePath, ULONG64 moduleAddress, int moduleSize);
 
+// A single request in a ReadVirtualBatch call.  Offset, Buffer and
+// BufferSize are filled in by the caller; BytesRead and Status are
+// set per entry by the implementation.
+typedef struct _READ_VIRTUAL_ENTRY
+{
+    ULONG64 Offset;
+    PVOID Buffer;
+    ULONG BufferSize;
+    ULONG BytesRead;
+    HRESULT Status;
+} READ_VIRTUAL_ENTRY, *PREAD_VIRTUAL_ENTRY;
+
+// Permission bits reported for a mapped memory region.
+#define MEMORY_REGION_READ    0x1
+#define MEMORY_REGION_WRITE   0x2
+#define MEMORY_REGION_EXECUTE 0x4
+
+typedef void (*PFN_MEMORY_REGION_CALLBACK)(void* param, ULONG64 base, ULONG64 size, ULONG permissions);
+
 MIDL_INTERFACE("012F32F0-33BA-4E8E-BC01-037D382D8A5E")
 ILLDBServices2: public IUnknown
 {
@@ -557,8 +576,25 @@ public:
         PFN_MODULE_LOAD_CALLBACK callback) = 0;
 
     virtual HRESULT AddModuleSymbol(
-        void* param, 
+        void* param,
         const char* symbolFilePath) = 0;
+
+    // Reads several independent virtual address ranges in one call,
+    // resolving the process once and visiting the ranges in address
+    // order.  Each entry succeeds or fails on its own; the return
+    // value only says whether the batch could be attempted at all.
+    virtual HRESULT ReadVirtualBatch(
+        PREAD_VIRTUAL_ENTRY entries,
+        ULONG count) = 0;
+
+    // Enumerates the mapped regions of the target address space in
+    // address order, reporting each region's bounds and permissions
+    // to the callback.  Unmapped gaps are simply absent, so scanners
+    // can iterate the regions instead of probing the whole address
+    // space and eating read failures.
+    virtual HRESULT EnumerateMemoryRegions(
+        PFN_MEMORY_REGION_CALLBACK callback,
+        void* param) = 0;
 };
 
 #ifdef __cplusplus
@@ -7,11 +7,206 @@
 #include "sosplugin.h"
 #include <string.h>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <dlfcn.h>
 #include <pthread.h>
 
 #define CONVERT_FROM_SIGN_EXTENDED(offset) ((ULONG_PTR)(offset))
 
+//----------------------------------------------------------------------------
+// Zero-copy reads from an ELF core file
+//
+// When lldb is debugging a core, every ReadVirtual round-trips through
+// SBProcess::ReadMemory even though the bytes sit in a local file.  The
+// "setcorefile" command maps the core and parses its PT_LOAD program
+// headers once; reads whose bytes are present in the file are then served
+// by pointer copy, and only ranges absent from the file fall back to lldb.
+//----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#include <elf.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __LP64__
+#define CORE_ELFCLASS ELFCLASS64
+#else
+#define CORE_ELFCLASS ELFCLASS32
+#endif
+
+struct CoreFileSegment
+{
+    ULONG64 VirtualAddress;
+    ULONG64 FileOffset;
+    ULONG64 FileSize;
+};
+
+static char *g_coreFilePath = nullptr;
+static void *g_coreFileBase = nullptr;
+static size_t g_coreFileSize = 0;
+static std::vector<CoreFileSegment> g_coreFileSegments;
+
+static void CoreFileUnmap()
+{
+    if (g_coreFileBase != nullptr)
+    {
+        munmap(g_coreFileBase, g_coreFileSize);
+        g_coreFileBase = nullptr;
+    }
+    g_coreFileSize = 0;
+    g_coreFileSegments.clear();
+
+    if (g_coreFilePath != nullptr)
+    {
+        free(g_coreFilePath);
+        g_coreFilePath = nullptr;
+    }
+}
+
+bool CoreFileMap(const char *path)
+{
+    CoreFileUnmap();
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(ElfW(Ehdr)))
+    {
+        close(fd);
+        return false;
+    }
+
+    void *base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const ElfW(Ehdr) *header = (const ElfW(Ehdr)*)base;
+    if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+        header->e_ident[EI_CLASS] != CORE_ELFCLASS ||
+        header->e_type != ET_CORE ||
+        header->e_phentsize != sizeof(ElfW(Phdr)) ||
+        header->e_phoff + (ULONG64)header->e_phnum * sizeof(ElfW(Phdr)) > (ULONG64)st.st_size)
+    {
+        munmap(base, st.st_size);
+        return false;
+    }
+
+    const ElfW(Phdr) *phdrs = (const ElfW(Phdr)*)((const char*)base + header->e_phoff);
+    std::vector<CoreFileSegment> segments;
+
+    for (int i = 0; i < header->e_phnum; i++)
+    {
+        // Only the part of a segment actually written to the file can be
+        // served; a truncated core simply falls back to lldb more often.
+        if (phdrs[i].p_type != PT_LOAD || phdrs[i].p_filesz == 0)
+        {
+            continue;
+        }
+        if (phdrs[i].p_offset + phdrs[i].p_filesz > (ULONG64)st.st_size)
+        {
+            continue;
+        }
+
+        CoreFileSegment segment;
+        segment.VirtualAddress = phdrs[i].p_vaddr;
+        segment.FileOffset = phdrs[i].p_offset;
+        segment.FileSize = phdrs[i].p_filesz;
+        segments.push_back(segment);
+    }
+
+    if (segments.empty())
+    {
+        munmap(base, st.st_size);
+        return false;
+    }
+
+    std::sort(segments.begin(), segments.end(),
+        [](const CoreFileSegment &lhs, const CoreFileSegment &rhs)
+        {
+            return lhs.VirtualAddress < rhs.VirtualAddress;
+        });
+
+    // The reads against the core are scattered, so kernel readahead based on
+    // access order doesn't help; ask for the whole file up front instead so
+    // pages stream in with large bulk reads rather than one fault at a time.
+    madvise(base, st.st_size, MADV_WILLNEED);
+
+    g_coreFilePath = strdup(path);
+    g_coreFileBase = base;
+    g_coreFileSize = st.st_size;
+    g_coreFileSegments.swap(segments);
+    return true;
+}
+
+const char *CoreFileGetPath()
+{
+    return g_coreFilePath;
+}
+
+// Copies as many of the requested bytes as the core file contains and
+// returns the count; the caller falls back to lldb for short reads.
+static size_t CoreFileRead(ULONG64 address, void *buffer, size_t size)
+{
+    if (g_coreFileBase == nullptr || size == 0)
+    {
+        return 0;
+    }
+
+    // Find the last segment which starts at or below the address.
+    size_t lo = 0;
+    size_t hi = g_coreFileSegments.size();
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (g_coreFileSegments[mid].VirtualAddress <= address)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == 0)
+    {
+        return 0;
+    }
+
+    const CoreFileSegment &segment = g_coreFileSegments[lo - 1];
+    if (address >= segment.VirtualAddress + segment.FileSize)
+    {
+        return 0;
+    }
+
+    size_t available = (size_t)(segment.VirtualAddress + segment.FileSize - address);
+    size_t copy = size < available ? size : available;
+    memcpy(buffer, (const char*)g_coreFileBase + segment.FileOffset + (address - segment.VirtualAddress), copy);
+    return copy;
+}
+
+#else // __linux__
+
+bool CoreFileMap(const char *path)
+{
+    return false;
+}
+
+const char *CoreFileGetPath()
+{
+    return nullptr;
+}
+
+#endif // __linux__
+
 ULONG g_currentThreadIndex = (ULONG)-1;
 ULONG g_currentThreadSystemId = (ULONG)-1;
 char *g_coreclrDirectory = nullptr;
@@ -22,7 +217,16 @@ LLDBServices::LLDBServices(lldb::SBDebugger &debugger, lldb::SBCommandReturnObje
     m_debugger(debugger),
     m_returnObject(returnObject),
     m_currentProcess(process),
-    m_currentThread(thread)
+    m_currentThread(thread),
+    m_moduleCacheStopId(0),
+    m_moduleCacheNumModules(0),
+    m_moduleCacheValid(false),
+    m_contextCacheStopId(0),
+    m_contextCacheValid(false),
+    m_expressionCacheStopId(0),
+    m_expressionCacheValid(false),
+    m_unwindCacheStopId(0),
+    m_unwindCacheValid(false)
 {
     returnObject.SetStatus(lldb::eReturnStatusSuccessFinishResult);
 }
@@ -128,6 +332,37 @@ LLDBServices::GetExpression(
     lldb::SBError error;
     std::string str;
 
+    // Evaluation results are stable while the process is stopped, so repeat
+    // evaluations of the same expression in the same thread/frame come out
+    // of the cache.  On a dump the stop id never changes and every
+    // expression lldb has seen once becomes a hash lookup.
+    uint32_t stopId = 0;
+    lldb::SBProcess process = GetCurrentProcess();
+    if (process.IsValid())
+    {
+        stopId = process.GetStopID();
+    }
+
+    if (!m_expressionCacheValid || stopId != m_expressionCacheStopId)
+    {
+        m_expressionCache.clear();
+        m_expressionCacheStopId = stopId;
+        m_expressionCacheValid = true;
+    }
+
+    char keyPrefix[64];
+    snprintf(keyPrefix, sizeof(keyPrefix), "%llx/%u:",
+        (unsigned long long)frame.GetThread().GetThreadID(), frame.GetFrameID());
+
+    std::string key(keyPrefix);
+    key.append(exp);
+
+    std::unordered_map<std::string, DWORD_PTR>::iterator cached = m_expressionCache.find(key);
+    if (cached != m_expressionCache.end())
+    {
+        return cached->second;
+    }
+
     // To be compatible with windbg/dbgeng, we need to emulate the default
     // hex radix (because sos prints addresses and other hex values without
     // the 0x) by first prepending 0x and if that fails use the actual
@@ -141,6 +376,7 @@ LLDBServices::GetExpression(
         result = GetExpression(frame, error, exp);
     }
 
+    m_expressionCache[key] = result;
     return result;
 }
 
@@ -207,32 +443,41 @@ LLDBServices::VirtualUnwind(
 #else
 #error "spToFind undefined for this platform"
 #endif
-    
-    int numFrames = thread.GetNumFrames();
-    for (int i = 0; i < numFrames; i++)
+
+    uint32_t stopId = process.GetStopID();
+    if (!m_unwindCacheValid || stopId != m_unwindCacheStopId)
     {
-        lldb::SBFrame frame = thread.GetFrameAtIndex(i);
-        if (!frame.IsValid())
-        {
-            break;
-        }
-        lldb::addr_t sp = frame.GetSP();
+        m_threadFrameSps.clear();
+        m_unwindCacheStopId = stopId;
+        m_unwindCacheValid = true;
+    }
 
-        if ((i + 1) < numFrames)
+    // A walk calls VirtualUnwind once per frame; extract the thread's frame
+    // SP list from lldb only on the first call per stop.
+    std::vector<ULONG64>& frameSps = m_threadFrameSps[threadID];
+    if (frameSps.empty())
+    {
+        int numFrames = thread.GetNumFrames();
+        frameSps.reserve(numFrames);
+        for (int i = 0; i < numFrames; i++)
         {
-            lldb::SBFrame frameNext = thread.GetFrameAtIndex(i + 1);
-            if (frameNext.IsValid())
+            lldb::SBFrame frame = thread.GetFrameAtIndex(i);
+            if (!frame.IsValid())
             {
-                lldb::addr_t spNext = frameNext.GetSP();
-
-                // An exact match of the current frame's SP would be nice
-                // but sometimes the incoming context is between lldb frames
-                if (spToFind >= sp && spToFind < spNext)
-                {
-                    frameFound = frameNext;
-                    break;
-                }
+                break;
             }
+            frameSps.push_back(frame.GetSP());
+        }
+    }
+
+    for (size_t i = 0; i + 1 < frameSps.size(); i++)
+    {
+        // An exact match of the current frame's SP would be nice
+        // but sometimes the incoming context is between lldb frames
+        if (spToFind >= frameSps[i] && spToFind < frameSps[i + 1])
+        {
+            frameFound = thread.GetFrameAtIndex((uint32_t)(i + 1));
+            break;
         }
     }
 
@@ -353,6 +598,16 @@ LLDBServices::OutputVaList(
     va_list args_copy;
     va_copy (args_copy, args);
 
+    // Preformatted text (the buffered output layer in SOS flushes with a
+    // plain "%s") goes straight through; the flushed chunks are far larger
+    // than any stack buffer and need no formatting.
+    if (format[0] == '%' && format[1] == 's' && format[2] == '\0')
+    {
+        OutputString(mask, va_arg(args_copy, const char*));
+        va_end(args_copy);
+        return result;
+    }
+
     // Try and format our string into a fixed buffer first and see if it fits
     size_t length = ::vsnprintf(str, sizeof(str), format, args);
     if (length < sizeof(str))
@@ -798,13 +1053,25 @@ LLDBServices::ReadVirtual(
     // lldb doesn't expect sign-extended address
     offset = CONVERT_FROM_SIGN_EXTENDED(offset);
 
-    lldb::SBProcess process = GetCurrentProcess();
-    if (!process.IsValid())
+#ifdef __linux__
+    // Serve the read straight from the mapped core file when the bytes are
+    // all present in it.
+    if (bufferSize != 0 && CoreFileRead(offset, buffer, bufferSize) == bufferSize)
     {
+        read = bufferSize;
         goto exit;
     }
+#endif
+
+    {
+        lldb::SBProcess process = GetCurrentProcess();
+        if (!process.IsValid())
+        {
+            goto exit;
+        }
 
-    read = process.ReadMemory(offset, buffer, bufferSize, error);
+        read = process.ReadMemory(offset, buffer, bufferSize, error);
+    }
 
 exit:
     if (bytesRead)
@@ -872,6 +1139,10 @@ LLDBServices::GetNameByOffset(
     lldb::SBFileSpec file;
     lldb::SBSymbol symbol;
     std::string str;
+    ULONG64 moduleBase = UINT64_MAX;
+    const SymbolTable* table = NULL;
+    const SymbolTable::Entry* entry = NULL;
+    bool resolved = false;
 
     // lldb doesn't expect sign-extended address
     offset = CONVERT_FROM_SIGN_EXTENDED(offset);
@@ -903,20 +1174,67 @@ LLDBServices::GetNameByOffset(
         str.append(file.GetFilename());
     }
 
-    symbol = address.GetSymbol();
-    if (symbol.IsValid())
+    // Resolve the symbol from the module's cached table when one exists;
+    // disassembly annotation funnels thousands of addresses through here and
+    // the local binary search avoids a full lldb symbol query for each.
+    moduleBase = GetModuleBase(target, module);
+    if (moduleBase != UINT64_MAX)
     {
-        lldb::SBAddress startAddress = symbol.GetStartAddress();
-        disp = address.GetOffset() - startAddress.GetOffset();
+        table = EnsureSymbolTable(target, module, moduleBase);
+        if (table != NULL)
+        {
+            entry = table->Find(offset);
+        }
+    }
 
-        const char *name = symbol.GetName();
-        if (name)
+    if (entry != NULL)
+    {
+        disp = offset - entry->Start;
+        if (file.IsValid())
         {
-            if (file.IsValid())
+            str.append("!");
+        }
+        str.append(table->Names.c_str() + entry->NameOffset);
+    }
+    else
+    {
+        // The first address a module fails to resolve marks it; later
+        // addresses in it skip lldb's per-address fallback (a stripped module
+        // fails every query, each one slowly) and go straight to the
+        // module+offset attribution below.
+        if (moduleBase == UINT64_MAX ||
+            m_symbolLookupFailed.find(moduleBase) == m_symbolLookupFailed.end())
+        {
+            symbol = address.GetSymbol();
+            if (symbol.IsValid())
+            {
+                lldb::SBAddress startAddress = symbol.GetStartAddress();
+                disp = address.GetOffset() - startAddress.GetOffset();
+
+                const char *name = symbol.GetName();
+                if (name)
+                {
+                    resolved = true;
+                    if (file.IsValid())
+                    {
+                        str.append("!");
+                    }
+                    str.append(name);
+                }
+            }
+
+            if (!resolved && moduleBase != UINT64_MAX)
             {
-                str.append("!");
+                m_symbolLookupFailed.insert(moduleBase);
             }
-            str.append(name);
+        }
+
+        // Without a symbol, attribute the address to the module instead:
+        // the name stays the module's file name and the displacement is the
+        // offset from its base.
+        if (!resolved && moduleBase != UINT64_MAX)
+        {
+            disp = offset - moduleBase;
         }
     }
 
@@ -1053,7 +1371,178 @@ exit:
     return moduleBase == UINT64_MAX ? E_FAIL : S_OK;
 }
 
-HRESULT 
+// Rebuilds the sorted (load address, size) -> module table when it is stale.
+// The table is keyed on the process stop id and the module count, so it is
+// built once per stop and refreshed when a module load changes the list.
+void
+LLDBServices::EnsureModuleRangeCache(
+    lldb::SBTarget& target)
+{
+    uint32_t stopId = 0;
+    lldb::SBProcess process = target.GetProcess();
+    if (process.IsValid())
+    {
+        stopId = process.GetStopID();
+    }
+
+    ULONG numModules = target.GetNumModules();
+    if (m_moduleCacheValid && stopId == m_moduleCacheStopId && numModules == m_moduleCacheNumModules)
+    {
+        return;
+    }
+
+    m_moduleRanges.clear();
+
+    // Module bases can be reused after an unload, so the symbol tables and
+    // negative lookup results keyed on them are only trustworthy within one
+    // stop.
+    m_symbolTables.clear();
+    m_symbolLookupFailed.clear();
+    m_lineLookupFailed.clear();
+
+    for (ULONG mi = 0; mi < numModules; mi++)
+    {
+        lldb::SBModule module = target.GetModuleAtIndex(mi);
+        if (!module.IsValid())
+        {
+            continue;
+        }
+
+        int numSections = module.GetNumSections();
+        for (int si = 0; si < numSections; si++)
+        {
+            lldb::SBSection section = module.GetSectionAtIndex(si);
+            if (!section.IsValid())
+            {
+                continue;
+            }
+
+            lldb::addr_t baseAddress = section.GetLoadAddress(target);
+            if (baseAddress == LLDB_INVALID_ADDRESS)
+            {
+                continue;
+            }
+
+            ModuleRange range;
+            range.Start = baseAddress;
+            range.End = baseAddress + section.GetByteSize();
+            range.ModuleBase = baseAddress - section.GetFileOffset();
+            range.Index = mi;
+            m_moduleRanges.push_back(range);
+        }
+    }
+
+    std::sort(m_moduleRanges.begin(), m_moduleRanges.end());
+
+    m_moduleCacheStopId = stopId;
+    m_moduleCacheNumModules = numModules;
+    m_moduleCacheValid = true;
+}
+
+// Binary search over the sorted entry array.  The last entry starting at or
+// before the address is the candidate; it only matches when the address falls
+// inside its [Start, End) range (or exactly on Start when the size is
+// unknown), so addresses in gaps between symbols miss instead of attributing
+// to the previous symbol.
+const LLDBServices::SymbolTable::Entry*
+LLDBServices::SymbolTable::Find(
+    ULONG64 addr) const
+{
+    size_t lo = 0;
+    size_t hi = Entries.size();
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (Entries[mid].Start <= addr)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if (lo == 0)
+    {
+        return NULL;
+    }
+    const Entry& entry = Entries[lo - 1];
+    if (addr == entry.Start || addr < entry.End)
+    {
+        return &entry;
+    }
+    return NULL;
+}
+
+// Returns the module's symbol table, extracting it from lldb on first use.
+// Extraction walks the module's symbol list once, interning the names into a
+// single string and recording load addresses; afterwards every lookup for
+// the module is a local binary search.  Returns NULL when the module has no
+// usable symbols, in which case the caller falls back to lldb per query.
+const LLDBServices::SymbolTable*
+LLDBServices::EnsureSymbolTable(
+    lldb::SBTarget& target,
+    lldb::SBModule& module,
+    ULONG64 moduleBase)
+{
+    std::unordered_map<ULONG64, SymbolTable>::iterator iter = m_symbolTables.find(moduleBase);
+    if (iter != m_symbolTables.end())
+    {
+        return iter->second.Valid ? &iter->second : NULL;
+    }
+
+    SymbolTable& table = m_symbolTables[moduleBase];
+
+    size_t numSymbols = module.GetNumSymbols();
+    table.Entries.reserve(numSymbols);
+
+    for (size_t i = 0; i < numSymbols; i++)
+    {
+        lldb::SBSymbol symbol = module.GetSymbolAtIndex(i);
+        if (!symbol.IsValid())
+        {
+            continue;
+        }
+
+        const char* name = symbol.GetName();
+        if (name == NULL || name[0] == '\0')
+        {
+            continue;
+        }
+
+        lldb::addr_t start = symbol.GetStartAddress().GetLoadAddress(target);
+        if (start == LLDB_INVALID_ADDRESS)
+        {
+            continue;
+        }
+
+        lldb::addr_t end = symbol.GetEndAddress().GetLoadAddress(target);
+        if (end == LLDB_INVALID_ADDRESS || end < start)
+        {
+            end = start;
+        }
+
+        SymbolTable::Entry entry;
+        entry.Start = start;
+        entry.End = end;
+        entry.NameOffset = (uint32_t)table.Names.size();
+        table.Names.append(name);
+        table.Names.append(1, '\0');
+        table.Entries.push_back(entry);
+    }
+
+    if (table.Entries.empty())
+    {
+        // Leave the invalid table cached so the module isn't rescanned.
+        return NULL;
+    }
+
+    std::sort(table.Entries.begin(), table.Entries.end());
+    table.Valid = true;
+    return &table;
+}
+
+HRESULT
 LLDBServices::GetModuleByOffset(
     ULONG64 offset,
     ULONG startIndex,
@@ -1064,7 +1553,6 @@ LLDBServices::GetModuleByOffset(
     ULONG moduleIndex = UINT32_MAX;
 
     lldb::SBTarget target;
-    int numModules;
 
     // lldb doesn't expect sign-extended address
     offset = CONVERT_FROM_SIGN_EXTENDED(offset);
@@ -1075,30 +1563,37 @@ LLDBServices::GetModuleByOffset(
         goto exit;
     }
 
-    numModules = target.GetNumModules();
-    for (int mi = startIndex; mi < numModules; mi++)
-    {
-        lldb::SBModule module = target.GetModuleAtIndex(mi);
+    EnsureModuleRangeCache(target);
 
-        int numSections = module.GetNumSections();
-        for (int si = 0; si < numSections; si++)
+    if (startIndex == 0)
+    {
+        // Sections don't overlap, so only the nearest range starting below
+        // the offset can contain it.
+        ModuleRange key;
+        key.Start = offset;
+        std::vector<ModuleRange>::const_iterator it =
+            std::upper_bound(m_moduleRanges.begin(), m_moduleRanges.end(), key);
+        if (it != m_moduleRanges.begin())
         {
-            lldb::SBSection section = module.GetSectionAtIndex(si);
-            if (section.IsValid())
+            --it;
+            if (offset > it->Start && offset < it->End)
             {
-                lldb::addr_t baseAddress = section.GetLoadAddress(target);
-                if (baseAddress != LLDB_INVALID_ADDRESS)
-                {
-                    if (offset > baseAddress)
-                    {
-                        if ((offset - baseAddress) < section.GetByteSize())
-                        {
-                            moduleIndex = mi;
-                            moduleBase = baseAddress - section.GetFileOffset();
-                            goto exit;
-                        }
-                    }
-                }
+                moduleIndex = it->Index;
+                moduleBase = it->ModuleBase;
+            }
+        }
+    }
+    else
+    {
+        // The rare callers that resume a search part way through the module
+        // list need the index filter, so walk the (already gathered) ranges.
+        for (std::vector<ModuleRange>::const_iterator it = m_moduleRanges.begin(); it != m_moduleRanges.end(); ++it)
+        {
+            if (it->Index >= startIndex && offset > it->Start && offset < it->End)
+            {
+                moduleIndex = it->Index;
+                moduleBase = it->ModuleBase;
+                break;
             }
         }
     }
@@ -1153,17 +1648,38 @@ LLDBServices::GetModuleNames(
     }
     else
     {
-        int numModules = target.GetNumModules();
-        for (int mi = 0; mi < numModules; mi++)
+        // Map the base back to a module index through the range cache
+        // instead of computing every module's base from its section list.
+        EnsureModuleRangeCache(target);
+        for (std::vector<ModuleRange>::const_iterator it = m_moduleRanges.begin(); it != m_moduleRanges.end(); ++it)
         {
-            lldb::SBModule module = target.GetModuleAtIndex(mi);
-            if (module.IsValid())
+            if (it->ModuleBase == base)
             {
-                ULONG64 moduleBase = GetModuleBase(target, module);
-                if (base == moduleBase)
+                lldb::SBModule module = target.GetModuleAtIndex(it->Index);
+                if (module.IsValid())
                 {
                     fileSpec = module.GetFileSpec();
-                    break;
+                }
+                break;
+            }
+        }
+
+        if (!fileSpec.IsValid())
+        {
+            // A module with no loaded sections isn't in the cache; fall back
+            // to the full walk, which also tries the object file header.
+            int numModules = target.GetNumModules();
+            for (int mi = 0; mi < numModules; mi++)
+            {
+                lldb::SBModule module = target.GetModuleAtIndex(mi);
+                if (module.IsValid())
+                {
+                    ULONG64 moduleBase = GetModuleBase(target, module);
+                    if (base == moduleBase)
+                    {
+                        fileSpec = module.GetFileSpec();
+                        break;
+                    }
                 }
             }
         }
@@ -1223,9 +1739,11 @@ LLDBServices::GetLineByOffset(
 
     lldb::SBTarget target;
     lldb::SBAddress address;
+    lldb::SBModule module;
     lldb::SBFileSpec file;
     lldb::SBLineEntry lineEntry;
     std::string str;
+    ULONG64 moduleBase = UINT64_MAX;
 
     // lldb doesn't expect sign-extended address
     offset = CONVERT_FROM_SIGN_EXTENDED(offset);
@@ -1244,7 +1762,23 @@ LLDBServices::GetLineByOffset(
         goto exit;
     }
 
-    if (displacement)
+    // A module already marked as having no line information fails right away
+    // instead of running another per-address lldb query.
+    module = address.GetModule();
+    if (module.IsValid())
+    {
+        moduleBase = GetModuleBase(target, module);
+        if (moduleBase != UINT64_MAX &&
+            m_lineLookupFailed.find(moduleBase) != m_lineLookupFailed.end())
+        {
+            hr = E_FAIL;
+            goto exit;
+        }
+    }
+
+    if (displacement &&
+        (moduleBase == UINT64_MAX ||
+         m_symbolLookupFailed.find(moduleBase) == m_symbolLookupFailed.end()))
     {
         lldb::SBSymbol symbol = address.GetSymbol();
         if (symbol.IsValid())
@@ -1257,6 +1791,14 @@ LLDBServices::GetLineByOffset(
     lineEntry = address.GetLineEntry();
     if (!lineEntry.IsValid())
     {
+        // Only a module with no symbol table at all is marked: it cannot
+        // carry debug info either, while a module with symbols may still
+        // have line entries for other addresses.
+        if (moduleBase != UINT64_MAX &&
+            EnsureSymbolTable(target, module, moduleBase) == NULL)
+        {
+            m_lineLookupFailed.insert(moduleBase);
+        }
         hr = E_FAIL;
         goto exit;
     }
@@ -1505,6 +2047,7 @@ LLDBServices::GetThreadContextById(
     lldb::SBThread thread;
     lldb::SBFrame frame;
     DT_CONTEXT *dtcontext;
+    uint32_t stopId = 0;
     HRESULT hr = E_FAIL;
 
     if (context == NULL || contextSize < sizeof(DT_CONTEXT))
@@ -1519,6 +2062,31 @@ LLDBServices::GetThreadContextById(
         goto exit;
     }
 
+    // Registers only change when the process runs, so repeat requests for
+    // the same thread within one stop are served from the cache instead of
+    // fetching every register from lldb again.  The "fake" thread id set by
+    // setsostid can be remapped without the process running, so that path
+    // bypasses the cache.
+    stopId = process.GetStopID();
+    if (!m_contextCacheValid || stopId != m_contextCacheStopId)
+    {
+        m_threadContexts.clear();
+        m_contextCacheStopId = stopId;
+        m_contextCacheValid = true;
+    }
+    if (g_currentThreadSystemId != threadID)
+    {
+        std::unordered_map<ULONG, DT_CONTEXT>::const_iterator itr = m_threadContexts.find(threadID);
+        if (itr != m_threadContexts.end())
+        {
+            dtcontext = (DT_CONTEXT*)context;
+            *dtcontext = itr->second;
+            dtcontext->ContextFlags = contextFlags;
+            hr = S_OK;
+            goto exit;
+        }
+    }
+
     // If we have a "fake" thread OS (system) id and a fake thread index,
     // use the fake thread index to get the context.
     if (g_currentThreadSystemId == threadID && g_currentThreadIndex != (ULONG)-1)
@@ -1529,7 +2097,7 @@ LLDBServices::GetThreadContextById(
     {
         thread = process.GetThreadByID(threadID);
     }
-    
+
     if (!thread.IsValid())
     {
         goto exit;
@@ -1545,6 +2113,10 @@ LLDBServices::GetThreadContextById(
     dtcontext->ContextFlags = contextFlags;
 
     GetContextFromFrame(frame, dtcontext);
+    if (g_currentThreadSystemId != threadID)
+    {
+        m_threadContexts[threadID] = *dtcontext;
+    }
     hr = S_OK;
 
 exit:
@@ -1807,6 +2379,109 @@ LLDBServices::AddModuleSymbol(
     return Execute(DEBUG_EXECUTE_NOT_LOGGED, command.c_str(), 0);
 }
 
+HRESULT
+LLDBServices::ReadVirtualBatch(
+    PREAD_VIRTUAL_ENTRY entries,
+    ULONG count)
+{
+    lldb::SBProcess process = GetCurrentProcess();
+    if (!process.IsValid())
+    {
+        for (ULONG i = 0; i < count; i++)
+        {
+            entries[i].BytesRead = 0;
+            entries[i].Status = E_FAIL;
+        }
+        return E_FAIL;
+    }
+
+    // Visit the requests in address order; on remote and dump targets
+    // sequential offsets are far more likely to hit the same cached page.
+    std::vector<ULONG> order(count);
+    for (ULONG i = 0; i < count; i++)
+    {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(),
+        [entries](ULONG lhs, ULONG rhs)
+        {
+            return entries[lhs].Offset < entries[rhs].Offset;
+        });
+
+    for (ULONG i = 0; i < count; i++)
+    {
+        PREAD_VIRTUAL_ENTRY entry = &entries[order[i]];
+        lldb::SBError error;
+
+        // lldb doesn't expect sign-extended address
+        ULONG64 offset = CONVERT_FROM_SIGN_EXTENDED(entry->Offset);
+
+#ifdef __linux__
+        if (entry->BufferSize != 0 && CoreFileRead(offset, entry->Buffer, entry->BufferSize) == entry->BufferSize)
+        {
+            entry->BytesRead = entry->BufferSize;
+            entry->Status = S_OK;
+            continue;
+        }
+#endif
+
+        size_t read = process.ReadMemory(offset, entry->Buffer, entry->BufferSize, error);
+        entry->BytesRead = read;
+        entry->Status = error.Success() || (read != 0) ? S_OK : E_FAIL;
+    }
+
+    return S_OK;
+}
+
+HRESULT
+LLDBServices::EnumerateMemoryRegions(
+    PFN_MEMORY_REGION_CALLBACK callback,
+    void* param)
+{
+    lldb::SBProcess process = GetCurrentProcess();
+    if (!process.IsValid())
+    {
+        return E_FAIL;
+    }
+
+    lldb::SBMemoryRegionInfoList regionList = process.GetMemoryRegions();
+    uint32_t count = regionList.GetSize();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        lldb::SBMemoryRegionInfo region;
+        if (!regionList.GetMemoryRegionAtIndex(i, region))
+        {
+            continue;
+        }
+
+        // The region list covers the whole address space; the gaps are
+        // represented as unmapped regions and are not reported.
+        if (!region.IsMapped())
+        {
+            continue;
+        }
+
+        ULONG permissions = 0;
+        if (region.IsReadable())
+        {
+            permissions |= MEMORY_REGION_READ;
+        }
+        if (region.IsWritable())
+        {
+            permissions |= MEMORY_REGION_WRITE;
+        }
+        if (region.IsExecutable())
+        {
+            permissions |= MEMORY_REGION_EXECUTE;
+        }
+
+        callback(param, region.GetRegionBase(), region.GetRegionEnd() - region.GetRegionBase(), permissions);
+    }
+
+    return S_OK;
+}
+
 //----------------------------------------------------------------------------
 // Helper functions
 //----------------------------------------------------------------------------
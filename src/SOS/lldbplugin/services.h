@@ -3,6 +3,10 @@
 // See the LICENSE file in the project root for more information.
 
 #include <cstdarg>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 class LLDBServices : public ILLDBServices, public ILLDBServices2
 {
@@ -14,6 +18,93 @@ private:
     lldb::SBProcess *m_currentProcess;
     lldb::SBThread *m_currentThread;
 
+    // One entry per loaded section, sorted by load address, so the
+    // module-by-address lookups SOS issues constantly during stack walks
+    // binary search instead of iterating every module's section list.
+    // Rebuilt when the process stops again or the module count changes.
+    struct ModuleRange
+    {
+        ULONG64 Start;          // section load address
+        ULONG64 End;            // section load address + byte size
+        ULONG64 ModuleBase;     // base of the module the section belongs to
+        ULONG Index;            // module index in the target's module list
+
+        bool operator<(const ModuleRange& rhs) const { return Start < rhs.Start; }
+    };
+
+    std::vector<ModuleRange> m_moduleRanges;
+    uint32_t m_moduleCacheStopId;
+    ULONG m_moduleCacheNumModules;
+    bool m_moduleCacheValid;
+
+    // Frame-0 register contexts keyed by thread id.  Contexts cannot change
+    // while the process is stopped, so consecutive stack-walking commands
+    // read each thread's registers from lldb once per stop instead of once
+    // per command.  Keyed on the stop id like the module range cache.
+    std::unordered_map<ULONG, DT_CONTEXT> m_threadContexts;
+    uint32_t m_contextCacheStopId;
+    bool m_contextCacheValid;
+
+    // Per-module symbol tables, extracted from lldb once and then searched
+    // locally.  Disassembly annotation resolves thousands of addresses per
+    // command; each lookup through lldb's symbol machinery is far more
+    // expensive than a binary search over a flat sorted array.  Entries hold
+    // offsets into one interned name string instead of per-symbol
+    // allocations.  A module whose extraction failed caches an invalid table
+    // so the lldb fallback is taken once per module, not once per query.
+    struct SymbolTable
+    {
+        struct Entry
+        {
+            ULONG64 Start;          // symbol load address
+            ULONG64 End;            // end load address, or Start if unknown
+            uint32_t NameOffset;    // offset of the name in Names
+
+            bool operator<(const Entry& rhs) const { return Start < rhs.Start; }
+        };
+
+        std::vector<Entry> Entries; // sorted by Start
+        std::string Names;          // null-separated interned symbol names
+        bool Valid;
+
+        SymbolTable() : Valid(false) {}
+
+        const Entry* Find(ULONG64 addr) const;
+    };
+
+    std::unordered_map<ULONG64, SymbolTable> m_symbolTables;
+
+    // Modules where a per-address lldb query already failed once, keyed by
+    // module base.  A stripped module fails every query, and each failure
+    // crawls the whole fallback chain; the first one marks the module so
+    // later addresses in it resolve immediately as module+offset.
+    std::unordered_set<ULONG64> m_symbolLookupFailed;
+    std::unordered_set<ULONG64> m_lineLookupFailed;
+
+    // Expression evaluation results keyed by the expression text (prefixed
+    // with the thread and frame identity, since expressions can reference
+    // registers and locals).  SOS re-evaluates the same handful of
+    // expressions every command; nothing they resolve can change while the
+    // process is stopped, and on a dump the stop id never changes, so each
+    // evaluation runs through lldb at most once per stop.
+    std::unordered_map<std::string, DWORD_PTR> m_expressionCache;
+    uint32_t m_expressionCacheStopId;
+    bool m_expressionCacheValid;
+
+    // Per-thread frame SP tables for VirtualUnwind.  A managed stack walk
+    // calls VirtualUnwind once per native frame, and each call walked the
+    // thread's whole frame list through lldb to find the frame containing
+    // the incoming SP.  The SP table is extracted once per thread per stop;
+    // each unwind then scans the plain array and fetches only the one frame
+    // it resolves to.  lldb computes and caches the actual unwind rules
+    // internally, so the memo is keyed by thread rather than by PC.
+    std::unordered_map<ULONG, std::vector<ULONG64>> m_threadFrameSps;
+    uint32_t m_unwindCacheStopId;
+    bool m_unwindCacheValid;
+
+    void EnsureModuleRangeCache(lldb::SBTarget& target);
+    const SymbolTable* EnsureSymbolTable(lldb::SBTarget& target, lldb::SBModule& module, ULONG64 moduleBase);
+
     void OutputString(ULONG mask, PCSTR str);
     ULONG64 GetModuleBase(lldb::SBTarget& target, lldb::SBModule& module);
     DWORD_PTR GetExpression(lldb::SBFrame& frame, lldb::SBError& error, PCSTR exp);
@@ -274,9 +365,17 @@ public:
         PFN_MODULE_LOAD_CALLBACK callback);
 
     HRESULT AddModuleSymbol(
-        void* param, 
+        void* param,
         const char* symbolFileName);
 
+    HRESULT ReadVirtualBatch(
+        PREAD_VIRTUAL_ENTRY entries,
+        ULONG count);
+
+    HRESULT EnumerateMemoryRegions(
+        PFN_MEMORY_REGION_CALLBACK callback,
+        void* param);
+
     //----------------------------------------------------------------------------
     // LLDBServices (internal)
     //----------------------------------------------------------------------------
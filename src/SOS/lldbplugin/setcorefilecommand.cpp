@@ -0,0 +1,46 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "sosplugin.h"
+#include <string.h>
+#include <string>
+
+class setcorefileCommand : public lldb::SBCommandPluginInterface
+{
+public:
+    setcorefileCommand()
+    {
+    }
+
+    virtual bool
+    DoExecute (lldb::SBDebugger debugger,
+               char** arguments,
+               lldb::SBCommandReturnObject &result)
+    {
+        if (arguments == nullptr || arguments[0] == nullptr)
+        {
+            const char* path = CoreFileGetPath();
+            result.Printf("Mapped core file: '%s'\n", path == nullptr ? "<none>" : path);
+        }
+        else {
+            if (CoreFileMap(arguments[0]))
+            {
+                result.Printf("Mapped core file '%s'; SOS now reads memory directly from it.\n", arguments[0]);
+            }
+            else
+            {
+                result.Printf("Failed to map '%s' as an ELF core file.\n", arguments[0]);
+            }
+        }
+        return result.Succeeded();
+    }
+};
+
+bool
+setcorefileCommandInitialize(lldb::SBDebugger debugger)
+{
+    lldb::SBCommandInterpreter interpreter = debugger.GetCommandInterpreter();
+    lldb::SBCommand command = interpreter.AddCommand("setcorefile", new setcorefileCommand(), "Map the ELF core file being debugged so SOS reads its memory directly from the file. setcorefile <path>");
+    return true;
+}
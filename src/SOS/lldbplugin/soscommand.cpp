@@ -153,6 +153,7 @@ sosCommandInitialize(lldb::SBDebugger debugger)
     interpreter.AddCommand("finalizequeue", new sosCommand("FinalizeQueue"), "Displays all objects registered for finalization.");
     interpreter.AddCommand("gcroot", new sosCommand("GCRoot"), "Displays info about references (or roots) to an object at the specified address.");
     interpreter.AddCommand("gcwhere", new sosCommand("GCWhere"), "Displays the location in the GC heap of the argument passed in.");
+    interpreter.AddCommand("heapdiff", new sosCommand("HeapDiff"), "Captures a snapshot of the per-type GC heap statistics, or diffs the heap against an earlier snapshot.");
     interpreter.AddCommand("ip2md", new sosCommand("IP2MD"), "Displays the MethodDesc structure at the specified address in code that has been JIT-compiled.");
     interpreter.AddCommand("loadsymbols", new sosCommand("SetSymbolServer", "-loadsymbols"), "Load the .NET Core native module symbols.");
     interpreter.AddCommand("name2ee", new sosCommand("Name2EE"), "Displays the MethodTable structure and EEClass structure for the specified type or method in the specified module.");
@@ -166,5 +167,8 @@ sosCommandInitialize(lldb::SBDebugger debugger)
     interpreter.AddCommand("sethostruntime", new sosCommand("SetHostRuntime"), "Sets or displays the .NET Core runtime directory to use to run managed code in SOS.");
     interpreter.AddCommand("setsymbolserver", new sosCommand("SetSymbolServer"), "Enables the symbol server support ");
     interpreter.AddCommand("soshelp", new sosCommand("Help"), "Displays all available commands when no parameter is specified, or displays detailed help information about the specified command. soshelp <command>");
+    interpreter.AddCommand("sosperf", new sosCommand("SOSPerf"), "Controls the opt-in per-command profiler, or prints its cumulative per-command totals.");
+    interpreter.AddCommand("sossnapshot", new sosCommand("SOSSnapshot"), "Saves the session caches to a file, or reloads them when the same dump is reopened.");
+    interpreter.AddCommand("whatis", new sosCommand("WhatIs"), "Classifies an address (or a file of addresses) as an object, MethodTable, MethodDesc, code or other runtime artifact, one line per address.");
     return true;
 }
@@ -14,5 +14,6 @@ lldb::PluginInitialize (lldb::SBDebugger debugger)
     sosCommandInitialize(debugger);
     setclrpathCommandInitialize(debugger);
     setsostidCommandInitialize(debugger);
+    setcorefileCommandInitialize(debugger);
     return true;
 }
@@ -15,7 +15,14 @@ extern char *g_coreclrDirectory;
 extern ULONG g_currentThreadIndex;
 extern ULONG g_currentThreadSystemId;
 
-bool 
+// Maps the given ELF core file so ReadVirtual can serve reads from it
+// directly; returns false if the file can't be mapped or isn't a core.
+bool CoreFileMap(const char *path);
+
+// Returns the path of the currently mapped core file or nullptr.
+const char *CoreFileGetPath();
+
+bool
 sosCommandInitialize(lldb::SBDebugger debugger);
 
 bool
@@ -23,3 +30,6 @@ setsostidCommandInitialize(lldb::SBDebugger debugger);
 
 bool
 setclrpathCommandInitialize(lldb::SBDebugger debugger);
+
+bool
+setcorefileCommandInitialize(lldb::SBDebugger debugger);
@@ -98,6 +98,58 @@ DBGEXT_DEF runcommand(__in PDEBUG_CLIENT4 client, __in PCSTR args)
     return hr;
 }
 
+// Batch mode for fleet triage: executes every command in a script file
+// against the already-open target, so a dump pays debugger+SOS startup once
+// instead of once per command.  Lines are commands; blank lines and lines
+// starting with '#' are skipped.  Each command is bracketed by markers the
+// harness splits on, with its HRESULT and wall time, and a failing command
+// does not stop the script - triage wants every result it can get.
+DBGEXT_DEF runscript(__in PDEBUG_CLIENT4 client, __in PCSTR args)
+{
+    FILE *file = NULL;
+    if (args == NULL || *args == '\0' || fopen_s(&file, args, "r") != 0 || file == NULL) {
+        dprintf("runscript: cannot open script file '%s'\n", args == NULL ? "" : args);
+        dprintf("<END_COMMAND_ERROR>\n");
+        return E_FAIL;
+    }
+
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+
+    char line[4096];
+    int commands = 0;
+    int failures = 0;
+
+    while (fgets(line, _countof(line), file) != NULL) {
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len == 0 || line[0] == '#') {
+            continue;
+        }
+
+        commands++;
+        dprintf("<BATCH_COMMAND %d> %s\n", commands, line);
+
+        LARGE_INTEGER start, end;
+        QueryPerformanceCounter(&start);
+        HRESULT hr = g_DebugControl->Execute(DEBUG_OUTCTL_ALL_CLIENTS, line, 0);
+        QueryPerformanceCounter(&end);
+
+        if (FAILED(hr)) {
+            failures++;
+        }
+        dprintf("<BATCH_STATUS %d> hr=0x%08x elapsed=%.3fs\n",
+                commands, hr, (double)(end.QuadPart - start.QuadPart) / (double)freq.QuadPart);
+    }
+    fclose(file);
+
+    dprintf("<BATCH_SUMMARY> %d commands, %d failed\n", commands, failures);
+    dprintf("<END_COMMAND_OUTPUT>\n");
+    return failures == 0 ? S_OK : S_FALSE;
+}
+
 void __cdecl
 dprintf(PCSTR Format, ...)
 {
@@ -5,6 +5,9 @@
 #ifndef __ARRAYHOLDER_H__
 #define __ARRAYHOLDER_H__
 
+#include <new>
+#include <stddef.h>
+
 template <class T>
 class ArrayHolder    
 {
@@ -24,6 +27,11 @@ public:
         m_ptr = const_cast<ArrayHolder *>(&rhs)->Detach();
     }
 
+    ArrayHolder(ArrayHolder &&rhs)
+    {
+        m_ptr = rhs.Detach();
+    }
+
     ArrayHolder &operator=(T *ptr)
     {
         Clear();
@@ -31,6 +39,15 @@ public:
         return *this;
     }
 
+    ArrayHolder &operator=(ArrayHolder &&rhs)
+    {
+        // Detach before Clear so self-assignment is harmless
+        T *ptr = rhs.Detach();
+        Clear();
+        m_ptr = ptr;
+        return *this;
+    }
+
     const T &operator[](int i) const
     {
         return m_ptr[i];
@@ -82,4 +99,90 @@ private:
     T *m_ptr;
 };
 
+// Like ArrayHolder, but carries an inline buffer of N elements and only
+// falls back to the heap when asked for more.  Intended for the short
+// name/signature buffers that commands fetch per object in hot loops,
+// where the typical length is well under N and the new[]/delete[] pair
+// dominates the cost.
+//
+//     SmallArrayHolder<WCHAR, 256> name;
+//     if (name.Alloc(needed) == NULL)
+//         return E_OUTOFMEMORY;
+//
+// Alloc may be called repeatedly; each call releases the previous
+// contents.  Unlike ArrayHolder there is no Detach or operator&, since
+// the buffer may live inside the holder itself.
+template <class T, size_t N>
+class SmallArrayHolder
+{
+public:
+    SmallArrayHolder()
+        : m_ptr(NULL)
+    {
+    }
+
+    ~SmallArrayHolder()
+    {
+        Clear();
+    }
+
+    // Returns a buffer of at least 'count' elements, or NULL if a heap
+    // allocation was required and failed.
+    T *Alloc(size_t count)
+    {
+        Clear();
+        if (count <= N)
+        {
+            m_ptr = m_inline;
+        }
+        else
+        {
+            m_ptr = new (std::nothrow) T[count];
+        }
+        return m_ptr;
+    }
+
+    const T &operator[](int i) const
+    {
+        return m_ptr[i];
+    }
+
+    T &operator[](int i)
+    {
+        return m_ptr[i];
+    }
+
+    operator const T *() const
+    {
+        return m_ptr;
+    }
+
+    operator T *()
+    {
+        return m_ptr;
+    }
+
+    T *GetPtr()
+    {
+        return m_ptr;
+    }
+
+private:
+    void Clear()
+    {
+        if (m_ptr && m_ptr != m_inline)
+        {
+            delete [] m_ptr;
+        }
+        m_ptr = NULL;
+    }
+
+    SmallArrayHolder(const SmallArrayHolder &);            // not copyable
+    SmallArrayHolder &operator=(const SmallArrayHolder &);
+
+private:
+    T *m_ptr;
+    T m_inline[N];
+};
+
 #endif // __ARRAYHOLDER_H__
\ No newline at end of file
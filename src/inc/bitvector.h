@@ -314,6 +314,218 @@ public:
 
     int  NumBits() const;
 
+    /* Bulk operations.  These work a machine word at a time (with the
+       compiler's popcount/count-trailing-zeros intrinsics where available)
+       so large vectors are not walked bit by bit.  They are implemented
+       inline, without the out-of-line doBig helpers, so they are usable
+       in STRIKE builds as well. */
+
+    // Set 'count' bits starting at bit 'start'
+    void SetRange(unsigned start, unsigned count)
+    {
+        WRAPPER_NO_CONTRACT;
+        SUPPORTS_DAC;
+
+        if (count == 0)
+            return;
+
+        _ASSERTE(start + count <= MAX_PTRARG_OFS);
+
+        unsigned end = start + count;
+
+        if (!isBig() && (end <= SMALL_BITS))
+        {
+            m_val |= ((((ChunkType)1 << count) - 1) << (start + 1));
+            return;
+        }
+
+        growBig((end + CHUNK_BITS - 1) / CHUNK_BITS);
+
+        unsigned firstChunk = start / CHUNK_BITS;
+        unsigned lastChunk  = (end - 1) / CHUNK_BITS;
+
+        for (unsigned i = firstChunk; i <= lastChunk; i++)
+        {
+            ChunkType mask = ~(ChunkType)0;
+            if (i == firstChunk)
+            {
+                mask &= (~(ChunkType)0) << (start % CHUNK_BITS);
+            }
+            if ((i == lastChunk) && ((end % CHUNK_BITS) != 0))
+            {
+                mask &= (~(ChunkType)0) >> (CHUNK_BITS - (end % CHUNK_BITS));
+            }
+            m_vals.m_chunks[i] |= mask;
+        }
+    }
+
+    // Clear 'count' bits starting at bit 'start'
+    void ClearRange(unsigned start, unsigned count)
+    {
+        WRAPPER_NO_CONTRACT;
+        SUPPORTS_DAC;
+
+        if (count == 0)
+            return;
+
+        if (!isBig())
+        {
+            if (start >= SMALL_BITS)
+                return;
+            if (count > SMALL_BITS - start)
+                count = SMALL_BITS - start;
+            m_val &= ~((((ChunkType)1 << count) - 1) << (start + 1));
+            return;
+        }
+
+        unsigned length = m_vals.GetLength();
+        if (start >= length * CHUNK_BITS)
+            return;
+        unsigned end = start + count;
+        if (end > length * CHUNK_BITS)
+            end = length * CHUNK_BITS;
+
+        unsigned firstChunk = start / CHUNK_BITS;
+        unsigned lastChunk  = (end - 1) / CHUNK_BITS;
+
+        for (unsigned i = firstChunk; i <= lastChunk; i++)
+        {
+            ChunkType mask = ~(ChunkType)0;
+            if (i == firstChunk)
+            {
+                mask &= (~(ChunkType)0) << (start % CHUNK_BITS);
+            }
+            if ((i == lastChunk) && ((end % CHUNK_BITS) != 0))
+            {
+                mask &= (~(ChunkType)0) >> (CHUNK_BITS - (end % CHUNK_BITS));
+            }
+            m_vals.m_chunks[i] &= ~mask;
+        }
+
+        // Preserve the invariant that zero is stored in the small form
+        for (unsigned i = 0; i < length; i++)
+        {
+            if (m_vals.m_chunks[i] != 0)
+                return;
+        }
+        m_val = 0;
+    }
+
+    // Return the number of set bits
+    unsigned CountBits() const
+    {
+        WRAPPER_NO_CONTRACT;
+        SUPPORTS_DAC;
+
+        if (!isBig())
+        {
+            return CountChunkBits(smallBits());
+        }
+
+        unsigned count  = 0;
+        unsigned length = m_vals.GetLength();
+        for (unsigned i = 0; i < length; i++)
+        {
+            count += CountChunkBits(m_vals.m_chunks[i]);
+        }
+        return count;
+    }
+
+    // Return the index of the first set bit at or after bit 'start',
+    // or -1 if there is none
+    int FindNextSet(unsigned start) const
+    {
+        WRAPPER_NO_CONTRACT;
+        SUPPORTS_DAC;
+
+        if (!isBig())
+        {
+            if (start >= SMALL_BITS)
+                return -1;
+            ChunkType bits = smallBits() & ((~(ChunkType)0) << start);
+            if (bits == 0)
+                return -1;
+            return (int)FindLowestBitSet(bits);
+        }
+
+        unsigned length = m_vals.GetLength();
+        unsigned chunk  = start / CHUNK_BITS;
+        if (chunk >= length)
+            return -1;
+
+        ChunkType bits = m_vals.m_chunks[chunk] & ((~(ChunkType)0) << (start % CHUNK_BITS));
+        for (;;)
+        {
+            if (bits != 0)
+            {
+                return (int)(chunk * CHUNK_BITS + FindLowestBitSet(bits));
+            }
+            if (++chunk >= length)
+                return -1;
+            bits = m_vals.m_chunks[chunk];
+        }
+    }
+
+    // Iterates over the indices of the set bits, scanning a machine word
+    // at a time and peeling set bits off with the find-lowest-bit
+    // intrinsic.  Usage:
+    //     for (BitVector::Iterator it(vec); it.MoveNext(); )
+    //         use(it.Current());
+    class Iterator
+    {
+    public:
+        Iterator(const BitVector& vector)
+        {
+            WRAPPER_NO_CONTRACT;
+            SUPPORTS_DAC;
+
+            m_pVector = &vector;
+            m_chunk   = 0;
+            m_current = 0;
+            if (vector.isBig())
+            {
+                m_cChunks = vector.m_vals.GetLength();
+                m_bits    = vector.m_vals.m_chunks[0];
+            }
+            else
+            {
+                m_cChunks = 1;
+                m_bits    = vector.smallBits();
+            }
+        }
+
+        BOOL MoveNext()
+        {
+            WRAPPER_NO_CONTRACT;
+            SUPPORTS_DAC;
+
+            while (m_bits == 0)
+            {
+                if (++m_chunk >= m_cChunks)
+                    return FALSE;
+                m_bits = m_pVector->m_vals.m_chunks[m_chunk];
+            }
+            m_current = m_chunk * CHUNK_BITS + FindLowestBitSet(m_bits);
+            m_bits &= m_bits - 1;   // clear the bit we just returned
+            return TRUE;
+        }
+
+        unsigned Current() const
+        {
+            LIMITED_METHOD_CONTRACT;
+            SUPPORTS_DAC;
+
+            return m_current;
+        }
+
+    private:
+        const BitVector* m_pVector;
+        ChunkType        m_bits;      // unconsumed bits of the current chunk
+        unsigned         m_chunk;
+        unsigned         m_cChunks;
+        unsigned         m_current;
+    };
+
 private:
 
     static const ChunkType MaxVal = ((ChunkType)1 << SMALL_BITS) - 1;    // Maximum value that can be stored in m_val
@@ -372,6 +584,89 @@ private:
     };
 
 
+    // Population count of one chunk
+    static unsigned CountChunkBits(ChunkType chunk)
+    {
+        LIMITED_METHOD_CONTRACT;
+        SUPPORTS_DAC;
+
+#if defined(__GNUC__) || defined(__clang__)
+        if (sizeof(ChunkType) == 8)
+            return (unsigned)__builtin_popcountll(chunk);
+        else
+            return (unsigned)__builtin_popcount((unsigned)chunk);
+#else
+        // Parallel bit count; compilers emit popcnt for this where the
+        // target supports it
+        chunk = chunk - ((chunk >> 1) & (ChunkType)0x5555555555555555ULL);
+        chunk = (chunk & (ChunkType)0x3333333333333333ULL) + ((chunk >> 2) & (ChunkType)0x3333333333333333ULL);
+        chunk = (chunk + (chunk >> 4)) & (ChunkType)0x0f0f0f0f0f0f0f0fULL;
+        return (unsigned)((chunk * (ChunkType)0x0101010101010101ULL) >> (CHUNK_BITS - 8));
+#endif
+    }
+
+    // Index of the lowest set bit in a non-zero chunk
+    static unsigned FindLowestBitSet(ChunkType chunk)
+    {
+        LIMITED_METHOD_CONTRACT;
+        SUPPORTS_DAC;
+
+        _ASSERTE(chunk != 0);
+#if defined(__GNUC__) || defined(__clang__)
+        if (sizeof(ChunkType) == 8)
+            return (unsigned)__builtin_ctzll(chunk);
+        else
+            return (unsigned)__builtin_ctz((unsigned)chunk);
+#elif defined(_MSC_VER)
+        unsigned long index;
+#ifdef _WIN64
+        _BitScanForward64(&index, chunk);
+#else
+        _BitScanForward(&index, chunk);
+#endif
+        return (unsigned)index;
+#else
+        unsigned index = 0;
+        while ((chunk & 1) == 0)
+        {
+            chunk >>= 1;
+            index++;
+        }
+        return index;
+#endif
+    }
+
+    // Switch to (or extend) the big representation so that at least
+    // 'length' chunks are valid.  Unlike toBig() this does not rely on
+    // the out-of-line doBigInit, which is stubbed out under STRIKE.
+    void growBig(unsigned length)
+    {
+        WRAPPER_NO_CONTRACT;
+        SUPPORTS_DAC;
+
+        _ASSERTE(length > 0);
+        _ASSERTE(length <= VALS_COUNT);
+
+        if (!isBig())
+        {
+            ChunkType bits = smallBits();
+            m_vals.m_chunks[0] = bits;
+            for (unsigned i = 1; i < length; i++)
+            {
+                m_vals.m_chunks[i] = 0;
+            }
+            m_vals.SetLength(length);
+        }
+        else if (m_vals.GetLength() < length)
+        {
+            for (unsigned i = m_vals.GetLength(); i < length; i++)
+            {
+                m_vals.m_chunks[i] = 0;
+            }
+            m_vals.SetLength(length);
+        }
+    }
+
     ChunkType smallBits() const
     {
         LIMITED_METHOD_CONTRACT;
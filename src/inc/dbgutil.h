@@ -30,6 +30,17 @@ HRESULT GetMachineAndResourceSectionRVA(ICorDebugDataTarget* pDataTarget,
     WORD* pwImageFileMachine,
     DWORD* pdwResourceSectionRVA);
 
+class DataTargetBufferedReader;
+
+// Variants that parse against a caller-owned header cache, so one probe
+// (e.g. CLRDebuggingImpl::GetCLRInfo walking headers, version resource and
+// debug resource of the same module) shares a single block read per region
+// instead of refetching it in every helper.
+HRESULT GetMachineAndResourceSectionRVA(DataTargetBufferedReader& reader,
+    ULONG64 moduleBaseAddress,
+    WORD* pwImageFileMachine,
+    DWORD* pdwResourceSectionRVA);
+
 HRESULT GetResourceRvaFromResourceSectionRva(ICorDebugDataTarget* pDataTarget,
     ULONG64 moduleBaseAddress,
     DWORD resourceSectionRva,
@@ -39,6 +50,15 @@ HRESULT GetResourceRvaFromResourceSectionRva(ICorDebugDataTarget* pDataTarget,
     DWORD* pResourceRva,
     DWORD* pResourceSize);
 
+HRESULT GetResourceRvaFromResourceSectionRva(DataTargetBufferedReader& reader,
+    ULONG64 moduleBaseAddress,
+    DWORD resourceSectionRva,
+    DWORD type,
+    DWORD name,
+    DWORD language,
+    DWORD* pResourceRva,
+    DWORD* pResourceSize);
+
 HRESULT GetResourceRvaFromResourceSectionRvaByName(ICorDebugDataTarget* pDataTarget,
     ULONG64 moduleBaseAddress,
     DWORD resourceSectionRva,
@@ -48,6 +68,15 @@ HRESULT GetResourceRvaFromResourceSectionRvaByName(ICorDebugDataTarget* pDataTar
     DWORD* pResourceRva,
     DWORD* pResourceSize);
 
+HRESULT GetResourceRvaFromResourceSectionRvaByName(DataTargetBufferedReader& reader,
+    ULONG64 moduleBaseAddress,
+    DWORD resourceSectionRva,
+    DWORD type,
+    LPCWSTR pwszName,
+    DWORD language,
+    DWORD* pResourceRva,
+    DWORD* pResourceSize);
+
 // Traverses down one level in the PE resource tree structure
 // 
 // Arguments:
@@ -91,3 +120,29 @@ HRESULT ReadFromDataTarget(ICorDebugDataTarget* pDataTarget,
     ULONG64 addr,
     BYTE* pBuffer,
     ULONG32 bytesToRead);
+
+// Serves small reads out of a page-sized buffer filled with one target read,
+// so field-by-field parsing (PE headers, resource directories) costs one
+// ReadVirtual per page instead of one per field. Reads that miss the buffer
+// refill it from the requested address; reads larger than the buffer go to
+// the target directly.
+class DataTargetBufferedReader
+{
+public:
+    DataTargetBufferedReader(ICorDebugDataTarget* pDataTarget);
+
+    // Same contract as ReadFromDataTarget: the full read succeeds or the
+    // call fails.
+    HRESULT Read(ULONG64 addr, BYTE* pBuffer, ULONG32 bytesToRead);
+
+private:
+    // Large enough that the DOS header, NT headers and section table - and
+    // typically the root of the resource directory - are covered by one
+    // target read per module probed.
+    static const ULONG32 kBufferSize = 0x2000;
+
+    ICorDebugDataTarget* m_pDataTarget;
+    ULONG64 m_bufferBase;
+    ULONG32 m_bufferValid;    // valid bytes in m_buffer, 0 when empty
+    BYTE m_buffer[kBufferSize];
+};
@@ -211,6 +211,8 @@ enum GcInfoDecoderFlags
 #if defined(_TARGET_ARM_) || defined(_TARGET_ARM64_)
     DECODE_HAS_TAILCALLS         = 0x4000,
 #endif // _TARGET_ARM_ || _TARGET_ARM64_
+    DECODE_SLOTS_ONLY            = 0x8000,  // caller only reads the slot table; skips the
+                                            // safe-point lookup for the break offset
 };
 
 enum GcInfoHeaderFlags
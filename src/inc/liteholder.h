@@ -0,0 +1,120 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#ifndef __LITEHOLDER_H__
+#define __LITEHOLDER_H__
+
+#include <stddef.h>
+
+// Policy-based holders for hot paths.  Unlike the general holder
+// framework in holder.h, which threads acquire/release through
+// function-pointer template arguments and a holder base class, these
+// bind the release action at compile time through a policy type whose
+// static Release is trivially inlined.  There is no vtable, no stored
+// function pointer, and no state beyond the wrapped pointer, so
+// instantiating one per object in an enumeration loop costs exactly
+// what the hand-written cleanup would.
+//
+// Use the general holders for cold paths; use these where the holder
+// itself shows up in a profile.
+
+// Releases a COM-style interface pointer.  Never AddRefs.
+template <class T>
+struct LiteReleasePolicy
+{
+    static void Release(T *ptr)
+    {
+        ptr->Release();
+    }
+};
+
+template <class T>
+struct LiteDeletePolicy
+{
+    static void Release(T *ptr)
+    {
+        delete ptr;
+    }
+};
+
+template <class T>
+struct LiteDeleteArrayPolicy
+{
+    static void Release(T *ptr)
+    {
+        delete [] ptr;
+    }
+};
+
+// The default policy makes LiteHolder<T> a drop-in for ToRelease<T>.
+template <class T, class POLICY = LiteReleasePolicy<T> >
+class LiteHolder
+{
+public:
+    LiteHolder()
+        : m_ptr(NULL)
+    {}
+
+    LiteHolder(T *ptr)
+        : m_ptr(ptr)
+    {}
+
+    ~LiteHolder()
+    {
+        Release();
+    }
+
+    void operator=(T *ptr)
+    {
+        Release();
+
+        m_ptr = ptr;
+    }
+
+    T* operator->() const
+    {
+        return m_ptr;
+    }
+
+    operator T*() const
+    {
+        return m_ptr;
+    }
+
+    // As with ToRelease: release first or the current contents leak
+    T** operator&()
+    {
+        return &m_ptr;
+    }
+
+    T* GetPtr() const
+    {
+        return m_ptr;
+    }
+
+    T* Detach()
+    {
+        T *pT = m_ptr;
+        m_ptr = NULL;
+        return pT;
+    }
+
+    void Release()
+    {
+        if (m_ptr != NULL)
+        {
+            POLICY::Release(m_ptr);
+            m_ptr = NULL;
+        }
+    }
+
+private:
+    LiteHolder(const LiteHolder &);            // not copyable
+    LiteHolder &operator=(const LiteHolder &);
+
+private:
+    T *m_ptr;
+};
+
+#endif // __LITEHOLDER_H__
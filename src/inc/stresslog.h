@@ -286,10 +286,26 @@ public:
     //preallocate up to per thread size limit
     static BOOL ReserveStressLogChunks (unsigned chunksToReserve);
 
+    // Optional message filters for Dump, applied against the raw message
+    // fields before any formatting.  Default-constructed fields leave the
+    // corresponding filter disabled.
+    struct DumpFilter
+    {
+        unsigned threadId;      // only the log chain for this thread id (0 == all)
+        ULONG64 facilityMask;   // only messages logged with one of these facilities (0 == all)
+        double afterSecs;       // only messages at or after this time, in seconds from log start
+        double beforeSecs;      // only messages at or before this time
+
+        DumpFilter() : threadId(0), facilityMask(0), afterSecs(-1.0), beforeSecs(-1.0) {}
+    };
+
     // used by out of process debugger to dump the stress log to 'fileName'
-    // IDebugDataSpaces is the NTSD execution callback for getting process memory.  
+    // IDebugDataSpaces is the NTSD execution callback for getting process memory.
     // This function is defined in the tools\strike\stressLogDump.cpp file
-    static HRESULT Dump(ULONG64 logAddr, const char* fileName, struct IDebugDataSpaces* memCallBack);    
+    // When bBinary is set the file receives fixed-width raw records plus a
+    // format-string table instead of formatted text; the layout is described
+    // at the top of stressLogDump.cpp.
+    static HRESULT Dump(ULONG64 logAddr, const char* fileName, struct IDebugDataSpaces* memCallBack, const DumpFilter* pFilter = NULL, BOOL bBinary = FALSE);
 
     static BOOL StressLogOn(unsigned facility, unsigned level);
     static BOOL ETWLogOn(unsigned facility, unsigned level);
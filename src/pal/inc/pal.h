@@ -379,6 +379,27 @@ PAL_ProbeMemory(
     DWORD cbBuffer,
     BOOL fWriteAccess);
 
+// Access hints for PAL_AdviseMappedRange
+#define PAL_MAP_HINT_NORMAL     0   // no special access pattern
+#define PAL_MAP_HINT_SEQUENTIAL 1   // expect sequential access; aggressive readahead
+#define PAL_MAP_HINT_RANDOM     2   // expect random access; disable readahead
+#define PAL_MAP_HINT_WILLNEED   3   // expect access soon; start populating now
+
+PALIMPORT
+BOOL
+PALAPI
+PAL_AdviseMappedRange(
+    IN LPVOID lpAddress,
+    IN SIZE_T cbSize,
+    IN DWORD dwHint);
+
+PALIMPORT
+BOOL
+PALAPI
+PAL_ProbeMappedRange(
+    IN LPVOID lpAddress,
+    IN SIZE_T cbSize);
+
 /******************* winuser.h Entrypoints *******************************/
 PALIMPORT
 LPSTR
@@ -894,6 +915,61 @@ ReadFile(
      OUT LPDWORD lpNumberOfBytesRead,
      IN LPOVERLAPPED lpOverlapped);
 
+//
+// Positional and vectored file I/O (PAL only). These transfer data at an
+// explicit file offset without moving the handle's file pointer, so
+// concurrent users of one handle need no seek serialization and a
+// seek+read/write pair collapses into one syscall.
+//
+
+typedef struct _PAL_IOVEC {
+    LPVOID Buffer;
+    SIZE_T Length;
+} PAL_IOVEC, *PPAL_IOVEC;
+
+// Maximum number of segments accepted by the vectored transfers below
+#define PAL_MAXIMUM_IO_SEGMENTS 64
+
+PALIMPORT
+BOOL
+PALAPI
+PAL_ReadFileAt(
+     IN HANDLE hFile,
+     IN ULONG64 ullFileOffset,
+     OUT LPVOID lpBuffer,
+     IN DWORD nNumberOfBytesToRead,
+     OUT LPDWORD lpNumberOfBytesRead);
+
+PALIMPORT
+BOOL
+PALAPI
+PAL_WriteFileAt(
+     IN HANDLE hFile,
+     IN ULONG64 ullFileOffset,
+     IN LPCVOID lpBuffer,
+     IN DWORD nNumberOfBytesToWrite,
+     OUT LPDWORD lpNumberOfBytesWritten);
+
+PALIMPORT
+BOOL
+PALAPI
+PAL_ReadFileVectorAt(
+     IN HANDLE hFile,
+     IN ULONG64 ullFileOffset,
+     IN PAL_IOVEC *rgSegments,
+     IN DWORD dwSegmentCount,
+     OUT LPDWORD lpNumberOfBytesRead);
+
+PALIMPORT
+BOOL
+PALAPI
+PAL_WriteFileVectorAt(
+     IN HANDLE hFile,
+     IN ULONG64 ullFileOffset,
+     IN PAL_IOVEC *rgSegments,
+     IN DWORD dwSegmentCount,
+     OUT LPDWORD lpNumberOfBytesWritten);
+
 #define STD_INPUT_HANDLE         ((DWORD)-10)
 #define STD_OUTPUT_HANDLE        ((DWORD)-11)
 #define STD_ERROR_HANDLE         ((DWORD)-12)
@@ -2050,6 +2126,7 @@ SetErrorMode(
 #define MEM_TOP_DOWN                    0x100000
 #define MEM_WRITE_WATCH                 0x200000
 #define MEM_RESERVE_EXECUTABLE          0x40000000 // reserve memory using executable memory allocator
+#define MEM_LARGE_PAGES                 0x20000000 // commit with large pages where the platform can; advisory, commits fall back to base pages
 
 PALIMPORT
 HANDLE
@@ -2089,6 +2166,7 @@ CreateFileMappingW(
 #define FILE_MAP_READ       SECTION_MAP_READ
 #define FILE_MAP_ALL_ACCESS SECTION_ALL_ACCESS
 #define FILE_MAP_COPY       SECTION_QUERY
+#define FILE_MAP_POPULATE   0x10000000 /* PAL only: prefault the view (MAP_POPULATE) for mappings the caller knows are hot */
 
 PALIMPORT
 HANDLE
@@ -2723,6 +2801,32 @@ QueryPerformanceFrequency(
     OUT LARGE_INTEGER *lpFrequency
     );
 
+//
+// Coarse time queries (PAL only). These trade precision for speed: they
+// read the kernel's coarse clocks where available (millisecond-ish
+// resolution, serviced from the vDSO without entering the kernel) and
+// fall back to the precise equivalents elsewhere. Intended for
+// high-frequency timestamping -- logging, sampling -- where querying the
+// precise clock on every event costs more than the event being timed.
+// PAL_QueryPerformanceCounterCoarse returns counts in the same units as
+// QueryPerformanceCounter, so one QueryPerformanceFrequency result
+// converts either.
+//
+
+PALIMPORT
+VOID
+PALAPI
+PAL_GetSystemTimeAsFileTimeCoarse(
+    OUT LPFILETIME lpSystemTimeAsFileTime
+    );
+
+PALIMPORT
+BOOL
+PALAPI
+PAL_QueryPerformanceCounterCoarse(
+    OUT LARGE_INTEGER *lpPerformanceCount
+    );
+
 PALIMPORT
 INT
 PALAPI
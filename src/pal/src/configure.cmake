@@ -79,6 +79,8 @@ set(CMAKE_REQUIRED_LIBRARIES m)
 check_function_exists(copysign HAVE_COPYSIGN)
 set(CMAKE_REQUIRED_LIBRARIES)
 check_function_exists(fsync HAVE_FSYNC)
+check_function_exists(preadv HAVE_PREADV)
+check_function_exists(pwritev HAVE_PWRITEV)
 check_function_exists(futimes HAVE_FUTIMES)
 check_function_exists(utimes HAVE_UTIMES)
 check_function_exists(sysctl HAVE_SYSCTL)
@@ -406,6 +408,19 @@ int main()
 }" HAVE_CLOCK_MONOTONIC_COARSE)
 check_cxx_source_runs("
 #include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+
+int main()
+{
+  int ret;
+  struct timespec ts;
+  ret = clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+
+  exit(ret);
+}" HAVE_CLOCK_REALTIME_COARSE)
+check_cxx_source_runs("
+#include <stdlib.h>
 #include <mach/mach_time.h>
 
 int main()
@@ -38,6 +38,7 @@ SET_DEFAULT_DEBUG_CHANNEL(FILE); // some headers have code with asserts, so do t
 #include <sys/stat.h>
 #include <sys/param.h>
 #include <sys/mount.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <limits.h>
 
@@ -2143,6 +2144,623 @@ ReadFile(
     return NO_ERROR == palError;
 }
 
+/*++
+Function:
+  FILEReferenceFileForPositionalIo
+
+Helper for the positional I/O routines below: resolves a file handle to
+its Unix file descriptor, checking the requested access right. On success
+the caller owns a reference on *ppFileObject and must release it once the
+I/O is done; the descriptor stays valid for that long
+--*/
+static PAL_ERROR FILEReferenceFileForPositionalIo(
+    CPalThread *pThread,
+    HANDLE hFile,
+    DWORD dwDesiredAccess,
+    IPalObject **ppFileObject,
+    int *pifd
+    )
+{
+    PAL_ERROR palError = NO_ERROR;
+    IPalObject *pFileObject = NULL;
+    CFileProcessLocalData *pLocalData = NULL;
+    IDataLock *pLocalDataLock = NULL;
+
+    palError = g_pObjectManager->ReferenceObjectByHandle(
+        pThread,
+        hFile,
+        &aotFile,
+        dwDesiredAccess,
+        &pFileObject
+        );
+
+    if (NO_ERROR != palError)
+    {
+        goto done;
+    }
+
+    palError = pFileObject->GetProcessLocalData(
+        pThread,
+        ReadLock,
+        &pLocalDataLock,
+        reinterpret_cast<void**>(&pLocalData)
+        );
+
+    if (NO_ERROR != palError)
+    {
+        goto done;
+    }
+
+    if (pLocalData->open_flags_deviceaccessonly == TRUE)
+    {
+        ERROR("File open for device access only\n");
+        palError = ERROR_ACCESS_DENIED;
+        goto done;
+    }
+
+    *pifd = pLocalData->unix_fd;
+
+done:
+
+    if (NULL != pLocalDataLock)
+    {
+        pLocalDataLock->ReleaseLock(pThread, FALSE);
+    }
+
+    if (NO_ERROR == palError)
+    {
+        *ppFileObject = pFileObject;
+    }
+    else if (NULL != pFileObject)
+    {
+        pFileObject->ReleaseReference(pThread);
+    }
+
+    return palError;
+}
+
+PAL_ERROR
+CorUnix::InternalReadFileAt(
+    CPalThread *pThread,
+    HANDLE hFile,
+    ULONG64 ullFileOffset,
+    LPVOID lpBuffer,
+    DWORD nNumberOfBytesToRead,
+    LPDWORD lpNumberOfBytesRead
+    )
+{
+    PAL_ERROR palError = NO_ERROR;
+    IPalObject *pFileObject = NULL;
+    int ifd;
+    ssize_t res;
+
+    if (NULL == lpNumberOfBytesRead)
+    {
+        ERROR( "lpNumberOfBytesRead is NULL\n" );
+        palError = ERROR_INVALID_PARAMETER;
+        goto done;
+    }
+
+    *lpNumberOfBytesRead = 0;
+
+    if (INVALID_HANDLE_VALUE == hFile)
+    {
+        ERROR( "Invalid file handle\n" );
+        palError = ERROR_INVALID_HANDLE;
+        goto done;
+    }
+    else if (NULL == lpBuffer)
+    {
+        ERROR( "Invalid parameter. (lpBuffer:%p)\n", lpBuffer);
+        palError = ERROR_NOACCESS;
+        goto done;
+    }
+
+    palError = FILEReferenceFileForPositionalIo(
+        pThread, hFile, GENERIC_READ, &pFileObject, &ifd);
+    if (NO_ERROR != palError)
+    {
+        goto done;
+    }
+
+    do
+    {
+        res = pread(ifd, lpBuffer, nNumberOfBytesToRead, (off_t)ullFileOffset);
+    } while (-1 == res && EINTR == errno);
+
+    TRACE("pread() returns %d\n", (int)res);
+
+    if (res >= 0)
+    {
+        *lpNumberOfBytesRead = (DWORD)res;
+    }
+    else
+    {
+        palError = FILEGetLastErrorFromErrno();
+    }
+
+done:
+
+    if (NULL != pFileObject)
+    {
+        pFileObject->ReleaseReference(pThread);
+    }
+
+    return palError;
+}
+
+PAL_ERROR
+CorUnix::InternalWriteFileAt(
+    CPalThread *pThread,
+    HANDLE hFile,
+    ULONG64 ullFileOffset,
+    LPCVOID lpBuffer,
+    DWORD nNumberOfBytesToWrite,
+    LPDWORD lpNumberOfBytesWritten
+    )
+{
+    PAL_ERROR palError = NO_ERROR;
+    IPalObject *pFileObject = NULL;
+    int ifd;
+    ssize_t res;
+
+    if (NULL == lpNumberOfBytesWritten)
+    {
+        ASSERT( "lpNumberOfBytesWritten is NULL\n" );
+        palError = ERROR_INVALID_PARAMETER;
+        goto done;
+    }
+
+    *lpNumberOfBytesWritten = 0;
+
+    if (INVALID_HANDLE_VALUE == hFile || hFile == pStdIn)
+    {
+        palError = ERROR_INVALID_HANDLE;
+        goto done;
+    }
+
+    palError = FILEReferenceFileForPositionalIo(
+        pThread, hFile, GENERIC_WRITE, &pFileObject, &ifd);
+    if (NO_ERROR != palError)
+    {
+        goto done;
+    }
+
+    do
+    {
+        res = pwrite(ifd, lpBuffer, nNumberOfBytesToWrite, (off_t)ullFileOffset);
+    } while (-1 == res && EINTR == errno);
+
+    TRACE("pwrite() returns %d\n", (int)res);
+
+    if (res >= 0)
+    {
+        *lpNumberOfBytesWritten = (DWORD)res;
+    }
+    else
+    {
+        palError = FILEGetLastErrorFromErrno();
+    }
+
+done:
+
+    if (NULL != pFileObject)
+    {
+        pFileObject->ReleaseReference(pThread);
+    }
+
+    return palError;
+}
+
+PAL_ERROR
+CorUnix::InternalReadFileVectorAt(
+    CPalThread *pThread,
+    HANDLE hFile,
+    ULONG64 ullFileOffset,
+    PAL_IOVEC *rgSegments,
+    DWORD dwSegmentCount,
+    LPDWORD lpNumberOfBytesRead
+    )
+{
+    PAL_ERROR palError = NO_ERROR;
+    IPalObject *pFileObject = NULL;
+    int ifd;
+
+    if (NULL == lpNumberOfBytesRead)
+    {
+        ERROR( "lpNumberOfBytesRead is NULL\n" );
+        palError = ERROR_INVALID_PARAMETER;
+        goto done;
+    }
+
+    *lpNumberOfBytesRead = 0;
+
+    if (INVALID_HANDLE_VALUE == hFile)
+    {
+        ERROR( "Invalid file handle\n" );
+        palError = ERROR_INVALID_HANDLE;
+        goto done;
+    }
+    else if (NULL == rgSegments || 0 == dwSegmentCount
+             || dwSegmentCount > PAL_MAXIMUM_IO_SEGMENTS)
+    {
+        ERROR( "Invalid segment list. (rgSegments:%p count:%u)\n",
+               rgSegments, dwSegmentCount);
+        palError = ERROR_INVALID_PARAMETER;
+        goto done;
+    }
+
+    palError = FILEReferenceFileForPositionalIo(
+        pThread, hFile, GENERIC_READ, &pFileObject, &ifd);
+    if (NO_ERROR != palError)
+    {
+        goto done;
+    }
+
+#if HAVE_PREADV
+    {
+        struct iovec rgiov[PAL_MAXIMUM_IO_SEGMENTS];
+        ssize_t res;
+
+        for (DWORD dw = 0; dw < dwSegmentCount; dw += 1)
+        {
+            rgiov[dw].iov_base = rgSegments[dw].Buffer;
+            rgiov[dw].iov_len = rgSegments[dw].Length;
+        }
+
+        do
+        {
+            res = preadv(ifd, rgiov, (int)dwSegmentCount, (off_t)ullFileOffset);
+        } while (-1 == res && EINTR == errno);
+
+        TRACE("preadv() returns %d\n", (int)res);
+
+        if (res >= 0)
+        {
+            *lpNumberOfBytesRead = (DWORD)res;
+        }
+        else
+        {
+            palError = FILEGetLastErrorFromErrno();
+        }
+    }
+#else // HAVE_PREADV
+    //
+    // No native scatter read: fall back to one pread per segment,
+    // stopping at the first short or failed transfer
+    //
+    for (DWORD dw = 0; dw < dwSegmentCount; dw += 1)
+    {
+        ssize_t res;
+
+        do
+        {
+            res = pread(ifd, rgSegments[dw].Buffer, rgSegments[dw].Length,
+                        (off_t)ullFileOffset);
+        } while (-1 == res && EINTR == errno);
+
+        if (res < 0)
+        {
+            palError = FILEGetLastErrorFromErrno();
+            break;
+        }
+
+        *lpNumberOfBytesRead += (DWORD)res;
+        ullFileOffset += (ULONG64)res;
+
+        if ((SIZE_T)res < rgSegments[dw].Length)
+        {
+            break;
+        }
+    }
+#endif // HAVE_PREADV
+
+done:
+
+    if (NULL != pFileObject)
+    {
+        pFileObject->ReleaseReference(pThread);
+    }
+
+    return palError;
+}
+
+PAL_ERROR
+CorUnix::InternalWriteFileVectorAt(
+    CPalThread *pThread,
+    HANDLE hFile,
+    ULONG64 ullFileOffset,
+    PAL_IOVEC *rgSegments,
+    DWORD dwSegmentCount,
+    LPDWORD lpNumberOfBytesWritten
+    )
+{
+    PAL_ERROR palError = NO_ERROR;
+    IPalObject *pFileObject = NULL;
+    int ifd;
+
+    if (NULL == lpNumberOfBytesWritten)
+    {
+        ASSERT( "lpNumberOfBytesWritten is NULL\n" );
+        palError = ERROR_INVALID_PARAMETER;
+        goto done;
+    }
+
+    *lpNumberOfBytesWritten = 0;
+
+    if (INVALID_HANDLE_VALUE == hFile || hFile == pStdIn)
+    {
+        palError = ERROR_INVALID_HANDLE;
+        goto done;
+    }
+    else if (NULL == rgSegments || 0 == dwSegmentCount
+             || dwSegmentCount > PAL_MAXIMUM_IO_SEGMENTS)
+    {
+        ERROR( "Invalid segment list. (rgSegments:%p count:%u)\n",
+               rgSegments, dwSegmentCount);
+        palError = ERROR_INVALID_PARAMETER;
+        goto done;
+    }
+
+    palError = FILEReferenceFileForPositionalIo(
+        pThread, hFile, GENERIC_WRITE, &pFileObject, &ifd);
+    if (NO_ERROR != palError)
+    {
+        goto done;
+    }
+
+#if HAVE_PWRITEV
+    {
+        struct iovec rgiov[PAL_MAXIMUM_IO_SEGMENTS];
+        ssize_t res;
+
+        for (DWORD dw = 0; dw < dwSegmentCount; dw += 1)
+        {
+            rgiov[dw].iov_base = rgSegments[dw].Buffer;
+            rgiov[dw].iov_len = rgSegments[dw].Length;
+        }
+
+        do
+        {
+            res = pwritev(ifd, rgiov, (int)dwSegmentCount, (off_t)ullFileOffset);
+        } while (-1 == res && EINTR == errno);
+
+        TRACE("pwritev() returns %d\n", (int)res);
+
+        if (res >= 0)
+        {
+            *lpNumberOfBytesWritten = (DWORD)res;
+        }
+        else
+        {
+            palError = FILEGetLastErrorFromErrno();
+        }
+    }
+#else // HAVE_PWRITEV
+    //
+    // No native gather write: fall back to one pwrite per segment,
+    // stopping at the first short or failed transfer
+    //
+    for (DWORD dw = 0; dw < dwSegmentCount; dw += 1)
+    {
+        ssize_t res;
+
+        do
+        {
+            res = pwrite(ifd, rgSegments[dw].Buffer, rgSegments[dw].Length,
+                         (off_t)ullFileOffset);
+        } while (-1 == res && EINTR == errno);
+
+        if (res < 0)
+        {
+            palError = FILEGetLastErrorFromErrno();
+            break;
+        }
+
+        *lpNumberOfBytesWritten += (DWORD)res;
+        ullFileOffset += (ULONG64)res;
+
+        if ((SIZE_T)res < rgSegments[dw].Length)
+        {
+            break;
+        }
+    }
+#endif // HAVE_PWRITEV
+
+done:
+
+    if (NULL != pFileObject)
+    {
+        pFileObject->ReleaseReference(pThread);
+    }
+
+    return palError;
+}
+
+/*++
+Function:
+  PAL_ReadFileAt
+
+Reads from a file at an explicit offset, without moving the handle's
+file pointer
+--*/
+BOOL
+PALAPI
+PAL_ReadFileAt(
+     IN HANDLE hFile,
+     IN ULONG64 ullFileOffset,
+     OUT LPVOID lpBuffer,
+     IN DWORD nNumberOfBytesToRead,
+     OUT LPDWORD lpNumberOfBytesRead)
+{
+    PAL_ERROR palError;
+    CPalThread *pThread;
+
+    PERF_ENTRY(PAL_ReadFileAt);
+    ENTRY("PAL_ReadFileAt(hFile=%p, offset=%I64u, lpBuffer=%p, nToRead=%u, "
+          "lpRead=%p)\n",
+          hFile, ullFileOffset, lpBuffer, nNumberOfBytesToRead,
+          lpNumberOfBytesRead);
+
+    pThread = InternalGetCurrentThread();
+
+    palError = InternalReadFileAt(
+        pThread,
+        hFile,
+        ullFileOffset,
+        lpBuffer,
+        nNumberOfBytesToRead,
+        lpNumberOfBytesRead
+        );
+
+    if (NO_ERROR != palError)
+    {
+        pThread->SetLastError(palError);
+    }
+
+    LOGEXIT("PAL_ReadFileAt returns BOOL %d\n", NO_ERROR == palError);
+    PERF_EXIT(PAL_ReadFileAt);
+    return NO_ERROR == palError;
+}
+
+/*++
+Function:
+  PAL_WriteFileAt
+
+Writes to a file at an explicit offset, without moving the handle's
+file pointer
+--*/
+BOOL
+PALAPI
+PAL_WriteFileAt(
+     IN HANDLE hFile,
+     IN ULONG64 ullFileOffset,
+     IN LPCVOID lpBuffer,
+     IN DWORD nNumberOfBytesToWrite,
+     OUT LPDWORD lpNumberOfBytesWritten)
+{
+    PAL_ERROR palError;
+    CPalThread *pThread;
+
+    PERF_ENTRY(PAL_WriteFileAt);
+    ENTRY("PAL_WriteFileAt(hFile=%p, offset=%I64u, lpBuffer=%p, nToWrite=%u, "
+          "lpWritten=%p)\n",
+          hFile, ullFileOffset, lpBuffer, nNumberOfBytesToWrite,
+          lpNumberOfBytesWritten);
+
+    pThread = InternalGetCurrentThread();
+
+    palError = InternalWriteFileAt(
+        pThread,
+        hFile,
+        ullFileOffset,
+        lpBuffer,
+        nNumberOfBytesToWrite,
+        lpNumberOfBytesWritten
+        );
+
+    if (NO_ERROR != palError)
+    {
+        pThread->SetLastError(palError);
+    }
+
+    LOGEXIT("PAL_WriteFileAt returns BOOL %d\n", NO_ERROR == palError);
+    PERF_EXIT(PAL_WriteFileAt);
+    return NO_ERROR == palError;
+}
+
+/*++
+Function:
+  PAL_ReadFileVectorAt
+
+Scatter-reads from a file at an explicit offset into up to
+PAL_MAXIMUM_IO_SEGMENTS buffers, without moving the handle's file pointer
+--*/
+BOOL
+PALAPI
+PAL_ReadFileVectorAt(
+     IN HANDLE hFile,
+     IN ULONG64 ullFileOffset,
+     IN PAL_IOVEC *rgSegments,
+     IN DWORD dwSegmentCount,
+     OUT LPDWORD lpNumberOfBytesRead)
+{
+    PAL_ERROR palError;
+    CPalThread *pThread;
+
+    PERF_ENTRY(PAL_ReadFileVectorAt);
+    ENTRY("PAL_ReadFileVectorAt(hFile=%p, offset=%I64u, rgSegments=%p, "
+          "dwSegmentCount=%u, lpRead=%p)\n",
+          hFile, ullFileOffset, rgSegments, dwSegmentCount,
+          lpNumberOfBytesRead);
+
+    pThread = InternalGetCurrentThread();
+
+    palError = InternalReadFileVectorAt(
+        pThread,
+        hFile,
+        ullFileOffset,
+        rgSegments,
+        dwSegmentCount,
+        lpNumberOfBytesRead
+        );
+
+    if (NO_ERROR != palError)
+    {
+        pThread->SetLastError(palError);
+    }
+
+    LOGEXIT("PAL_ReadFileVectorAt returns BOOL %d\n", NO_ERROR == palError);
+    PERF_EXIT(PAL_ReadFileVectorAt);
+    return NO_ERROR == palError;
+}
+
+/*++
+Function:
+  PAL_WriteFileVectorAt
+
+Gather-writes to a file at an explicit offset from up to
+PAL_MAXIMUM_IO_SEGMENTS buffers, without moving the handle's file pointer
+--*/
+BOOL
+PALAPI
+PAL_WriteFileVectorAt(
+     IN HANDLE hFile,
+     IN ULONG64 ullFileOffset,
+     IN PAL_IOVEC *rgSegments,
+     IN DWORD dwSegmentCount,
+     OUT LPDWORD lpNumberOfBytesWritten)
+{
+    PAL_ERROR palError;
+    CPalThread *pThread;
+
+    PERF_ENTRY(PAL_WriteFileVectorAt);
+    ENTRY("PAL_WriteFileVectorAt(hFile=%p, offset=%I64u, rgSegments=%p, "
+          "dwSegmentCount=%u, lpWritten=%p)\n",
+          hFile, ullFileOffset, rgSegments, dwSegmentCount,
+          lpNumberOfBytesWritten);
+
+    pThread = InternalGetCurrentThread();
+
+    palError = InternalWriteFileVectorAt(
+        pThread,
+        hFile,
+        ullFileOffset,
+        rgSegments,
+        dwSegmentCount,
+        lpNumberOfBytesWritten
+        );
+
+    if (NO_ERROR != palError)
+    {
+        pThread->SetLastError(palError);
+    }
+
+    LOGEXIT("PAL_WriteFileVectorAt returns BOOL %d\n", NO_ERROR == palError);
+    PERF_EXIT(PAL_WriteFileVectorAt);
+    return NO_ERROR == palError;
+}
+
 
 /*++
 Function:
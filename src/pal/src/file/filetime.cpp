@@ -188,6 +188,46 @@ GetSystemTimeAsFileTime(
     PERF_EXIT(GetSystemTimeAsFileTime);
 }
 
+/*++
+Function:
+  PAL_GetSystemTimeAsFileTimeCoarse
+
+Like GetSystemTimeAsFileTime, but reads the kernel's coarse realtime
+clock where one exists: tick resolution instead of nanoseconds, in
+exchange for a query that stays in the vDSO. Intended for callers that
+timestamp at high frequency (logging and the like) and don't need
+sub-millisecond accuracy. Falls back to the precise clock on platforms
+without a coarse one.
+--*/
+VOID
+PALAPI
+PAL_GetSystemTimeAsFileTimeCoarse(
+            OUT LPFILETIME lpSystemTimeAsFileTime)
+{
+#if HAVE_WORKING_CLOCK_GETTIME && HAVE_CLOCK_REALTIME_COARSE
+    PERF_ENTRY(PAL_GetSystemTimeAsFileTimeCoarse);
+    ENTRY("PAL_GetSystemTimeAsFileTimeCoarse(lpSystemTimeAsFileTime=%p)\n",
+          lpSystemTimeAsFileTime);
+
+    struct timespec Time;
+    if (clock_gettime(CLOCK_REALTIME_COARSE, &Time) == 0)
+    {
+        *lpSystemTimeAsFileTime = FILEUnixTimeToFileTime( Time.tv_sec, Time.tv_nsec );
+    }
+    else
+    {
+        /* no way to indicate failure, so set time to zero */
+        ASSERT("clock_gettime(CLOCK_REALTIME_COARSE) failed");
+        *lpSystemTimeAsFileTime = FILEUnixTimeToFileTime( 0, 0 );
+    }
+
+    LOGEXIT("PAL_GetSystemTimeAsFileTimeCoarse returns.\n");
+    PERF_EXIT(PAL_GetSystemTimeAsFileTimeCoarse);
+#else
+    GetSystemTimeAsFileTime(lpSystemTimeAsFileTime);
+#endif // HAVE_WORKING_CLOCK_GETTIME && HAVE_CLOCK_REALTIME_COARSE
+}
+
 
 #ifdef __APPLE__
 /*++
@@ -14,6 +14,12 @@ Abstract:
 
     Implementation of a basic handle table
 
+    The table is a set of fixed-size slabs that are allocated on demand
+    and stay at their addresses until shutdown, so a handle value can be
+    turned into its entry without taking any lock. Entry ownership is
+    arbitrated with interlocked state transitions; the critical section
+    only covers slab growth (and external callers of Lock()/Unlock()).
+
 
 
 --*/
@@ -36,48 +42,188 @@ const HANDLE hPseudoCurrentThread  = (HANDLE) 0xFFFFFF03;
 /* Pseudo handle constant for the global IO Completion port */
 const HANDLE hPseudoGlobalIOCP  = (HANDLE) 0xFFFFFF05;
 
+/* The free list head packs the first free index into the low DWORD
+   (all-ones for an empty list) and a version tag into the high DWORD;
+   the tag is bumped on every update to defeat ABA on the CAS. */
+#define FREE_LIST_INDEX(ll)     ((DWORD)((ll) & 0xFFFFFFFF))
+#define FREE_LIST_NEXT_VERSION(ll) (((ll) + ((LONGLONG)1 << 32)) & (LONGLONG)0xFFFFFFFF00000000LL)
+#define FREE_LIST_EMPTY_INDEX   ((DWORD)-1)
+
 PAL_ERROR
 CSimpleHandleManager::Initialize(
     void
     )
 {
     PAL_ERROR palError = NO_ERROR;
-    
+
     InternalInitializeCriticalSection(&m_csLock);
     m_fLockInitialized = TRUE;
 
-    m_dwTableGrowthRate = c_BasicGrowthRate;
+    /* allocate the first slab; no other thread can be using the table
+       yet, so there's no need to take the lock here */
+    palError = GrowTable();
+    if (NO_ERROR != palError)
+    {
+        ERROR("Unable to create initial handle table slab\n");
+        goto InitializeExit;
+    }
+
+    TRACE("Handle Manager initialization complete.\n");
+
+InitializeExit:
+
+    return palError;
+}
+
+/*++
+Function :
+    GrowTable
 
-    /* initialize the handle table - the free list is stored in the 'object'
-       field, with the head in the global 'm_hiFreeListStart'. */
-    m_dwTableSize = m_dwTableGrowthRate;
-    
-    m_rghteHandleTable = reinterpret_cast<HANDLE_TABLE_ENTRY*>(InternalMalloc((m_dwTableSize * sizeof(HANDLE_TABLE_ENTRY))));
-    if(NULL == m_rghteHandleTable)
+    Add one slab's worth of entries to the handle table and splice them
+    onto the free list. The caller must hold m_csLock (or be running
+    single-threaded, as during Initialize); concurrent lock-free readers
+    are unaffected because existing slabs never move.
+--*/
+PAL_ERROR
+CSimpleHandleManager::GrowTable(
+    void
+    )
+{
+    PAL_ERROR palError = NO_ERROR;
+    HANDLE_TABLE_ENTRY *rghteSlab;
+    DWORD dwSlab;
+    DWORD dwBase;
+    LONGLONG llOldHead;
+    LONGLONG llNewHead;
+
+    dwBase = m_dwTableSize;
+    dwSlab = dwBase / c_SlabSize;
+
+    TRACE("Handle pool empty (%d handles allocated), growing handle table "
+          "by %d entries.\n", dwBase, c_SlabSize);
+
+    /* make sure handle values don't overflow */
+    if (dwSlab >= c_MaxSlabs || dwBase + c_SlabSize >= c_MaxIndex)
     {
-        ERROR("Unable to create initial handle table array");
+        WARN("Unable to allocate handle : maximum (%d) reached!\n", dwBase);
         palError = ERROR_OUTOFMEMORY;
-        goto InitializeExit;
+        goto GrowTableExit;
     }
 
-    for (DWORD i = 0; i < m_dwTableSize; i++)
+    rghteSlab = reinterpret_cast<HANDLE_TABLE_ENTRY*>(InternalMalloc(c_SlabSize * sizeof(HANDLE_TABLE_ENTRY)));
+    if (NULL == rghteSlab)
     {
-        m_rghteHandleTable[i].u.hiNextIndex = i + 1;
-        m_rghteHandleTable[i].fEntryAllocated = FALSE;
+        WARN("not enough memory to grow handle table!\n");
+        palError = ERROR_OUTOFMEMORY;
+        goto GrowTableExit;
     }
 
-    m_rghteHandleTable[m_dwTableSize - 1].u.hiNextIndex = (HANDLE_INDEX)-1;
-    
-    m_hiFreeListStart = 0;
-    m_hiFreeListEnd = m_dwTableSize - 1;
+    /* new handles are initially invalid; chain them together so the
+       whole slab can be spliced onto the free list with a single CAS */
+    for (DWORD dw = 0; dw < c_SlabSize; dw += 1)
+    {
+        rghteSlab[dw].u.hiNextIndex = dwBase + dw + 1;
+        rghteSlab[dw].lState = c_lEntryFree;
+    }
 
-    TRACE("Handle Manager initialization complete.\n");
+    /* publish the slab before making its entries reachable through the
+       free list; the table size only ever grows */
+    m_rgSlabs[dwSlab] = rghteSlab;
+    m_dwTableSize = dwBase + c_SlabSize;
+
+    do
+    {
+        llOldHead = m_llFreeListHead;
+        rghteSlab[c_SlabSize - 1].u.hiNextIndex = FREE_LIST_INDEX(llOldHead);
+        llNewHead = FREE_LIST_NEXT_VERSION(llOldHead) | (LONGLONG)dwBase;
+    }
+    while (llOldHead != InterlockedCompareExchange64(&m_llFreeListHead,
+                                                     llNewHead,
+                                                     llOldHead));
+
+GrowTableExit:
 
-InitializeExit:
-    
     return palError;
 }
 
+/*++
+Function :
+    PopFreeIndex
+
+    Remove the first free entry from the lock-free free list. Returns
+    c_hiInvalid if the list is empty. The stale-next hazard (the head
+    entry being popped and reused while we read its next link) is
+    resolved by the version tag: the CAS fails and we retry.
+--*/
+CSimpleHandleManager::HANDLE_INDEX
+CSimpleHandleManager::PopFreeIndex(
+    void
+    )
+{
+    LONGLONG llOldHead;
+    LONGLONG llNewHead;
+    DWORD dwIndex;
+    HANDLE_INDEX hiNext;
+
+    for (;;)
+    {
+        llOldHead = m_llFreeListHead;
+        dwIndex = FREE_LIST_INDEX(llOldHead);
+        if (FREE_LIST_EMPTY_INDEX == dwIndex)
+        {
+            return c_hiInvalid;
+        }
+
+        /* this read may be stale if another thread pops and reuses the
+           entry in the meantime; the version tag makes the CAS below
+           fail in that case, so the stale value is never used */
+        hiNext = EntryFromIndex(dwIndex)->u.hiNextIndex;
+
+        llNewHead = FREE_LIST_NEXT_VERSION(llOldHead) | (LONGLONG)(DWORD)hiNext;
+        if (llOldHead == InterlockedCompareExchange64(&m_llFreeListHead,
+                                                      llNewHead,
+                                                      llOldHead))
+        {
+            return (HANDLE_INDEX)dwIndex;
+        }
+
+        YieldProcessor();
+    }
+}
+
+/*++
+Function :
+    PushFreeIndex
+
+    Return an entry to the lock-free free list. The entry must already
+    be marked c_lEntryFree so that stale handles naming it fail
+    validation.
+--*/
+void
+CSimpleHandleManager::PushFreeIndex(
+    HANDLE_INDEX hi
+    )
+{
+    HANDLE_TABLE_ENTRY *pEntry = EntryFromIndex(hi);
+    LONGLONG llOldHead;
+    LONGLONG llNewHead;
+
+    for (;;)
+    {
+        llOldHead = m_llFreeListHead;
+        pEntry->u.hiNextIndex = FREE_LIST_INDEX(llOldHead);
+        llNewHead = FREE_LIST_NEXT_VERSION(llOldHead) | (LONGLONG)(DWORD)hi;
+        if (llOldHead == InterlockedCompareExchange64(&m_llFreeListHead,
+                                                      llNewHead,
+                                                      llOldHead))
+        {
+            return;
+        }
+
+        YieldProcessor();
+    }
+}
+
 PAL_ERROR
 CSimpleHandleManager::AllocateHandle(
     CPalThread *pThread,
@@ -88,85 +234,57 @@ CSimpleHandleManager::AllocateHandle(
     )
 {
     PAL_ERROR palError = NO_ERROR;
-    DWORD dwIndex;
-
-    Lock(pThread);
+    HANDLE_INDEX hi;
+    HANDLE_TABLE_ENTRY *pEntry;
 
-    /* if no free handles are available, we need to grow the handle table and
-       add new handles to the pool */
-    if (m_hiFreeListStart == c_hiInvalid)
+    /* the common case pops a free entry without taking the lock; the
+       lock is only needed to grow the table, and the free list is
+       re-checked under it since another thread may have grown (or
+       freed handles) while we waited */
+    for (;;)
     {
-        HANDLE_TABLE_ENTRY* rghteTempTable;
+        hi = PopFreeIndex();
+        if (c_hiInvalid != hi)
+        {
+            break;
+        }
 
-        TRACE("Handle pool empty (%d handles allocated), growing handle table "
-              "by %d entries.\n", m_dwTableSize, m_dwTableGrowthRate );
+        Lock(pThread);
 
-        /* make sure handle values don't overflow */
-        if (m_dwTableSize + m_dwTableGrowthRate >= c_MaxIndex)
+        hi = PopFreeIndex();
+        if (c_hiInvalid == hi)
         {
-            WARN("Unable to allocate handle : maximum (%d) reached!\n",
-                 m_dwTableSize);
-            palError = ERROR_OUTOFMEMORY;
-            goto AllocateHandleExit;
+            palError = GrowTable();
         }
 
-        /* grow handle table */
-        rghteTempTable = reinterpret_cast<HANDLE_TABLE_ENTRY*>(InternalRealloc(
-            m_rghteHandleTable,
-            (m_dwTableSize + m_dwTableGrowthRate) * sizeof(HANDLE_TABLE_ENTRY)));
-        
-        if (NULL == rghteTempTable)
+        Unlock(pThread);
+
+        if (c_hiInvalid != hi)
         {
-            WARN("not enough memory to grow handle table!\n");
-            palError = ERROR_OUTOFMEMORY;
-            goto AllocateHandleExit;
+            break;
         }
-        m_rghteHandleTable = rghteTempTable;
 
-        /* update handle table and handle pool */
-        for (DWORD dw = m_dwTableSize; dw < m_dwTableSize + m_dwTableGrowthRate; dw += 1)
+        if (NO_ERROR != palError)
         {
-            /* new handles are initially invalid */
-            /* the last "old" handle was m_dwTableSize-1, so the new
-               handles range from m_dwTableSize to
-               m_dwTableSize+m_dwTableGrowthRate-1 */
-            m_rghteHandleTable[dw].u.hiNextIndex = dw + 1;
-            m_rghteHandleTable[dw].fEntryAllocated = FALSE;
+            goto AllocateHandleExit;
         }
-
-        m_hiFreeListStart = m_dwTableSize;
-        m_dwTableSize += m_dwTableGrowthRate;
-        m_rghteHandleTable[m_dwTableSize - 1].u.hiNextIndex = (HANDLE_INDEX)-1;
-        m_hiFreeListEnd = m_dwTableSize - 1;
-        
     }
 
-    /* take the next free handle */
-    dwIndex = m_hiFreeListStart;
-
-    /* remove the handle from the pool */
-    m_hiFreeListStart = m_rghteHandleTable[dwIndex].u.hiNextIndex;
-    
-    /* clear the tail record if this is the last handle slot available */
-    if(m_hiFreeListStart == c_hiInvalid) 
-    {
-        m_hiFreeListEnd = c_hiInvalid;
-    }
+    /* save the data associated with the new handle; the state is
+       published last so lookups never observe a half-filled entry */
+    pEntry = EntryFromIndex(hi);
 
-    /* save the data associated with the new handle */
-    *ph = HandleIndexToHandle(dwIndex);
-    
     pObject->AddReference();
-    m_rghteHandleTable[dwIndex].u.pObject = pObject;
-    m_rghteHandleTable[dwIndex].dwAccessRights = dwAccessRights;
-    m_rghteHandleTable[dwIndex].fInheritable = fInheritable;
-    m_rghteHandleTable[dwIndex].fEntryAllocated = TRUE;
+    pEntry->u.pObject = pObject;
+    pEntry->dwAccessRights = dwAccessRights;
+    pEntry->fInheritable = fInheritable;
+    pEntry->lState = c_lEntryAllocated;
 
-AllocateHandleExit:
+    *ph = HandleIndexToHandle(hi);
 
-    Unlock(pThread);
+AllocateHandleExit:
 
-    return palError;    
+    return palError;
 }
 
 PAL_ERROR
@@ -179,25 +297,51 @@ CSimpleHandleManager::GetObjectFromHandle(
 {
     PAL_ERROR palError = NO_ERROR;
     HANDLE_INDEX hi;
+    HANDLE_TABLE_ENTRY *pEntry;
+    LONG lState;
 
-    Lock(pThread);
-    
     if (!ValidateHandle(h))
     {
         ERROR("Tried to dereference an invalid handle %p\n", h);
         palError = ERROR_INVALID_HANDLE;
         goto GetObjectFromHandleExit;
     }
-    
+
     hi = HandleToHandleIndex(h);
+    pEntry = EntryFromIndex(hi);
+
+    /* claim the entry for the duration of the reads and the reference
+       acquisition; a concurrent FreeHandle will either beat us to the
+       claim (and we'll see the entry as free) or wait until we've
+       taken our reference */
+    for (;;)
+    {
+        lState = InterlockedCompareExchange(&pEntry->lState,
+                                            c_lEntryBusy,
+                                            c_lEntryAllocated);
+        if (c_lEntryAllocated == lState)
+        {
+            break;
+        }
+
+        if (c_lEntryFree == lState)
+        {
+            ERROR("Tried to dereference an invalid handle %p\n", h);
+            palError = ERROR_INVALID_HANDLE;
+            goto GetObjectFromHandleExit;
+        }
+
+        /* busy -- another thread holds a momentary claim */
+        YieldProcessor();
+    }
 
-    *pdwRightsGranted = m_rghteHandleTable[hi].dwAccessRights;
-    *ppObject = m_rghteHandleTable[hi].u.pObject;
+    *pdwRightsGranted = pEntry->dwAccessRights;
+    *ppObject = pEntry->u.pObject;
     (*ppObject)->AddReference();
-    
-GetObjectFromHandleExit:
 
-    Unlock(pThread);
+    pEntry->lState = c_lEntryAllocated;
+
+GetObjectFromHandleExit:
 
     return palError;
 }
@@ -210,9 +354,9 @@ CSimpleHandleManager::FreeHandle(
 {
     PAL_ERROR palError = NO_ERROR;
     IPalObject *pobj = NULL;
-    HANDLE_INDEX hi = HandleToHandleIndex(h);
-
-    Lock(pThread);
+    HANDLE_INDEX hi;
+    HANDLE_TABLE_ENTRY *pEntry;
+    LONG lState;
 
     if (!ValidateHandle(h))
     {
@@ -221,32 +365,38 @@ CSimpleHandleManager::FreeHandle(
         goto FreeHandleExit;
     }
 
-    if (HandleIsSpecial(h))
+    hi = HandleToHandleIndex(h);
+    pEntry = EntryFromIndex(hi);
+
+    for (;;)
     {
-        ASSERT("Trying to free Special Handle %p.\n", h);
-        palError = ERROR_INVALID_HANDLE;
-        goto FreeHandleExit;
-    }
+        lState = InterlockedCompareExchange(&pEntry->lState,
+                                            c_lEntryBusy,
+                                            c_lEntryAllocated);
+        if (c_lEntryAllocated == lState)
+        {
+            break;
+        }
 
-    pobj = m_rghteHandleTable[hi].u.pObject;
-    m_rghteHandleTable[hi].fEntryAllocated = FALSE;
+        if (c_lEntryFree == lState)
+        {
+            ERROR("Trying to free invalid handle %p.\n", h);
+            palError = ERROR_INVALID_HANDLE;
+            goto FreeHandleExit;
+        }
 
-    /* add handle to the free pool */
-    if(m_hiFreeListEnd != c_hiInvalid)
-    {
-        m_rghteHandleTable[m_hiFreeListEnd].u.hiNextIndex = hi;
+        /* busy -- a lookup holds a momentary claim on the entry */
+        YieldProcessor();
     }
-    else
-    {
-        m_hiFreeListStart = hi;
-    }
-    
-    m_rghteHandleTable[hi].u.hiNextIndex = c_hiInvalid;
-    m_hiFreeListEnd = hi;
 
-FreeHandleExit:    
+    pobj = pEntry->u.pObject;
 
-    Unlock(pThread);
+    /* mark the entry free before putting it back in the pool, so stale
+       handles fail validation from this point on */
+    pEntry->lState = c_lEntryFree;
+    PushFreeIndex(hi);
+
+FreeHandleExit:
 
     if (NULL != pobj)
     {
@@ -260,7 +410,10 @@ FreeHandleExit:
 Function :
     ValidateHandle
 
-    Check if a handle was allocated by this handle manager
+    Check if a handle could have been allocated by this handle manager.
+    The per-entry allocation state is not examined here -- that check is
+    performed as part of the interlocked entry claim by the caller, so
+    it can't race with a concurrent free.
 
 Parameters :
     HANDLE handle : handle to check.
@@ -271,13 +424,13 @@ Return Value :
 bool CSimpleHandleManager::ValidateHandle(HANDLE handle)
 {
     DWORD dwIndex;
-    
-    if (NULL == m_rghteHandleTable)
+
+    if (0 == m_dwTableSize)
     {
         ASSERT("Handle Manager is not initialized!\n");
         return FALSE;
     }
-    
+
     if (handle == INVALID_HANDLE_VALUE || handle == 0)
     {
         TRACE( "INVALID_HANDLE_VALUE or NULL value is not a valid handle.\n" );
@@ -293,7 +446,7 @@ bool CSimpleHandleManager::ValidateHandle(HANDLE handle)
         // (since clients of the handle manager should have already dealt with
         // the specialness of the handle) so we assert here.
         //
-        
+
         ASSERT ("Handle %p is a special handle, returning FALSE.\n", handle);
         return FALSE;
     }
@@ -306,12 +459,6 @@ bool CSimpleHandleManager::ValidateHandle(HANDLE handle)
         return FALSE;
     }
 
-    if (!m_rghteHandleTable[dwIndex].fEntryAllocated)
-    {
-        WARN("The handle value (%p) has not been allocated\n", handle);
-        return FALSE;
-    }
-
     return TRUE;
 }
 
@@ -324,4 +471,3 @@ CorUnix::HandleIsSpecial(
             hPseudoCurrentThread == h ||
             hPseudoGlobalIOCP == h);
 }
-
@@ -79,6 +79,46 @@ namespace CorUnix
         LPOVERLAPPED lpOverlapped
         );
 
+    PAL_ERROR
+    InternalWriteFileAt(
+        CPalThread *pThread,
+        HANDLE hFile,
+        ULONG64 ullFileOffset,
+        LPCVOID lpBuffer,
+        DWORD nNumberOfBytesToWrite,
+        LPDWORD lpNumberOfBytesWritten
+        );
+
+    PAL_ERROR
+    InternalReadFileAt(
+        CPalThread *pThread,
+        HANDLE hFile,
+        ULONG64 ullFileOffset,
+        LPVOID lpBuffer,
+        DWORD nNumberOfBytesToRead,
+        LPDWORD lpNumberOfBytesRead
+        );
+
+    PAL_ERROR
+    InternalWriteFileVectorAt(
+        CPalThread *pThread,
+        HANDLE hFile,
+        ULONG64 ullFileOffset,
+        PAL_IOVEC *rgSegments,
+        DWORD dwSegmentCount,
+        LPDWORD lpNumberOfBytesWritten
+        );
+
+    PAL_ERROR
+    InternalReadFileVectorAt(
+        CPalThread *pThread,
+        HANDLE hFile,
+        ULONG64 ullFileOffset,
+        PAL_IOVEC *rgSegments,
+        DWORD dwSegmentCount,
+        LPDWORD lpNumberOfBytesRead
+        );
+
     PAL_ERROR
     InternalSetEndOfFile(
         CPalThread *pThread,
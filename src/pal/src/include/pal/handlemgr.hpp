@@ -35,15 +35,38 @@ extern const HANDLE hPseudoGlobalIOCP;
 
 namespace CorUnix
 {
+    //
+    // The handle table is organized as an array of fixed-size slabs that
+    // are allocated on demand and never moved or freed before shutdown,
+    // so lookups can index into it without any lock. Per-entry states
+    // changed with interlocked operations make handle lookup, allocation
+    // and release safe against each other; the critical section only
+    // serializes slab growth and callers of Lock()/Unlock().
+    //
     class CSimpleHandleManager
     {
     private:
-        enum { c_BasicGrowthRate = 1024 };
+        enum { c_SlabSize = 1024 };
+        enum { c_MaxSlabs = 1024 };
         enum { c_MaxIndex = 0x3FFFFFFE };
 
         typedef UINT_PTR HANDLE_INDEX;
         static const HANDLE_INDEX c_hiInvalid = (HANDLE_INDEX) -1;
 
+        //
+        // Entry life cycle: Free -> Allocated on AllocateHandle,
+        // Allocated -> Busy -> Allocated around a lookup (while the
+        // object reference is taken), Allocated -> Busy -> Free on
+        // FreeHandle. All transitions are interlocked; Busy is a
+        // short-lived claim that other threads spin on.
+        //
+        enum
+        {
+            c_lEntryFree      = 0,
+            c_lEntryAllocated = 1,
+            c_lEntryBusy      = 2
+        };
+
         HANDLE
         HandleIndexToHandle(HANDLE_INDEX hi)
         {
@@ -63,36 +86,52 @@ namespace CorUnix
                 IPalObject *pObject;
                 HANDLE_INDEX hiNextIndex;
             } u;
-            
+
             DWORD dwAccessRights;
             bool fInheritable;
-            
-            bool fEntryAllocated;
+
+            Volatile<LONG> lState;
         } HANDLE_TABLE_ENTRY;
 
-        HANDLE_INDEX m_hiFreeListStart;
-        HANDLE_INDEX m_hiFreeListEnd;
-        
-        DWORD m_dwTableSize;
-        DWORD m_dwTableGrowthRate;
-        HANDLE_TABLE_ENTRY* m_rghteHandleTable;
+        //
+        // Free entries form a lock-free LIFO threaded through
+        // u.hiNextIndex. The head packs the first free index into the
+        // low 32 bits (all-ones when the list is empty) and an ABA
+        // version tag into the high 32 bits.
+        //
+        Volatile<LONGLONG> m_llFreeListHead;
+
+        Volatile<DWORD> m_dwTableSize;
+        Volatile<HANDLE_TABLE_ENTRY*> m_rgSlabs[c_MaxSlabs];
 
         CRITICAL_SECTION m_csLock;
         bool m_fLockInitialized;
 
+        HANDLE_TABLE_ENTRY *
+        EntryFromIndex(HANDLE_INDEX hi)
+        {
+            return &m_rgSlabs[hi / c_SlabSize][hi % c_SlabSize];
+        };
+
+        void PushFreeIndex(HANDLE_INDEX hi);
+        HANDLE_INDEX PopFreeIndex();
+
+        PAL_ERROR GrowTable(void);
+
         bool ValidateHandle(HANDLE h);
 
     public:
 
         CSimpleHandleManager()
             :
-            m_hiFreeListStart(c_hiInvalid),
-            m_hiFreeListEnd(c_hiInvalid),
+            m_llFreeListHead((LONGLONG)(DWORD)-1),
             m_dwTableSize(0),
-            m_dwTableGrowthRate(c_BasicGrowthRate),
-            m_rghteHandleTable(NULL),
             m_fLockInitialized(FALSE)
         {
+            for (DWORD dw = 0; dw < c_MaxSlabs; dw += 1)
+            {
+                m_rgSlabs[dw] = NULL;
+            }
         };
 
         virtual
@@ -103,9 +142,12 @@ namespace CorUnix
                 DeleteCriticalSection(&m_csLock);
             }
 
-            if (NULL != m_rghteHandleTable)
+            for (DWORD dw = 0; dw < c_MaxSlabs; dw += 1)
             {
-                free(m_rghteHandleTable);
+                if (NULL != m_rgSlabs[dw])
+                {
+                    free(m_rgSlabs[dw]);
+                }
             }
         }
 
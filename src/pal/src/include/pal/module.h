@@ -29,6 +29,18 @@ typedef BOOL (PALAPI *PDLLMAIN)(HINSTANCE, DWORD, LPVOID);   /* entry point of m
 typedef HINSTANCE (PALAPI *PREGISTER_MODULE)(LPCSTR);           /* used to create the HINSTANCE for above DLLMain entry point */
 typedef VOID (PALAPI *PUNREGISTER_MODULE)(HINSTANCE);           /* used to cleanup the HINSTANCE for above DLLMain entry point */
 
+/* number of slots in a module's export address cache; resolutions beyond
+   this simply aren't cached */
+#define MODULE_PROC_CACHE_SIZE 32
+
+/* one resolved export: the name as passed to GetProcAddress and the
+   address dlsym returned for it */
+typedef struct _MODPROC_CACHE_ENTRY
+{
+    LPSTR name;
+    FARPROC address;
+} MODPROC_CACHE_ENTRY;
+
 typedef struct _MODSTRUCT
 {
     HMODULE self;           /* circular reference to this module */
@@ -49,6 +61,14 @@ typedef struct _MODSTRUCT
     /* reference to next and previous modules in list (in load order) */
     struct _MODSTRUCT *next;
     struct _MODSTRUCT *prev;
+
+    /* chain link for the dl_handle hash table */
+    struct _MODSTRUCT *hash_next;
+
+    /* lazily allocated export address cache (MODULE_PROC_CACHE_SIZE
+       entries), so repeated GetProcAddress calls for the same name skip
+       the dlsym round trip */
+    MODPROC_CACHE_ENTRY *proc_cache;
 } MODSTRUCT;
 
 
@@ -117,6 +117,50 @@ Notes :
 --*/
 BOOL SHMSetInfo(SHM_INFO_ID element, SHMPTR value);
 
+/*++
+SHMalloc
+
+Allocate a block of shared memory of the requested size. Blocks are served
+from per-size-class free lists where possible, so the typical allocation is
+a list pop instead of a heap call.
+
+Parameters :
+    size_t size : size of block required
+
+Return value :
+    SHMPTR for the newly allocated block, 0 on failure
+--*/
+SHMPTR SHMalloc(size_t size);
+
+/*++
+SHMfree
+
+Release a block of shared memory obtained from SHMalloc. Blocks small
+enough to belong to a size class are cached on that class's free list for
+reuse rather than returned to the heap.
+
+Parameters :
+    SHMPTR shmptr : block to release
+--*/
+void SHMfree(SHMPTR shmptr);
+
+/*++
+SHMPrime
+
+Populate the free list for the size class serving the given block size
+with the requested number of blocks, so that a subsequent burst of
+SHMalloc calls of that size is O(1) per allocation.
+
+Parameters :
+    size_t size : block size the caller intends to allocate
+    DWORD count : number of blocks to make available
+
+Return value :
+    TRUE if the free list was primed, FALSE otherwise (the size exceeds
+    the largest size class, or memory is exhausted)
+--*/
+BOOL SHMPrime(size_t size, DWORD count);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
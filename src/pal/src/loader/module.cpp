@@ -86,9 +86,15 @@ using namespace CorUnix;
 CRITICAL_SECTION module_critsec;
 
 /* always the first, in the in-load-order list */
-MODSTRUCT exe_module; 
+MODSTRUCT exe_module;
 MODSTRUCT *pal_module = nullptr;
 
+/* modules hashed by dl_handle, so the lookup performed on every load
+   doesn't walk the whole module list. Protected by module_critsec, like
+   the list itself. */
+#define MODULE_HANDLE_HASH_SIZE 64
+static MODSTRUCT *module_handle_hash[MODULE_HANDLE_HASH_SIZE];
+
 char *g_szPalLibraryPath = nullptr;
 
 int MaxWCharToAcpLength = 3;
@@ -108,6 +114,11 @@ static BOOL LOADFreeLibrary(MODSTRUCT *module, BOOL fCallDllMain);
 static HMODULE LOADRegisterLibraryDirect(void *dl_handle, LPCSTR libraryNameOrPath, BOOL fDynamic);
 static HMODULE LOADLoadLibrary(LPCSTR shortAsciiName, BOOL fDynamic);
 static BOOL LOADCallDllMainSafe(MODSTRUCT *module, DWORD dwReason, LPVOID lpReserved);
+static void LOADHashInsertModule(MODSTRUCT *module);
+static void LOADHashRemoveModule(MODSTRUCT *module);
+static MODSTRUCT *LOADHashFindModule(void *dl_handle);
+static FARPROC LOADLookupCachedProc(MODSTRUCT *module, LPCSTR lpProcName);
+static void LOADCacheProc(MODSTRUCT *module, LPCSTR lpProcName, FARPROC address);
 
 /* API function definitions ***************************************************/
 
@@ -305,8 +316,18 @@ GetProcAddress(
         goto done;
     }
 
+    /* a previous resolution of the same name satisfies the call without
+       another dlsym round trip */
+    ProcAddress = LOADLookupCachedProc(module, lpProcName);
+    if (ProcAddress != nullptr)
+    {
+        TRACE("Symbol %s found in proc cache at address %p in module %p (named %S)\n",
+              lpProcName, ProcAddress, module, MODNAME(module));
+        goto done;
+    }
+
     // Get the symbol's address.
-    
+
     // If we're looking for a symbol inside the PAL, we try the PAL_ variant
     // first because otherwise we run the risk of having the non-PAL_
     // variant preferred over the PAL's implementation.
@@ -345,6 +366,11 @@ GetProcAddress(
         TRACE("Symbol %s found at address %p in module %p (named %S)\n",
               lpProcName, ProcAddress, module, MODNAME(module));
 
+        /* remember the resolution for subsequent calls; the PAL_ variant
+           preference above is deterministic per module, so caching the
+           final address under the caller's name is safe */
+        LOADCacheProc(module, lpProcName, ProcAddress);
+
         /* if we don't know the module's full name yet, this is our chance to obtain it */
         if (!module->lib_name && module->dl_handle)
         {
@@ -809,7 +835,10 @@ BOOL LOADInitializeModules()
     exe_module.pDllMain = nullptr;
     exe_module.hinstance = nullptr;
     exe_module.threadLibCalls = TRUE;
- 
+    exe_module.hash_next = nullptr;
+    exe_module.proc_cache = nullptr;
+    LOADHashInsertModule(&exe_module);
+
     // Initialize g_szPalLibraryPath
     MODSTRUCT *module = LOADGetPalLibrary();
     if (!module)
@@ -1005,9 +1034,10 @@ static BOOL LOADFreeLibrary(MODSTRUCT *module, BOOL fCallDllMain)
     TRACE("Reference count for module %p (named %S) now 0; destroying module structure\n", 
         module, MODNAME(module));
 
-    /* unlink the module structure from the list */
+    /* unlink the module structure from the list and the handle hash */
     module->prev->next = module->next;
     module->next->prev = module->prev;
+    LOADHashRemoveModule(module);
 
     /* remove the circular reference so that LOADValidateModule will fail */
     module->self = nullptr;
@@ -1035,6 +1065,14 @@ static BOOL LOADFreeLibrary(MODSTRUCT *module, BOOL fCallDllMain)
     }
 
     /* release all memory */
+    if (module->proc_cache)
+    {
+        for (size_t i = 0; i < MODULE_PROC_CACHE_SIZE; i++)
+        {
+            free(module->proc_cache[i].name);
+        }
+        free(module->proc_cache);
+    }
     free(module->lib_name);
     free(module);
 
@@ -1288,6 +1326,201 @@ static void *LOADLoadLibraryDirect(LPCSTR libraryNameOrPath)
     return dl_handle;
 }
 
+/*++
+Function :
+    LOADHashInsertModule
+
+    Add a module to the dl_handle hash table. The caller must hold the
+    module list lock.
+
+Parameters :
+    MODSTRUCT *module : module to insert; dl_handle must be set
+
+(no return value)
+--*/
+static void LOADHashInsertModule(MODSTRUCT *module)
+{
+    size_t bucket = (((size_t)module->dl_handle) >> 4) % MODULE_HANDLE_HASH_SIZE;
+
+    module->hash_next = module_handle_hash[bucket];
+    module_handle_hash[bucket] = module;
+}
+
+/*++
+Function :
+    LOADHashRemoveModule
+
+    Remove a module from the dl_handle hash table. The caller must hold
+    the module list lock.
+
+Parameters :
+    MODSTRUCT *module : module to remove
+
+(no return value)
+--*/
+static void LOADHashRemoveModule(MODSTRUCT *module)
+{
+    size_t bucket = (((size_t)module->dl_handle) >> 4) % MODULE_HANDLE_HASH_SIZE;
+    MODSTRUCT **link = &module_handle_hash[bucket];
+
+    while (*link != nullptr)
+    {
+        if (*link == module)
+        {
+            *link = module->hash_next;
+            module->hash_next = nullptr;
+            return;
+        }
+        link = &(*link)->hash_next;
+    }
+
+    ASSERT("Module %p not found in the handle hash table!\n", module);
+}
+
+/*++
+Function :
+    LOADHashFindModule
+
+    Look up a module by its dl_handle. The caller must hold the module
+    list lock.
+
+Parameters :
+    void *dl_handle : handle returned by dlopen
+
+Return value :
+    the matching module, or nullptr if the handle is unknown
+--*/
+static MODSTRUCT *LOADHashFindModule(void *dl_handle)
+{
+    size_t bucket = (((size_t)dl_handle) >> 4) % MODULE_HANDLE_HASH_SIZE;
+    MODSTRUCT *module = module_handle_hash[bucket];
+
+    while (module != nullptr && module->dl_handle != dl_handle)
+    {
+        module = module->hash_next;
+    }
+
+    return module;
+}
+
+/*++
+Function :
+    LOADLookupCachedProc
+
+    Look up a previously resolved export in the module's proc cache. The
+    caller must hold the module list lock.
+
+Parameters :
+    MODSTRUCT *module : module to search
+    LPCSTR lpProcName : export name as passed to GetProcAddress
+
+Return value :
+    the cached address, or nullptr on a cache miss
+--*/
+static FARPROC LOADLookupCachedProc(MODSTRUCT *module, LPCSTR lpProcName)
+{
+    size_t hash = 0;
+    const char *p;
+
+    if (nullptr == module->proc_cache)
+    {
+        return nullptr;
+    }
+
+    for (p = lpProcName; *p != '\0'; p++)
+    {
+        hash = hash * 31 + (unsigned char)*p;
+    }
+
+    for (size_t i = 0; i < MODULE_PROC_CACHE_SIZE; i++)
+    {
+        MODPROC_CACHE_ENTRY *entry =
+            &module->proc_cache[(hash + i) % MODULE_PROC_CACHE_SIZE];
+
+        if (nullptr == entry->name)
+        {
+            return nullptr;
+        }
+
+        if (0 == strcmp(entry->name, lpProcName))
+        {
+            return entry->address;
+        }
+    }
+
+    return nullptr;
+}
+
+/*++
+Function :
+    LOADCacheProc
+
+    Record a resolved export in the module's proc cache, allocating the
+    cache on first use. A full cache (or allocation failure) simply means
+    the resolution isn't cached; correctness doesn't depend on it. The
+    caller must hold the module list lock.
+
+Parameters :
+    MODSTRUCT *module : module the export was resolved against
+    LPCSTR lpProcName : export name as passed to GetProcAddress
+    FARPROC address : address dlsym returned
+
+(no return value)
+--*/
+static void LOADCacheProc(MODSTRUCT *module, LPCSTR lpProcName, FARPROC address)
+{
+    size_t hash = 0;
+    const char *p;
+
+    if (nullptr == module->proc_cache)
+    {
+        module->proc_cache = (MODPROC_CACHE_ENTRY *)InternalMalloc(
+            MODULE_PROC_CACHE_SIZE * sizeof(MODPROC_CACHE_ENTRY));
+        if (nullptr == module->proc_cache)
+        {
+            WARN("Unable to allocate proc cache for module %p\n", module);
+            return;
+        }
+        memset(module->proc_cache, 0,
+            MODULE_PROC_CACHE_SIZE * sizeof(MODPROC_CACHE_ENTRY));
+    }
+
+    for (p = lpProcName; *p != '\0'; p++)
+    {
+        hash = hash * 31 + (unsigned char)*p;
+    }
+
+    for (size_t i = 0; i < MODULE_PROC_CACHE_SIZE; i++)
+    {
+        MODPROC_CACHE_ENTRY *entry =
+            &module->proc_cache[(hash + i) % MODULE_PROC_CACHE_SIZE];
+
+        if (nullptr != entry->name)
+        {
+            /* already present (raced lookup) or occupied; probe on */
+            if (0 == strcmp(entry->name, lpProcName))
+            {
+                return;
+            }
+            continue;
+        }
+
+        size_t length = strlen(lpProcName) + 1;
+        entry->name = (LPSTR)InternalMalloc(length);
+        if (nullptr == entry->name)
+        {
+            WARN("Unable to allocate proc cache entry for %s\n", lpProcName);
+            return;
+        }
+        memcpy(entry->name, lpProcName, length);
+        entry->address = address;
+        return;
+    }
+
+    TRACE("Proc cache for module %p is full; not caching %s\n",
+          module, lpProcName);
+}
+
 /*++
 Function :
     LOADAllocModule
@@ -1347,6 +1580,8 @@ static MODSTRUCT *LOADAllocModule(void *dl_handle, LPCSTR name)
     module->pDllMain = nullptr;
     module->next = nullptr;
     module->prev = nullptr;
+    module->hash_next = nullptr;
+    module->proc_cache = nullptr;
 
     module->lib_name = wide_name;
 
@@ -1373,26 +1608,23 @@ static MODSTRUCT *LOADAddModule(void *dl_handle, LPCSTR libraryNameOrPath)
     _ASSERTE(libraryNameOrPath[0] != '\0');
 
 #if !RETURNS_NEW_HANDLES_ON_REPEAT_DLOPEN
-    /* search module list for a match. */
-    MODSTRUCT *module = &exe_module;
-    do
+    /* search the handle hash table for a match. */
+    MODSTRUCT *module = LOADHashFindModule(dl_handle);
+    if (module != nullptr)
     {
-        if (dl_handle == module->dl_handle)
-        {   
-            /* found the handle. increment the refcount and return the 
-               existing module structure */
-            TRACE("Found matching module %p for module name %s\n", module, libraryNameOrPath);
+        /* found the handle. increment the refcount and return the
+           existing module structure */
+        TRACE("Found matching module %p for module name %s\n", module, libraryNameOrPath);
 
-            if (module->refcount != -1)
-            {
-                module->refcount++;
-            }
-            dlclose(dl_handle);
-            return module;
+        if (module->refcount != -1)
+        {
+            module->refcount++;
         }
-        module = module->next;
-
-    } while (module != &exe_module);
+        dlclose(dl_handle);
+        return module;
+    }
+#else
+    MODSTRUCT *module;
 #endif
 
     TRACE("Module doesn't exist : creating %s.\n", libraryNameOrPath);
@@ -1415,6 +1647,8 @@ static MODSTRUCT *LOADAddModule(void *dl_handle, LPCSTR libraryNameOrPath)
     exe_module.prev->next = module;
     exe_module.prev = module;
 
+    LOADHashInsertModule(module);
+
 #if RETURNS_NEW_HANDLES_ON_REPEAT_DLOPEN
     module->inode = stat_buf.st_ino; 
     module->device = stat_buf.st_dev;
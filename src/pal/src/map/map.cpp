@@ -1050,6 +1050,130 @@ UnmapViewOfFile(
     return (NO_ERROR == palError);
 }
 
+/*++
+Function:
+  PAL_AdviseMappedRange
+
+  Tells the kernel how a mapped range is going to be accessed, so it can
+  adjust its readahead. The hint applies to whole pages; the range is
+  expanded outward to page boundaries.
+
+Parameters
+  lpAddress : start of the mapped range
+  cbSize : size of the range in bytes
+  dwHint : one of the PAL_MAP_HINT_* values
+
+Return
+  TRUE if the advice was accepted, FALSE otherwise.
+--*/
+BOOL
+PALAPI
+PAL_AdviseMappedRange(
+    IN LPVOID lpAddress,
+    IN SIZE_T cbSize,
+    IN DWORD dwHint)
+{
+    int advice;
+    BOOL result = FALSE;
+
+    PERF_ENTRY(PAL_AdviseMappedRange);
+    ENTRY("PAL_AdviseMappedRange(lpAddress=%p, cbSize=%u, dwHint=%u)\n",
+          lpAddress, cbSize, dwHint);
+
+    switch (dwHint)
+    {
+    case PAL_MAP_HINT_NORMAL:
+        advice = MADV_NORMAL;
+        break;
+    case PAL_MAP_HINT_SEQUENTIAL:
+        advice = MADV_SEQUENTIAL;
+        break;
+    case PAL_MAP_HINT_RANDOM:
+        advice = MADV_RANDOM;
+        break;
+    case PAL_MAP_HINT_WILLNEED:
+        advice = MADV_WILLNEED;
+        break;
+    default:
+        ERROR("Invalid mapping hint %u\n", dwHint);
+        goto PAL_AdviseMappedRangeExit;
+    }
+
+    if (cbSize != 0)
+    {
+        UINT_PTR start = ALIGN_DOWN((UINT_PTR)lpAddress, GetVirtualPageSize());
+        UINT_PTR end = ALIGN_UP((UINT_PTR)lpAddress + cbSize, GetVirtualPageSize());
+
+        if (-1 == madvise((LPVOID)start, end - start, advice))
+        {
+            WARN("madvise failed: errno is %d (%s)\n", errno, strerror(errno));
+            goto PAL_AdviseMappedRangeExit;
+        }
+    }
+
+    result = TRUE;
+
+PAL_AdviseMappedRangeExit:
+    LOGEXIT("PAL_AdviseMappedRange returning %s.\n", result ? "TRUE" : "FALSE");
+    PERF_EXIT(PAL_AdviseMappedRange);
+    return result;
+}
+
+/*++
+Function:
+  PAL_ProbeMappedRange
+
+  Pre-faults a mapped range that the caller knows it is about to touch, so
+  the pages arrive with a few large bulk reads instead of one fault per
+  access cluster. Faults the pages in synchronously after asking the kernel
+  to start populating them.
+
+Parameters
+  lpAddress : start of the mapped range
+  cbSize : size of the range in bytes
+
+Return
+  TRUE if the range was probed, FALSE otherwise.
+--*/
+BOOL
+PALAPI
+PAL_ProbeMappedRange(
+    IN LPVOID lpAddress,
+    IN SIZE_T cbSize)
+{
+    BOOL result = TRUE;
+
+    PERF_ENTRY(PAL_ProbeMappedRange);
+    ENTRY("PAL_ProbeMappedRange(lpAddress=%p, cbSize=%u)\n", lpAddress, cbSize);
+
+    if (cbSize != 0)
+    {
+        UINT_PTR start = ALIGN_DOWN((UINT_PTR)lpAddress, GetVirtualPageSize());
+        UINT_PTR end = ALIGN_UP((UINT_PTR)lpAddress + cbSize, GetVirtualPageSize());
+
+        // Ask the kernel to begin populating the whole range...
+        if (-1 == madvise((LPVOID)start, end - start, MADV_WILLNEED))
+        {
+            WARN("madvise failed: errno is %d (%s)\n", errno, strerror(errno));
+            result = FALSE;
+        }
+        else
+        {
+            // ...then touch one byte per page so the caller's own accesses
+            // don't fault. The reads overlap with the populate the kernel
+            // already has in flight.
+            for (UINT_PTR page = start; page < end; page += GetVirtualPageSize())
+            {
+                *(volatile BYTE *)page;
+            }
+        }
+    }
+
+    LOGEXIT("PAL_ProbeMappedRange returning %s.\n", result ? "TRUE" : "FALSE");
+    PERF_EXIT(PAL_ProbeMappedRange);
+    return result;
+}
+
 PAL_ERROR
 CorUnix::InternalMapViewOfFile(
     CPalThread *pThread,
@@ -1071,6 +1195,12 @@ CorUnix::InternalMapViewOfFile(
 #endif
     LPVOID pvBaseAddress = NULL;
 
+    /* FILE_MAP_POPULATE is a PAL-only hint that the caller will touch the
+       whole view soon, so the pages should be prefaulted up front. Strip it
+       before the access checks; it is not an access right. */
+    BOOL fPopulate = (dwDesiredAccess & FILE_MAP_POPULATE) != 0;
+    dwDesiredAccess &= ~FILE_MAP_POPULATE;
+
     /* Sanity checks */
     if ( MAPContainsInvalidFlags( dwDesiredAccess ) )
     {
@@ -1154,6 +1284,12 @@ CorUnix::InternalMapViewOfFile(
         {
             flags |= MAP_ANON;
         }
+#endif
+#ifdef MAP_POPULATE
+        if (fPopulate)
+        {
+            flags |= MAP_POPULATE;
+        }
 #endif
         pvBaseAddress = mmap(
             NULL,
@@ -1177,6 +1313,12 @@ CorUnix::InternalMapViewOfFile(
                 flags |= MAP_ANON;
             }
 #endif
+#ifdef MAP_POPULATE
+            if (fPopulate)
+            {
+                flags |= MAP_POPULATE;
+            }
+#endif
 
             pvBaseAddress = mmap(
                 NULL,
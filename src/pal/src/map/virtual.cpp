@@ -76,6 +76,35 @@ static LPVOID ReserveVirtualMemory(
 // of virtual memory that is located near the CoreCLR library.
 static ExecutableMemoryAllocator g_executableMemoryAllocator;
 
+//
+//
+// Reservation cache
+//
+// The hosted runtime reserves and releases many identically sized regions,
+// especially at startup. Released reservations are parked here, per exact
+// size and already in the reserved PROT_NONE state, so a later reservation
+// of the same size is satisfied without an mmap syscall. The cache is
+// bounded, and is flushed in one batch when a reservation fails or at
+// shutdown.
+//
+//
+struct VIRTUAL_RESERVE_CACHE_ENTRY
+{
+    UINT_PTR startBoundary;
+    SIZE_T   memSize;
+};
+
+static const int VIRTUAL_RESERVE_CACHE_SLOTS = 16;
+static const SIZE_T VIRTUAL_RESERVE_CACHE_MAX_REGION = 4 * 1024 * 1024;
+static const SIZE_T VIRTUAL_RESERVE_CACHE_MAX_TOTAL = 32 * 1024 * 1024;
+
+static VIRTUAL_RESERVE_CACHE_ENTRY virtual_reserveCache[VIRTUAL_RESERVE_CACHE_SLOTS];
+static SIZE_T virtual_reserveCacheBytes = 0;
+
+static LPVOID VIRTUALGetCachedReservation( IN CPalThread *pthrCurrent, IN SIZE_T memSize );
+static BOOL VIRTUALCacheReleasedReservation( IN CPalThread *pthrCurrent, IN UINT_PTR startBoundary, IN SIZE_T memSize );
+static int VIRTUALFlushReservationCache( IN CPalThread *pthrCurrent );
+
 //
 //
 // Virtual Memory Logging
@@ -209,6 +238,9 @@ void VIRTUALCleanup()
     }
     pVirtualMemory = NULL;
 
+    // Hand any cached reservations back to the OS.
+    VIRTUALFlushReservationCache(pthrCurrent);
+
     InternalLeaveCriticalSection(pthrCurrent, &virtual_critsec);
 
     TRACE( "Deleting the Virtual Critical Sections. \n" );
@@ -865,6 +897,126 @@ static LPVOID VIRTUALResetMemory(
     return pRetVal;
 }
 
+/***
+ *
+ *  VIRTUALGetCachedReservation() - Returns a cached reservation of exactly
+ *      memSize bytes, or NULL. The region is already mapped PROT_NONE.
+ */
+static LPVOID VIRTUALGetCachedReservation( IN CPalThread *pthrCurrent, IN SIZE_T memSize )
+{
+    LPVOID pRetVal = NULL;
+
+    InternalEnterCriticalSection(pthrCurrent, &virtual_critsec);
+
+    for ( int i = 0; i < VIRTUAL_RESERVE_CACHE_SLOTS; i++ )
+    {
+        if ( virtual_reserveCache[i].startBoundary != 0 &&
+             virtual_reserveCache[i].memSize == memSize )
+        {
+            pRetVal = (LPVOID)virtual_reserveCache[i].startBoundary;
+            virtual_reserveCache[i].startBoundary = 0;
+            virtual_reserveCacheBytes -= memSize;
+            break;
+        }
+    }
+
+    InternalLeaveCriticalSection(pthrCurrent, &virtual_critsec);
+
+    if ( pRetVal != NULL )
+    {
+        TRACE( "Satisfied a %d byte reservation from the cache.\n", memSize );
+    }
+
+    return pRetVal;
+}
+
+/***
+ *
+ *  VIRTUALCacheReleasedReservation() - Parks a released region in the cache
+ *      instead of unmapping it. Returns TRUE if the region was cached; on
+ *      FALSE the caller must munmap it as before.
+ */
+static BOOL VIRTUALCacheReleasedReservation(
+                IN CPalThread *pthrCurrent,
+                IN UINT_PTR startBoundary,
+                IN SIZE_T memSize )
+{
+    BOOL bRetVal = FALSE;
+    int slot = -1;
+
+    if ( memSize > VIRTUAL_RESERVE_CACHE_MAX_REGION )
+    {
+        return FALSE;
+    }
+
+    InternalEnterCriticalSection(pthrCurrent, &virtual_critsec);
+
+    if ( virtual_reserveCacheBytes + memSize <= VIRTUAL_RESERVE_CACHE_MAX_TOTAL )
+    {
+        for ( int i = 0; i < VIRTUAL_RESERVE_CACHE_SLOTS; i++ )
+        {
+            if ( virtual_reserveCache[i].startBoundary == 0 )
+            {
+                slot = i;
+                break;
+            }
+        }
+    }
+
+    if ( slot != -1 )
+    {
+        /* Drop the region's pages and return it to the reserved state; a
+           fresh PROT_NONE mapping over the range does both in one call. */
+        if ( mmap( (LPVOID)startBoundary, memSize, PROT_NONE,
+                   MAP_FIXED | MAP_ANON | MAP_PRIVATE, -1, 0 ) != MAP_FAILED )
+        {
+#if MMAP_ANON_IGNORES_PROTECTION
+            if ( mprotect( (LPVOID)startBoundary, memSize, PROT_NONE ) != 0 )
+            {
+                InternalLeaveCriticalSection(pthrCurrent, &virtual_critsec);
+                return FALSE;
+            }
+#endif  // MMAP_ANON_IGNORES_PROTECTION
+            virtual_reserveCache[slot].startBoundary = startBoundary;
+            virtual_reserveCache[slot].memSize = memSize;
+            virtual_reserveCacheBytes += memSize;
+            bRetVal = TRUE;
+        }
+    }
+
+    InternalLeaveCriticalSection(pthrCurrent, &virtual_critsec);
+
+    return bRetVal;
+}
+
+/***
+ *
+ *  VIRTUALFlushReservationCache() - Unmaps every cached reservation in one
+ *      batch. Returns the number of regions handed back to the OS.
+ */
+static int VIRTUALFlushReservationCache( IN CPalThread *pthrCurrent )
+{
+    int released = 0;
+
+    InternalEnterCriticalSection(pthrCurrent, &virtual_critsec);
+
+    for ( int i = 0; i < VIRTUAL_RESERVE_CACHE_SLOTS; i++ )
+    {
+        if ( virtual_reserveCache[i].startBoundary != 0 )
+        {
+            munmap( (LPVOID)virtual_reserveCache[i].startBoundary,
+                    virtual_reserveCache[i].memSize );
+            virtual_reserveCache[i].startBoundary = 0;
+            released++;
+        }
+    }
+    virtual_reserveCacheBytes = 0;
+
+    InternalLeaveCriticalSection(pthrCurrent, &virtual_critsec);
+
+    return released;
+}
+
 /******
  *
  *  VIRTUALReserveMemory() - Helper function that actually reserves the memory.
@@ -911,10 +1063,24 @@ static LPVOID VIRTUALReserveMemory(
         }
     }
 
+    if (pRetVal == NULL && lpAddress == NULL)
+    {
+        // A released reservation of the same size can satisfy the request
+        // without going back to the OS.
+        pRetVal = VIRTUALGetCachedReservation(pthrCurrent, MemSize);
+    }
+
     if (pRetVal == NULL)
     {
         // Try to reserve memory from the OS
         pRetVal = ReserveVirtualMemory(pthrCurrent, (LPVOID)StartBoundary, MemSize);
+
+        if (pRetVal == NULL && VIRTUALFlushReservationCache(pthrCurrent) > 0)
+        {
+            // The cache was holding address space; it has been handed back
+            // in one batch, so try once more.
+            pRetVal = ReserveVirtualMemory(pthrCurrent, (LPVOID)StartBoundary, MemSize);
+        }
     }
 
     if (pRetVal != NULL)
@@ -1170,6 +1336,21 @@ VIRTUALCommitMemory(
 
             VIRTUALSetAllocState(MEM_COMMIT, runStart, runLength, pInformation);
 
+#ifdef MADV_HUGEPAGE
+            if ((flAllocationType & MEM_LARGE_PAGES) != 0)
+            {
+                // The caller asked for large pages. Commit is an mprotect over
+                // an existing reservation here, so ask the kernel to back the
+                // run with transparent huge pages instead of remapping it.
+                // This is purely advisory; the commit stands either way.
+                if (madvise((void *) StartBoundary, MemSize, MADV_HUGEPAGE) != 0)
+                {
+                    TRACE("madvise(MADV_HUGEPAGE) failed! Error(%d)=%s\n",
+                          errno, strerror(errno));
+                }
+            }
+#endif  // MADV_HUGEPAGE
+
             if (nProtect == (PROT_WRITE | PROT_READ))
             {
                 // Handle this case specially so we don't bother
@@ -1242,6 +1423,8 @@ Function:
 Note:
   MEM_TOP_DOWN, MEM_PHYSICAL, MEM_WRITE_WATCH are not supported.
   Unsupported flags are ignored.
+  MEM_LARGE_PAGES is advisory: committed pages are madvise'd for huge
+  pages where the kernel supports it, and fall back to base pages.
   
   Page size on i386 is set to 4k.
 
@@ -1271,10 +1454,10 @@ VirtualAlloc(
     }
 
     /* Test for un-supported flags. */
-    if ( ( flAllocationType & ~( MEM_COMMIT | MEM_RESERVE | MEM_RESET | MEM_TOP_DOWN | MEM_RESERVE_EXECUTABLE ) ) != 0 )
+    if ( ( flAllocationType & ~( MEM_COMMIT | MEM_RESERVE | MEM_RESET | MEM_TOP_DOWN | MEM_RESERVE_EXECUTABLE | MEM_LARGE_PAGES ) ) != 0 )
     {
         ASSERT( "flAllocationType can be one, or any combination of MEM_COMMIT, \
-               MEM_RESERVE, MEM_TOP_DOWN, or MEM_RESERVE_EXECUTABLE.\n" );
+               MEM_RESERVE, MEM_TOP_DOWN, MEM_RESERVE_EXECUTABLE, or MEM_LARGE_PAGES.\n" );
         pthrCurrent->SetLastError( ERROR_INVALID_PARAMETER );
         goto done;
     }
@@ -1503,7 +1686,10 @@ VirtualFree(
         TRACE( "Releasing the following memory %d to %d.\n", 
                pMemoryToBeReleased->startBoundary, pMemoryToBeReleased->memSize );
 
-        if ( munmap( (LPVOID)pMemoryToBeReleased->startBoundary, 
+        if ( VIRTUALCacheReleasedReservation( pthrCurrent,
+                                              pMemoryToBeReleased->startBoundary,
+                                              pMemoryToBeReleased->memSize ) ||
+             munmap( (LPVOID)pMemoryToBeReleased->startBoundary,
                      pMemoryToBeReleased->memSize ) == 0 )
         {
             if ( VIRTUALReleaseMemory( pMemoryToBeReleased ) == FALSE )
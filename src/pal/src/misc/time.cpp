@@ -34,6 +34,10 @@ Abstract:
 static mach_timebase_info_data_t s_TimebaseInfo;
 #endif
 
+/* performance counter frequency, computed once during TIMEInitialize so
+   QueryPerformanceFrequency doesn't redo the conversion on every call */
+static LONGLONG s_lPerformanceFrequency = 0;
+
 using namespace CorUnix;
 
 SET_DEFAULT_DEBUG_CHANNEL(MISC);
@@ -59,7 +63,12 @@ BOOL TIMEInitialize(void)
         ASSERT("mach_timebase_info() failed: %s\n", mach_error_string(machRet));
         return FALSE;
     }
-#endif
+    s_lPerformanceFrequency = (LONGLONG)tccSecondsToNanoSeconds * ((LONGLONG)s_TimebaseInfo.denom / (LONGLONG)s_TimebaseInfo.numer);
+#elif HAVE_GETHRTIME || HAVE_READ_REAL_TIME || HAVE_CLOCK_MONOTONIC
+    s_lPerformanceFrequency = (LONGLONG)tccSecondsToNanoSeconds;
+#else
+    s_lPerformanceFrequency = (LONGLONG)tccSecondsToMicroSeconds;
+#endif // HAVE_MACH_ABSOLUTE_TIME
 
     return TRUE;
 }
@@ -265,27 +274,69 @@ QueryPerformanceFrequency(
     BOOL retval = TRUE;
     PERF_ENTRY(QueryPerformanceFrequency);
     ENTRY("QueryPerformanceFrequency()\n");
-#if HAVE_MACH_ABSOLUTE_TIME
-    // use denom == 0 to indicate that s_TimebaseInfo is uninitialised.
-    if (s_TimebaseInfo.denom == 0)
+
+    // the frequency is computed once during TIMEInitialize; a zero value
+    // indicates initialization hasn't happened yet.
+    if (0 == s_lPerformanceFrequency)
     {
-        ASSERT("s_TimebaseInfo is uninitialized.\n");
+        ASSERT("s_lPerformanceFrequency is uninitialized.\n");
         retval = FALSE;
     }
     else
     {
-        lpFrequency->QuadPart = (LONGLONG)tccSecondsToNanoSeconds * ((LONGLONG)s_TimebaseInfo.denom / (LONGLONG)s_TimebaseInfo.numer);
+        lpFrequency->QuadPart = s_lPerformanceFrequency;
     }
-#elif HAVE_GETHRTIME || HAVE_READ_REAL_TIME || HAVE_CLOCK_MONOTONIC
-    lpFrequency->QuadPart = (LONGLONG)tccSecondsToNanoSeconds;
-#else
-    lpFrequency->QuadPart = (LONGLONG)tccSecondsToMicroSeconds;
-#endif // HAVE_MACH_ABSOLUTE_TIME
+
     LOGEXIT("QueryPerformanceFrequency\n");
     PERF_EXIT(QueryPerformanceFrequency);
     return retval;
 }
 
+/*++
+Function:
+  PAL_QueryPerformanceCounterCoarse
+
+Like QueryPerformanceCounter, but reads the kernel's coarse monotonic
+clock where one exists. The result has tick resolution (a few
+milliseconds) but the query is serviced from the vDSO without entering
+the kernel, which matters for callers timestamping in tight loops. The
+counts use the same units as QueryPerformanceCounter, so the
+QueryPerformanceFrequency result applies to both.
+--*/
+BOOL
+PALAPI
+PAL_QueryPerformanceCounterCoarse(
+    OUT LARGE_INTEGER *lpPerformanceCount
+    )
+{
+#if HAVE_CLOCK_MONOTONIC_COARSE
+    BOOL retval = TRUE;
+
+    PERF_ENTRY(PAL_QueryPerformanceCounterCoarse);
+    ENTRY("PAL_QueryPerformanceCounterCoarse()\n");
+
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC_COARSE, &ts) != 0)
+    {
+        ASSERT("clock_gettime(CLOCK_MONOTONIC_COARSE) failed; errno is %d (%s)\n", errno, strerror(errno));
+        retval = FALSE;
+    }
+    else
+    {
+        lpPerformanceCount->QuadPart =
+            (LONGLONG)ts.tv_sec * (LONGLONG)tccSecondsToNanoSeconds + (LONGLONG)ts.tv_nsec;
+    }
+
+    LOGEXIT("PAL_QueryPerformanceCounterCoarse\n");
+    PERF_EXIT(PAL_QueryPerformanceCounterCoarse);
+    return retval;
+#else
+    // no coarse clock on this platform; the precise counter is the
+    // cheapest source available
+    return QueryPerformanceCounter(lpPerformanceCount);
+#endif // HAVE_CLOCK_MONOTONIC_COARSE
+}
+
 /*++
 Function:
   GetTickCount64
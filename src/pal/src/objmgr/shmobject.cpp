@@ -328,7 +328,7 @@ CSharedMemoryObject::AllocateSharedDataItems(
 
     SHMLock();
 
-    shmod = malloc(sizeof(SHMObjData));
+    shmod = SHMalloc(sizeof(SHMObjData));
     if (NULL == shmod)
     {
         ERROR("Unable to allocate m_shmod for new object\n");
@@ -352,7 +352,7 @@ CSharedMemoryObject::AllocateSharedDataItems(
         psmod->dwNameLength = m_oa.sObjectName.GetStringLength();
 
         UINT length = (PAL_wcslen(str) + 1) * sizeof(WCHAR);
-        psmod->shmObjName = malloc(length);
+        psmod->shmObjName = SHMalloc(length);
 
         if (psmod->shmObjName != 0)
         {
@@ -373,7 +373,7 @@ CSharedMemoryObject::AllocateSharedDataItems(
         // by CSharedMemoryObjectManager::RegisterObject or PromoteSharedData
         //
         
-        psmod->shmObjImmutableData = malloc(m_pot->GetImmutableDataSize());
+        psmod->shmObjImmutableData = SHMalloc(m_pot->GetImmutableDataSize());
         if (NULL == psmod->shmObjImmutableData)
         {
             ERROR("Unable to allocate psmod->shmObjImmutableData for new object\n");
@@ -384,7 +384,7 @@ CSharedMemoryObject::AllocateSharedDataItems(
 
     if (0 != m_pot->GetSharedDataSize())
     {
-        psmod->shmObjSharedData = malloc(m_pot->GetSharedDataSize());
+        psmod->shmObjSharedData = SHMalloc(m_pot->GetSharedDataSize());
         if (NULL == psmod->shmObjSharedData)
         {
             ERROR("Unable to allocate psmod->shmObjSharedData for new object\n");
@@ -447,20 +447,20 @@ CSharedMemoryObject::FreeSharedDataAreas(
         {
             (*psmod->pCleanupRoutine)(psmod->shmObjImmutableData);
         }
-        free(psmod->shmObjImmutableData);
+        SHMfree(psmod->shmObjImmutableData);
     }
 
     if (NULL != psmod->shmObjSharedData)
     {
-        free(psmod->shmObjSharedData);
+        SHMfree(psmod->shmObjSharedData);
     }
 
     if (NULL != psmod->shmObjName)
     {
-        free(psmod->shmObjName);
+        SHMfree(psmod->shmObjName);
     }
     
-    free(shmObjData);
+    SHMfree(shmObjData);
 
     SHMRelease();
 
@@ -62,11 +62,24 @@ CSharedMemoryObjectManager::Initialize(
     InitializeListHead(&m_leNamedObjects);
     InitializeListHead(&m_leAnonymousObjects);
 
-    InternalInitializeCriticalSection(&m_csListLock);
-    m_fListLockInitialized = TRUE;
+    InternalInitializeCriticalSection(&m_csNamedListLock);
+    InternalInitializeCriticalSection(&m_csAnonymousListLock);
+    m_fListLocksInitialized = TRUE;
 
     palError = m_HandleManager.Initialize();
 
+    if (NO_ERROR == palError)
+    {
+        //
+        // Warm the shared memory block cache for the object descriptors;
+        // every shared object allocates one, so startup bursts (process
+        // attach creating its initial objects) shouldn't hit the heap
+        // for each. Failure is not fatal -- SHMalloc falls back to the
+        // heap on an empty free list.
+        //
+        (void) SHMPrime(sizeof(SHMObjData), 32);
+    }
+
     LOGEXIT("CSharedMemoryObjectManager::Initialize returns %d", palError);
     
     return palError;
@@ -99,8 +112,14 @@ CSharedMemoryObjectManager::Shutdown(
         pthr
         );
 
-    InternalEnterCriticalSection(pthr, &m_csListLock);
-    SHMLock();
+    //
+    // Anonymous objects never own shared memory structures, so their
+    // cleanup pass does not need the shared memory lock. (An object that
+    // somehow does own shared data takes the lock itself when it
+    // dereferences that data.)
+    //
+
+    InternalEnterCriticalSection(pthr, &m_csAnonymousListLock);
 
     while (!IsListEmpty(&m_leAnonymousObjects))
     {
@@ -109,6 +128,11 @@ CSharedMemoryObjectManager::Shutdown(
         pshmobj->CleanupForProcessShutdown(pthr);
     }
 
+    InternalLeaveCriticalSection(pthr, &m_csAnonymousListLock);
+
+    InternalEnterCriticalSection(pthr, &m_csNamedListLock);
+    SHMLock();
+
     while (!IsListEmpty(&m_leNamedObjects))
     {
         ple = RemoveTailList(&m_leNamedObjects);
@@ -117,7 +141,7 @@ CSharedMemoryObjectManager::Shutdown(
     }
 
     SHMRelease();
-    InternalLeaveCriticalSection(pthr, &m_csListLock);
+    InternalLeaveCriticalSection(pthr, &m_csNamedListLock);
 
     LOGEXIT("CSharedMemoryObjectManager::Shutdown returns %d\n", NO_ERROR);
     
@@ -162,13 +186,28 @@ CSharedMemoryObjectManager::AllocateObject(
         ppobjNew
         );
 
+    //
+    // The object's name determines which list it will live on, and
+    // therefore which list lock guards its destruction.
+    //
+
+    CRITICAL_SECTION *pcsListLock;
+    if (0 != poa->sObjectName.GetStringLength())
+    {
+        pcsListLock = &m_csNamedListLock;
+    }
+    else
+    {
+        pcsListLock = &m_csAnonymousListLock;
+    }
+
     if (CObjectType::WaitableObject == pot->GetSynchronizationSupport())
     {
         _ASSERTE(FALSE);
     }
     else
     {
-        pshmobj = InternalNew<CSharedMemoryObject>(pot, &m_csListLock);
+        pshmobj = InternalNew<CSharedMemoryObject>(pot, pcsListLock);
     }
 
     if (NULL != pshmobj)
@@ -232,6 +271,8 @@ CSharedMemoryObjectManager::RegisterObject(
     IPalObject *pobjExisting;
     BOOL fInherit = FALSE;
     BOOL fShared = FALSE;
+    BOOL fNamed = FALSE;
+    CRITICAL_SECTION *pcsListLock = NULL;
 
     _ASSERTE(NULL != pthr);
     _ASSERTE(NULL != pobjToRegister);
@@ -261,8 +302,16 @@ CSharedMemoryObjectManager::RegisterObject(
 
     potObj = pobjToRegister->GetObjectType();
     fShared = (SharedObject == pshmobj->GetObjectDomain());
-    
-    InternalEnterCriticalSection(pthr, &m_csListLock);
+    fNamed = (0 != poa->sObjectName.GetStringLength());
+
+    //
+    // Only the list the object is headed for needs to be locked;
+    // anonymous registration must not contend with named lookups.
+    //
+
+    pcsListLock = fNamed ? &m_csNamedListLock : &m_csAnonymousListLock;
+
+    InternalEnterCriticalSection(pthr, pcsListLock);
 
     if (fShared)
     {
@@ -274,7 +323,7 @@ CSharedMemoryObjectManager::RegisterObject(
         SHMLock();
     }
 
-    if (0 != poa->sObjectName.GetStringLength())
+    if (fNamed)
     {
         SHMPTR shmObjectListHead = NULL;
 
@@ -470,8 +519,8 @@ RegisterObjectExit:
     {
         SHMRelease();
     }
-    
-    InternalLeaveCriticalSection(pthr, &m_csListLock);
+
+    InternalLeaveCriticalSection(pthr, pcsListLock);
 
     if (NULL != pobjToRegister)
     {
@@ -535,7 +584,7 @@ CSharedMemoryObjectManager::LocateObject(
 
     TRACE("Searching for object name %S\n", psObjectToLocate->GetString());
 
-    InternalEnterCriticalSection(pthr, &m_csListLock);
+    InternalEnterCriticalSection(pthr, &m_csNamedListLock);
 
     //
     // Search the local named object list for this object
@@ -710,7 +759,7 @@ LocateObjectExitSHMRelease:
 
 LocateObjectExit:
 
-    InternalLeaveCriticalSection(pthr, &m_csListLock);
+    InternalLeaveCriticalSection(pthr, &m_csNamedListLock);
 
     LOGEXIT("CSharedMemoryObjectManager::LocateObject returns %d\n", palError);
 
@@ -992,7 +1041,7 @@ CSharedMemoryObjectManager::ReferenceMultipleObjectsByHandleArray(
     //
     // The handle manager lock must be released before releasing
     // any object references, as ReleaseReference will acquire
-    // the object manager list lock (which needs to be acquired before
+    // the object's list lock (which needs to be acquired before
     // the handle manager lock)
     //
 
@@ -1097,6 +1146,7 @@ CSharedMemoryObjectManager::ImportSharedObjectIntoProcess(
     PAL_ERROR palError = NO_ERROR;
     CSharedMemoryObject *pshmobj = NULL;
     PLIST_ENTRY pleObjectList;
+    CRITICAL_SECTION *pcsListLock;
 
     _ASSERTE(NULL != pthr);
     _ASSERTE(NULL != pot);
@@ -1117,6 +1167,17 @@ CSharedMemoryObjectManager::ImportSharedObjectIntoProcess(
         ppshmobj
         );
     
+    if (0 != psmod->dwNameLength)
+    {
+        pleObjectList = &m_leNamedObjects;
+        pcsListLock = &m_csNamedListLock;
+    }
+    else
+    {
+        pleObjectList = &m_leAnonymousObjects;
+        pcsListLock = &m_csAnonymousListLock;
+    }
+
     if (CObjectType::WaitableObject == pot->GetSynchronizationSupport())
     {
         _ASSERTE(FALSE);
@@ -1124,7 +1185,7 @@ CSharedMemoryObjectManager::ImportSharedObjectIntoProcess(
     else
     {
         pshmobj = InternalNew<CSharedMemoryObject>(pot,
-                                                   &m_csListLock,
+                                                   pcsListLock,
                                                    shmSharedObjectData,
                                                    psmod,
                                                    fAddRefSharedData);
@@ -1135,16 +1196,14 @@ CSharedMemoryObjectManager::ImportSharedObjectIntoProcess(
         palError = pshmobj->InitializeFromExistingSharedData(pthr, poa);
         if (NO_ERROR == palError)
         {
-            if (0 != psmod->dwNameLength)
-            {
-                pleObjectList = &m_leNamedObjects;
-            }
-            else
-            {
-                pleObjectList = &m_leAnonymousObjects;
-            }
-            
+            //
+            // On the named path the caller (LocateObject) already holds
+            // the named list lock, and this critical section is recursive.
+            //
+
+            InternalEnterCriticalSection(pthr, pcsListLock);
             InsertTailList(pleObjectList, pshmobj->GetObjectListLink());
+            InternalLeaveCriticalSection(pthr, pcsListLock);
         }
         else
         {
@@ -31,8 +31,18 @@ namespace CorUnix
     {
     protected:
 
-        CRITICAL_SECTION m_csListLock;
-        bool m_fListLockInitialized;
+        //
+        // The named and anonymous object lists are guarded by separate
+        // locks so that create / close traffic for unnamed objects --
+        // the overwhelming bulk of object churn in this process -- does
+        // not serialize against named object registration and lookup.
+        // An object's list is fixed at allocation time, so each object
+        // holds a pointer to the one lock that guards its list.
+        //
+
+        CRITICAL_SECTION m_csNamedListLock;
+        CRITICAL_SECTION m_csAnonymousListLock;
+        bool m_fListLocksInitialized;
         LIST_ENTRY m_leNamedObjects;
         LIST_ENTRY m_leAnonymousObjects;
         
@@ -53,7 +63,7 @@ namespace CorUnix
 
         CSharedMemoryObjectManager()
             :
-            m_fListLockInitialized(FALSE)
+            m_fListLocksInitialized(FALSE)
         {
         };
 
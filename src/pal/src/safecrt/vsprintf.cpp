@@ -26,6 +26,618 @@ typedef int (*OUTPUTFN)(miniFILE *, const char *, va_list);
 static int _vsnprintf_helper( OUTPUTFN outfn, char *string, size_t count, const char *format, va_list ap );
 static int _vscprintf_helper ( OUTPUTFN outfn, const char *format, va_list ap);
 
+/***
+* Fast formatter
+*
+*Purpose:
+*       The general formatting engine (_output_s) re-parses the format
+*       string character by character through a state table and funnels
+*       every byte through the miniFILE putc path. Callers on the hot
+*       output paths format the same handful of simple conversions with
+*       the same format literals millions of times, so those formats are
+*       compiled once into a short op list -- literal runs and conversion
+*       descriptors -- cached by format-string address, and replayed with
+*       direct buffer writes. Anything outside the supported subset
+*       (precision, '*', '#', '+', wide strings, floating point, %n, ...)
+*       is rejected at compile time and falls back to _output_s, so
+*       behavior for those formats is unchanged.
+*
+*******************************************************************************/
+
+#define _FASTFMT_CACHE_SIZE 64  /* cached compiled formats; power of two */
+#define _FASTFMT_MAX_OPS    24  /* ops per format; longer formats fall back */
+#define _FASTFMT_MAX_FORMAT 96  /* longest cacheable format, incl. the nul */
+
+/* op kinds */
+#define _FASTFMT_OP_TEXT    1   /* literal run from the format string */
+#define _FASTFMT_OP_CONV    2   /* one conversion */
+
+/* conversions */
+#define _FASTFMT_CONV_CHAR  1   /* %c */
+#define _FASTFMT_CONV_STR   2   /* %s / %hs */
+#define _FASTFMT_CONV_INT   3   /* %d / %i */
+#define _FASTFMT_CONV_UINT  4   /* %u */
+#define _FASTFMT_CONV_HEX   5   /* %x / %X */
+#define _FASTFMT_CONV_PTR   6   /* %p */
+
+/* conversion flags */
+#define _FASTFMT_ZERO   0x01    /* '0' -- pad with leading zeros */
+#define _FASTFMT_LEFT   0x02    /* '-' -- left justify */
+#define _FASTFMT_I64    0x04    /* 64-bit argument (ll, I64, l on LP64) */
+#define _FASTFMT_UPPER  0x08    /* uppercase hex digits */
+
+typedef struct
+{
+    unsigned char kind;         /* _FASTFMT_OP_* */
+    unsigned char conv;         /* _FASTFMT_CONV_* when kind is CONV */
+    unsigned char flags;        /* _FASTFMT_* flag bits */
+    unsigned short width;       /* minimum field width; 0 = none */
+    unsigned short offset;      /* literal run start, for TEXT */
+    unsigned short length;      /* literal run length, for TEXT */
+} _FASTFMT_OPREC;
+
+typedef struct
+{
+    const char * volatile format;   /* claim token only; never trusted on hit */
+    volatile int ready;             /* set once the op list is filled in */
+    int cops;
+    _FASTFMT_OPREC rgops[_FASTFMT_MAX_OPS];
+    char szformat[_FASTFMT_MAX_FORMAT]; /* copy of the format; hit key */
+} _FASTFMT_ENTRY;
+
+static _FASTFMT_ENTRY __fastfmt_cache[_FASTFMT_CACHE_SIZE];
+
+/***
+*int __fastfmt_compile(format, rgops) - compile a format string
+*
+*Purpose:
+*       Translate a format string into an op list. Returns the number of
+*       ops, or -1 if the format uses anything outside the supported
+*       subset and must go through _output_s instead.
+*
+*******************************************************************************/
+
+static int __fastfmt_compile (
+        const char *format,
+        _FASTFMT_OPREC *rgops
+        )
+{
+    const char *p = format;
+    int cops = 0;
+
+    while (*p != '\0')
+    {
+        if (cops >= _FASTFMT_MAX_OPS)
+        {
+            return -1;
+        }
+
+        if (*p != '%')
+        {
+            const char *start = p;
+
+            while (*p != '\0' && *p != '%')
+            {
+                p++;
+            }
+
+            if ((p - start) > 0xFFFF || (start - format) > 0xFFFF)
+            {
+                return -1;
+            }
+
+            rgops[cops].kind = _FASTFMT_OP_TEXT;
+            rgops[cops].offset = (unsigned short)(start - format);
+            rgops[cops].length = (unsigned short)(p - start);
+            cops++;
+            continue;
+        }
+
+        /* '%%' -- a one-character literal run pointing at the '%' */
+        if (p[1] == '%')
+        {
+            if ((p - format) > 0xFFFF)
+            {
+                return -1;
+            }
+
+            rgops[cops].kind = _FASTFMT_OP_TEXT;
+            rgops[cops].offset = (unsigned short)(p - format);
+            rgops[cops].length = 1;
+            cops++;
+            p += 2;
+            continue;
+        }
+
+        {
+            unsigned char flags = 0;
+            unsigned long width = 0;
+            int f64 = 0;
+            int flong = 0;
+            unsigned char conv;
+
+            p++;
+
+            /* flags: only '-' and '0' are supported */
+            for (;;)
+            {
+                if (*p == '-')
+                {
+                    flags |= _FASTFMT_LEFT;
+                    p++;
+                }
+                else if (*p == '0')
+                {
+                    flags |= _FASTFMT_ZERO;
+                    p++;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            /* field width; '*' and precision fall back */
+            while (*p >= '0' && *p <= '9')
+            {
+                width = width * 10 + (*p - '0');
+                if (width > 0xFFFF)
+                {
+                    return -1;
+                }
+                p++;
+            }
+
+            if (*p == '*' || *p == '.')
+            {
+                return -1;
+            }
+
+            /* size prefixes */
+            if (*p == 'l')
+            {
+                p++;
+                if (*p == 'l')
+                {
+                    f64 = 1;
+                    p++;
+                }
+                else
+                {
+                    flong = 1;
+                    if (sizeof(long) == 8)
+                    {
+                        f64 = 1;
+                    }
+                }
+            }
+            else if (*p == 'h')
+            {
+                /* short args are promoted; nothing to record */
+                p++;
+            }
+            else if (*p == 'I' && p[1] == '6' && p[2] == '4')
+            {
+                f64 = 1;
+                p += 3;
+            }
+
+            switch (*p)
+            {
+                case 'd':
+                case 'i':
+                    conv = _FASTFMT_CONV_INT;
+                    break;
+                case 'u':
+                    conv = _FASTFMT_CONV_UINT;
+                    break;
+                case 'x':
+                    conv = _FASTFMT_CONV_HEX;
+                    break;
+                case 'X':
+                    conv = _FASTFMT_CONV_HEX;
+                    flags |= _FASTFMT_UPPER;
+                    break;
+                case 'p':
+                    /* %lp / %I64p change the printed width; fall back */
+                    if (flong || f64)
+                    {
+                        return -1;
+                    }
+                    conv = _FASTFMT_CONV_PTR;
+                    break;
+                case 's':
+                    /* %ls is a wide string; not handled here */
+                    if (flong)
+                    {
+                        return -1;
+                    }
+                    conv = _FASTFMT_CONV_STR;
+                    break;
+                case 'c':
+                    if (flong)
+                    {
+                        return -1;
+                    }
+                    conv = _FASTFMT_CONV_CHAR;
+                    break;
+                default:
+                    return -1;
+            }
+
+            /* zero padding only applies to the numeric conversions */
+            if ((flags & _FASTFMT_ZERO) &&
+                (conv == _FASTFMT_CONV_STR || conv == _FASTFMT_CONV_CHAR))
+            {
+                return -1;
+            }
+
+            if (f64)
+            {
+                flags |= _FASTFMT_I64;
+            }
+
+            rgops[cops].kind = _FASTFMT_OP_CONV;
+            rgops[cops].conv = conv;
+            rgops[cops].flags = flags;
+            rgops[cops].width = (unsigned short)width;
+            cops++;
+            p++;
+        }
+    }
+
+    return cops;
+}
+
+/* replay output cursor */
+typedef struct
+{
+    char *dst;
+    size_t remain;
+    size_t total;
+} _FASTFMT_CURSOR;
+
+static void __fastfmt_write (
+        _FASTFMT_CURSOR *pcur,
+        const char *src,
+        size_t length
+        )
+{
+    size_t copy = (length <= pcur->remain) ? length : pcur->remain;
+
+    if (copy > 0)
+    {
+        memcpy(pcur->dst, src, copy);
+        pcur->dst += copy;
+        pcur->remain -= copy;
+    }
+
+    pcur->total += length;
+}
+
+static void __fastfmt_pad (
+        _FASTFMT_CURSOR *pcur,
+        char ch,
+        int length
+        )
+{
+    while (length-- > 0)
+    {
+        if (pcur->remain > 0)
+        {
+            *(pcur->dst)++ = ch;
+            pcur->remain--;
+        }
+        pcur->total++;
+    }
+}
+
+/***
+*int __fastfmt_replay(string, count, format, rgops, cops, ap) - replay ops
+*
+*Purpose:
+*       Format the arguments by replaying a compiled op list. Output
+*       semantics (truncation, termination, return values) match
+*       _vsnprintf_helper: the count of characters written on success,
+*       -2 on truncation.
+*
+*******************************************************************************/
+
+static int __fastfmt_replay (
+        char *string,
+        size_t count,
+        const char *format,
+        const _FASTFMT_OPREC *rgops,
+        int cops,
+        va_list ap
+        )
+{
+    _FASTFMT_CURSOR cur;
+    int i;
+
+    if (count > INT_MAX)
+    {
+        /* old-style functions allow any large value to mean unbounded */
+        count = INT_MAX;
+    }
+
+    cur.dst = string;
+    cur.remain = count;
+    cur.total = 0;
+
+    for (i = 0; i < cops; i++)
+    {
+        const _FASTFMT_OPREC *pop = &rgops[i];
+
+        if (pop->kind == _FASTFMT_OP_TEXT)
+        {
+            __fastfmt_write(&cur, format + pop->offset, pop->length);
+            continue;
+        }
+
+        switch (pop->conv)
+        {
+            case _FASTFMT_CONV_CHAR:
+            {
+                char ch = (char)va_arg(ap, int);
+                int padding = (int)pop->width - 1;
+
+                if (!(pop->flags & _FASTFMT_LEFT))
+                {
+                    __fastfmt_pad(&cur, ' ', padding);
+                }
+                __fastfmt_write(&cur, &ch, 1);
+                if (pop->flags & _FASTFMT_LEFT)
+                {
+                    __fastfmt_pad(&cur, ' ', padding);
+                }
+                break;
+            }
+
+            case _FASTFMT_CONV_STR:
+            {
+                const char *sz = va_arg(ap, const char *);
+                size_t length;
+                int padding;
+
+                if (sz == NULL)
+                {
+                    /* prints '(null)' if a null string is passed */
+                    sz = "(null)";
+                }
+
+                length = strlen(sz);
+                padding = (int)pop->width - (int)length;
+
+                if (!(pop->flags & _FASTFMT_LEFT))
+                {
+                    __fastfmt_pad(&cur, ' ', padding);
+                }
+                __fastfmt_write(&cur, sz, length);
+                if (pop->flags & _FASTFMT_LEFT)
+                {
+                    __fastfmt_pad(&cur, ' ', padding);
+                }
+                break;
+            }
+
+            default:
+            {
+                /* the numeric conversions share one emitter */
+                char digits[32];    /* built back to front */
+                int cchDigits = 0;
+                int cchZero = 0;    /* forced leading zeros (%p) */
+                char chSign = 0;
+                unsigned __int64 number;
+                int body;
+                int padding;
+
+                if (pop->conv == _FASTFMT_CONV_PTR)
+                {
+                    number = (unsigned __int64)(size_t)va_arg(ap, void *);
+                }
+                else if (pop->flags & _FASTFMT_I64)
+                {
+                    number = (unsigned __int64)va_arg(ap, __int64);
+                }
+                else if (pop->conv == _FASTFMT_CONV_INT)
+                {
+                    number = (unsigned __int64)(__int64)va_arg(ap, int);
+                }
+                else
+                {
+                    number = va_arg(ap, unsigned int);
+                }
+
+                if (pop->conv == _FASTFMT_CONV_INT)
+                {
+                    __int64 l = (__int64)number;
+
+                    if (!(pop->flags & _FASTFMT_I64))
+                    {
+                        l = (int)l;
+                    }
+
+                    if (l < 0)
+                    {
+                        chSign = '-';
+                        number = (unsigned __int64)0 - (unsigned __int64)l;
+                    }
+                    else
+                    {
+                        number = (unsigned __int64)l;
+                    }
+                }
+                else if (!(pop->flags & _FASTFMT_I64) &&
+                         pop->conv != _FASTFMT_CONV_PTR)
+                {
+                    number = (unsigned int)number;
+                }
+
+                if (pop->conv == _FASTFMT_CONV_INT ||
+                    pop->conv == _FASTFMT_CONV_UINT)
+                {
+                    do
+                    {
+                        digits[cchDigits++] = (char)('0' + (number % 10));
+                        number /= 10;
+                    } while (number != 0);
+                }
+                else
+                {
+                    /* %p prints full-pointer-width uppercase hex */
+                    const char *rgch = (pop->conv == _FASTFMT_CONV_PTR ||
+                                        (pop->flags & _FASTFMT_UPPER))
+                        ? "0123456789ABCDEF"
+                        : "0123456789abcdef";
+
+                    do
+                    {
+                        digits[cchDigits++] = rgch[number & 0xF];
+                        number >>= 4;
+                    } while (number != 0);
+
+                    if (pop->conv == _FASTFMT_CONV_PTR)
+                    {
+                        cchZero = (int)(2 * sizeof(void *)) - cchDigits;
+                        if (cchZero < 0)
+                        {
+                            cchZero = 0;
+                        }
+                    }
+                }
+
+                body = cchDigits + cchZero;
+                padding = (int)pop->width - body - (chSign != 0);
+
+                if (pop->flags & _FASTFMT_LEFT)
+                {
+                    /* left justify: sign, digits, then trailing blanks */
+                    if (chSign != 0)
+                    {
+                        __fastfmt_write(&cur, &chSign, 1);
+                    }
+                }
+                else if (pop->flags & _FASTFMT_ZERO)
+                {
+                    /* zero pad goes between the sign and the digits */
+                    if (chSign != 0)
+                    {
+                        __fastfmt_write(&cur, &chSign, 1);
+                    }
+                    __fastfmt_pad(&cur, '0', padding);
+                }
+                else
+                {
+                    __fastfmt_pad(&cur, ' ', padding);
+                    if (chSign != 0)
+                    {
+                        __fastfmt_write(&cur, &chSign, 1);
+                    }
+                }
+
+                __fastfmt_pad(&cur, '0', cchZero);
+
+                while (cchDigits > 0)
+                {
+                    __fastfmt_write(&cur, &digits[--cchDigits], 1);
+                }
+
+                if (pop->flags & _FASTFMT_LEFT)
+                {
+                    __fastfmt_pad(&cur, ' ', padding);
+                }
+                break;
+            }
+        }
+    }
+
+    if (cur.total < count)
+    {
+        *cur.dst = '\0';
+        return (int)cur.total;
+    }
+
+    /* the buffer was too small; we return -2 to indicate truncation */
+    string[count - 1] = '\0';
+    return -2;
+}
+
+/***
+*int __fastfmt_tryformat(string, count, format, ap, pretval) - fast path
+*
+*Purpose:
+*       Attempt to format using a compiled op list, consulting and
+*       populating the format cache. Returns nonzero and sets *pretval
+*       when the format was handled; zero means the caller must use the
+*       general engine.
+*
+*       Cache slots are claimed with a compare-and-swap on the format
+*       pointer and published with a 'ready' flag, so readers never see
+*       a partially filled op list. The format address is only a hash
+*       and a claim token: callers may hand us heap- or stack-built
+*       formats whose storage gets reused, so each entry keeps its own
+*       copy of the format and a hit must match that copy byte for
+*       byte before the op list is replayed. The gcc/clang __sync
+*       builtins are used directly to keep this file free of outside
+*       dependencies.
+*
+*******************************************************************************/
+
+static int __fastfmt_tryformat (
+        char *string,
+        size_t count,
+        const char *format,
+        va_list ap,
+        int *pretval
+        )
+{
+    _FASTFMT_ENTRY *pentry;
+    _FASTFMT_OPREC rgops[_FASTFMT_MAX_OPS];
+    int cops;
+    va_list apcopy;
+
+    pentry = &__fastfmt_cache[(((size_t)format) >> 4) & (_FASTFMT_CACHE_SIZE - 1)];
+
+    if (pentry->ready)
+    {
+        /* pairs with the publishing barrier below: 'ready' must be
+           observed after the op list and the format copy, even on
+           weakly-ordered targets */
+        __sync_synchronize();
+        if (strcmp(pentry->szformat, format) == 0)
+        {
+            va_copy(apcopy, ap);
+            *pretval = __fastfmt_replay(string, count, format,
+                                        pentry->rgops, pentry->cops, apcopy);
+            va_end(apcopy);
+            return 1;
+        }
+    }
+
+    cops = __fastfmt_compile(format, rgops);
+    if (cops < 0)
+    {
+        return 0;
+    }
+
+    if (pentry->format == NULL &&
+        strlen(format) < _FASTFMT_MAX_FORMAT &&
+        __sync_bool_compare_and_swap(&pentry->format, (const char *)NULL, format))
+    {
+        memcpy(pentry->rgops, rgops, cops * sizeof(rgops[0]));
+        pentry->cops = cops;
+        strcpy(pentry->szformat, format);
+        __sync_synchronize();
+        pentry->ready = 1;
+    }
+
+    va_copy(apcopy, ap);
+    *pretval = __fastfmt_replay(string, count, format, rgops, cops, apcopy);
+    va_end(apcopy);
+    return 1;
+}
+
 /***
 *ifndef _COUNT_
 *int vsprintf(string, format, ap) - print formatted data to string from arg ptr
@@ -88,6 +700,17 @@ int __cdecl _vsnprintf_helper (
 
         _VALIDATE_RETURN( (count == 0) || (string != NULL), EINVAL, -1 );
 
+        /* fast path: formats limited to the common conversions are
+           compiled into an op list and replayed with direct buffer
+           writes, bypassing the miniFILE interpreter */
+        if (string != NULL && count > 0)
+        {
+            if (__fastfmt_tryformat(string, count, format, ap, &retval))
+            {
+                return retval;
+            }
+        }
+
         if(count>INT_MAX)
         {
             /* old-style functions allow any large value to mean unbounded */
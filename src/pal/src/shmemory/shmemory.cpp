@@ -69,10 +69,70 @@ SHMLock/SHMRelease pair, this is actually the number of locks held by a single
 thread. */
 static Volatile<LONG> lock_count;
 
-/* thread ID of thread holding the SHM lock. used for debugging purposes : 
+/* thread ID of thread holding the SHM lock. used for debugging purposes :
    SHMGet/SetInfo will verify that the calling thread holds the lock */
 static Volatile<HANDLE> locking_thread;
 
+/* Block allocator ************************************************************/
+
+/*
+Shared memory blocks are bucketed by size class; released blocks go on the
+free list of their class and are handed back out in constant time, so that
+object setup/teardown cycles (the dominant SHM traffic) don't pound the
+heap allocator. Size classes are powers of two from SHM_BLOCK_SMALLEST up;
+anything larger bypasses the cache. Free lists are guarded by shm_critsec,
+which the allocation paths already hold via SHMLock in most callers; the
+critical section is recursive, so taking it again here is harmless.
+*/
+
+#define SHM_BLOCK_SMALLEST    32
+#define SHM_BLOCK_CLASSES     5   /* 32, 64, 128, 256, 512 bytes */
+#define SHM_BLOCK_CLASS_RAW   SHM_BLOCK_CLASSES /* block too large for a class */
+#define SHM_BLOCK_MAX_CACHED  64  /* per-class cap on cached free blocks */
+
+typedef struct _SHM_POOL_BLOCK
+{
+    union
+    {
+        struct _SHM_POOL_BLOCK *psbNext; /* link while on a free list */
+        size_t nSizeClass;               /* size class while in use */
+    } u;
+    size_t nReserved; /* keeps the user data aligned for any type */
+} SHM_POOL_BLOCK;
+
+static SHM_POOL_BLOCK *shm_block_lists[SHM_BLOCK_CLASSES];
+static DWORD shm_block_counts[SHM_BLOCK_CLASSES];
+
+/*++
+SHMBlockSizeClass
+
+Map a block size to its size class; returns SHM_BLOCK_CLASS_RAW if the
+size exceeds the largest class.
+--*/
+static size_t SHMBlockSizeClass(size_t size)
+{
+    size_t nClass = 0;
+    size_t nClassSize = SHM_BLOCK_SMALLEST;
+
+    while (nClass < SHM_BLOCK_CLASSES && nClassSize < size)
+    {
+        nClassSize <<= 1;
+        nClass++;
+    }
+
+    return nClass;
+}
+
+/*++
+SHMBlockClassSize
+
+Usable size of blocks belonging to the given size class.
+--*/
+static size_t SHMBlockClassSize(size_t nClass)
+{
+    return (size_t)SHM_BLOCK_SMALLEST << nClass;
+}
+
 /* Public function implementations ********************************************/
 
 /*++
@@ -93,6 +153,10 @@ BOOL SHMInitialize(void)
         /* SHM information array starts with NULLs */
         memset((void *)shm_header.shm_info, 0, SIID_LAST*sizeof(SHMPTR));
 
+        /* block free lists start out empty */
+        memset(shm_block_lists, 0, sizeof(shm_block_lists));
+        memset(shm_block_counts, 0, sizeof(shm_block_counts));
+
         TRACE("Global shared memory initialization complete.\n");
 
     lock_count = 0;
@@ -133,6 +197,23 @@ void SHMCleanup(void)
     /* Now for the interprocess stuff. */
     DeleteCriticalSection(&shm_critsec);
 
+    /* return the cached free blocks to the heap; no lock needed, we're the
+       only thread left by the time this is called */
+    for (int i = 0; i < SHM_BLOCK_CLASSES; i++)
+    {
+        SHM_POOL_BLOCK *psb = shm_block_lists[i];
+
+        while (NULL != psb)
+        {
+            SHM_POOL_BLOCK *psbNext = psb->u.psbNext;
+            free(psb);
+            psb = psbNext;
+        }
+
+        shm_block_lists[i] = NULL;
+        shm_block_counts[i] = 0;
+    }
+
     TRACE("SHMCleanup complete!\n");
 }
 
@@ -387,3 +468,190 @@ BOOL SHMSetInfo(SHM_INFO_ID element, SHMPTR value)
 
     return TRUE;
 }
+
+/*++
+Function :
+    SHMalloc
+
+    Allocate a block of shared memory, served from the size-class free
+    lists where possible
+
+Parameters :
+    size_t size : size of block required
+
+Return value :
+    SHMPTR for the block, 0 on failure
+
+(see documentation in shmemory.h)
+--*/
+SHMPTR SHMalloc(size_t size)
+{
+    SHM_POOL_BLOCK *psb = NULL;
+    size_t nClass;
+
+    TRACE("SHMalloc() called; requested size is %u\n", size);
+
+    if (0 == size)
+    {
+        WARN("Got a request for a 0-byte block! returning 0\n");
+        return 0;
+    }
+
+    nClass = SHMBlockSizeClass(size);
+
+    if (SHM_BLOCK_CLASS_RAW != nClass)
+    {
+        PALCEnterCriticalSection(&shm_critsec);
+
+        psb = shm_block_lists[nClass];
+        if (NULL != psb)
+        {
+            shm_block_lists[nClass] = psb->u.psbNext;
+            shm_block_counts[nClass]--;
+        }
+
+        PALCLeaveCriticalSection(&shm_critsec);
+    }
+
+    if (NULL == psb)
+    {
+        size_t nBlockSize = (SHM_BLOCK_CLASS_RAW != nClass)
+            ? SHMBlockClassSize(nClass)
+            : size;
+
+        psb = (SHM_POOL_BLOCK *)malloc(sizeof(SHM_POOL_BLOCK) + nBlockSize);
+        if (NULL == psb)
+        {
+            ERROR("Unable to allocate %u-byte block\n", size);
+            return 0;
+        }
+    }
+
+    psb->u.nSizeClass = nClass;
+
+    TRACE("Allocation successful; block is %p (size class %u)\n",
+          (SHMPTR)(psb + 1), nClass);
+
+    return (SHMPTR)(psb + 1);
+}
+
+/*++
+Function :
+    SHMfree
+
+    Release a block of shared memory; blocks belonging to a size class
+    are cached on that class's free list for reuse
+
+Parameters :
+    SHMPTR shmptr : block to release
+
+(see documentation in shmemory.h)
+--*/
+void SHMfree(SHMPTR shmptr)
+{
+    SHM_POOL_BLOCK *psb;
+    size_t nClass;
+    BOOL fCached = FALSE;
+
+    if (NULL == shmptr)
+    {
+        WARN("can't free a NULL SHMPTR!\n");
+        return;
+    }
+
+    TRACE("Releasing SHMPTR %p\n", shmptr);
+
+    psb = ((SHM_POOL_BLOCK *)shmptr) - 1;
+    nClass = psb->u.nSizeClass;
+
+    if (nClass > SHM_BLOCK_CLASS_RAW)
+    {
+        ASSERT("SHMPTR %p has invalid size class %u -- double free or "
+               "corrupted block?\n", shmptr, nClass);
+        return;
+    }
+
+    if (SHM_BLOCK_CLASS_RAW != nClass)
+    {
+        PALCEnterCriticalSection(&shm_critsec);
+
+        if (shm_block_counts[nClass] < SHM_BLOCK_MAX_CACHED)
+        {
+            psb->u.psbNext = shm_block_lists[nClass];
+            shm_block_lists[nClass] = psb;
+            shm_block_counts[nClass]++;
+            fCached = TRUE;
+        }
+
+        PALCLeaveCriticalSection(&shm_critsec);
+    }
+
+    if (!fCached)
+    {
+        free(psb);
+    }
+}
+
+/*++
+Function :
+    SHMPrime
+
+    Populate the free list serving the given block size ahead of a burst
+    of allocations
+
+Parameters :
+    size_t size : block size the caller intends to allocate
+    DWORD count : number of blocks to make available
+
+Return value :
+    TRUE if the free list was primed, FALSE otherwise
+
+(see documentation in shmemory.h)
+--*/
+BOOL SHMPrime(size_t size, DWORD count)
+{
+    size_t nClass;
+    size_t nBlockSize;
+
+    if (0 == size)
+    {
+        WARN("Got a request to prime 0-byte blocks!\n");
+        return FALSE;
+    }
+
+    nClass = SHMBlockSizeClass(size);
+    if (SHM_BLOCK_CLASS_RAW == nClass)
+    {
+        WARN("Can't prime %u-byte blocks; largest size class is %u bytes\n",
+             size, SHMBlockClassSize(SHM_BLOCK_CLASSES - 1));
+        return FALSE;
+    }
+
+    nBlockSize = SHMBlockClassSize(nClass);
+
+    PALCEnterCriticalSection(&shm_critsec);
+
+    while (count > 0 && shm_block_counts[nClass] < SHM_BLOCK_MAX_CACHED)
+    {
+        SHM_POOL_BLOCK *psb = (SHM_POOL_BLOCK *)malloc(sizeof(SHM_POOL_BLOCK) + nBlockSize);
+
+        if (NULL == psb)
+        {
+            WARN("Out of memory while priming size class %u\n", nClass);
+            PALCLeaveCriticalSection(&shm_critsec);
+            return FALSE;
+        }
+
+        psb->u.psbNext = shm_block_lists[nClass];
+        shm_block_lists[nClass] = psb;
+        shm_block_counts[nClass]++;
+        count--;
+    }
+
+    PALCLeaveCriticalSection(&shm_critsec);
+
+    TRACE("Size class %u primed (%u blocks cached)\n",
+          nClass, shm_block_counts[nClass]);
+
+    return TRUE;
+}
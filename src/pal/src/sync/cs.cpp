@@ -22,6 +22,7 @@
 
 #include <sched.h>
 #include <pthread.h>
+#include <unistd.h>
 
 using namespace CorUnix;
 
@@ -112,6 +113,25 @@ SET_DEFAULT_DEBUG_CHANNEL(CRITSEC);
 #define PALCS_LOCK_AWAKENED_WAITER     2
 #define PALCS_LOCK_WAITER_INC          4
 
+//
+// Adaptive spinning
+//
+// On a multiprocessor machine a contended CS spins in user mode before
+// falling back to the kernel wait, since most internal CSs are held for
+// far less than a context switch worth of time. A spin count of zero at
+// initialization selects the default, which scales with the number of
+// CPUs; on uniprocessor machines spinning is disabled entirely. The
+// per-CS SpinCount then adapts: acquisitions won while spinning raise
+// it, spins that still ended in a kernel wait lower it, within the
+// bounds below. Most spin iterations are just a CPU pause; once per
+// PALCS_SPIN_YIELD_MASK+1 iterations the thread yields the processor to
+// stay polite on oversubscribed machines.
+//
+#define PALCS_SPIN_COUNT_UNIT          256
+#define PALCS_MIN_SPIN_COUNT           64
+#define PALCS_MAX_SPIN_COUNT           8192
+#define PALCS_SPIN_YIELD_MASK          0xFF
+
 #define PALCS_GETLBIT(val)      ((int)(0!=(PALCS_LOCK_BIT&val)))
 #define PALCS_GETAWBIT(val)     ((int)(0!=(PALCS_LOCK_AWAKENED_WAITER&val)))
 #define PALCS_GETWCOUNT(val)    (val/PALCS_LOCK_WAITER_INC)
@@ -174,6 +194,52 @@ namespace CorUnix
 }
 #endif // _DEBUG
 
+/*++
+Function:
+  PALCS_GetDefaultSpinCount
+
+Returns the spin count used for CSs initialized with a zero spin count.
+The value is computed once, from the number of CPUs the OS reports.
+CSs must stay independent from the other PAL subsystems (see the notes
+at the top of this file), so the CPU count is read with sysconf directly
+--*/
+static LONG PALCS_GetDefaultSpinCount()
+{
+    static Volatile<LONG> lDefaultSpinCount = -1;
+
+    LONG lSpinCount = lDefaultSpinCount;
+    if (-1 == lSpinCount)
+    {
+        long lCpus = 1;
+#if HAVE_SYSCONF && defined(_SC_NPROCESSORS_ONLN)
+        lCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (lCpus < 1)
+        {
+            lCpus = 1;
+        }
+#endif // HAVE_SYSCONF && _SC_NPROCESSORS_ONLN
+
+        if (lCpus > 1)
+        {
+            lSpinCount = lCpus * PALCS_SPIN_COUNT_UNIT;
+            if (lSpinCount > PALCS_MAX_SPIN_COUNT)
+            {
+                lSpinCount = PALCS_MAX_SPIN_COUNT;
+            }
+        }
+        else
+        {
+            // Spinning on a uniprocessor machine just delays the owner
+            lSpinCount = 0;
+        }
+
+        // A race here is benign: both threads compute the same value
+        lDefaultSpinCount = lSpinCount;
+    }
+
+    return lSpinCount;
+}
+
 #define ObtainCurrentThreadId(thread) ObtainCurrentThreadIdImpl(thread, __func__)
 static SIZE_T ObtainCurrentThreadIdImpl(CPalThread *pCurrentThread, const char *callingFuncName)
 {
@@ -622,6 +688,12 @@ namespace CorUnix
         }
 #endif // _DEBUG
 
+        // A zero spin count selects the adaptive default
+        if (0 == dwSpinCount)
+        {
+            dwSpinCount = (DWORD)PALCS_GetDefaultSpinCount();
+        }
+
         // Init CS data
         pPalCriticalSection->DebugInfo         = NULL;
         pPalCriticalSection->LockCount         = 0;
@@ -702,13 +774,15 @@ namespace CorUnix
         LONG lSpinCount;
         LONG lVal, lNewVal;
         LONG lBitsToChange, lWaitInc;
-        PalCsWaiterReturnState cwrs;    
+        PalCsWaiterReturnState cwrs;
         SIZE_T threadId;
+        bool fContended = false;
+        bool fWaitedOnCS = false;
 
         _ASSERTE(PalCsNotInitialized != pPalCriticalSection->cisInitState);
 
         threadId = ObtainCurrentThreadId(pThread);
-        
+
 
         // Check if the current thread already owns the CS
         //
@@ -733,11 +807,25 @@ namespace CorUnix
             goto IECS_exit;
         }
 
+        // Uncontended fast path: a single interlocked attempt to take a
+        // free CS before setting up for spinning and waiting. If the CS
+        // is locked, or there are waiters around, this fails and we fall
+        // through to the full enter logic below.
+        if (PALCS_LOCK_INIT == InterlockedCompareExchange(
+                &pPalCriticalSection->LockCount,
+                (LONG)PALCS_LOCK_BIT,
+                (LONG)PALCS_LOCK_INIT))
+        {
+            goto IECS_set_ownership;
+        }
+
+        fContended = true;
+
         // Set bits to change and waiter increment for an incoming thread
         lBitsToChange = PALCS_LOCK_BIT;
         lWaitInc = PALCS_LOCK_WAITER_INC;
         lSpinCount = pPalCriticalSection->SpinCount;
-        
+
         while (TRUE)
         {
             // Either this is an incoming thread, and therefore lBitsToChange 
@@ -794,16 +882,28 @@ namespace CorUnix
                     lVal = lNewVal;
                 }
 
-                if (0 < lSpinCount) 
+                if (0 < lSpinCount)
                 {
-                    sched_yield();
+                    // Spin mostly with a plain CPU pause; yield the
+                    // processor once in a while so spinning stays cheap
+                    // when there are more runnable threads than CPUs
+                    if (0 == (lSpinCount & PALCS_SPIN_YIELD_MASK))
+                    {
+                        sched_yield();
+                    }
+                    else
+                    {
+                        YieldProcessor();
+                    }
                 }
             } while (0 <= --lSpinCount);
 
             cwrs = PALCS_WaitOnCS(pPalCriticalSection, lWaitInc);
-            
-            if (PalCsReturnWaiterAwakened == cwrs) 
+
+            if (PalCsReturnWaiterAwakened == cwrs)
             {
+                fWaitedOnCS = true;
+
 #ifdef PALCS_TRANSFER_OWNERSHIP_ON_RELEASE
                 // 
                 // Fair Critical Sections
@@ -828,6 +928,29 @@ namespace CorUnix
         }
 
     IECS_set_ownership:
+        // Adapt the spin count on contended acquisitions: winning the CS
+        // while spinning makes spinning look profitable, needing a kernel
+        // wait anyway makes it look wasted. SpinCount is a heuristic, not
+        // a correctness parameter, so the unsynchronized updates here are
+        // acceptable
+        if (fContended && 0 != pPalCriticalSection->SpinCount)
+        {
+            ULONG_PTR ulSpin = pPalCriticalSection->SpinCount;
+            if (fWaitedOnCS)
+            {
+                if (ulSpin / 2 >= PALCS_MIN_SPIN_COUNT)
+                {
+                    pPalCriticalSection->SpinCount = ulSpin / 2;
+                }
+            }
+            else if (ulSpin < PALCS_MAX_SPIN_COUNT)
+            {
+                ulSpin += ulSpin / 4;
+                pPalCriticalSection->SpinCount = (ulSpin < PALCS_MAX_SPIN_COUNT)
+                    ? ulSpin : PALCS_MAX_SPIN_COUNT;
+            }
+        }
+
         // Critical section acquired: set ownership data
         pPalCriticalSection->OwningThread = threadId;
         pPalCriticalSection->RecursionCount = 1;